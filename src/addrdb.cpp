@@ -36,6 +36,22 @@ bool SerializeDB(Stream& stream, const Data& data)
     return true;
 }
 
+//! Writes the bytes of a stream serialized earlier without a size prefix.
+class SerializedSnapshot
+{
+public:
+    explicit SerializedSnapshot(const CDataStream& stream) : m_stream(stream) { }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s.write(m_stream.data(), m_stream.size());
+    }
+
+private:
+    const CDataStream& m_stream;
+};
+
 template <typename Data>
 bool SerializeFileDB(const std::string& prefix, const fs::path& path, const Data& data)
 {
@@ -142,7 +158,17 @@ CAddrDB::CAddrDB()
 
 bool CAddrDB::Write(const CAddrMan& addr)
 {
-    return SerializeFileDB("peers", pathAddr, addr);
+    // Serialize the address manager into memory first. It holds its lock
+    // while it serializes, so the disk writes happen after it releases it:
+    CDataStream ssPeers(SER_DISK, CLIENT_VERSION);
+
+    try {
+        ssPeers << addr;
+    } catch (const std::exception& e) {
+        return error("%s: Serialize error - %s", __func__, e.what());
+    }
+
+    return SerializeFileDB("peers", pathAddr, SerializedSnapshot(ssPeers));
 }
 
 bool CAddrDB::Read(CAddrMan& addr)
@@ -0,0 +1,236 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "hash.h"
+#include "txdb.h"
+
+namespace {
+const std::string ADDRESS_HISTORY = "addrtx";
+const std::string ADDRESS_UNSPENT = "addrutxo";
+const std::string SPENT_INDEX = "spent";
+const std::string ADDRESS_INDEX_START = "addrindexstart";
+} // anonymous namespace
+
+uint160 GetAddressIndexHash(const CScript& script)
+{
+    return Hash160(script.begin(), script.end());
+}
+
+CAddressIndexUpdate::CAddressIndexUpdate(int nHeight) : m_height(nHeight)
+{
+}
+
+void CAddressIndexUpdate::AddTransaction(const CTransaction& tx, const MapPrevTx& inputs)
+{
+    const uint256 txid = tx.GetHash(true);
+
+    if (fAddressIndex) {
+        for (uint32_t i = 0; i < tx.vout.size(); ++i) {
+            const CTxOut& txout = tx.vout[i];
+
+            // Skip the empty coinstake marker:
+            if (txout.IsEmpty()) {
+                continue;
+            }
+
+            const uint160 hashScript = GetAddressIndexHash(txout.scriptPubKey);
+
+            m_history.emplace_back(
+                CAddressIndexKey(hashScript, m_height, txid, i, false),
+                txout.nValue);
+            m_outputs.emplace_back(
+                CAddressUnspentKey(hashScript, COutPoint(txid, i)),
+                CAddressUnspentValue(txout.nValue, txout.scriptPubKey, m_height));
+        }
+    }
+
+    if (tx.IsCoinBase()) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < tx.vin.size(); ++i) {
+        const COutPoint& prevout = tx.vin[i].prevout;
+        const auto iter = inputs.find(prevout.hash);
+
+        if (iter == inputs.end() || prevout.n >= iter->second.second.vout.size()) {
+            continue; // Validation rejects the block.
+        }
+
+        const CTxOut& prev = iter->second.second.vout[prevout.n];
+
+        SpentOutput output;
+        output.prevout = prevout;
+        output.spent.txid = txid;
+        output.spent.nInput = i;
+        output.spent.nHeight = m_height;
+        output.spent.nValue = prev.nValue;
+        output.spent.script = prev.scriptPubKey;
+        output.spent.nPrevHeight = -1;
+
+        if (fAddressIndex) {
+            m_history.emplace_back(
+                CAddressIndexKey(GetAddressIndexHash(prev.scriptPubKey), m_height, txid, i, true),
+                -prev.nValue);
+        }
+
+        m_spent.push_back(std::move(output));
+    }
+}
+
+bool CAddressIndexUpdate::Write(CTxDB& txdb)
+{
+    for (const auto& entry : m_history) {
+        if (!txdb.WriteRecord(ADDRESS_HISTORY, entry.first, entry.second)) {
+            return false;
+        }
+    }
+
+    for (const auto& entry : m_outputs) {
+        if (!txdb.WriteRecord(ADDRESS_UNSPENT, entry.first, entry.second)) {
+            return false;
+        }
+    }
+
+    // Spend the outputs after adding all of the outputs of the block so that
+    // transactions may spend outputs created earlier in the same block:
+    for (auto& output : m_spent) {
+        if (fAddressIndex) {
+            const CAddressUnspentKey key(GetAddressIndexHash(output.spent.script), output.prevout);
+            CAddressUnspentValue unspent;
+
+            // Outputs created before the index started have no entry. The
+            // height stays -1 so that a disconnect does not invent one:
+            if (txdb.ReadRecord(ADDRESS_UNSPENT, key, unspent)) {
+                output.spent.nPrevHeight = unspent.nHeight;
+
+                if (!txdb.EraseRecord(ADDRESS_UNSPENT, key)) {
+                    return false;
+                }
+            }
+        }
+
+        if (!txdb.WriteRecord(SPENT_INDEX, output.prevout, output.spent)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int InitAddressIndex(CTxDB& txdb, int nBestHeight)
+{
+    int nStart;
+
+    if (!txdb.ReadRecord(ADDRESS_INDEX_START, std::string("height"), nStart)) {
+        nStart = nBestHeight + 1;
+        txdb.WriteRecord(ADDRESS_INDEX_START, std::string("height"), nStart);
+    }
+
+    return nStart;
+}
+
+bool DisconnectAddressIndex(CTxDB& txdb, const CBlock& block, int nHeight)
+{
+    // Restore the spent outputs first. Erasing the outputs of the block next
+    // removes any restored output that the block itself created:
+    for (auto tx = block.vtx.rbegin(); tx != block.vtx.rend(); ++tx) {
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+
+        const uint256 txid = tx->GetHash();
+
+        for (uint32_t i = 0; i < tx->vin.size(); ++i) {
+            const COutPoint& prevout = tx->vin[i].prevout;
+            CSpentIndexValue spent;
+
+            if (!txdb.ReadRecord(SPENT_INDEX, prevout, spent)) {
+                continue; // Connected before the index started.
+            }
+
+            if (fAddressIndex) {
+                const uint160 hashScript = GetAddressIndexHash(spent.script);
+
+                if (!txdb.EraseRecord(ADDRESS_HISTORY, CAddressIndexKey(hashScript, nHeight, txid, i, true))) {
+                    return false;
+                }
+
+                if (spent.nPrevHeight >= 0
+                    && !txdb.WriteRecord(
+                        ADDRESS_UNSPENT,
+                        CAddressUnspentKey(hashScript, prevout),
+                        CAddressUnspentValue(spent.nValue, spent.script, spent.nPrevHeight)))
+                {
+                    return false;
+                }
+            }
+
+            if (!txdb.EraseRecord(SPENT_INDEX, prevout)) {
+                return false;
+            }
+        }
+    }
+
+    if (!fAddressIndex) {
+        return true;
+    }
+
+    for (const auto& tx : block.vtx) {
+        const uint256 txid = tx.GetHash();
+
+        for (uint32_t i = 0; i < tx.vout.size(); ++i) {
+            if (tx.vout[i].IsEmpty()) {
+                continue;
+            }
+
+            const uint160 hashScript = GetAddressIndexHash(tx.vout[i].scriptPubKey);
+
+            if (!txdb.EraseRecord(ADDRESS_HISTORY, CAddressIndexKey(hashScript, nHeight, txid, i, false))
+                || !txdb.EraseRecord(ADDRESS_UNSPENT, CAddressUnspentKey(hashScript, COutPoint(txid, i))))
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool ReadAddressHistory(
+    CTxDB& txdb,
+    const uint160& hashScript,
+    const std::function<bool(const CAddressIndexKey&, int64_t)>& fn)
+{
+    return txdb.ScanRecords(ADDRESS_HISTORY, hashScript, [&](CDataStream& ssKey, CDataStream& ssValue) {
+        CAddressIndexKey key;
+        int64_t nValue;
+
+        ssKey >> key;
+        ssValue >> nValue;
+
+        return fn(key, nValue);
+    });
+}
+
+bool ReadAddressUnspent(
+    CTxDB& txdb,
+    const uint160& hashScript,
+    const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn)
+{
+    return txdb.ScanRecords(ADDRESS_UNSPENT, hashScript, [&](CDataStream& ssKey, CDataStream& ssValue) {
+        CAddressUnspentKey key;
+        CAddressUnspentValue value;
+
+        ssKey >> key;
+        ssValue >> value;
+
+        return fn(key, value);
+    });
+}
+
+bool ReadSpentIndex(CTxDB& txdb, const COutPoint& prevout, CSpentIndexValue& value)
+{
+    return txdb.ReadRecord(SPENT_INDEX, prevout, value);
+}
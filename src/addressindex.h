@@ -0,0 +1,226 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ADDRESSINDEX_H
+#define BITCOIN_ADDRESSINDEX_H
+
+#include "main.h"
+#include "script.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <functional>
+#include <stdint.h>
+#include <vector>
+
+class CTxDB;
+
+//!
+//! \brief Get the key that the address index stores the records of an output
+//! script under.
+//!
+uint160 GetAddressIndexHash(const CScript& script);
+
+//!
+//! \brief Key of an entry in the history of an address. Each entry records
+//! an output that paid the address or an input that spent such an output.
+//!
+//! The height serializes in big-endian byte order so that leveldb sorts the
+//! entries of an address by height.
+//!
+struct CAddressIndexKey
+{
+    uint160 hashScript; //!< Hash of the output script.
+    int32_t nHeight;    //!< Height of the block that contains the transaction.
+    uint256 txid;       //!< Transaction that received or spent the coins.
+    uint32_t nIndex;    //!< Position of the output or input in the transaction.
+    bool fSpending;     //!< Whether the entry records an input.
+
+    CAddressIndexKey() : nHeight(0), nIndex(0), fSpending(false) { }
+
+    CAddressIndexKey(const uint160& hash, int32_t height, const uint256& tx, uint32_t index, bool spending)
+        : hashScript(hash), nHeight(height), txid(tx), nIndex(index), fSpending(spending)
+    {
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << hashScript;
+        ser_writedata32be(s, nHeight);
+        s << txid << nIndex << fSpending;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> hashScript;
+        nHeight = ser_readdata32be(s);
+        s >> txid >> nIndex >> fSpending;
+    }
+};
+
+//!
+//! \brief Key of an unspent output of an address.
+//!
+struct CAddressUnspentKey
+{
+    uint160 hashScript; //!< Hash of the output script.
+    COutPoint outpoint; //!< The unspent output.
+
+    CAddressUnspentKey() { }
+    CAddressUnspentKey(const uint160& hash, const COutPoint& out) : hashScript(hash), outpoint(out) { }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(hashScript);
+        READWRITE(outpoint);
+    }
+};
+
+//!
+//! \brief An unspent output of an address.
+//!
+struct CAddressUnspentValue
+{
+    int64_t nValue;  //!< Amount of the output.
+    CScript script;  //!< Output script.
+    int32_t nHeight; //!< Height of the block that contains the output.
+
+    CAddressUnspentValue() : nValue(0), nHeight(0) { }
+
+    CAddressUnspentValue(int64_t value, const CScript& script_in, int32_t height)
+        : nValue(value), script(script_in), nHeight(height)
+    {
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(nValue);
+        READWRITE(script);
+        READWRITE(nHeight);
+    }
+};
+
+//!
+//! \brief Records the input that spent an output. The spent index stores one
+//! for each spent output under the output's COutPoint.
+//!
+//! The record keeps the spent output as well, so that disconnecting a block
+//! can restore the unspent entries of the address index.
+//!
+struct CSpentIndexValue
+{
+    uint256 txid;         //!< Transaction that spent the output.
+    uint32_t nInput;      //!< Position of the input in that transaction.
+    int32_t nHeight;      //!< Height of the block that spent the output.
+    int64_t nValue;       //!< Amount of the spent output.
+    CScript script;       //!< Script of the spent output.
+    int32_t nPrevHeight;  //!< Height of the block that contains the output.
+
+    CSpentIndexValue() : nInput(0), nHeight(0), nValue(0), nPrevHeight(0) { }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(txid);
+        READWRITE(nInput);
+        READWRITE(nHeight);
+        READWRITE(nValue);
+        READWRITE(script);
+        READWRITE(nPrevHeight);
+    }
+};
+
+//!
+//! \brief Collects the address and spent index changes of a block while
+//! ConnectBlock() validates it.
+//!
+class CAddressIndexUpdate
+{
+public:
+    //!
+    //! \brief Initialize an update for the block at the specified height.
+    //!
+    explicit CAddressIndexUpdate(int nHeight);
+
+    //!
+    //! \brief Record the outputs of a transaction and the inputs it spends.
+    //!
+    //! \param tx     Transaction of the block.
+    //! \param inputs Transactions that the inputs spend from as fetched for
+    //!               validation. Empty for the coinbase.
+    //!
+    void AddTransaction(const CTransaction& tx, const MapPrevTx& inputs);
+
+    //!
+    //! \brief Write the changes to the active batch of the database.
+    //!
+    bool Write(CTxDB& txdb);
+
+private:
+    struct SpentOutput
+    {
+        COutPoint prevout;
+        CSpentIndexValue spent;
+    };
+
+    int m_height;
+    std::vector<std::pair<CAddressIndexKey, int64_t>> m_history;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue>> m_outputs;
+    std::vector<SpentOutput> m_spent;
+};
+
+//!
+//! \brief Get the first block height covered by the address index.
+//!
+//! The index only covers the blocks that connected while the node ran with
+//! -addressindex. The first call records the height after the current tip
+//! as the start of the index.
+//!
+//! \param nBestHeight Height of the current chain tip.
+//!
+int InitAddressIndex(CTxDB& txdb, int nBestHeight);
+
+//!
+//! \brief Undo the address and spent index changes of a block.
+//!
+//! \param block  Block to disconnect.
+//! \param nHeight Height of the block.
+//!
+bool DisconnectAddressIndex(CTxDB& txdb, const CBlock& block, int nHeight);
+
+//!
+//! \brief Invoke a function for each history entry of an address in order
+//! of height.
+//!
+bool ReadAddressHistory(
+    CTxDB& txdb,
+    const uint160& hashScript,
+    const std::function<bool(const CAddressIndexKey&, int64_t)>& fn);
+
+//!
+//! \brief Invoke a function for each unspent output of an address.
+//!
+bool ReadAddressUnspent(
+    CTxDB& txdb,
+    const uint160& hashScript,
+    const std::function<bool(const CAddressUnspentKey&, const CAddressUnspentValue&)>& fn);
+
+//!
+//! \brief Look up the input that spent an output.
+//!
+//! \return \c false if the spent index contains no record for the output.
+//!
+bool ReadSpentIndex(CTxDB& txdb, const COutPoint& prevout, CSpentIndexValue& value);
+
+#endif // BITCOIN_ADDRESSINDEX_H
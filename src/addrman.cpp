@@ -80,12 +80,12 @@ double CAddrInfo::GetChance(int64_t nNow) const
 
 CAddrInfo* CAddrMan::Find(const CNetAddr& addr, int *pnId)
 {
-    std::map<CNetAddr, int>::iterator it = mapAddr.find(addr);
+    std::unordered_map<CNetAddr, int, CNetAddrHasher>::iterator it = mapAddr.find(addr);
     if (it == mapAddr.end())
         return NULL;
     if (pnId)
         *pnId = (*it).second;
-    std::map<int, CAddrInfo>::iterator it2 = mapInfo.find((*it).second);
+    std::unordered_map<int, CAddrInfo>::iterator it2 = mapInfo.find((*it).second);
     if (it2 != mapInfo.end())
         return &(*it2).second;
     return NULL;
@@ -150,10 +150,10 @@ int CAddrMan::SelectTried(int nKBucket)
 int CAddrMan::ShrinkNew(int nUBucket)
 {
     assert(nUBucket >= 0 && (unsigned int)nUBucket < vvNew.size());
-    std::set<int> &vNew = vvNew[nUBucket];
+    CAddrNewBucket &vNew = vvNew[nUBucket];
 
     // first look for deletable items
-    for (std::set<int>::iterator it = vNew.begin(); it != vNew.end(); it++)
+    for (CAddrNewBucket::iterator it = vNew.begin(); it != vNew.end(); it++)
     {
         assert(mapInfo.count(*it));
         CAddrInfo &info = mapInfo[*it];
@@ -176,7 +176,7 @@ int CAddrMan::ShrinkNew(int nUBucket)
     int n[4] = {GetRandInt(vNew.size()), GetRandInt(vNew.size()), GetRandInt(vNew.size()), GetRandInt(vNew.size())};
     int nI = 0;
     int nOldest = -1;
-    for (std::set<int>::iterator it = vNew.begin(); it != vNew.end(); it++)
+    for (CAddrNewBucket::iterator it = vNew.begin(); it != vNew.end(); it++)
     {
         if (nI == n[0] || nI == n[1] || nI == n[2] || nI == n[3])
         {
@@ -206,7 +206,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId, int nOrigin)
     assert(vvNew[nOrigin].count(nId) == 1);
 
     // remove the entry from all new buckets
-    for (std::vector<std::set<int> >::iterator it = vvNew.begin(); it != vvNew.end(); it++)
+    for (std::vector<CAddrNewBucket>::iterator it = vvNew.begin(); it != vvNew.end(); it++)
     {
         if ((*it).erase(nId))
             info.nRefCount--;
@@ -234,7 +234,7 @@ void CAddrMan::MakeTried(CAddrInfo& info, int nId, int nOrigin)
     // find which new bucket it belongs to
     assert(mapInfo.count(vTried[nPos]) == 1);
     int nUBucket = mapInfo[vTried[nPos]].GetNewBucket(nKey);
-    std::set<int> &vNew = vvNew[nUBucket];
+    CAddrNewBucket &vNew = vvNew[nUBucket];
 
     // remove the to-be-replaced tried entry from the tried set
     CAddrInfo& infoOld = mapInfo[vTried[nPos]];
@@ -290,7 +290,7 @@ void CAddrMan::Good_(const CService &addr, int64_t nTime)
     for (unsigned int n = 0; n < vvNew.size(); n++)
     {
         int nB = (n+nRnd) % vvNew.size();
-        std::set<int> &vNew = vvNew[nB];
+        CAddrNewBucket &vNew = vvNew[nB];
         if (vNew.count(nId))
         {
             nUBucket = nB;
@@ -354,7 +354,7 @@ bool CAddrMan::Add_(const CAddress &addr, const CNetAddr& source, int64_t nTimeP
     }
 
     int nUBucket = pinfo->GetNewBucket(nKey, source);
-    std::set<int> &vNew = vvNew[nUBucket];
+    CAddrNewBucket &vNew = vvNew[nUBucket];
     if (!vNew.count(nId))
     {
         pinfo->nRefCount++;
@@ -413,14 +413,11 @@ CAddress CAddrMan::Select_(int nUnkBias)
         while(1)
         {
             int nUBucket = GetRandInt(vvNew.size());
-            std::set<int> &vNew = vvNew[nUBucket];
+            CAddrNewBucket &vNew = vvNew[nUBucket];
             if (vNew.size() == 0) continue;
             int nPos = GetRandInt(vNew.size());
-            std::set<int>::iterator it = vNew.begin();
-            while (nPos--)
-                it++;
-            assert(mapInfo.count(*it) == 1);
-            CAddrInfo &info = mapInfo[*it];
+            assert(mapInfo.count(vNew[nPos]) == 1);
+            CAddrInfo &info = mapInfo[vNew[nPos]];
             if (GetRandInt(1<<30) < fChanceFactor*info.GetChance()*(1<<30))
                 return info;
             fChanceFactor *= 1.2;
@@ -436,7 +433,7 @@ int CAddrMan::Check_()
 
     if (vRandom.size() != nTried + nNew) return -7;
 
-    for (std::map<int, CAddrInfo>::iterator it = mapInfo.begin(); it != mapInfo.end(); it++)
+    for (std::unordered_map<int, CAddrInfo>::iterator it = mapInfo.begin(); it != mapInfo.end(); it++)
     {
         int n = (*it).first;
         CAddrInfo &info = (*it).second;
@@ -472,8 +469,8 @@ int CAddrMan::Check_()
 
     for (int n=0; n<vvNew.size(); n++)
     {
-        std::set<int> &vNew = vvNew[n];
-        for (std::set<int>::iterator it = vNew.begin(); it != vNew.end(); it++)
+        CAddrNewBucket &vNew = vvNew[n];
+        for (CAddrNewBucket::iterator it = vNew.begin(); it != vNew.end(); it++)
         {
             if (!mapNew.count(*it)) return -12;
             if (--mapNew[*it] == 0)
@@ -8,9 +8,12 @@
 #include "protocol.h"
 #include "util.h"
 #include "sync.h"
+#include "crypto/siphash.h"
 
-
+#include <algorithm>
+#include <limits>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 #include <openssl/rand.h>
@@ -164,6 +167,75 @@ public:
 // the maximum number of nodes to return in a getaddr call
 #define ADDRMAN_GETADDR_MAX 2500
 
+/** Hashes network addresses for the address manager with a random key, so
+ *  that peers cannot choose addresses that collide in the table. */
+class CNetAddrHasher
+{
+private:
+    uint64_t k0;
+    uint64_t k1;
+
+public:
+    CNetAddrHasher()
+        : k0(GetRand(std::numeric_limits<uint64_t>::max()))
+        , k1(GetRand(std::numeric_limits<uint64_t>::max()))
+    {
+    }
+
+    size_t operator()(const CNetAddr& addr) const
+    {
+        unsigned char bytes[16];
+
+        for (int i = 0; i < 16; i++)
+            bytes[i] = addr.GetByte(15 - i);
+
+        return CSipHasher(k0, k1).Write(bytes, sizeof(bytes)).Finalize();
+    }
+};
+
+/** The nIds in one "new" bucket, kept in increasing order in a vector. A
+ *  bucket holds at most ADDRMAN_NEW_BUCKET_SIZE entries, so one allocation
+ *  per bucket replaces a node per entry, and selection indexes directly. */
+class CAddrNewBucket
+{
+private:
+    std::vector<int> vId;
+
+public:
+    typedef std::vector<int>::iterator iterator;
+    typedef std::vector<int>::const_iterator const_iterator;
+
+    iterator begin() { return vId.begin(); }
+    iterator end() { return vId.end(); }
+    const_iterator begin() const { return vId.begin(); }
+    const_iterator end() const { return vId.end(); }
+    size_t size() const { return vId.size(); }
+    int operator[](size_t nPos) const { return vId[nPos]; }
+
+    size_t count(int nId) const
+    {
+        return std::binary_search(vId.begin(), vId.end(), nId) ? 1 : 0;
+    }
+
+    void insert(int nId)
+    {
+        iterator it = std::lower_bound(vId.begin(), vId.end(), nId);
+        if (it == vId.end() || *it != nId)
+            vId.insert(it, nId);
+    }
+
+    size_t erase(int nId)
+    {
+        iterator it = std::lower_bound(vId.begin(), vId.end(), nId);
+        if (it == vId.end() || *it != nId)
+            return 0;
+        vId.erase(it);
+        return 1;
+    }
+
+    iterator erase(iterator it) { return vId.erase(it); }
+};
+
 /** Stochastical (IP) address manager */
 class CAddrMan
 {
@@ -178,10 +250,10 @@ private:
     int nIdCount;
 
     // table with information about all nIds
-    std::map<int, CAddrInfo> mapInfo;
+    std::unordered_map<int, CAddrInfo> mapInfo;
 
     // find an nId based on its network address
-    std::map<CNetAddr, int> mapAddr;
+    std::unordered_map<CNetAddr, int, CNetAddrHasher> mapAddr;
 
     // randomly-ordered vector of all nIds
     std::vector<int> vRandom;
@@ -196,7 +268,7 @@ private:
     int nNew;
 
     // list of "new" buckets
-    std::vector<std::set<int> > vvNew;
+    std::vector<CAddrNewBucket> vvNew;
 
 protected:
 
@@ -285,7 +357,7 @@ public:
         s << nUBuckets;
         std::map<int, int> mapUnkIds;
         int nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+        for (std::unordered_map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
             if (nIds == nNew) break; // this means nNew was wrong, oh ow
             mapUnkIds[(*it).first] = nIds;
             const CAddrInfo &info = (*it).second;
@@ -295,7 +367,7 @@ public:
             }
         }
         nIds = 0;
-        for (std::map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
+        for (std::unordered_map<int, CAddrInfo>::const_iterator it = mapInfo.begin(); it != mapInfo.end(); it++) {
             if (nIds == nTried) break; // this means nTried was wrong, oh ow
             const CAddrInfo &info = (*it).second;
             if (info.fInTried) {
@@ -303,11 +375,11 @@ public:
                 nIds++;
             }
         }
-        for (std::vector<std::set<int> >::const_iterator it = vvNew.begin(); it != vvNew.end(); it++) {
-            const std::set<int> &vNew = (*it);
+        for (std::vector<CAddrNewBucket>::const_iterator it = vvNew.begin(); it != vvNew.end(); it++) {
+            const CAddrNewBucket &vNew = (*it);
             int nSize = vNew.size();
             s << nSize;
-            for (std::set<int>::const_iterator it2 = vNew.begin(); it2 != vNew.end(); it2++) {
+            for (CAddrNewBucket::const_iterator it2 = vNew.begin(); it2 != vNew.end(); it2++) {
                 int nIndex = mapUnkIds[*it2];
                 s << nIndex;
             }
@@ -332,7 +404,7 @@ public:
         mapAddr.clear();
         vRandom.clear();
         vvTried = std::vector<std::vector<int> >(ADDRMAN_TRIED_BUCKET_COUNT, std::vector<int>(0));
-        vvNew = std::vector<std::set<int> >(ADDRMAN_NEW_BUCKET_COUNT, std::set<int>());
+        vvNew = std::vector<CAddrNewBucket>(ADDRMAN_NEW_BUCKET_COUNT);
         for (int n = 0; n < nNew; n++) {
             CAddrInfo &info = mapInfo[n];
             s >> info;
@@ -364,7 +436,7 @@ public:
         }
         nTried -= nLost;
         for (int b = 0; b < nUBuckets; b++) {
-            std::set<int> &vNew = vvNew[b];
+            CAddrNewBucket &vNew = vvNew[b];
             int nSize = 0;
             s >> nSize;
             for (int n = 0; n < nSize; n++) {
@@ -379,7 +451,7 @@ public:
         }
     }
 
-    CAddrMan() : vRandom(0), vvTried(ADDRMAN_TRIED_BUCKET_COUNT, std::vector<int>(0)), vvNew(ADDRMAN_NEW_BUCKET_COUNT, std::set<int>())
+    CAddrMan() : vRandom(0), vvTried(ADDRMAN_TRIED_BUCKET_COUNT, std::vector<int>(0)), vvNew(ADDRMAN_NEW_BUCKET_COUNT)
     {
          nKey.resize(32);
          RAND_bytes(&nKey[0], 32);
@@ -505,7 +577,7 @@ public:
         std::vector<int>().swap(vRandom);
         RAND_bytes(&nKey[0], 32);
         vvTried = std::vector<std::vector<int>>(ADDRMAN_TRIED_BUCKET_COUNT, std::vector<int>(0));
-        vvNew = std::vector<std::set<int>>(ADDRMAN_NEW_BUCKET_COUNT, std::set<int>());
+        vvNew = std::vector<CAddrNewBucket>(ADDRMAN_NEW_BUCKET_COUNT);
         // Will need for Bitcoin rebase
         // nKey = insecure_rand.rand256();
         //for (size_t bucket = 0; bucket < ADDRMAN_NEW_BUCKET_COUNT; bucket++) {
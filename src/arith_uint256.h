@@ -279,9 +279,25 @@ public:
 
     friend uint256 ArithToUint256(const arith_uint256 &);
     friend arith_uint256 UintToArith256(const uint256 &);
+    friend class arith_uint512;
 };
 
 uint256 ArithToUint256(const arith_uint256 &);
 arith_uint256 UintToArith256(const uint256 &);
 
+/**
+ * 512-bit unsigned big integer. Holds the exact products of 256-bit values
+ * and 64-bit factors, like a difficulty target scaled by a coin weight.
+ */
+class arith_uint512 : public base_uint<512> {
+public:
+    arith_uint512() {}
+    arith_uint512(const base_uint<512>& b) : base_uint<512>(b) {}
+    arith_uint512(uint64_t b) : base_uint<512>(b) {}
+    explicit arith_uint512(const arith_uint256& b);
+
+    /** Get the low 256 bits. */
+    arith_uint256 GetLow256() const;
+};
+
 #endif // BITCOIN_ARITH_UINT256_H
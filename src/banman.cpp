@@ -10,6 +10,118 @@
 #include "ui_interface.h"
 #include "util.h"
 
+BanIndex::BanIndex() : m_nodes(1)
+{
+}
+
+namespace {
+//! Get a bit of an address, counted from the most significant bit.
+unsigned int AddressBit(const CNetAddr& net_addr, int bit)
+{
+    return (net_addr.GetByte(15 - bit / 8) >> (7 - bit % 8)) & 1;
+}
+} // namespace
+
+void BanIndex::Insert(const CSubNet& sub_net, const CBanEntry& ban_entry)
+{
+    if (!sub_net.IsValid()) return;
+
+    const int prefix_length = sub_net.GetPrefixLength();
+
+    if (prefix_length < 0) {
+        for (auto& other : m_other) {
+            if (other.first == sub_net) {
+                other.second = &ban_entry;
+                return;
+            }
+        }
+
+        m_other.emplace_back(sub_net, &ban_entry);
+        return;
+    }
+
+    uint32_t node = 0;
+
+    for (int bit = 0; bit < prefix_length; ++bit) {
+        const unsigned int branch = AddressBit(sub_net.GetNetwork(), bit);
+
+        if (m_nodes[node].children[branch] == 0) {
+            m_nodes[node].children[branch] = m_nodes.size();
+            m_nodes.emplace_back();
+        }
+
+        node = m_nodes[node].children[branch];
+    }
+
+    m_nodes[node].ban_entry = &ban_entry;
+}
+
+void BanIndex::Erase(const CSubNet& sub_net)
+{
+    const int prefix_length = sub_net.GetPrefixLength();
+
+    if (prefix_length < 0) {
+        for (auto it = m_other.begin(); it != m_other.end(); ++it) {
+            if (it->first == sub_net) {
+                m_other.erase(it);
+                return;
+            }
+        }
+
+        return;
+    }
+
+    // Unused nodes remain until the next Clear():
+    uint32_t node = 0;
+
+    for (int bit = 0; bit < prefix_length; ++bit) {
+        node = m_nodes[node].children[AddressBit(sub_net.GetNetwork(), bit)];
+
+        if (node == 0) return;
+    }
+
+    m_nodes[node].ban_entry = nullptr;
+}
+
+void BanIndex::Clear()
+{
+    m_nodes.assign(1, Node());
+    m_other.clear();
+}
+
+int BanIndex::GetLevel(const CNetAddr& net_addr, int64_t current_time) const
+{
+    if (!net_addr.IsValid()) return 0;
+
+    int level = 0;
+
+    // Returns true when the search can stop at the most severe level:
+    const auto check = [&](const CBanEntry* ban_entry) {
+        if (ban_entry && current_time < ban_entry->nBanUntil) {
+            if (ban_entry->banReason != BanReasonNodeMisbehaving) return true;
+            level = 1;
+        }
+        return false;
+    };
+
+    uint32_t node = 0;
+
+    for (int bit = 0; ; ++bit) {
+        if (check(m_nodes[node].ban_entry)) return 2;
+        if (bit == 128) break;
+
+        node = m_nodes[node].children[AddressBit(net_addr, bit)];
+
+        if (node == 0) break;
+    }
+
+    for (const auto& other : m_other) {
+        if (other.first.Match(net_addr) && check(other.second)) return 2;
+    }
+
+    return level;
+}
+
 BanMan::BanMan(fs::path ban_file, CClientUIInterface* client_interface, int64_t default_ban_time)
     : m_client_interface(client_interface), m_ban_db(std::move(ban_file)), m_default_ban_time(default_ban_time)
 {
@@ -68,6 +180,8 @@ void BanMan::ClearBanned()
         }
 
         m_banned.clear();
+        m_index.Clear();
+        m_expiry.clear();
         m_is_dirty = true;
     }
     DumpBanlist(); //store banlist to disk
@@ -80,34 +194,14 @@ int BanMan::IsBannedLevel(CNetAddr net_addr)
     // 0 - Not banned
     // 1 - Automatic misbehavior ban
     // 2 - Any other ban
-    int level = 0;
     auto current_time = GetTime();
     LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
-
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
-            if (ban_entry.banReason != BanReasonNodeMisbehaving) return 2;
-            level = 1;
-        }
-    }
-    return level;
+    return m_index.GetLevel(net_addr, current_time);
 }
 
 bool BanMan::IsBanned(CNetAddr net_addr)
 {
-    auto current_time = GetTime();
-    LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
-
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
-            return true;
-        }
-    }
-    return false;
+    return IsBannedLevel(net_addr) > 0;
 }
 
 bool BanMan::IsBanned(CSubNet sub_net)
@@ -144,11 +238,14 @@ void BanMan::Ban(const CSubNet& sub_net, const BanReason& ban_reason, int64_t ba
 
     {
         LOCK(m_cs_banned);
-        if (m_banned[sub_net].nBanUntil < ban_entry.nBanUntil) {
-            m_banned[sub_net] = ban_entry;
-            m_is_dirty = true;
-        } else
-            return;
+        banmap_t::iterator it = m_banned.find(sub_net);
+        if (it != m_banned.end() && it->second.nBanUntil >= ban_entry.nBanUntil) return;
+
+        CBanEntry& stored_entry = m_banned[sub_net];
+        stored_entry = ban_entry;
+        m_index.Insert(sub_net, stored_entry);
+        m_expiry.emplace(ban_entry.nBanUntil, sub_net);
+        m_is_dirty = true;
     }
     if (m_client_interface) m_client_interface->BannedListChanged();
 
@@ -166,7 +263,9 @@ bool BanMan::Unban(const CSubNet& sub_net)
 {
     {
         LOCK(m_cs_banned);
-        if (m_banned.erase(sub_net) == 0) return false;
+        if (!m_banned.count(sub_net)) return false;
+        m_index.Erase(sub_net);
+        m_banned.erase(sub_net);
         m_is_dirty = true;
 
         ZeroMisbehavior(sub_net);
@@ -188,30 +287,49 @@ void BanMan::SetBanned(const banmap_t& banmap)
 {
     LOCK(m_cs_banned);
     m_banned = banmap;
+    Reindex();
     m_is_dirty = true;
 }
 
+void BanMan::Reindex()
+{
+    LOCK(m_cs_banned);
+    m_index.Clear();
+    m_expiry.clear();
+
+    for (const auto& it : m_banned) {
+        m_index.Insert(it.first, it.second);
+        m_expiry.emplace(it.second.nBanUntil, it.first);
+    }
+}
+
 void BanMan::SweepBanned()
 {
     int64_t now = GetTime();
     bool notify_ui = false;
     {
         LOCK(m_cs_banned);
-        banmap_t::iterator it = m_banned.begin();
-        while (it != m_banned.end()) {
-            CSubNet sub_net = (*it).first;
-            CBanEntry ban_entry = (*it).second;
-            if (now > ban_entry.nBanUntil) {
-                m_banned.erase(it++);
-
-                ZeroMisbehavior(sub_net);
-
-                m_is_dirty = true;
-                notify_ui = true;
-                LogPrint(BCLog::LogFlags::NET, "%s: Removed banned node ip/subnet from banlist.dat: %s\n", __func__, sub_net.ToString());
-            } else
-                ++it;
+        // Visit only the bans that expired rather than the whole banlist:
+        while (!m_expiry.empty() && m_expiry.begin()->first < now) {
+            CSubNet sub_net = m_expiry.begin()->second;
+            m_expiry.erase(m_expiry.begin());
+
+            banmap_t::iterator it = m_banned.find(sub_net);
+            // Skip the stale entries of unbanned or extended bans:
+            if (it == m_banned.end() || now <= it->second.nBanUntil) continue;
+
+            m_index.Erase(sub_net);
+            m_banned.erase(it);
+
+            ZeroMisbehavior(sub_net);
+
+            m_is_dirty = true;
+            notify_ui = true;
+            LogPrint(BCLog::LogFlags::NET, "%s: Removed banned node ip/subnet from banlist.dat: %s\n", __func__, sub_net.ToString());
         }
+
+        // Drop the nodes of the expired bans from the index:
+        if (notify_ui) Reindex();
     }
     // update UI
     if (notify_ui && m_client_interface) {
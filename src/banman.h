@@ -6,18 +6,58 @@
 #define BITCOIN_BANMAN_H
 
 #include <cstdint>
+#include <map>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include <addrdb.h>
 #include <fs.h>
+#include <netbase.h>
 #include <sync.h>
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static constexpr unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24; // Default 24-hour ban
 
 class CClientUIInterface;
-class CNetAddr;
-class CSubNet;
+
+/** Index of banned subnets for lookups by address in time proportional to
+ * the length of an address rather than the number of bans.
+ *
+ * Subnets with a prefix netmask form a binary trie over the bits of the
+ * 128-bit address (IPv4 addresses are mapped into IPv6). The rare subnets
+ * with other masks are matched one by one.
+ *
+ * The index refers to the ban entries stored in the map owned by BanMan. An
+ * entry must be erased from the index before it is erased from the map.
+ */
+class BanIndex
+{
+public:
+    BanIndex();
+
+    void Insert(const CSubNet& sub_net, const CBanEntry& ban_entry);
+    void Erase(const CSubNet& sub_net);
+    void Clear();
+
+    /** @returns The most severe level of the bans in effect at the given
+     *           time that apply to the address: 0 if not banned, 1 for an
+     *           automatic misbehavior ban, or 2 for any other ban.
+     */
+    int GetLevel(const CNetAddr& net_addr, int64_t current_time) const;
+
+private:
+    struct Node
+    {
+        uint32_t children[2] = { 0, 0 }; //!< Index of the child nodes, or 0.
+        const CBanEntry* ban_entry = nullptr;
+    };
+
+    //! Nodes of the trie. The first node is the root.
+    std::vector<Node> m_nodes;
+    //! Subnets with a netmask that is not a prefix.
+    std::vector<std::pair<CSubNet, const CBanEntry*>> m_other;
+};
 
 // Denial-of-service detection/prevention
 // The idea is to detect peers that are behaving
@@ -60,8 +100,14 @@ private:
     unsigned int ZeroMisbehavior(CNetAddr net_addr);
     unsigned int ZeroMisbehavior(CSubNet sub_net);
 
+    //!rebuild the lookup index and the expiry queue from the banlist
+    void Reindex();
+
     CCriticalSection m_cs_banned;
     banmap_t m_banned GUARDED_BY(m_cs_banned);
+    BanIndex m_index GUARDED_BY(m_cs_banned);
+    //!bans ordered by expiry time. Extended bans leave stale entries behind.
+    std::multimap<int64_t, CSubNet> m_expiry GUARDED_BY(m_cs_banned);
     bool m_is_dirty GUARDED_BY(m_cs_banned);
     CClientUIInterface* m_client_interface = nullptr;
     CBanDB m_ban_db;
@@ -15,52 +15,97 @@
 #ifndef BITCOIN_BASE58_H
 #define BITCOIN_BASE58_H
 
+#include <algorithm>
 #include <string>
 #include <vector>
 #include "bignum.h"
+#include "support/cleanse.h"
 #include "key.h"
 #include "script.h"
 
 static const char* pszBase58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
 
+// Base58 digits are handled five at a time in 32-bit limbs. A limb holds less
+// than 2^30, so shifting one up by a 32-bit chunk of input stays within the
+// 64-bit intermediate, which replaces the bignum division of each digit.
+static const uint32_t BASE58_LIMB_RADIX = 58 * 58 * 58 * 58 * 58;
+
+static const int8_t mapBase58[256] = {
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1, 0, 1, 2, 3, 4, 5, 6, 7, 8,-1,-1,-1,-1,-1,-1,
+    -1, 9,10,11,12,13,14,15,16,-1,17,18,19,20,21,-1,
+    22,23,24,25,26,27,28,29,30,31,32,-1,-1,-1,-1,-1,
+    -1,33,34,35,36,37,38,39,40,41,42,43,-1,44,45,46,
+    47,48,49,50,51,52,53,54,55,56,57,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+    -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
+};
+
 // Encode a byte sequence as a base58-encoded string
 inline std::string EncodeBase58(const unsigned char* pbegin, const unsigned char* pend)
 {
-    CAutoBN_CTX pctx;
-    CBigNum bn58 = 58;
-    CBigNum bn0 = 0;
-
-    // Convert big endian data to little endian
-    // Extra zero at the end make sure bignum will interpret as a positive number
-    std::vector<unsigned char> vchTmp(pend-pbegin+1, 0);
-    reverse_copy(pbegin, pend, vchTmp.begin());
+    // Leading zeroes encoded as base58 zeros
+    size_t nZeroes = 0;
+    while (pbegin != pend && *pbegin == 0)
+    {
+        pbegin++;
+        nZeroes++;
+    }
 
-    // Convert little endian data to bignum
-    CBigNum bn;
-    bn.setvch(vchTmp);
+    // Convert big endian data to little endian limbs. Expected size increase
+    // from base58 conversion is approximately 137%, so each limb of five
+    // digits covers about 3.6 bytes:
+    std::vector<uint32_t> vLimbs;
+    vLimbs.reserve((pend - pbegin) * 138 / 500 + 1);
+    while (pbegin != pend)
+    {
+        const int nBytes = std::min<ptrdiff_t>(pend - pbegin, 4);
+        uint64_t carry = 0;
+        for (int i = 0; i < nBytes; i++)
+            carry = (carry << 8) | *pbegin++;
+        for (uint32_t& limb : vLimbs)
+        {
+            carry += (uint64_t)limb << (8 * nBytes);
+            limb = carry % BASE58_LIMB_RADIX;
+            carry /= BASE58_LIMB_RADIX;
+        }
+        while (carry > 0)
+        {
+            vLimbs.push_back(carry % BASE58_LIMB_RADIX);
+            carry /= BASE58_LIMB_RADIX;
+        }
+    }
 
-    // Convert bignum to std::string
+    // Convert little endian limbs to big endian std::string
     std::string str;
-    // Expected size increase from base58 conversion is approximately 137%
-    // use 138% to be safe
-    str.reserve((pend - pbegin) * 138 / 100 + 1);
-    CBigNum dv;
-    CBigNum rem;
-    while (bn > bn0)
+    str.reserve(nZeroes + vLimbs.size() * 5);
+    str.assign(nZeroes, pszBase58[0]);
+    for (size_t i = vLimbs.size(); i-- > 0;)
     {
-        if (!BN_div(&dv, &rem, &bn, &bn58, pctx))
-            throw bignum_error("EncodeBase58 : BN_div failed");
-        bn = dv;
-        unsigned int c = rem.getulong();
-        str += pszBase58[c];
+        char digits[5];
+        uint32_t limb = vLimbs[i];
+        for (int j = 4; j >= 0; j--)
+        {
+            digits[j] = pszBase58[limb % 58];
+            limb /= 58;
+        }
+        // The most significant limb is never zero. Drop its leading zeros:
+        int nStart = 0;
+        if (i == vLimbs.size() - 1)
+            while (digits[nStart] == pszBase58[0])
+                nStart++;
+        str.append(digits + nStart, 5 - nStart);
     }
 
-    // Leading zeroes encoded as base58 zeros
-    for (const unsigned char* p = pbegin; p < pend && *p == 0; p++)
-        str += pszBase58[0];
-
-    // Convert little endian std::string to big endian
-    reverse(str.begin(), str.end());
+    memory_cleanse(vLimbs.data(), vLimbs.size() * sizeof(uint32_t));
     return str;
 }
 
@@ -74,47 +119,81 @@ inline std::string EncodeBase58(const std::vector<unsigned char>& vch)
 // returns true if decoding is successful
 inline bool DecodeBase58(const char* psz, std::vector<unsigned char>& vchRet)
 {
-    CAutoBN_CTX pctx;
     vchRet.clear();
-    CBigNum bn58 = 58;
-    CBigNum bn = 0;
-    CBigNum bnChar;
     while (isspace(*psz))
         psz++;
 
-    // Convert big endian string to bignum
-    for (const char* p = psz; *p; p++)
+    // Leading zeros
+    size_t nZeroes = 0;
+    while (*psz == pszBase58[0])
+    {
+        psz++;
+        nZeroes++;
+    }
+
+    // Convert big endian string to little endian 32-bit limbs, multiplying in
+    // up to five digits per pass:
+    std::vector<uint32_t> vLimbs;
+    uint32_t nGroup = 0;
+    uint32_t nMultiplier = 1;
+    for (;; psz++)
     {
-        const char* p1 = strchr(pszBase58, *p);
-        if (p1 == NULL)
+        const bool fEnd = *psz == '\0' || isspace(*psz);
+        if (!fEnd)
         {
-            while (isspace(*p))
-                p++;
-            if (*p != '\0')
+            const int8_t digit = mapBase58[(uint8_t)*psz];
+            if (digit == -1)
+            {
+                memory_cleanse(vLimbs.data(), vLimbs.size() * sizeof(uint32_t));
                 return false;
-            break;
+            }
+            nGroup = nGroup * 58 + digit;
+            nMultiplier *= 58;
         }
-        bnChar.setulong(p1 - pszBase58);
-        if (!BN_mul(&bn, &bn, &bn58, pctx))
-            throw bignum_error("DecodeBase58 : BN_mul failed");
-        bn += bnChar;
+        if (nMultiplier == BASE58_LIMB_RADIX || (fEnd && nMultiplier > 1))
+        {
+            uint64_t carry = nGroup;
+            for (uint32_t& limb : vLimbs)
+            {
+                carry += (uint64_t)limb * nMultiplier;
+                limb = (uint32_t)carry;
+                carry >>= 32;
+            }
+            while (carry > 0)
+            {
+                vLimbs.push_back((uint32_t)carry);
+                carry >>= 32;
+            }
+            nGroup = 0;
+            nMultiplier = 1;
+        }
+        if (fEnd)
+            break;
     }
 
-    // Get bignum as little endian data
-    std::vector<unsigned char> vchTmp = bn.getvch();
-
-    // Trim off sign byte if present
-    if (vchTmp.size() >= 2 && vchTmp.end()[-1] == 0 && vchTmp.end()[-2] >= 0x80)
-        vchTmp.erase(vchTmp.end()-1);
+    while (isspace(*psz))
+        psz++;
+    if (*psz != '\0')
+    {
+        memory_cleanse(vLimbs.data(), vLimbs.size() * sizeof(uint32_t));
+        return false;
+    }
 
-    // Restore leading zeros
-    int nLeadingZeros = 0;
-    for (const char* p = psz; *p == pszBase58[0]; p++)
-        nLeadingZeros++;
-    vchRet.assign(nLeadingZeros + vchTmp.size(), 0);
+    // Restore leading zeros and convert little endian limbs to big endian
+    // data. The most significant limb is never zero; skip its zero bytes:
+    vchRet.reserve(nZeroes + vLimbs.size() * 4);
+    vchRet.assign(nZeroes, 0);
+    for (size_t i = vLimbs.size(); i-- > 0;)
+    {
+        for (int nShift = 24; nShift >= 0; nShift -= 8)
+        {
+            const unsigned char ch = vLimbs[i] >> nShift;
+            if (i < vLimbs.size() - 1 || ch != 0 || vchRet.size() > nZeroes)
+                vchRet.push_back(ch);
+        }
+    }
 
-    // Convert little endian data to big endian
-    reverse_copy(vchTmp.begin(), vchTmp.end(), vchRet.end() - vchTmp.size());
+    memory_cleanse(vLimbs.data(), vLimbs.size() * sizeof(uint32_t));
     return true;
 }
 
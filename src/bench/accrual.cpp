@@ -0,0 +1,214 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/data.h"
+#include "gridcoin/accrual/newbie.h"
+#include "gridcoin/accrual/research_age.h"
+#include "gridcoin/accrual/snapshot.h"
+
+#include <boost/filesystem/operations.hpp>
+
+using namespace GRC;
+
+namespace {
+//!
+//! \brief Get the synthetic tally shared by the accrual benchmarks.
+//!
+//! Building the chain and accounts takes longer than the benchmarks, so we
+//! only build it once for the process.
+//!
+const benchmark::SyntheticTally& GetTally()
+{
+    static const benchmark::SyntheticTally tally(
+        benchmark::GenerateCpids(benchmark::SYNTHETIC_CPID_COUNT));
+
+    return tally;
+}
+
+//!
+//! \brief Creates an empty snapshot file path and removes it when done.
+//!
+class TemporarySnapshotPath
+{
+public:
+    TemporarySnapshotPath()
+        : m_path(fs::temp_directory_path() / fs::unique_path("gridcoin-bench-%%%%%%%%.dat"))
+    {
+    }
+
+    ~TemporarySnapshotPath()
+    {
+        boost::system::error_code ec;
+        fs::remove(m_path, ec);
+    }
+
+    const fs::path m_path;
+};
+
+//!
+//! \brief Write a snapshot of the synthetic tally's accrual to the path.
+//!
+void WriteSnapshot(const fs::path& path, const benchmark::SyntheticTally& tally)
+{
+    AccrualSnapshotWriter writer(path);
+
+    writer.WriteHeader(tally.m_superblock.m_height);
+
+    for (const auto& cpid : tally.m_cpids) {
+        writer.WriteRecord(cpid, tally.m_accounts.at(cpid).m_accrual);
+    }
+}
+} // anonymous namespace
+
+static void SnapshotAccrual(benchmark::State& state)
+{
+    const benchmark::SyntheticTally& tally = GetTally();
+
+    state.SetItemsPerIteration(tally.m_accounts.size());
+
+    while (state.KeepRunning()) {
+        int64_t total = 0;
+
+        for (const auto& account_pair : tally.m_accounts) {
+            total += SnapshotAccrualComputer(
+                account_pair.first,
+                account_pair.second,
+                tally.m_payment_time,
+                tally.m_last_height,
+                tally.m_superblock)
+                .Accrual();
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+
+static void LegacyAccrual(benchmark::State& state)
+{
+    const benchmark::SyntheticTally& tally = GetTally();
+    const double magnitude_unit = 0.25;
+
+    state.SetItemsPerIteration(tally.m_accounts.size());
+
+    while (state.KeepRunning()) {
+        int64_t total = 0;
+
+        for (const auto& account_pair : tally.m_accounts) {
+            const Cpid& cpid = account_pair.first;
+            const ResearchAccount& account = account_pair.second;
+            const double magnitude = tally.m_superblock->m_cpids.MagnitudeOf(cpid).Floating();
+
+            if (account.IsNew()) {
+                total += NewbieAccrualComputer(
+                    cpid,
+                    account,
+                    tally.m_payment_time,
+                    magnitude_unit,
+                    magnitude)
+                    .Accrual();
+            } else {
+                total += ResearchAgeComputer(
+                    cpid,
+                    account,
+                    magnitude,
+                    tally.m_payment_time,
+                    magnitude_unit,
+                    tally.m_last_height)
+                    .Accrual();
+            }
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+
+static void NewbieAccrual(benchmark::State& state)
+{
+    const benchmark::SyntheticTally& tally = GetTally();
+    const double magnitude_unit = 0.25;
+    const ResearchAccount account;
+
+    state.SetItemsPerIteration(tally.m_cpids.size());
+
+    while (state.KeepRunning()) {
+        int64_t total = 0;
+
+        for (const auto& cpid : tally.m_cpids) {
+            const double magnitude = tally.m_superblock->m_cpids.MagnitudeOf(cpid).Floating();
+
+            total += NewbieAccrualComputer(
+                cpid,
+                account,
+                tally.m_payment_time,
+                magnitude_unit,
+                magnitude)
+                .Accrual();
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+
+static void AccrualSnapshotWrite(benchmark::State& state)
+{
+    const benchmark::SyntheticTally& tally = GetTally();
+    const TemporarySnapshotPath temp;
+
+    state.SetItemsPerIteration(tally.m_cpids.size());
+
+    while (state.KeepRunning()) {
+        WriteSnapshot(temp.m_path, tally);
+    }
+}
+
+static void AccrualSnapshotReadEach(benchmark::State& state)
+{
+    const benchmark::SyntheticTally& tally = GetTally();
+    const TemporarySnapshotPath temp;
+
+    WriteSnapshot(temp.m_path, tally);
+    state.SetItemsPerIteration(tally.m_cpids.size());
+
+    while (state.KeepRunning()) {
+        AccrualSnapshotReader reader(temp.m_path);
+        uint32_t version;
+        uint64_t height;
+        int64_t total = 0;
+
+        reader.ReadEach(version, height, [&](const Cpid&, const int64_t accrual) {
+            total += accrual;
+        });
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+
+static void AccrualSnapshotFind(benchmark::State& state)
+{
+    const benchmark::SyntheticTally& tally = GetTally();
+    const TemporarySnapshotPath temp;
+    const size_t lookups = 1000;
+
+    WriteSnapshot(temp.m_path, tally);
+    state.SetItemsPerIteration(lookups);
+
+    while (state.KeepRunning()) {
+        AccrualSnapshotReader reader(temp.m_path);
+        int64_t total = 0;
+
+        for (size_t i = 0; i < lookups; ++i) {
+            total += reader.FindAccrual(tally.m_cpids[i * tally.m_cpids.size() / lookups]);
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+
+BENCHMARK(SnapshotAccrual, 20);
+BENCHMARK(LegacyAccrual, 20);
+BENCHMARK(NewbieAccrual, 20);
+BENCHMARK(AccrualSnapshotWrite, 10);
+BENCHMARK(AccrualSnapshotReadEach, 10);
+BENCHMARK(AccrualSnapshotFind, 50);
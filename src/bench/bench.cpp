@@ -0,0 +1,117 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "util/time.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+using namespace benchmark;
+
+volatile uint64_t benchmark::g_sink = 0;
+
+// -----------------------------------------------------------------------------
+// Class: State
+// -----------------------------------------------------------------------------
+
+State::State(std::string name, const uint64_t iterations)
+    : m_name(std::move(name))
+    , m_max_count(std::max<uint64_t>(iterations, 1))
+    , m_count(0)
+    , m_items(1)
+    , m_start_micros(0)
+    , m_elapsed_micros(0)
+{
+}
+
+bool State::KeepRunning()
+{
+    if (m_count == 0) {
+        m_start_micros = GetTimeMicros();
+    }
+
+    if (m_count < m_max_count) {
+        ++m_count;
+        return true;
+    }
+
+    m_elapsed_micros = GetTimeMicros() - m_start_micros;
+
+    return false;
+}
+
+void State::SetItemsPerIteration(const uint64_t items)
+{
+    m_items = std::max<uint64_t>(items, 1);
+}
+
+const std::string& State::Name() const
+{
+    return m_name;
+}
+
+int64_t State::ElapsedMicros() const
+{
+    return m_elapsed_micros;
+}
+
+uint64_t State::Iterations() const
+{
+    return m_count;
+}
+
+uint64_t State::Items() const
+{
+    return m_count * m_items;
+}
+
+// -----------------------------------------------------------------------------
+// Class: BenchRunner
+// -----------------------------------------------------------------------------
+
+BenchRunner::BenchmarkMap& BenchRunner::Benchmarks()
+{
+    static BenchmarkMap benchmarks;
+    return benchmarks;
+}
+
+BenchRunner::BenchRunner(
+    std::string name,
+    BenchFunction func,
+    const uint64_t iterations)
+{
+    Benchmarks().emplace(std::move(name), Bench { std::move(func), iterations });
+}
+
+void BenchRunner::RunAll(const std::string& filter, const double scaling)
+{
+    std::printf("# Benchmark, iterations, items, total (s), ns/item, items/s\n");
+
+    for (const auto& entry : Benchmarks()) {
+        if (!filter.empty() && entry.first.find(filter) == std::string::npos) {
+            continue;
+        }
+
+        const uint64_t iterations = std::max<uint64_t>(
+            std::llround(entry.second.m_iterations * scaling),
+            1);
+
+        State state(entry.first, iterations);
+        entry.second.m_func(state);
+
+        const double seconds = state.ElapsedMicros() / 1000000.0;
+        const double items = std::max<uint64_t>(state.Items(), 1);
+
+        std::printf("%s, %" PRIu64 ", %" PRIu64 ", %.6f, %.1f, %.0f\n",
+            state.Name().c_str(),
+            state.Iterations(),
+            state.Items(),
+            seconds,
+            state.ElapsedMicros() * 1000.0 / items,
+            seconds > 0 ? items / seconds : 0);
+    }
+}
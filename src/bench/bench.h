@@ -0,0 +1,164 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <boost/preprocessor/cat.hpp>
+#include <boost/preprocessor/stringize.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace benchmark {
+//!
+//! \brief Tracks the iterations of a running benchmark.
+//!
+//! A benchmark function loops on \c KeepRunning() until the runner collected
+//! enough samples. Each iteration may process a batch of items, such as the
+//! CPIDs in a synthetic tally, so that the runner can report the throughput
+//! of the routine under test:
+//!
+//!     static void MyBenchmark(benchmark::State& state)
+//!     {
+//!         const auto data = BuildExpensiveInput(); // excluded from timing
+//!
+//!         state.SetItemsPerIteration(data.size());
+//!
+//!         while (state.KeepRunning()) {
+//!             RoutineUnderTest(data);
+//!         }
+//!     }
+//!
+//!     BENCHMARK(MyBenchmark, 10);
+//!
+class State
+{
+public:
+    //!
+    //! \brief Initialize a benchmark state.
+    //!
+    //! \param name       Name of the benchmark to report.
+    //! \param iterations Number of times to run the timed loop body.
+    //!
+    State(std::string name, const uint64_t iterations);
+
+    //!
+    //! \brief Determine whether the benchmark should run another iteration.
+    //!
+    //! The first call starts the timer. The call that exhausts the requested
+    //! iterations stops the timer and records the elapsed time.
+    //!
+    //! \return \c false when the benchmark finished all of its iterations.
+    //!
+    bool KeepRunning();
+
+    //!
+    //! \brief Set the number of items that one iteration processes.
+    //!
+    //! \param items Items in one iteration of the timed loop body.
+    //!
+    void SetItemsPerIteration(const uint64_t items);
+
+    //!
+    //! \brief Get the name of the benchmark.
+    //!
+    const std::string& Name() const;
+
+    //!
+    //! \brief Get the total time spent in the timed loop in microseconds.
+    //!
+    int64_t ElapsedMicros() const;
+
+    //!
+    //! \brief Get the number of completed iterations.
+    //!
+    uint64_t Iterations() const;
+
+    //!
+    //! \brief Get the number of items processed by all of the iterations.
+    //!
+    uint64_t Items() const;
+
+private:
+    const std::string m_name;   //!< Name of the benchmark to report.
+    const uint64_t m_max_count; //!< Iterations to run.
+    uint64_t m_count;           //!< Iterations started so far.
+    uint64_t m_items;           //!< Items processed by one iteration.
+    int64_t m_start_micros;     //!< Time that the first iteration started.
+    int64_t m_elapsed_micros;   //!< Time spent in all of the iterations.
+};
+
+//!
+//! \brief Receives the values passed to \c DoNotOptimize().
+//!
+extern volatile uint64_t g_sink;
+
+//!
+//! \brief Consume a result so that the compiler cannot drop the loop body
+//! that computes it.
+//!
+//! \param value An integral result of the code under test.
+//!
+template <typename T>
+void DoNotOptimize(const T& value)
+{
+    g_sink = static_cast<uint64_t>(value);
+}
+
+//!
+//! \brief Signature of a registered benchmark function.
+//!
+typedef std::function<void(State&)> BenchFunction;
+
+//!
+//! \brief Registers and runs the benchmarks compiled into the binary.
+//!
+class BenchRunner
+{
+public:
+    //!
+    //! \brief Register a benchmark. Called by the \c BENCHMARK macro.
+    //!
+    //! \param name       Name of the benchmark to report.
+    //! \param func       Benchmark function to run.
+    //! \param iterations Number of iterations to time.
+    //!
+    BenchRunner(std::string name, BenchFunction func, const uint64_t iterations);
+
+    //!
+    //! \brief Run the registered benchmarks and print a report to stdout.
+    //!
+    //! \param filter     Only run benchmarks with names that contain this
+    //! substring. An empty string runs every benchmark.
+    //! \param scaling    Scales the number of iterations of each benchmark.
+    //!
+    static void RunAll(const std::string& filter, const double scaling);
+
+private:
+    struct Bench
+    {
+        BenchFunction m_func;  //!< Benchmark function to run.
+        uint64_t m_iterations; //!< Number of iterations to time.
+    };
+
+    typedef std::map<std::string, Bench> BenchmarkMap;
+
+    //!
+    //! \brief Get the set of registered benchmarks ordered by name.
+    //!
+    static BenchmarkMap& Benchmarks();
+};
+} // namespace benchmark
+
+//!
+//! \brief Register a benchmark function with the runner.
+//!
+//! Usage: BENCHMARK(MyBenchmark, 10) where 10 is the number of iterations.
+//! Benchmarks that process many items per iteration should choose a small
+//! iteration count to keep the suite fast.
+//!
+#define BENCHMARK(n, iterations) \
+    benchmark::BenchRunner BOOST_PP_CAT(bench_, BOOST_PP_CAT(__LINE__, n))(BOOST_PP_STRINGIZE(n), n, iterations);
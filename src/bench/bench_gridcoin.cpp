@@ -0,0 +1,47 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "chainparams.h"
+#include "util.h"
+#include "util/strencodings.h"
+
+#include <cstdio>
+
+extern void noui_connect();
+
+int main(int argc, char** argv)
+{
+    ParseParameters(argc, argv);
+
+    if (mapArgs.count("-?") || mapArgs.count("-h") || mapArgs.count("-help")) {
+        std::printf(
+            "Usage: bench_gridcoin [options]\n"
+            "\n"
+            "Options:\n"
+            "  -filter=<text>         Run only the benchmarks with names that contain <text>\n"
+            "  -scaling=<n>           Multiply the iterations of each benchmark by <n> (default: 1.0)\n"
+            "  -replayfile=<file>     Replay the blocks in a flat file for the ReplayBlocks benchmark\n"
+            "  -replaydatadir=<dir>   Scratch data directory for ReplayBlocks (default: a new temporary directory)\n"
+            "  -replayreorg=<n>       Reorganize back and forward by <n> blocks after ReplayBlocks\n");
+
+        return 0;
+    }
+
+    SetupEnvironment();
+    fPrintToDebugger = true; // don't want to write to debug.log file
+    SelectParams(CBaseChainParams::MAIN);
+    noui_connect();
+
+    double scaling = 1.0;
+
+    if (mapArgs.count("-scaling") && !ParseDouble(GetArg("-scaling", "1.0"), &scaling)) {
+        std::fprintf(stderr, "Error: invalid -scaling value\n");
+        return 1;
+    }
+
+    benchmark::BenchRunner::RunAll(GetArg("-filter", ""), scaling);
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "crypter.h"
+#include "crypto/aes.h"
+
+#include <openssl/evp.h>
+
+#include <cassert>
+#include <iostream>
+#include <vector>
+
+namespace {
+//!
+//! \brief Number of secrets encrypted or decrypted in each iteration, about
+//! the key count of a large wallet.
+//!
+constexpr size_t SECRET_COUNT = 10000;
+
+//!
+//! \brief Size of the buffer in the bulk AES benchmarks.
+//!
+constexpr size_t BULK_SIZE = 1024 * 1024;
+
+CKeyingMaterial MasterKey()
+{
+    return CKeyingMaterial(WALLET_CRYPTO_KEY_SIZE, 0x5a);
+}
+
+//!
+//! \brief A private key as stored by the wallet, and a per-key IV.
+//!
+CSecret Secret(const size_t i)
+{
+    CSecret secret(32);
+
+    for (size_t j = 0; j < secret.size(); ++j) {
+        secret[j] = i + j;
+    }
+
+    return secret;
+}
+
+uint256 IV(const size_t i)
+{
+    uint256 iv;
+    *iv.begin() = i;
+    *(iv.begin() + 1) = i >> 8;
+
+    return iv;
+}
+
+//!
+//! \brief Encrypts a buffer with OpenSSL's EVP interface, as CCrypter did
+//! before it moved to the in-tree AES.
+//!
+bool EvpEncrypt(
+    const unsigned char* key,
+    const unsigned char* iv,
+    const unsigned char* data,
+    const int size,
+    std::vector<unsigned char>& out)
+{
+    out.resize(size + AES_BLOCKSIZE);
+    int len = 0;
+    int final_len = 0;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    bool ok = ctx != nullptr;
+
+    if (ok) ok = EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key, iv);
+    if (ok) ok = EVP_EncryptUpdate(ctx, out.data(), &len, data, size);
+    if (ok) ok = EVP_EncryptFinal_ex(ctx, out.data() + len, &final_len);
+    EVP_CIPHER_CTX_free(ctx);
+
+    out.resize(len + final_len);
+    return ok;
+}
+} // anonymous namespace
+
+//!
+//! \brief Encrypt the private keys of a large wallet, as encryptwallet and
+//! key imports do.
+//!
+static void CrypterEncryptSecrets(benchmark::State& state)
+{
+    std::cout << "# AES implementation: " << AES256AutoDetect() << "\n";
+
+    CKeyingMaterial master_key = MasterKey();
+    std::vector<unsigned char> ciphertext;
+
+    state.SetItemsPerIteration(SECRET_COUNT);
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < SECRET_COUNT; ++i) {
+            const bool ok = EncryptSecret(master_key, Secret(i), IV(i), ciphertext);
+            assert(ok);
+            benchmark::DoNotOptimize(ciphertext[0]);
+        }
+    }
+}
+
+//!
+//! \brief Decrypt the private keys of a large wallet, as a wallet unlock does.
+//!
+static void CrypterDecryptSecrets(benchmark::State& state)
+{
+    const CKeyingMaterial master_key = MasterKey();
+    CKeyingMaterial encrypt_key = master_key;
+    std::vector<std::vector<unsigned char>> ciphertexts(SECRET_COUNT);
+
+    for (size_t i = 0; i < SECRET_COUNT; ++i) {
+        const bool ok = EncryptSecret(encrypt_key, Secret(i), IV(i), ciphertexts[i]);
+        assert(ok);
+    }
+
+    CSecret secret;
+
+    state.SetItemsPerIteration(SECRET_COUNT);
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < SECRET_COUNT; ++i) {
+            const bool ok = DecryptSecret(master_key, ciphertexts[i], IV(i), secret);
+            assert(ok);
+            benchmark::DoNotOptimize(secret[0]);
+        }
+    }
+}
+
+//!
+//! \brief Encrypt the private keys of a large wallet through OpenSSL EVP for
+//! comparison with CrypterEncryptSecrets.
+//!
+static void EvpEncryptSecrets(benchmark::State& state)
+{
+    const CKeyingMaterial master_key = MasterKey();
+    std::vector<unsigned char> ciphertext;
+
+    state.SetItemsPerIteration(SECRET_COUNT);
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < SECRET_COUNT; ++i) {
+            const CSecret secret = Secret(i);
+            const uint256 iv = IV(i);
+
+            const bool ok = EvpEncrypt(master_key.data(), iv.begin(), secret.data(), secret.size(), ciphertext);
+            assert(ok);
+            benchmark::DoNotOptimize(ciphertext[0]);
+        }
+    }
+}
+
+//!
+//! \brief Encrypt a large buffer with the AES implementation chosen at run
+//! time.
+//!
+static void AES256CBCEncryptBulk(benchmark::State& state)
+{
+    const std::vector<unsigned char> key(AES256_KEYSIZE, 0x5a);
+    const std::vector<unsigned char> iv(AES_BLOCKSIZE, 0xa5);
+    const std::vector<unsigned char> data(BULK_SIZE, 0x42);
+    std::vector<unsigned char> out(BULK_SIZE + AES_BLOCKSIZE);
+
+    const AES256CBCEncrypt enc(key.data(), iv.data(), true);
+
+    state.SetItemsPerIteration(BULK_SIZE);
+
+    while (state.KeepRunning()) {
+        enc.Encrypt(data.data(), data.size(), out.data());
+        benchmark::DoNotOptimize(out[0]);
+    }
+}
+
+//!
+//! \brief Encrypt a large buffer with ctaes regardless of the CPU, for
+//! comparison with AES256CBCEncryptBulk.
+//!
+static void CtaesEncryptBulk(benchmark::State& state)
+{
+    const std::vector<unsigned char> key(AES256_KEYSIZE, 0x5a);
+    std::vector<unsigned char> block(AES_BLOCKSIZE, 0xa5);
+
+    AES256_ctx ctx;
+    AES256_init(&ctx, key.data());
+
+    state.SetItemsPerIteration(BULK_SIZE);
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < BULK_SIZE; i += AES_BLOCKSIZE) {
+            AES256_encrypt(&ctx, 1, block.data(), block.data());
+        }
+
+        benchmark::DoNotOptimize(block[0]);
+    }
+}
+
+BENCHMARK(CrypterEncryptSecrets, 5);
+BENCHMARK(CrypterDecryptSecrets, 5);
+BENCHMARK(EvpEncryptSecrets, 5);
+BENCHMARK(AES256CBCEncryptBulk, 20);
+BENCHMARK(CtaesEncryptBulk, 20);
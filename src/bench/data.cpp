@@ -0,0 +1,178 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/data.h"
+
+#include <algorithm>
+#include <random>
+
+using namespace benchmark;
+
+namespace {
+//!
+//! \brief Seed for the generated data so that every run measures the same
+//! inputs.
+//!
+constexpr uint64_t SEED = 0x67726362656e6368; // "grcbench"
+
+//!
+//! \brief Number of whitelisted projects in the generated statistics.
+//!
+constexpr size_t PROJECT_COUNT = 30;
+} // anonymous namespace
+
+std::vector<GRC::Cpid> benchmark::GenerateCpids(const size_t count)
+{
+    std::mt19937_64 rng(SEED);
+    std::vector<GRC::Cpid> cpids;
+
+    cpids.reserve(count);
+
+    while (cpids.size() < count) {
+        GRC::Cpid cpid;
+
+        for (size_t i = 0; i < cpid.Raw().size(); i += sizeof(uint64_t)) {
+            const uint64_t bits = rng();
+            std::copy_n(reinterpret_cast<const unsigned char*>(&bits),
+                sizeof(uint64_t),
+                cpid.Raw().begin() + i);
+        }
+
+        cpids.emplace_back(cpid);
+
+        if (cpids.size() == count) {
+            std::sort(cpids.begin(), cpids.end());
+            cpids.erase(std::unique(cpids.begin(), cpids.end()), cpids.end());
+        }
+    }
+
+    return cpids;
+}
+
+ScraperStatsAndVerifiedBeacons benchmark::GenerateScraperStats(
+    const std::vector<GRC::Cpid>& cpids)
+{
+    std::mt19937_64 rng(SEED);
+    std::uniform_real_distribution<double> magnitudes(0, 4000);
+    std::uniform_real_distribution<double> credits(1000, 100000000);
+
+    std::vector<ScraperStats::value_type> entries;
+    entries.reserve(cpids.size() + PROJECT_COUNT);
+
+    for (const auto& cpid : cpids) {
+        ScraperObjectStats stats;
+
+        stats.statskey.objecttype = statsobjecttype::byCPID;
+        stats.statskey.objectID = cpid.ToString();
+        stats.statsvalue.dTC = credits(rng);
+        stats.statsvalue.dRAC = credits(rng) / 1000;
+        stats.statsvalue.dAvgRAC = stats.statsvalue.dRAC;
+        stats.statsvalue.dMag = magnitudes(rng);
+
+        entries.emplace_back(stats.statskey, std::move(stats));
+    }
+
+    for (size_t i = 0; i < PROJECT_COUNT; ++i) {
+        ScraperObjectStats stats;
+
+        stats.statskey.objecttype = statsobjecttype::byProject;
+        stats.statskey.objectID = "project_" + std::to_string(i);
+        stats.statsvalue.dTC = credits(rng) * 1000;
+        stats.statsvalue.dRAC = credits(rng);
+        stats.statsvalue.dAvgRAC = stats.statsvalue.dRAC / cpids.size();
+        stats.statsvalue.dMag = 0;
+
+        entries.emplace_back(stats.statskey, std::move(stats));
+    }
+
+    ScraperStatsAndVerifiedBeacons stats_and_verified_beacons;
+    stats_and_verified_beacons.mScraperStats = ScraperStats::FromUnsorted(std::move(entries));
+
+    return stats_and_verified_beacons;
+}
+
+GRC::Superblock benchmark::GenerateSuperblock(const std::vector<GRC::Cpid>& cpids)
+{
+    std::mt19937_64 rng(SEED);
+    std::uniform_real_distribution<double> magnitudes(0, 4000);
+    std::uniform_int_distribution<uint64_t> credits(1000, 100000000);
+
+    GRC::Superblock superblock;
+
+    for (const auto& cpid : cpids) {
+        superblock.m_cpids.RoundAndAdd(cpid, magnitudes(rng));
+    }
+
+    for (size_t i = 0; i < PROJECT_COUNT; ++i) {
+        superblock.m_projects.Add(
+            "project_" + std::to_string(i),
+            GRC::Superblock::ProjectStats(credits(rng) * 1000, credits(rng), credits(rng)));
+    }
+
+    return superblock;
+}
+
+// -----------------------------------------------------------------------------
+// Class: SyntheticTally
+// -----------------------------------------------------------------------------
+
+constexpr int64_t SyntheticTally::BLOCK_COUNT; // for clang
+constexpr int64_t SyntheticTally::BLOCK_SPACING; // for clang
+
+SyntheticTally::SyntheticTally(std::vector<GRC::Cpid> cpids)
+    : m_cpids(std::move(cpids))
+    , m_blocks(BLOCK_COUNT)
+{
+    std::mt19937_64 rng(SEED);
+    std::uniform_int_distribution<uint16_t> magnitudes(0, 4000);
+
+    const int64_t genesis_time = 1413033777;
+
+    for (int64_t height = 0; height < BLOCK_COUNT; ++height) {
+        CBlockIndex& block = m_blocks[height];
+
+        block.nHeight = height;
+        block.nTime = genesis_time + height * BLOCK_SPACING;
+        block.nMagnitude = magnitudes(rng);
+        block.pprev = height > 0 ? &m_blocks[height - 1] : nullptr;
+
+        if (block.pprev != nullptr) {
+            block.pprev->pnext = &block;
+        }
+    }
+
+    const CBlockIndex* const pindex_tip = &m_blocks.back();
+    const CBlockIndex* const pindex_superblock = &m_blocks[BLOCK_COUNT - 500];
+
+    m_superblock = GRC::SuperblockPtr::BindShared(GenerateSuperblock(m_cpids), pindex_superblock);
+    m_payment_time = pindex_tip->nTime + BLOCK_SPACING;
+    m_last_height = pindex_tip->nHeight + 1;
+
+    std::uniform_int_distribution<int64_t> heights(0, BLOCK_COUNT - 1);
+    std::uniform_int_distribution<int64_t> payments(1, 50000);
+    std::uniform_int_distribution<uint32_t> reward_counts(1, 500);
+
+    for (const auto& cpid : m_cpids) {
+        GRC::ResearchAccount& account = m_accounts[cpid];
+
+        // Leave about a fifth of the accounts new for the newbie paths:
+        if (rng() % 5 == 0) {
+            continue;
+        }
+
+        int64_t first_height = heights(rng);
+        int64_t last_height = heights(rng);
+
+        if (first_height > last_height) {
+            std::swap(first_height, last_height);
+        }
+
+        account.m_first_block_ptr = &m_blocks[first_height];
+        account.m_last_block_ptr = &m_blocks[last_height];
+        account.m_accuracy = reward_counts(rng);
+        account.m_total_magnitude = account.m_accuracy * magnitudes(rng);
+        account.m_total_research_subsidy = account.m_accuracy * payments(rng) * COIN / 100;
+        account.m_accrual = payments(rng) * COIN / 100;
+    }
+}
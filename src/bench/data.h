@@ -0,0 +1,75 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "main.h"
+#include "gridcoin/account.h"
+#include "gridcoin/cpid.h"
+#include "gridcoin/scraper/fwd.h"
+#include "gridcoin/superblock.h"
+
+#include <vector>
+
+namespace benchmark {
+//!
+//! \brief Number of CPIDs in the synthetic data sets. Comparable to the size
+//! of the network with some room to grow.
+//!
+constexpr size_t SYNTHETIC_CPID_COUNT = 50000;
+
+//!
+//! \brief Generate a deterministic, sorted set of unique CPIDs.
+//!
+//! \param count Number of CPIDs to generate.
+//!
+std::vector<GRC::Cpid> GenerateCpids(const size_t count);
+
+//!
+//! \brief Generate a deterministic set of scraper statistics like those that
+//! a scraper convergence produces for the supplied CPIDs.
+//!
+//! \param cpids CPIDs to include in the statistics.
+//!
+ScraperStatsAndVerifiedBeacons GenerateScraperStats(const std::vector<GRC::Cpid>& cpids);
+
+//!
+//! \brief Generate a superblock that assigns a magnitude to each CPID.
+//!
+//! \param cpids CPIDs to include in the superblock.
+//!
+GRC::Superblock GenerateSuperblock(const std::vector<GRC::Cpid>& cpids);
+
+//!
+//! \brief A synthetic chain with research accounts that reference its blocks.
+//!
+//! Contains the state that the accrual computers read: a main chain of block
+//! index objects, an active superblock in a recent block, and the research
+//! account of each CPID. About a fifth of the accounts never earned a reward
+//! to exercise the newbie accrual paths.
+//!
+class SyntheticTally
+{
+public:
+    static constexpr int64_t BLOCK_COUNT = 100000; //!< Blocks in the chain.
+    static constexpr int64_t BLOCK_SPACING = 90;   //!< Seconds between blocks.
+
+    //!
+    //! \brief Build a synthetic tally for the supplied CPIDs.
+    //!
+    //! \param cpids CPIDs to create research accounts for.
+    //!
+    explicit SyntheticTally(std::vector<GRC::Cpid> cpids);
+
+    SyntheticTally(const SyntheticTally&) = delete;
+    SyntheticTally& operator=(const SyntheticTally&) = delete;
+
+    std::vector<GRC::Cpid> m_cpids;        //!< CPIDs in the tally.
+    std::vector<CBlockIndex> m_blocks;     //!< Main chain from height zero.
+    GRC::SuperblockPtr m_superblock;       //!< Active superblock.
+    GRC::ResearchAccountMap m_accounts;    //!< Research accounts by CPID.
+    int64_t m_payment_time;                //!< Time of the next block.
+    uint32_t m_last_height;                //!< Height of the next block.
+};
+} // namespace benchmark
@@ -0,0 +1,186 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "crypto/common.h"
+#include "crypto/siphash.h"
+#include "gridcoin/cpid.h"
+#include "main.h"
+#include "util/hasher.h"
+
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+//!
+//! \brief Number of keys in the tables of the lookup benchmarks.
+//!
+constexpr size_t KEY_COUNT = 100000;
+
+//!
+//! \brief The hasher that keyed mapBlockIndex and the part map of the scraper:
+//! the first 64 bits of the hash.
+//!
+struct CheapUint256Hasher
+{
+    size_t operator()(const uint256& hash) const { return hash.GetUint64(); }
+};
+
+//!
+//! \brief The std::hash<GRC::Cpid> specialization before salting: the sum of
+//! the two halves of the CPID.
+//!
+struct CheapCpidHasher
+{
+    size_t operator()(const GRC::Cpid& cpid) const
+    {
+        return ReadLE64(cpid.Raw().data()) + ReadLE64(cpid.Raw().data() + 8);
+    }
+};
+
+//!
+//! \brief A SipHash-2-4 hasher as used by CInvHasher and CNetAddrHasher.
+//!
+struct SipHash24Uint256Hasher
+{
+    const uint64_t k0 = GetRand(std::numeric_limits<uint64_t>::max());
+    const uint64_t k1 = GetRand(std::numeric_limits<uint64_t>::max());
+
+    size_t operator()(const uint256& hash) const { return SipHashUint256(k0, k1, hash); }
+};
+
+const std::vector<uint256>& GetHashes()
+{
+    static const std::vector<uint256> hashes = [] {
+        std::vector<uint256> hashes;
+        hashes.reserve(KEY_COUNT);
+
+        for (size_t i = 0; i < KEY_COUNT; ++i) {
+            hashes.push_back(GetRandHash());
+        }
+
+        return hashes;
+    }();
+
+    return hashes;
+}
+
+const std::vector<GRC::Cpid>& GetCpids()
+{
+    static const std::vector<GRC::Cpid> cpids = [] {
+        std::vector<GRC::Cpid> cpids;
+        cpids.reserve(KEY_COUNT);
+
+        for (const auto& hash : GetHashes()) {
+            cpids.emplace_back(std::vector<unsigned char>(hash.begin(), hash.begin() + 16));
+        }
+
+        return cpids;
+    }();
+
+    return cpids;
+}
+
+//!
+//! \brief Hash every key with a hasher.
+//!
+template <typename Hasher, typename Key>
+void HashKeys(benchmark::State& state, const std::vector<Key>& keys)
+{
+    const Hasher hasher;
+
+    state.SetItemsPerIteration(keys.size());
+
+    while (state.KeepRunning()) {
+        uint64_t total = 0;
+
+        for (const auto& key : keys) {
+            total += hasher(key);
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+
+//!
+//! \brief Look up every key in a table filled with the keys.
+//!
+template <typename Hasher, typename Key>
+void LookUpKeys(benchmark::State& state, const std::vector<Key>& keys)
+{
+    std::unordered_map<Key, size_t, Hasher> table;
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        table.emplace(keys[i], i);
+    }
+
+    state.SetItemsPerIteration(keys.size());
+
+    while (state.KeepRunning()) {
+        uint64_t total = 0;
+
+        for (const auto& key : keys) {
+            total += table.find(key)->second;
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+} // anonymous namespace
+
+static void HashUint256Cheap(benchmark::State& state)
+{
+    HashKeys<CheapUint256Hasher>(state, GetHashes());
+}
+
+static void HashUint256SipHash24(benchmark::State& state)
+{
+    HashKeys<SipHash24Uint256Hasher>(state, GetHashes());
+}
+
+static void HashUint256Salted(benchmark::State& state)
+{
+    HashKeys<SaltedUint256Hasher>(state, GetHashes());
+}
+
+static void HashCpidCheap(benchmark::State& state)
+{
+    HashKeys<CheapCpidHasher>(state, GetCpids());
+}
+
+static void HashCpidSalted(benchmark::State& state)
+{
+    HashKeys<std::hash<GRC::Cpid>>(state, GetCpids());
+}
+
+static void LookUpUint256Cheap(benchmark::State& state)
+{
+    LookUpKeys<CheapUint256Hasher>(state, GetHashes());
+}
+
+static void LookUpUint256Salted(benchmark::State& state)
+{
+    LookUpKeys<SaltedUint256Hasher>(state, GetHashes());
+}
+
+static void LookUpCpidCheap(benchmark::State& state)
+{
+    LookUpKeys<CheapCpidHasher>(state, GetCpids());
+}
+
+static void LookUpCpidSalted(benchmark::State& state)
+{
+    LookUpKeys<std::hash<GRC::Cpid>>(state, GetCpids());
+}
+
+BENCHMARK(HashUint256Cheap, 100);
+BENCHMARK(HashUint256SipHash24, 100);
+BENCHMARK(HashUint256Salted, 100);
+BENCHMARK(HashCpidCheap, 100);
+BENCHMARK(HashCpidSalted, 100);
+BENCHMARK(LookUpUint256Cheap, 20);
+BENCHMARK(LookUpUint256Salted, 20);
+BENCHMARK(LookUpCpidCheap, 20);
+BENCHMARK(LookUpCpidSalted, 20);
@@ -0,0 +1,234 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "bench/bench.h"
+#include "chainparams.h"
+#include "fs.h"
+#include "gridcoin/support/block_finder.h"
+#include "gridcoin/tally.h"
+#include "streams.h"
+#include "util.h"
+#include "util/perf.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+bool ForceReorganizeToHash(uint256 NewHash);
+
+namespace {
+//!
+//! \brief Read the blocks in a flat file as written for -loadblock: each
+//! block follows the network magic and its size.
+//!
+//! \param path Flat file of blocks exported from a node.
+//!
+//! \return The serialized blocks in the order of the file.
+//!
+std::vector<CDataStream> ReadRawBlocks(const fs::path& path)
+{
+    std::vector<CDataStream> raw_blocks;
+
+    FILE* file = fsbridge::fopen(path, "rb");
+
+    if (!file) {
+        std::cerr << "# ReplayBlocks: cannot open " << path.string() << "\n";
+        return raw_blocks;
+    }
+
+    CBufferedFile blkdat(file, 2 * MAX_BLOCK_SIZE, MAX_BLOCK_SIZE + 8, SER_DISK, CLIENT_VERSION);
+    uint64_t rewind = blkdat.GetPos();
+
+    while (!blkdat.eof()) {
+        blkdat.SetPos(rewind);
+        rewind++;
+
+        unsigned int size = 0;
+
+        try {
+            unsigned char buf[sizeof(pchMessageStart)];
+            blkdat.FindByte(pchMessageStart[0]);
+            rewind = blkdat.GetPos() + 1;
+            blkdat >> buf;
+
+            if (memcmp(buf, pchMessageStart, sizeof(pchMessageStart)) != 0) {
+                continue;
+            }
+
+            blkdat >> size;
+
+            if (size == 0 || size > MAX_BLOCK_SIZE) {
+                continue;
+            }
+
+            CDataStream raw(SER_DISK, CLIENT_VERSION);
+            raw.resize(size);
+            blkdat.read(&raw[0], size);
+            rewind = blkdat.GetPos();
+
+            raw_blocks.emplace_back(std::move(raw));
+        } catch (const std::exception&) {
+            break;
+        }
+    }
+
+    return raw_blocks;
+}
+
+//!
+//! \brief Create the block index and the research reward accounting state in
+//! an empty data directory like a new node does.
+//!
+//! \param datadir Scratch data directory for the chain databases.
+//!
+//! \return \c false if the genesis block could not be written.
+//!
+bool InitializeScratchChain(const fs::path& datadir)
+{
+    fs::create_directories(datadir);
+    mapArgs["-datadir"] = datadir.string();
+
+    LOCK(cs_main);
+
+    if (!LoadBlockIndex()) {
+        return false;
+    }
+
+    const int64_t start_height = Params().GetConsensus().ResearchAgeHeight;
+
+    return GRC::Tally::Initialize(GRC::BlockFinder().FindByHeight(start_height));
+}
+
+void PrintStageTimes(const uint64_t blocks)
+{
+    std::printf("# Stage, calls, total (ms), us/call, us/block, max (us)\n");
+
+    for (const auto& snapshot : util::GetPerfSnapshots()) {
+        if (snapshot.count == 0) {
+            continue;
+        }
+
+        std::printf("# %s, %" PRIu64 ", %.3f, %.1f, %.1f, %" PRIu64 "\n",
+            snapshot.name.c_str(),
+            snapshot.count,
+            snapshot.total_us / 1000.0,
+            snapshot.total_us / (double)snapshot.count,
+            snapshot.total_us / (double)std::max<uint64_t>(blocks, 1),
+            snapshot.max_us);
+    }
+}
+} // anonymous namespace
+
+//!
+//! \brief Replay a range of exported mainnet blocks through ProcessBlock()
+//! into a scratch data directory.
+//!
+//! The blocks must start at the block after genesis. Options:
+//!
+//!   -replayfile=<file>     Flat file of blocks to replay, as read by
+//!                          -loadblock. The benchmark does nothing without it.
+//!   -replaydatadir=<dir>   Scratch data directory. Must not contain a chain.
+//!                          Defaults to a new temporary directory.
+//!   -replayreorg=<n>       After the replay, reorganize the chain back by
+//!                          <n> blocks and forward to the tip again.
+//!
+//! The benchmark reports blocks/s as its items/s and prints the time spent in
+//! each instrumented stage: deserialization, CheckBlock, the script checks,
+//! GridcoinConnectBlock, ApplyContracts, the tally and TxnCommit.
+//!
+static void ReplayBlocks(benchmark::State& state)
+{
+    if (!mapArgs.count("-replayfile")) {
+        std::printf("# ReplayBlocks: pass -replayfile=<file> to replay exported blocks\n");
+        return;
+    }
+
+    const std::vector<CDataStream> raw_blocks = ReadRawBlocks(GetArg("-replayfile", ""));
+
+    if (raw_blocks.empty()) {
+        std::printf("# ReplayBlocks: no blocks found in %s\n", GetArg("-replayfile", "").c_str());
+        return;
+    }
+
+    const fs::path datadir = mapArgs.count("-replaydatadir")
+        ? fs::path(GetArg("-replaydatadir", ""))
+        : fs::temp_directory_path() / fs::unique_path("gridcoin-replay-%%%%%%%%");
+
+    if (!InitializeScratchChain(datadir)) {
+        std::printf("# ReplayBlocks: failed to initialize %s\n", datadir.string().c_str());
+        return;
+    }
+
+    std::printf("# ReplayBlocks: %" PRIszu " blocks into %s\n", raw_blocks.size(), datadir.string().c_str());
+
+    util::PerfCounter& deserialize_counter = util::GetPerfCounter("Deserialize");
+    util::g_perf_enabled = true;
+    util::ResetPerfCounters();
+
+    uint64_t connected = 0;
+    bool replayed = false;
+
+    state.SetItemsPerIteration(raw_blocks.size());
+
+    // The chain can only replay once. Any further iterations requested by
+    // -scaling do nothing:
+    while (state.KeepRunning()) {
+        if (replayed) {
+            continue;
+        }
+
+        replayed = true;
+
+        for (const auto& raw_block : raw_blocks) {
+            CBlock block;
+
+            try {
+                util::PerfTimer timer(deserialize_counter);
+                CDataStream stream(raw_block);
+                stream >> block;
+            } catch (const std::exception& e) {
+                std::printf("# ReplayBlocks: deserialize failed: %s\n", e.what());
+                continue;
+            }
+
+            LOCK(cs_main);
+
+            if (!ProcessBlock(nullptr, &block, false)) {
+                std::printf("# ReplayBlocks: block %s rejected at height %d\n",
+                    block.GetHash(true).ToString().c_str(),
+                    nBestHeight);
+                break;
+            }
+
+            ++connected;
+        }
+    }
+
+    std::printf("# ReplayBlocks: connected %" PRIu64 " blocks, tip at height %d\n", connected, nBestHeight);
+
+    PrintStageTimes(connected);
+
+    const int reorg_depth = GetArg("-replayreorg", 0);
+
+    if (reorg_depth > 0 && reorg_depth < nBestHeight) {
+        util::ResetPerfCounters();
+
+        const uint256 tip_hash = pindexBest->GetBlockHash();
+        const uint256 fork_hash = GRC::BlockFinder().FindByHeight(nBestHeight - reorg_depth)->GetBlockHash();
+
+        const bool reorganized = ForceReorganizeToHash(fork_hash) && ForceReorganizeToHash(tip_hash);
+
+        std::printf("# ReplayBlocks: reorganized %d blocks back and forward: %s\n",
+            reorg_depth,
+            reorganized ? "ok" : "failed");
+
+        PrintStageTimes(reorg_depth);
+    }
+
+    util::g_perf_enabled = false;
+}
+
+BENCHMARK(ReplayBlocks, 1);
@@ -0,0 +1,125 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench/bench.h"
+#include "bench/data.h"
+#include "gridcoin/superblock.h"
+#include "streams.h"
+
+using namespace GRC;
+
+namespace {
+//!
+//! \brief Get the CPIDs shared by the superblock benchmarks.
+//!
+const std::vector<Cpid>& GetCpids()
+{
+    static const std::vector<Cpid> cpids
+        = benchmark::GenerateCpids(benchmark::SYNTHETIC_CPID_COUNT);
+
+    return cpids;
+}
+
+//!
+//! \brief Sum the magnitudes of the CPIDs in the superblock.
+//!
+uint64_t SumMagnitudes(const Superblock& superblock, const std::vector<Cpid>& cpids)
+{
+    uint64_t total = 0;
+
+    for (const auto& cpid : cpids) {
+        total += superblock.m_cpids.MagnitudeOf(cpid).Scaled();
+    }
+
+    return total;
+}
+} // anonymous namespace
+
+static void SuperblockFromStats(benchmark::State& state)
+{
+    const std::vector<Cpid>& cpids = GetCpids();
+    const ScraperStatsAndVerifiedBeacons stats = benchmark::GenerateScraperStats(cpids);
+
+    state.SetItemsPerIteration(cpids.size());
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(Superblock::FromStats(stats).m_cpids.size());
+    }
+}
+
+static void SuperblockGetHash(benchmark::State& state)
+{
+    const std::vector<Cpid>& cpids = GetCpids();
+    const Superblock superblock = benchmark::GenerateSuperblock(cpids);
+
+    state.SetItemsPerIteration(cpids.size());
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(superblock.GetHash(true).Valid());
+    }
+}
+
+static void SuperblockSerialize(benchmark::State& state)
+{
+    const std::vector<Cpid>& cpids = GetCpids();
+    const Superblock superblock = benchmark::GenerateSuperblock(cpids);
+
+    state.SetItemsPerIteration(cpids.size());
+
+    while (state.KeepRunning()) {
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << superblock;
+        benchmark::DoNotOptimize(stream.size());
+    }
+}
+
+static void SuperblockUnserialize(benchmark::State& state)
+{
+    const std::vector<Cpid>& cpids = GetCpids();
+    CDataStream data(SER_NETWORK, PROTOCOL_VERSION);
+    data << benchmark::GenerateSuperblock(cpids);
+
+    state.SetItemsPerIteration(cpids.size());
+
+    while (state.KeepRunning()) {
+        CDataStream stream(data.begin(), data.end(), SER_NETWORK, PROTOCOL_VERSION);
+        Superblock superblock;
+        stream >> superblock;
+        benchmark::DoNotOptimize(superblock.m_cpids.size());
+    }
+}
+
+static void CpidIndexMagnitudeOf(benchmark::State& state)
+{
+    const std::vector<Cpid>& cpids = GetCpids();
+    const Superblock superblock = benchmark::GenerateSuperblock(cpids);
+
+    state.SetItemsPerIteration(cpids.size());
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(SumMagnitudes(superblock, cpids));
+    }
+}
+
+static void CpidIndexMagnitudeOfLookup(benchmark::State& state)
+{
+    const std::vector<Cpid>& cpids = GetCpids();
+    const CBlockIndex pindex;
+    const SuperblockPtr superblock = SuperblockPtr::BindShared(
+        benchmark::GenerateSuperblock(cpids),
+        &pindex);
+
+    state.SetItemsPerIteration(cpids.size());
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(SumMagnitudes(*superblock, cpids));
+    }
+}
+
+BENCHMARK(SuperblockFromStats, 5);
+BENCHMARK(SuperblockGetHash, 20);
+BENCHMARK(SuperblockSerialize, 20);
+BENCHMARK(SuperblockUnserialize, 10);
+BENCHMARK(CpidIndexMagnitudeOf, 20);
+BENCHMARK(CpidIndexMagnitudeOfLookup, 20);
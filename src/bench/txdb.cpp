@@ -0,0 +1,172 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(HAVE_CONFIG_H)
+#include "config/gridcoin-config.h"
+#endif
+
+#include "bench/bench.h"
+#include "fs.h"
+#include "serialize.h"
+#include "streams.h"
+#include "uint256.h"
+#include "version.h"
+
+#include <leveldb/cache.h>
+#include <leveldb/db.h>
+#include <leveldb/filter_policy.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+
+namespace {
+//!
+//! \brief Number of transaction index records in the benchmark databases.
+//!
+constexpr size_t TX_INDEX_RECORDS = 100000;
+
+//!
+//! \brief A transaction index database filled with synthetic records, the
+//! same size and shape as the records that CTxDB::UpdateTxIndex() writes.
+//!
+//! The database lives in a temporary directory removed with the object.
+//!
+class SyntheticTxIndexDb
+{
+public:
+    explicit SyntheticTxIndexDb(const leveldb::CompressionType compression)
+        : m_path(fs::temp_directory_path() / fs::unique_path("gridcoin-bench-%%%%%%%%"))
+    {
+        leveldb::Options options;
+        options.create_if_missing = true;
+        options.compression = compression;
+        options.block_cache = leveldb::NewLRUCache(8 * 1048576);
+        options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+
+        m_cache.reset(options.block_cache);
+        m_filter.reset(options.filter_policy);
+
+        leveldb::DB* db;
+        leveldb::Status status = leveldb::DB::Open(options, m_path.string(), &db);
+        assert(status.ok());
+        m_db.reset(db);
+
+        std::mt19937_64 rng(compression);
+
+        for (size_t i = 0; i < TX_INDEX_RECORDS; ++i) {
+            uint256 hash;
+            for (auto it = hash.begin(); it != hash.end(); it += sizeof(uint64_t)) {
+                const uint64_t word = rng();
+                std::memcpy(&*it, &word, sizeof(word));
+            }
+
+            m_hashes.push_back(hash);
+
+            // A CTxIndex: the version, the position of the transaction, and
+            // a null position for each of its two unspent outputs.
+            //
+            const uint32_t file = 1 + i / 20000;
+            const uint32_t block_pos = 80 + i * 640;
+            const uint32_t tx_pos = block_pos + 81 + (i % 4) * 250;
+
+            CDataStream value(SER_DISK, CLIENT_VERSION);
+            value << (int)CLIENT_VERSION << file << block_pos << tx_pos;
+            WriteCompactSize(value, 2);
+            for (int output = 0; output < 2; ++output) {
+                value << (uint32_t)-1 << (uint32_t)0 << (uint32_t)0;
+            }
+
+            m_db->Put(leveldb::WriteOptions(), Key(hash), leveldb::Slice(value.data(), value.size()));
+        }
+
+        m_db->CompactRange(nullptr, nullptr);
+
+        const leveldb::Range everything("", "\xff");
+        uint64_t size;
+        m_db->GetApproximateSizes(&everything, 1, &size);
+
+        std::cout << "# tx index: " << TX_INDEX_RECORDS << " records, "
+            << size << " bytes with "
+            << (compression == leveldb::kSnappyCompression ? "snappy" : "no")
+            << " compression\n";
+    }
+
+    ~SyntheticTxIndexDb()
+    {
+        m_db.reset();
+
+        boost::system::error_code ec;
+        fs::remove_all(m_path, ec);
+    }
+
+    //!
+    //! \brief Get the key of the transaction index record for a hash.
+    //!
+    static std::string Key(const uint256& hash)
+    {
+        CDataStream key(SER_DISK, CLIENT_VERSION);
+        key << std::string("tx") << hash;
+
+        return key.str();
+    }
+
+    const fs::path m_path;
+    std::unique_ptr<leveldb::Cache> m_cache;
+    std::unique_ptr<const leveldb::FilterPolicy> m_filter;
+    std::unique_ptr<leveldb::DB> m_db;
+    std::vector<uint256> m_hashes;
+};
+
+//!
+//! \brief Look up the transaction index records in a random order, as input
+//! validation does.
+//!
+void ReadTxIndex(benchmark::State& state, const leveldb::CompressionType compression)
+{
+    const SyntheticTxIndexDb db(compression);
+    std::vector<uint256> hashes = db.m_hashes;
+    std::shuffle(hashes.begin(), hashes.end(), std::mt19937_64(1));
+
+    // Skip the block cache so that every read decodes and checks the table
+    // block, as a read of a cold record does:
+    leveldb::ReadOptions options;
+    options.fill_cache = false;
+    options.verify_checksums = true;
+
+    std::string value;
+
+    state.SetItemsPerIteration(hashes.size());
+
+    while (state.KeepRunning()) {
+        size_t total = 0;
+
+        for (const auto& hash : hashes) {
+            db.m_db->Get(options, SyntheticTxIndexDb::Key(hash), &value);
+            total += value.size();
+        }
+
+        benchmark::DoNotOptimize(total);
+    }
+}
+} // anonymous namespace
+
+static void ReadTxIndexUncompressed(benchmark::State& state)
+{
+    ReadTxIndex(state, leveldb::kNoCompression);
+}
+
+static void ReadTxIndexSnappy(benchmark::State& state)
+{
+#ifndef USE_SNAPPY
+    std::cout << "# LevelDB built without libsnappy: tables stay uncompressed\n";
+#endif
+    ReadTxIndex(state, leveldb::kSnappyCompression);
+}
+
+BENCHMARK(ReadTxIndexUncompressed, 3);
+BENCHMARK(ReadTxIndexSnappy, 3);
@@ -0,0 +1,452 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockdownload.h"
+#include "checkpoints.h"
+#include "orphanblocks.h"
+
+#include <boost/optional.hpp>
+#include <limits>
+
+constexpr size_t BlockDownloadScheduler::MAX_HEADERS_RESULTS; // for clang
+constexpr size_t BlockDownloadScheduler::BLOCK_DOWNLOAD_WINDOW; // for clang
+constexpr size_t BlockDownloadScheduler::MAX_BLOCKS_IN_TRANSIT_PER_PEER; // for clang
+constexpr int BlockDownloadScheduler::MAX_HEADERS_AHEAD; // for clang
+constexpr int64_t BlockDownloadScheduler::HEADERS_RESPONSE_TIMEOUT; // for clang
+constexpr int64_t BlockDownloadScheduler::BLOCK_DOWNLOAD_TIMEOUT; // for clang
+constexpr int64_t BlockDownloadScheduler::BLOCK_STALLING_TIMEOUT; // for clang
+constexpr int BlockDownloadScheduler::MAX_BLOCK_FAILURES; // for clang
+constexpr int BlockDownloadScheduler::HEADER_SOURCE_PENALTY; // for clang
+
+BlockDownloadScheduler::BlockDownloadScheduler()
+    : m_base_height(0)
+    , m_next_missing(0)
+    , m_header_peer(-1)
+    , m_header_request_time(0)
+    , m_header_source(-1)
+{
+}
+
+bool BlockDownloadScheduler::IsAncestorOf(const uint256& hash, const uint256& descendant) const
+{
+    const auto iter = m_positions.find(hash);
+
+    if (iter == m_positions.end()) {
+        return false;
+    }
+
+    const auto descendant_iter = m_positions.find(descendant);
+
+    return descendant_iter != m_positions.end() && iter->second <= descendant_iter->second;
+}
+
+int BlockDownloadScheduler::TipHeight() const
+{
+    if (m_headers.empty()) {
+        return nBestHeight;
+    }
+
+    return std::max<int>(nBestHeight, m_base_height + m_headers.size());
+}
+
+bool BlockDownloadScheduler::ReceiveHeaders(CNode* pfrom, const std::vector<CBlockHeader>& headers)
+{
+    AssertLockHeld(cs_main);
+
+    const NodeId id = pfrom->GetId();
+
+    if (id != m_header_peer) {
+        return true; // Not requested.
+    }
+
+    m_header_peer = -1;
+
+    if (headers.empty()) {
+        m_header_synced.insert(id);
+        return true;
+    }
+
+    // Find the block that the headers extend. It is either a header in
+    // the chain that we know or a block that we have:
+    //
+    int start_height;
+    size_t keep;
+
+    const auto position_iter = m_positions.find(headers.front().hashPrevBlock);
+
+    if (position_iter != m_positions.end()) {
+        keep = position_iter->second + 1;
+        start_height = m_base_height + keep;
+    } else if (!m_headers.empty() && headers.front().hashPrevBlock == m_base_hash) {
+        keep = 0;
+        start_height = m_base_height;
+    } else {
+        const auto block_iter = mapBlockIndex.find(headers.front().hashPrevBlock);
+
+        if (block_iter == mapBlockIndex.end()) {
+            m_header_synced.insert(id);
+            return error("%s: headers from peer %d do not connect", __func__, id);
+        }
+
+        keep = std::numeric_limits<size_t>::max();
+        start_height = block_iter->second->nHeight;
+    }
+
+    std::vector<uint256> hashes;
+    hashes.reserve(headers.size());
+
+    for (size_t i = 0; i < headers.size(); ++i) {
+        const CBlockHeader& header = headers[i];
+        const uint256 hash = header.GetHash(true);
+        const int height = start_height + i + 1;
+
+        if (i > 0 && header.hashPrevBlock != hashes.back()) {
+            pfrom->Misbehaving(20);
+            return error("%s: non-continuous headers from peer %d", __func__, id);
+        }
+
+        if (header.GetBlockTime() > FutureDrift(GetAdjustedTime(), height)) {
+            pfrom->Misbehaving(20);
+            return error("%s: header %s too far in the future", __func__, hash.ToString());
+        }
+
+        if (!Checkpoints::CheckHardened(height, hash)) {
+            pfrom->Misbehaving(100);
+            return error("%s: header %s at height %d fails checkpoint", __func__, hash.ToString(), height);
+        }
+
+        hashes.push_back(hash);
+    }
+
+    // Only switch to headers that describe a longer chain than the one
+    // that we follow:
+    //
+    if (start_height + (int)hashes.size() <= TipHeight()) {
+        m_header_synced.insert(id);
+        return true;
+    }
+
+    if (keep == std::numeric_limits<size_t>::max()) {
+        Truncate(0);
+        m_base_hash = headers.front().hashPrevBlock;
+        m_base_height = start_height;
+    } else {
+        Truncate(keep);
+    }
+
+    // Drop the headers past the limit. The next request for headers starts
+    // from the last one kept:
+    const int max_height = nBestHeight + MAX_HEADERS_AHEAD;
+
+    for (const auto& hash : hashes) {
+        if (m_base_height + (int)m_headers.size() >= max_height) {
+            break;
+        }
+
+        if (!m_positions.emplace(hash, m_headers.size()).second) {
+            break; // Headers cannot repeat in a chain.
+        }
+
+        m_headers.emplace_back(hash, id);
+    }
+
+    m_header_source = id;
+
+    LogPrint(BCLog::LogFlags::NET, "%s: received %" PRIszu " headers from peer %d, header height %d",
+        __func__, headers.size(), id, TipHeight());
+
+    // A full reply means that the peer has more headers to send, unless the
+    // header chain already reached the height that the peer started with. A
+    // peer that keeps sending headers past it would grow the chain without
+    // end, and the blocks that it connects later arrive by inventory:
+    //
+    if (headers.size() < MAX_HEADERS_RESULTS || TipHeight() >= pfrom->nStartingHeight) {
+        m_header_synced.insert(id);
+    } else if (HasHeaderRoom()) {
+        RequestHeaders(pfrom);
+    }
+
+    // Otherwise, SendRequests() asks again when the blocks make room.
+
+    return true;
+}
+
+void BlockDownloadScheduler::BlockReceived(const uint256& hash, const bool accepted)
+{
+    AssertLockHeld(cs_main);
+
+    const auto position_iter = m_positions.find(hash);
+
+    if (position_iter == m_positions.end()) {
+        return;
+    }
+
+    ReleaseRequest(hash);
+
+    if (!accepted && !mapBlockIndex.count(hash) && !g_orphan_blocks.Contains(hash)) {
+        LogPrintf("%s: discarding headers from rejected block %s", __func__, hash.ToString());
+        DiscardFrom(position_iter->second);
+    }
+}
+
+void BlockDownloadScheduler::SendRequests(CNode* pto)
+{
+    AssertLockHeld(cs_main);
+
+    const NodeId id = pto->GetId();
+    const int64_t now = GetTime();
+
+    if (pto->fDisconnect) {
+        ReleasePeer(id);
+        return;
+    }
+
+    const auto penalty_iter = m_penalties.find(id);
+
+    if (penalty_iter != m_penalties.end()) {
+        pto->Misbehaving(penalty_iter->second);
+        m_penalties.erase(penalty_iter);
+    }
+
+    if (pto->fClient || pto->fOneShot) {
+        return;
+    }
+
+    if (m_header_peer != -1 && now - m_header_request_time > HEADERS_RESPONSE_TIMEOUT) {
+        LogPrint(BCLog::LogFlags::NET, "%s: peer %d did not send headers", __func__, m_header_peer);
+        m_header_synced.insert(m_header_peer);
+        m_header_peer = -1;
+    }
+
+    if (m_header_peer == -1
+        && !m_header_synced.count(id)
+        && AcceptsHeadersFrom(id)
+        && pto->nStartingHeight > TipHeight()
+        && HasHeaderRoom())
+    {
+        RequestHeaders(pto);
+    }
+
+    AdvanceWindow();
+    ExpireRequests(now);
+
+    size_t& requests = m_peer_requests[id];
+    std::vector<CInv> getdata;
+
+    const size_t window_end = std::min(m_headers.size(), m_next_missing + BLOCK_DOWNLOAD_WINDOW);
+
+    for (size_t i = m_next_missing;
+        i < window_end && requests < MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+        ++i)
+    {
+        const uint256& hash = m_headers[i].m_hash;
+
+        if (m_in_flight.count(hash)
+            || mapBlockIndex.count(hash)
+            || g_orphan_blocks.Contains(hash))
+        {
+            continue;
+        }
+
+        // Only ask peers that claim to have the block:
+        if (id != m_header_source && pto->nStartingHeight < m_base_height + (int)i + 1) {
+            break;
+        }
+
+        m_in_flight.emplace(hash, Request { id, now });
+        getdata.emplace_back(MSG_BLOCK, hash);
+        ++requests;
+    }
+
+    if (requests == 0) {
+        m_peer_requests.erase(id);
+    }
+
+    if (!getdata.empty()) {
+        LogPrint(BCLog::LogFlags::NET, "%s: requesting %" PRIszu " blocks from peer %d",
+            __func__, getdata.size(), id);
+
+        pto->PushMessage("getdata", getdata);
+    }
+}
+
+void BlockDownloadScheduler::ExpireRequests(const int64_t now)
+{
+    const uint256* stalling_hash = m_next_missing < m_headers.size()
+        ? &m_headers[m_next_missing].m_hash
+        : nullptr;
+
+    boost::optional<size_t> discard_position;
+
+    for (auto iter = m_in_flight.begin(); iter != m_in_flight.end();) {
+        const int64_t timeout = stalling_hash && iter->first == *stalling_hash
+            ? BLOCK_STALLING_TIMEOUT
+            : BLOCK_DOWNLOAD_TIMEOUT;
+
+        if (now - iter->second.m_time <= timeout) {
+            ++iter;
+            continue;
+        }
+
+        LogPrint(BCLog::LogFlags::NET, "%s: peer %d did not send block %s",
+            __func__, iter->second.m_node, iter->first.ToString());
+
+        const size_t position = m_positions.at(iter->first);
+
+        if (++m_headers[position].m_failures >= MAX_BLOCK_FAILURES
+            && (!discard_position || position < *discard_position))
+        {
+            discard_position = position;
+        }
+
+        DecrementPeer(iter->second.m_node);
+        iter = m_in_flight.erase(iter);
+    }
+
+    if (discard_position) {
+        LogPrintf("%s: no peer sends block %s; discarding headers",
+            __func__, m_headers[*discard_position].m_hash.ToString());
+
+        DiscardFrom(*discard_position);
+    }
+}
+
+void BlockDownloadScheduler::DiscardFrom(const size_t position)
+{
+    if (position < m_headers.size()) {
+        const NodeId source = m_headers[position].m_source;
+
+        LogPrint(BCLog::LogFlags::NET, "%s: ignoring headers from peer %d", __func__, source);
+
+        m_header_banned.insert(source);
+        m_penalties[source] += HEADER_SOURCE_PENALTY;
+
+        if (m_header_source == source) {
+            m_header_source = -1;
+        }
+    }
+
+    Truncate(position);
+
+    m_header_synced.clear();
+    m_header_peer = -1;
+}
+
+void BlockDownloadScheduler::Truncate(const size_t position)
+{
+    for (size_t i = position; i < m_headers.size(); ++i) {
+        ReleaseRequest(m_headers[i].m_hash);
+        m_positions.erase(m_headers[i].m_hash);
+    }
+
+    m_headers.resize(std::min(position, m_headers.size()), Header(uint256(), -1));
+    m_next_missing = std::min(m_next_missing, m_headers.size());
+}
+
+bool BlockDownloadScheduler::HasHeaderRoom() const
+{
+    return TipHeight() + (int)MAX_HEADERS_RESULTS <= nBestHeight + MAX_HEADERS_AHEAD;
+}
+
+void BlockDownloadScheduler::RequestHeaders(CNode* pto)
+{
+    // Build the locator like CBlockLocator::Set() does, but start from
+    // the headers that the block index does not contain yet:
+    //
+    std::vector<uint256> have;
+    const CBlockIndex* pindex = pindexBest;
+    size_t step = 1;
+
+    if (!m_headers.empty()) {
+        for (size_t i = m_headers.size(); i > 0; i = i > step ? i - step : 0) {
+            have.push_back(m_headers[i - 1].m_hash);
+
+            if (have.size() > 10) {
+                step *= 2;
+            }
+        }
+
+        const auto iter = mapBlockIndex.find(m_base_hash);
+        pindex = iter != mapBlockIndex.end() ? iter->second : pindexBest;
+    }
+
+    while (pindex) {
+        have.push_back(pindex->GetBlockHash());
+
+        for (size_t i = 0; pindex && i < step; ++i) {
+            pindex = pindex->pprev;
+        }
+
+        if (have.size() > 10) {
+            step *= 2;
+        }
+    }
+
+    have.push_back(!fTestNet ? hashGenesisBlock : hashGenesisBlockTestNet);
+
+    m_header_peer = pto->GetId();
+    m_header_request_time = GetTime();
+
+    LogPrint(BCLog::LogFlags::NET, "%s: requesting headers from peer %d at height %d",
+        __func__, m_header_peer, TipHeight());
+
+    pto->PushMessage("getheaders", CBlockLocator(have), uint256());
+}
+
+void BlockDownloadScheduler::AdvanceWindow()
+{
+    while (m_next_missing < m_headers.size()
+        && mapBlockIndex.count(m_headers[m_next_missing].m_hash))
+    {
+        ++m_next_missing;
+    }
+
+    if (!m_headers.empty() && m_next_missing == m_headers.size()) {
+        LogPrint(BCLog::LogFlags::NET, "%s: downloaded blocks to header height %d",
+            __func__, m_base_height + (int)m_headers.size());
+
+        m_base_hash = m_headers.back().m_hash;
+        m_base_height += m_headers.size();
+        Truncate(0);
+    }
+}
+
+void BlockDownloadScheduler::ReleaseRequest(const uint256& hash)
+{
+    const auto iter = m_in_flight.find(hash);
+
+    if (iter != m_in_flight.end()) {
+        DecrementPeer(iter->second.m_node);
+        m_in_flight.erase(iter);
+    }
+}
+
+void BlockDownloadScheduler::ReleasePeer(const NodeId id)
+{
+    for (auto iter = m_in_flight.begin(); iter != m_in_flight.end();) {
+        if (iter->second.m_node == id) {
+            iter = m_in_flight.erase(iter);
+        } else {
+            ++iter;
+        }
+    }
+
+    m_peer_requests.erase(id);
+    m_header_synced.erase(id);
+    m_header_banned.erase(id);
+    m_penalties.erase(id);
+
+    if (m_header_peer == id) {
+        m_header_peer = -1;
+    }
+}
+
+void BlockDownloadScheduler::DecrementPeer(const NodeId id)
+{
+    const auto iter = m_peer_requests.find(id);
+
+    if (iter != m_peer_requests.end() && --iter->second == 0) {
+        m_peer_requests.erase(iter);
+    }
+}
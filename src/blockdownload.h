@@ -0,0 +1,283 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKDOWNLOAD_H
+#define BITCOIN_BLOCKDOWNLOAD_H
+
+#include "main.h"
+#include "net.h"
+
+#include <map>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+//!
+//! \brief Schedules the headers-first synchronization of the block chain.
+//!
+//! The node downloads the chain of block headers from one peer at a time
+//! and then requests the blocks that the headers describe from every peer
+//! that can provide them. Requests stay within a window that starts at the
+//! first block that the node does not have yet, so the blocks that arrive
+//! out of order and wait as orphans remain bounded. A request that a peer
+//! fails to deliver in time moves to another peer.
+//!
+//! Proof-of-stake headers cannot be validated without the coinstake of the
+//! block, so the scheduler only checks that the headers link together and
+//! match the checkpoints. The header chain extends at most MAX_HEADERS_AHEAD
+//! blocks past the best block. A block that fails validation, or one that no
+//! peer delivers, discards the headers from that block onward, and the node
+//! ignores further headers from the peer that sent them.
+//!
+//! The caller must hold cs_main for every method.
+//!
+class BlockDownloadScheduler
+{
+public:
+    //!
+    //! \brief Maximum number of headers sent in reply to "getheaders".
+    //!
+    static constexpr size_t MAX_HEADERS_RESULTS = 1000;
+
+    //!
+    //! \brief Number of blocks after the first missing block to request.
+    //!
+    static constexpr size_t BLOCK_DOWNLOAD_WINDOW = 1024;
+
+    //!
+    //! \brief Maximum number of block requests in flight to one peer.
+    //!
+    static constexpr size_t MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+
+    //!
+    //! \brief Maximum number of headers past the best block in the header
+    //! chain.
+    //!
+    //! The headers cannot be validated without their blocks, so this bounds
+    //! the memory that a peer can fill with a long chain. The node asks for
+    //! more headers as the blocks connect.
+    //!
+    static constexpr int MAX_HEADERS_AHEAD = 50000;
+
+    //!
+    //! \brief Seconds to wait for a reply to "getheaders".
+    //!
+    static constexpr int64_t HEADERS_RESPONSE_TIMEOUT = 30;
+
+    //!
+    //! \brief Seconds to wait for a requested block.
+    //!
+    static constexpr int64_t BLOCK_DOWNLOAD_TIMEOUT = 60;
+
+    //!
+    //! \brief Seconds to wait for the first missing block in the window.
+    //!
+    //! Every other block in the window waits for this one to connect, so the
+    //! request moves to another peer sooner.
+    //!
+    static constexpr int64_t BLOCK_STALLING_TIMEOUT = 10;
+
+    //!
+    //! \brief Number of failed requests for a block that discard its header.
+    //!
+    static constexpr int MAX_BLOCK_FAILURES = 3;
+
+    //!
+    //! \brief Misbehavior score of a peer that sent discarded headers.
+    //!
+    static constexpr int HEADER_SOURCE_PENALTY = 20;
+
+    BlockDownloadScheduler();
+
+    //!
+    //! \brief Determine whether the synchronization still has work to do.
+    //!
+    bool IsActive() const
+    {
+        return !m_headers.empty() || m_header_peer != -1;
+    }
+
+    //!
+    //! \brief Determine whether the scheduler downloads the specified block.
+    //!
+    bool IsScheduled(const uint256& hash) const
+    {
+        return m_positions.count(hash) > 0;
+    }
+
+    //!
+    //! \brief Determine whether a block comes before another one, or is the
+    //! same block, in the header chain.
+    //!
+    //! \param hash       Hash of the block to check.
+    //! \param descendant Hash of the later block.
+    //!
+    bool IsAncestorOf(const uint256& hash, const uint256& descendant) const;
+
+    //!
+    //! \brief Determine whether the node accepts headers from a peer.
+    //!
+    //! \return \c false when the peer sent headers that were discarded.
+    //!
+    bool AcceptsHeadersFrom(const NodeId id) const
+    {
+        return m_header_banned.count(id) == 0;
+    }
+
+    //!
+    //! \brief Get the number of headers after the base block.
+    //!
+    size_t HeaderCount() const
+    {
+        return m_headers.size();
+    }
+
+    //!
+    //! \brief Get the number of block requests in flight.
+    //!
+    size_t RequestCount() const
+    {
+        return m_in_flight.size();
+    }
+
+    //!
+    //! \brief Get the height of the chain that the headers describe.
+    //!
+    int TipHeight() const;
+
+    //!
+    //! \brief Add headers received from a peer to the header chain.
+    //!
+    //! \param pfrom   Peer that sent the headers.
+    //! \param headers Headers from the "headers" message.
+    //!
+    //! \return \c false when the headers are invalid.
+    //!
+    bool ReceiveHeaders(CNode* pfrom, const std::vector<CBlockHeader>& headers);
+
+    //!
+    //! \brief Release the request for a block that a peer delivered.
+    //!
+    //! Call this after processing the block. A scheduled block that failed
+    //! validation makes the headers from that block onward describe an
+    //! invalid chain. A block that the orphan pool evicted stays scheduled.
+    //!
+    //! \param hash     Hash of the block received.
+    //! \param accepted Whether the block passed ProcessBlock().
+    //!
+    void BlockReceived(const uint256& hash, const bool accepted);
+
+    //!
+    //! \brief Send the headers and block requests due for a peer.
+    //!
+    //! \param pto Peer to send the requests to.
+    //!
+    void SendRequests(CNode* pto);
+
+    //!
+    //! \brief Move the requests that peers failed to deliver in time.
+    //!
+    //! A block that times out MAX_BLOCK_FAILURES times discards the headers
+    //! from that block onward.
+    //!
+    //! \param now Current time in seconds.
+    //!
+    void ExpireRequests(const int64_t now);
+
+    //!
+    //! \brief Drop the headers from an invalid block onward and get the
+    //! headers again from peers other than the one that sent them.
+    //!
+    //! The peer that sent the header at \p position receives a misbehavior
+    //! penalty with its next requests, and the node stops taking headers
+    //! from it.
+    //!
+    //! \param position Offset of the first header to drop.
+    //!
+    void DiscardFrom(const size_t position);
+
+    //!
+    //! \brief Remove the headers from the specified offset onward.
+    //!
+    //! \param position Offset of the first header to remove.
+    //!
+    void Truncate(const size_t position);
+
+private:
+    //!
+    //! \brief A header in the chain to download.
+    //!
+    struct Header
+    {
+        Header(const uint256& hash, const NodeId source)
+            : m_hash(hash), m_source(source), m_failures(0)
+        {
+        }
+
+        uint256 m_hash;  //!< Hash of the block.
+        NodeId m_source; //!< Peer that sent the header.
+        int m_failures;  //!< Number of requests for the block that timed out.
+    };
+
+    //!
+    //! \brief A block request in flight.
+    //!
+    struct Request
+    {
+        NodeId m_node; //!< Peer asked for the block.
+        int64_t m_time; //!< Time of the request in seconds.
+    };
+
+    uint256 m_base_hash;                       //!< Block that the headers extend.
+    int m_base_height;                         //!< Height of the base block.
+    std::vector<Header> m_headers;             //!< Headers after the base block.
+    std::map<uint256, size_t> m_positions;     //!< Offsets of the headers by hash.
+    size_t m_next_missing;                     //!< Offset of the first missing block.
+    std::map<uint256, Request> m_in_flight;    //!< Block requests by block hash.
+    std::map<NodeId, size_t> m_peer_requests;  //!< Number of requests by peer.
+    NodeId m_header_peer;                      //!< Peer asked for headers, if any.
+    int64_t m_header_request_time;             //!< Time of the headers request.
+    NodeId m_header_source;                    //!< Peer that sent the last headers.
+    std::set<NodeId> m_header_synced;          //!< Peers with no more headers for us.
+    std::set<NodeId> m_header_banned;          //!< Peers that sent discarded headers.
+    std::map<NodeId, int> m_penalties;         //!< Misbehavior scores to apply by peer.
+
+    //!
+    //! \brief Determine whether the header chain has room for a full
+    //! "headers" reply.
+    //!
+    bool HasHeaderRoom() const;
+
+    //!
+    //! \brief Ask a peer for the headers after the tip of the header chain.
+    //!
+    void RequestHeaders(CNode* pto);
+
+    //!
+    //! \brief Move the start of the window past the blocks that we have.
+    //!
+    void AdvanceWindow();
+
+    //!
+    //! \brief Remove the request in flight for a block.
+    //!
+    void ReleaseRequest(const uint256& hash);
+
+    //!
+    //! \brief Remove the requests in flight to a peer that disconnects.
+    //!
+    void ReleasePeer(const NodeId id);
+
+    //!
+    //! \brief Decrease the number of requests in flight to a peer.
+    //!
+    void DecrementPeer(const NodeId id);
+}; // BlockDownloadScheduler
+
+//!
+//! \brief Schedules the headers-first download. Guarded by cs_main.
+//!
+extern BlockDownloadScheduler g_block_download;
+
+#endif // BITCOIN_BLOCKDOWNLOAD_H
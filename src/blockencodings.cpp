@@ -0,0 +1,165 @@
+// Copyright (c) 2016-2018 The Bitcoin Core developers
+// Copyright (c) 2020 The Gridcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockencodings.h"
+#include "crypto/siphash.h"
+#include "hash.h"
+#include "sync.h"
+#include "util.h"
+
+#include <unordered_map>
+
+constexpr int CBlockHeaderAndShortTxIDs::SHORTTXIDS_LENGTH; // for clang
+
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block)
+    : nonce(GetRand(std::numeric_limits<uint64_t>::max()))
+    , header(block.GetBlockHeader())
+    , vchBlockSig(block.vchBlockSig)
+{
+    FillShortTxIDSelector();
+
+    // No memory pool contains the coinbase or the coinstake:
+    const size_t prefilled = block.IsProofOfStake() ? 2 : 1;
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        if (i < prefilled) {
+            prefilledtxn.push_back({ static_cast<uint16_t>(i), block.vtx[i] });
+        } else {
+            shorttxids.push_back(GetShortID(block.vtx[i].GetHash()));
+        }
+    }
+}
+
+void CBlockHeaderAndShortTxIDs::FillShortTxIDSelector() const
+{
+    const uint256 hash = (CHashWriter(SER_NETWORK, PROTOCOL_VERSION) << header << nonce).GetHash();
+
+    shorttxidk0 = hash.GetUint64(0);
+    shorttxidk1 = hash.GetUint64(1);
+}
+
+uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const
+{
+    static_assert(SHORTTXIDS_LENGTH == 6, "shorttxids calculation assumes 6-byte shorttxids");
+
+    return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
+}
+
+ReadStatus PartiallyDownloadedBlock::InitData(
+    const CBlockHeaderAndShortTxIDs& cmpctblock,
+    const CTxMemPool& pool)
+{
+    if (cmpctblock.header.IsNull()
+        || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
+    {
+        return ReadStatus::INVALID;
+    }
+
+    if (cmpctblock.BlockTxCount() > MAX_BLOCK_SIZE / ::GetSerializeSize(CTransaction(), SER_NETWORK, PROTOCOL_VERSION)) {
+        return ReadStatus::INVALID;
+    }
+
+    m_header = cmpctblock.header;
+    m_block_sig = cmpctblock.vchBlockSig;
+    m_txn.assign(cmpctblock.BlockTxCount(), CTransaction());
+    m_available.assign(cmpctblock.BlockTxCount(), false);
+
+    for (const auto& prefilled : cmpctblock.prefilledtxn) {
+        if (prefilled.index >= m_txn.size() || m_available[prefilled.index]) {
+            return ReadStatus::INVALID;
+        }
+
+        m_txn[prefilled.index] = prefilled.tx;
+        m_available[prefilled.index] = true;
+    }
+
+    // Map each short ID to the position of its transaction in the block:
+    std::unordered_map<uint64_t, uint16_t> positions;
+    positions.reserve(cmpctblock.shorttxids.size());
+
+    size_t shortid_index = 0;
+
+    for (size_t i = 0; i < m_txn.size(); ++i) {
+        if (m_available[i]) {
+            continue;
+        }
+
+        if (!positions.emplace(cmpctblock.shorttxids[shortid_index++], i).second) {
+            // Two transactions in the block share a short ID. The block is
+            // valid in this case, but request it in full:
+            return ReadStatus::FAILED;
+        }
+    }
+
+    LOCK(pool.cs);
+
+    for (const auto& entry : pool.mapTx) {
+        const auto iter = positions.find(cmpctblock.GetShortID(entry.first));
+
+        if (iter == positions.end()) {
+            continue;
+        }
+
+        if (m_available[iter->second]) {
+            // Two memory pool transactions share the short ID:
+            return ReadStatus::FAILED;
+        }
+
+        m_txn[iter->second] = entry.second;
+        m_available[iter->second] = true;
+    }
+
+    return ReadStatus::OK;
+}
+
+std::vector<uint16_t> PartiallyDownloadedBlock::GetMissing() const
+{
+    std::vector<uint16_t> missing;
+
+    for (size_t i = 0; i < m_available.size(); ++i) {
+        if (!m_available[i]) {
+            missing.push_back(i);
+        }
+    }
+
+    return missing;
+}
+
+ReadStatus PartiallyDownloadedBlock::FillBlock(
+    CBlock& block,
+    const std::vector<CTransaction>& vtx_missing) const
+{
+    if (m_header.IsNull()) {
+        return ReadStatus::INVALID;
+    }
+
+    block = CBlock(m_header);
+    block.vchBlockSig = m_block_sig;
+    block.vtx.reserve(m_txn.size());
+
+    size_t missing_index = 0;
+
+    for (size_t i = 0; i < m_txn.size(); ++i) {
+        if (m_available[i]) {
+            block.vtx.push_back(m_txn[i]);
+        } else if (missing_index < vtx_missing.size()) {
+            block.vtx.push_back(vtx_missing[missing_index++]);
+        } else {
+            return ReadStatus::INVALID;
+        }
+    }
+
+    if (missing_index != vtx_missing.size()) {
+        return ReadStatus::INVALID;
+    }
+
+    // A short ID collision with an unrelated memory pool transaction yields
+    // a block that does not match its merkle root:
+    if (block.BuildMerkleTree() != block.hashMerkleRoot) {
+        return ReadStatus::FAILED;
+    }
+
+    return ReadStatus::OK;
+}
@@ -0,0 +1,240 @@
+// Copyright (c) 2016-2018 The Bitcoin Core developers
+// Copyright (c) 2020 The Gridcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKENCODINGS_H
+#define BITCOIN_BLOCKENCODINGS_H
+
+#include "main.h"
+
+#include <ios>
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+class CTxMemPool;
+
+/**
+ * Serialize a vector of transaction indexes as the differences between
+ * consecutive indexes like BIP 152 does.
+ */
+template <typename Stream>
+void SerializeDifferentialIndexes(Stream& s, const std::vector<uint16_t>& indexes)
+{
+    WriteCompactSize(s, indexes.size());
+
+    for (size_t i = 0; i < indexes.size(); ++i) {
+        WriteCompactSize(s, i == 0 ? indexes[i] : indexes[i] - indexes[i - 1] - 1);
+    }
+}
+
+template <typename Stream>
+void UnserializeDifferentialIndexes(Stream& s, std::vector<uint16_t>& indexes)
+{
+    const uint64_t count = ReadCompactSize(s);
+
+    if (count > std::numeric_limits<uint16_t>::max()) {
+        throw std::ios_base::failure("too many indexes");
+    }
+
+    indexes.clear();
+    indexes.reserve(count);
+
+    for (uint64_t i = 0; i < count; ++i) {
+        uint64_t index = ReadCompactSize(s);
+
+        if (i > 0) {
+            index += indexes.back() + 1;
+        }
+
+        if (index > std::numeric_limits<uint16_t>::max()) {
+            throw std::ios_base::failure("index overflowed 16 bits");
+        }
+
+        indexes.push_back(index);
+    }
+}
+
+/** Request for the transactions of a block that a compact block left out. */
+class BlockTransactionsRequest
+{
+public:
+    uint256 blockhash;
+    std::vector<uint16_t> indexes;
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << blockhash;
+        SerializeDifferentialIndexes(s, indexes);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> blockhash;
+        UnserializeDifferentialIndexes(s, indexes);
+    }
+};
+
+/** Transactions of a block sent in reply to a BlockTransactionsRequest. */
+class BlockTransactions
+{
+public:
+    uint256 blockhash;
+    std::vector<CTransaction> txn;
+
+    BlockTransactions() { }
+    explicit BlockTransactions(const BlockTransactionsRequest& req) : blockhash(req.blockhash) { }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(blockhash);
+        READWRITE(txn);
+    }
+};
+
+/** A transaction sent in full with a compact block. */
+struct PrefilledTransaction
+{
+    uint16_t index; //!< Position of the transaction in the block.
+    CTransaction tx;
+};
+
+/**
+ * A block that replaces each transaction that the receiver likely holds in
+ * its memory pool with a short ID. It sends the coinbase and coinstake in
+ * full because no memory pool contains them.
+ */
+class CBlockHeaderAndShortTxIDs
+{
+private:
+    mutable uint64_t shorttxidk0, shorttxidk1;
+    uint64_t nonce;
+
+    void FillShortTxIDSelector() const;
+
+public:
+    static constexpr int SHORTTXIDS_LENGTH = 6;
+
+    CBlockHeader header;
+    std::vector<unsigned char> vchBlockSig;
+    std::vector<uint64_t> shorttxids;
+    std::vector<PrefilledTransaction> prefilledtxn;
+
+    CBlockHeaderAndShortTxIDs() : shorttxidk0(0), shorttxidk1(0), nonce(0) { }
+
+    //! Build the compact form of a block.
+    explicit CBlockHeaderAndShortTxIDs(const CBlock& block);
+
+    //! Get the short ID of a transaction for this block.
+    uint64_t GetShortID(const uint256& txhash) const;
+
+    size_t BlockTxCount() const { return shorttxids.size() + prefilledtxn.size(); }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << header << nonce;
+
+        WriteCompactSize(s, shorttxids.size());
+
+        for (const uint64_t id : shorttxids) {
+            ser_writedata32(s, id & 0xffffffff);
+            ser_writedata16(s, (id >> 32) & 0xffff);
+        }
+
+        std::vector<uint16_t> indexes;
+        indexes.reserve(prefilledtxn.size());
+
+        for (const auto& prefilled : prefilledtxn) {
+            indexes.push_back(prefilled.index);
+        }
+
+        SerializeDifferentialIndexes(s, indexes);
+
+        for (const auto& prefilled : prefilledtxn) {
+            s << prefilled.tx;
+        }
+
+        s << vchBlockSig;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> header >> nonce;
+
+        const uint64_t count = ReadCompactSize(s);
+
+        if (count > std::numeric_limits<uint16_t>::max()) {
+            throw std::ios_base::failure("too many short IDs");
+        }
+
+        shorttxids.resize(count);
+
+        for (auto& id : shorttxids) {
+            const uint64_t lsb = ser_readdata32(s);
+            const uint64_t msb = ser_readdata16(s);
+            id = (msb << 32) | lsb;
+        }
+
+        std::vector<uint16_t> indexes;
+        UnserializeDifferentialIndexes(s, indexes);
+
+        prefilledtxn.resize(indexes.size());
+
+        for (size_t i = 0; i < indexes.size(); ++i) {
+            prefilledtxn[i].index = indexes[i];
+            s >> prefilledtxn[i].tx;
+        }
+
+        s >> vchBlockSig;
+
+        if (BlockTxCount() > std::numeric_limits<uint16_t>::max()) {
+            throw std::ios_base::failure("indexes overflowed 16 bits");
+        }
+
+        FillShortTxIDSelector();
+    }
+};
+
+enum class ReadStatus
+{
+    OK,
+    INVALID, //!< Invalid object, peer is sending bogus data.
+    FAILED,  //!< Failed to reconstruct, for example from short ID collisions.
+};
+
+/**
+ * Reconstructs a block from a compact block and the transactions of the
+ * memory pool.
+ */
+class PartiallyDownloadedBlock
+{
+public:
+    //! Fill the transactions from the compact block and the memory pool.
+    ReadStatus InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const CTxMemPool& pool);
+
+    //! Get the positions of the transactions still missing.
+    std::vector<uint16_t> GetMissing() const;
+
+    //! Build the block from the transactions found and the missing ones.
+    //!
+    //! \param block       Receives the reconstructed block.
+    //! \param vtx_missing Transactions in the order of GetMissing().
+    //!
+    ReadStatus FillBlock(CBlock& block, const std::vector<CTransaction>& vtx_missing) const;
+
+private:
+    CBlockHeader m_header;
+    std::vector<unsigned char> m_block_sig;
+    std::vector<CTransaction> m_txn;
+    std::vector<bool> m_available;
+};
+
+#endif // BITCOIN_BLOCKENCODINGS_H
@@ -0,0 +1,82 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockstats.h"
+#include "main.h"
+#include "txdb.h"
+#include "gridcoin/support/block_prefetcher.h"
+
+constexpr uint32_t CBlockStats::CURRENT_VERSION; // for clang
+
+CBlockStats::CBlockStats()
+    : nRecordVersion(CURRENT_VERSION)
+    , nBlockVersion(0)
+    , nTxCount(0)
+    , nSize(0)
+    , fCoinStake(false)
+    , fSuperblock(false)
+    , nResearchSubsidy(0)
+    , nBlockSubsidy(0)
+{
+}
+
+CBlockStats::CBlockStats(const CBlock& block)
+    : nRecordVersion(CURRENT_VERSION)
+    , nBlockVersion(block.nVersion)
+    , nTxCount(block.vtx.size())
+    , nSize(::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION))
+    , fCoinStake(block.vtx.size() >= 2 && block.vtx[1].IsCoinStake())
+{
+    const GRC::Claim& claim = block.GetClaim();
+
+    fSuperblock = claim.ContainsSuperblock();
+    nResearchSubsidy = claim.m_research_subsidy;
+    nBlockSubsidy = claim.m_block_subsidy;
+    m_mining_id = claim.m_mining_id;
+    m_organization = claim.m_organization;
+    m_client_version = claim.m_client_version;
+    m_quorum_hash = claim.m_quorum_hash;
+}
+
+bool LoadBlockStats(const std::vector<const CBlockIndex*>& blocks, std::vector<CBlockStats>& stats)
+{
+    stats.assign(blocks.size(), CBlockStats());
+
+    std::vector<size_t> missing;
+
+    {
+        CTxDB txdb("r");
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            if (!txdb.ReadBlockStats(blocks[i]->GetBlockHash(), stats[i])) {
+                missing.push_back(i);
+            }
+        }
+    }
+
+    if (missing.empty()) {
+        return true;
+    }
+
+    std::vector<const CBlockIndex*> to_read;
+    to_read.reserve(missing.size());
+
+    for (const size_t i : missing) {
+        to_read.push_back(blocks[i]);
+    }
+
+    GRC::BlockPrefetcher prefetcher(std::move(to_read));
+
+    for (const size_t i : missing) {
+        CBlock block;
+
+        if (!prefetcher.Take(block)) {
+            return false;
+        }
+
+        stats[i] = CBlockStats(block);
+    }
+
+    return true;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKSTATS_H
+#define BITCOIN_BLOCKSTATS_H
+
+#include "gridcoin/claim.h"
+#include "serialize.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+
+//!
+//! \brief Summary of a block for the chain statistics RPCs.
+//!
+//! With -blockstatsindex, ConnectBlock() stores one record for each block in
+//! txleveldb. The statistics RPCs aggregate these records instead of reading
+//! every block in the range from disk. The block index already holds the
+//! remaining values that they report, like the mint and the difficulty.
+//!
+class CBlockStats
+{
+public:
+    //! Version of the record format.
+    static constexpr uint32_t CURRENT_VERSION = 1;
+
+    uint32_t nRecordVersion;     //!< Version of the record format.
+    int32_t nBlockVersion;       //!< Version of the block.
+    uint32_t nTxCount;           //!< Number of transactions including the coinbase.
+    uint32_t nSize;              //!< Serialized size of the block.
+    bool fCoinStake;             //!< Whether the block contains a coinstake.
+    bool fSuperblock;            //!< Whether the claim contains a superblock.
+    int64_t nResearchSubsidy;    //!< Research reward claimed by the block.
+    int64_t nBlockSubsidy;       //!< Constant block reward or interest claimed.
+    GRC::MiningId m_mining_id;   //!< CPID of the staker or investor.
+    std::string m_organization;  //!< Organization named in the claim.
+    std::string m_client_version; //!< Client version named in the claim.
+    GRC::QuorumHash m_quorum_hash; //!< Superblock hash voted for by the claim.
+
+    //!
+    //! \brief Initialize an empty record.
+    //!
+    CBlockStats();
+
+    //!
+    //! \brief Summarize a block.
+    //!
+    explicit CBlockStats(const CBlock& block);
+
+    //!
+    //! \brief Determine whether the staker claimed a research reward.
+    //!
+    bool HasResearchReward() const
+    {
+        return m_mining_id.Which() == GRC::MiningId::Kind::CPID;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(VARINT(nRecordVersion));
+        READWRITE(nBlockVersion);
+        READWRITE(VARINT(nTxCount));
+        READWRITE(VARINT(nSize));
+        READWRITE(fCoinStake);
+        READWRITE(fSuperblock);
+        READWRITE(VARINT(nResearchSubsidy, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(VARINT(nBlockSubsidy, VarIntMode::NONNEGATIVE_SIGNED));
+        READWRITE(m_mining_id);
+        READWRITE(LIMITED_STRING(m_organization, GRC::Claim::MAX_ORGANIZATION_SIZE));
+        READWRITE(LIMITED_STRING(m_client_version, GRC::Claim::MAX_VERSION_SIZE));
+        READWRITE(m_quorum_hash);
+    }
+};
+
+//!
+//! \brief Load the statistics records of a series of blocks.
+//!
+//! Blocks connected before the node enabled -blockstatsindex have no record.
+//! The function reads these blocks from disk to summarize them.
+//!
+//! \param blocks Index entries of the blocks to load the records for.
+//! \param stats  Receives one record for each block in the same order.
+//!
+//! \return \c false if a block without a record failed to load.
+//!
+bool LoadBlockStats(const std::vector<const CBlockIndex*>& blocks, std::vector<CBlockStats>& stats);
+
+#endif // BITCOIN_BLOCKSTATS_H
@@ -0,0 +1,146 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bloom.h"
+#include "crypto/siphash.h"
+#include "protocol.h"
+#include "util.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// A replacement for x % n that assumes that x is a uniformly distributed 32
+// bit value, as the output of a good hash is.
+inline uint32_t FastMod(uint32_t x, size_t n)
+{
+    return ((uint64_t)x * (uint64_t)n) >> 32;
+}
+} // anonymous namespace
+
+CRollingBloomFilter::CRollingBloomFilter(unsigned int nElements, double fpRate)
+{
+    const double logFpRate = log(fpRate);
+
+    // The optimal number of hash functions is log(fpRate) / log(0.5). Keep
+    // it in the range 1-50:
+    nHashFuncs = std::max(1, std::min((int)round(logFpRate / log(0.5)), 50));
+
+    // The filter stores between 2 and 3 generations of nElements / 2 items:
+    nEntriesPerGeneration = (nElements + 1) / 2;
+    const uint32_t nMaxElements = nEntriesPerGeneration * 3;
+
+    // Solve fpRate = (1 - exp(-nHashFuncs * nMaxElements / nFilterBits)) ^ nHashFuncs
+    // for the number of positions:
+    const uint32_t nFilterBits = (uint32_t)ceil(
+        -1.0 * nHashFuncs * nMaxElements / log(1.0 - exp(logFpRate / nHashFuncs)));
+
+    data.resize(((nFilterBits + 63) / 64) << 1);
+    reset();
+}
+
+uint64_t CRollingBloomFilter::Hash(const unsigned char* bytes, size_t size) const
+{
+    return CSipHasher(k0, k1).Write(bytes, size).Finalize();
+}
+
+void CRollingBloomFilter::insert(const unsigned char* bytes, size_t size)
+{
+    Insert(Hash(bytes, size));
+}
+
+void CRollingBloomFilter::insert(const uint256& hash)
+{
+    Insert(SipHashUint256(k0, k1, hash));
+}
+
+void CRollingBloomFilter::insert(const CInv& inv)
+{
+    Insert(CSipHasher(k0, k1).Write((uint64_t)inv.type).Write(inv.hash.begin(), inv.hash.size()).Finalize());
+}
+
+bool CRollingBloomFilter::contains(const unsigned char* bytes, size_t size) const
+{
+    return Contains(Hash(bytes, size));
+}
+
+bool CRollingBloomFilter::contains(const uint256& hash) const
+{
+    return Contains(SipHashUint256(k0, k1, hash));
+}
+
+bool CRollingBloomFilter::contains(const CInv& inv) const
+{
+    return Contains(CSipHasher(k0, k1).Write((uint64_t)inv.type).Write(inv.hash.begin(), inv.hash.size()).Finalize());
+}
+
+void CRollingBloomFilter::Insert(uint64_t hash)
+{
+    if (nEntriesThisGeneration == nEntriesPerGeneration)
+    {
+        nEntriesThisGeneration = 0;
+        nGeneration++;
+        if (nGeneration == 4)
+            nGeneration = 1;
+
+        // Wipe the positions last set by the generation that this one reuses:
+        const uint64_t nGenerationMask1 = 0 - (uint64_t)(nGeneration & 1);
+        const uint64_t nGenerationMask2 = 0 - (uint64_t)(nGeneration >> 1);
+
+        for (size_t p = 0; p < data.size(); p += 2)
+        {
+            const uint64_t p1 = data[p];
+            const uint64_t p2 = data[p + 1];
+            const uint64_t mask = (p1 ^ nGenerationMask1) | (p2 ^ nGenerationMask2);
+            data[p] = p1 & mask;
+            data[p + 1] = p2 & mask;
+        }
+    }
+    nEntriesThisGeneration++;
+
+    // Derive the positions from the two halves of one SipHash instead of
+    // hashing the item once for each function:
+    const uint32_t h1 = (uint32_t)hash;
+    const uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+
+    for (int n = 0; n < nHashFuncs; n++)
+    {
+        const uint32_t h = h1 + n * h2;
+        const int bit = h & 0x3F;
+        // FastMod() uses the upper bits of h, so the lower bits may pick the bit.
+        const uint32_t pos = FastMod(h, data.size());
+        // The lowest bit of pos selects the word in the pair, so ignore it:
+        data[pos & ~1U] = (data[pos & ~1U] & ~(uint64_t{1} << bit)) | (uint64_t)(nGeneration & 1) << bit;
+        data[pos | 1] = (data[pos | 1] & ~(uint64_t{1} << bit)) | (uint64_t)(nGeneration >> 1) << bit;
+    }
+}
+
+bool CRollingBloomFilter::Contains(uint64_t hash) const
+{
+    const uint32_t h1 = (uint32_t)hash;
+    const uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+
+    for (int n = 0; n < nHashFuncs; n++)
+    {
+        const uint32_t h = h1 + n * h2;
+        const int bit = h & 0x3F;
+        const uint32_t pos = FastMod(h, data.size());
+
+        // A position is set if either word of the pair has the bit:
+        if (!(((data[pos & ~1U] | data[pos | 1]) >> bit) & 1))
+            return false;
+    }
+
+    return true;
+}
+
+void CRollingBloomFilter::reset()
+{
+    k0 = GetRand(std::numeric_limits<uint64_t>::max());
+    k1 = GetRand(std::numeric_limits<uint64_t>::max());
+    nEntriesThisGeneration = 0;
+    nGeneration = 1;
+    std::fill(data.begin(), data.end(), 0);
+}
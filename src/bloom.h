@@ -0,0 +1,63 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOOM_H
+#define BITCOIN_BLOOM_H
+
+#include "uint256.h"
+
+#include <stdint.h>
+#include <vector>
+
+class CInv;
+
+/** A probabilistic set that remembers about the most recent nElements items
+ *  inserted. It forgets older items in generations of nElements / 2, so it
+ *  always recalls at least the last nElements / 2 items and at most the last
+ *  nElements * 3 / 2. contains() returns false for an item inserted since
+ *  the last reset() only if the item aged out. It returns true for an item
+ *  never inserted with about the fpRate probability.
+ *
+ *  The memory use depends only on nElements and fpRate: two bits for each
+ *  position of the filter, with no allocation per item. Each instance hashes
+ *  with its own random key, so peers cannot pick items that collide.
+ */
+class CRollingBloomFilter
+{
+public:
+    CRollingBloomFilter(unsigned int nElements, double fpRate);
+
+    void insert(const unsigned char* data, size_t size);
+    void insert(const uint256& hash);
+    void insert(const CInv& inv);
+
+    bool contains(const unsigned char* data, size_t size) const;
+    bool contains(const uint256& hash) const;
+    bool contains(const CInv& inv) const;
+
+    /** Forget every item and pick a new hash key. */
+    void reset();
+
+    /** @return the number of bytes that hold the filter. */
+    size_t DynamicMemoryUsage() const { return data.capacity() * sizeof(uint64_t); }
+
+private:
+    int nEntriesPerGeneration;
+    int nEntriesThisGeneration;
+    int nGeneration;
+    int nHashFuncs;
+    uint64_t k0;
+    uint64_t k1;
+
+    // Position P of the filter is bit (P & 63) of both data[(P >> 6) * 2]
+    // and data[(P >> 6) * 2 + 1]. The two bits hold the generation (1 to 3)
+    // that last set the position, or 0 if no live generation set it.
+    std::vector<uint64_t> data;
+
+    uint64_t Hash(const unsigned char* data, size_t size) const;
+    void Insert(uint64_t hash);
+    bool Contains(uint64_t hash) const;
+};
+
+#endif // BITCOIN_BLOOM_H
@@ -63,6 +63,8 @@ public:
         consensus.BlockV9TallyHeight = 1144120;
         consensus.BlockV10Height = 1420000;
         consensus.BlockV11Height = 2053000;
+        // The last checkpoint. Update it with the checkpoints for each release:
+        consensus.defaultAssumeValid = uint256S("0xfa1342b4076ca65be64abd7f9cea50cbbdb6247a6937f1f02d6e76494aab20bf");
         /**
          * The message start string is designed to be unlikely to occur in normal data.
          * The characters are rarely used upper ASCII, not valid as UTF-8, and produce
@@ -144,6 +146,7 @@ public:
         consensus.BlockV9TallyHeight = 399120;
         consensus.BlockV10Height = 629409;
         consensus.BlockV11Height = 1301500;
+        consensus.defaultAssumeValid = uint256();
 
         pchMessageStart[0] = 0xcd;
         pchMessageStart[1] = 0xf2;
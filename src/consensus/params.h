@@ -29,5 +29,7 @@ struct Params {
     int BlockV10Height;
     /** Block height at which v11 blocks are created */
     int BlockV11Height;
+    /** Default -assumevalid block. Its ancestors skip script checks. */
+    uint256 defaultAssumeValid;
 };
 } // namespace Consensus
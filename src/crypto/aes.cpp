@@ -8,37 +8,101 @@
 #include <assert.h>
 #include <string.h>
 
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL) && defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define AES_HAVE_AESNI 1
+#include <cpuid.h>
+#endif
+
 extern "C" {
 #include <crypto/ctaes/ctaes.c>
 }
 
-AES256Encrypt::AES256Encrypt(const unsigned char key[32])
+namespace aes_aesni
+{
+void ExpandEncryptKey(unsigned char rk[240], const unsigned char key[32]);
+void ExpandDecryptKey(unsigned char rk[240], const unsigned char key[32]);
+void Encrypt(const unsigned char rk[240], unsigned char out[16], const unsigned char in[16]);
+void Decrypt(const unsigned char rk[240], unsigned char out[16], const unsigned char in[16]);
+}
+
+namespace {
+/** Whether the CPU runs the AES-NI instructions. */
+bool DetectAESNI()
+{
+#if defined(AES_HAVE_AESNI)
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+        return (ecx >> 25) & 1;
+    }
+#endif
+    return false;
+}
+
+bool UseAESNI()
+{
+    static const bool aesni = DetectAESNI();
+    return aesni;
+}
+} // namespace
+
+std::string AES256AutoDetect()
+{
+    return UseAESNI() ? "aesni" : "ctaes";
+}
+
+AES256Encrypt::AES256Encrypt(const unsigned char key[32]) : hw(UseAESNI())
 {
+#if defined(AES_HAVE_AESNI)
+    if (hw) {
+        aes_aesni::ExpandEncryptKey(rk, key);
+        return;
+    }
+#endif
     AES256_init(&ctx, key);
 }
 
 AES256Encrypt::~AES256Encrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(rk, 0, sizeof(rk));
 }
 
 void AES256Encrypt::Encrypt(unsigned char ciphertext[16], const unsigned char plaintext[16]) const
 {
+#if defined(AES_HAVE_AESNI)
+    if (hw) {
+        aes_aesni::Encrypt(rk, ciphertext, plaintext);
+        return;
+    }
+#endif
     AES256_encrypt(&ctx, 1, ciphertext, plaintext);
 }
 
-AES256Decrypt::AES256Decrypt(const unsigned char key[32])
+AES256Decrypt::AES256Decrypt(const unsigned char key[32]) : hw(UseAESNI())
 {
+#if defined(AES_HAVE_AESNI)
+    if (hw) {
+        aes_aesni::ExpandDecryptKey(rk, key);
+        return;
+    }
+#endif
     AES256_init(&ctx, key);
 }
 
 AES256Decrypt::~AES256Decrypt()
 {
     memset(&ctx, 0, sizeof(ctx));
+    memset(rk, 0, sizeof(rk));
 }
 
 void AES256Decrypt::Decrypt(unsigned char plaintext[16], const unsigned char ciphertext[16]) const
 {
+#if defined(AES_HAVE_AESNI)
+    if (hw) {
+        aes_aesni::Decrypt(rk, plaintext, ciphertext);
+        return;
+    }
+#endif
     AES256_decrypt(&ctx, 1, plaintext, ciphertext);
 }
 
@@ -11,14 +11,26 @@ extern "C" {
 #include <crypto/ctaes/ctaes.h>
 }
 
+#include <string>
+
 static const int AES_BLOCKSIZE = 16;
 static const int AES256_KEYSIZE = 32;
 
+/** Size of the AES-256 key schedule used by the hardware implementations. */
+static const int AES256_SCHEDULESIZE = 240;
+
+/** Autodetect the best available AES implementation.
+ *  Returns the name of the implementation.
+ */
+std::string AES256AutoDetect();
+
 /** An encryption class for AES-256. */
 class AES256Encrypt
 {
 private:
     AES256_ctx ctx;
+    unsigned char rk[AES256_SCHEDULESIZE];
+    bool hw;
 
 public:
     explicit AES256Encrypt(const unsigned char key[32]);
@@ -31,6 +43,8 @@ class AES256Decrypt
 {
 private:
     AES256_ctx ctx;
+    unsigned char rk[AES256_SCHEDULESIZE];
+    bool hw;
 
 public:
     explicit AES256Decrypt(const unsigned char key[32]);
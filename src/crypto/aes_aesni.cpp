@@ -0,0 +1,105 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AES-256 with the AES-NI instructions, after the Intel Advanced Encryption
+// Standard (AES) New Instructions Set white paper by Shay Gueron.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <wmmintrin.h>
+
+namespace {
+
+template <int RCON>
+void inline __attribute__((always_inline)) ExpandEven(__m128i& k0, const __m128i k1)
+{
+    __m128i t = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k1, RCON), 0xff);
+    k0 = _mm_xor_si128(k0, _mm_slli_si128(k0, 4));
+    k0 = _mm_xor_si128(k0, _mm_slli_si128(k0, 8));
+    k0 = _mm_xor_si128(k0, t);
+}
+
+void inline __attribute__((always_inline)) ExpandOdd(const __m128i k0, __m128i& k1)
+{
+    __m128i t = _mm_shuffle_epi32(_mm_aeskeygenassist_si128(k0, 0x00), 0xaa);
+    k1 = _mm_xor_si128(k1, _mm_slli_si128(k1, 4));
+    k1 = _mm_xor_si128(k1, _mm_slli_si128(k1, 8));
+    k1 = _mm_xor_si128(k1, t);
+}
+
+void inline Store(unsigned char* rk, const int round, const __m128i k)
+{
+    _mm_storeu_si128((__m128i*)(rk + round * 16), k);
+}
+
+__m128i inline Load(const unsigned char* rk, const int round)
+{
+    return _mm_loadu_si128((const __m128i*)(rk + round * 16));
+}
+
+} // Anonymous namespace
+
+namespace aes_aesni {
+
+void ExpandEncryptKey(unsigned char rk[240], const unsigned char key[32])
+{
+    __m128i k0 = _mm_loadu_si128((const __m128i*)key);
+    __m128i k1 = _mm_loadu_si128((const __m128i*)(key + 16));
+
+    Store(rk, 0, k0);
+    Store(rk, 1, k1);
+    ExpandEven<0x01>(k0, k1); Store(rk, 2, k0); ExpandOdd(k0, k1); Store(rk, 3, k1);
+    ExpandEven<0x02>(k0, k1); Store(rk, 4, k0); ExpandOdd(k0, k1); Store(rk, 5, k1);
+    ExpandEven<0x04>(k0, k1); Store(rk, 6, k0); ExpandOdd(k0, k1); Store(rk, 7, k1);
+    ExpandEven<0x08>(k0, k1); Store(rk, 8, k0); ExpandOdd(k0, k1); Store(rk, 9, k1);
+    ExpandEven<0x10>(k0, k1); Store(rk, 10, k0); ExpandOdd(k0, k1); Store(rk, 11, k1);
+    ExpandEven<0x20>(k0, k1); Store(rk, 12, k0); ExpandOdd(k0, k1); Store(rk, 13, k1);
+    ExpandEven<0x40>(k0, k1); Store(rk, 14, k0);
+
+    k0 = k1 = _mm_setzero_si128();
+}
+
+void ExpandDecryptKey(unsigned char rk[240], const unsigned char key[32])
+{
+    unsigned char enc[240];
+    ExpandEncryptKey(enc, key);
+
+    // The equivalent inverse cipher runs the round keys backwards, passed
+    // through InvMixColumns for all but the outer rounds:
+    Store(rk, 0, Load(enc, 14));
+    for (int round = 1; round < 14; ++round) {
+        Store(rk, round, _mm_aesimc_si128(Load(enc, 14 - round)));
+    }
+    Store(rk, 14, Load(enc, 0));
+
+    volatile unsigned char* p = enc;
+    for (size_t i = 0; i < sizeof(enc); ++i) p[i] = 0;
+}
+
+void Encrypt(const unsigned char rk[240], unsigned char out[16], const unsigned char in[16])
+{
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), Load(rk, 0));
+
+    for (int round = 1; round < 14; ++round) {
+        b = _mm_aesenc_si128(b, Load(rk, round));
+    }
+
+    _mm_storeu_si128((__m128i*)out, _mm_aesenclast_si128(b, Load(rk, 14)));
+}
+
+void Decrypt(const unsigned char rk[240], unsigned char out[16], const unsigned char in[16])
+{
+    __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), Load(rk, 0));
+
+    for (int round = 1; round < 14; ++round) {
+        b = _mm_aesdec_si128(b, Load(rk, round));
+    }
+
+    _mm_storeu_si128((__m128i*)out, _mm_aesdeclast_si128(b, Load(rk, 14)));
+}
+
+} // namespace aes_aesni
+
+#endif
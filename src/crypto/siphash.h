@@ -44,4 +44,21 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** SipHash-1-3 of arbitrary bytes.
+ *
+ *  One compression and three finalization rounds instead of two and four.
+ *  This is the variant used to key hash tables in other projects: it still
+ *  keeps a salted table safe from chosen collisions, but it is not meant for
+ *  authentication.
+ */
+uint64_t SipHash13(uint64_t k0, uint64_t k1, const unsigned char* data, size_t size);
+/** Optimized SipHash-1-3 implementation for uint256, identical to SipHash13()
+ *  of its 32 bytes.
+ */
+uint64_t SipHash13Uint256(uint64_t k0, uint64_t k1, const uint256& val);
+/** Optimized SipHash-1-3 implementation for uint256 followed by a 32-bit
+ *  integer in little-endian order, identical to SipHash13() of the 36 bytes.
+ */
+uint64_t SipHash13Uint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
@@ -4,20 +4,21 @@
 
 #pragma once
 
+#include <algorithm>
 #include <boost/optional.hpp>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 class CBlockIndex;
 
 namespace GRC {
 
 class Cpid;
-class ResearchAccount;
-
-//!
-//! \brief Maps BOINC CPIDs to the accounts that track research reward accrual.
-//!
-typedef std::unordered_map<Cpid, ResearchAccount> ResearchAccountMap;
 
 //!
 //! \brief An optional type that contains a pointer to a block index object or
@@ -249,6 +250,222 @@ public:
     }
 }; // ResearchAccount
 
+//!
+//! \brief Allocates the nodes of a research account map in contiguous slabs.
+//!
+//! The tally holds an account for every CPID that ever earned a reward. The
+//! arena avoids the allocator overhead of each account and places accounts
+//! next to each other in memory, so the passes over every account for an
+//! accrual snapshot or a new superblock touch fewer cache lines. The nodes of
+//! erased accounts return to a free list for the next inserted accounts.
+//!
+//! An arena belongs to one map and its copies of the map's allocator, so it
+//! needs no lock of its own.
+//!
+class ResearchAccountArena
+{
+public:
+    ResearchAccountArena() : m_node_size(0), m_used(0), m_free(nullptr)
+    {
+    }
+
+    ResearchAccountArena(const ResearchAccountArena&) = delete;
+    ResearchAccountArena& operator=(const ResearchAccountArena&) = delete;
+
+    //!
+    //! \brief Allocate a map node.
+    //!
+    //! \param size Size of the node. The first call fixes the size of the
+    //! nodes stored in the slabs. Other sizes come from the heap.
+    //!
+    void* Allocate(const size_t size)
+    {
+        if (m_node_size == 0) {
+            m_node_size = Stride(size);
+        }
+
+        if (Stride(size) != m_node_size) {
+            return ::operator new(size);
+        }
+
+        if (m_free) {
+            void* node = m_free;
+            m_free = *static_cast<void**>(node);
+
+            return node;
+        }
+
+        if (m_slabs.empty() || m_used == SlabNodes(m_slabs.size() - 1)) {
+            m_slabs.emplace_back(new unsigned char[SlabNodes(m_slabs.size()) * m_node_size]);
+            m_used = 0;
+        }
+
+        return m_slabs.back().get() + m_used++ * m_node_size;
+    }
+
+    //!
+    //! \brief Return a map node to the arena.
+    //!
+    void Deallocate(void* node, const size_t size)
+    {
+        if (Stride(size) != m_node_size) {
+            ::operator delete(node);
+            return;
+        }
+
+        *static_cast<void**>(node) = m_free;
+        m_free = node;
+    }
+
+    //!
+    //! \brief Get the number of bytes reserved by the slabs.
+    //!
+    size_t SlabBytes() const
+    {
+        size_t bytes = 0;
+
+        for (size_t i = 0; i < m_slabs.size(); ++i) {
+            bytes += SlabNodes(i) * m_node_size;
+        }
+
+        return bytes;
+    }
+
+private:
+    //!
+    //! \brief Nodes in the first slab. Each slab doubles the size of the one
+    //! before it up to \c MAX_SLAB_NODES so that the small maps of the tally
+    //! views reserve little memory.
+    //!
+    static constexpr size_t MIN_SLAB_NODES = 64;
+    static constexpr size_t MAX_SLAB_NODES = 4096;
+
+    size_t m_node_size;                                 //!< Bytes per node.
+    std::vector<std::unique_ptr<unsigned char[]>> m_slabs;
+    size_t m_used;                                      //!< Nodes used in the last slab.
+    void* m_free;                                       //!< Erased nodes to reuse.
+
+    //!
+    //! \brief Round a node size up to keep each node aligned in the slab.
+    //!
+    static size_t Stride(const size_t size)
+    {
+        constexpr size_t align = alignof(std::max_align_t);
+
+        return (std::max(size, sizeof(void*)) + align - 1) / align * align;
+    }
+
+    static size_t SlabNodes(const size_t slab_index)
+    {
+        size_t nodes = MIN_SLAB_NODES;
+
+        for (size_t i = 0; i < slab_index && nodes < MAX_SLAB_NODES; ++i) {
+            nodes *= 2;
+        }
+
+        return nodes;
+    }
+}; // ResearchAccountArena
+
+//!
+//! \brief Supplies the nodes of a research account map from an arena.
+//!
+//! Copies of the allocator share the arena. A copied map starts a new arena,
+//! so the published tally views never share an arena with the tally itself.
+//! The bucket arrays of the map come from the heap.
+//!
+template <typename T>
+class ResearchAccountAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    ResearchAccountAllocator() : m_arena(std::make_shared<ResearchAccountArena>())
+    {
+    }
+
+    // A moved allocator must still share its arena with the nodes it
+    // allocated, so this declaration also suppresses the implicit move:
+    ResearchAccountAllocator(const ResearchAccountAllocator&) = default;
+    ResearchAccountAllocator& operator=(const ResearchAccountAllocator&) = default;
+
+    template <typename U>
+    ResearchAccountAllocator(const ResearchAccountAllocator<U>& other) : m_arena(other.m_arena)
+    {
+    }
+
+    ResearchAccountAllocator select_on_container_copy_construction() const
+    {
+        return ResearchAccountAllocator();
+    }
+
+    T* allocate(const size_t n)
+    {
+        if (IsNode(n)) {
+            return static_cast<T*>(m_arena->Allocate(sizeof(T)));
+        }
+
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, const size_t n)
+    {
+        if (IsNode(n)) {
+            m_arena->Deallocate(ptr, sizeof(T));
+        } else {
+            ::operator delete(ptr);
+        }
+    }
+
+    //!
+    //! \brief Get the number of bytes reserved for the nodes of the map.
+    //!
+    size_t SlabBytes() const
+    {
+        return m_arena->SlabBytes();
+    }
+
+    template <typename U>
+    bool operator==(const ResearchAccountAllocator<U>& other) const
+    {
+        return m_arena == other.m_arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ResearchAccountAllocator<U>& other) const
+    {
+        return m_arena != other.m_arena;
+    }
+
+private:
+    template <typename U>
+    friend class ResearchAccountAllocator;
+
+    std::shared_ptr<ResearchAccountArena> m_arena;
+
+    //!
+    //! \brief Whether an allocation holds a map node. Only the nodes contain
+    //! a whole research account.
+    //!
+    static bool IsNode(const size_t n)
+    {
+        return n == 1 && sizeof(T) > sizeof(ResearchAccount);
+    }
+}; // ResearchAccountAllocator
+
+//!
+//! \brief Maps BOINC CPIDs to the accounts that track research reward accrual.
+//!
+typedef std::unordered_map<
+    Cpid,
+    ResearchAccount,
+    std::hash<Cpid>,
+    std::equal_to<Cpid>,
+    ResearchAccountAllocator<std::pair<const Cpid, ResearchAccount>>>
+    ResearchAccountMap;
+
 //!
 //! \brief A traversable range of all the research accounts stored in the tally.
 //!
@@ -15,8 +15,14 @@
 #include "serialize.h"
 #include "streams.h"
 #include "tinyformat.h"
+#include "util/threadpool.h"
 
+#include <algorithm>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 class CBlockIndex;
 
@@ -425,7 +431,26 @@ public:
     //!
     //! \brief Version number of the current format for a serialized snapshot.
     //!
-    static constexpr uint32_t CURRENT_VERSION = 1;
+    //! Version 2 snapshots store the same fixed-width records as version 1
+    //! but sort them by CPID so that a reader can search a file in place.
+    //!
+    static constexpr uint32_t CURRENT_VERSION = 2;
+
+    //!
+    //! \brief First version of the snapshot format that sorts the records by
+    //! CPID.
+    //!
+    static constexpr uint32_t SORTED_VERSION = 2;
+
+    //!
+    //! \brief Size in bytes of the serialized version and height.
+    //!
+    static constexpr size_t HEADER_SIZE = sizeof(uint32_t) + sizeof(uint64_t);
+
+    //!
+    //! \brief Size in bytes of a serialized CPID and accrual record.
+    //!
+    static constexpr size_t RECORD_SIZE = sizeof(Cpid) + sizeof(int64_t);
 
     uint32_t m_version; //!< Version of the serialized snapshot format.
     uint64_t m_height;  //!< Block height of the snapshot.
@@ -456,8 +481,33 @@ public:
     {
         m_records.clear();
 
-        file >> m_version;
-        file >> m_height;
+        const bool store = !(file.GetType() & SER_GETHASH);
+
+        ReadEach(file, m_version, m_height, [&](const Cpid& cpid, const int64_t accrual) {
+            if (store) {
+                m_records.emplace(cpid, accrual);
+            }
+        });
+    }
+
+    //!
+    //! \brief Deserialize a snapshot from the provided file one record at a
+    //! time without storing the records.
+    //!
+    //! \param file    The input stream positioned at the start of the file.
+    //! \param version Set to the version of the snapshot format.
+    //! \param height  Set to the block height of the snapshot.
+    //! \param visitor Called with the CPID and accrual of each record.
+    //!
+    template <typename Visitor>
+    static void ReadEach(
+        CAutoHasherFile& file,
+        uint32_t& version,
+        uint64_t& height,
+        Visitor&& visitor)
+    {
+        file >> version;
+        file >> height;
 
         while (true) {
             Cpid cpid;
@@ -474,9 +524,7 @@ public:
                 throw;
             }
 
-            if (!(file.GetType() & SER_GETHASH)) {
-                m_records.emplace(cpid, accrual);
-            }
+            visitor(cpid, accrual);
         }
     }
 
@@ -503,6 +551,11 @@ public:
 
 constexpr uint32_t AccrualSnapshot::CURRENT_VERSION; // for clang
 
+static_assert(sizeof(Cpid) == 16, "Unexpected CPID size.");
+constexpr uint32_t AccrualSnapshot::SORTED_VERSION; // for clang
+constexpr size_t AccrualSnapshot::HEADER_SIZE; // for clang
+constexpr size_t AccrualSnapshot::RECORD_SIZE; // for clang
+
 //!
 //! \brief Base class for types that read and write accrual snapshot files.
 //!
@@ -660,6 +713,108 @@ public:
     {
         return AccrualSnapshot(deserialize, m_file);
     }
+
+    //!
+    //! \brief Deserialize the snapshot file from disk one record at a time
+    //! without loading the snapshot into memory.
+    //!
+    //! This computes the hash of the file like \c Read() does.
+    //!
+    //! \param version Set to the version of the snapshot format.
+    //! \param height  Set to the block height of the snapshot.
+    //! \param visitor Called with the CPID and accrual of each record.
+    //!
+    template <typename Visitor>
+    void ReadEach(uint32_t& version, uint64_t& height, Visitor&& visitor)
+    {
+        AccrualSnapshot::ReadEach(m_file, version, height, std::forward<Visitor>(visitor));
+    }
+
+    //!
+    //! \brief Look up the accrual of a single CPID without reading the whole
+    //! snapshot file.
+    //!
+    //! For snapshots in the sorted format, this binary searches the records
+    //! in place. Older snapshots fall back to a linear scan. The lookup does
+    //! not verify the hash of the file.
+    //!
+    //! \param cpid CPID to fetch accrual for.
+    //!
+    //! \return Accrued research rewards at the time of the snapshot in units
+    //! of 1/100000000 GRC or zero if the CPID does not exist in the snapshot.
+    //!
+    //! \throws std::ios_base::failure If the file cannot be read.
+    //!
+    int64_t FindAccrual(const Cpid cpid)
+    {
+        FILE* file = m_file.Get();
+
+        uint32_t version;
+        uint64_t height;
+
+        if (fseek(file, 0, SEEK_SET) != 0) {
+            throw std::ios_base::failure("AccrualSnapshotReader::FindAccrual(): seek failed");
+        }
+
+        m_file >> version;
+        m_file >> height;
+
+        if (version < AccrualSnapshot::SORTED_VERSION) {
+            int64_t found = 0;
+
+            if (fseek(file, 0, SEEK_SET) != 0) {
+                throw std::ios_base::failure("AccrualSnapshotReader::FindAccrual(): seek failed");
+            }
+
+            ReadEach(version, height, [&](const Cpid& record_cpid, const int64_t accrual) {
+                if (record_cpid == cpid) {
+                    found = accrual;
+                }
+            });
+
+            return found;
+        }
+
+        if (fseek(file, 0, SEEK_END) != 0) {
+            throw std::ios_base::failure("AccrualSnapshotReader::FindAccrual(): seek failed");
+        }
+
+        const long file_size = ftell(file);
+
+        if (file_size < static_cast<long>(AccrualSnapshot::HEADER_SIZE)) {
+            throw std::ios_base::failure("AccrualSnapshotReader::FindAccrual(): truncated file");
+        }
+
+        size_t low = 0;
+        size_t high = (file_size - AccrualSnapshot::HEADER_SIZE) / AccrualSnapshot::RECORD_SIZE;
+
+        while (low < high) {
+            const size_t mid = low + (high - low) / 2;
+            const long offset = AccrualSnapshot::HEADER_SIZE + mid * AccrualSnapshot::RECORD_SIZE;
+
+            if (fseek(file, offset, SEEK_SET) != 0) {
+                throw std::ios_base::failure("AccrualSnapshotReader::FindAccrual(): seek failed");
+            }
+
+            Cpid record_cpid;
+            int64_t accrual;
+
+            m_file >> record_cpid;
+            m_file >> accrual;
+
+            if (record_cpid == cpid) {
+                return accrual;
+            }
+
+            if (record_cpid < cpid) {
+                low = mid + 1;
+            } else {
+                high = mid;
+            }
+        }
+
+        return 0;
+    }
 }; // AccrualSnapshotReader
 
 //!
@@ -699,6 +854,16 @@ public:
     {
         m_file << cpid << accrual;
     }
+
+    //!
+    //! \brief Flush the written snapshot data to the disk.
+    //!
+    //! \return \c false if the operating system failed to sync the file.
+    //!
+    bool Commit()
+    {
+        return FileCommit(m_file.Get());
+    }
 }; // AccrualSnapshotWriter
 
 //!
@@ -1206,6 +1371,14 @@ private:
 class AccrualSnapshotRepository
 {
 public:
+    //!
+    //! \brief Wait for a snapshot still being written in the background.
+    //!
+    ~AccrualSnapshotRepository()
+    {
+        FinishPendingStore();
+    }
+
     //!
     //! \brief Initialize the accrual snapshot system.
     //!
@@ -1214,6 +1387,8 @@ public:
     //!
     bool Initialize()
     {
+        FinishPendingStore();
+
         try {
             fs::create_directory(SnapshotDirectory());
         } catch (const std::exception& e) {
@@ -1236,6 +1411,12 @@ public:
     //!
     bool EraseAll()
     {
+        // A snapshot that failed to store no longer matters after we erase
+        // the repository:
+        //
+        FinishPendingStore();
+        m_store_failed = false;
+
         if (!m_registry.Close()) {
             return false;
         }
@@ -1266,6 +1447,8 @@ public:
     //!
     void AssertMatch(const uint64_t height) const
     {
+        AssertPendingStoreSucceeded();
+
         if (const auto* entry = m_registry.TryHeight(height)) {
             entry->AssertHash(AccrualSnapshotReader::Hash(SnapshotPath(height)));
         } else {
@@ -1278,6 +1461,8 @@ public:
     //!
     void PruneSnapshotFiles() const
     {
+        AssertPendingStoreSucceeded();
+
         for (const auto& file : fs::directory_iterator(SnapshotDirectory())) {
             const fs::path& file_path = file.path();
 
@@ -1309,6 +1494,8 @@ public:
     //!
     bool HasBaseline() const
     {
+        AssertPendingStoreSucceeded();
+
         return m_registry.BaselineHeight() > 0;
     }
 
@@ -1322,43 +1509,61 @@ public:
     //!
     bool StoreBaseline(const uint64_t height, const ResearchAccountMap& accounts)
     {
+        if (!FinishPendingStore()) {
+            return error("%s: a previous accrual snapshot failed to store", __func__);
+        }
+
         return m_registry.ResetBaseline(height) && Store(height, accounts);
     }
 
     //!
     //! \brief Store a snapshot of accrual for each account to disk.
     //!
+    //! The snapshot file is written, synced and registered in the background.
+    //! A failure to store it surfaces from the next call that waits for the
+    //! writer.
+    //!
     //! \param height   Height of the block to associate with the snapshot.
     //! \param accounts Research accounts to record accrual from.
     //!
-    //! \return \c false when an error occurs while creating a snapshot.
+    //! \return \c false when the previous snapshot failed to store.
     //!
     bool Store(const uint64_t height, const ResearchAccountMap& accounts)
     {
-        LogPrint(LogFlags::TALLY,
-            "Tally: storing new accrual snapshot %" PRIu64 "...", height);
+        if (!FinishPendingStore()) {
+            return error("%s: a previous accrual snapshot failed to store", __func__);
+        }
 
-        AccrualSnapshotWriter writer(SnapshotPath(height));
+        // Sort the records by CPID so that readers can binary search the
+        // snapshot file:
+        //
+        auto records = std::make_shared<std::vector<std::pair<Cpid, int64_t>>>();
 
-        if (writer.IsNull()) {
-            return error("%s: failed to open %" PRIu64, __func__, height);
+        for (const auto& account_pair : accounts) {
+            if (account_pair.second.m_accrual > 0) {
+                records->emplace_back(
+                    account_pair.first, // CPID
+                    account_pair.second.m_accrual);
+            }
         }
 
-        try {
-            writer.WriteHeader(height);
+        std::sort(records->begin(), records->end());
 
-            for (const auto& account_pair : accounts) {
-                if (account_pair.second.m_accrual > 0) {
-                    writer.WriteRecord(
-                        account_pair.first, // CPID
-                        account_pair.second.m_accrual);
-                }
+        // Writing and syncing the file takes far longer than collecting the
+        // records, so the writer finishes in the background. The registry
+        // only records the snapshot after the file reaches the disk, and the
+        // methods that read snapshots or the registry wait for the writer:
+        //
+        m_pending_store = boost::thread([this, height, records]() {
+            try {
+                m_store_failed = !WriteSnapshot(height, *records);
+            } catch (const std::exception& e) {
+                LogPrintf("ERROR: %s: %s", __func__, e.what());
+                m_store_failed = true;
             }
-        } catch (const std::exception& e) {
-            return error("%s: %s", __func__, e.what());
-        }
+        });
 
-        return m_registry.Register(height, writer.GetHash());
+        return true;
     }
 
     //!
@@ -1373,6 +1578,8 @@ public:
     //!
     bool ApplyLatest(ResearchAccountMap& accounts) const
     {
+        AssertPendingStoreSucceeded();
+
         return Apply(m_registry.LatestHeight(), accounts);
     }
 
@@ -1389,6 +1596,8 @@ public:
     //!
     bool Apply(const uint64_t height, ResearchAccountMap& accounts) const
     {
+        AssertPendingStoreSucceeded();
+
         LogPrint(LogFlags::TALLY,
             "Tally: applying accrual snapshot %" PRIu64 "...", height);
 
@@ -1398,10 +1607,22 @@ public:
             return error("%s: failed to open %" PRIu64, __func__, height);
         }
 
-        AccrualSnapshot snapshot;
+        // Stream the records rather than loading the whole snapshot. Stage
+        // the accrual for known accounts so that a snapshot that fails the
+        // hash check leaves the accounts untouched:
+        //
+        std::vector<std::pair<ResearchAccount*, int64_t>> updates;
+        uint32_t version;
+        uint64_t snapshot_height;
 
         try {
-            snapshot = reader.Read();
+            reader.ReadEach(version, snapshot_height, [&](const Cpid& cpid, const int64_t accrual) {
+                const auto iter = accounts.find(cpid);
+
+                if (iter != accounts.end()) {
+                    updates.emplace_back(&iter->second, accrual);
+                }
+            });
         } catch (const std::exception& e) {
             return error("%s: %s", __func__, e.what());
         }
@@ -1409,10 +1630,11 @@ public:
         m_registry.AssertHashMatches(height, reader.GetHash());
 
         for (auto& account_pair : accounts) {
-            const Cpid& cpid = account_pair.first;
-            ResearchAccount& account = account_pair.second;
+            account_pair.second.m_accrual = 0;
+        }
 
-            account.m_accrual = snapshot.GetAccrual(cpid);
+        for (const auto& update : updates) {
+            update.first->m_accrual = update.second;
         }
 
         return true;
@@ -1427,6 +1649,8 @@ public:
     //!
     bool Drop(const uint64_t height)
     {
+        AssertPendingStoreSucceeded();
+
         LogPrint(LogFlags::TALLY,
             "Tally: dropping accrual snapshot %" PRIu64 "...", height);
 
@@ -1435,8 +1659,84 @@ public:
         return m_registry.Deregister(height);
     }
 
+    //!
+    //! \brief Wait for a snapshot still being written in the background.
+    //!
+    //! \return \c false if the last snapshot written in the background failed
+    //! to store.
+    //!
+    bool FinishPendingStore() const
+    {
+        if (m_pending_store.joinable()) {
+            m_pending_store.join();
+        }
+
+        return !m_store_failed;
+    }
+
 private:
-    AccrualSnapshotRegistry m_registry; //!< Tracks snapshot files state.
+    AccrualSnapshotRegistry m_registry;    //!< Tracks snapshot files state.
+    mutable boost::thread m_pending_store; //!< Writes the newest snapshot.
+
+    //!
+    //! \brief Set when the snapshot written in the background failed to store.
+    //!
+    //! Only accessed by the background writer or after joining it.
+    //!
+    bool m_store_failed = false;
+
+    //!
+    //! \brief Wait for a snapshot still being written in the background and
+    //! check that it stored successfully.
+    //!
+    //! \throws SnapshotStateError If the snapshot failed to store. The registry
+    //! does not contain the missing snapshot so the caller needs to rebuild the
+    //! snapshots.
+    //!
+    void AssertPendingStoreSucceeded() const
+    {
+        if (!FinishPendingStore()) {
+            throw SnapshotStateError("an accrual snapshot failed to store");
+        }
+    }
+
+    //!
+    //! \brief Write a snapshot file to disk and register it.
+    //!
+    //! \param height  Height of the block to associate with the snapshot.
+    //! \param records CPID and accrual records sorted by CPID.
+    //!
+    //! \return \c false when an error occurs while creating a snapshot.
+    //!
+    bool WriteSnapshot(
+        const uint64_t height,
+        const std::vector<std::pair<Cpid, int64_t>>& records)
+    {
+        LogPrint(LogFlags::TALLY,
+            "Tally: storing new accrual snapshot %" PRIu64 "...", height);
+
+        AccrualSnapshotWriter writer(SnapshotPath(height));
+
+        if (writer.IsNull()) {
+            return error("%s: failed to open %" PRIu64, __func__, height);
+        }
+
+        try {
+            writer.WriteHeader(height);
+
+            for (const auto& record : records) {
+                writer.WriteRecord(record.first, record.second);
+            }
+        } catch (const std::exception& e) {
+            return error("%s: %s", __func__, e.what());
+        }
+
+        if (!writer.Commit()) {
+            return error("%s: failed to flush %" PRIu64, __func__, height);
+        }
+
+        return m_registry.Register(height, writer.GetHash());
+    }
 }; // AccrualSnapshotRepository
 
 //!
@@ -1453,7 +1753,6 @@ public:
     //!
     SnapshotBaselineBuilder(ResearchAccountMap& researchers)
         : m_researchers(researchers)
-        , m_superblock(SuperblockPtr::Empty())
     {
     }
 
@@ -1505,6 +1804,11 @@ public:
         // the magnitudes stored in each of the superblocks to compute accrual
         // earned during the period that a superblock was active.
         //
+        // This walk only collects the accrual periods. Reading superblocks
+        // from disk dominates the cost of the baseline, so we load them and
+        // compute the accrual for each period concurrently afterward.
+        //
+        std::vector<AccrualPeriod> periods;
         int64_t payment_time = current_superblock.m_timestamp;
 
         for (; pindex && pindex->nHeight > max_depth; pindex = pindex->pprev) {
@@ -1512,11 +1816,7 @@ public:
                 continue;
             }
 
-            if (!LoadSuperblock(pindex)) {
-                return false;
-            }
-
-            TallyAccrual(payment_time);
+            periods.emplace_back(pindex, nullptr, payment_time);
 
             payment_time = pindex->nTime;
         }
@@ -1524,7 +1824,7 @@ public:
         // If the maximum depth is a superblock, we're done.
         //
         if (pindex->nIsSuperBlock == 1) {
-            return true;
+            return TallyAccrual(periods);
         }
 
         // Otherwise, we need to credit the remaining accrual between the last
@@ -1545,21 +1845,47 @@ public:
             // to force accrual calculation at the time of the maximum depth
             // rather than at the time of the superblock's containing block:
             //
-            if (!LoadSuperblock(pindex, pindex_max)) {
-                return false;
-            }
-
-            TallyAccrual(payment_time);
+            periods.emplace_back(pindex, pindex_max, payment_time);
 
             break;
         }
 
-        return true;
+        return TallyAccrual(periods);
     }
 
 private:
+    //!
+    //! \brief Describes the span of time that a historical superblock was
+    //! active for.
+    //!
+    struct AccrualPeriod
+    {
+        const CBlockIndex* m_pindex;      //!< Contains the superblock.
+        const CBlockIndex* m_pindex_bind; //!< Overrides superblock context.
+        int64_t m_payment_time;           //!< End of the accrual period.
+
+        AccrualPeriod(
+            const CBlockIndex* const pindex,
+            const CBlockIndex* const pindex_bind,
+            const int64_t payment_time)
+            : m_pindex(pindex)
+            , m_pindex_bind(pindex_bind)
+            , m_payment_time(payment_time)
+        {
+        }
+    };
+
+    //!
+    //! \brief Accrual earned by each CPID during one accrual period.
+    //!
+    using AccrualDeltas = std::vector<std::pair<Cpid, int64_t>>;
+
+    //!
+    //! \brief Maximum number of threads that load historical superblocks.
+    //!
+    static constexpr size_t MAX_THREADS = 8;
+
     ResearchAccountMap& m_researchers; //!< Current set of known CPIDs.
-    SuperblockPtr m_superblock;        //!< Current historical superblock.
 
     //!
     //! \brief Read the superblock at the specified block index from disk.
@@ -1572,13 +1898,16 @@ private:
     //! limit (the deepest block) when that block is not a superblock itself.
     //!
     //! \param pindex      Used to locate the containing block on disk.
-    //! \param pindex_bind Context of the block to bind to the superblock.
+    //! \param pindex_bind Context of the block to bind to the superblock or
+    //! \c nullptr to use \p pindex.
+    //! \param superblock  Set to the superblock read from disk.
     //!
     //! \return \c false if an error occurred while reading the block from disk.
     //!
-    bool LoadSuperblock(
+    static bool LoadSuperblock(
         const CBlockIndex* const pindex,
-        const CBlockIndex* const pindex_bind = nullptr)
+        const CBlockIndex* const pindex_bind,
+        SuperblockPtr& superblock)
     {
         assert(pindex->nIsSuperBlock == 1);
 
@@ -1592,25 +1921,94 @@ private:
                 pindex->nHeight);
         }
 
-        m_superblock = block.GetSuperblock(pindex_bind ? pindex_bind : pindex);
+        superblock = block.GetSuperblock(pindex_bind ? pindex_bind : pindex);
 
         return true;
     }
 
     //!
-    //! \brief Apply the accrual earned for the current superblock to the total
-    //! accrual for each of the CPIDs that it contains.
+    //! \brief Calculate the accrual earned during one period by each of the
+    //! CPIDs in the period's superblock.
     //!
-    //! \param payment_time Timestamp of the end of the accrual period.
+    //! This only reads the research accounts, so several threads may call it
+    //! at the same time.
     //!
-    void TallyAccrual(const int64_t payment_time)
+    //! \param period Identifies the superblock and the end of the period.
+    //! \param deltas Receives the accrual earned by each CPID.
+    //!
+    //! \return \c false if an error occurred while reading the block from disk.
+    //!
+    bool ComputeAccrual(const AccrualPeriod& period, AccrualDeltas& deltas) const
     {
-        const SnapshotCalculator calc(payment_time, m_superblock);
+        SuperblockPtr superblock = SuperblockPtr::Empty();
 
-        for (const auto& cpid_pair : m_superblock->m_cpids) {
-            ResearchAccount& account = m_researchers[cpid_pair.Cpid()];
-            account.m_accrual += calc.AccrualDelta(cpid_pair.Cpid(), account);
+        if (!LoadSuperblock(period.m_pindex, period.m_pindex_bind, superblock)) {
+            return false;
         }
+
+        const SnapshotCalculator calc(period.m_payment_time, superblock);
+        const ResearchAccount blank_account;
+
+        deltas.reserve(superblock->m_cpids.size());
+
+        for (const auto& cpid_pair : superblock->m_cpids) {
+            const auto iter = m_researchers.find(cpid_pair.Cpid());
+            const ResearchAccount& account = iter != m_researchers.end()
+                ? iter->second
+                : blank_account;
+
+            deltas.emplace_back(cpid_pair.Cpid(), calc.AccrualDelta(cpid_pair.Cpid(), account));
+        }
+
+        return true;
+    }
+
+    //!
+    //! \brief Apply the accrual earned during each period to the total accrual
+    //! for each of the CPIDs in the period's superblock.
+    //!
+    //! The periods are processed across several threads. Each period's deltas
+    //! are then applied to the accounts in the original order so the result
+    //! does not depend on thread scheduling.
+    //!
+    //! \param periods The accrual periods in the baseline window.
+    //!
+    //! \return \c false if an error occurred while reading a block from disk.
+    //!
+    bool TallyAccrual(const std::vector<AccrualPeriod>& periods)
+    {
+        std::vector<AccrualDeltas> deltas(periods.size());
+        std::atomic<size_t> next_period(0);
+        std::atomic<bool> failed(false);
+
+        const auto worker = [&]() {
+            for (size_t i = next_period++; i < periods.size() && !failed; i = next_period++) {
+                if (!ComputeAccrual(periods[i], deltas[i])) {
+                    failed = true;
+                }
+            }
+        };
+
+        const size_t thread_count = std::min<size_t>(
+            std::max<size_t>(boost::thread::hardware_concurrency(), 1),
+            std::min(periods.size(), MAX_THREADS));
+
+        // The calling thread takes a share of the work too:
+        util::ParallelFor(util::Executor::VALIDATION, thread_count, [&](size_t) { worker(); });
+
+        if (failed) {
+            return false;
+        }
+
+        for (const auto& period_deltas : deltas) {
+            for (const auto& delta : period_deltas) {
+                m_researchers[delta.first].m_accrual += delta.second;
+            }
+        }
+
+        return true;
     }
 }; // SnapshotBaselineBuilder
+
+constexpr size_t SnapshotBaselineBuilder::MAX_THREADS; // for clang
 } // anonymous namespace
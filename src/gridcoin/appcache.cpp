@@ -3,10 +3,13 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "gridcoin/appcache.h"
+#include "memusage.h"
 #include "util.h"
 
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 #include <array>
+#include <deque>
 #include <type_traits>
 
 namespace
@@ -24,6 +27,29 @@ namespace
 
     //static_assert(section_name_map.size() == NumCaches, "Section name table size mismatch");
 
+    //!
+    //! \brief The state of an entry before a block changed it.
+    //!
+    struct AppCacheDelta
+    {
+        int height;             //!< Height of the block that changed the entry.
+        Section section;        //!< Section of the entry.
+        std::string key;        //!< Key of the entry.
+        bool existed;           //!< Whether the entry existed before the change.
+        AppCacheEntry previous; //!< Entry before the change if it existed.
+    };
+
+    //!
+    //! \brief Changes made by recent blocks, ordered from oldest to newest.
+    //!
+    std::deque<AppCacheDelta> deltas;
+
+    //!
+    //! \brief Highest height of a change dropped from the history. Rollbacks
+    //! to a lower height must replay the contracts instead.
+    //!
+    int deltas_floor = -1;
+
     AppCacheSection& GetSection(Section section)
     {
         if(section == Section::NUM_CACHES)
@@ -32,19 +58,129 @@ namespace
         auto idx = static_cast<Section_t>(section);
         return caches[idx];
     }
+
+    //!
+    //! \brief Record the current state of an entry before a block changes it.
+    //!
+    void RecordDelta(Section section, const std::string& key, int height)
+    {
+        if (height < 0) {
+            return;
+        }
+
+        const AppCacheSection& cache = GetSection(section);
+        const auto entry = cache.find(key);
+
+        if (entry == cache.end()) {
+            deltas.push_back({ height, section, key, false, AppCacheEntry{ std::string(), 0 } });
+        } else {
+            deltas.push_back({ height, section, key, true, entry->second });
+        }
+
+        while (deltas.front().height <= height - APPCACHE_UNDO_DEPTH) {
+            deltas_floor = std::max(deltas_floor, deltas.front().height);
+            deltas.pop_front();
+        }
+    }
+
+    //!
+    //! \brief Parse the team whitelist protocol entry.
+    //!
+    //! \return The set of lowercase team names, or a set with only team
+    //! "gridcoin" when the entry is empty or contains no team names.
+    //!
+    std::set<std::string> ParseTeamWhitelist(const std::string& value)
+    {
+        std::set<std::string> teams;
+        std::string delimiter = "<>";
+
+        // Handle the transition of the team whitelist delimiter from "|" to "<>":
+        if (value.find(delimiter) == std::string::npos) {
+            delimiter = "|";
+        }
+
+        for (auto&& team_name : split(value, delimiter)) {
+            if (team_name.empty()) {
+                continue;
+            }
+
+            boost::to_lower(team_name);
+
+            teams.emplace(std::move(team_name));
+        }
+
+        if (teams.empty()) {
+            teams.emplace("gridcoin");
+        }
+
+        return teams;
+    }
+
+    ProtocolParametersPtr BuildProtocolParameters(const uint64_t revision)
+    {
+        const AppCacheSection& cache = GetSection(Section::PROTOCOL);
+        const auto find = [&](const std::string& key) {
+            auto entry = cache.find(key);
+            return entry != cache.end() ? entry->second : AppCacheEntry{ std::string(), 0 };
+        };
+
+        auto params = std::make_shared<ProtocolParameters>();
+
+        const AppCacheEntry block_reward = find("blockreward1");
+        params->block_reward = atoi64(block_reward.value);
+        params->block_reward_time = block_reward.timestamp;
+        params->require_team_membership = find("REQUIRE_TEAM_WHITELIST_MEMBERSHIP").value != "false";
+        params->team_whitelist = ParseTeamWhitelist(find("TEAM_WHITELIST").value);
+        params->revision = revision;
+
+        return params;
+    }
+
+    ProtocolParametersPtr g_protocol_params = BuildProtocolParameters(0);
+
+    //!
+    //! \brief Rebuild the protocol parameters if a change to the cache may
+    //! affect them.
+    //!
+    //! \param section Section of the changed entry.
+    //! \param key     Key of the changed entry, or empty to rebuild for any
+    //! change to \p section.
+    //!
+    void RefreshProtocolParameters(Section section, const std::string& key)
+    {
+        if (section != Section::PROTOCOL) {
+            return;
+        }
+
+        if (!key.empty()
+            && key != "blockreward1"
+            && key != "REQUIRE_TEAM_WHITELIST_MEMBERSHIP"
+            && key != "TEAM_WHITELIST")
+        {
+            return;
+        }
+
+        const uint64_t revision = std::atomic_load(&g_protocol_params)->revision + 1;
+        std::atomic_store(&g_protocol_params, BuildProtocolParameters(revision));
+    }
 }
 
 void WriteCache(
         Section section,
         const std::string& key,
         const std::string& value,
-        int64_t locktime)
+        int64_t locktime,
+        int height)
 {
     if(key.empty())
         return;
 
+    RecordDelta(section, key, height);
+
     AppCacheSection& cache = GetSection(section);
     cache[key] = AppCacheEntry{ value, locktime };
+
+    RefreshProtocolParameters(section, key);
 }
 
 AppCacheEntry ReadCache(
@@ -66,20 +202,82 @@ AppCacheSection& ReadCacheSection(Section section)
     return GetSection(section);
 }
 
-SortedAppCacheSection ReadSortedCacheSection(Section section)
+const SortedAppCacheSection& ReadSortedCacheSection(Section section)
 {
-    const auto& cache = ReadCacheSection(section);
-    return SortedAppCacheSection(cache.begin(), cache.end());
+    return GetSection(section);
 }
 
 void ClearCache(Section section)
 {
     GetSection(section).clear();
+
+    deltas.erase(
+        std::remove_if(deltas.begin(), deltas.end(), [&](const AppCacheDelta& delta) {
+            return delta.section == section;
+        }),
+        deltas.end());
+
+    RefreshProtocolParameters(section, std::string());
+}
+
+void DeleteCache(Section section, const std::string &key, int height)
+{
+    AppCacheSection& cache = GetSection(section);
+
+    if (cache.count(key) == 0) {
+        return;
+    }
+
+    RecordDelta(section, key, height);
+    cache.erase(key);
+
+    RefreshProtocolParameters(section, key);
+}
+
+bool RevertCache(int height)
+{
+    if (height < deltas_floor) {
+        return false;
+    }
+
+    while (!deltas.empty() && deltas.back().height > height) {
+        const AppCacheDelta& delta = deltas.back();
+        AppCacheSection& cache = GetSection(delta.section);
+
+        if (delta.existed) {
+            cache[delta.key] = delta.previous;
+        } else {
+            cache.erase(delta.key);
+        }
+
+        RefreshProtocolParameters(delta.section, delta.key);
+        deltas.pop_back();
+    }
+
+    return true;
 }
 
-void DeleteCache(Section section, const std::string &key)
+size_t AppCacheDynamicUsage()
 {
-    GetSection(section).erase(key);
+    size_t usage = 0;
+
+    for (const auto& cache : caches) {
+        usage += memusage::DynamicUsage(cache);
+
+        for (const auto& entry : cache) {
+            usage += memusage::DynamicUsage(entry.first)
+                + memusage::DynamicUsage(entry.second.value);
+        }
+    }
+
+    // A deque allocates its elements in blocks of 512 bytes:
+    usage += memusage::MallocUsage(512) * ((deltas.size() * sizeof(AppCacheDelta)) / 512 + 1);
+
+    for (const auto& delta : deltas) {
+        usage += memusage::DynamicUsage(delta.key) + memusage::DynamicUsage(delta.previous.value);
+    }
+
+    return usage;
 }
 
 Section StringToSection(const std::string &section)
@@ -90,3 +288,8 @@ Section StringToSection(const std::string &section)
 
     return entry->second;
 }
+
+ProtocolParametersPtr GetProtocolParameters()
+{
+    return std::atomic_load(&g_protocol_params);
+}
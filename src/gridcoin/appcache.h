@@ -6,6 +6,8 @@
 
 #include <string>
 #include <map>
+#include <memory>
+#include <set>
 #include <unordered_map>
 
 enum class Section
@@ -29,12 +31,21 @@ struct AppCacheEntry
 //!
 //! \brief Application cache section type.
 //!
-typedef std::unordered_map<std::string, AppCacheEntry> AppCacheSection;
+//! Sections hold a few dozen entries at most. Keeping them ordered lets the
+//! RPC listings iterate a section without copying it into a sorted map.
+//!
+typedef std::map<std::string, AppCacheEntry> AppCacheSection;
 
 //!
 //! \brief Application cache section sorted by key.
 //!
-typedef std::map<std::string, AppCacheEntry> SortedAppCacheSection;
+typedef AppCacheSection SortedAppCacheSection;
+
+//!
+//! \brief Number of blocks below the newest recorded change for which the
+//! cache keeps the history needed to roll back a reorganization.
+//!
+static constexpr int APPCACHE_UNDO_DEPTH = 1000;
 
 //!
 //! \brief Application cache type.
@@ -46,12 +57,15 @@ typedef std::unordered_map<std::string, AppCacheSection> AppCache;
 //! \param section Cache section to write to.
 //! \param key Entry key to write.
 //! \param value Entry value to write.
+//! \param height Height of the block that changed the entry, or -1 to skip
+//! the rollback history.
 //!
 void WriteCache(
         Section section,
         const std::string& key,
         const std::string& value,
-        int64_t locktime);
+        int64_t locktime,
+        int height = -1);
 
 //!
 //! \brief Read values from appcache section.
@@ -76,18 +90,18 @@ AppCacheSection& ReadCacheSection(Section section);
 //! \param section Section to read.
 //! \returns The data for \p section if available.
 //!
-//! Reads a cache section and transfers it to a sorted map. This can be an
-//! expensive operation and should not be used unless there is a need
-//! for sorted traversal.
+//! Sections are stored in key order, so this returns the section itself
+//! without copying it.
 //!
 //! \see ReadCacheSection
 //!
-SortedAppCacheSection ReadSortedCacheSection(Section section);
+const SortedAppCacheSection& ReadSortedCacheSection(Section section);
 
 //!
 //! \brief Clear all values in a cache section.
 //! \param section Cache section to clear.
-//! \note This only clears the values. It does not erase them.
+//! \note This only clears the values. It does not erase them. It discards
+//! the rollback history of the section.
 //!
 void ClearCache(Section section);
 
@@ -95,7 +109,55 @@ void ClearCache(Section section);
 //! \brief Erase key from appcache section.
 //! \param section Cache section to erase from.
 //! \param key Entry key to erase.
+//! \param height Height of the block that erased the entry, or -1 to skip
+//! the rollback history.
+//!
+void DeleteCache(Section section, const std::string& key, int height = -1);
+
+//!
+//! \brief Roll back the changes recorded for blocks above a height.
+//!
+//! Restores the entries that the blocks overwrote or erased and removes the
+//! entries that they added by popping the recorded changes from newest to
+//! oldest.
+//!
+//! \param height Height of the block that becomes the newest one.
+//!
+//! \return \c false when the history no longer reaches back to \p height.
+//! The caller must then rebuild the cache by replaying the contracts.
+//!
+bool RevertCache(int height);
+
 //!
-void DeleteCache(Section section, const std::string& key);
+//! \brief Estimate the heap memory used by the cache sections and their
+//! rollback history.
+//!
+size_t AppCacheDynamicUsage();
 
 Section StringToSection(const std::string& section);
+
+//!
+//! \brief Protocol parameters parsed from the PROTOCOL cache section.
+//!
+//! The cache builds a new, immutable instance each time that a write, delete,
+//! or clear touches one of the keys below so that consensus code reads typed
+//! values instead of searching and parsing strings for every block.
+//!
+struct ProtocolParameters
+{
+    int64_t block_reward;               //!< Parsed "blockreward1" value.
+    int64_t block_reward_time;          //!< Timestamp of "blockreward1".
+    bool require_team_membership;       //!< "REQUIRE_TEAM_WHITELIST_MEMBERSHIP" not "false".
+    std::set<std::string> team_whitelist; //!< Lowercase team names from "TEAM_WHITELIST".
+    uint64_t revision;                  //!< Increments with each rebuild.
+};
+
+typedef std::shared_ptr<const ProtocolParameters> ProtocolParametersPtr;
+
+//!
+//! \brief Get the current protocol parameters.
+//!
+//! \return A snapshot that stays valid while the caller holds it. Safe to
+//! call from any thread.
+//!
+ProtocolParametersPtr GetProtocolParameters();
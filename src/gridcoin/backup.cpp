@@ -65,18 +65,6 @@ int64_t GRC::GetBackupInterval()
 
 void GRC::RunBackupJob()
 {
-    TRY_LOCK(cs_main, locked_main);
-
-    if (!locked_main) {
-        return;
-    }
-
-    TRY_LOCK(pwalletMain->cs_wallet, locked_wallet);
-
-    if (!locked_wallet) {
-        return;
-    }
-
     const int64_t now = GetSystemTimeInSeconds();
 
     static const int64_t interval = GetBackupInterval();
@@ -97,11 +85,30 @@ void GRC::RunBackupJob()
         return;
     }
 
-    // Store the last backup time to the wallet file so that we can resume the
-    // configured backup schedule between node restarts:
-    //
-    pwalletMain->StoreLastBackupTime(now);
+    {
+        TRY_LOCK(cs_main, locked_main);
+
+        if (!locked_main) {
+            return;
+        }
 
+        TRY_LOCK(pwalletMain->cs_wallet, locked_wallet);
+
+        if (!locked_wallet) {
+            return;
+        }
+
+        // Store the last backup time to the wallet file so that we can resume
+        // the configured backup schedule between node restarts:
+        //
+        pwalletMain->StoreLastBackupTime(now);
+    }
+
+    // Copy the files and prune old backups without holding cs_main or the
+    // wallet lock so that block processing and staking continue during the
+    // copy of a large wallet. BackupWallet() holds bitdb.cs_db instead, which
+    // keeps the wallet database closed until the copy finishes:
+    //
     const bool wallet_result = BackupWallet(*pwalletMain, GetBackupFilename(backup_file_type[0]));
     const bool config_result = BackupConfigFile(GetBackupFilename(backup_file_type[1]));
     const bool maintain_backups_result = MaintainBackups(GetBackupPath(), backup_file_type, 0, 0, files_removed);
@@ -148,6 +155,8 @@ bool GRC::BackupWallet(const CWallet& wallet, const std::string& strDest)
     if (!wallet.fFileBacked)
         return false;
 
+    // Every wallet database handle takes cs_db to open the file. Holding it
+    // for the copy prevents writes without the need for the wallet lock:
     LOCK(bitdb.cs_db);
     if (!bitdb.mapFileUseCount.count(wallet.strWalletFile) || bitdb.mapFileUseCount[wallet.strWalletFile] == 0)
     {
@@ -5,6 +5,9 @@
 #include "base58.h"
 #include "logging.h"
 #include "main.h"
+#include "memusage.h"
+#include "streams.h"
+#include "txdb.h"
 #include "gridcoin/beacon.h"
 #include "gridcoin/contract/contract.h"
 #include "util.h"
@@ -21,6 +24,121 @@ extern int64_t g_v11_legacy_beacon_days;
 namespace {
 BeaconRegistry g_beacons;
 
+//!
+//! \brief The data stored in the transaction database for a beacon.
+//!
+//! Beacon serialization omits the timestamp and the location of the contract
+//! because contracts derive them from the transaction, so the database records
+//! store them explicitly.
+//!
+class BeaconRecord
+{
+public:
+    CPubKey m_public_key; //!< Verifies blocks that claim research rewards.
+    int64_t m_timestamp;  //!< Time of the the beacon contract transaction.
+    uint256 m_txid;       //!< Hash of the beacon contract transaction.
+    int m_height;         //!< Height of the beacon contract block.
+
+    BeaconRecord() : m_timestamp(0), m_height(0)
+    {
+    }
+
+    BeaconRecord(const Beacon& beacon)
+        : m_public_key(beacon.m_public_key)
+        , m_timestamp(beacon.m_timestamp)
+        , m_txid(beacon.m_txid)
+        , m_height(beacon.m_height)
+    {
+    }
+
+    bool Matches(const Beacon& beacon) const
+    {
+        return m_public_key == beacon.m_public_key
+            && m_timestamp == beacon.m_timestamp
+            && m_txid == beacon.m_txid
+            && m_height == beacon.m_height;
+    }
+
+    Beacon ToBeacon() const
+    {
+        Beacon beacon(m_public_key, m_timestamp);
+        beacon.m_txid = m_txid;
+        beacon.m_height = m_height;
+
+        return beacon;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(m_public_key);
+        READWRITE(m_timestamp);
+        SerializeLocation(s, ser_action);
+    }
+
+protected:
+    //!
+    //! \brief Serialize the location of the beacon contract.
+    //!
+    //! Records written before version 3 contract snapshots end before the
+    //! location. A flush only meets those as stale records to replace.
+    //!
+    template <typename Stream, typename Operation>
+    void SerializeLocation(Stream& s, Operation ser_action)
+    {
+        if (ser_action.ForRead() && s.empty()) {
+            m_txid.SetNull();
+            m_height = 0;
+            return;
+        }
+
+        READWRITE(m_txid);
+        READWRITE(m_height);
+    }
+}; // BeaconRecord
+
+//!
+//! \brief The data stored in the transaction database for a pending beacon.
+//!
+class PendingBeaconRecord : public BeaconRecord
+{
+public:
+    Cpid m_cpid; //!< Identifies the researcher that advertised the beacon.
+
+    PendingBeaconRecord()
+    {
+    }
+
+    PendingBeaconRecord(const PendingBeacon& pending)
+        : BeaconRecord(pending)
+        , m_cpid(pending.m_cpid)
+    {
+    }
+
+    bool Matches(const PendingBeacon& pending) const
+    {
+        return m_cpid == pending.m_cpid && BeaconRecord::Matches(pending);
+    }
+
+    PendingBeacon ToPendingBeacon() const
+    {
+        return PendingBeacon(m_cpid, ToBeacon());
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(m_cpid);
+        READWRITE(m_public_key);
+        READWRITE(m_timestamp);
+        SerializeLocation(s, ser_action);
+    }
+}; // PendingBeaconRecord
+
 //!
 //! \brief Compute the hash of a beacon payload object.
 //!
@@ -43,29 +161,22 @@ uint256 HashBeaconPayload(const BeaconPayload& payload)
 //! \param payload Beacon contract message from a transaction.
 //!
 //! \return \c true if the supplied beacon contract matches an active beacon.
-//! This updates the matched beacon with a new timestamp.
 //!
-bool TryRenewal(BeaconRegistry::BeaconMap& beacons, const BeaconPayload& payload)
+bool IsRenewal(const BeaconRegistry::BeaconMap& beacons, const BeaconPayload& payload)
 {
-    auto beacon_pair_iter = beacons.find(payload.m_cpid);
+    const auto beacon_pair_iter = beacons.find(payload.m_cpid);
 
     if (beacon_pair_iter == beacons.end()) {
         return false;
     }
 
-    Beacon& current_beacon = beacon_pair_iter->second;
+    const Beacon& current_beacon = beacon_pair_iter->second;
 
     if (current_beacon.Expired(payload.m_beacon.m_timestamp)) {
         return false;
     }
 
-    if (current_beacon.m_public_key != payload.m_beacon.m_public_key) {
-        return false;
-    }
-
-    current_beacon.m_timestamp = payload.m_beacon.m_timestamp;
-
-    return true;
+    return current_beacon.m_public_key == payload.m_beacon.m_public_key;
 }
 } // Anonymous namespace
 
@@ -82,7 +193,7 @@ BeaconRegistry& GRC::GetBeaconRegistry()
 // Class: Beacon
 // -----------------------------------------------------------------------------
 
-Beacon::Beacon() : m_public_key(), m_timestamp(0)
+Beacon::Beacon() : m_public_key(), m_timestamp(0), m_height(0)
 {
 }
 
@@ -94,6 +205,7 @@ Beacon::Beacon(CPubKey public_key)
 Beacon::Beacon(CPubKey public_key, int64_t timestamp)
     : m_public_key(std::move(public_key))
     , m_timestamp(timestamp)
+    , m_height(0)
 {
 }
 
@@ -235,13 +347,7 @@ bool BeaconPayload::Sign(CKey& private_key)
 
 bool BeaconPayload::VerifySignature() const
 {
-    CKey key;
-
-    if (!key.SetPubKey(m_beacon.m_public_key)) {
-        return false;
-    }
-
-    return key.Verify(HashBeaconPayload(*this), m_signature);
+    return m_beacon.m_public_key.Verify(HashBeaconPayload(*this), m_signature);
 }
 
 // -----------------------------------------------------------------------------
@@ -273,6 +379,29 @@ const BeaconRegistry::PendingBeaconMap& BeaconRegistry::PendingBeacons() const
     return m_pending;
 }
 
+size_t BeaconRegistry::DynamicMemoryUsage() const
+{
+    size_t usage = memusage::DynamicUsage(m_beacons)
+        + memusage::DynamicUsage(m_pending)
+        + memusage::DynamicUsage(m_pending_by_cpid)
+        + memusage::DynamicUsage(m_beacons_by_time)
+        + memusage::DynamicUsage(m_pending_by_time);
+
+    for (const auto& beacon_pair : m_beacons) {
+        usage += memusage::MallocUsage(beacon_pair.second.m_public_key.size());
+    }
+
+    for (const auto& pending_pair : m_pending) {
+        usage += memusage::MallocUsage(pending_pair.second.m_public_key.size());
+    }
+
+    for (const auto& index_pair : m_pending_by_cpid) {
+        usage += memusage::DynamicUsage(index_pair.second);
+    }
+
+    return usage;
+}
+
 BeaconOption BeaconRegistry::Try(const Cpid& cpid) const
 {
     const auto iter = m_beacons.find(cpid);
@@ -297,18 +426,40 @@ BeaconOption BeaconRegistry::TryActive(const Cpid& cpid, const int64_t now) cons
 
 std::vector<const PendingBeacon*> BeaconRegistry::FindPending(const Cpid cpid) const
 {
-    // TODO: consider adding a lookup table for pending beacons keyed by CPID.
-    // Since the protocol just needs to look up pending beacons by public key,
-    // we just do a search here. Informational RPCs or local beacon management
-    // only need to call this occasionally.
-
     std::vector<const PendingBeacon*> found;
 
-    for (const auto& pending_beacon_pair : m_pending) {
-        const PendingBeacon& beacon = pending_beacon_pair.second;
+    const auto index_iter = m_pending_by_cpid.find(cpid);
+
+    if (index_iter == m_pending_by_cpid.end()) {
+        return found;
+    }
+
+    for (const auto& key_id : index_iter->second) {
+        const auto iter = m_pending.find(key_id);
 
-        if (beacon.m_cpid == cpid) {
-            found.emplace_back(&beacon);
+        if (iter != m_pending.end()) {
+            found.emplace_back(&iter->second);
+        }
+    }
+
+    return found;
+}
+
+std::vector<std::pair<Cpid, const Beacon*>> BeaconRegistry::FindActive(const int64_t now) const
+{
+    std::vector<std::pair<Cpid, const Beacon*>> found;
+
+    const auto end = m_beacons_by_time.lower_bound({ now, Cpid() });
+
+    for (auto iter = m_beacons_by_time.lower_bound({ now - Beacon::MAX_AGE, Cpid() });
+        iter != end;
+        ++iter)
+    {
+        const Beacon& beacon = m_beacons.at(iter->second);
+
+        // Legacy beacons may expire earlier during the version 2 transition:
+        if (!beacon.Expired(now)) {
+            found.emplace_back(iter->second, &beacon);
         }
     }
 
@@ -333,33 +484,42 @@ void BeaconRegistry::Reset()
 {
     m_beacons.clear();
     m_pending.clear();
+    m_pending_by_cpid.clear();
+    m_beacons_by_time.clear();
+    m_pending_by_time.clear();
 }
 
 void BeaconRegistry::Add(const ContractContext& ctx)
 {
     BeaconPayload payload = ctx->CopyPayloadAs<BeaconPayload>();
     payload.m_beacon.m_timestamp = ctx.m_tx.nTime;
+    payload.m_beacon.m_txid = ctx.m_tx.GetHash();
+    payload.m_beacon.m_height = ctx.m_pindex->nHeight;
 
     // Legacy beacon contracts before block version 11--just load the beacon:
     //
     if (ctx->m_version == 1) {
-        m_beacons[payload.m_cpid] = std::move(payload.m_beacon);
+        SetBeacon(payload.m_cpid, std::move(payload.m_beacon));
         return;
     }
 
     // For beacon renewals, check that the new beacon contains the same public
     // key. If it matches, we don't need to verify it again:
     //
-    if (TryRenewal(m_beacons, payload)) {
+    if (IsRenewal(m_beacons, payload)) {
+        Beacon renewed = m_beacons.at(payload.m_cpid);
+        renewed.m_timestamp = payload.m_beacon.m_timestamp;
+        renewed.m_txid = payload.m_beacon.m_txid;
+        renewed.m_height = payload.m_beacon.m_height;
+
+        SetBeacon(payload.m_cpid, std::move(renewed));
         return;
     }
 
     // Otherwise, set the new beacon aside for scraper verification. The next
     // superblock will activate it if it matches a BOINC account:
     //
-    PendingBeacon pending(payload.m_cpid, std::move(payload.m_beacon));
-
-    m_pending.emplace(pending.GetId(), std::move(pending));
+    AddPending(PendingBeacon(payload.m_cpid, std::move(payload.m_beacon)));
 }
 
 void BeaconRegistry::Delete(const ContractContext& ctx)
@@ -367,10 +527,18 @@ void BeaconRegistry::Delete(const ContractContext& ctx)
     const auto payload = ctx->SharePayloadAs<BeaconPayload>();
 
     if (ctx->m_version >= 2) {
-        m_pending.erase(payload->m_beacon.GetId());
+        const auto iter = m_pending.find(payload->m_beacon.GetId());
+
+        if (iter != m_pending.end()) {
+            ErasePending(iter);
+        }
     }
 
-    m_beacons.erase(payload->m_cpid);
+    const auto iter = m_beacons.find(payload->m_cpid);
+
+    if (iter != m_beacons.end()) {
+        EraseBeacon(iter);
+    }
 }
 
 bool BeaconRegistry::Validate(const Contract& contract, const CTransaction& tx) const
@@ -469,30 +637,236 @@ void BeaconRegistry::ActivatePending(
         auto iter_pair = m_pending.find(id);
 
         if (iter_pair != m_pending.end()) {
-            m_beacons[iter_pair->second.m_cpid] = std::move(iter_pair->second);
-            m_pending.erase(iter_pair);
+            const Cpid cpid = iter_pair->second.m_cpid;
+
+            SetBeacon(cpid, std::move(iter_pair->second));
+            ErasePending(iter_pair);
         }
     }
 
-    for (auto iter = m_pending.begin(); iter != m_pending.end(); /* no-op */) {
-        if (iter->second.Expired(superblock_time)) {
-            iter = m_pending.erase(iter);
-        } else {
-            ++iter;
+    // Pending beacons expire oldest first, so the sweep stops at the first
+    // one that remains:
+    //
+    while (!m_pending_by_time.empty()) {
+        const auto iter = m_pending.find(m_pending_by_time.begin()->second);
+
+        if (!iter->second.Expired(superblock_time)) {
+            break;
         }
+
+        ErasePending(iter);
     }
 }
 
 void BeaconRegistry::Deactivate(const int64_t superblock_time)
 {
-    for (auto iter = m_beacons.begin(); iter != m_beacons.end(); /* no-op */) {
-        if (iter->second.m_timestamp >= superblock_time) {
-            PendingBeacon pending(iter->first, std::move(iter->second));
-            m_pending.emplace(pending.GetId(), std::move(pending));
+    std::vector<Cpid> activated;
+
+    for (auto iter = m_beacons_by_time.lower_bound({ superblock_time, Cpid() });
+        iter != m_beacons_by_time.end();
+        ++iter)
+    {
+        activated.emplace_back(iter->second);
+    }
+
+    for (const auto& cpid : activated) {
+        const auto iter = m_beacons.find(cpid);
+
+        PendingBeacon pending(cpid, iter->second);
+
+        EraseBeacon(iter);
+        AddPending(std::move(pending));
+    }
+}
+
+void BeaconRegistry::SetBeacon(const Cpid& cpid, Beacon beacon)
+{
+    const auto iter = m_beacons.find(cpid);
+
+    if (iter != m_beacons.end()) {
+        m_beacons_by_time.erase({ iter->second.m_timestamp, cpid });
+    }
+
+    m_beacons_by_time.emplace(beacon.m_timestamp, cpid);
+    m_beacons[cpid] = std::move(beacon);
+}
+
+BeaconRegistry::BeaconMap::iterator BeaconRegistry::EraseBeacon(BeaconMap::iterator iter)
+{
+    m_beacons_by_time.erase({ iter->second.m_timestamp, iter->first });
+
+    return m_beacons.erase(iter);
+}
+
+void BeaconRegistry::AddPending(PendingBeacon pending)
+{
+    const CKeyID key_id = pending.GetId();
+    const Cpid cpid = pending.m_cpid;
+    const int64_t timestamp = pending.m_timestamp;
+
+    if (m_pending.emplace(key_id, std::move(pending)).second) {
+        m_pending_by_cpid[cpid].emplace(key_id);
+        m_pending_by_time.emplace(timestamp, key_id);
+    }
+}
+
+BeaconRegistry::PendingBeaconMap::iterator
+BeaconRegistry::ErasePending(PendingBeaconMap::iterator iter)
+{
+    m_pending_by_time.erase({ iter->second.m_timestamp, iter->first });
+
+    const auto index_iter = m_pending_by_cpid.find(iter->second.m_cpid);
+
+    if (index_iter != m_pending_by_cpid.end()) {
+        index_iter->second.erase(iter->first);
+
+        if (index_iter->second.empty()) {
+            m_pending_by_cpid.erase(index_iter);
+        }
+    }
+
+    return m_pending.erase(iter);
+}
+
+bool BeaconRegistry::Flush(CTxDB& txdb) const
+{
+    std::vector<Cpid> stale_beacons;
+    std::vector<CKeyID> stale_pending;
+    std::unordered_map<Cpid, bool> current_beacons;
+    std::map<CKeyID, bool> current_pending;
+
+    // Compare the records from the last flush to the registry so that we only
+    // rewrite beacons that changed. The network renews or adds a handful of
+    // beacons between flushes out of a few thousand:
+    //
+    bool scanned = txdb.ScanRecords("beacon", [&](CDataStream& key, CDataStream& value) {
+        Cpid cpid;
+        BeaconRecord record;
+        key >> cpid;
+        value >> record;
+
+        const auto iter = m_beacons.find(cpid);
+
+        if (iter == m_beacons.end()) {
+            stale_beacons.emplace_back(cpid);
+        } else {
+            current_beacons[cpid] = record.Matches(iter->second);
+        }
+
+        return true;
+    });
+
+    scanned &= txdb.ScanRecords("pendingbeacon", [&](CDataStream& key, CDataStream& value) {
+        CKeyID key_id;
+        PendingBeaconRecord record;
+        key >> key_id;
+        value >> record;
 
-            iter = m_beacons.erase(iter);
+        const auto iter = m_pending.find(key_id);
+
+        if (iter == m_pending.end()) {
+            stale_pending.emplace_back(key_id);
         } else {
-            ++iter;
+            current_pending[key_id] = record.Matches(iter->second);
         }
+
+        return true;
+    });
+
+    if (!scanned) {
+        return error("%s: failed to scan beacon records", __func__);
+    }
+
+    for (const auto& cpid : stale_beacons) {
+        txdb.EraseRecord("beacon", cpid);
     }
+
+    for (const auto& key_id : stale_pending) {
+        txdb.EraseRecord("pendingbeacon", key_id);
+    }
+
+    for (const auto& beacon_pair : m_beacons) {
+        const auto iter = current_beacons.find(beacon_pair.first);
+
+        if (iter != current_beacons.end() && iter->second) {
+            continue;
+        }
+
+        if (!txdb.WriteRecord("beacon", beacon_pair.first, BeaconRecord(beacon_pair.second)))
+        {
+            return error("%s: failed to write beacon record", __func__);
+        }
+    }
+
+    for (const auto& pending_pair : m_pending) {
+        const auto iter = current_pending.find(pending_pair.first);
+
+        if (iter != current_pending.end() && iter->second) {
+            continue;
+        }
+
+        if (!txdb.WriteRecord(
+            "pendingbeacon",
+            pending_pair.first,
+            PendingBeaconRecord(pending_pair.second)))
+        {
+            return error("%s: failed to write pending beacon record", __func__);
+        }
+    }
+
+    LogPrint(LogFlags::CONTRACT,
+        "%s: %u beacons, %u pending, %u erased",
+        __func__,
+        m_beacons.size(),
+        m_pending.size(),
+        stale_beacons.size() + stale_pending.size());
+
+    return true;
+}
+
+bool BeaconRegistry::Load(CTxDB& txdb)
+{
+    Reset();
+
+    try {
+        bool scanned = txdb.ScanRecords("beacon", [&](CDataStream& key, CDataStream& value) {
+            Cpid cpid;
+            BeaconRecord record;
+            key >> cpid;
+            value >> record;
+
+            SetBeacon(cpid, record.ToBeacon());
+
+            return true;
+        });
+
+        scanned &= txdb.ScanRecords("pendingbeacon", [&](CDataStream& key, CDataStream& value) {
+            CKeyID key_id;
+            PendingBeaconRecord record;
+            key >> key_id;
+            value >> record;
+
+            PendingBeacon pending = record.ToPendingBeacon();
+            const Cpid cpid = pending.m_cpid;
+
+            const int64_t timestamp = pending.m_timestamp;
+
+            if (m_pending.emplace(key_id, std::move(pending)).second) {
+                m_pending_by_cpid[cpid].emplace(key_id);
+                m_pending_by_time.emplace(timestamp, key_id);
+            }
+
+            return true;
+        });
+
+        if (!scanned) {
+            Reset();
+            return error("%s: failed to scan beacon records", __func__);
+        }
+    } catch (const std::exception& e) {
+        Reset();
+        return error("%s: malformed beacon record: %s", __func__, e.what());
+    }
+
+    return true;
 }
@@ -10,11 +10,13 @@
 #include "gridcoin/cpid.h"
 #include "serialize.h"
 
+#include <set>
 #include <string>
 #include <vector>
 
 class CBitcoinAddress;
 class CTransaction;
+class CTxDB;
 class CWallet;
 
 namespace GRC {
@@ -67,6 +69,22 @@ public:
     CPubKey m_public_key;      //!< Verifies blocks that claim research rewards.
     int64_t m_timestamp;       //!< Time of the the beacon contract transaction.
 
+    //!
+    //! \brief Hash of the transaction with the contract that advertised or
+    //! last renewed the beacon.
+    //!
+    //! Set by the beacon registry. Not part of the contract payload.
+    //!
+    uint256 m_txid;
+
+    //!
+    //! \brief Height of the block with the contract that advertised or last
+    //! renewed the beacon.
+    //!
+    //! Set by the beacon registry. Not part of the contract payload.
+    //!
+    int m_height;
+
     //!
     //! \brief Initialize an empty, invalid beacon instance.
     //!
@@ -428,6 +446,13 @@ public:
     //!
     const PendingBeaconMap& PendingBeacons() const;
 
+    //!
+    //! \brief Estimate the heap memory used by the registry.
+    //!
+    //! \return Bytes used by the beacons, the pending beacons and the indexes.
+    //!
+    size_t DynamicMemoryUsage() const;
+
     //!
     //! \brief Get the beacon for the specified CPID.
     //!
@@ -458,6 +483,20 @@ public:
     //!
     std::vector<const PendingBeacon*> FindPending(const Cpid cpid) const;
 
+    //!
+    //! \brief Get the beacons that were active at the specified time.
+    //!
+    //! Reads the beacons in the window of valid timestamps from the timestamp
+    //! index, so the cost depends on the number of beacons in the window and
+    //! not on the size of the registry.
+    //!
+    //! \param now The time in seconds to check from for beacon expiration.
+    //!
+    //! \return The CPIDs and beacons advertised before \p now that did not
+    //! expire by then, ordered by timestamp.
+    //!
+    std::vector<std::pair<Cpid, const Beacon*>> FindActive(const int64_t now) const;
+
     //!
     //! \brief Determine whether a beacon is active for the specified CPID.
     //!
@@ -527,9 +566,87 @@ public:
     //!
     void Deactivate(const int64_t superblock_time);
 
+    //!
+    //! \brief Write the registered and pending beacons to the transaction
+    //! database.
+    //!
+    //! The database stores one record per beacon keyed by CPID and one record
+    //! per pending beacon keyed by public key ID. A flush only writes records
+    //! that changed since the previous flush and erases the records for any
+    //! beacons no longer in the registry.
+    //!
+    //! \param txdb Transaction database to write the records to. The caller
+    //! should open a batch to commit the records atomically with other state.
+    //!
+    //! \return \c false if a record failed to write.
+    //!
+    bool Flush(CTxDB& txdb) const;
+
+    //!
+    //! \brief Replace the registry state with the beacon records written by
+    //! the last flush.
+    //!
+    //! \param txdb Transaction database to read the records from.
+    //!
+    //! \return \c false if the records failed to load. The registry remains
+    //! empty in this case.
+    //!
+    bool Load(CTxDB& txdb);
+
 private:
+    //!
+    //! \brief Associates CPIDs with the keys of their pending beacons.
+    //!
+    typedef std::unordered_map<Cpid, std::set<CKeyID>> PendingCpidIndex;
+
+    //!
+    //! \brief Orders active beacons by their timestamps.
+    //!
+    typedef std::set<std::pair<int64_t, Cpid>> BeaconTimeIndex;
+
+    //!
+    //! \brief Orders pending beacons by their timestamps.
+    //!
+    typedef std::set<std::pair<int64_t, CKeyID>> PendingTimeIndex;
+
     BeaconMap m_beacons;        //!< Contains the active registered beacons.
     PendingBeaconMap m_pending; //!< Contains beacons awaiting verification.
+    PendingCpidIndex m_pending_by_cpid; //!< Looks up pending beacons by CPID.
+    BeaconTimeIndex m_beacons_by_time;  //!< Active beacons by timestamp.
+    PendingTimeIndex m_pending_by_time; //!< Pending beacons by timestamp.
+
+    //!
+    //! \brief Store or replace the active beacon for a CPID.
+    //!
+    //! \param cpid   CPID of the beacon owner.
+    //! \param beacon The beacon to activate.
+    //!
+    void SetBeacon(const Cpid& cpid, Beacon beacon);
+
+    //!
+    //! \brief Remove an active beacon and its timestamp index entry.
+    //!
+    //! \param iter Points to the beacon to remove.
+    //!
+    //! \return An iterator to the next beacon.
+    //!
+    BeaconMap::iterator EraseBeacon(BeaconMap::iterator iter);
+
+    //!
+    //! \brief Store a pending beacon unless one exists for the same key.
+    //!
+    //! \param pending The beacon to set aside for verification.
+    //!
+    void AddPending(PendingBeacon pending);
+
+    //!
+    //! \brief Remove a pending beacon and its index entries.
+    //!
+    //! \param iter Points to the pending beacon to remove.
+    //!
+    //! \return An iterator to the next pending beacon.
+    //!
+    PendingBeaconMap::iterator ErasePending(PendingBeaconMap::iterator iter);
 }; // BeaconRegistry
 
 //!
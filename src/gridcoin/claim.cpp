@@ -107,7 +107,7 @@ Claim Claim::Parse(const std::string& claim, int block_version)
         case 25: c.m_magnitude_unit = RoundFromString(s[25], MAG_UNIT_PLACES);
         case 24: //c.m_research_age = RoundFromString(s[24], 6);
         case 23: //c.ResearchSubsidy2 = RoundFromString(s[23], subsidy_places);
-        case 22: c.m_superblock.Replace(Superblock::UnpackLegacy(s[22]));
+        case 22: c.m_superblock.Replace(Superblock::UnpackLegacyCached(s[22]));
         case 21: if (!c.m_quorum_hash.Valid())
                     c.m_quorum_hash = QuorumHash::Parse(s[21]);
         case 20: //c.OrganizationKey = s[20];
@@ -216,15 +216,9 @@ bool Claim::VerifySignature(
     const uint256& last_block_hash,
     const CTransaction& coinstake_tx) const
 {
-    CKey key;
-
-    if (!key.SetPubKey(public_key)) {
-        return false;
-    }
-
     const uint256 hash = GetClaimHash(*this, last_block_hash, coinstake_tx);
 
-    return key.Verify(hash, m_signature);
+    return public_key.Verify(hash, m_signature);
 }
 
 uint256 Claim::GetHash() const
@@ -10,17 +10,36 @@
 #include "gridcoin/beacon.h"
 #include "gridcoin/project.h"
 #include "gridcoin/researcher.h"
+#include "gridcoin/scraper/scraper_net.h"
 #include "gridcoin/support/block_finder.h"
 #include "gridcoin/support/xml.h"
 #include "gridcoin/tx_message.h"
 #include "gridcoin/voting/payloads.h"
 #include "gridcoin/voting/registry.h"
+#include "streams.h"
+#include "txdb.h"
 #include "util.h"
+#include "util/perf.h"
 #include "wallet/wallet.h"
 
 using namespace GRC;
 
 namespace {
+//!
+//! \brief Version of the serialized contract state snapshot format.
+//!
+//! Increment this value when changing the snapshot format of any contract
+//! handler. Nodes discard snapshots with a different version and fall back
+//! to a full contract replay.
+//!
+constexpr int CONTRACT_SNAPSHOT_VERSION = 3;
+
+//!
+//! \brief Number of blocks connected after the stored contract state snapshot
+//! before the next one becomes due.
+//!
+constexpr int CONTRACT_SNAPSHOT_INTERVAL = 1000;
+
 //!
 //! \brief An empty, invalid contract payload.
 //!
@@ -167,7 +186,8 @@ public:
             StringToSection(ctx->m_type.ToString()),
             payload->m_key,
             payload->m_value,
-            ctx.m_tx.nTime);
+            ctx.m_tx.nTime,
+            ctx.m_pindex->nHeight);
     }
 
     void Delete(const ContractContext& ctx) override
@@ -176,7 +196,67 @@ public:
 
         DeleteCache(
             StringToSection(ctx->m_type.ToString()),
-            payload->m_key);
+            payload->m_key,
+            ctx.m_pindex->nHeight);
+    }
+
+    //!
+    //! \brief Roll back the AppCache changes made by the contract's block.
+    //!
+    //! This restores the entry that the contract overwrote or erased. It falls
+    //! back to the inverse action when the history no longer reaches back to
+    //! the block.
+    //!
+    void Revert(const ContractContext& ctx) override
+    {
+        if (!RevertCache(ctx.m_pindex->nHeight - 1)) {
+            IContractHandler::Revert(ctx);
+        }
+    }
+
+    //!
+    //! \brief Serialize the contract sections of the AppCache for a contract
+    //! state snapshot.
+    //!
+    //! \param stream Receives the serialized AppCache entries.
+    //!
+    void WriteSnapshot(CDataStream& stream) const
+    {
+        for (const auto section : { Section::PROTOCOL, Section::SCRAPER }) {
+            const AppCacheSection& entries = ReadCacheSection(section);
+
+            WriteCompactSize(stream, entries.size());
+
+            for (const auto& entry_pair : entries) {
+                stream << entry_pair.first
+                    << entry_pair.second.value
+                    << entry_pair.second.timestamp;
+            }
+        }
+    }
+
+    //!
+    //! \brief Replace the contract sections of the AppCache with entries from
+    //! a contract state snapshot.
+    //!
+    //! \param stream Contains the AppCache entries serialized by
+    //! \c WriteSnapshot().
+    //!
+    void ReadSnapshot(CDataStream& stream)
+    {
+        Reset();
+
+        for (const auto section : { Section::PROTOCOL, Section::SCRAPER }) {
+            for (uint64_t count = ReadCompactSize(stream); count > 0; --count) {
+                std::string key;
+                std::string value;
+                int64_t timestamp;
+
+                stream >> key >> value >> timestamp;
+
+                WriteCache(section, key, value, timestamp);
+            }
+        }
     }
 };
 
@@ -246,6 +326,65 @@ public:
         m_appcache_handler.Reset();
     }
 
+    //!
+    //! \brief Serialize the cached state of each contract handler.
+    //!
+    //! The beacon registry stores its state as individual records so this
+    //! does not include beacons. Flush the registry in the same batch.
+    //!
+    //! \param stream Receives the serialized contract state.
+    //!
+    void WriteSnapshot(CDataStream& stream) const
+    {
+        stream << CONTRACT_SNAPSHOT_VERSION;
+
+        GetPollRegistry().WriteSnapshot(stream);
+        GetWhitelist().WriteSnapshot(stream);
+        m_appcache_handler.WriteSnapshot(stream);
+    }
+
+    //!
+    //! \brief Replace the cached state of each contract handler with the data
+    //! from a contract state snapshot.
+    //!
+    //! \param txdb   Transaction database to load the beacon records from.
+    //! \param stream Contains the contract state serialized by
+    //! \c WriteSnapshot().
+    //!
+    //! \return \c false if the snapshot is malformed or uses an unknown format.
+    //! The contract handlers remain in the reset state in this case.
+    //!
+    bool ReadSnapshot(CTxDB& txdb, CDataStream& stream)
+    {
+        try {
+            int version;
+            stream >> version;
+
+            if (version != CONTRACT_SNAPSHOT_VERSION) {
+                LogPrint(BCLog::LogFlags::CONTRACT,
+                    "%s: ignored snapshot version %d", __func__, version);
+
+                return false;
+            }
+
+            if (!GetBeaconRegistry().Load(txdb)) {
+                ResetHandlers();
+                return false;
+            }
+
+            GetPollRegistry().ReadSnapshot(stream);
+            GetWhitelist().ReadSnapshot(stream);
+            m_appcache_handler.ReadSnapshot(stream);
+        } catch (const std::exception& e) {
+            LogPrintf("WARNING: %s: malformed contract snapshot: %s", __func__, e.what());
+            ResetHandlers();
+
+            return false;
+        }
+
+        return true;
+    }
+
     //!
     //! \brief Validate the provided contract and forward it to the appropriate
     //! contract handler.
@@ -257,12 +396,14 @@ public:
         if (ctx->m_action == ContractAction::ADD) {
             ctx->Log("INFO: Add contract");
             GetHandler(ctx->m_type.Value()).Add(ctx);
+            NotifyScraper(ctx->m_type.Value());
             return;
         }
 
         if (ctx->m_action == ContractAction::REMOVE) {
             ctx->Log("INFO: Delete contract");
             GetHandler(ctx->m_type.Value()).Delete(ctx);
+            NotifyScraper(ctx->m_type.Value());
             return;
         }
 
@@ -296,6 +437,7 @@ public:
         // (addition or deletion) declared in the contract argument, but the
         // type-specific handlers may override this behavior as needed:
         GetHandler(ctx->m_type.Value()).Revert(ctx);
+        NotifyScraper(ctx->m_type.Value());
     }
 
 private:
@@ -323,6 +465,25 @@ private:
             default:                       return m_unknown_handler;
         }
     }
+
+    //!
+    //! \brief Wake the scraper threads for a change to their inputs: the
+    //! beacons, the project whitelist or the authorized scrapers.
+    //!
+    //! \param type Type of the contract applied or reverted.
+    //!
+    static void NotifyScraper(const ContractType type)
+    {
+        switch (type) {
+            case ContractType::BEACON:
+            case ContractType::PROJECT:
+            case ContractType::SCRAPER:
+                WakeScraper(true);
+                break;
+            default:
+                break;
+        }
+    }
 }; // class Dispatcher
 
 //!
@@ -330,6 +491,99 @@ private:
 //!
 Dispatcher g_dispatcher;
 
+//!
+//! \brief Block index of the stored contract state snapshot, or \c nullptr
+//! when the database contains none.
+//!
+//! CheckpointContracts() reads the stored snapshot on the first call. After
+//! that, the snapshot functions keep this up to date as they write and erase
+//! the snapshot record.
+//!
+const CBlockIndex* g_pindex_snapshot = nullptr;
+
+//!
+//! \brief Whether \c g_pindex_snapshot reflects the snapshot record yet.
+//!
+bool g_snapshot_known = false;
+
+//!
+//! \brief Find the block index of the stored contract state snapshot.
+//!
+//! \return The block index of the snapshot, or \c nullptr when none exists or
+//! the block is unknown.
+//!
+const CBlockIndex* FindStoredSnapshot(CTxDB& txdb)
+{
+    uint256 snapshot_hash;
+    std::vector<unsigned char> state;
+
+    if (!txdb.ReadContractSnapshot(snapshot_hash, state)) {
+        return nullptr;
+    }
+
+    const auto iter = mapBlockIndex.find(snapshot_hash);
+
+    if (iter == mapBlockIndex.end()) {
+        return nullptr;
+    }
+
+    return iter->second;
+}
+
+//!
+//! \brief Load the contract handler state from the most recent snapshot.
+//!
+//! \param pindex_start Block index of the first block in the replay window.
+//! Snapshots taken before this block are too old to resume from.
+//!
+//! \return Block index of the snapshot if the contract handlers now contain
+//! its state, or \c nullptr when the caller must replay the full window.
+//!
+const CBlockIndex* TryLoadContractSnapshot(const CBlockIndex* const pindex_start)
+{
+    CTxDB txdb("r");
+    uint256 snapshot_hash;
+    std::vector<unsigned char> state;
+
+    if (!txdb.ReadContractSnapshot(snapshot_hash, state)) {
+        return nullptr;
+    }
+
+    const auto iter = mapBlockIndex.find(snapshot_hash);
+
+    if (iter == mapBlockIndex.end()) {
+        return nullptr;
+    }
+
+    const CBlockIndex* const pindex_snapshot = iter->second;
+
+    // A reorganization may have disconnected the snapshot block, or the node
+    // may have been offline long enough for the window to move past it:
+    //
+    if (!pindex_snapshot->IsInMainChain()
+        || pindex_snapshot->nHeight < pindex_start->nHeight)
+    {
+        LogPrint(BCLog::LogFlags::CONTRACT,
+            "%s: ignored stale snapshot at block %" PRId64,
+            __func__,
+            pindex_snapshot->nHeight);
+
+        return nullptr;
+    }
+
+    CDataStream stream(state, SER_DISK, CLIENT_VERSION);
+
+    if (!g_dispatcher.ReadSnapshot(txdb, stream)) {
+        return nullptr;
+    }
+
+    // Rescan in-memory project CPIDs in case the snapshot changed the team
+    // requirement settings in the protocol section:
+    Researcher::MarkDirty();
+
+    return pindex_snapshot;
+}
+
 } // anonymous namespace
 
 // -----------------------------------------------------------------------------
@@ -357,14 +611,26 @@ void GRC::ReplayContracts(const CBlockIndex* pindex)
     static BlockFinder blockFinder;
     pindex = blockFinder.FindByMinTime(pindex->nTime - Beacon::MAX_AGE);
 
-    LogPrint(BCLog::LogFlags::CONTRACT,
-        "Replaying contracts from block %" PRId64 "...", pindex->nHeight);
-
     if (pindex->nHeight < (fTestNet ? 1 : 164618)) {
        return;
     }
 
-    g_dispatcher.ResetHandlers();
+    // Resume from the last contract state snapshot when possible. This just
+    // replays the blocks connected since the snapshot instead of the entire
+    // six month window:
+    //
+    if (const CBlockIndex* const pindex_snapshot = TryLoadContractSnapshot(pindex)) {
+        pindex = pindex_snapshot->pnext;
+
+        LogPrint(BCLog::LogFlags::CONTRACT,
+            "Replaying contracts from snapshot at block %" PRId64 "...",
+            pindex_snapshot->nHeight);
+    } else {
+        LogPrint(BCLog::LogFlags::CONTRACT,
+            "Replaying contracts from block %" PRId64 "...", pindex->nHeight);
+
+        g_dispatcher.ResetHandlers();
+    }
 
     CBlock block;
 
@@ -380,26 +646,105 @@ void GRC::ReplayContracts(const CBlockIndex* pindex)
         }
 
         if (pindex->nIsSuperBlock == 1 && pindex->nVersion >= 11) {
-            if (block.hashPrevBlock != pindex->pprev->GetBlockHash()
-                && !block.ReadFromDisk(pindex))
-            {
+            // Decode the superblock from the block just read for contracts.
+            // Otherwise, load it through the superblock cache shared with the
+            // quorum and the tally. They already hold the recent superblocks
+            // at startup, so this avoids reading those blocks again:
+            //
+            const SuperblockPtr superblock = pindex->nIsContract == 1
+                ? block.GetSuperblock(pindex)
+                : SuperblockPtr::ReadFromDisk(pindex);
+
+            if (!superblock->WellFormed()) {
                 continue;
             }
 
             GetBeaconRegistry().ActivatePending(
-                block.GetSuperblock()->m_verified_beacons.m_verified,
-                block.GetBlockTime());
+                superblock->m_verified_beacons.m_verified,
+                pindex->GetBlockTime());
         }
     }
 
     Researcher::Refresh();
 }
 
+bool GRC::WriteContractSnapshot(CTxDB& txdb, const CBlockIndex* const pindex)
+{
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    g_dispatcher.WriteSnapshot(stream);
+
+    // Commit the beacon records and the snapshot of the remaining contract
+    // state together so that both always reflect the same block:
+    //
+    txdb.TxnBegin();
+
+    if (!GetBeaconRegistry().Flush(txdb)
+        || !txdb.WriteContractSnapshot(
+            pindex->GetBlockHash(),
+            std::vector<unsigned char>(stream.begin(), stream.end()))
+        || !txdb.TxnCommit())
+    {
+        txdb.TxnAbort();
+        return error("%s: failed to write contract snapshot", __func__);
+    }
+
+    g_pindex_snapshot = pindex;
+    g_snapshot_known = true;
+
+    LogPrint(BCLog::LogFlags::CONTRACT,
+        "%s: wrote contract snapshot at block %" PRId64 " (%u bytes)",
+        __func__,
+        pindex->nHeight,
+        stream.size());
+
+    return true;
+}
+
+void GRC::CheckpointContracts(CTxDB& txdb, const CBlockIndex* const pindex)
+{
+    if (!g_snapshot_known) {
+        g_pindex_snapshot = FindStoredSnapshot(txdb);
+        g_snapshot_known = true;
+    }
+
+    // A reorganization disconnected the block of the stored snapshot. Replay
+    // cannot resume from it, so drop it and take a new snapshot of the state
+    // at the new chain tip:
+    //
+    if (g_pindex_snapshot && !g_pindex_snapshot->IsInMainChain()) {
+        LogPrint(BCLog::LogFlags::CONTRACT,
+            "%s: dropping snapshot of disconnected block %" PRId64,
+            __func__,
+            g_pindex_snapshot->nHeight);
+
+        if (!txdb.EraseContractSnapshot()) {
+            error("%s: failed to erase contract snapshot", __func__);
+            return;
+        }
+
+        g_pindex_snapshot = nullptr;
+    }
+
+    // Count the distance from the stored snapshot rather than checking for a
+    // multiple of the interval, so that a tip that skips past an interval by
+    // connecting several blocks at once still triggers a snapshot:
+    //
+    if (g_pindex_snapshot
+        && pindex->nHeight - g_pindex_snapshot->nHeight < CONTRACT_SNAPSHOT_INTERVAL)
+    {
+        return;
+    }
+
+    WriteContractSnapshot(txdb, pindex);
+}
+
 void GRC::ApplyContracts(
     const CBlock& block,
     const CBlockIndex* const pindex,
     bool& out_found_contract)
 {
+    PERF_SCOPE("ApplyContracts");
+
     out_found_contract = false;
 
     // Skip coinbase and coinstake transactions:
@@ -717,14 +1062,14 @@ bool Contract::SignWithMessageKey()
 
 bool Contract::VerifySignature() const
 {
-    CKey key;
+    const CPubKey& public_key = ResolvePublicKey();
 
-    if (!key.SetPubKey(ResolvePublicKey())) {
+    if (!public_key.IsValid()) {
         Log("ERROR: Failed to set contract public key");
         return false;
     }
 
-    return key.Verify(GetHash(), m_signature.Raw());
+    return public_key.Verify(GetHash(), m_signature.Raw());
 }
 
 uint256 Contract::GetHash() const
@@ -853,6 +1198,19 @@ Contract::Body::Body(ContractPayload payload)
 {
 }
 
+Contract::Body::Body(const Body& other)
+    : m_payload(other.m_payload)
+{
+}
+
+Contract::Body& Contract::Body::operator=(const Body& other)
+{
+    m_payload = other.m_payload;
+    m_converted = boost::none;
+
+    return *this;
+}
+
 bool Contract::Body::WellFormed(const ContractAction action) const
 {
     return m_payload->WellFormed(action);
@@ -864,6 +1222,15 @@ ContractPayload Contract::Body::AssumeLegacy() const
 }
 
 ContractPayload Contract::Body::ConvertFromLegacy(const ContractType type) const
+{
+    if (!m_converted || m_converted->first != type) {
+        m_converted = std::make_pair(type, ParseLegacy(type));
+    }
+
+    return m_converted->second;
+}
+
+ContractPayload Contract::Body::ParseLegacy(const ContractType type) const
 {
     // We use static_cast here instead of dynamic_cast to avoid the lookup. The
     // value of m_payload is guaranteed to be a LegacyPayload for v1 contracts.
@@ -904,6 +1271,8 @@ ContractPayload Contract::Body::ConvertFromLegacy(const ContractType type) const
 
 void Contract::Body::ResetType(const ContractType type)
 {
+    m_converted = boost::none;
+
     switch (type) {
         case ContractType::UNKNOWN:
             m_payload.Reset(new EmptyPayload());
@@ -16,6 +16,7 @@
 class CBlock;
 class CBlockIndex;
 class CTransaction;
+class CTxDB;
 
 namespace GRC {
 //!
@@ -133,6 +134,15 @@ public:
         //!
         Body(ContractPayload payload);
 
+        //!
+        //! \brief Copy a contract body without the parsed legacy payload so
+        //! that moving the payload out of a copy leaves the original intact.
+        //!
+        Body(const Body& other);
+        Body(Body&& other) = default;
+        Body& operator=(const Body& other);
+        Body& operator=(Body&& other) = default;
+
         //!
         //! \brief Determine whether the object contains a well-formed payload.
         //!
@@ -167,7 +177,8 @@ public:
         //!
         //! Version 1 contracts always contain a legacy payload object. This
         //! method parses the legacy payload into an IContractPayload object
-        //! that matches the contract type.
+        //! that matches the contract type. It parses the payload on the first
+        //! call and returns the same object after that.
         //!
         //! \param type Determines the type to convert a legacy payload into.
         //!
@@ -202,6 +213,18 @@ public:
     private:
         ContractPayload m_payload; //!< Data specific to the contract type.
 
+        //!
+        //! \brief Legacy payload parsed by ConvertFromLegacy() and the type
+        //! that it was parsed as.
+        //!
+        mutable boost::optional<std::pair<ContractType, ContractPayload>> m_converted;
+
+        //!
+        //! \brief Parse the legacy payload into an IContractPayload object for
+        //! the specified type.
+        //!
+        ContractPayload ParseLegacy(const ContractType type) const;
+
         //!
         //! \brief Reinitialize the contract body with an IContractHandler
         //! object for the specified contract type.
@@ -559,7 +582,12 @@ public:
         // Since only handlers for a particular contract type should access the
         // the payload, the derived type is known at the casting site.
         //
-        return std::move(static_cast<PayloadType&>(*SharePayload()));;
+        ContractPayload payload = SharePayload();
+
+        // Parse the legacy payload again if needed after moving it out:
+        m_body.m_converted = boost::none;
+
+        return std::move(static_cast<PayloadType&>(*payload));
     }
 
     //!
@@ -700,6 +728,30 @@ Contract MakeLegacyContract(
 //!
 void ReplayContracts(const CBlockIndex* pindex);
 
+//!
+//! \brief Store the state of the contract handlers as a snapshot that
+//! \c ReplayContracts() resumes from instead of replaying six months of
+//! contracts.
+//!
+//! \param txdb   Transaction database to write the snapshot to.
+//! \param pindex Block index of the chain tip that the state reflects.
+//!
+//! \return \c false if the database write fails.
+//!
+bool WriteContractSnapshot(CTxDB& txdb, const CBlockIndex* const pindex);
+
+//!
+//! \brief Write a contract state snapshot when the chain tip moved a snapshot
+//! interval past the stored snapshot.
+//!
+//! Drops the stored snapshot when a reorganization disconnected its block and
+//! writes a new one at the chain tip instead.
+//!
+//! \param txdb   Transaction database to write the snapshot to.
+//! \param pindex Block index of the new chain tip.
+//!
+void CheckpointContracts(CTxDB& txdb, const CBlockIndex* const pindex);
+
 //!
 //! \brief Apply contracts from transactions in a block by passing them to the
 //! appropriate contract handlers.
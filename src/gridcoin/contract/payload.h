@@ -35,6 +35,10 @@ class CSizeComputer;
     {                                                                                 \
         SerializationOp(s, CSerActionUnserialize(), action);                          \
     }                                                                                 \
+    void Unserialize(SpanReader& s, const GRC::ContractAction action) override        \
+    {                                                                                 \
+        SerializationOp(s, CSerActionUnserialize(), action);                          \
+    }                                                                                 \
     void Serialize(CSizeComputer& s, const GRC::ContractAction action) const override \
     {                                                                                 \
         NCONST_PTR(this)->SerializationOp(s, CSerActionSerialize(), action);          \
@@ -147,6 +151,11 @@ public:
     //!
     virtual void Unserialize(CDataStream& s, const ContractAction action) = 0;
 
+    //!
+    //! \brief Deserialize a contract from the provided memory span.
+    //!
+    virtual void Unserialize(SpanReader& s, const ContractAction action) = 0;
+
     //!
     //! \brief Write the contract data to a hasher.
     //!
@@ -5,6 +5,7 @@
 #pragma once
 
 #include "serialize.h"
+#include "util/hasher.h"
 
 #include <array>
 #include <boost/optional.hpp>
@@ -23,6 +24,11 @@ namespace GRC {
 class Cpid
 {
 public:
+    //!
+    //! \brief Vectors of CPIDs serialize in bulk.
+    //!
+    static constexpr bool BULK_SERIALIZABLE = true;
+
     //!
     //! \brief Initialize a zero-value CPID object.
     //!
@@ -466,15 +472,14 @@ struct hash<GRC::Cpid>
     //!
     //! \param cpid Contains the bytes to hash.
     //!
-    //! \return A hash as the sum of the two halves of the bytes in the CPID.
+    //! \return The salted SipHash-1-3 of the bytes in the CPID.
     //!
     size_t operator()(const GRC::Cpid& cpid) const
     {
-        // Just convert the CPID into a value that we can store in a size_t
-        // object. CPIDs are already unique identifiers.
+        // Anyone can advertise a beacon for a CPID of their choice, so hash
+        // it with a salt to keep the tables keyed by CPID evenly loaded:
         //
-        return *reinterpret_cast<const uint64_t*>(cpid.Raw().data())
-            + *reinterpret_cast<const uint64_t*>(cpid.Raw().data() + 8);
+        return SaltedSipHash(cpid.Raw().data(), cpid.Raw().size());
     }
 };
 }
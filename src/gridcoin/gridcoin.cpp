@@ -21,7 +21,11 @@ using namespace GRC;
 extern bool fExplorer;
 extern unsigned int nScraperSleep;
 extern unsigned int nActiveBeforeSB;
+extern unsigned int nScraperParallelDownloads;
+extern unsigned int nScraperProcessingThreads;
+extern uint64_t nScraperPastConvergencesMaxBytes;
 extern bool fScraperActive;
+extern bool fScraperEventDriven;
 
 extern ThreadHandler* netThreads;
 
@@ -44,6 +48,11 @@ void InitializeSuperblockQuorum(const CBlockIndex* pindexBest)
 
         Quorum::LoadSuperblockIndex(pindexBest);
     }
+
+    // The chain tip view published while loading the block index predates
+    // the superblock cache:
+    LOCK(cs_main);
+    PublishChainTipView();
 }
 
 //!
@@ -163,6 +172,14 @@ void InitializeScraper()
     nScraperSleep = std::min<int64_t>(std::max<int64_t>(GetArg("-scrapersleep", 300), 60), 600) * 1000;
     // Default to 7200 sec (4 hrs), clamp to 300 minimum, 86400 maximum (meaning active all of the time).
     nActiveBeforeSB = std::min<int64_t>(std::max<int64_t>(GetArg("-activebeforesb", 14400), 300), 86400);
+    // Default to 4 concurrent project stats transfers, clamp to 1 minimum, 16 maximum.
+    nScraperParallelDownloads = std::min<int64_t>(std::max<int64_t>(GetArg("-scraperparalleldownloads", 4), 1), 16);
+    // Default to 4 project stats processing threads, clamp to 1 minimum, 16 maximum.
+    nScraperProcessingThreads = std::min<int64_t>(std::max<int64_t>(GetArg("-scraperprocessingthreads", 4), 1), 16);
+    // Default to 256 MiB for the past convergences, clamp to 16 MiB minimum, 4096 MiB maximum.
+    nScraperPastConvergencesMaxBytes = std::min<int64_t>(std::max<int64_t>(GetArg("-scraperpastconvergencesmb", 256), 16), 4096) * 1024 * 1024;
+    // Wake on new manifests and chain changes instead of polling every -scrapersleep seconds.
+    fScraperEventDriven = GetBoolArg("-scraperevents", false);
 
     // Run the scraper or subscriber housekeeping thread, but not both. The
     // subscriber housekeeping thread checks if the flag for the scraper thread
@@ -223,7 +240,7 @@ void ScheduleBackups(CScheduler& scheduler)
     // a cycle when it encounters lock contention or when a cycle occurs
     // sooner than the requested interval:
     //
-    scheduler.scheduleEvery(RunBackupJob, GetBackupInterval() * 1000 / 4);
+    scheduler.scheduleEvery(RunBackupJob, GetBackupInterval() * 1000 / 4, "backup");
 
     // Run the backup job on start-up in case the wallet started after a
     // long period of downtime. Some usage patterns may cause the wallet
@@ -232,7 +249,7 @@ void ScheduleBackups(CScheduler& scheduler)
     // the wallet contains a stored backup timestamp later than the next
     // scheduled backup interval:
     //
-    scheduler.scheduleFromNow(RunBackupJob, 60 * 1000);
+    scheduler.scheduleFromNow(RunBackupJob, 60 * 1000, "backup");
 }
 
 //!
@@ -264,12 +281,12 @@ void ScheduleUpdateChecks(CScheduler& scheduler)
 
     scheduler.scheduleEvery([]{
         g_UpdateChecker->CheckForLatestUpdate();
-    }, hours * 60 * 60 * 1000);
+    }, hours * 60 * 60 * 1000, "updatecheck");
 
     // Schedule a start-up check one minute from now:
     scheduler.scheduleFromNow([]{
         g_UpdateChecker->CheckForLatestUpdate();
-    }, 60 * 1000);
+    }, 60 * 1000, "updatecheck");
 }
 } // Anonymous namespace
 
@@ -288,14 +305,31 @@ bool GRC::Initialize(CBlockIndex* pindexBest)
 {
     LogPrintf("Gridcoin: initializing...");
 
+    // The stages run in order. The tally reads the superblock that the quorum
+    // loads, replaying contracts records legacy quorum votes, and the local
+    // researcher context needs the replayed beacons:
+    //
+    int64_t start_time = GetTimeMillis();
+    const auto log_stage_time = [&start_time](const char* stage) {
+        const int64_t now = GetTimeMillis();
+        LogPrintf("Gridcoin: %-16s %15" PRId64 "ms", stage, now - start_time);
+        start_time = now;
+    };
+
     InitializeSuperblockQuorum(pindexBest);
+    log_stage_time("superblocks");
 
     if (!InitializeResearchRewardAccounting(pindexBest)) {
         return false;
     }
 
+    log_stage_time("tally");
+
     InitializeContracts(pindexBest);
+    log_stage_time("contracts");
+
     InitializeResearcherContext();
+    log_stage_time("researcher");
 
     // The scraper is run on the netThreads group, because it shares data structures
     // with scraper_net, which is run as part of the network node threads.
@@ -316,9 +350,9 @@ void GRC::ScheduleBackgroundJobs(CScheduler& scheduler)
     scheduler.scheduleEvery([]{
         fs::path plogfile_out;
         LogInstance().archive(false, plogfile_out);
-    }, 300 * 1000);
+    }, 300 * 1000, "logarchive");
 
-    scheduler.scheduleEvery(Researcher::RunRenewBeaconJob, 4 * 60 * 60 * 1000);
+    scheduler.scheduleEvery(Researcher::RunRenewBeaconJob, 4 * 60 * 60 * 1000, "renewbeacon");
 
     ScheduleBackups(scheduler);
     ScheduleUpdateChecks(scheduler);
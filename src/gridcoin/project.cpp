@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "main.h"
+#include "streams.h"
 #include "gridcoin/contract/contract.h"
 #include "gridcoin/project.h"
 
@@ -184,6 +185,32 @@ void Whitelist::Delete(const ContractContext& ctx)
     std::atomic_store(&m_projects, CopyFilteredWhitelist(payload->m_name));
 }
 
+void Whitelist::WriteSnapshot(CDataStream& stream) const
+{
+    const WhitelistSnapshot projects = Snapshot();
+
+    WriteCompactSize(stream, projects.size());
+
+    for (const auto& project : projects) {
+        stream << project.m_name << project.m_url << project.m_timestamp;
+    }
+}
+
+void Whitelist::ReadSnapshot(CDataStream& stream)
+{
+    ProjectListPtr projects = std::make_shared<ProjectList>();
+
+    for (uint64_t count = ReadCompactSize(stream); count > 0; --count) {
+        Project project;
+        stream >> project.m_name >> project.m_url >> project.m_timestamp;
+
+        projects->emplace_back(std::move(project));
+    }
+
+    // With C++20, use std::atomic<std::shared_ptr<T>>::store() instead:
+    std::atomic_store(&m_projects, std::move(projects));
+}
+
 ProjectListPtr Whitelist::CopyFilteredWhitelist(const std::string& name) const
 {
     ProjectListPtr copy = std::make_shared<ProjectList>();
@@ -12,6 +12,8 @@
 #include <vector>
 #include <string>
 
+class CDataStream;
+
 namespace GRC
 {
 //!
@@ -317,6 +319,22 @@ public:
     //!
     void Delete(const ContractContext& ctx) override;
 
+    //!
+    //! \brief Serialize the whitelisted projects for a contract state snapshot.
+    //!
+    //! \param stream Receives the serialized whitelist state.
+    //!
+    void WriteSnapshot(CDataStream& stream) const;
+
+    //!
+    //! \brief Replace the whitelist with projects from a contract state
+    //! snapshot.
+    //!
+    //! \param stream Contains the whitelist state serialized by
+    //! \c WriteSnapshot().
+    //!
+    void ReadSnapshot(CDataStream& stream);
+
 private:
     // With C++20, use std::atomic<std::shared_ptr<T>> instead:
     ProjectListPtr m_projects;  //!< The set of whitelisted projects.
@@ -9,15 +9,28 @@
 #include "gridcoin/quorum.h"
 #include "gridcoin/scraper/scraper_net.h"
 #include "gridcoin/superblock.h"
+#include "util/perf.h"
 #include "util/reverse_iterator.h"
+#include "util/threadpool.h"
 
+#include <algorithm>
+#include <atomic>
+#include <boost/thread.hpp>
+#include <deque>
+#include <limits>
 #include <openssl/md5.h>
 #include <unordered_map>
 
 using namespace GRC;
 
 // TODO: use a header
-ScraperStatsAndVerifiedBeacons  GetScraperStatsByConvergedManifest(const ConvergedManifest& StructConvergedManifest);
+ScraperStatsAndVerifiedBeacons  GetScraperStatsByConvergedManifest(
+    const ConvergedManifest& StructConvergedManifest,
+    const ScraperProjectStatsCache* project_stats_cache = nullptr);
+void LoadProjectPartsToStatsCache(
+    const std::vector<std::pair<std::string, const CSplitBlob::CPart*>>& project_parts,
+    unsigned int nActiveProjects,
+    ScraperProjectStatsCache& project_stats_cache);
 ScraperStatsAndVerifiedBeacons  GetScraperStatsFromSingleManifest(CScraperManifest_shared_ptr& manifest);
 unsigned int NumScrapersForSupermajority(unsigned int nScraperCount);
 mmCSManifestsBinnedByScraper ScraperCullAndBinCScraperManifests();
@@ -164,6 +177,51 @@ public:
         }
     }
 
+    //!
+    //! \brief Record the block that contains a superblock connected to the
+    //! main chain.
+    //!
+    //! \param pindex Index of the block that contains the superblock.
+    //!
+    void Remember(const CBlockIndex* const pindex)
+    {
+        m_history[pindex->nHeight] = pindex;
+    }
+
+    //!
+    //! \brief Remove a superblock disconnected from the main chain from the
+    //! history.
+    //!
+    //! \param pindex Index of the block that contains the superblock.
+    //!
+    void Forget(const CBlockIndex* const pindex)
+    {
+        m_history.erase(pindex->nHeight);
+    }
+
+    //!
+    //! \brief Get the block of the most recent superblock below a height.
+    //!
+    //! \param height Find a superblock with a height less than this value.
+    //!
+    //! \return Index of the block that contains the superblock or \c nullptr
+    //! if no superblock exists below the height.
+    //!
+    const CBlockIndex* FindBefore(const int64_t height)
+    {
+        if (!m_history_loaded) {
+            LoadHistory(pindexBest);
+        }
+
+        auto iter = m_history.lower_bound(height);
+
+        if (iter == m_history.begin()) {
+            return nullptr;
+        }
+
+        return (--iter)->second;
+    }
+
     //!
     //! \brief Refill the superblock index cache.
     //!
@@ -171,6 +229,8 @@ public:
     //!
     void Reload(const CBlockIndex* pindexLast)
     {
+        LoadHistory(pindexLast);
+
         // Version 11+ blocks no longer rely on the tally trigger heights. We
         // just find and load the most recent superblock:
         //
@@ -178,10 +238,7 @@ public:
             m_pending.clear();
             m_cache.clear();
 
-            const CBlockIndex* pindex = pindexLast;
-            for (; pindex && pindex->nIsSuperBlock != 1; pindex = pindex->pprev);
-
-            m_cache.emplace_front(SuperblockPtr::ReadFromDisk(pindex));
+            m_cache.emplace_front(SuperblockPtr::ReadFromDisk(FindBefore(pindexLast->nHeight + 1)));
 
             return;
         }
@@ -197,36 +254,72 @@ public:
             m_cache.clear();
         }
 
-        if (!m_pending.empty() && m_pending.size() < CACHE_SIZE) {
-            const int64_t lowest_height = m_pending.begin()->first;
-
-            while (pindexLast->nHeight >= lowest_height) {
-                if (!pindexLast->pprev) {
-                    return;
-                }
+        int64_t search_height = pindexLast->nHeight + 1;
 
-                pindexLast = pindexLast->pprev;
-            }
+        if (!m_pending.empty() && m_pending.size() < CACHE_SIZE) {
+            search_height = std::min<int64_t>(search_height, m_pending.begin()->first);
         }
 
         // TODO: for now, just load the last three superblocks. We'll build a
         // better index when we implement superblock windows:
         //
         while (m_pending.size() < CACHE_SIZE) {
-            while (pindexLast->nIsSuperBlock != 1) {
-                if (!pindexLast->pprev) {
-                    return;
-                }
+            const CBlockIndex* const pindex = FindBefore(search_height);
 
-                pindexLast = pindexLast->pprev;
+            if (!pindex) {
+                return;
             }
 
-            PushSuperblock(SuperblockPtr::ReadFromDisk(pindexLast));
+            PushSuperblock(SuperblockPtr::ReadFromDisk(pindex));
 
-            pindexLast = pindexLast->pprev;
+            search_height = pindex->nHeight;
         }
     }
 private:
+    //!
+    //! \brief Blocks that contain the superblocks in the main chain, keyed by
+    //! height.
+    //!
+    //! This lets lookups of historical superblocks find the containing block
+    //! without walking the chain. The index is rebuilt from the superblock
+    //! flags stored in the block index on startup and then maintained as the
+    //! node connects and disconnects blocks.
+    //!
+    std::map<int64_t, const CBlockIndex*> m_history;
+
+    //!
+    //! \brief Whether \c m_history contains every superblock in the chain.
+    //!
+    bool m_history_loaded = false;
+
+    //!
+    //! \brief Build the superblock history if necessary and drop any entries
+    //! above the specified block.
+    //!
+    //! \param pindexLast The most recent block in the main chain.
+    //!
+    void LoadHistory(const CBlockIndex* pindexLast)
+    {
+        if (!pindexLast) {
+            return;
+        }
+
+        if (m_history_loaded) {
+            m_history.erase(m_history.upper_bound(pindexLast->nHeight), m_history.end());
+            return;
+        }
+
+        m_history.clear();
+
+        for (const CBlockIndex* pindex = pindexLast; pindex; pindex = pindex->pprev) {
+            if (pindex->nIsSuperBlock == 1) {
+                m_history.emplace_hint(m_history.begin(), pindex->nHeight, pindex);
+            }
+        }
+
+        m_history_loaded = true;
+    }
+
     //!
     //! \brief A set of recently-added superblocks not yet activated by the
     //! tally recount.
@@ -331,26 +424,17 @@ public:
             return QuorumHash();
         }
 
-        RefillVoteCache(pindex);
-
-        const PopularityMap popularity_map = BuildPopularityMap(pindex->nHeight);
-        auto popular = popularity_map.cbegin();
-
-        if (popular == popularity_map.cend()) {
-            return QuorumHash();
+        // The miner asks for the same chain tip on every staking attempt:
+        if (pindex == m_popular_pindex) {
+            return m_popular_hash;
         }
 
-        if (popularity_map.size() == 1) {
-            return popular->first;
-        }
+        RefillVoteCache(pindex);
 
-        for (auto iter = std::next(popular); iter != popularity_map.end(); ++iter) {
-            if (iter->second > popular->second) {
-                popular = iter;
-            }
-        }
+        m_popular_hash = SelectPopularHash(BuildPopularityMap(pindex->nHeight));
+        m_popular_pindex = pindex;
 
-        return popular->first;
+        return m_popular_hash;
     }
 
     //!
@@ -392,6 +476,8 @@ public:
             quorum_hash,
             std::move(address),
             pindex));
+
+        m_popular_pindex = nullptr;
     }
 
     //!
@@ -406,6 +492,7 @@ public:
         }
 
         m_votes.erase(pindex->nHeight);
+        m_popular_pindex = nullptr;
     }
 
 private:
@@ -424,6 +511,19 @@ private:
     //!
     std::map<int64_t, QuorumVote> m_votes;
 
+    //!
+    //! \brief Chain tip of the last popular hash query.
+    //!
+    //! Any change to the vote cache resets this so that the next query counts
+    //! the votes again.
+    //!
+    const CBlockIndex* m_popular_pindex = nullptr;
+
+    //!
+    //! \brief Result of the last popular hash query.
+    //!
+    QuorumHash m_popular_hash;
+
     //!
     //! \brief Load superblock votes from disk to prepare the cache for a
     //! recount of pending superblock popularity.
@@ -482,7 +582,33 @@ private:
 
         while (m_votes.size() > STANDARD_LOOKBACK && iter->first < min_height) {
             iter = m_votes.erase(iter);
+            m_popular_pindex = nullptr;
+        }
+    }
+
+    //!
+    //! \brief Select the superblock hash with the greatest vote weight.
+    //!
+    //! \param popularity_map Sums of the vote weights of pending superblocks.
+    //!
+    //! \return The first hash with the greatest weight in the iteration order
+    //! of the map, or an invalid hash when the map is empty.
+    //!
+    static QuorumHash SelectPopularHash(const PopularityMap& popularity_map)
+    {
+        auto popular = popularity_map.cbegin();
+
+        if (popular == popularity_map.cend()) {
+            return QuorumHash();
         }
+
+        for (auto iter = std::next(popular); iter != popularity_map.end(); ++iter) {
+            if (iter->second > popular->second) {
+                popular = iter;
+            }
+        }
+
+        return popular->first;
     }
 
     //!
@@ -803,12 +929,17 @@ private: // SuperblockValidator classes
         //! \brief Calculate a superblock hash from the supplied manifest data
         //! that matches the set of resolved project parts.
         //!
+        //! \param project_stats_cache Optional stats already loaded for some of
+        //! the project parts in the convergence.
+        //!
         //! \return A superblock hash generated from the convergence to compare
         //! to the superblock under validation.
         //!
-        QuorumHash ComputeQuorumHash() const
+        QuorumHash ComputeQuorumHash(const ScraperProjectStatsCache* project_stats_cache = nullptr) const
         {
-            const ScraperStatsAndVerifiedBeacons stats_and_verified_beacons = GetScraperStatsByConvergedManifest(m_convergence);
+            const ScraperStatsAndVerifiedBeacons stats_and_verified_beacons = GetScraperStatsByConvergedManifest(
+                m_convergence,
+                project_stats_cache);
 
             return QuorumHash::Hash(stats_and_verified_beacons);
         }
@@ -879,6 +1010,35 @@ private: // SuperblockValidator classes
             return m_total_combinations;
         }
 
+        //!
+        //! \brief Get the number of projects in each combination.
+        //!
+        size_t ProjectCount() const
+        {
+            return m_projects.size();
+        }
+
+        //!
+        //! \brief Get every resolved project part that the combinations draw
+        //! from.
+        //!
+        //! \return Pairs of project names and pointers to the resolved parts.
+        //!
+        std::vector<std::pair<std::string, const CSplitBlob::CPart*>> GetProjectParts() const
+        {
+            std::vector<std::pair<std::string, const CSplitBlob::CPart*>> parts;
+
+            for (const auto& project_pair : m_projects) {
+                for (const auto& resolved_part : project_pair.second.m_resolved_parts) {
+                    if (const CSplitBlob::CPart* part = GetResolvedPartPtr(resolved_part.m_part_hash)) {
+                        parts.emplace_back(project_pair.first, part);
+                    }
+                }
+            }
+
+            return parts;
+        }
+
         //!
         //! \brief Generate the next convergence in sequence from the resolved
         //! project parts.
@@ -927,8 +1087,26 @@ private: // SuperblockValidator classes
                 return boost::none;
             }
 
+            return boost::make_optional(GetConvergence(m_current_combination++));
+        }
+
+        //!
+        //! \brief Generate the convergence for the specified combination of
+        //! the resolved project parts.
+        //!
+        //! This does not change the state of the combiner, so threads may call
+        //! it concurrently to evaluate different parts of the combination
+        //! space. See \c GetNextConvergence() for the algorithm.
+        //!
+        //! \param combination Index of the combination. Must be less than the
+        //! value of \c TotalCombinations().
+        //!
+        //! \return A convergence to generate a superblock hash from.
+        //!
+        ConvergenceCandidate GetConvergence(const size_t combination) const
+        {
             ConvergenceCandidate convergence;
-            size_t remainder = m_current_combination;
+            size_t remainder = combination;
             uint256 latest_manifest;
             int64_t latest_manifest_time = 0;
 
@@ -963,9 +1141,7 @@ private: // SuperblockValidator classes
 
             AddBeaconPartsData(convergence, latest_manifest);
 
-            ++m_current_combination;
-
-            return boost::make_optional(std::move(convergence));
+            return convergence;
         }
 
     private:
@@ -1090,7 +1266,7 @@ private: // SuperblockValidator classes
         }
 
         //!
-        //! \brief Scan the local manifest data to reconstruct a supermajority
+        //! \brief Look up the local manifest parts to reconstruct a supermajority
         //! of manifest parts that match the candidate parts in the superblock.
         //!
         //! \return \c false after failing to resolve a matching part for each
@@ -1099,17 +1275,27 @@ private: // SuperblockValidator classes
         //!
         ProjectCombiner ResolveProjectParts()
         {
-            // Collect the manifest parts that match the hints in the superblock
-            // and record missing projects, if any:
+            // Number the manifests by scraper and then by time. Parts tally in
+            // this order so that the manifest that completes a supermajority
+            // for a part becomes its source:
             //
+            std::map<uint256, std::pair<size_t, const ScraperID*>> manifest_order;
+
             for (const auto& by_scraper : m_manifests_by_scraper) {
-                const ScraperID& scraper_id = by_scraper.first;
-                const mCSManifest& hashes_by_time = by_scraper.second;
+                for (const auto& hashes : by_scraper.second) {
+                    manifest_order.emplace(
+                        hashes.second.first,
+                        std::make_pair(manifest_order.size(), &by_scraper.first));
+                }
+            }
+
+            {
+                LOCK(CScraperManifest::cs_mapManifest);
 
-                for (const auto& hashes : hashes_by_time) {
-                    const uint256& manifest_hash = hashes.second.first;
+                RecordOtherProjects(manifest_order);
 
-                    ResolvePartsFor(manifest_hash, scraper_id);
+                for (auto& project_pair : m_resolved_projects) {
+                    ResolvePartsFor(project_pair.first, project_pair.second, manifest_order);
                 }
             }
 
@@ -1202,43 +1388,106 @@ private: // SuperblockValidator classes
         }
 
         //!
-        //! \brief Match each part hinted by the superblock to a local manifest
-        //! published by each scraper.
+        //! \brief Record the scrapers that published each project missing from
+        //! the superblock.
         //!
-        //! \param manifest_hash Hash of the manifest to match parts for.
-        //! \param scraper_id    Used to establish supermajority for a manifest.
+        //! A lock must be taken on \c CScraperManifest::cs_mapManifest before
+        //! calling this method.
         //!
-        void ResolvePartsFor(const uint256& manifest_hash, const ScraperID& scraper_id)
+        //! \param manifest_order Positions and scrapers of the manifests to
+        //! resolve the projects from.
+        //!
+        void RecordOtherProjects(
+            const std::map<uint256, std::pair<size_t, const ScraperID*>>& manifest_order)
         {
-            LOCK(CScraperManifest::cs_mapManifest);
+            for (const auto& order_pair : manifest_order) {
+                const auto iter = CScraperManifest::mapManifest.find(order_pair.first);
 
-            const auto iter = CScraperManifest::mapManifest.find(manifest_hash);
+                if (iter == CScraperManifest::mapManifest.end()) {
+                    continue;
+                }
 
-            if (iter == CScraperManifest::mapManifest.end()) {
-                return;
+                for (const auto& entry : iter->second->projects) {
+                    TallyProject(entry.project, *order_pair.second.second);
+                }
             }
+        }
 
-            const CScraperManifest_shared_ptr manifest = iter->second;
+        //!
+        //! \brief Match each part hinted by the superblock for a project to the
+        //! local manifests that contain it.
+        //!
+        //! Looks up the candidate parts in the part index of the manifests
+        //! instead of reading the parts of every manifest. A lock must be taken
+        //! on \c CScraperManifest::cs_mapManifest before calling this method.
+        //!
+        //! \param project_name   Name of the project to resolve parts for.
+        //! \param project        Resolution state of the project.
+        //! \param manifest_order Positions and scrapers of the manifests to
+        //! resolve the parts from.
+        //!
+        void ResolvePartsFor(
+            const std::string& project_name,
+            ResolvedProject& project,
+            const std::map<uint256, std::pair<size_t, const ScraperID*>>& manifest_order)
+        {
+            struct PartSource
+            {
+                size_t m_position;           //!< Position of the manifest.
+                unsigned int m_entry;        //!< Offset of the project entry.
+                const ScraperID* m_scraper;  //!< Scraper of the manifest.
+                const CScraperManifest* m_manifest;
+            };
 
-            for (const auto& entry : manifest->projects) {
-                auto project_option = TallyProject(entry.project, scraper_id);
+            std::vector<std::pair<uint256, PartSource>> sources;
 
-                // If this project does not exist in the superblock, skip the
-                // attempt to associate its parts:
-                //
-                if (!project_option || entry.part1 >= (int)manifest->vParts.size()) {
-                    continue;
+            for (const auto& candidate_pair : project.m_candidate_hashes) {
+                const uint256& part_hash = candidate_pair.first;
+                const auto range = CScraperManifest::mapProjectPartsByHash.equal_range(part_hash.GetUint64());
+
+                for (auto iter = range.first; iter != range.second; ++iter) {
+                    const CScraperManifest& manifest = *iter->second.first;
+                    const CScraperManifest::dentry& entry = manifest.projects[iter->second.second];
+
+                    if (manifest.vParts[entry.part1]->hash != part_hash || entry.project != project_name) {
+                        continue;
+                    }
+
+                    const auto order = manifest_order.find(*manifest.phash);
+
+                    if (order == manifest_order.end()) {
+                        continue;
+                    }
+
+                    sources.emplace_back(part_hash, PartSource {
+                        order->second.first,
+                        iter->second.second,
+                        order->second.second,
+                        &manifest,
+                    });
                 }
+            }
 
-                const uint256& part_hash = manifest->vParts[entry.part1]->hash;
+            std::sort(sources.begin(), sources.end(), [](
+                const std::pair<uint256, PartSource>& a,
+                const std::pair<uint256, PartSource>& b)
+            {
+                return a.second.m_position < b.second.m_position
+                    || (a.second.m_position == b.second.m_position
+                        && a.second.m_entry < b.second.m_entry);
+            });
 
-                if (project_option->Expects(part_hash)
-                    && project_option->Tally(part_hash, scraper_id, m_supermajority))
+            for (const auto& source_pair : sources) {
+                const uint256& part_hash = source_pair.first;
+                const PartSource& source = source_pair.second;
+
+                if (project.Expects(part_hash)
+                    && project.Tally(part_hash, *source.m_scraper, m_supermajority))
                 {
-                    project_option->LinkPart(ResolvedPart(
-                        manifest->vParts[entry.part1]->hash,
-                        manifest_hash,
-                        entry.LastModified));
+                    project.LinkPart(ResolvedPart(
+                        part_hash,
+                        *source.m_manifest->phash,
+                        source.m_manifest->projects[source.m_entry].LastModified));
                 }
             }
         }
@@ -1258,21 +1507,17 @@ private: // SuperblockValidator methods
     //!
     //! The scraper convergence cache stores a set of previous convergences for
     //! the current superblock cycle with matching superblock hashes. This step
-    //! accepts superblocks if the embedded converged manifest hash hints match
-    //! a hash of a past convergence in this cache.
+    //! accepts superblocks if a past convergence in this cache produced a
+    //! superblock with the same hash.
     //!
-    //! \return \c true if the hinted convergence's superblock hash matches the
-    //! hash of the validated superblock.
+    //! \return \c true if the hash of the validated superblock matches the
+    //! superblock hash of a past convergence.
     //!
     bool TryRecentPastConvergence() const
     {
         LOCK(cs_ConvergedScraperStatsCache);
 
-        const uint32_t hint = m_superblock->m_convergence_hint;
-        const auto iter = ConvergedScraperStatsCache.PastConvergences.find(hint);
-
-        return iter != ConvergedScraperStatsCache.PastConvergences.end()
-            && iter->second.first == m_quorum_hash;
+        return ConvergedScraperStatsCache.HasPastConvergenceForSuperblock(m_quorum_hash);
     }
 
     //!
@@ -1407,13 +1652,86 @@ private: // SuperblockValidator methods
                  "ValidateSuperblock(): by-project possible combinations: %" PRIszu,
                  combiner.TotalCombinations());
 
-        while (const auto combination_option = combiner.GetNextConvergence()) {
-            if (combination_option->ComputeQuorumHash() == m_quorum_hash) {
-                return true;
+        if (combiner.TotalCombinations() == 0) {
+            return false;
+        }
+
+        // Each combination shares most of its project parts with the others,
+        // so load the stats for every resolved part just once:
+        ScraperProjectStatsCache project_stats_cache;
+
+        LoadProjectPartsToStatsCache(
+            combiner.GetProjectParts(),
+            combiner.ProjectCount(),
+            project_stats_cache);
+
+        return SearchCombinations(combiner, project_stats_cache);
+    }
+
+    //!
+    //! \brief Build a convergence for each combination of resolved project
+    //! parts until one matches the superblock.
+    //!
+    //! Almost every by-project fallback produces a single combination. When
+    //! scrapers disagree on several projects, the combinations multiply, so
+    //! this splits them across worker threads and stops all of the workers
+    //! after the first match. A combination that fails to build stops them as
+    //! well, and its exception propagates to the caller once they finish, the
+    //! same as in the single-threaded search.
+    //!
+    //! \param combiner            Produces the convergence combinations.
+    //! \param project_stats_cache Stats loaded for the resolved parts.
+    //!
+    //! \return \c true if a combination matches the validated superblock.
+    //!
+    bool SearchCombinations(
+        const ProjectCombiner& combiner,
+        const ScraperProjectStatsCache& project_stats_cache) const
+    {
+        const size_t total_combinations = combiner.TotalCombinations();
+        const size_t thread_count = std::min<size_t>(
+            total_combinations,
+            std::max<size_t>(1, std::min<size_t>(boost::thread::hardware_concurrency(), 8)));
+
+        if (thread_count <= 1) {
+            for (size_t i = 0; i < total_combinations; ++i) {
+                if (combiner.GetConvergence(i).ComputeQuorumHash(&project_stats_cache) == m_quorum_hash) {
+                    return true;
+                }
             }
+
+            return false;
         }
 
-        return false;
+        std::atomic<size_t> next_combination(0);
+        std::atomic<bool> found(false);
+        std::atomic<bool> failed(false);
+
+        util::ParallelFor(util::Executor::VALIDATION, thread_count, [&](size_t) {
+            for (size_t combination = next_combination++;
+                combination < total_combinations && !found && !failed;
+                combination = next_combination++)
+            {
+                try {
+                    const QuorumHash candidate_hash = combiner
+                        .GetConvergence(combination)
+                        .ComputeQuorumHash(&project_stats_cache);
+
+                    if (candidate_hash == m_quorum_hash) {
+                        found = true;
+                    }
+                } catch (const std::exception& e) {
+                    LogPrintf("ValidateSuperblock(): combination %" PRIszu " failed: %s",
+                        combination,
+                        e.what());
+
+                    failed = true;
+                    throw;
+                }
+            }
+        });
+
+        return found;
     }
 
     //!
@@ -1447,15 +1765,31 @@ private: // SuperblockValidator methods
     {
         std::map<std::string, CandidatePartHashMap> candidates;
 
-        LOCK(CSplitBlob::cs_mapParts);
+        LOCK(CScraperManifest::cs_mapManifest);
+
+        const auto& parts_by_hash = CScraperManifest::mapProjectPartsByHash;
 
-        for (const auto& part_pair : CSplitBlob::mapParts) {
-            const uint32_t hint = part_pair.first.GetUint64() >> m_hint_shift;
-            const auto hint_range = hints.equal_range(hint);
+        for (const auto& hint_pair : hints) {
+            // A hint holds the high bits of the first 64 bits of a part hash,
+            // so the matching parts form a range of the index:
+            //
+            uint64_t lower = 0;
+            uint64_t upper = std::numeric_limits<uint64_t>::max();
+
+            if (m_hint_shift < 64) {
+                lower = static_cast<uint64_t>(hint_pair.first) << m_hint_shift;
+                upper = lower | (upper >> (64 - m_hint_shift));
+            }
+
+            for (auto iter = parts_by_hash.lower_bound(lower);
+                iter != parts_by_hash.end() && iter->first <= upper;
+                ++iter)
+            {
+                const CScraperManifest& manifest = *iter->second.first;
+                const int part = manifest.projects[iter->second.second].part1;
 
-            for (auto i = hint_range.first; i != hint_range.second; ++i) {
-                candidates[i->second].emplace(
-                    part_pair.second.hash,
+                candidates[hint_pair.second].emplace(
+                    manifest.vParts[part]->hash,
                     std::initializer_list<ScraperID> { });
             }
         }
@@ -1474,6 +1808,66 @@ SuperblockIndex g_superblock_index;
 //!
 LegacyConsensus g_legacy_consensus;
 
+//!
+//! \brief Hashes of the superblocks in recently connected blocks that matched
+//! a scraper convergence.
+//!
+//! A reorganization that disconnects and then reconnects a superblock would
+//! otherwise repeat the comparison to the convergence data. That comparison
+//! is the most expensive step of connecting a block. Guarded by cs_main.
+//!
+std::deque<QuorumHash> g_validated_superblocks;
+
+//!
+//! \brief Number of validated superblock hashes to remember.
+//!
+constexpr size_t MAX_VALIDATED_SUPERBLOCKS = 8;
+
+//!
+//! \brief Validate a superblock against scraper convergence data and log the
+//! result.
+//!
+SuperblockValidator::Result ValidateAndLogSuperblock(
+    const SuperblockPtr& superblock,
+    const bool use_cache,
+    const size_t hint_bits)
+{
+    PERF_SCOPE("ValidateSuperblock");
+
+    using Result = SuperblockValidator::Result;
+
+    const Result result = SuperblockValidator(superblock, hint_bits).Validate(use_cache);
+    std::string message;
+
+    switch (result) {
+        case Result::UNKNOWN:
+            message = "UNKNOWN - Waiting for manifest data";
+            break;
+        case Result::INVALID:
+            message = "INVALID - Validation failed";
+            break;
+        case Result::HISTORICAL:
+            message = "HISTORICAL - Skipped historical superblock.";
+            break;
+        case Result::VALID_CURRENT:
+            message = "VALID_CURRENT - Matched current cached convergence";
+            break;
+        case Result::VALID_PAST:
+            message = "VALID_PAST - Matched past cached convergence";
+            break;
+        case Result::VALID_BY_MANIFEST:
+            message = "VALID_BY_MANIFEST - Matched supermajority by manifest";
+            break;
+        case Result::VALID_BY_PROJECT:
+            message = "VALID_BY_PROJECT - Matched supermajority by project";
+            break;
+    }
+
+    LogPrintf("ValidateSuperblock(): %s.", message);
+
+    return result;
+}
+
 } // anonymous namespace
 
 
@@ -1532,7 +1926,33 @@ bool Quorum::ValidateSuperblockClaim(
             return error("ValidateSuperblockClaim(): quorum hash mismatch.");
         }
 
-        return ValidateSuperblock(superblock);
+        if (std::find(
+                g_validated_superblocks.begin(),
+                g_validated_superblocks.end(),
+                claim.m_quorum_hash) != g_validated_superblocks.end())
+        {
+            return true;
+        }
+
+        using Result = SuperblockValidator::Result;
+
+        switch (ValidateAndLogSuperblock(superblock, true, 32)) {
+            case Result::INVALID:
+                return false;
+            case Result::UNKNOWN:
+            case Result::HISTORICAL:
+                return true;
+            default:
+                break;
+        }
+
+        g_validated_superblocks.push_back(claim.m_quorum_hash);
+
+        if (g_validated_superblocks.size() > MAX_VALIDATED_SUPERBLOCKS) {
+            g_validated_superblocks.pop_front();
+        }
+
+        return true;
     }
 
     const CBitcoinAddress address(claim.m_quorum_address);
@@ -1565,38 +1985,8 @@ bool Quorum::ValidateSuperblock(
     const bool use_cache,
     const size_t hint_bits)
 {
-    using Result = SuperblockValidator::Result;
-
-    const Result result = SuperblockValidator(superblock, hint_bits).Validate(use_cache);
-    std::string message;
-
-    switch (result) {
-        case Result::UNKNOWN:
-            message = "UNKNOWN - Waiting for manifest data";
-            break;
-        case Result::INVALID:
-            message = "INVALID - Validation failed";
-            break;
-        case Result::HISTORICAL:
-            message = "HISTORICAL - Skipped historical superblock.";
-            break;
-        case Result::VALID_CURRENT:
-            message = "VALID_CURRENT - Matched current cached convergence";
-            break;
-        case Result::VALID_PAST:
-            message = "VALID_PAST - Matched past cached convergence";
-            break;
-        case Result::VALID_BY_MANIFEST:
-            message = "VALID_BY_MANIFEST - Matched supermajority by manifest";
-            break;
-        case Result::VALID_BY_PROJECT:
-            message = "VALID_BY_PROJECT - Matched supermajority by project";
-            break;
-    }
-
-    LogPrintf("ValidateSuperblock(): %s.", message);
-
-    return result != Result::INVALID;
+    return ValidateAndLogSuperblock(superblock, use_cache, hint_bits)
+        != SuperblockValidator::Result::INVALID;
 }
 
 Magnitude Quorum::GetMagnitude(const Cpid cpid)
@@ -1703,10 +2093,13 @@ Superblock Quorum::CreateSuperblock()
     return ScraperGetSuperblockContract();
 }
 
-void Quorum::PushSuperblock(SuperblockPtr superblock)
+void Quorum::PushSuperblock(SuperblockPtr superblock, const CBlockIndex* const pindex)
 {
     LogPrintf("Quorum::PushSuperblock(%" PRId64 ")", superblock.m_height);
 
+    superblock.Share(pindex);
+
+    g_superblock_index.Remember(pindex);
     g_superblock_index.PushSuperblock(std::move(superblock));
 }
 
@@ -1714,9 +2107,15 @@ void Quorum::PopSuperblock(const CBlockIndex* const pindex)
 {
     LogPrintf("Quorum::PopSuperblock(%" PRId64 ")", pindex->nHeight);
 
+    g_superblock_index.Forget(pindex);
     g_superblock_index.PopSuperblock();
 }
 
+const CBlockIndex* Quorum::FindSuperblockBefore(const int64_t height)
+{
+    return g_superblock_index.FindBefore(height);
+}
+
 bool Quorum::CommitSuperblock(const uint32_t height)
 {
     return g_superblock_index.Commit(height);
@@ -223,8 +223,9 @@ public:
     //! \brief Push a new superblock into the tally.
     //!
     //! \param superblock Contains the superblock data to load.
+    //! \param pindex     Index of the block that contains the superblock.
     //!
-    static void PushSuperblock(SuperblockPtr superblock);
+    static void PushSuperblock(SuperblockPtr superblock, const CBlockIndex* const pindex);
 
     //!
     //! \brief Drop the last superblock loaded into the tally.
@@ -233,6 +234,20 @@ public:
     //!
     static void PopSuperblock(const CBlockIndex* const pindex);
 
+    //!
+    //! \brief Get the block that contains the most recent superblock in the
+    //! main chain below the specified height.
+    //!
+    //! This looks up the superblock in an index by height instead of walking
+    //! the chain. The caller must hold a lock on \c cs_main.
+    //!
+    //! \param height Find a superblock with a height less than this value.
+    //!
+    //! \return Index of the block that contains the superblock or \c nullptr
+    //! if no superblock exists below the height.
+    //!
+    static const CBlockIndex* FindSuperblockBefore(const int64_t height);
+
     //!
     //! \brief Activate the superblock received at or below the specified
     //! height.
@@ -0,0 +1,122 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "gridcoin/quorum.h"
+#include "gridcoin/research_history.h"
+#include "gridcoin/superblock.h"
+#include "gridcoin/tally.h"
+#include "txdb.h"
+
+#include <vector>
+
+using namespace GRC;
+
+namespace {
+const std::string RESEARCH_HISTORY = "rhistory";
+const std::string RESEARCH_HISTORY_BLOCK = "rhistoryblock";
+const std::string RESEARCH_INDEX_START = "rhistorystart";
+} // anonymous namespace
+
+int GRC::InitResearchIndex(CTxDB& txdb, const int best_height)
+{
+    int start;
+
+    if (!txdb.ReadRecord(RESEARCH_INDEX_START, std::string("height"), start)) {
+        start = best_height + 1;
+        txdb.WriteRecord(RESEARCH_INDEX_START, std::string("height"), start);
+    }
+
+    return start;
+}
+
+bool GRC::WriteResearchHistory(CTxDB& txdb, const CBlockIndex* const pindex)
+{
+    std::vector<std::pair<ResearchHistoryKey, int64_t>> entries;
+
+    if (pindex->nResearchSubsidy > 0) {
+        if (const CpidOption cpid = pindex->GetMiningId().TryCpid()) {
+            entries.emplace_back(
+                ResearchHistoryKey(*cpid, pindex->nHeight, ResearchHistoryKind::REWARD),
+                pindex->nResearchSubsidy);
+        }
+    }
+
+    if (pindex->nIsSuperBlock == 1) {
+        const SuperblockPtr superblock = Quorum::CurrentSuperblock();
+
+        if (superblock.m_height == pindex->nHeight) {
+            for (const auto& entry : superblock->m_cpids) {
+                entries.emplace_back(
+                    ResearchHistoryKey(entry.Cpid(), pindex->nHeight, ResearchHistoryKind::MAGNITUDE),
+                    entry.Magnitude().Scaled());
+            }
+
+            // Version 2+ superblocks take the accrual snapshots:
+            if (superblock->m_version >= 2) {
+                for (const auto& account_pair : Tally::Accounts()) {
+                    if (account_pair.second.m_accrual == 0) {
+                        continue;
+                    }
+
+                    entries.emplace_back(
+                        ResearchHistoryKey(account_pair.first, pindex->nHeight, ResearchHistoryKind::ACCRUAL),
+                        account_pair.second.m_accrual);
+                }
+            }
+        }
+    }
+
+    if (entries.empty()) {
+        return true;
+    }
+
+    // Record the keys written for the block so that a disconnect can erase
+    // them without searching the history of every CPID:
+    std::vector<ResearchHistoryKey> keys;
+    keys.reserve(entries.size());
+
+    for (const auto& entry : entries) {
+        if (!txdb.WriteRecord(RESEARCH_HISTORY, entry.first, entry.second)) {
+            return false;
+        }
+
+        keys.push_back(entry.first);
+    }
+
+    return txdb.WriteRecord(RESEARCH_HISTORY_BLOCK, pindex->nHeight, keys);
+}
+
+bool GRC::DisconnectResearchHistory(CTxDB& txdb, const int height)
+{
+    std::vector<ResearchHistoryKey> keys;
+
+    if (!txdb.ReadRecord(RESEARCH_HISTORY_BLOCK, height, keys)) {
+        return true; // No entries or connected before the index started.
+    }
+
+    for (const auto& key : keys) {
+        if (!txdb.EraseRecord(RESEARCH_HISTORY, key)) {
+            return false;
+        }
+    }
+
+    return txdb.EraseRecord(RESEARCH_HISTORY_BLOCK, height);
+}
+
+bool GRC::ReadResearchHistory(
+    CTxDB& txdb,
+    const Cpid& cpid,
+    const std::function<bool(const ResearchHistoryKey&, int64_t)>& fn)
+{
+    return txdb.ScanRecords(RESEARCH_HISTORY, cpid, [&](CDataStream& ssKey, CDataStream& ssValue) {
+        ResearchHistoryKey key;
+        int64_t value;
+
+        ssKey >> key;
+        ssValue >> value;
+
+        return fn(key, value);
+    });
+}
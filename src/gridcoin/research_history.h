@@ -0,0 +1,97 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "gridcoin/cpid.h"
+#include "serialize.h"
+
+#include <functional>
+#include <stdint.h>
+
+class CBlockIndex;
+class CTxDB;
+
+namespace GRC {
+//!
+//! \brief Kinds of the values in the research history of a CPID.
+//!
+enum class ResearchHistoryKind : uint8_t
+{
+    MAGNITUDE = 1, //!< Magnitude in a superblock, scaled by Magnitude::SCALE_FACTOR.
+    REWARD = 2,    //!< Research reward claimed by a block, in units of 1/COIN.
+    ACCRUAL = 3,   //!< Accrual snapshot value at a superblock, in units of 1/COIN.
+};
+
+//!
+//! \brief Key of an entry in the research history of a CPID.
+//!
+//! With -researchindex, ConnectBlock() stores the magnitude of each CPID in
+//! a superblock, each research reward claim, and the accrual snapshot value
+//! of each CPID at a superblock. The height serializes in big-endian byte
+//! order so that leveldb sorts the entries of a CPID by height.
+//!
+struct ResearchHistoryKey
+{
+    Cpid m_cpid;               //!< CPID that the entry belongs to.
+    int32_t m_height;          //!< Height of the block that produced the value.
+    ResearchHistoryKind m_kind; //!< Meaning of the value.
+
+    ResearchHistoryKey() : m_height(0), m_kind(ResearchHistoryKind::REWARD) { }
+
+    ResearchHistoryKey(const Cpid& cpid, const int32_t height, const ResearchHistoryKind kind)
+        : m_cpid(cpid), m_height(height), m_kind(kind)
+    {
+    }
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << m_cpid;
+        ser_writedata32be(s, m_height);
+        ser_writedata8(s, static_cast<uint8_t>(m_kind));
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        s >> m_cpid;
+        m_height = ser_readdata32be(s);
+        m_kind = static_cast<ResearchHistoryKind>(ser_readdata8(s));
+    }
+};
+
+//!
+//! \brief Get the first block height covered by the research history index.
+//!
+//! The index only covers the blocks that connected while the node ran with
+//! -researchindex. The first call records the height after the current tip
+//! as the start of the index.
+//!
+//! \param best_height Height of the current chain tip.
+//!
+int InitResearchIndex(CTxDB& txdb, const int best_height);
+
+//!
+//! \brief Store the research history entries of a connected block.
+//!
+//! Call this after the tally and the quorum processed the block so that the
+//! current superblock and the accrual snapshot belong to the block.
+//!
+bool WriteResearchHistory(CTxDB& txdb, const CBlockIndex* const pindex);
+
+//!
+//! \brief Erase the research history entries of a disconnected block.
+//!
+bool DisconnectResearchHistory(CTxDB& txdb, const int height);
+
+//!
+//! \brief Invoke a function for each research history entry of a CPID in
+//! order of height.
+//!
+bool ReadResearchHistory(
+    CTxDB& txdb,
+    const Cpid& cpid,
+    const std::function<bool(const ResearchHistoryKey&, int64_t)>& fn);
+} // namespace GRC
@@ -246,15 +246,33 @@ bool IsPoolCpid(const Cpid cpid)
     return false;
 }
 
+//!
+//! \brief The project sections read from the last client_state.xml file.
+//!
+//! BOINC rewrites the file every few minutes at most. The cache lets repeated
+//! reloads skip reading and scanning a file that did not change.
+//!
+struct ClientStateCache
+{
+    fs::path m_path;                     //!< Path of the file.
+    std::time_t m_mtime = 0;             //!< Modification time of the file.
+    uintmax_t m_size = 0;                //!< Size of the file in bytes.
+    std::vector<std::string> m_projects; //!< Project sections in the file.
+};
+
+CCriticalSection cs_client_state;
+ClientStateCache g_client_state_cache;
+
 //!
 //! \brief Fetch the contents of BOINC's client_state.xml file from disk.
 //!
+//! \param path Location of the client_state.xml file.
+//!
 //! \return The entire client_state.xml file as a string if readable.
 //!
-boost::optional<std::string> ReadClientStateXml()
+boost::optional<std::string> ReadClientStateXml(const fs::path& path)
 {
-    const fs::path path = GetBoincDataDir();
-    std::string contents = GetFileContents(path / "client_state.xml");
+    std::string contents = GetFileContents(path);
 
     if (contents != "-1") {
         return boost::make_optional(std::move(contents));
@@ -263,7 +281,7 @@ boost::optional<std::string> ReadClientStateXml()
     LogPrintf("WARNING: Unable to obtain BOINC CPIDs.");
 
     if (!GetArgument("boincdatadir", "").empty()) {
-        LogPrintf("Could not access configured BOINC data directory %s", path.string());
+        LogPrintf("Could not access configured BOINC data directory %s", path.parent_path().string());
     } else {
         LogPrintf(
             "BOINC data directory is not installed in the default location.\n"
@@ -273,6 +291,43 @@ boost::optional<std::string> ReadClientStateXml()
     return boost::none;
 }
 
+//!
+//! \brief Extract the XML of each \c <project> element in one pass over the
+//! contents of a client_state.xml file.
+//!
+//! The large result, workunit, and application sections that follow the
+//! projects are skipped instead of copied with the project before them.
+//!
+//! \param client_state_xml Contents of a client_state.xml file.
+//!
+//! \return The XML between each \c <project>...</project> pair. A project
+//! element without a closing tag ends at the next project element or at the
+//! end of the file.
+//!
+std::vector<std::string> ExtractProjectsXml(const std::string& client_state_xml)
+{
+    static const std::string open_tag = "<project>";
+    static const std::string close_tag = "</project>";
+
+    std::vector<std::string> projects;
+    size_t pos = client_state_xml.find(open_tag);
+
+    while (pos != std::string::npos) {
+        const size_t begin = pos + open_tag.size();
+        size_t end = client_state_xml.find(close_tag, begin);
+
+        pos = client_state_xml.find(open_tag, end == std::string::npos ? begin : end);
+
+        if (end == std::string::npos || (pos != std::string::npos && pos < end)) {
+            end = pos == std::string::npos ? client_state_xml.size() : pos;
+        }
+
+        projects.emplace_back(client_state_xml, begin, end - begin);
+    }
+
+    return projects;
+}
+
 //!
 //! \brief Load a set of project XML sections from BOINC's client_state.xml
 //! file to gather CPIDs from.
@@ -283,23 +338,42 @@ boost::optional<std::string> ReadClientStateXml()
 //!
 std::vector<std::string> FetchProjectsXml()
 {
-    const boost::optional<std::string> client_state_xml = ReadClientStateXml();
+    const fs::path path = GetBoincDataDir() / "client_state.xml";
+
+    boost::system::error_code ec;
+    const std::time_t mtime = fs::last_write_time(path, ec);
+    const uintmax_t size = ec ? 0 : fs::file_size(path, ec);
+
+    LOCK(cs_client_state);
+
+    if (!ec
+        && g_client_state_cache.m_path == path
+        && g_client_state_cache.m_mtime == mtime
+        && g_client_state_cache.m_size == size)
+    {
+        return g_client_state_cache.m_projects;
+    }
+
+    g_client_state_cache = ClientStateCache();
+
+    const boost::optional<std::string> client_state_xml = ReadClientStateXml(path);
 
     if (!client_state_xml) {
         return { };
     }
 
-    std::vector<std::string> projects = split(*client_state_xml, "<project>");
+    std::vector<std::string> projects = ExtractProjectsXml(*client_state_xml);
 
-    if (projects.size() < 2) {
+    if (projects.empty()) {
         LogPrintf("BOINC is not attached to any projects. No CPIDs loaded.");
-        return { };
     }
 
-    // Drop the first element which never contains a project:
-    //
-    std::swap(projects.front(), projects.back());
-    projects.pop_back();
+    if (!ec) {
+        g_client_state_cache.m_path = path;
+        g_client_state_cache.m_mtime = mtime;
+        g_client_state_cache.m_size = size;
+        g_client_state_cache.m_projects = projects;
+    }
 
     return projects;
 }
@@ -313,7 +387,7 @@ std::vector<std::string> FetchProjectsXml()
 //!
 bool ShouldEnforceTeamMembership()
 {
-    return ReadCache(Section::PROTOCOL, "REQUIRE_TEAM_WHITELIST_MEMBERSHIP").value != "false";
+    return GetProtocolParameters()->require_team_membership;
 }
 
 //!
@@ -325,39 +399,13 @@ bool ShouldEnforceTeamMembership()
 //!
 std::set<std::string> GetTeamWhitelist()
 {
-    if (!ShouldEnforceTeamMembership()) {
-        return { };
-    }
-
-    const AppCacheEntry entry = ReadCache(Section::PROTOCOL, "TEAM_WHITELIST");
-
-    if (entry.value.empty()) {
-        return { "gridcoin" };
-    }
+    const ProtocolParametersPtr params = GetProtocolParameters();
 
-    std::set<std::string> teams;
-    std::string delimiter = "<>";
-
-    // Handle the transition of the team whitelist delimiter from "|" to "<>":
-    if (entry.value.find(delimiter) == std::string::npos) {
-        delimiter = "|";
-    }
-
-    for (auto&& team_name : split(entry.value, delimiter)) {
-        if (team_name.empty()) {
-            continue;
-        }
-
-        boost::to_lower(team_name);
-
-        teams.emplace(std::move(team_name));
-    }
-
-    if (teams.empty()) {
-        return { "gridcoin" };
+    if (!params->require_team_membership) {
+        return { };
     }
 
-    return teams;
+    return params->team_whitelist;
 }
 
 //!
@@ -1269,16 +1317,18 @@ bool Researcher::HasRAC() const
 int64_t Researcher::Accrual() const
 {
     const CpidOption cpid = m_mining_id.TryCpid();
+    const CBlockIndex* const pindex = pindexBest;
 
-    if (!cpid || !pindexBest) {
+    if (!cpid || !pindex) {
         return 0;
     }
 
-    const int64_t now = OutOfSyncByAge() ? pindexBest->nTime : GetAdjustedTime();
+    const int64_t now = OutOfSyncByAge() ? pindex->nTime : GetAdjustedTime();
 
-    LOCK(cs_main);
-
-    return Tally::GetAccrual(*cpid, now, pindexBest);
+    // The published tally view lets the GUI and RPC calls compute accrual
+    // without waiting for cs_main while the node connects blocks:
+    //
+    return Tally::View()->GetAccrual(*cpid, now, pindex);
 }
 
 ResearcherStatus Researcher::Status() const
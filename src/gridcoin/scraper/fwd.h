@@ -4,11 +4,14 @@
 
 #pragma once
 
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <vector>
 #include <unordered_map>
 
 #include "gridcoin/scraper/scraper_net.h"
+#include "hash.h"
 #include "util.h"
 #include "streams.h"
 
@@ -219,14 +222,15 @@ struct ConvergedManifest
 
     void ComputeConvergedContentHash()
     {
-        CDataStream ss(SER_NETWORK,1);
+        // Hash the parts in place instead of copying them into a stream:
+        CHashWriter ss(SER_NETWORK,1);
 
         for (const auto& iter : ConvergedManifestPartPtrsMap)
         {
             ss << iter.second->data;
         }
 
-        nContentHash = Hash(ss.begin(), ss.end());
+        nContentHash = ss.GetHash();
     }
 };
 
@@ -254,13 +258,244 @@ struct ScraperObjectStats
 
 struct ScraperObjectStatsKeyComp
 {
-    bool operator() ( ScraperObjectStatsKey a, ScraperObjectStatsKey b ) const
+    bool operator() (const ScraperObjectStatsKey& a, const ScraperObjectStatsKey& b) const
     {
-        return std::make_pair(a.objecttype, a.objectID) < std::make_pair(b.objecttype, b.objectID);
+        // Compare by reference. Copying the keys into pairs allocates strings
+        // on every comparison in the map:
+        if (a.objecttype != b.objecttype)
+            return a.objecttype < b.objecttype;
+
+        return a.objectID < b.objectID;
     }
 };
 
-typedef std::map<ScraperObjectStatsKey, ScraperObjectStats, ScraperObjectStatsKeyComp> ScraperStats;
+//!
+//! \brief Scraper statistics entries stored in one sorted, contiguous array.
+//!
+//! A full set of statistics contains an entry for every CPID in every project.
+//! A node-based map allocates each of these separately. This container keeps
+//! the entries in a single vector ordered by \c ScraperObjectStatsKeyComp, so
+//! it iterates in the same order as the map it replaces and implements the
+//! subset of the std::map interface that the scraper uses.
+//!
+//! Inserting a single key that sorts before the last entry shifts the entries
+//! after it. To build large sets, collect them with \c FromUnsorted() and
+//! combine sets with \c Merge().
+//!
+class ScraperStats
+{
+public:
+    typedef ScraperObjectStatsKey key_type;
+    typedef ScraperObjectStats mapped_type;
+    typedef std::pair<key_type, mapped_type> value_type;
+    typedef std::vector<value_type>::size_type size_type;
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+    //!
+    //! \brief Create a set of statistics from entries in any order.
+    //!
+    //! When the input contains more than one entry for a key, the last one
+    //! wins.
+    //!
+    //! \param entries The statistics entries to take ownership of.
+    //!
+    static ScraperStats FromUnsorted(std::vector<value_type> entries)
+    {
+        const ScraperObjectStatsKeyComp comp;
+
+        std::stable_sort(entries.begin(), entries.end(),
+            [&comp](const value_type& a, const value_type& b) { return comp(a.first, b.first); });
+
+        ScraperStats stats;
+        stats.m_entries.reserve(entries.size());
+
+        for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+            auto next = std::next(iter);
+
+            // Keep only the last of the equivalent entries:
+            if (next != entries.end() && !comp(iter->first, next->first)) {
+                continue;
+            }
+
+            stats.m_entries.emplace_back(std::move(*iter));
+        }
+
+        return stats;
+    }
+
+    iterator begin() { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+
+    size_type size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    void clear() { m_entries.clear(); }
+    void reserve(const size_type count) { m_entries.reserve(count); }
+
+    //!
+    //! \brief Get the entry for the specified key.
+    //!
+    //! \return An iterator to the entry or \c end() when no entry exists.
+    //!
+    iterator find(const key_type& key)
+    {
+        const auto iter = LowerBound(key);
+
+        if (iter == m_entries.end() || ScraperObjectStatsKeyComp()(key, iter->first)) {
+            return m_entries.end();
+        }
+
+        return iter;
+    }
+
+    //!
+    //! \brief Get the entry for the specified key.
+    //!
+    //! \return An iterator to the entry or \c end() when no entry exists.
+    //!
+    const_iterator find(const key_type& key) const
+    {
+        return const_cast<ScraperStats*>(this)->find(key);
+    }
+
+    //!
+    //! \brief Get the first entry that does not sort before the specified key.
+    //!
+    //! Entries are ordered by type and then by object ID, so this seeks to the
+    //! start of a range of entries that share a type and an ID prefix.
+    //!
+    const_iterator lower_bound(const key_type& key) const
+    {
+        return const_cast<ScraperStats*>(this)->LowerBound(key);
+    }
+
+    //!
+    //! \brief Get the number of entries for the specified key (0 or 1).
+    //!
+    size_type count(const key_type& key) const
+    {
+        return find(key) != end();
+    }
+
+    //!
+    //! \brief Add an entry unless one already exists for the key.
+    //!
+    //! \return An iterator to the entry for the key and \c true if this call
+    //! inserted it.
+    //!
+    std::pair<iterator, bool> emplace(const key_type& key, mapped_type value)
+    {
+        // Fast path for entries added in order:
+        if (m_entries.empty() || ScraperObjectStatsKeyComp()(m_entries.back().first, key)) {
+            m_entries.emplace_back(key, std::move(value));
+            return std::make_pair(std::prev(m_entries.end()), true);
+        }
+
+        const auto iter = LowerBound(key);
+
+        if (iter != m_entries.end() && !ScraperObjectStatsKeyComp()(key, iter->first)) {
+            return std::make_pair(iter, false);
+        }
+
+        return std::make_pair(m_entries.emplace(iter, key, std::move(value)), true);
+    }
+
+    //!
+    //! \brief Get the value for a key, adding an empty entry if none exists.
+    //!
+    mapped_type& operator[](const key_type& key)
+    {
+        return emplace(key, mapped_type()).first->second;
+    }
+
+    //!
+    //! \brief Add the entries in the range that do not already exist.
+    //!
+    template <typename InputIterator>
+    void insert(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first) {
+            emplace(first->first, first->second);
+        }
+    }
+
+    //!
+    //! \brief Combine another set of statistics into this one in linear time.
+    //!
+    //! Entries in \p other replace existing entries with the same key.
+    //!
+    //! \param other The statistics to merge. Taken by value so that callers
+    //! can move a set that they no longer need.
+    //!
+    void Merge(ScraperStats other)
+    {
+        if (m_entries.empty()) {
+            m_entries.swap(other.m_entries);
+            return;
+        }
+
+        const ScraperObjectStatsKeyComp comp;
+        std::vector<value_type> merged;
+        merged.reserve(m_entries.size() + other.m_entries.size());
+
+        auto a = m_entries.begin();
+        auto b = other.m_entries.begin();
+
+        while (a != m_entries.end() && b != other.m_entries.end()) {
+            if (comp(a->first, b->first)) {
+                merged.emplace_back(std::move(*a++));
+            } else {
+                if (!comp(b->first, a->first)) ++a;
+                merged.emplace_back(std::move(*b++));
+            }
+        }
+
+        std::move(a, m_entries.end(), std::back_inserter(merged));
+        std::move(b, other.m_entries.end(), std::back_inserter(merged));
+
+        m_entries.swap(merged);
+    }
+
+private:
+    std::vector<value_type> m_entries; //!< Entries sorted by key.
+
+    iterator LowerBound(const key_type& key)
+    {
+        const ScraperObjectStatsKeyComp comp;
+
+        return std::lower_bound(m_entries.begin(), m_entries.end(), key,
+            [&comp](const value_type& entry, const key_type& k) { return comp(entry.first, k); });
+    }
+};
+
+//!
+//! \brief Project statistics loaded from manifest parts, keyed by project and
+//! part hash.
+//!
+//! Validation of by-project fallback superblocks builds many convergences that
+//! share the same project parts. Loading each part once and reusing the stats
+//! avoids decompressing and parsing the same data for every combination.
+//!
+struct ScraperProjectStatsCache
+{
+    //!
+    //! \brief Magnitude allotted to each project when the stats were loaded.
+    //!
+    //! The cached stats only apply to convergences with the same number of
+    //! projects.
+    //!
+    double dMagnitudePerProject = 0.0;
+
+    //!
+    //! \brief The byCPIDbyProject and byProject stats for each project part.
+    //!
+    //! The stats carry the project name in their object IDs, so two projects
+    //! that publish byte-identical parts need separate entries.
+    //!
+    std::map<std::pair<std::string, uint256>, ScraperStats> mStatsByProjectPart;
+};
 
 // This is modeled after AppCacheEntry/Section but named separately.
 struct ScraperBeaconEntry
@@ -2,13 +2,16 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "crypto/sha256.h"
 #include "gridcoin/scraper/http.h"
 #include "tinyformat.h"
 #include "util.h"
+#include "util/strencodings.h"
 
 #include <curl/curl.h>
 #include <stdio.h>
 #include <string.h>
+#include <algorithm>
 #include <memory>
 #include <boost/thread.hpp>
 
@@ -51,6 +54,65 @@ namespace
         return size * nmemb;
     }
 
+    //!
+    //! \brief Number of times to resume an interrupted snapshot download.
+    //!
+    constexpr int SNAPSHOT_DOWNLOAD_ATTEMPTS = 5;
+
+    //!
+    //! \brief Writes a snapshot download to disk and hashes it on the way.
+    //!
+    struct SnapshotWriter
+    {
+        fs::path destination;
+        FILE* file;
+        CSHA256 hasher;
+        curl_off_t written = 0;   //!< Bytes received over every attempt.
+        curl_off_t offset = 0;    //!< Bytes received before this attempt.
+        bool checked = false;     //!< Whether this attempt checked the status.
+        CURL* curl = nullptr;
+
+        ~SnapshotWriter()
+        {
+            if (file) fclose(file);
+        }
+    };
+
+    size_t curl_write_snapshot(void* ptr, size_t size, size_t nmemb, SnapshotWriter* writer)
+    {
+        const size_t len = size * nmemb;
+
+        if (!writer->checked) {
+            writer->checked = true;
+
+            // A server that ignores the range sends the whole file again:
+            long response_code = 0;
+            curl_easy_getinfo(writer->curl, CURLINFO_RESPONSE_CODE, &response_code);
+
+            if (writer->offset > 0 && response_code != 206) {
+                fclose(writer->file);
+                writer->file = fsbridge::fopen(writer->destination, "wb");
+
+                if (!writer->file) {
+                    return 0;
+                }
+
+                writer->hasher.Reset();
+                writer->written = 0;
+                writer->offset = 0;
+            }
+        }
+
+        if (fwrite(ptr, 1, len, writer->file) != len) {
+            return 0;
+        }
+
+        writer->hasher.Write(static_cast<const unsigned char*>(ptr), len);
+        writer->written += len;
+
+        return len;
+    }
+
     typedef std::unique_ptr<CURL, decltype(&curl_easy_cleanup)> ScopedCurl;
     typedef std::unique_ptr<FILE, decltype(&fclose)> ScopedFile;
 
@@ -73,6 +135,7 @@ namespace
     struct progress {
       timetype lastruntime;
       CURL *curl;
+      curl_off_t offset;
     };
 
     static int newerprogress_callback(void *ptr, curl_off_t downtotal, curl_off_t downnow, curl_off_t uptotal, curl_off_t uplnow)
@@ -84,10 +147,12 @@ namespace
         try
         {
             boost::this_thread::interruption_point();
-            // Set this once.
+            // Set this once. A resumed transfer counts from the offset.
             if (DownloadStatus.SnapshotDownloadSize == 0)
                 DownloadStatus.SnapshotDownloadSize = downtotal;
 
+            downnow += pg->offset;
+
             timetype currenttime = 0;
             curl_easy_getinfo(curl, timeopt, &currenttime);
 
@@ -184,6 +249,63 @@ namespace
 
         return header.substr(start_quote + 1, end_quote - start_quote - 1);
     }
+
+    //!
+    //! \brief Find the ETag in the headers of an HTTP response.
+    //!
+    //! \param header Response headers separated by newlines.
+    //! \param url    URL of the request for the error message.
+    //!
+    //! \return The first standard etag value in the headers.
+    //!
+    //! \throws std::runtime_error if the headers contain no ETag.
+    //!
+    std::string FindEtag(const std::string& header, const std::string& url)
+    {
+        _log(logattribute::INFO, "Http::ETag", "Header: \n" + header);
+
+        std::istringstream iss(header);
+        for (std::string line; std::getline(iss, line);)
+        {
+            std::string etag = ParseEtag(line);
+
+            if (!etag.empty())
+            {
+                return etag;
+            }
+        }
+
+        throw std::runtime_error("No ETag response from project url <urlfile=" + url + ">");
+    }
+
+    //!
+    //! \brief Check an HTTP response code for success.
+    //!
+    //! \throws HttpException if the code represents a failure.
+    //!
+    void EvaluateResponseCode(int code, const std::string& url)
+    {
+        // Check code to make sure we have success as even a response is considered an OK
+        // We check only on head requests since they give us the information we need
+        // Codes we send back true and wait for other HTTP/ code is 301, 302, 307 and 308 since these are follows
+        if (code == 200 ||
+            code == 206 ||
+            code == 301 ||
+            code == 302 ||
+            code == 307 ||
+            code == 308)
+            return;
+        else if (code == 400)
+            throw HttpException(tfm::format("Server returned a http code of Bad Request <url=%s, code=%d>", url, code));
+        else if (code == 401)
+            throw HttpException(tfm::format("Server returned a http code of Unauthorized <url=%s, code=%d>", url, code));
+        else if (code == 403)
+            throw HttpException(tfm::format("Server returned a http code of Forbidden <url=%s, code=%d>", url, code));
+        else if (code == 404)
+            throw HttpException(tfm::format("Server returned a http code of Not Found <url=%s, code=%d>", url, code));
+
+        throw HttpException(tfm::format("Server returned a http code <url=%s, code=%d>", url, code));
+    }
 } // anonymous namespace
 
 Http::CurlLifecycle::CurlLifecycle()
@@ -250,20 +372,7 @@ std::string Http::GetEtag(
     curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
     EvaluateResponse(response_code, url);
 
-    _log(logattribute::INFO, "Http::ETag", "Header: \n" + header);
-
-    std::istringstream iss(header);
-    for (std::string line; std::getline(iss, line);)
-    {
-        std::string etag = ParseEtag(line);
-
-        if (!etag.empty())
-        {
-            return etag;
-        }
-    }
-
-    throw std::runtime_error("No ETag response from project url <urlfile=" + url + ">");
+    return FindEtag(header, url);
 }
 
 std::string Http::GetLatestVersionResponse()
@@ -305,9 +414,11 @@ void Http::DownloadSnapshot()
 
     boost::filesystem::path destination = GetDataDir() / "snapshot.zip";
 
-    ScopedFile fp(fsbridge::fopen(destination, "wb"), &fclose);
+    SnapshotWriter writer;
+    writer.destination = destination;
+    writer.file = fsbridge::fopen(destination, "wb");
 
-    if (!fp)
+    if (!writer.file)
     {
         DownloadStatus.SnapshotDownloadFailed = true;
 
@@ -315,46 +426,72 @@ void Http::DownloadSnapshot()
                 tfm::format("Snapshot Downloader: Error opening target %s: %s (%d)", destination.string(), strerror(errno), errno));
     }
 
-    std::string buffer;
-    std::string header;
-
     struct curl_slist* headers = NULL;
     headers = curl_slist_append(headers, "Accept: */*");
     headers = curl_slist_append(headers, "User-Agent: curl/7.63.0");
 
-    CURL* curl;
-    curl = curl_easy_init();
+    std::unique_ptr<curl_slist, decltype(&curl_slist_free_all)> scoped_headers(headers, &curl_slist_free_all);
+
+    ScopedCurl curl = GetContext();
+    writer.curl = curl.get();
 
     struct progress fileprogress;
 
     fileprogress.lastruntime = 0;
-    fileprogress.curl = curl;
-    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
-    curl_easy_setopt(curl, CURLOPT_PROXY, "");
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_UNRESTRICTED_AUTH, 1L);
-    curl_easy_setopt(curl, CURLOPT_VERBOSE, 0);
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 10000L);
-    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 60L);
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, curl_write_file);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp.get());
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    fileprogress.curl = curl.get();
+    fileprogress.offset = 0;
+    curl_easy_setopt(curl.get(), CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl.get(), CURLOPT_PROXY, "");
+    curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl.get(), CURLOPT_UNRESTRICTED_AUTH, 1L);
+    curl_easy_setopt(curl.get(), CURLOPT_VERBOSE, 0);
+    curl_easy_setopt(curl.get(), CURLOPT_LOW_SPEED_LIMIT, 10000L);
+    curl_easy_setopt(curl.get(), CURLOPT_LOW_SPEED_TIME, 60L);
+    curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, curl_write_snapshot);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &writer);
+    curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
 
 #if LIBCURL_VERSION_NUM >= 0x072000
-    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, newerprogress_callback);
-    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, &fileprogress);
+    curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION, newerprogress_callback);
+    curl_easy_setopt(curl.get(), CURLOPT_XFERINFODATA, &fileprogress);
 #else
-    curl_easy_setopt(curl, CURLOPT_PROGRESSFUNCTION, olderprogress_callback);
-    curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, &fileprogress);
+    curl_easy_setopt(curl.get(), CURLOPT_PROGRESSFUNCTION, olderprogress_callback);
+    curl_easy_setopt(curl.get(), CURLOPT_PROGRESSDATA, &fileprogress);
 #endif
 
-    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl.get(), CURLOPT_NOPROGRESS, 0L);
 
-    CURLcode res = curl_easy_perform(curl);
+    CURLcode res = CURLE_OK;
 
-    curl_slist_free_all(headers);
-    curl_easy_cleanup(curl);
+    for (int attempt = 1; attempt <= SNAPSHOT_DOWNLOAD_ATTEMPTS; ++attempt)
+    {
+        // Continue from the end of the data received so far:
+        writer.offset = writer.written;
+        writer.checked = false;
+        fileprogress.offset = writer.written;
+        fileprogress.lastruntime = 0;
+        curl_easy_setopt(curl.get(), CURLOPT_RESUME_FROM_LARGE, writer.written);
+
+        res = curl_easy_perform(curl.get());
+
+        if (res == CURLE_OK || res == CURLE_ABORTED_BY_CALLBACK || res == CURLE_WRITE_ERROR)
+            break;
+
+        LogPrintf("Snapshot Downloader: Transfer interrupted after %d bytes (attempt %d/%d): %s",
+            writer.written, attempt, SNAPSHOT_DOWNLOAD_ATTEMPTS, curl_easy_strerror(res));
+
+        try
+        {
+            if (attempt < SNAPSHOT_DOWNLOAD_ATTEMPTS)
+                MilliSleep(5000);
+        }
+
+        catch (boost::thread_interrupted&)
+        {
+            return;
+        }
+    }
 
     if (res > 0)
     {
@@ -371,9 +508,23 @@ void Http::DownloadSnapshot()
 
     // Validate HTTP return code.
     long response_code;
-    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response_code);
+    curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
     EvaluateResponse(response_code, url);
 
+    const int close_result = fclose(writer.file);
+    writer.file = nullptr;
+
+    if (close_result != 0)
+    {
+        DownloadStatus.SnapshotDownloadFailed = true;
+
+        throw std::runtime_error(tfm::format("Snapshot Downloader: Failed to write %s", destination.string()));
+    }
+
+    unsigned char digest[CSHA256::OUTPUT_SIZE];
+    writer.hasher.Finalize(digest);
+
+    DownloadStatus.SnapshotDownloadSHA256 = HexStr(digest, digest + sizeof(digest));
     DownloadStatus.SnapshotDownloadComplete = true;
 
     return;
@@ -438,23 +589,220 @@ std::string Http::GetSnapshotSHA256()
 
 void Http::EvaluateResponse(int code, const std::string& url)
 {
-    // Check code to make sure we have success as even a response is considered an OK
-    // We check only on head requests since they give us the information we need
-    // Codes we send back true and wait for other HTTP/ code is 301, 302, 307 and 308 since these are follows
-    if (code == 200 ||
-        code == 301 ||
-        code == 302 ||
-        code == 307 ||
-        code == 308)
+    EvaluateResponseCode(code, url);
+}
+
+// -----------------------------------------------------------------------------
+// Class: HttpPipeline
+// -----------------------------------------------------------------------------
+
+//!
+//! \brief State of a transfer queued in an HttpPipeline.
+//!
+struct HttpPipeline::Transfer
+{
+    Transfer(std::string url_in, std::string userpass_in)
+        : url(std::move(url_in))
+        , userpass(std::move(userpass_in))
+        , curl(nullptr, &curl_easy_cleanup)
+        , fp(nullptr, &fclose)
+        , headers(nullptr)
+    {
+    }
+
+    ~Transfer()
+    {
+        curl_slist_free_all(headers);
+    }
+
+    std::string url;         //!< URL to request.
+    std::string userpass;    //!< Optional HTTP credentials.
+    fs::path destination;    //!< Download destination. Empty for ETags.
+    EtagCallback on_etag;    //!< Receives the ETag of an ETag request.
+    DownloadCallback on_downloaded; //!< Called when a download completes.
+    ErrorCallback on_error;  //!< Receives the error for a failed transfer.
+
+    ScopedCurl curl;         //!< The easy handle for the transfer.
+    ScopedFile fp;           //!< Download destination file.
+    curl_slist* headers;     //!< Request headers for ETag requests.
+    std::string header;      //!< Response headers for ETag requests.
+    std::string buffer;      //!< Response body for ETag requests.
+};
+
+HttpPipeline::HttpPipeline(const size_t max_transfers, const size_t max_host_transfers)
+    : m_multi(static_cast<void*>(curl_multi_init()))
+    , m_max_transfers(std::max<size_t>(max_transfers, 1))
+{
+#if LIBCURL_VERSION_NUM >= 0x071e00
+    curl_multi_setopt(static_cast<CURLM*>(m_multi), CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(max_host_transfers));
+#endif
+}
+
+HttpPipeline::~HttpPipeline()
+{
+    for (auto& transfer_pair : m_active) {
+        curl_multi_remove_handle(static_cast<CURLM*>(m_multi), static_cast<CURL*>(transfer_pair.first));
+    }
+
+    m_active.clear();
+    curl_multi_cleanup(static_cast<CURLM*>(m_multi));
+}
+
+void HttpPipeline::GetEtag(
+    const std::string& url,
+    const std::string& userpass,
+    EtagCallback on_success,
+    ErrorCallback on_error)
+{
+    std::unique_ptr<Transfer> transfer(new Transfer(url, userpass));
+    transfer->on_etag = std::move(on_success);
+    transfer->on_error = std::move(on_error);
+
+    m_queue.emplace_back(std::move(transfer));
+}
+
+void HttpPipeline::Download(
+    const std::string& url,
+    const fs::path& destination,
+    const std::string& userpass,
+    DownloadCallback on_success,
+    ErrorCallback on_error)
+{
+    std::unique_ptr<Transfer> transfer(new Transfer(url, userpass));
+    transfer->destination = destination;
+    transfer->on_downloaded = std::move(on_success);
+    transfer->on_error = std::move(on_error);
+
+    m_queue.emplace_back(std::move(transfer));
+}
+
+void HttpPipeline::Run()
+{
+    while (!m_queue.empty() || !m_active.empty()) {
+        boost::this_thread::interruption_point();
+
+        while (m_active.size() < m_max_transfers && !m_queue.empty()) {
+            std::unique_ptr<Transfer> transfer = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            Start(std::move(transfer));
+        }
+
+        int running = 0;
+        curl_multi_perform(static_cast<CURLM*>(m_multi), &running);
+
+        int remaining = 0;
+        while (CURLMsg* message = curl_multi_info_read(static_cast<CURLM*>(m_multi), &remaining)) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+
+            CURL* handle = message->easy_handle;
+            const CURLcode result = message->data.result;
+
+            curl_multi_remove_handle(static_cast<CURLM*>(m_multi), handle);
+
+            const auto iter = m_active.find(handle);
+
+            if (iter == m_active.end()) {
+                continue;
+            }
+
+            std::unique_ptr<Transfer> transfer = std::move(iter->second);
+            m_active.erase(iter);
+
+            Finish(*transfer, result);
+        }
+
+        if (!m_active.empty()) {
+            curl_multi_wait(static_cast<CURLM*>(m_multi), nullptr, 0, 1000, nullptr);
+        }
+    }
+}
+
+void HttpPipeline::Start(std::unique_ptr<Transfer> transfer)
+{
+    transfer->curl = GetContext();
+    CURL* handle = transfer->curl.get();
+
+    curl_easy_setopt(handle, CURLOPT_URL, transfer->url.c_str());
+    curl_easy_setopt(handle, CURLOPT_USERPWD, transfer->userpass.c_str());
+
+    if (transfer->destination.empty()) {
+        transfer->headers = curl_slist_append(transfer->headers, "Accept: */*");
+        transfer->headers = curl_slist_append(transfer->headers, "User-Agent: curl/7.63.0");
+
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_string);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &transfer->buffer);
+        curl_easy_setopt(handle, CURLOPT_HEADERDATA, &transfer->header);
+        curl_easy_setopt(handle, CURLOPT_NOBODY, 1);
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, transfer->headers);
+    } else {
+        transfer->fp.reset(fsbridge::fopen(transfer->destination, "wb"));
+
+        if (!transfer->fp) {
+            transfer->on_error(tfm::format(
+                "Error opening target %s: %s (%d)",
+                transfer->destination,
+                strerror(errno),
+                errno));
+
+            return;
+        }
+
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, curl_write_file);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, transfer->fp.get());
+    }
+
+    curl_multi_add_handle(static_cast<CURLM*>(m_multi), handle);
+    m_active.emplace(handle, std::move(transfer));
+}
+
+void HttpPipeline::Finish(Transfer& transfer, const int result)
+{
+    const CURLcode res = static_cast<CURLcode>(result);
+
+    if (!transfer.destination.empty()) {
+        // Flush and close the file before the callback reads it:
+        transfer.fp.reset();
+
+        if (res > 0) {
+            transfer.on_error(tfm::format(
+                "Failed to download file %s: %s",
+                transfer.url,
+                curl_easy_strerror(res)));
+
+            return;
+        }
+
+        transfer.on_downloaded();
+
+        return;
+    }
+
+    if (res > 0) {
+        transfer.on_error(tfm::format(
+            "Failed to get ETag for URL %s: %s",
+            transfer.url,
+            curl_easy_strerror(res)));
+
+        return;
+    }
+
+    std::string etag;
+
+    try {
+        // Validate HTTP return code.
+        long response_code;
+        curl_easy_getinfo(transfer.curl.get(), CURLINFO_RESPONSE_CODE, &response_code);
+        EvaluateResponseCode(response_code, transfer.url);
+
+        etag = FindEtag(transfer.header, transfer.url);
+    } catch (const std::runtime_error& e) {
+        transfer.on_error(e.what());
+
         return;
-    else if (code == 400)
-        throw HttpException(tfm::format("Server returned a http code of Bad Request <url=%s, code=%d>", url, code));
-    else if (code == 401)
-        throw HttpException(tfm::format("Server returned a http code of Unauthorized <url=%s, code=%d>", url, code));
-    else if (code == 403)
-        throw HttpException(tfm::format("Server returned a http code of Forbidden <url=%s, code=%d>", url, code));
-    else if (code == 404)
-        throw HttpException(tfm::format("Server returned a http code of Not Found <url=%s, code=%d>", url, code));
-
-    throw HttpException(tfm::format("Server returned a http code <url=%s, code=%d>", url, code));
+    }
+
+    transfer.on_etag(etag);
 }
@@ -6,6 +6,10 @@
 
 #include <fs.h>
 
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <string>
 #include <stdexcept>
 
@@ -19,6 +23,9 @@ struct struct_SnapshotStatus{
     int SnapshotDownloadProgress;
     long long SnapshotDownloadSize = 0;
     long long SnapshotDownloadAmount = 0;
+    //! SHA256 of the downloaded file in hex, hashed as the data arrives. Set
+    //! before SnapshotDownloadComplete.
+    std::string SnapshotDownloadSHA256;
 };
 
 extern struct_SnapshotStatus DownloadStatus;
@@ -88,6 +95,8 @@ public:
     //! \brief Download Snapshot with progress updates.
     //!
     //! Downloads the snapshot from the latest snapshot.zip hosted on download.gridcoin.us.
+    //! The download hashes the data as it writes the file and resumes with a
+    //! ranged request when the transfer breaks off.
     //!
     //! \throws HttpException on invalid server response.
     //!
@@ -125,3 +134,117 @@ private:
 
     void EvaluateResponse(int code, const std::string& url);
 };
+
+//!
+//! \brief Performs scraper HTTP transfers concurrently.
+//!
+//! This wraps libcurl's multi interface to run a bounded number of ETag
+//! requests and file downloads at the same time so that one slow project
+//! server does not stall the transfers for the other projects.
+//!
+//! Completion callbacks run on the thread that calls \c Run(). They may queue
+//! more transfers, so a caller can chain the download of a file to the ETag
+//! request that determines whether the file changed.
+//!
+class HttpPipeline
+{
+public:
+    //!
+    //! \brief Called with the ETag parsed from a successful ETag request.
+    //!
+    typedef std::function<void(const std::string& etag)> EtagCallback;
+
+    //!
+    //! \brief Called when a download finishes writing its destination file.
+    //!
+    typedef std::function<void()> DownloadCallback;
+
+    //!
+    //! \brief Called with a description of the failure when a transfer fails.
+    //!
+    typedef std::function<void(const std::string& error)> ErrorCallback;
+
+    //!
+    //! \brief Initialize an empty pipeline.
+    //!
+    //! \param max_transfers      Maximum number of concurrent transfers.
+    //! \param max_host_transfers Maximum number of concurrent connections to a
+    //! single host.
+    //!
+    HttpPipeline(const size_t max_transfers, const size_t max_host_transfers);
+
+    //!
+    //! \brief Aborts any unfinished transfers.
+    //!
+    ~HttpPipeline();
+
+    //!
+    //! \brief Queue a request for the ETag of a URL.
+    //!
+    //! This behaves like \c Http::GetEtag().
+    //!
+    //! \param url        URL to fetch the ETag from.
+    //! \param userpass   Optional HTTP credentials.
+    //! \param on_success Receives the ETag.
+    //! \param on_error   Receives the error message when the request fails.
+    //!
+    void GetEtag(
+        const std::string& url,
+        const std::string& userpass,
+        EtagCallback on_success,
+        ErrorCallback on_error);
+
+    //!
+    //! \brief Queue a download of a URL to a file.
+    //!
+    //! This behaves like \c Http::Download().
+    //!
+    //! \param url         URL to download.
+    //! \param destination Destination path, including filename.
+    //! \param userpass    Optional HTTP credentials.
+    //! \param on_success  Called after the file is closed.
+    //! \param on_error    Receives the error message when the download fails.
+    //!
+    void Download(
+        const std::string& url,
+        const fs::path& destination,
+        const std::string& userpass,
+        DownloadCallback on_success,
+        ErrorCallback on_error);
+
+    //!
+    //! \brief Perform the queued transfers until all of them finish.
+    //!
+    //! This is a boost thread interruption point.
+    //!
+    void Run();
+
+private:
+    struct Transfer;
+
+    void* m_multi;                 //!< The libcurl multi handle.
+    const size_t m_max_transfers;  //!< Maximum number of concurrent transfers.
+
+    //!
+    //! \brief Transfers that wait for a free slot, in order of submission.
+    //!
+    std::deque<std::unique_ptr<Transfer>> m_queue;
+
+    //!
+    //! \brief Transfers in progress keyed by libcurl easy handle.
+    //!
+    std::map<void*, std::unique_ptr<Transfer>> m_active;
+
+    //!
+    //! \brief Add a transfer from the queue to the multi handle.
+    //!
+    void Start(std::unique_ptr<Transfer> transfer);
+
+    //!
+    //! \brief Invoke the callbacks for a finished transfer.
+    //!
+    //! \param transfer The finished transfer.
+    //! \param result   libcurl result code for the transfer.
+    //!
+    void Finish(Transfer& transfer, const int result);
+};
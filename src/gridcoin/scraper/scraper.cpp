@@ -14,7 +14,10 @@
 #include "gridcoin/scraper/scraper_net.h"
 #include "gridcoin/superblock.h"
 #include "gridcoin/support/block_finder.h"
+#include "gridcoin/support/csv.h"
 #include "gridcoin/support/xml.h"
+#include "util/perf.h"
+#include "util/threadpool.h"
 
 #include <zlib.h>
 #include <boost/algorithm/string/classification.hpp>
@@ -31,6 +34,7 @@
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/gregorian/greg_date.hpp>
 #include <random>
+#include <set>
 
 using namespace GRC;
 
@@ -44,8 +48,8 @@ bool fScraperActive = false;
 std::vector<std::pair<std::string, std::string>> vuserpass;
 std::vector<std::pair<std::string, int64_t>> vprojectteamids;
 std::vector<std::string> vauthenicationetags;
-int64_t ndownloadsize = 0;
-int64_t nuploadsize = 0;
+std::atomic<int64_t> ndownloadsize(0);
+std::atomic<int64_t> nuploadsize(0);
 
 enum class logattribute
 {
@@ -102,7 +106,7 @@ ScraperFileManifest StructScraperFileManifest = {};
 //
 CCriticalSection CSplitBlob::cs_mapParts;
 CCriticalSection CScraperManifest::cs_mapManifest;
-std::map<uint256, CSplitBlob::CPart> CSplitBlob::mapParts;
+CSplitBlob::PartMap CSplitBlob::mapParts;
 std::map<uint256, std::shared_ptr<CScraperManifest>> CScraperManifest::mapManifest;
 
 // Global cache for converged scraper stats. Access must be with the lock cs_ConvergedScraperStatsCache taken.
@@ -147,6 +151,8 @@ bool ProcessProjectStatsFromStreamByCPID(const std::string& project, boostio::fi
 bool ProcessNetworkWideFromProjectStats(ScraperStats& mScraperStats);
 bool StoreStats(const fs::path& file, const ScraperStats& mScraperStats);
 bool ScraperSaveCScraperManifestToFiles(uint256 nManifestHash);
+bool StoreCScraperManifestCache();
+unsigned int LoadCScraperManifestCache();
 bool ScraperSendFileManifestContents(CBitcoinAddress& Address, CKey& Key);
 mmCSManifestsBinnedByScraper BinCScraperManifestsByScraper();
 mmCSManifestsBinnedByScraper ScraperCullAndBinCScraperManifests();
@@ -160,7 +166,7 @@ bool DownloadProjectTeamFiles(const WhitelistSnapshot& projectWhitelist);
 bool ProcessProjectTeamFile(const std::string& project, const fs::path& file, const std::string& etag);
 bool DownloadProjectRacFilesByCPID(const WhitelistSnapshot& projectWhitelist);
 bool ProcessProjectRacFileByCPID(const std::string& project, const fs::path& file, const std::string& etag,
-                                 BeaconConsensus& Consensus, ScraperVerifiedBeacons& GlobalVerifiedBeaconsCopy,
+                                 const BeaconConsensus& Consensus, const ScraperVerifiedBeacons& GlobalVerifiedBeaconsCopy,
                                  ScraperVerifiedBeacons& IncomingVerifiedBeacons);
 bool AuthenticationETagUpdate(const std::string& project, const std::string& etag);
 void AuthenticationETagClear();
@@ -215,14 +221,16 @@ BeaconConsensus GetConsensusBeaconList()
         max_time = pMaxConsensusLadder->nTime;
 
         const auto& beacon_registry = GetBeaconRegistry();
-        const auto& beacon_map = beacon_registry.Beacons();
         const auto& pending_beacon_map = beacon_registry.PendingBeacons();
 
         // Copy the set of beacons out of the registry so we can release the
-        // lock on cs_main before stringifying them:
+        // lock on cs_main before stringifying them. The registry selects the
+        // active beacons from its timestamp index:
         //
-        beacons.reserve(beacon_map.size());
-        beacons.assign(beacon_map.begin(), beacon_map.end());
+        for (const auto& beacon_pair : beacon_registry.FindActive(max_time)) {
+            beacons.emplace_back(beacon_pair.first, *beacon_pair.second);
+        }
+
         pending_beacons.reserve(pending_beacon_map.size());
         pending_beacons.assign(pending_beacon_map.begin(), pending_beacon_map.end());
     }
@@ -232,11 +240,6 @@ BeaconConsensus GetConsensusBeaconList()
         const Cpid& cpid = beacon_pair.first;
         const Beacon& beacon = beacon_pair.second;
 
-        if (beacon.Expired(max_time) || beacon.m_timestamp >= max_time)
-        {
-            continue;
-        }
-
         ScraperBeaconEntry beaconentry;
 
         beaconentry.timestamp = beacon.m_timestamp;
@@ -382,6 +385,37 @@ void UpdateVerifiedBeaconsFromConsensus(BeaconConsensus& Consensus)
 
     _log(logattribute::INFO, "ENDLOCK", "cs_VerifiedBeacons");
 }
+
+//!
+//! \brief Run a task for each of a number of projects on a bounded set of
+//! threads from the background pool.
+//!
+//! The calling thread takes a share of the tasks and blocks until every task
+//! finishes, so a caller can merge the per-project results afterward without
+//! further synchronization. Tasks receive the index of the project to process.
+//! An interruption of the calling thread propagates once the other tasks end,
+//! as the tasks refer to the caller's stack. Failed tasks are logged and the
+//! first exception propagates the same way, so a caller never merges the
+//! results of a partial set of projects.
+//!
+//! \param count Number of projects to process.
+//! \param task  Processes the project at the supplied index.
+//!
+void ForEachProjectConcurrently(const size_t count, const std::function<void(size_t)>& task)
+{
+    util::ParallelFor(util::Executor::BACKGROUND, count, [&task](size_t index)
+    {
+        try
+        {
+            task(index);
+        }
+        catch (const std::exception& e)
+        {
+            _log(logattribute::ERR, "ForEachProjectConcurrently", "Project task failed: " + std::string(e.what()));
+            throw;
+        }
+    }, std::max<size_t>(nScraperProcessingThreads, 1));
+}
 } // anonymous namespace
 
 /**********************
@@ -400,17 +434,32 @@ private:
 
     fsbridge::ofstream logfile;
 
+    // Drained by the background writer of the main logger with -logasync:
+    std::shared_ptr<BCLog::AsyncQueue> m_queue;
+
 public:
 
     ScraperLogger()
     {
-        LOCK(cs_log);
+        {
+            LOCK(cs_log);
+
+            fs::path plogfile = pathDataDir / "scraper.log";
+            logfile.open(plogfile, std::ios_base::out | std::ios_base::app);
+
+            if (!logfile.is_open())
+                LogPrintf("ERROR: Scraper: Logger: Failed to open logging file\n");
+        }
 
-        fs::path plogfile = pathDataDir / "scraper.log";
-        logfile.open(plogfile, std::ios_base::out | std::ios_base::app);
+        m_queue = LogInstance().CreateAsyncQueue([this](const std::string& batch) {
+            LOCK(cs_log);
 
-        if (!logfile.is_open())
-            LogPrintf("ERROR: Scraper: Logger: Failed to open logging file\n");
+            if (logfile.is_open())
+            {
+                logfile << batch;
+                logfile.flush();
+            }
+        });
     }
 
     ~ScraperLogger()
@@ -426,6 +475,9 @@ public:
 
     void output(const std::string& tofile)
     {
+        if (m_queue && m_queue->Push(tofile + "\n"))
+            return;
+
         LOCK(cs_log);
 
         if (logfile.is_open())
@@ -957,6 +1009,79 @@ void ScraperApplyAppCacheEntries()
 
 
 
+namespace {
+// The events that end the waits of the scraper threads in event-driven mode.
+constexpr unsigned int SCRAPER_WAKE_MANIFEST = 1 << 0; // A manifest arrived with all of its parts.
+constexpr unsigned int SCRAPER_WAKE_CHAIN = 1 << 1;    // The whitelist, beacons or scraper entries changed.
+
+// Events usually arrive in bursts, like the parts of several manifests. Wait this long after the first
+// one so that a single pass handles the burst.
+constexpr int64_t SCRAPER_EVENT_SETTLE_MS = 10 * 1000;
+
+// The longest time that a thread idles in event-driven mode without an event, so that culling of expired
+// manifests still runs.
+constexpr int64_t SCRAPER_EVENT_MAX_IDLE_MS = 3600 * 1000;
+
+boost::mutex mutexScraperWake;
+boost::condition_variable condScraperWake;
+unsigned int nScraperWakeEvents = 0;
+
+// Sleep for nMilliseconds. In event-driven mode, return early after one of the events in nWakeOn arrives.
+void ScraperSleep(const int64_t nMilliseconds, const unsigned int nWakeOn)
+{
+    if (!fScraperEventDriven)
+    {
+        MilliSleep(nMilliseconds);
+        return;
+    }
+
+    bool fWoken = false;
+
+    {
+        boost::unique_lock<boost::mutex> lock(mutexScraperWake);
+
+        fWoken = condScraperWake.wait_for(lock, boost::chrono::milliseconds(nMilliseconds),
+                                          [nWakeOn] { return (nScraperWakeEvents & nWakeOn) || fShutdown; });
+
+        nScraperWakeEvents &= ~nWakeOn;
+    }
+
+    if (fWoken && !fShutdown)
+    {
+        _log(logattribute::INFO, "ScraperSleep", "Woken by a scraper event.");
+
+        MilliSleep(SCRAPER_EVENT_SETTLE_MS);
+
+        boost::lock_guard<boost::mutex> lock(mutexScraperWake);
+        nScraperWakeEvents &= ~nWakeOn;
+    }
+}
+
+// The time to idle in event-driven mode: until the scraper becomes active before the next superblock is due,
+// but no less than nScraperSleep and no more than SCRAPER_EVENT_MAX_IDLE_MS. This is in milliseconds.
+int64_t ScraperEventIdleTime()
+{
+    const int64_t sbage = SuperblockAge();
+
+    if (sbage < 0) return nScraperSleep;
+
+    const int64_t nUntilActive = (86400 - (int64_t) nActiveBeforeSB - sbage) * 1000;
+
+    return std::max<int64_t>(std::min(nUntilActive, SCRAPER_EVENT_MAX_IDLE_MS), nScraperSleep);
+}
+} // anonymous namespace
+
+// Wake the scraper threads in event-driven mode. This only takes its own lock, so callers may hold any others.
+void WakeScraper(const bool fChainEvent)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutexScraperWake);
+        nScraperWakeEvents |= fChainEvent ? SCRAPER_WAKE_CHAIN : SCRAPER_WAKE_MANIFEST;
+    }
+
+    condScraperWake.notify_all();
+}
+
 // This is the "main" scraper function.
 // It will be instantiated as a separate thread if -scraper is specified as a startup argument,
 // and operate in a continuous while loop.
@@ -975,6 +1100,9 @@ void Scraper(bool bSingleShot)
 
     _log(logattribute::INFO, "Scraper", "Using data directory " + pathScraper.string());
 
+    // Restore the manifests held before the last shutdown.
+    if (!bSingleShot) LoadCScraperManifestCache();
+
     if (!bSingleShot)
         _log(logattribute::INFO, "Scraper", "Starting Scraper thread.");
     else
@@ -1068,9 +1196,24 @@ void Scraper(bool bSingleShot)
 
                 sbage = SuperblockAge();
                 _log(logattribute::INFO, "Scraper", "Superblock not needed. age=" + std::to_string(sbage));
-                _log(logattribute::INFO, "Scraper", "Sleeping for " + std::to_string(nScraperSleep / 1000) +" seconds");
 
-                MilliSleep(nScraperSleep);
+                if (fScraperEventDriven)
+                {
+                    // Only culling happens here, so idle until an event or the run up to the superblock.
+                    int64_t nIdleTime = std::min<int64_t>(ScraperEventIdleTime(),
+                                                          (nBeforeSBSleep - (GetAdjustedTime() - nScraperThreadStartTime)) * 1000);
+                    nIdleTime = std::max<int64_t>(nIdleTime, 1000);
+
+                    _log(logattribute::INFO, "Scraper", "Waiting up to " + std::to_string(nIdleTime / 1000) +" seconds for scraper events");
+
+                    ScraperSleep(nIdleTime, SCRAPER_WAKE_MANIFEST | SCRAPER_WAKE_CHAIN);
+                }
+                else
+                {
+                    _log(logattribute::INFO, "Scraper", "Sleeping for " + std::to_string(nScraperSleep / 1000) +" seconds");
+
+                    MilliSleep(nScraperSleep);
+                }
             }
         }
 
@@ -1190,7 +1333,10 @@ void Scraper(bool bSingleShot)
             ScraperHousekeeping();
 
             _log(logattribute::INFO, "Scraper", "Sleeping for " + std::to_string(nScraperSleep / 1000) +" seconds");
-            MilliSleep(nScraperSleep);
+
+            // Manifests from other scrapers do not change the stats to download, but a whitelist or beacon change
+            // does, so only a chain event ends this sleep early.
+            ScraperSleep(nScraperSleep, SCRAPER_WAKE_CHAIN);
         }
         else
             // This will break from the outer while loop if in singleshot mode and end execution after one pass.
@@ -1223,6 +1369,9 @@ void ScraperSubscriber()
 
     _log(logattribute::INFO, "Scraper", "Using data directory " + pathScraper.string());
 
+    // Restore the manifests held before the last shutdown.
+    if (!fScraperActive) LoadCScraperManifestCache();
+
     _log(logattribute::INFO, "ScraperSubscriber", "Starting scraper subscriber housekeeping thread. \n"
                                               "Note that this does NOT mean the subscriber is active. This simply does housekeeping "
                                               "functions.");
@@ -1264,10 +1413,22 @@ void ScraperSubscriber()
             _log(logattribute::INFO, "ENDLOCK", "cs_Scraper");
         }
 
-        // Use the same sleep interval configured for the scraper.
-        _log(logattribute::INFO, "ScraperSubscriber", "Sleeping for " + std::to_string(nScraperSleep / 1000) +" seconds");
+        if (fScraperEventDriven)
+        {
+            // Idle until new manifests or chain changes can change the convergence, or the superblock is close to due.
+            const int64_t nIdleTime = ScraperEventIdleTime();
+
+            _log(logattribute::INFO, "ScraperSubscriber", "Waiting up to " + std::to_string(nIdleTime / 1000) +" seconds for scraper events");
+
+            ScraperSleep(nIdleTime, SCRAPER_WAKE_MANIFEST | SCRAPER_WAKE_CHAIN);
+        }
+        else
+        {
+            // Use the same sleep interval configured for the scraper.
+            _log(logattribute::INFO, "ScraperSubscriber", "Sleeping for " + std::to_string(nScraperSleep / 1000) +" seconds");
 
-        MilliSleep(nScraperSleep);
+            MilliSleep(nScraperSleep);
+        }
     }
 }
 
@@ -1304,6 +1465,9 @@ bool ScraperHousekeeping()
              + std::to_string(CScraperManifest::mapPendingDeletedManifest.size()));
     }
 
+    // Keep the manifest cache on disk in step with mapManifest so that a restart can reload it.
+    StoreCScraperManifestCache();
+
     if (LogInstance().WillLogCategory(BCLog::LogFlags::SCRAPER) && superblock.WellFormed())
     {
         UniValue input_params(UniValue::VARR);
@@ -1661,6 +1825,8 @@ bool DownloadProjectHostFiles(const WhitelistSnapshot& projectWhitelist)
 
 bool DownloadProjectTeamFiles(const WhitelistSnapshot& projectWhitelist)
 {
+    PERF_SCOPE("Scraper.DownloadProjectTeamFiles");
+
     if (!projectWhitelist.Populated())
     {
         _log(logattribute::CRITICAL, "DownloadProjectTeamFiles", "Whitelist is not populated");
@@ -1677,31 +1843,49 @@ bool DownloadProjectTeamFiles(const WhitelistSnapshot& projectWhitelist)
         return false;
     }
 
-    for (const auto& prjs : projectWhitelist)
+    // The ETag requests and downloads for all of the projects run concurrently
+    // in the pipeline. Team files to process are recorded here by the position
+    // of the project in the whitelist so that processing still happens in
+    // whitelist order after the transfers finish.
+    struct TeamDownload
     {
-        LOCK(cs_TeamIDMap);
-        _log(logattribute::INFO, "LOCK", "cs_TeamIDMap");
+        std::string etag;
+        fs::path file;
+        bool etag_changed;
+    };
 
-        const auto iter = TeamIDMap.find(prjs.m_name);
-        bool fProjTeamIDsMissing = false;
+    std::map<size_t, TeamDownload> downloaded_team_files;
 
-        if (iter == TeamIDMap.end() || iter->second.size() != GetTeamWhiteList().size()) fProjTeamIDsMissing = true;
+    HttpPipeline pipeline(nScraperParallelDownloads, SCRAPER_MAX_HOST_DOWNLOADS);
+    size_t project_index = 0;
+
+    for (const auto& prjs : projectWhitelist)
+    {
+        const size_t index = project_index++;
 
-        // If fExplorer is false, which means we do not need to retain team files, and there are no TeamID entries missing,
-        // then skip processing altogether.
-        if (!fExplorer && !fProjTeamIDsMissing)
         {
-            _log(logattribute::INFO, "DownloadProjectTeamFiles", "Correct team whitelist entries already in the team ID map for "
-                 + prjs.m_name + " project. Skipping team file download and processing.");
-            continue;
+            LOCK(cs_TeamIDMap);
+            _log(logattribute::INFO, "LOCK", "cs_TeamIDMap");
+
+            const auto iter = TeamIDMap.find(prjs.m_name);
+            bool fProjTeamIDsMissing = false;
+
+            if (iter == TeamIDMap.end() || iter->second.size() != GetTeamWhiteList().size()) fProjTeamIDsMissing = true;
+
+            _log(logattribute::INFO, "ENDLOCK", "cs_TeamIDMap");
+
+            // If fExplorer is false, which means we do not need to retain team files, and there are no TeamID entries missing,
+            // then skip processing altogether.
+            if (!fExplorer && !fProjTeamIDsMissing)
+            {
+                _log(logattribute::INFO, "DownloadProjectTeamFiles", "Correct team whitelist entries already in the team ID map for "
+                     + prjs.m_name + " project. Skipping team file download and processing.");
+                continue;
+            }
         }
 
         _log(logattribute::INFO, "DownloadProjectTeamFiles", "Downloading project file for " + prjs.m_name);
 
-        // Grab ETag of team file
-        Http http;
-        std::string sTeamETag;
-
         bool buserpass = false;
         std::string userpass;
 
@@ -1717,114 +1901,141 @@ bool DownloadProjectTeamFiles(const WhitelistSnapshot& projectWhitelist)
             }
         }
 
-        try
-        {
-            sTeamETag = http.GetEtag(prjs.StatsUrl("team"), userpass);
-        }
-        catch (const std::runtime_error& e)
-        {
-            _log(logattribute::ERR, "DownloadProjectTeamFiles", "Failed to pull team header file for " + prjs.m_name + ": " + e.what());
-            continue;
-        }
+        const GRC::Project& project = prjs;
 
-        if (sTeamETag.empty())
+        // Grab ETag of team file
+        pipeline.GetEtag(prjs.StatsUrl("team"), userpass,
+            [&pipeline, &downloaded_team_files, &project, index, buserpass, userpass](const std::string& sTeamETag)
         {
-            _log(logattribute::ERR, "DownloadProjectTeamFiles", "ETag for project is empty" + prjs.m_name);
+            if (sTeamETag.empty())
+            {
+                _log(logattribute::ERR, "DownloadProjectTeamFiles", "ETag for project is empty" + project.m_name);
 
-            continue;
-        }
-        else
-            _log(logattribute::INFO, "DownloadProjectTeamFiles", "Successfully pulled team header file for " + prjs.m_name);
+                return;
+            }
+            else
+                _log(logattribute::INFO, "DownloadProjectTeamFiles", "Successfully pulled team header file for " + project.m_name);
 
-        if (buserpass)
-        {
-            authdata ad(lowercase(prjs.m_name));
+            if (buserpass)
+            {
+                authdata ad(lowercase(project.m_name));
 
-            ad.setoutputdata("team", prjs.m_name, sTeamETag);
+                ad.setoutputdata("team", project.m_name, sTeamETag);
 
-            if (!ad.xport())
-                _log(logattribute::CRITICAL, "DownloadProjectTeamFiles", "Failed to export etag for " + prjs.m_name + " to authentication file");
-        }
+                if (!ad.xport())
+                    _log(logattribute::CRITICAL, "DownloadProjectTeamFiles", "Failed to export etag for " + project.m_name + " to authentication file");
+            }
 
-        std::string team_file_name;
-        fs::path team_file;
-        bool bDownloadFlag = false;
-        bool bETagChanged = false;
+            std::string team_file_name;
+            fs::path team_file;
+            bool bDownloadFlag = false;
+            bool bETagChanged = false;
 
-        // Detect change in ETag from in memory versioning.
-        // ProjTeamETags is not persisted to disk. There would be little to be gained by doing so. The scrapers are restarted very
-        // rarely, and on restart, this would only save downloading team files for those projects that have one or TeamIDs missing AND
-        // an ETag had NOT changed since the last pull. Not worth the complexity.
-        auto const& iPrevETag = ProjTeamETags.find(prjs.m_name);
+            // Detect change in ETag from in memory versioning.
+            // ProjTeamETags is not persisted to disk. There would be little to be gained by doing so. The scrapers are restarted very
+            // rarely, and on restart, this would only save downloading team files for those projects that have one or TeamIDs missing AND
+            // an ETag had NOT changed since the last pull. Not worth the complexity.
+            {
+                LOCK(cs_TeamIDMap);
 
-        if (iPrevETag == ProjTeamETags.end() || iPrevETag->second != sTeamETag)
-        {
-            bETagChanged  = true;
+                auto const& iPrevETag = ProjTeamETags.find(project.m_name);
 
-            _log(logattribute::INFO, "DownloadProjectTeamFiles", "Team header file ETag has changed for " + prjs.m_name);
-        }
+                if (iPrevETag == ProjTeamETags.end() || iPrevETag->second != sTeamETag)
+                {
+                    bETagChanged  = true;
 
+                    _log(logattribute::INFO, "DownloadProjectTeamFiles", "Team header file ETag has changed for " + project.m_name);
+                }
+            }
 
-        if (fExplorer)
-        {
-            // Use eTag versioning ON THE DISK with eTag versioned team files per project.
-            team_file_name = prjs.m_name + "-" + sTeamETag + "-team.gz";
-            team_file = pathScraper / team_file_name;
 
-            // If the file with the same eTag already exists, don't download it again. Leave bDownloadFlag false.
-            if (fs::exists(team_file))
+            if (fExplorer)
             {
-                _log(logattribute::INFO, "DownloadProjectTeamFiles", "Etag file for " + prjs.m_name + " already exists");
-                 // continue;
+                // Use eTag versioning ON THE DISK with eTag versioned team files per project.
+                team_file_name = project.m_name + "-" + sTeamETag + "-team.gz";
+                team_file = pathScraper / team_file_name;
+
+                // If the file with the same eTag already exists, don't download it again. Leave bDownloadFlag false.
+                if (fs::exists(team_file))
+                {
+                    _log(logattribute::INFO, "DownloadProjectTeamFiles", "Etag file for " + project.m_name + " already exists");
+                     // continue;
+                }
+                else
+                {
+                    bDownloadFlag = true;
+                }
             }
             else
             {
-                bDownloadFlag = true;
+                // Not in explorer mode...
+                // No versioning ON THE DISK for the individual team files for a given project. However, if the eTag pulled from the header
+                // does not match the entry in ProjTeamETags, then download the file and process. Note that this combined with the size check
+                // above means that the size of the inner map for the mTeamIDs for this project already doesn't match, which means either there
+                // were teams that cannot be associated (-1 entries in the file), or there was an addition to or deletion from the team
+                // whitelist. Either way if the ETag has changed under this condition, the -1 entries may be subject to change so the team file
+                // must be downloaded and processed to see if it has and update. If the ETag matches what was in the map, then the state
+                // has not changed since the team file was last processed, and no need to download and process again.
+                team_file_name = project.m_name + "-team.gz";
+                team_file = pathScraper / team_file_name;
+
+                if (bETagChanged)
+                {
+                    if (fs::exists(team_file)) fs::remove(team_file);
+
+                    bDownloadFlag = true;
+                }
             }
-        }
-        else
-        {
-            // Not in explorer mode...
-            // No versioning ON THE DISK for the individual team files for a given project. However, if the eTag pulled from the header
-            // does not match the entry in ProjTeamETags, then download the file and process. Note that this combined with the size check
-            // above means that the size of the inner map for the mTeamIDs for this project already doesn't match, which means either there
-            // were teams that cannot be associated (-1 entries in the file), or there was an addition to or deletion from the team
-            // whitelist. Either way if the ETag has changed under this condition, the -1 entries may be subject to change so the team file
-            // must be downloaded and processed to see if it has and update. If the ETag matches what was in the map, then the state
-            // has not changed since the team file was last processed, and no need to download and process again.
-            team_file_name = prjs.m_name + "-team.gz";
-            team_file = pathScraper / team_file_name;
-
-            if (bETagChanged)
+
+            // If no new team file at the project site is detected, the existing file is processed as-is.
+            if (!bDownloadFlag)
             {
-                if (fs::exists(team_file)) fs::remove(team_file);
+                downloaded_team_files[index] = { sTeamETag, team_file, bETagChanged };
 
-                bDownloadFlag = true;
+                return;
             }
-        }
 
-        // If a new team file at the project site is detected, then download new file. (I.e. bDownload flag is true).
-        if (bDownloadFlag)
-        {
-            try
+            // If a new team file at the project site is detected, then download new file. (I.e. bDownload flag is true).
+            pipeline.Download(project.StatsUrl("team"), team_file, userpass,
+                [&downloaded_team_files, &project, index, sTeamETag, team_file, bETagChanged]()
             {
-                http.Download(prjs.StatsUrl("team"), team_file, userpass);
-            }
-            catch(const std::runtime_error& e)
+                // If in explorer mode and new file downloaded, save team xml files to file manifest map with exclude from CSManifest flag set to true.
+                // If not in explorer mode, this is not necessary, because the team xml file is just temporary and can be discarded after
+                // processing.
+                if (fExplorer) AlignScraperFileManifestEntries(team_file, "team", project.m_name, true);
+
+                downloaded_team_files[index] = { sTeamETag, team_file, bETagChanged };
+            },
+                [&project](const std::string& error)
             {
-                _log(logattribute::ERR, "DownloadProjectTeamFiles", "Failed to download project team file for " + prjs.m_name + ": " + e.what());
-                continue;
-            }
-        }
+                _log(logattribute::ERR, "DownloadProjectTeamFiles", "Failed to download project team file for " + project.m_name + ": " + error);
+            });
+        },
+            [&project](const std::string& error)
+        {
+            _log(logattribute::ERR, "DownloadProjectTeamFiles", "Failed to pull team header file for " + project.m_name + ": " + error);
+        });
+    }
+
+    pipeline.Run();
 
-        // If in explorer mode and new file downloaded, save team xml files to file manifest map with exclude from CSManifest flag set to true.
-        // If not in explorer mode, this is not necessary, because the team xml file is just temporary and can be discarded after
-        // processing.
-        if (fExplorer && bDownloadFlag) AlignScraperFileManifestEntries(team_file, "team", prjs.m_name, true);
+    project_index = 0;
+
+    for (const auto& prjs : projectWhitelist)
+    {
+        const auto iter = downloaded_team_files.find(project_index++);
+
+        if (iter == downloaded_team_files.end()) continue;
+
+        LOCK(cs_TeamIDMap);
+        _log(logattribute::INFO, "LOCK", "cs_TeamIDMap");
 
         // If require team whitelist is set and bETagChanged is true, then process the file. This also populates/updated the team whitelist TeamIDs
         // in the TeamIDMap and the ETag entries in the ProjTeamETags map.
-        if (REQUIRE_TEAM_WHITELIST_MEMBERSHIP && bETagChanged) ProcessProjectTeamFile(prjs.m_name, team_file, sTeamETag);
+        if (REQUIRE_TEAM_WHITELIST_MEMBERSHIP && iter->second.etag_changed)
+        {
+            ProcessProjectTeamFile(prjs.m_name, iter->second.file, iter->second.etag);
+        }
 
         _log(logattribute::INFO, "ENDLOCK", "cs_TeamIDMap");
     }
@@ -1862,44 +2073,37 @@ bool ProcessProjectTeamFile(const std::string& project, const fs::path& file, co
     _log(logattribute::INFO, "ProcessProjectTeamFile", "Started processing " + file.filename().string());
 
     std::vector<std::string> vTeamWhiteList = GetTeamWhiteList();
+    const std::set<std::string> setTeamWhiteList(vTeamWhiteList.begin(), vTeamWhiteList.end());
 
-    std::string line;
-    stringbuilder builder;
+    GRC::XmlRecordReader reader(in, "team");
 
-    while (std::getline(in, line))
+    // A team file contains every team of the project, but the whitelist only
+    // names a few. Stop decompressing the file once the IDs of all of them are
+    // resolved:
+    while (mTeamIdsForProject.size() < setTeamWhiteList.size() && reader.NextRecord())
     {
-        if (line == "<team>")
-            builder.clear();
-        else if (line == "</team>")
-        {
-            const std::string& data = builder.value();
-            builder.clear();
+        const std::string sTeamName = reader.Field("name");
 
-            const std::string& sTeamID = ExtractXML(data, "<id>", "</id>");
-            const std::string& sTeamName = ExtractXML(data, "<name>", "</name>");
+        // See if the team name is in the team whitelist.
+        // If it is not continue on to next team.
+        if (!setTeamWhiteList.count(sTeamName))
+            continue;
 
-            // See if the team name is in the team whitelist.
-            auto iter = find(vTeamWhiteList.begin(), vTeamWhiteList.end(), sTeamName);
-            // If it is not continue on to next team.
-            if (iter == vTeamWhiteList.end())
-                continue;
+        const std::string sTeamID = reader.Field("id");
 
-            int64_t nTeamID = 0;
+        int64_t nTeamID = 0;
 
-            try
-            {
-                nTeamID = atoi64(sTeamID);
-            }
-            catch (const std::exception&)
-            {
-                _log(logattribute::ERR, "ProccessProjectTeamFile", tfm::format("Ignoring bad team id for team %s.", sTeamName));
-                continue;
-            }
-
-            mTeamIdsForProject[sTeamName] = nTeamID;
+        try
+        {
+            nTeamID = atoi64(sTeamID);
         }
-        else
-            builder.append(line);
+        catch (const std::exception&)
+        {
+            _log(logattribute::ERR, "ProccessProjectTeamFile", tfm::format("Ignoring bad team id for team %s.", sTeamName));
+            continue;
+        }
+
+        mTeamIdsForProject[sTeamName] = nTeamID;
     }
 
     if (mTeamIdsForProject.empty())
@@ -1947,6 +2151,8 @@ bool ProcessProjectTeamFile(const std::string& project, const fs::path& file, co
 
 bool DownloadProjectRacFilesByCPID(const WhitelistSnapshot& projectWhitelist)
 {
+    PERF_SCOPE("Scraper.DownloadProjectRacFiles");
+
     if (!projectWhitelist.Populated())
     {
         _log(logattribute::CRITICAL, "DownloadProjectRacFiles", "Whitelist is not populated");
@@ -1999,13 +2205,26 @@ bool DownloadProjectRacFilesByCPID(const WhitelistSnapshot& projectWhitelist)
     // in a run-through of all of the projects.
     ScraperVerifiedBeacons IncomingVerifiedBeacons;
 
+    // The ETag requests and downloads for all of the projects run concurrently
+    // in the pipeline. Projects with a new rac file are recorded here by their
+    // position in the whitelist so that processing still happens in whitelist
+    // order after the transfers finish.
+    struct RacDownload
+    {
+        std::string etag;
+        fs::path file;
+    };
+
+    std::map<size_t, RacDownload> downloaded_rac_files;
+
+    HttpPipeline pipeline(nScraperParallelDownloads, SCRAPER_MAX_HOST_DOWNLOADS);
+    size_t project_index = 0;
+
     for (const auto& prjs : projectWhitelist)
     {
         _log(logattribute::INFO, "DownloadProjectRacFiles", "Downloading project file for " + prjs.m_name);
 
-        // Grab ETag of rac file
-        Http http;
-        std::string sRacETag;
+        const size_t index = project_index++;
 
         bool buserpass = false;
         std::string userpass;
@@ -2022,89 +2241,130 @@ bool DownloadProjectRacFilesByCPID(const WhitelistSnapshot& projectWhitelist)
             }
         }
 
-        try
-        {
-            sRacETag = http.GetEtag(prjs.StatsUrl("user"), userpass);
-        } catch (const std::runtime_error& e)
-        {
-            _log(logattribute::ERR, "DownloadProjectRacFiles", "Failed to pull rac header file for " + prjs.m_name + ": " + e.what());
-            continue;
-        }
+        const GRC::Project& project = prjs;
 
-        if (sRacETag.empty())
+        // Grab ETag of rac file
+        pipeline.GetEtag(prjs.StatsUrl("user"), userpass,
+            [&pipeline, &downloaded_rac_files, &project, index, buserpass, userpass](const std::string& sRacETag)
         {
-            _log(logattribute::ERR, "DownloadProjectRacFiles", "ETag for project is empty" + prjs.m_name);
+            if (sRacETag.empty())
+            {
+                _log(logattribute::ERR, "DownloadProjectRacFiles", "ETag for project is empty" + project.m_name);
 
-            continue;
-        }
+                return;
+            }
 
-        else
-            _log(logattribute::INFO, "DownloadProjectRacFiles", "Successfully pulled rac header file for " + prjs.m_name);
+            else
+                _log(logattribute::INFO, "DownloadProjectRacFiles", "Successfully pulled rac header file for " + project.m_name);
 
-        if (buserpass)
-        {
-            authdata ad(lowercase(prjs.m_name));
+            if (buserpass)
+            {
+                authdata ad(lowercase(project.m_name));
 
-            ad.setoutputdata("user", prjs.m_name, sRacETag);
+                ad.setoutputdata("user", project.m_name, sRacETag);
 
-            if (!ad.xport())
-                _log(logattribute::CRITICAL, "DownloadProjectRacFiles", "Failed to export etag for " + prjs.m_name + " to authentication file");
-        }
-
-        std::string rac_file_name;
-        fs::path rac_file;
+                if (!ad.xport())
+                    _log(logattribute::CRITICAL, "DownloadProjectRacFiles", "Failed to export etag for " + project.m_name + " to authentication file");
+            }
 
-        std::string processed_rac_file_name;
-        fs::path processed_rac_file;
+            std::string rac_file_name;
+            fs::path rac_file;
 
-        processed_rac_file_name = prjs.m_name + "-" + sRacETag + ".csv" + ".gz";
-        processed_rac_file = pathScraper / processed_rac_file_name;
+            std::string processed_rac_file_name;
+            fs::path processed_rac_file;
 
-        if (fExplorer)
-        {
-            // Use eTag versioning for source file.
-            rac_file_name = prjs.m_name + "-" + sRacETag + "-user.gz";
-            rac_file = pathScraper / rac_file_name;
+            processed_rac_file_name = project.m_name + "-" + sRacETag + ".csv" + ".gz";
+            processed_rac_file = pathScraper / processed_rac_file_name;
 
-            //  If the file was already processed, both should be here. If both here, skip processing.
-            if (fs::exists(rac_file) && fs::exists(processed_rac_file))
+            if (fExplorer)
             {
-                _log(logattribute::INFO, "DownloadProjectRacFiles", "Etag file for " + prjs.m_name + " already exists");
-                continue;
+                // Use eTag versioning for source file.
+                rac_file_name = project.m_name + "-" + sRacETag + "-user.gz";
+                rac_file = pathScraper / rac_file_name;
+
+                //  If the file was already processed, both should be here. If both here, skip processing.
+                if (fs::exists(rac_file) && fs::exists(processed_rac_file))
+                {
+                    _log(logattribute::INFO, "DownloadProjectRacFiles", "Etag file for " + project.m_name + " already exists");
+                    return;
+                }
             }
-        }
-        else
-        {
-            // No versioning for source file. If file exists delete it and download anew, unless processed file already present.
-            rac_file_name = prjs.m_name + "-user.gz";
-            rac_file = pathScraper / rac_file_name;
+            else
+            {
+                // No versioning for source file. If file exists delete it and download anew, unless processed file already present.
+                rac_file_name = project.m_name + "-user.gz";
+                rac_file = pathScraper / rac_file_name;
 
-            if (fs::exists(rac_file)) fs::remove(rac_file);
+                if (fs::exists(rac_file)) fs::remove(rac_file);
 
-            //  If the file was already processed, skip processing.
-            if (fs::exists(processed_rac_file))
-            {
-                _log(logattribute::INFO, "DownloadProjectRacFiles", "Etag file for " + prjs.m_name + " already exists");
-                continue;
+                //  If the file was already processed, skip processing.
+                if (fs::exists(processed_rac_file))
+                {
+                    _log(logattribute::INFO, "DownloadProjectRacFiles", "Etag file for " + project.m_name + " already exists");
+                    return;
+                }
             }
-        }
 
-        try
+            pipeline.Download(project.StatsUrl("user"), rac_file, userpass,
+                [&downloaded_rac_files, &project, index, sRacETag, rac_file]()
+            {
+                // If in explorer mode, save user (rac) source xml files to file manifest map with exclude from CSManifest flag set to true.
+                if (fExplorer) AlignScraperFileManifestEntries(rac_file, "user_source", project.m_name, true);
+
+                downloaded_rac_files[index] = { sRacETag, rac_file };
+            },
+                [&project](const std::string& error)
+            {
+                _log(logattribute::ERR, "DownloadProjectRacFiles", "Failed to download project rac file for " + project.m_name + ": " + error);
+            });
+        },
+            [&project](const std::string& error)
         {
-            http.Download(prjs.StatsUrl("user"), rac_file, userpass);
-        }
-        catch(const std::runtime_error& e)
+            _log(logattribute::ERR, "DownloadProjectRacFiles", "Failed to pull rac header file for " + project.m_name + ": " + error);
+        });
+    } // for prjs : projectWhitelist
+
+    pipeline.Run();
+
+    // Now that the source files are handled, process the files. Each project
+    // is independent, so the files are processed concurrently. The pending
+    // beacons verified by each project are merged in whitelist order after
+    // all of the projects finish.
+    std::vector<std::pair<std::string, RacDownload>> rac_files;
+
+    project_index = 0;
+
+    for (const auto& prjs : projectWhitelist)
+    {
+        const auto iter = downloaded_rac_files.find(project_index++);
+
+        if (iter == downloaded_rac_files.end()) continue;
+
+        rac_files.emplace_back(prjs.m_name, iter->second);
+    }
+
+    std::vector<ScraperVerifiedBeacons> ProjectVerifiedBeacons(rac_files.size());
+
+    ForEachProjectConcurrently(rac_files.size(), [&](size_t index)
+    {
+        ProcessProjectRacFileByCPID(
+            rac_files[index].first,
+            rac_files[index].second.file,
+            rac_files[index].second.etag,
+            Consensus,
+            GlobalVerifiedBeaconsCopy,
+            ProjectVerifiedBeacons[index]);
+    });
+
+    for (const auto& project_verified_beacons : ProjectVerifiedBeacons)
+    {
+        for (const auto& iter_pair : project_verified_beacons.mVerifiedMap)
         {
-            _log(logattribute::ERR, "DownloadProjectRacFiles", "Failed to download project rac file for " + prjs.m_name + ": " + e.what());
-            continue;
+            IncomingVerifiedBeacons.mVerifiedMap[iter_pair.first] = iter_pair.second;
         }
 
-        // If in explorer mode, save user (rac) source xml files to file manifest map with exclude from CSManifest flag set to true.
-        if (fExplorer) AlignScraperFileManifestEntries(rac_file, "user_source", prjs.m_name, true);
-
-        // Now that the source file is handled, process the file.
-        ProcessProjectRacFileByCPID(prjs.m_name, rac_file, sRacETag, Consensus, GlobalVerifiedBeaconsCopy, IncomingVerifiedBeacons);
-    } // for prjs : projectWhitelist
+        IncomingVerifiedBeacons.timestamp = std::max(IncomingVerifiedBeacons.timestamp, project_verified_beacons.timestamp);
+    }
 
     // Get the global verified beacons and copy the incoming verified beacons from the
     // ProcessProjectRacFileByCPID iterations into the global.
@@ -2159,9 +2419,11 @@ bool DownloadProjectRacFilesByCPID(const WhitelistSnapshot& projectWhitelist)
 
 // This version uses a consensus beacon map (and teamid, if team filtering is specified by policy) to filter statistics.
 bool ProcessProjectRacFileByCPID(const std::string& project, const fs::path& file, const std::string& etag,
-                                 BeaconConsensus& Consensus, ScraperVerifiedBeacons& GlobalVerifiedBeaconsCopy,
+                                 const BeaconConsensus& Consensus, const ScraperVerifiedBeacons& GlobalVerifiedBeaconsCopy,
                                  ScraperVerifiedBeacons& IncomingVerifiedBeacons)
 {
+    PERF_SCOPE("Scraper.ProcessProjectRacFile");
+
     // Set fileerror flag to true until made false by the completion of one successful injection of user stats into stream.
     bool bfileerror = true;
 
@@ -2390,25 +2652,88 @@ bool ProcessProjectRacFileByCPID(const std::string& project, const fs::path& fil
 }
 
 
+namespace {
+//!
+//! \brief Identifies a version of a file by its path, size, and modification
+//! time.
+//!
+struct FileHashKey
+{
+    std::string path;
+    uintmax_t size;
+    std::time_t mtime;
+
+    bool operator<(const FileHashKey& other) const
+    {
+        return std::tie(path, size, mtime) < std::tie(other.path, other.size, other.mtime);
+    }
+};
+
+//!
+//! \brief Hashes of the files hashed by GetFileHash(). The scraper checks the
+//! same unchanged files on every housekeeping pass.
+//!
+std::map<FileHashKey, uint256> g_file_hash_cache;
+CCriticalSection cs_file_hash_cache;
+
+//!
+//! \brief Maximum number of cached file hashes. The cache starts over when
+//! it grows past this size, which drops the entries of deleted files.
+//!
+constexpr size_t MAX_FILE_HASH_CACHE_SIZE = 4096;
+
+//!
+//! \brief Number of bytes that GetFileHash() reads at a time.
+//!
+constexpr size_t FILE_HASH_CHUNK_SIZE = 64 * 1024;
+} // anonymous namespace
+
 uint256 GetFileHash(const fs::path& inputfile)
 {
+    uint256 nHash;
+
+    boost::system::error_code ec;
+    const uintmax_t size = fs::file_size(inputfile, ec);
+    const std::time_t mtime = ec ? 0 : fs::last_write_time(inputfile, ec);
+
+    if (ec) {
+        return nHash;
+    }
+
+    const FileHashKey key { inputfile.string(), size, mtime };
+
+    {
+        LOCK(cs_file_hash_cache);
+
+        const auto iter = g_file_hash_cache.find(key);
+
+        if (iter != g_file_hash_cache.end()) {
+            return iter->second;
+        }
+    }
+
     // open input file, and associate with CAutoFile
     FILE *file = fsbridge::fopen(inputfile, "rb");
     CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
-    uint256 nHash;
 
     if (filein.IsNull())
         return nHash;
 
-    // use file size to size memory buffer
-    int dataSize = boost::filesystem::file_size(inputfile);
-    std::vector<unsigned char> vchData;
-    vchData.resize(dataSize);
+    // Hash the file in chunks instead of loading it into memory:
+    CHash256 hasher;
+    std::vector<unsigned char> vchData(FILE_HASH_CHUNK_SIZE);
+    uintmax_t remaining = size;
 
-    // read data and checksum from file
     try
     {
-        filein.read((char *)&vchData[0], dataSize);
+        while (remaining > 0)
+        {
+            const size_t chunk = std::min<uintmax_t>(remaining, vchData.size());
+
+            filein.read((char *)vchData.data(), chunk);
+            hasher.Write(vchData.data(), chunk);
+            remaining -= chunk;
+        }
     }
     catch (std::exception &e)
     {
@@ -2417,9 +2742,21 @@ uint256 GetFileHash(const fs::path& inputfile)
 
     filein.fclose();
 
-    CDataStream ssFile(vchData, SER_DISK, CLIENT_VERSION);
+    hasher.Finalize(nHash.begin());
+
+    // A file rewritten within the resolution of the modification time keeps
+    // the same key, so only cache the hashes of files that settled:
+    if (mtime < GetTime() - 2)
+    {
+        LOCK(cs_file_hash_cache);
+
+        if (g_file_hash_cache.size() >= MAX_FILE_HASH_CACHE_SIZE)
+        {
+            g_file_hash_cache.clear();
+        }
 
-    nHash = Hash(ssFile.begin(), ssFile.end());
+        g_file_hash_cache.emplace(key, nHash);
+    }
 
     return nHash;
 }
@@ -2625,9 +2962,11 @@ bool StoreBeaconList(const fs::path& file)
         return false;
     }
 
-    boostio::filtering_istream out;
-    out.push(boostio::gzip_compressor());
-    std::stringstream stream;
+    // Compress the text as it is written instead of assembling all of it in
+    // a string stream first:
+    boostio::filtering_ostream stream;
+    stream.push(boostio::gzip_compressor());
+    stream.push(outgzfile);
 
     _log(logattribute::INFO, "StoreBeaconList", "Started processing " + file.string());
 
@@ -2642,8 +2981,7 @@ bool StoreBeaconList(const fs::path& file)
 
     _log(logattribute::INFO, "StoreBeaconList", "Finished processing beacon data from map.");
 
-    out.push(stream);
-    boost::iostreams::copy(out, outgzfile);
+    stream.reset();
     outgzfile.flush();
     outgzfile.close();
 
@@ -2670,9 +3008,11 @@ bool StoreTeamIDList(const fs::path& file)
         return false;
     }
 
-    boostio::filtering_istream out;
-    out.push(boostio::gzip_compressor());
-    std::stringstream stream;
+    // Compress the text as it is written instead of assembling all of it in
+    // a string stream first:
+    boostio::filtering_ostream stream;
+    stream.push(boostio::gzip_compressor());
+    stream.push(outgzfile);
 
     _log(logattribute::INFO, "StoreTeamIDList", "Started processing " + file.string());
 
@@ -2721,8 +3061,7 @@ bool StoreTeamIDList(const fs::path& file)
 
     _log(logattribute::INFO, "StoreTeamIDList", "Finished processing Team ID data from map.");
 
-    out.push(stream);
-    boost::iostreams::copy(out, outgzfile);
+    stream.reset();
     outgzfile.flush();
     outgzfile.close();
 
@@ -3034,9 +3373,11 @@ bool StoreStats(const fs::path& file, const ScraperStats& mScraperStats)
         return false;
     }
 
-    boostio::filtering_istream out;
-    out.push(boostio::gzip_compressor());
-    std::stringstream stream;
+    // Compress the text as it is written instead of assembling all of it in
+    // a string stream first:
+    boostio::filtering_ostream stream;
+    stream.push(boostio::gzip_compressor());
+    stream.push(outgzfile);
 
     _log(logattribute::INFO, "StoreStats", "Started processing " + file.string());
 
@@ -3085,8 +3426,7 @@ bool StoreStats(const fs::path& file, const ScraperStats& mScraperStats)
 
     _log(logattribute::INFO, "StoreStats", "Finished processing stats from map.");
 
-    out.push(stream);
-    boost::iostreams::copy(out, outgzfile);
+    stream.reset();
     outgzfile.flush();
     outgzfile.close();
 
@@ -3142,66 +3482,78 @@ bool LoadProjectObjectToStatsByCPID(const std::string& project, const CSerialize
 bool ProcessProjectStatsFromStreamByCPID(const std::string& project, boostio::filtering_istream& sUncompressedIn,
                                          const double& projectmag, ScraperStats& mScraperStats)
 {
-    std::vector<std::string> vXML;
+    // Tokenize the lines in place to avoid allocating strings for every line
+    // and field. Projects export hundreds of thousands of CPIDs:
+    GRC::CsvReader reader(sUncompressedIn);
 
-    // Lets vector the user blocks
-    std::string line;
+    std::string objectID_prefix = project + ",";
     double dProjectRAC = 0.0;
-    while (std::getline(sUncompressedIn, line))
+
+    // Collect the entries unordered and sort them once at the end:
+    std::vector<ScraperStats::value_type> entries;
+
+    while (reader.NextLine())
     {
-        if (line[0] == '#')
+        const GRC::CsvField line = reader.Line();
+
+        if (!line.empty() && *line.begin() == '#')
             continue;
 
-        std::vector<std::string> fields;
-        boost::split(fields, line, boost::is_any_of(","), boost::token_compress_on);
+        const std::vector<GRC::CsvField>& fields = reader.Fields();
 
         if (fields.size() < 4)
             continue;
 
         ScraperObjectStats statsentry = {};
 
-        const std::string& sTC = fields[0];
-        const std::string& sRAT = fields[1];
-        const std::string& sRAC = fields[2];
-        const std::string& cpid = fields[3];
+        const GRC::CsvField& sTC = fields[0];
+        const GRC::CsvField& sRAT = fields[1];
+        const GRC::CsvField& sRAC = fields[2];
+        const GRC::CsvField& cpid = fields[3];
 
         // Replace blank strings with zeros.
-        statsentry.statsvalue.dTC = (sTC.empty()) ? 0.0 : std::stod(sTC);
-        statsentry.statsvalue.dRAT = (sRAT.empty()) ? 0.0 : std::stod(sRAT);
-        statsentry.statsvalue.dRAC = (sRAC.empty()) ? 0.0 : std::stod(sRAC);
+        statsentry.statsvalue.dTC = (sTC.empty()) ? 0.0 : sTC.ToDouble();
+        statsentry.statsvalue.dRAT = (sRAT.empty()) ? 0.0 : sRAT.ToDouble();
+        statsentry.statsvalue.dRAC = (sRAC.empty()) ? 0.0 : sRAC.ToDouble();
         // At the individual (byCPIDbyProject) level the AvgRAC is the same as the RAC.
         statsentry.statsvalue.dAvgRAC = statsentry.statsvalue.dRAC;
         // Mag is dealt with on the second pass... so is left at 0.0 on the first pass.
 
         statsentry.statskey.objecttype = statsobjecttype::byCPIDbyProject;
-        statsentry.statskey.objectID = project + "," + cpid;
-
-        // Insert stats entry into map by the key.
-        mScraperStats[statsentry.statskey] = statsentry;
+        statsentry.statskey.objectID.reserve(objectID_prefix.size() + cpid.size());
+        statsentry.statskey.objectID.assign(objectID_prefix);
+        statsentry.statskey.objectID.append(cpid.begin(), cpid.end());
 
         // Increment project
         dProjectRAC += statsentry.statsvalue.dRAC;
+
+        // Insert stats entry by the key. Duplicates resolve to the last entry.
+        ScraperObjectStatsKey statskey = statsentry.statskey;
+        entries.emplace_back(std::move(statskey), std::move(statsentry));
     }
 
+    mScraperStats.Merge(ScraperStats::FromUnsorted(std::move(entries)));
+
     _log(logattribute::INFO, "LoadProjectObjectToStatsByCPID", "There are " + std::to_string(mScraperStats.size()) + " CPID entries for " + project);
 
     // The mScraperStats here is scoped to only this project so we do not need project filtering here.
-    ScraperStats::iterator entry;
+    // Compute the magnitudes over a contiguous column of RAC values so that the compiler can vectorize
+    // the arithmetic. The operations and their order match MagRound(dRAC / dProjectRAC * projectmag) for
+    // each entry, so the results are the same to the bit. MAG_ROUND is copied because stores into the
+    // column could otherwise alias the global.
+    std::vector<double> vMag;
+    vMag.reserve(mScraperStats.size());
 
-    for (auto const& entry : mScraperStats)
+    for (const auto& entry : mScraperStats)
     {
-        ScraperObjectStats statsentry;
+        vMag.push_back(entry.second.statsvalue.dRAC);
+    }
 
-        statsentry.statskey = entry.first;
-        statsentry.statsvalue.dTC = entry.second.statsvalue.dTC;
-        statsentry.statsvalue.dRAT = entry.second.statsvalue.dRAT;
-        statsentry.statsvalue.dRAC = entry.second.statsvalue.dRAC;
-        // As per the above the individual (byCPIDbyProject) level the AvgRAC is the same as the RAC.
-        statsentry.statsvalue.dAvgRAC = entry.second.statsvalue.dAvgRAC;
-        statsentry.statsvalue.dMag = MagRound(entry.second.statsvalue.dRAC / dProjectRAC * projectmag);
+    const double dMagRound = MAG_ROUND;
 
-        // Update map entry with the magnitude.
-        mScraperStats[statsentry.statskey] = statsentry;
+    for (double& dMag : vMag)
+    {
+        dMag = round(dMag / dProjectRAC * projectmag / dMagRound) * dMagRound;
     }
 
     // Due to rounding to MAG_ROUND, the actual total project magnitude will not be exactly projectmag,
@@ -3212,8 +3564,12 @@ bool ProcessProjectStatsFromStreamByCPID(const std::string& project, boostio::fi
     ProjectStatsEntry.statskey.objectID = project;
 
     unsigned int nCPIDCount = 0;
-    for (auto const& entry : mScraperStats)
+    for (auto& entry : mScraperStats)
     {
+        // Update map entry with the magnitude. As per the above the individual
+        // (byCPIDbyProject) level the AvgRAC is the same as the RAC.
+        entry.second.statsvalue.dMag = vMag[nCPIDCount];
+
         ProjectStatsEntry.statsvalue.dTC += entry.second.statsvalue.dTC;
         ProjectStatsEntry.statsvalue.dRAT += entry.second.statsvalue.dRAT;
         ProjectStatsEntry.statsvalue.dRAC += entry.second.statsvalue.dRAC;
@@ -3239,51 +3595,34 @@ bool ProcessProjectStatsFromStreamByCPID(const std::string& project, boostio::fi
 // ---------------------------------------------- In/Out
 bool ProcessNetworkWideFromProjectStats(ScraperStats& mScraperStats)
 {
-    // -------- CPID ----------------- stats entry ---- # of projects
-    std::map<std::string, std::pair<ScraperObjectStats, unsigned int>> mByCPID;
+    PERF_SCOPE("Scraper.ProcessNetworkWideStats");
+
+    // Group the byCPIDbyProject entries by CPID with a sort of their positions instead of a hash map of
+    // CPID strings. The sort is stable, so the projects of a CPID add up in the same order as before.
+    // ---------- entry ------------------------ offset of the CPID in objectID
+    std::vector<std::pair<const ScraperStats::value_type*, size_t>> vByCPIDbyProject;
+    vByCPIDbyProject.reserve(mScraperStats.size());
 
     for (const auto& byCPIDbyProjectEntry : mScraperStats)
     {
         if (byCPIDbyProjectEntry.first.objecttype == statsobjecttype::byCPIDbyProject)
         {
-            std::string CPID = split(byCPIDbyProjectEntry.first.objectID, ",")[1];
+            // The objectID is "project,cpid":
+            const std::string& objectID = byCPIDbyProjectEntry.first.objectID;
 
-            auto mByCPID_entry = mByCPID.find(CPID);
-            if (mByCPID_entry != mByCPID.end())
-            {
-                mByCPID_entry->second.first.statsvalue.dTC += byCPIDbyProjectEntry.second.statsvalue.dTC;
-                mByCPID_entry->second.first.statsvalue.dRAT += byCPIDbyProjectEntry.second.statsvalue.dRAT;
-                mByCPID_entry->second.first.statsvalue.dRAC += byCPIDbyProjectEntry.second.statsvalue.dRAC;
-                mByCPID_entry->second.first.statsvalue.dMag += byCPIDbyProjectEntry.second.statsvalue.dMag;
-                // Note the following is VERY inelegant. It CAPS the CPID magnitude to CPID_MAG_LIMIT.
-                // No attempt to renormalize the magnitudes due to this cap is done at this time. This means
-                // The total magnitude across projects will NOT match the total across all CPIDs and the network.
-                mByCPID_entry->second.first.statsvalue.dMag = std::min(CPID_MAG_LIMIT, mByCPID_entry->second.first.statsvalue.dMag);
-                // Increment number of projects tallied
-                ++mByCPID_entry->second.second;
-            }
-            else
-            {
-                // Since an entry did not already exist, start a new one.
-                ScraperObjectStats CPIDStatsEntry;
-
-                CPIDStatsEntry.statskey.objecttype = statsobjecttype::byCPID;
-                CPIDStatsEntry.statskey.objectID = CPID;
-
-                CPIDStatsEntry.statsvalue.dTC = byCPIDbyProjectEntry.second.statsvalue.dTC;
-                CPIDStatsEntry.statsvalue.dRAT = byCPIDbyProjectEntry.second.statsvalue.dRAT;
-                CPIDStatsEntry.statsvalue.dRAC = byCPIDbyProjectEntry.second.statsvalue.dRAC;
-                // Note the following is VERY inelegant. It CAPS the CPID magnitude to CPID_MAG_LIMIT.
-                // No attempt to renormalize the magnitudes due to this cap is done at this time. This means
-                // The total magnitude across projects will NOT match the total across all CPIDs and the network.
-                CPIDStatsEntry.statsvalue.dMag = std::min(CPID_MAG_LIMIT, byCPIDbyProjectEntry.second.statsvalue.dMag);
-
-                // This is the first project encountered, because otherwise there would already be an entry.
-                mByCPID[CPID] = std::make_pair(CPIDStatsEntry, 1);
-            }
+            vByCPIDbyProject.emplace_back(&byCPIDbyProjectEntry, objectID.find(',') + 1);
         }
     }
 
+    const auto CPIDLess = [](const std::pair<const ScraperStats::value_type*, size_t>& a,
+                             const std::pair<const ScraperStats::value_type*, size_t>& b)
+    {
+        return a.first->first.objectID.compare(a.second, std::string::npos,
+                                             b.first->first.objectID, b.second, std::string::npos) < 0;
+    };
+
+    std::stable_sort(vByCPIDbyProject.begin(), vByCPIDbyProject.end(), CPIDLess);
+
     unsigned int nCPIDProjectCount = 0;
 
     //Also track the network wide rollup.
@@ -3293,28 +3632,61 @@ bool ProcessNetworkWideFromProjectStats(ScraperStats& mScraperStats)
     // ObjectID is blank string for network-wide.
     NetworkWideStatsEntry.statskey.objectID = "";
 
-    for (auto mByCPID_entry = mByCPID.begin(); mByCPID_entry != mByCPID.end(); ++mByCPID_entry)
+    // Collect the rolled-up entries to merge into the overall set at once:
+    std::vector<ScraperStats::value_type> rollup_entries;
+
+    for (auto iter = vByCPIDbyProject.begin(); iter != vByCPIDbyProject.end(); )
     {
-        unsigned int nProjectCount = mByCPID_entry->second.second;
+        // Start the entry for the CPID with its first project.
+        ScraperObjectStats CPIDStatsEntry;
+
+        CPIDStatsEntry.statskey.objecttype = statsobjecttype::byCPID;
+        CPIDStatsEntry.statskey.objectID = iter->first->first.objectID.substr(iter->second);
+
+        CPIDStatsEntry.statsvalue.dTC = iter->first->second.statsvalue.dTC;
+        CPIDStatsEntry.statsvalue.dRAT = iter->first->second.statsvalue.dRAT;
+        CPIDStatsEntry.statsvalue.dRAC = iter->first->second.statsvalue.dRAC;
+        // Note the following is VERY inelegant. It CAPS the CPID magnitude to CPID_MAG_LIMIT.
+        // No attempt to renormalize the magnitudes due to this cap is done at this time. This means
+        // The total magnitude across projects will NOT match the total across all CPIDs and the network.
+        CPIDStatsEntry.statsvalue.dMag = std::min(CPID_MAG_LIMIT, iter->first->second.statsvalue.dMag);
+
+        unsigned int nProjectCount = 1;
+
+        auto next = std::next(iter);
 
-        // Compute CPID AvgRAC across the projects for that CPID and set.
-        if (nProjectCount)
-        {
-            mByCPID_entry->second.first.statsvalue.dAvgRAC = mByCPID_entry->second.first.statsvalue.dRAC / nProjectCount;
-        }
-        else
+        for (; next != vByCPIDbyProject.end() && !CPIDLess(*iter, *next); ++next)
         {
-            mByCPID_entry->second.first.statsvalue.dAvgRAC = 0.0;
+            CPIDStatsEntry.statsvalue.dTC += next->first->second.statsvalue.dTC;
+            CPIDStatsEntry.statsvalue.dRAT += next->first->second.statsvalue.dRAT;
+            CPIDStatsEntry.statsvalue.dRAC += next->first->second.statsvalue.dRAC;
+            CPIDStatsEntry.statsvalue.dMag += next->first->second.statsvalue.dMag;
+            CPIDStatsEntry.statsvalue.dMag = std::min(CPID_MAG_LIMIT, CPIDStatsEntry.statsvalue.dMag);
+            // Increment number of projects tallied
+            ++nProjectCount;
         }
 
+        // Compute CPID AvgRAC across the projects for that CPID and set.
+        CPIDStatsEntry.statsvalue.dAvgRAC = CPIDStatsEntry.statsvalue.dRAC / nProjectCount;
+
         // Update scraper map with complete entry including dAvgRAC
-        mScraperStats[mByCPID_entry->second.first.statskey] = mByCPID_entry->second.first;
+        ScraperObjectStatsKey statskey = CPIDStatsEntry.statskey;
+        rollup_entries.emplace_back(std::move(statskey), std::move(CPIDStatsEntry));
+
+        iter = next;
+    }
 
+    ScraperStats mByCPIDStats = ScraperStats::FromUnsorted(std::move(rollup_entries));
+
+    // Sum in CPID order so that the network-wide totals do not depend on the
+    // iteration order of the hash map above.
+    for (const auto& entry : mByCPIDStats)
+    {
         // Increment the network wide stats.
-        NetworkWideStatsEntry.statsvalue.dTC += mByCPID_entry->second.first.statsvalue.dTC;
-        NetworkWideStatsEntry.statsvalue.dRAT += mByCPID_entry->second.first.statsvalue.dRAT;
-        NetworkWideStatsEntry.statsvalue.dRAC += mByCPID_entry->second.first.statsvalue.dRAC;
-        NetworkWideStatsEntry.statsvalue.dMag += mByCPID_entry->second.first.statsvalue.dMag;
+        NetworkWideStatsEntry.statsvalue.dTC += entry.second.statsvalue.dTC;
+        NetworkWideStatsEntry.statsvalue.dRAT += entry.second.statsvalue.dRAT;
+        NetworkWideStatsEntry.statsvalue.dRAC += entry.second.statsvalue.dRAC;
+        NetworkWideStatsEntry.statsvalue.dMag += entry.second.statsvalue.dMag;
 
         ++nCPIDProjectCount;
     }
@@ -3330,7 +3702,9 @@ bool ProcessNetworkWideFromProjectStats(ScraperStats& mScraperStats)
     }
 
     // Insert the (single) network-wide entry into the overall map.
-    mScraperStats[NetworkWideStatsEntry.statskey] = NetworkWideStatsEntry;
+    mByCPIDStats.emplace(NetworkWideStatsEntry.statskey, NetworkWideStatsEntry);
+
+    mScraperStats.Merge(std::move(mByCPIDStats));
 
     return true;
 }
@@ -3369,25 +3743,34 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsByCurrentFileManifestState()
         LOCK(cs_StructScraperFileManifest);
         _log(logattribute::INFO, "LOCK", "GetScraperStatsByCurrentFileManifestState - load project file to stats: cs_StructScraperFileManifest");
 
+        std::vector<std::pair<std::string, fs::path>> project_files;
+
         for (auto const& entry : StructScraperFileManifest.mScraperFileManifest)
         {
 
             if (entry.second.current && !entry.second.excludefromcsmanifest)
             {
-                std::string project = entry.first;
-                fs::path file = pathScraper / entry.second.filename;
-                ScraperStats mProjectScraperStats;
+                project_files.emplace_back(entry.first, pathScraper / entry.second.filename);
+            }
+        }
 
-                _log(logattribute::INFO, "GetScraperStatsByCurrentFileManifestState", "Processing stats for project: " + project);
+        // Load the projects concurrently and merge them into the overall map
+        // once all of them finish.
+        std::vector<ScraperStats> ProjectScraperStats(project_files.size());
 
-                LoadProjectFileToStatsByCPID(project, file, dMagnitudePerProject, mProjectScraperStats);
+        ForEachProjectConcurrently(project_files.size(), [&](size_t index)
+        {
+            const std::string& project = project_files[index].first;
 
-                // Insert into overall map.
-                for (auto const& entry2 : mProjectScraperStats)
-                {
-                    mScraperStats[entry2.first] = entry2.second;
-                }
-            }
+            _log(logattribute::INFO, "GetScraperStatsByCurrentFileManifestState", "Processing stats for project: " + project);
+
+            LoadProjectFileToStatsByCPID(project, project_files[index].second, dMagnitudePerProject, ProjectScraperStats[index]);
+        });
+
+        // Insert into overall map.
+        for (auto& mProjectScraperStats : ProjectScraperStats)
+        {
+            mScraperStats.Merge(std::move(mProjectScraperStats));
         }
 
         // End LOCK(cs_StructScraperFileManifest)
@@ -3420,8 +3803,11 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsByCurrentFileManifestState()
 }
 
 
-ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const ConvergedManifest& StructConvergedManifest)
+ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const ConvergedManifest& StructConvergedManifest,
+                                                                  const ScraperProjectStatsCache* project_stats_cache)
 {
+    PERF_SCOPE("Scraper.GetStatsByConvergedManifest");
+
     _log(logattribute::INFO, "GetScraperStatsByConvergedManifest", "Beginning stats processing.");
 
     ScraperStatsAndVerifiedBeacons stats_and_verified_beacons;
@@ -3436,7 +3822,7 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const Converge
     const auto& iter = StructConvergedManifest.ConvergedManifestPartPtrsMap.find("VerifiedBeacons");
     if (iter != StructConvergedManifest.ConvergedManifestPartPtrsMap.end())
     {
-        CDataStream part(iter->second->data, SER_NETWORK, 1);
+        SpanReader part = iter->second->getReader();
 
         try
         {
@@ -3459,25 +3845,52 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const Converge
 
     ScraperStats mScraperStats;
 
+    // Stats loaded for a different number of projects have the wrong magnitudes:
+    if (project_stats_cache && project_stats_cache->dMagnitudePerProject != dMagnitudePerProject)
+    {
+        project_stats_cache = nullptr;
+    }
+
+    std::vector<std::pair<std::string, const CSplitBlob::CPart*>> project_parts;
 
     for (auto entry = StructConvergedManifest.ConvergedManifestPartPtrsMap.begin(); entry != StructConvergedManifest.ConvergedManifestPartPtrsMap.end(); ++entry)
     {
-        std::string project = entry->first;
-        ScraperStats mProjectScraperStats;
-
         // Do not process the BeaconList or VerifiedBeacons as a project stats file.
-        if (project != "BeaconList" && project != "VerifiedBeacons")
+        if (entry->first != "BeaconList" && entry->first != "VerifiedBeacons")
         {
-            _log(logattribute::INFO, "GetScraperStatsByConvergedManifest", "Processing stats for project: " + project);
+            project_parts.emplace_back(entry->first, entry->second);
+        }
+    }
 
-            LoadProjectObjectToStatsByCPID(project, entry->second->data, dMagnitudePerProject, mProjectScraperStats);
+    // Load the projects concurrently and merge them into the overall map once
+    // all of them finish.
+    std::vector<ScraperStats> ProjectScraperStats(project_parts.size());
+
+    ForEachProjectConcurrently(project_parts.size(), [&](size_t index)
+    {
+        const std::string& project = project_parts[index].first;
+
+        if (project_stats_cache)
+        {
+            const auto cached = project_stats_cache->mStatsByProjectPart.find(
+                std::make_pair(project, project_parts[index].second->hash));
 
-            // Insert into overall map.
-            for (auto const& entry2 : mProjectScraperStats)
+            if (cached != project_stats_cache->mStatsByProjectPart.end())
             {
-                mScraperStats[entry2.first] = entry2.second;
+                ProjectScraperStats[index] = cached->second;
+                return;
             }
         }
+
+        _log(logattribute::INFO, "GetScraperStatsByConvergedManifest", "Processing stats for project: " + project);
+
+        LoadProjectObjectToStatsByCPID(project, project_parts[index].second->data, dMagnitudePerProject, ProjectScraperStats[index]);
+    });
+
+    // Insert into overall map.
+    for (auto& mProjectScraperStats : ProjectScraperStats)
+    {
+        mScraperStats.Merge(std::move(mProjectScraperStats));
     }
 
     ProcessNetworkWideFromProjectStats(mScraperStats);
@@ -3489,6 +3902,34 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const Converge
     return stats_and_verified_beacons;
 }
 
+// Loads the stats for each of the supplied project parts into the cache so that GetScraperStatsByConvergedManifest()
+// can reuse them across convergences that share the parts. nActiveProjects is the number of projects in those
+// convergences.
+void LoadProjectPartsToStatsCache(const std::vector<std::pair<std::string, const CSplitBlob::CPart*>>& project_parts,
+                                  unsigned int nActiveProjects, ScraperProjectStatsCache& project_stats_cache)
+{
+    project_stats_cache.dMagnitudePerProject = NETWORK_MAGNITUDE / nActiveProjects;
+    project_stats_cache.mStatsByProjectPart.clear();
+
+    std::vector<ScraperStats> ProjectScraperStats(project_parts.size());
+
+    ForEachProjectConcurrently(project_parts.size(), [&](size_t index)
+    {
+        LoadProjectObjectToStatsByCPID(
+            project_parts[index].first,
+            project_parts[index].second->data,
+            project_stats_cache.dMagnitudePerProject,
+            ProjectScraperStats[index]);
+    });
+
+    for (size_t i = 0; i < project_parts.size(); ++i)
+    {
+        project_stats_cache.mStatsByProjectPart.emplace(
+            std::make_pair(project_parts[i].first, project_parts[i].second->hash),
+            std::move(ProjectScraperStats[i]));
+    }
+}
+
 // This function should only be used as part of the superblock validation in bv11+.
 ScraperStatsAndVerifiedBeacons GetScraperStatsFromSingleManifest(CScraperManifest_shared_ptr& manifest)
 {
@@ -3510,7 +3951,7 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsFromSingleManifest(CScraperManifes
     const auto& iter = StructDummyConvergedManifest.ConvergedManifestPartPtrsMap.find("VerifiedBeacons");
     if (iter != StructDummyConvergedManifest.ConvergedManifestPartPtrsMap.end())
     {
-        CDataStream part(iter->second->data, SER_NETWORK, 1);
+        SpanReader part = iter->second->getReader();
 
         try
         {
@@ -3531,21 +3972,34 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsFromSingleManifest(CScraperManifes
 
     double dMagnitudePerProject = NETWORK_MAGNITUDE / nActiveProjects;
 
+    std::vector<std::pair<std::string, const CSplitBlob::CPart*>> project_parts;
+
     for (auto entry = StructDummyConvergedManifest.ConvergedManifestPartPtrsMap.begin(); entry != StructDummyConvergedManifest.ConvergedManifestPartPtrsMap.end(); ++entry)
     {
-        std::string project = entry->first;
-        ScraperStats mProjectScraperStats;
-
         // Do not process the BeaconList or VerifiedBeacons as a project stats file.
-        if (project != "BeaconList" && project != "VerifiedBeacons")
+        if (entry->first != "BeaconList" && entry->first != "VerifiedBeacons")
         {
-            _log(logattribute::INFO, "GetScraperStatsFromSingleManifest", "Processing stats for project: " + project);
+            project_parts.emplace_back(entry->first, entry->second);
+        }
+    }
+
+    // Load the projects concurrently and merge them into the overall map once
+    // all of them finish.
+    std::vector<ScraperStats> ProjectScraperStats(project_parts.size());
+
+    ForEachProjectConcurrently(project_parts.size(), [&](size_t index)
+    {
+        const std::string& project = project_parts[index].first;
 
-            LoadProjectObjectToStatsByCPID(project, entry->second->data, dMagnitudePerProject, mProjectScraperStats);
+        _log(logattribute::INFO, "GetScraperStatsFromSingleManifest", "Processing stats for project: " + project);
 
-            // Insert into overall map.
-            stats_and_verified_beacons.mScraperStats.insert(mProjectScraperStats.begin(), mProjectScraperStats.end());
-       }
+        LoadProjectObjectToStatsByCPID(project, project_parts[index].second->data, dMagnitudePerProject, ProjectScraperStats[index]);
+    });
+
+    // Insert into overall map.
+    for (auto& mProjectScraperStats : ProjectScraperStats)
+    {
+        stats_and_verified_beacons.mScraperStats.Merge(std::move(mProjectScraperStats));
     }
 
     ProcessNetworkWideFromProjectStats(stats_and_verified_beacons.mScraperStats);
@@ -3665,6 +4119,188 @@ bool ScraperSaveCScraperManifestToFiles(uint256 nManifestHash)
     return true;
 }
 
+// The manifest cache holds one file per complete, current manifest in mapManifest, named by the manifest hash.
+// Each file contains the manifest as received from the network followed by its parts, so that a restarted node
+// can rebuild mapManifest and mapParts without waiting for peers to send them again.
+// Takes a lock on cs_mapManifest and cs_mapParts.
+bool StoreCScraperManifestCache()
+{
+    fs::path cache_dir = pathScraper / "manifests";
+
+    try
+    {
+        if (fs::exists(cache_dir) && !fs::is_directory(cache_dir)) fs::remove(cache_dir);
+        if (!fs::exists(cache_dir)) fs::create_directories(cache_dir);
+    }
+    catch (const fs::filesystem_error& e)
+    {
+        _log(logattribute::ERR, "StoreCScraperManifestCache", "Failed to create manifest cache directory: " + std::string(e.what()));
+        return false;
+    }
+
+    std::set<std::string> vExistingFiles;
+
+    for (fs::directory_entry& dir : fs::directory_iterator(cache_dir))
+    {
+        if (fs::is_regular_file(dir)) vExistingFiles.insert(dir.path().filename().string());
+    }
+
+    std::set<std::string> vCurrentFiles;
+    std::vector<std::pair<std::string, CDataStream>> vNewFiles;
+
+    {
+        LOCK2(CScraperManifest::cs_mapManifest, CSplitBlob::cs_mapParts);
+        _log(logattribute::INFO, "LOCK2", "CScraperManifest::cs_mapManifest, CSplitBlob::cs_mapParts");
+
+        for (const auto& iter : CScraperManifest::mapManifest)
+        {
+            const CScraperManifest& manifest = *iter.second;
+
+            if (!manifest.isComplete() || !manifest.IsManifestCurrent()) continue;
+
+            std::string filename = iter.first.GetHex() + ".dat";
+            vCurrentFiles.insert(filename);
+
+            // Manifests never change under the same hash, so a file written earlier is still valid.
+            if (vExistingFiles.count(filename)) continue;
+
+            CDataStream ssManifest(SER_NETWORK, PROTOCOL_VERSION);
+            manifest.Serialize(ssManifest);
+
+            CDataStream ss(SER_DISK, CLIENT_VERSION);
+            WriteCompactSize(ss, ssManifest.size());
+            ss.write(ssManifest.data(), ssManifest.size());
+
+            WriteCompactSize(ss, manifest.vParts.size());
+            for (const CSplitBlob::CPart* part : manifest.vParts)
+            {
+                WriteCompactSize(ss, part->data.size());
+                ss << part->getSpan();
+            }
+
+            vNewFiles.emplace_back(std::move(filename), std::move(ss));
+        }
+
+        _log(logattribute::INFO, "ENDLOCK2", "CScraperManifest::cs_mapManifest, CSplitBlob::cs_mapParts");
+    }
+
+    // Write the new files without holding the locks. Write to a temporary file first so that an interrupted
+    // write never leaves a truncated cache file behind.
+    bool fResult = true;
+
+    for (const auto& entry : vNewFiles)
+    {
+        fs::path file = cache_dir / entry.first;
+        fs::path file_temp = cache_dir / (entry.first + ".tmp");
+
+        CAutoFile cache_file(fsbridge::fopen(file_temp, "wb"), SER_DISK, CLIENT_VERSION);
+
+        if (cache_file.IsNull())
+        {
+            _log(logattribute::ERR, "StoreCScraperManifestCache", "Failed to open file (" + file_temp.string() + ")");
+            fResult = false;
+            continue;
+        }
+
+        try
+        {
+            cache_file.write(entry.second.data(), entry.second.size());
+            cache_file.fclose();
+
+            fs::rename(file_temp, file);
+        }
+        catch (const std::exception& e)
+        {
+            _log(logattribute::ERR, "StoreCScraperManifestCache", "Failed to store manifest to " + file.string() + ": " + e.what());
+            fResult = false;
+        }
+    }
+
+    // Remove the files of manifests that were deleted or are no longer current, and any leftover temporary files.
+    unsigned int nRemoved = 0;
+
+    for (const auto& filename : vExistingFiles)
+    {
+        if (vCurrentFiles.count(filename)) continue;
+
+        fs::remove(cache_dir / filename);
+        ++nRemoved;
+    }
+
+    _log(logattribute::INFO, "StoreCScraperManifestCache", "Stored " + std::to_string(vNewFiles.size())
+         + " and removed " + std::to_string(nRemoved) + " cached manifest(s).");
+
+    return fResult;
+}
+
+// Reload the manifests and parts stored by StoreCScraperManifestCache(). The manifests go through the same checks as
+// manifests received from peers, so files past SCRAPER_CMANIFEST_RETENTION_TIME or with a bad signature are discarded.
+// While the wallet is out of sync the manifests are loaded with bCheckedAuthorized false, and the housekeeping removes
+// the unauthorized ones once it is in sync, as it does for manifests received during the sync.
+// Takes a lock on cs_mapManifest and cs_mapParts.
+unsigned int LoadCScraperManifestCache()
+{
+    fs::path cache_dir = pathScraper / "manifests";
+
+    if (!fs::is_directory(cache_dir)) return 0;
+
+    unsigned int nLoaded = 0;
+    std::vector<fs::path> vFiles;
+
+    for (fs::directory_entry& dir : fs::directory_iterator(cache_dir))
+    {
+        if (fs::is_regular_file(dir)) vFiles.push_back(dir.path());
+    }
+
+    for (const auto& file : vFiles)
+    {
+        if (file.extension() != ".dat")
+        {
+            fs::remove(file);
+            continue;
+        }
+
+        std::vector<unsigned char> vManifest;
+        std::vector<std::vector<unsigned char>> vParts;
+
+        {
+            CAutoFile cache_file(fsbridge::fopen(file, "rb"), SER_DISK, CLIENT_VERSION);
+
+            try
+            {
+                cache_file >> vManifest >> vParts;
+            }
+            catch (const std::ios_base::failure& e)
+            {
+                _log(logattribute::WARNING, "LoadCScraperManifestCache", "Failed to load cached manifest " + file.string());
+                vManifest.clear();
+            }
+        }
+
+        CDataStream ssManifest(vManifest, SER_NETWORK, PROTOCOL_VERSION);
+
+        if (vManifest.empty() || !CScraperManifest::RecvManifest(nullptr, ssManifest))
+        {
+            fs::remove(file);
+            continue;
+        }
+
+        for (const auto& part : vParts)
+        {
+            if (part.empty()) continue;
+
+            CDataStream ssPart(part, SER_NETWORK, PROTOCOL_VERSION);
+            CSplitBlob::RecvPart(nullptr, ssPart);
+        }
+
+        ++nLoaded;
+    }
+
+    _log(logattribute::INFO, "LoadCScraperManifestCache", "Loaded " + std::to_string(nLoaded) + " cached manifest(s).");
+
+    return nLoaded;
+}
+
 // The idea here is that there are two levels of authorization. The first level is whether any
 // node can operate as a "scraper", in other words, download the stats files themselves.
 // The second level, which is the IsScraperAuthorizedToBroadcastManifests() function,
@@ -3844,14 +4480,6 @@ bool IsScraperAuthorizedToBroadcastManifests(CBitcoinAddress& AddressOut, CKey&
 // a scraper that is abusing the network by sending too many manifests over a very short period of time.
 bool IsScraperMaximumManifestPublishingRateExceeded(int64_t& nTime, CPubKey& PubKey)
 {
-    mmCSManifestsBinnedByScraper mMapCSManifestBinnedByScraper;
-
-    {
-        LOCK(CScraperManifest::cs_mapManifest);
-
-        mMapCSManifestBinnedByScraper = BinCScraperManifestsByScraper();
-    }
-
     CKeyID ManifestKeyID = PubKey.GetID();
 
     CBitcoinAddress ManifestAddress;
@@ -3860,9 +4488,27 @@ bool IsScraperMaximumManifestPublishingRateExceeded(int64_t& nTime, CPubKey& Pub
     // This is the address corresponding to the manifest public key, and is the scraper ID key in the outer map.
     std::string sManifestAddress = ManifestAddress.ToString();
 
-    const auto& iScraper = mMapCSManifestBinnedByScraper.find(sManifestAddress);
+    std::multimap<int64_t, ScraperID, std::greater <int64_t>> mScraperManifests;
+
+    {
+        LOCK(CScraperManifest::cs_mapManifest);
+
+        const auto iScraper = CScraperManifest::mapManifestByScraper.find(sManifestAddress);
+
+        if (iScraper != CScraperManifest::mapManifestByScraper.end())
+        {
+            // Only the manifests with all of their parts count, as in BinCScraperManifestsByScraper().
+            for (const auto& iManifest : iScraper->second)
+            {
+                if (iManifest.second->isComplete())
+                {
+                    mScraperManifests.insert(std::make_pair(iManifest.first.first, sManifestAddress));
+                }
+            }
+        }
+    }
 
-    if (iScraper == mMapCSManifestBinnedByScraper.end())
+    if (mScraperManifests.empty())
     {
         // There are no previous manifests on this node corresponding to the supplied public key.
         return false;
@@ -3875,18 +4521,10 @@ bool IsScraperMaximumManifestPublishingRateExceeded(int64_t& nTime, CPubKey& Pub
     int64_t nTotalTime = 0;
     int64_t nAvgTimeBetweenManifests = 0;
 
-    std::multimap<int64_t, ScraperID, std::greater <int64_t>> mScraperManifests;
-
-    // Insert manifest referenced by the argument first (the "incoming" manifest). Note that it may NOT have the most recent time.
-    // This is followed by the rest so that we have a unified map with the incoming in the right order.
+    // Add the manifest referenced by the argument (the "incoming" manifest) to the rest of the manifests for the scraper
+    // matching the public key. Note that it may NOT have the most recent time.
     mScraperManifests.insert(std::make_pair(nTime, sManifestAddress));
 
-    // Insert the rest of the manifests for the scraper matching the public key.
-    for (const auto& iManifest : iScraper->second)
-    {
-        mScraperManifests.insert(std::make_pair(iManifest.first, sManifestAddress));
-    }
-
     // Remember the map is sorted in descending order of time, so the end comes before the beginning.
     for (const auto& iManifest : mScraperManifests)
     {
@@ -4192,14 +4830,97 @@ bool ScraperSendFileManifestContents(CBitcoinAddress& Address, CKey& Key)
 
 
 // ------------------------------------ This an out parameter.
+namespace {
+//!
+//! \brief The result of the last convergence attempt and a digest of the
+//! inputs that produced it.
+//!
+struct ConvergenceCache
+{
+    bool valid = false;                 //!< Whether the cache holds a result.
+    uint256 input_digest;               //!< Digest of the convergence inputs.
+    bool converged = false;             //!< Whether the attempt converged.
+    ConvergedManifest converged_manifest; //!< The converged manifest, if any.
+};
+
+CCriticalSection cs_ConvergenceCache;
+ConvergenceCache g_convergence_cache;
+
+//!
+//! \brief Compute a digest of everything that a convergence attempt reads.
+//!
+//! This covers the manifests and the number of parts received for each, the
+//! project whitelist, and the scraper entries in the appcache. If none of
+//! these changed, the convergence would come out the same.
+//!
+//! \param projectWhitelist The current project whitelist.
+//!
+uint256 GetConvergenceInputDigest(const WhitelistSnapshot& projectWhitelist)
+{
+    CDataStream ss(SER_NETWORK, 1);
+
+    {
+        LOCK2(CScraperManifest::cs_mapManifest, CSplitBlob::cs_mapParts);
+
+        for (const auto& entry : CScraperManifest::mapManifest)
+        {
+            ss << entry.first << static_cast<uint64_t>(entry.second->cntPartsRcvd);
+        }
+    }
+
+    for (const auto& project : projectWhitelist)
+    {
+        ss << project.m_name;
+    }
+
+    for (const auto& entry : ReadSortedCacheSection(Section::SCRAPER))
+    {
+        ss << entry.first << entry.second.value;
+    }
+
+    return Hash(ss.begin(), ss.end());
+}
+} // anonymous namespace
+
 bool ScraperConstructConvergedManifest(ConvergedManifest& StructConvergedManifest)
 {
+    PERF_SCOPE("Scraper.ConstructConvergedManifest");
+
     bool bConvergenceSuccessful = false;
 
     // Call ScraperDeleteCScraperManifests() to ensure we have culled old manifests. This will
     // return a map of manifests binned by Scraper after the culling.
     mmCSManifestsBinnedByScraper mMapCSManifestsBinnedByScraper = ScraperCullAndBinCScraperManifests();
 
+    // Get a read-only view of the current project whitelist to fill out the
+    // excluded projects vector later on:
+    const WhitelistSnapshot projectWhitelist = GetWhitelist().Snapshot();
+
+    // Reuse the last convergence if none of its inputs changed since then.
+    // Binning and evaluating the manifests (and especially the by-project
+    // fallback) is expensive, and staking nodes call this repeatedly:
+    const uint256 input_digest = GetConvergenceInputDigest(projectWhitelist);
+
+    {
+        LOCK(cs_ConvergenceCache);
+
+        if (g_convergence_cache.valid && g_convergence_cache.input_digest == input_digest)
+        {
+            _log(logattribute::INFO, "ScraperConstructConvergedManifest", "Manifests unchanged. Using cached convergence result.");
+
+            StructConvergedManifest = g_convergence_cache.converged_manifest;
+            bConvergenceSuccessful = g_convergence_cache.converged;
+
+            // Signal UI of the status of convergence attempt.
+            if (bConvergenceSuccessful)
+                uiInterface.NotifyScraperEvent(scrapereventtypes::Convergence, CT_NEW, {});
+            else
+                uiInterface.NotifyScraperEvent(scrapereventtypes::Convergence, CT_DELETED, {});
+
+            return bConvergenceSuccessful;
+        }
+    }
+
     // Do a map for unique manifest times ordered by descending time then content hash.
     std::multimap<int64_t, uint256, std::greater<int64_t>> mManifestsBinnedByTime;
     // and also by content hash, then scraperID and manifest (not content) hash.
@@ -4320,10 +5041,6 @@ bool ScraperConstructConvergedManifest(ConvergedManifest& StructConvergedManifes
         }
     }
 
-    // Get a read-only view of the current project whitelist to fill out the
-    // excluded projects vector later on:
-    const WhitelistSnapshot projectWhitelist = GetWhitelist().Snapshot();
-
     if (bConvergenceSuccessful)
     {
         LOCK(CScraperManifest::cs_mapManifest);
@@ -4394,6 +5111,15 @@ bool ScraperConstructConvergedManifest(ConvergedManifest& StructConvergedManifes
             StructConvergedManifest = {};
     }
 
+    {
+        LOCK(cs_ConvergenceCache);
+
+        g_convergence_cache.valid = true;
+        g_convergence_cache.input_digest = input_digest;
+        g_convergence_cache.converged = bConvergenceSuccessful;
+        g_convergence_cache.converged_manifest = StructConvergedManifest;
+    }
+
     // Signal UI of the status of convergence attempt.
     if (bConvergenceSuccessful)
         uiInterface.NotifyScraperEvent(scrapereventtypes::Convergence, CT_NEW, {});
@@ -4759,35 +5485,24 @@ mmCSManifestsBinnedByScraper BinCScraperManifestsByScraper()
 {
     mmCSManifestsBinnedByScraper mMapCSManifestsBinnedByScraper;
 
-    // Make use of the ordered element feature of above map to bin by scraper and then order by manifest time.
-    for (auto iter = CScraperManifest::mapManifest.begin(); iter != CScraperManifest::mapManifest.end(); ++iter)
+    // The index already bins by scraper and orders by manifest time, latest first, and then by hash, so equal times
+    // keep the order of mapManifest in the inner multimap.
+    for (const auto& iScraper : CScraperManifest::mapManifestByScraper)
     {
-        CScraperManifest_shared_ptr manifest = iter->second;
-
-        // Do not consider manifests that do not have all of their parts.
-        if (!manifest->isComplete()) continue;
-
-        std::string sManifestName = manifest->sCManifestName;
-        int64_t nTime = manifest->nTime;
-        uint256 nHash = *manifest->phash;
-        uint256 nContentHash = manifest->nContentHash;
-
         mCSManifest mManifestInner;
 
-        auto BinIter = mMapCSManifestsBinnedByScraper.find(sManifestName);
-
-        // No scraper bin yet - so new insert.
-        if (BinIter == mMapCSManifestsBinnedByScraper.end())
-        {
-            mManifestInner.insert(std::make_pair(nTime, std::make_pair(nHash, nContentHash)));
-            mMapCSManifestsBinnedByScraper.insert(std::make_pair(sManifestName, mManifestInner));
-        }
-        else
+        for (const auto& iManifest : iScraper.second)
         {
-            mManifestInner = BinIter->second;
-            mManifestInner.insert(std::make_pair(nTime, std::make_pair(nHash, nContentHash)));
-            std::swap(mManifestInner, BinIter->second);
+            const CScraperManifest& manifest = *iManifest.second;
+
+            // Do not consider manifests that do not have all of their parts.
+            if (!manifest.isComplete()) continue;
+
+            mManifestInner.insert(mManifestInner.end(),
+                                  std::make_pair(manifest.nTime, std::make_pair(*manifest.phash, manifest.nContentHash)));
         }
+
+        if (!mManifestInner.empty()) mMapCSManifestsBinnedByScraper.emplace(iScraper.first, std::move(mManifestInner));
     }
 
     return mMapCSManifestsBinnedByScraper;
@@ -4841,19 +5556,19 @@ mmCSManifestsBinnedByScraper ScraperCullAndBinCScraperManifests()
         }
     }
 
-    // If any CScraperManifest has exceeded SCRAPER_CMANIFEST_RETENTION_TIME, then delete.
-    for (auto iter = CScraperManifest::mapManifest.begin(); iter != CScraperManifest::mapManifest.end(); )
+    // If any CScraperManifest has exceeded SCRAPER_CMANIFEST_RETENTION_TIME, then delete. The time index holds the oldest first.
+    while (!CScraperManifest::mapManifestByTime.empty()
+           && GetAdjustedTime() - CScraperManifest::mapManifestByTime.begin()->first > SCRAPER_CMANIFEST_RETENTION_TIME)
     {
-        CScraperManifest_shared_ptr manifest = iter->second;
+        // Copy the hash. DeleteManifest() erases the map entry that the hash pointer refers to.
+        const uint256 nHash = *CScraperManifest::mapManifestByTime.begin()->second->phash;
 
-        if (GetAdjustedTime() - manifest->nTime > SCRAPER_CMANIFEST_RETENTION_TIME)
+        _log(logattribute::INFO, "ScraperDeleteCScraperManifests", "Deleting old CScraperManifest with hash " + nHash.GetHex());
+        // Delete from CScraperManifest map. Drop a stale index entry so that the loop always advances.
+        if (!CScraperManifest::DeleteManifest(nHash))
         {
-            _log(logattribute::INFO, "ScraperDeleteCScraperManifests", "Deleting old CScraperManifest with hash " + iter->first.GetHex());
-            // Delete from CScraperManifest map
-            iter = CScraperManifest::DeleteManifest(iter);
+            CScraperManifest::mapManifestByTime.erase(CScraperManifest::mapManifestByTime.begin());
         }
-        else
-            ++iter;
     }
 
     // Also delete old entries that have exceeded retention time from the ConvergedScraperStatsCache. This follows
@@ -4863,6 +5578,7 @@ mmCSManifestsBinnedByScraper ScraperCullAndBinCScraperManifests()
         _log(logattribute::INFO, "LOCK", "cs_ConvergedScraperStatsCache");
 
         ConvergedScraperStatsCache.DeleteOldConvergenceFromPastConvergencesMap();
+        ConvergedScraperStatsCache.TrimPastConvergencesMap(nScraperPastConvergencesMaxBytes);
 
         _log(logattribute::INFO, "ENDLOCK", "cs_ConvergedScraperStatsCache");
     }
@@ -4949,7 +5665,7 @@ std::vector<uint160> GetVerifiedBeaconIDs(const ConvergedManifest& StructConverg
     const auto& iter = StructConvergedManifest.ConvergedManifestPartPtrsMap.find("VerifiedBeacons");
     if (iter != StructConvergedManifest.ConvergedManifestPartPtrsMap.end())
     {
-        CDataStream part(iter->second->data, SER_NETWORK, 1);
+        SpanReader part = iter->second->getReader();
 
         try
         {
@@ -4997,7 +5713,7 @@ ScraperStatsAndVerifiedBeacons GetScraperStatsAndVerifiedBeacons(const Converged
     const auto& iter = stats.Convergence.ConvergedManifestPartPtrsMap.find("VerifiedBeacons");
     if (iter != stats.Convergence.ConvergedManifestPartPtrsMap.end())
     {
-        CDataStream part(iter->second->data, SER_NETWORK, 1);
+        SpanReader part = iter->second->getReader();
 
         try
         {
@@ -5099,6 +5815,32 @@ Superblock ScraperGetSuperblockContract(bool bStoreConvergedStats, bool bContrac
             // to make sure the BeaconMap has been populated properly.
             if (ScraperConstructConvergedManifest(StructConvergedManifest) && LoadBeaconListFromConvergedManifest(StructConvergedManifest, mBeaconMap))
             {
+                const uint32_t superblock_version = IsV11Enabled(nBestHeight + 1) ? Superblock::CURRENT_VERSION : 1;
+
+                // A new manifest marks the cache dirty even when the convergence does not change. Keep the cached
+                // superblock in that case instead of computing the stats and the superblock again.
+                {
+                    LOCK(cs_ConvergedScraperStatsCache);
+                    _log(logattribute::INFO, "LOCK", "cs_ConvergedScraperStatsCache");
+
+                    if (ConvergedScraperStatsCache.IsSuperblockCurrentFor(StructConvergedManifest, superblock_version))
+                    {
+                        // Refer to the newest manifests so that the convergence outlives the ones that expire.
+                        ConvergedScraperStatsCache.Convergence = StructConvergedManifest;
+                        ConvergedScraperStatsCache.nTime = GetAdjustedTime();
+                        ConvergedScraperStatsCache.bClean = true;
+
+                        superblock = ConvergedScraperStatsCache.NewFormatSuperblock;
+
+                        _log(logattribute::INFO, "ScraperGetSuperblockContract", "Convergence unchanged. Superblock object from cache");
+                        _log(logattribute::INFO, "ENDLOCK", "cs_ConvergedScraperStatsCache");
+
+                        return superblock;
+                    }
+
+                    _log(logattribute::INFO, "ENDLOCK", "cs_ConvergedScraperStatsCache");
+                }
+
                 ScraperStats mScraperConvergedStats = GetScraperStatsByConvergedManifest(StructConvergedManifest).mScraperStats;
 
                 _log(logattribute::INFO, "ScraperGetSuperblockContract", "mScraperStats has the following number of elements: " + std::to_string(mScraperConvergedStats.size()));
@@ -5119,6 +5861,7 @@ Superblock ScraperGetSuperblockContract(bool bStoreConvergedStats, bool bContrac
                     _log(logattribute::INFO, "LOCK", "cs_ConvergedScraperStatsCache");
 
                     ConvergedScraperStatsCache.AddConvergenceToPastConvergencesMap();
+                    ConvergedScraperStatsCache.TrimPastConvergencesMap(nScraperPastConvergencesMaxBytes);
 
                     Superblock superblock_Prev = ConvergedScraperStatsCache.NewFormatSuperblock;
 
@@ -5126,11 +5869,7 @@ Superblock ScraperGetSuperblockContract(bool bStoreConvergedStats, bool bContrac
                     ConvergedScraperStatsCache.nTime = GetAdjustedTime();
                     ConvergedScraperStatsCache.Convergence = StructConvergedManifest;
 
-                    if (IsV11Enabled(nBestHeight + 1)) {
-                        superblock = Superblock::FromConvergence(ConvergedScraperStatsCache);
-                    } else {
-                        superblock = Superblock::FromConvergence(ConvergedScraperStatsCache, 1);
-                    }
+                    superblock = Superblock::FromConvergence(ConvergedScraperStatsCache, superblock_version);
 
                     ConvergedScraperStatsCache.NewFormatSuperblock = superblock;
 
@@ -5828,6 +6567,12 @@ UniValue scraperreport(const UniValue& params, bool fHelp)
             converged_scraper_stats_cache.pushKV("past_convergence_map_size",
                                                  past_convergence_map_size);
 
+            converged_scraper_stats_cache.pushKV("past_convergence_memory_usage",
+                                                 ConvergedScraperStatsCache.GetPastConvergencesMemoryUsage());
+
+            converged_scraper_stats_cache.pushKV("past_convergence_memory_budget",
+                                                 nScraperPastConvergencesMaxBytes);
+
             converged_scraper_stats_cache.pushKV("total_convergences_part_pointer_maps_size",
                                                  total_convergences_part_pointer_maps_size);
 
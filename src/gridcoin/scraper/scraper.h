@@ -55,6 +55,18 @@ unsigned int nActiveBeforeSB = 14400;
 
 // Explorer mode flag. Only effective if scraper is active.
 bool fExplorer = false;
+// The maximum number of project stats transfers that run at the same time.
+unsigned int nScraperParallelDownloads = 4;
+// The maximum number of concurrent connections to a single project server.
+const unsigned int SCRAPER_MAX_HOST_DOWNLOADS = 2;
+// The number of threads that process project stats files concurrently.
+unsigned int nScraperProcessingThreads = 4;
+// The memory budget for the past convergences kept to validate superblocks.
+uint64_t nScraperPastConvergencesMaxBytes = 256 * 1024 * 1024;
+// Event-driven mode flag. The scraper threads wake on new manifests and on
+// whitelist, beacon and scraper changes, and otherwise idle until the run up
+// to the next superblock.
+bool fScraperEventDriven = false;
 
 // These can be overridden by ScraperApplyAppCacheEntries().
 
@@ -110,7 +122,10 @@ CCriticalSection cs_mScrapersExt;
 *********************/
 
 uint256 GetFileHash(const fs::path& inputfile);
-ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const ConvergedManifest& StructConvergedManifest);
+ScraperStatsAndVerifiedBeacons GetScraperStatsByConvergedManifest(const ConvergedManifest& StructConvergedManifest,
+                                                                  const ScraperProjectStatsCache* project_stats_cache = nullptr);
+void LoadProjectPartsToStatsCache(const std::vector<std::pair<std::string, const CSplitBlob::CPart*>>& project_parts,
+                                  unsigned int nActiveProjects, ScraperProjectStatsCache& project_stats_cache);
 bool IsScraperAuthorized();
 bool IsScraperAuthorizedToBroadcastManifests(CBitcoinAddress& AddressOut, CKey& KeyOut);
 bool IsScraperMaximumManifestPublishingRateExceeded(int64_t& nTime, CPubKey& PubKey);
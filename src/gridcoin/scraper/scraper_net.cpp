@@ -22,6 +22,9 @@
 
 //Globals
 std::map<uint256, std::pair<int64_t, std::shared_ptr<CScraperManifest>>> CScraperManifest::mapPendingDeletedManifest;
+std::map<std::string, CScraperManifest::ScraperManifestIndex> CScraperManifest::mapManifestByScraper;
+std::multimap<int64_t, CScraperManifest*> CScraperManifest::mapManifestByTime;
+std::multimap<uint64_t, std::pair<CScraperManifest*, unsigned int>> CScraperManifest::mapProjectPartsByHash;
 extern unsigned int SCRAPER_MISBEHAVING_NODE_BANSCORE;
 extern int64_t SCRAPER_DEAUTHORIZED_BANSCORE_GRACE_PERIOD;
 extern int64_t SCRAPER_CMANIFEST_RETENTION_TIME;
@@ -34,7 +37,14 @@ extern CCriticalSection cs_mScrapersExt;
 extern CCriticalSection cs_ConvergedScraperStatsCache;
 extern bool IsScraperMaximumManifestPublishingRateExceeded(int64_t& nTime, CPubKey& PubKey);
 
-// A lock needs to be taken on cs_mapParts before calling this function.
+namespace {
+//!
+//! \brief Serialized part messages recently sent to peers.
+//!
+CSharedMessageCache g_part_messages(16 * 1024 * 1024);
+} // anonymous namespace
+
+// Takes a lock on cs_mapParts.
 bool CSplitBlob::RecvPart(CNode* pfrom, CDataStream& vRecv)
 {
   /* Part of larger hashed blob. Currently only used for scraper data sharing.
@@ -43,8 +53,16 @@ bool CSplitBlob::RecvPart(CNode* pfrom, CDataStream& vRecv)
    * erase from mapAlreadyAskedFor
    */
     auto& ss = vRecv;
+
+    // Hash the part before taking cs_mapParts so that the message workers
+    // hash parts from several nodes at once:
     uint256 hash(Hash(ss.begin(), ss.end()));
-    mapAlreadyAskedFor.erase(CInv(MSG_PART, hash));
+    {
+        LOCK(cs_mapAlreadyAskedFor);
+        mapAlreadyAskedFor.erase(CInv(MSG_PART, hash));
+    }
+
+    LOCK(cs_mapParts);
 
     auto ipart = mapParts.find(hash);
 
@@ -57,7 +75,16 @@ bool CSplitBlob::RecvPart(CNode* pfrom, CDataStream& vRecv)
         {
             LogPrint(BCLog::LogFlags::MANIFEST, "received part %s %u refs", hash.GetHex(), (unsigned) part.refs.size());
 
-            part.data = CSerializeData(vRecv.begin(),vRecv.end()); //TODO: replace with move constructor
+            // Take the buffer of the message unless it holds much more room
+            // than the part needs, like a large pooled receive buffer:
+            vRecv.Compact();
+
+            if (vRecv.capacity() <= vRecv.size() + vRecv.size() / 4) {
+                vRecv.SwapBuffer(part.data);
+            } else {
+                part.data.assign(vRecv.begin(), vRecv.end());
+            }
+
             for (const auto& ref : part.refs)
             {
                 CSplitBlob& split = *ref.first;
@@ -172,7 +199,16 @@ bool CSplitBlob::SendPartTo(CNode* pto, const uint256& hash)
     {
         if (ipart->second.present())
         {
-            pto->PushMessage("part",ipart->second.getReader());
+            // Build the message once for all of the peers that fetch the
+            // part. Its payload is the raw part data:
+            CSharedMessage message = g_part_messages.Get(hash);
+
+            if (!message) {
+                message = MakeSharedMessage(PROTOCOL_VERSION, "part", ipart->second.getSpan());
+                g_part_messages.Put(hash, message);
+            }
+
+            pto->PushSharedMessage(std::move(message));
             return true;
         }
     }
@@ -334,54 +370,60 @@ bool CScraperManifest::IsManifestAuthorized(int64_t& nTime, CPubKey& PubKey, uns
     // So we are going to make use of AppCacheEntryExt and mScrapersExt, which are just like the normal AppCache structure, except they
     // have an explicit deleted boolean.
 
-    // First, walk the mScrapersExt map and see if it contains an entry that does not exist in mScrapers. If so,
-    // update the entry's value and timestamp and mark deleted.
-    LOCK(cs_mScrapersExt);
+    bool bAuthorized = false;
+    int64_t nLastFalseEntryTime = 0;
+    int64_t nGracePeriodEnd = 0;
 
-    for (auto const& entry : mScrapersExt)
+    // The publishing rate check below takes cs_mapManifest. Release
+    // cs_mScrapersExt first to keep the lock order of the callers that hold
+    // cs_mapManifest while they check authorization:
     {
-        const auto& iter = mScrapers.find(entry.first);
+        LOCK(cs_mScrapersExt);
 
-        if (iter == mScrapers.end())
+        // First, walk the mScrapersExt map and see if it contains an entry that does not exist in mScrapers. If so,
+        // update the entry's value and timestamp and mark deleted.
+        for (auto const& entry : mScrapersExt)
         {
-            // Mark entry in mScrapersExt as deleted at the current adjusted time. The value is changed
-            // to false, because if it is deleted, it is also not authorized.
-            mScrapersExt[entry.first] = AppCacheEntryExt {"false", GetAdjustedTime(), true};
-        }
+            const auto& iter = mScrapers.find(entry.first);
 
-    }
+            if (iter == mScrapers.end())
+            {
+                // Mark entry in mScrapersExt as deleted at the current adjusted time. The value is changed
+                // to false, because if it is deleted, it is also not authorized.
+                mScrapersExt[entry.first] = AppCacheEntryExt {"false", GetAdjustedTime(), true};
+            }
 
-    // Now insert/update entries from mScrapers into mScrapersExt.
-    for (auto const& entry : mScrapers)
-    {
-        mScrapersExt[entry.first] = AppCacheEntryExt {entry.second.value, entry.second.timestamp, false};
-    }
+        }
 
-    // Now mScrapersExt is up to date. Walk and see if there is an entry with a value of true that matches
-    // manifest address. If so the manifest is authorized. Note that no grace period has to be considered
-    // for the authorized case. To prevent islanding in the unauthorized case, we must allow a grace period
-    // before we return a banscore > 0. The grace period must extend SCRAPER_DEAUTHORIZED_BANSCORE_GRACE_PERIOD
-    // from the timestamp of the last updated entry in mScraperExt or the time the wallet went in sync, whichever is later.
-    bool bAuthorized = false;
-    int64_t nLastFalseEntryTime = 0;
-    int64_t nGracePeriodEnd = 0;
+        // Now insert/update entries from mScrapers into mScrapersExt.
+        for (auto const& entry : mScrapers)
+        {
+            mScrapersExt[entry.first] = AppCacheEntryExt {entry.second.value, entry.second.timestamp, false};
+        }
 
-    for (auto const& entry : mScrapersExt)
-    {
-        if (entry.second.value == "true" || entry.second.value == "1")
+        // Now mScrapersExt is up to date. Walk and see if there is an entry with a value of true that matches
+        // manifest address. If so the manifest is authorized. Note that no grace period has to be considered
+        // for the authorized case. To prevent islanding in the unauthorized case, we must allow a grace period
+        // before we return a banscore > 0. The grace period must extend SCRAPER_DEAUTHORIZED_BANSCORE_GRACE_PERIOD
+        // from the timestamp of the last updated entry in mScraperExt or the time the wallet went in sync, whichever is later.
+
+        for (auto const& entry : mScrapersExt)
         {
-            // If the entry key (address) matches the manifest address, then the scraper is authorized, so
-            // set banscore_out equal to 0 and bAuthorized = true and break.
-            if (sManifestAddress == entry.first)
+            if (entry.second.value == "true" || entry.second.value == "1")
             {
-                banscore_out = 0;
-                bAuthorized = true;
-                break;
+                // If the entry key (address) matches the manifest address, then the scraper is authorized, so
+                // set banscore_out equal to 0 and bAuthorized = true and break.
+                if (sManifestAddress == entry.first)
+                {
+                    banscore_out = 0;
+                    bAuthorized = true;
+                    break;
+                }
             }
+            else
+                // Track the latest timestamp of the false/deleted entries.
+                nLastFalseEntryTime = std::max(nLastFalseEntryTime, entry.second.timestamp);
         }
-        else
-            // Track the latest timestamp of the false/deleted entries.
-            nLastFalseEntryTime = std::max(nLastFalseEntryTime, entry.second.timestamp);
     }
 
     // Check for excessive manifest publishing rate by the associated scraper. If the maximum rate is exceeded
@@ -418,11 +460,10 @@ bool CScraperManifest::IsManifestAuthorized(int64_t& nTime, CPubKey& PubKey, uns
 }
 
 // A lock must be taken on cs_mapManifest before calling this function.
-void CScraperManifest::UnserializeCheck(CDataStream& ss, unsigned int& banscore_out)
+void CScraperManifest::UnserializeCheck(CDataStream& ss, unsigned int& banscore_out, std::vector<uint256>& vph)
 {
     const auto pbegin = ss.begin();
 
-    std::vector<uint256> vph;
     ss >> vph;
     ss >> pubkey;
     ss >> sCManifestName;
@@ -514,18 +555,8 @@ void CScraperManifest::UnserializeCheck(CDataStream& ss, unsigned int& banscore_
     ss >> signature;
     LogPrint(BCLog::LogFlags::MANIFEST, "CScraperManifest::UnserializeCheck: hash of signature = %s", Hash(signature.begin(), signature.end()).GetHex());
 
-    CKey mkey;
-    if (!mkey.SetPubKey(pubkey)) throw error("CScraperManifest: Invalid manifest key");
-    if (!mkey.Verify(hash, signature)) throw error("CScraperManifest: Invalid manifest signature");
-
-    {
-        LOCK(cs_mapParts);
-
-        for (const uint256& ph : vph)
-        {
-            addPart(ph);
-        }
-    }
+    if (!pubkey.IsValid()) throw error("CScraperManifest: Invalid manifest key");
+    if (!pubkey.Verify(hash, signature)) throw error("CScraperManifest: Invalid manifest signature");
 }
 
 bool CScraperManifest::IsManifestCurrent() const
@@ -544,6 +575,8 @@ bool CScraperManifest::DeleteManifest(const uint256& nHash, const bool& fImmedia
 
     if(iter != mapManifest.end())
     {
+        UnindexManifest(*iter->second);
+
         if (!fImmediate) mapPendingDeletedManifest[nHash] = std::make_pair(GetAdjustedTime(), std::move(iter->second));
 
         mapManifest.erase(nHash);
@@ -566,6 +599,8 @@ bool CScraperManifest::DeleteManifest(const uint256& nHash, const bool& fImmedia
 std::map<uint256, std::shared_ptr<CScraperManifest>>::iterator CScraperManifest::DeleteManifest(std::map<uint256, std::shared_ptr<CScraperManifest>>::iterator& iter,
                                                                                                 const bool& fImmediate)
 {
+    UnindexManifest(*iter->second);
+
     if (!fImmediate) mapPendingDeletedManifest[iter->first] = std::make_pair(GetAdjustedTime(), std::move(iter->second));
 
     iter = mapManifest.erase(iter);
@@ -605,6 +640,66 @@ unsigned int CScraperManifest::DeletePendingDeletedManifests()
     return nDeleted;
 }
 
+// A lock must be taken on cs_mapManifest before calling this function.
+void CScraperManifest::IndexManifest(CScraperManifest& manifest)
+{
+    mapManifestByScraper[manifest.sCManifestName].emplace(std::make_pair(manifest.nTime, *manifest.phash), &manifest);
+    mapManifestByTime.emplace(manifest.nTime, &manifest);
+
+    for (unsigned int i = 0; i < manifest.projects.size(); ++i)
+    {
+        const int part = manifest.projects[i].part1;
+
+        if (part >= 0 && part < (int)manifest.vParts.size())
+        {
+            mapProjectPartsByHash.emplace(manifest.vParts[part]->hash.GetUint64(), std::make_pair(&manifest, i));
+        }
+    }
+}
+
+// A lock must be taken on cs_mapManifest before calling this function.
+void CScraperManifest::UnindexManifest(const CScraperManifest& manifest)
+{
+    auto scraper = mapManifestByScraper.find(manifest.sCManifestName);
+
+    if (scraper != mapManifestByScraper.end())
+    {
+        scraper->second.erase(std::make_pair(manifest.nTime, *manifest.phash));
+
+        if (scraper->second.empty()) mapManifestByScraper.erase(scraper);
+    }
+
+    auto range = mapManifestByTime.equal_range(manifest.nTime);
+
+    for (auto iter = range.first; iter != range.second; ++iter)
+    {
+        if (iter->second == &manifest)
+        {
+            mapManifestByTime.erase(iter);
+            break;
+        }
+    }
+
+    for (const auto& entry : manifest.projects)
+    {
+        if (entry.part1 < 0 || entry.part1 >= (int)manifest.vParts.size()) continue;
+
+        auto parts = mapProjectPartsByHash.equal_range(manifest.vParts[entry.part1]->hash.GetUint64());
+
+        for (auto iter = parts.first; iter != parts.second;)
+        {
+            if (iter->second.first == &manifest)
+            {
+                iter = mapProjectPartsByHash.erase(iter);
+            }
+            else
+            {
+                ++iter;
+            }
+        }
+    }
+}
+
 // A lock must be taken on cs_mapManifest before calling this function.
 bool CScraperManifest::RecvManifest(CNode* pfrom, CDataStream& vRecv)
 {
@@ -622,22 +717,28 @@ bool CScraperManifest::RecvManifest(CNode* pfrom, CDataStream& vRecv)
     uint256 hash(Hash(vRecv.begin(), vRecv.end()));
 
     /* see if we do not already have it */
-    if (AlreadyHave(pfrom, CInv(MSG_SCRAPERINDEX, hash)))
     {
-        LogPrint(BCLog::LogFlags::SCRAPER, "INFO: ScraperManifest::RecvManifest: Already have CScraperManifest %s from node %s.", hash.GetHex(), pfrom->addrName);
-        return false;
+        LOCK(cs_mapManifest);
+
+        if (AlreadyHave(pfrom, CInv(MSG_SCRAPERINDEX, hash)))
+        {
+            LogPrint(BCLog::LogFlags::SCRAPER, "INFO: ScraperManifest::RecvManifest: Already have CScraperManifest %s from node %s.",
+                     hash.GetHex(), pfrom ? pfrom->addrName : "(local cache)");
+            return false;
+        }
     }
 
-    const auto it = mapManifest.emplace(hash, std::shared_ptr<CScraperManifest>(new CScraperManifest()));
-    CScraperManifest& manifest = *it.first->second;
-    manifest.phash = &it.first->first;
+    // Check the authorization and the signature without holding the manifest
+    // and part locks. The message workers check manifests from several nodes
+    // at once this way:
+    std::shared_ptr<CScraperManifest> manifest_ptr(new CScraperManifest());
+    std::vector<uint256> vph;
 
     try
     {
-        manifest.UnserializeCheck(vRecv, banscore);
+        manifest_ptr->UnserializeCheck(vRecv, banscore, vph);
     } catch (bool& e)
     {
-        mapManifest.erase(hash);
         LogPrint(BCLog::LogFlags::MANIFEST, "invalid manifest %s received", hash.GetHex());
 
         if (pfrom)
@@ -649,7 +750,6 @@ bool CScraperManifest::RecvManifest(CNode* pfrom, CDataStream& vRecv)
         return false;
     } catch(std::ios_base::failure& e)
     {
-        mapManifest.erase(hash);
         LogPrint(BCLog::LogFlags::MANIFEST, "invalid manifest %s received", hash.GetHex());
 
         if (pfrom)
@@ -661,6 +761,28 @@ bool CScraperManifest::RecvManifest(CNode* pfrom, CDataStream& vRecv)
         return false;
     }
 
+    LOCK2(cs_mapManifest, cs_mapParts);
+
+    const auto it = mapManifest.emplace(hash, std::move(manifest_ptr));
+
+    // Another node sent the same manifest while we checked it:
+    if (!it.second)
+    {
+        LogPrint(BCLog::LogFlags::MANIFEST, "received duplicate manifest %s", hash.GetHex());
+        return false;
+    }
+
+    CScraperManifest& manifest = *it.first->second;
+    manifest.phash = &it.first->first;
+
+    for (const uint256& ph : vph)
+    {
+        manifest.addPart(ph);
+    }
+
+    // The part index needs the part hashes:
+    IndexManifest(manifest);
+
     // lock cs_ConvergedScraperStatsCache and mark ConvergedScraperStatsCache dirty because a new manifest is present,
     // so the convergence may change.
     {
@@ -669,8 +791,6 @@ bool CScraperManifest::RecvManifest(CNode* pfrom, CDataStream& vRecv)
         ConvergedScraperStatsCache.bClean = false;
     }
 
-    LOCK(cs_mapParts);
-
     LogPrint(BCLog::LogFlags::MANIFEST, "received manifest %s with %u / %u parts", hash.GetHex(),(unsigned)manifest.cntPartsRcvd,(unsigned)manifest.vParts.size());
     if (manifest.isComplete())
     {
@@ -723,6 +843,7 @@ bool CScraperManifest::addManifest(std::shared_ptr<CScraperManifest>&& m, CKey&
     CScraperManifest& manifest = *it.first->second;
     /* set the hash pointer inside */
     manifest.phash= &it.first->first;
+    IndexManifest(manifest);
 
     // We do not need to do a deserialize check here, because the
     // manifest originates from THIS node, and the scraper's authorization
@@ -759,6 +880,8 @@ void CScraperManifest::Complete()
     }
 
     LogPrint(BCLog::LogFlags::SCRAPER, "INFO: CScraperManifest::Complete(): from %s with hash %s", sCManifestName, phash->GetHex());
+
+    WakeScraper(false);
 }
 
 /* how?
@@ -11,10 +11,13 @@
 
 #include <key.h>
 #include "net.h"
+#include "span.h"
 #include "streams.h"
 #include "sync.h"
+#include "util/hasher.h"
 
 #include <univalue.h>
+#include <unordered_map>
 
 
 /** Abstract class for blobs that are split into parts. */
@@ -30,11 +33,24 @@ public:
         CPart(const uint256& ihash)
             :hash(ihash)
         {}
-        CDataStream getReader() const { return CDataStream(data.begin(), data.end(), SER_NETWORK, PROTOCOL_VERSION); }
+        /** Get a stream that reads the part data in place. It stays valid
+         * while the part holds its data. */
+        SpanReader getReader() const { return SpanReader(SER_NETWORK, PROTOCOL_VERSION, data.data(), data.size()); }
+        /** Get the part data as raw bytes that serialize without a size. */
+        Span<const unsigned char> getSpan() const
+        {
+            return Span<const unsigned char>(reinterpret_cast<const unsigned char*>(data.data()), data.size());
+        }
         bool present() const {return !this->data.empty();}
     };
 
+    /** Parts arrive from peers, so mapParts hashes their hashes with a salt
+     * that the peers cannot know. */
+    typedef std::unordered_map<uint256, CPart, SaltedUint256Hasher> PartMap;
+
     /** Process a message containing Part of Blob.
+   * Takes the bytes of a new part out of vRecv instead of copying them.
+   * Takes cs_mapParts itself after hashing the part.
    * @return whether the data was useful
   */
     static bool RecvPart(CNode* pfrom, CDataStream& vRecv);
@@ -66,7 +82,7 @@ public:
 
     /* We could store the parts in mapRelay and have getdata service for free. */
     /** map from part hash to scraper Index, so we can attach incoming Part in Index */
-    static std::map<uint256,CPart> mapParts;
+    static PartMap mapParts;
     size_t cntPartsRcvd =0;
 
     static CCriticalSection cs_mapParts; // also protects vParts.
@@ -85,10 +101,41 @@ public: /* static methods */
     // ------------ hash -------------- nTime ------- pointer to CScraperManifest
     static std::map<uint256, std::pair<int64_t, std::shared_ptr<CScraperManifest>>> mapPendingDeletedManifest;
 
-    // Protects both mapManifest and MapPendingDeletedManifest
+    /** Orders the manifests of a scraper by time, latest first, and then
+     * by hash in the order of mapManifest.
+     */
+    struct LatestFirst
+    {
+        bool operator()(const std::pair<int64_t, uint256>& a, const std::pair<int64_t, uint256>& b) const
+        {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        }
+    };
+
+    typedef std::map<std::pair<int64_t, uint256>, CScraperManifest*, LatestFirst> ScraperManifestIndex;
+
+    /** Manifests in mapManifest by scraper name and then time, so that
+     * binning and the publishing rate check do not scan the whole map.
+     */
+    static std::map<std::string, ScraperManifestIndex> mapManifestByScraper;
+
+    /** Manifests in mapManifest by time, oldest first, so that culling finds
+     * the expired manifests without a scan.
+     */
+    static std::multimap<int64_t, CScraperManifest*> mapManifestByTime;
+
+    /** Project entries of the manifests in mapManifest by the first 64 bits
+     * of the hash of their part, so that superblock validation finds the parts
+     * that match a convergence hint without a scan. The pair holds the manifest
+     * and the offset of the entry in its projects.
+     */
+    static std::multimap<uint64_t, std::pair<CScraperManifest*, unsigned int>> mapProjectPartsByHash;
+
+    // Protects mapManifest, its indices and MapPendingDeletedManifest
     static CCriticalSection cs_mapManifest;
 
     /** Process a message containing Index of Scraper Data.
+   * Takes cs_mapManifest and cs_mapParts itself after the checks.
    * @returns whether the data was useful and valid
   */
     static bool RecvManifest(CNode* pfrom, CDataStream& vRecv);
@@ -125,6 +172,12 @@ public: /* static methods */
     /** Delete PendingDeletedManifests **/
     static unsigned int DeletePendingDeletedManifests();
 
+    /** Add a manifest in mapManifest to the indices. The hash pointer and the parts must be set. **/
+    static void IndexManifest(CScraperManifest& manifest);
+
+    /** Remove a manifest from the indices before it leaves mapManifest. **/
+    static void UnindexManifest(const CScraperManifest& manifest);
+
 
 public: /*==== fields ====*/
 
@@ -172,9 +225,20 @@ public: /* public methods */
     void Serialize(CDataStream& s) const;
     void SerializeWithoutSignature(CDataStream& s) const;
     void SerializeForManifestCompare(CDataStream& ss) const;
-    void UnserializeCheck(CDataStream& s, unsigned int& banscore_out);
+    /** Deserialize a received manifest and check its authorization and its
+     * signature. Takes neither cs_mapManifest nor cs_mapParts for the checks.
+     * @param vph Receives the hashes of the parts for addPart().
+     */
+    void UnserializeCheck(CDataStream& s, unsigned int& banscore_out, std::vector<uint256>& vph);
 
     bool IsManifestCurrent() const;
 
     UniValue ToJson() const;
 };
+
+/** Wake the scraper threads in event-driven mode. Takes only its own lock, so
+ * callers may hold any others.
+ * @param fChainEvent true for a chain or contract change, false for a received
+ * manifest.
+ */
+void WakeScraper(const bool fChainEvent);
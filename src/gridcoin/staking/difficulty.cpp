@@ -3,7 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
-#include "bignum.h"
+#include "arith_uint256.h"
 #include "init.h"
 #include "gridcoin/staking/difficulty.h"
 #include "gridcoin/staking/kernel.h"
@@ -18,7 +18,7 @@ using namespace GRC;
 
 namespace {
 constexpr int64_t TARGET_TIMESPAN = 16 * 60;  // 16 mins in seconds
-const CBigNum PROOF_OF_STAKE_LIMIT(ArithToUint256(~arith_uint256() >> 20));
+const arith_uint256 PROOF_OF_STAKE_LIMIT = ~arith_uint256() >> 20;
 
 // ppcoin: find last block index up to pindex
 const CBlockIndex* GetLastBlockIndex(const CBlockIndex* pindex, bool fProofOfStake)
@@ -27,12 +27,130 @@ const CBlockIndex* GetLastBlockIndex(const CBlockIndex* pindex, bool fProofOfSta
         pindex = pindex->pprev;
     return pindex;
 }
+
+DifficultyWindow g_difficulty_window;
 } // Anonymous namespace
 
+// -----------------------------------------------------------------------------
+// Class: DifficultyWindow
+// -----------------------------------------------------------------------------
+
+constexpr unsigned int DifficultyWindow::MAX_INTERVAL;
+
+void DifficultyWindow::SetTip(const CBlockIndex* const pindex)
+{
+    LOCK(cs_window);
+
+    if (pindex == nullptr) {
+        m_blocks.clear();
+        m_tip = nullptr;
+        m_exhausted = false;
+
+        return;
+    }
+
+    if (pindex == m_tip) {
+        return;
+    }
+
+    if (m_tip && pindex->pprev == m_tip) {
+        if (pindex->IsProofOfStake()) {
+            const double dDiff = GetBlockDifficulty(pindex->nBits);
+
+            // Skip a zero difficulty as GetAverageDifficulty() does:
+            if (dDiff) {
+                m_blocks.emplace_back(pindex, dDiff);
+            }
+        }
+
+        if (m_blocks.size() > MAX_INTERVAL) {
+            m_blocks.pop_front();
+            m_exhausted = false;
+        }
+
+        m_tip = pindex;
+
+        return;
+    }
+
+    if (m_tip && m_tip->pprev == pindex) {
+        if (!m_blocks.empty() && m_blocks.back().first == m_tip) {
+            m_blocks.pop_back();
+        }
+    } else {
+        m_blocks.clear();
+        m_exhausted = false;
+    }
+
+    m_tip = pindex;
+    Refill();
+}
+
+void DifficultyWindow::Initialize(const CBlockIndex* const pindex)
+{
+    LOCK(cs_window);
+
+    if (m_tip == nullptr && pindex != nullptr) {
+        m_tip = pindex;
+        Refill();
+    }
+}
+
+bool DifficultyWindow::GetAverage(const unsigned int nPoSInterval, double& average) const
+{
+    LOCK(cs_window);
+
+    if (m_tip == nullptr || (nPoSInterval > m_blocks.size() && !m_exhausted)) {
+        return false;
+    }
+
+    double dDiffSum = 0.0;
+    unsigned int nStakesHandled = 0;
+
+    // Sum the newest blocks first in the same order as the original walk:
+    for (auto iter = m_blocks.rbegin();
+        iter != m_blocks.rend() && nStakesHandled < nPoSInterval;
+        ++iter, ++nStakesHandled)
+    {
+        dDiffSum += iter->second;
+    }
+
+    average = nStakesHandled ? dDiffSum / nStakesHandled : 0;
+
+    return true;
+}
+
+void DifficultyWindow::Refill()
+{
+    const CBlockIndex* pindex = m_blocks.empty() ? m_tip : m_blocks.front().first->pprev;
+
+    while (!m_exhausted && m_blocks.size() < MAX_INTERVAL) {
+        if (pindex == nullptr) {
+            m_exhausted = true;
+            break;
+        }
+
+        if (pindex->IsProofOfStake()) {
+            const double dDiff = GetBlockDifficulty(pindex->nBits);
+
+            if (dDiff) {
+                m_blocks.emplace_front(pindex, dDiff);
+            }
+        }
+
+        pindex = pindex->pprev;
+    }
+}
+
 // -----------------------------------------------------------------------------
 // Functions
 // -----------------------------------------------------------------------------
 
+DifficultyWindow& GRC::GetDifficultyWindow()
+{
+    return g_difficulty_window;
+}
+
 unsigned int GRC::GetNextTargetRequired(const CBlockIndex* pindexLast)
 {
     if (pindexLast == nullptr) {
@@ -58,8 +176,10 @@ unsigned int GRC::GetNextTargetRequired(const CBlockIndex* pindexLast)
 
     // ppcoin: target change every block
     // ppcoin: retarget with exponential moving toward target spacing
-    CBigNum bnNew;
-    bnNew.SetCompact(pindexPrev->nBits);
+    bool negative;
+    bool overflow;
+    arith_uint256 target;
+    target.SetCompact(pindexPrev->nBits, &negative, &overflow);
 
     // Gridcoin - Reset Diff to 1 on 12-19-2014 (R Halford) - Diff sticking at
     // 2065 due to many incompatible features:
@@ -77,14 +197,24 @@ unsigned int GRC::GetNextTargetRequired(const CBlockIndex* pindexLast)
     // the nInterval = 15 min
 
     const int64_t nInterval = TARGET_TIMESPAN / nTargetSpacing;
-    bnNew *= (nInterval - 1) * nTargetSpacing + nActualSpacing + nActualSpacing;
-    bnNew /= (nInterval + 1) * nTargetSpacing;
 
-    if (bnNew <= 0 || bnNew > PROOF_OF_STAKE_LIMIT) {
-        bnNew = PROOF_OF_STAKE_LIMIT;
+    // A negative target retargets to a value of zero or less. A target that
+    // overflows 256 bits stays above the limit because the factor below is
+    // at least (nInterval - 1) / (nInterval + 1):
+    if (negative || overflow) {
+        return PROOF_OF_STAKE_LIMIT.GetCompact();
     }
 
-    return bnNew.GetCompact();
+    // The product needs more than 256 bits for long block spacings:
+    arith_uint512 bnNew(target);
+    bnNew *= arith_uint512((nInterval - 1) * nTargetSpacing + nActualSpacing + nActualSpacing);
+    bnNew /= arith_uint512((nInterval + 1) * nTargetSpacing);
+
+    if (bnNew == 0 || bnNew > arith_uint512(PROOF_OF_STAKE_LIMIT)) {
+        return PROOF_OF_STAKE_LIMIT.GetCompact();
+    }
+
+    return bnNew.GetLow256().GetCompact();
 }
 
 double GRC::GetDifficulty(const CBlockIndex* blockindex)
@@ -153,6 +283,15 @@ double GRC::GetAverageDifficulty(unsigned int nPoSInterval)
     unsigned int nStakesHandled = 0;
     double result;
 
+    // The node keeps the window in step with the chain tip. This only walks
+    // the block index for intervals longer than the window holds:
+    g_difficulty_window.Initialize(pindexBest);
+
+    if (g_difficulty_window.GetAverage(nPoSInterval, result)) {
+        LogPrint(BCLog::LogFlags::NOISY, "GetAverageDifficulty debug: Average dDiff = %f", result);
+        return result;
+    }
+
     CBlockIndex* pindex = pindexBest;
 
     while (pindex && nStakesHandled < nPoSInterval)
@@ -181,37 +320,10 @@ double GRC::GetAverageDifficulty(unsigned int nPoSInterval)
 
 uint64_t GRC::GetStakeWeight(const CWallet& wallet)
 {
-    if (wallet.GetBalance() <= nReserveBalance) {
-        return 0;
-    }
-
-    const int64_t now = GetAdjustedTime();
-
-    std::vector<std::pair<const CWalletTx*, unsigned int>> coins;
-    GRC::MinerStatus::ReasonNotStakingCategory unused;
-
-    if (!wallet.SelectCoinsForStaking(now, coins, unused)) {
-        return 0;
-    }
-
-    CTxDB txdb("r");
-    uint64_t weight = 0;
-
-    LOCK2(cs_main, wallet.cs_wallet);
-
-    for (const auto& pcoin : coins) {
-        CTxIndex txindex;
-
-        if (!txdb.ReadTxIndex(pcoin.first->GetHash(), txindex)) {
-            continue;
-        }
-
-        if (now - pcoin.first->nTime > nStakeMinAge) {
-            weight += (pcoin.first->vout[pcoin.second].nValue);
-        }
-    }
-
-    return weight;
+    // The wallet queues the outputs that have not reached the minimum stake
+    // age, so this only scans the wallet again after a change to it or to the
+    // chain tip:
+    return std::max<int64_t>(wallet.GetStakeWeight(GetAdjustedTime()), 0);
 }
 
 double GRC::GetEstimatedNetworkWeight(unsigned int nPoSInterval)
@@ -340,12 +452,26 @@ double GRC::GetEstimatedTimetoStake(bool ignore_staking_status, double dDiff, do
     LogPrint(BCLog::LogFlags::NOISY, "GetEstimatedTimetoStake debug: dUnitStakeProbability = %e", dUnitStakeProbability);
 
 
+    // Read the index entries of all the coins in one pass over the database:
+    std::vector<uint256> vHashes;
+    vHashes.reserve(vCoins.size());
+    for (const auto& out : vCoins) vHashes.push_back(out.tx->GetHash());
+
+    std::map<uint256, CTxIndex> mapTxIndex;
+    if (!txdb.ReadTxIndexes(vHashes, mapTxIndex))
+    {
+        error("%s: failed to read the transaction index", __func__);
+        return result;
+    }
+
     int64_t nTime = 0;
     for (const auto& out : vCoins)
     {
-        CTxIndex txindex;
+        const auto txindex_iter = mapTxIndex.find(out.tx->GetHash());
+        if (txindex_iter == mapTxIndex.end()) continue; //Ignore transactions that can't be read.
+
+        const CTxIndex& txindex = txindex_iter->second;
         CBlock CoinBlock; //Block which contains CoinTx
-        if (!txdb.ReadTxIndex(out.tx->GetHash(), txindex)) continue; //Ignore transactions that can't be read.
 
         if (!CoinBlock.ReadFromDisk(txindex.pos.nFile, txindex.pos.nBlockPos, false)) continue;
 
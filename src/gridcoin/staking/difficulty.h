@@ -5,10 +5,87 @@
 
 #pragma once
 
+#include "sync.h"
+
+#include <deque>
+#include <utility>
+
 class CBlockIndex;
 class CWallet;
 
 namespace GRC {
+//!
+//! \brief Holds the difficulties of the most recent proof-of-stake blocks in
+//! the active chain so that the average difficulty does not walk the block
+//! index on every call.
+//!
+//! The node moves the window with each change of the chain tip: a connected
+//! block pushes its difficulty and a disconnected block pops it again.
+//!
+class DifficultyWindow
+{
+public:
+    //!
+    //! \brief The largest number of proof-of-stake blocks that the window
+    //! averages. The staking loop uses the largest interval.
+    //!
+    static constexpr unsigned int MAX_INTERVAL = 160;
+
+    //!
+    //! \brief Move the window to a new chain tip.
+    //!
+    //! Pushes the tip if it extends the previous tip, pops the previous tip
+    //! if the new tip is its parent and rebuilds the window from the block
+    //! index for any other change.
+    //!
+    //! \param pindex The new chain tip. Pass \c nullptr to clear the window.
+    //!
+    void SetTip(const CBlockIndex* const pindex);
+
+    //!
+    //! \brief Build the window for a chain tip if it has never been moved.
+    //!
+    //! \param pindex The current chain tip.
+    //!
+    void Initialize(const CBlockIndex* const pindex);
+
+    //!
+    //! \brief Get the arithmetic average difficulty of the most recent
+    //! proof-of-stake blocks.
+    //!
+    //! \param nPoSInterval Number of proof-of-stake blocks to average.
+    //! \param average      Set to the average, or zero when the chain contains
+    //! no proof-of-stake blocks.
+    //!
+    //! \return \c false if the window has no tip or does not hold enough
+    //! blocks to answer for the interval.
+    //!
+    bool GetAverage(const unsigned int nPoSInterval, double& average) const;
+
+private:
+    mutable CCriticalSection cs_window;
+
+    //!
+    //! \brief The proof-of-stake blocks in the window with their difficulty,
+    //! oldest first.
+    //!
+    std::deque<std::pair<const CBlockIndex*, double>> m_blocks;
+
+    const CBlockIndex* m_tip = nullptr; //!< Chain tip of the window.
+    bool m_exhausted = false; //!< No older proof-of-stake blocks exist.
+
+    //!
+    //! \brief Add older proof-of-stake blocks to the window until it holds
+    //! MAX_INTERVAL blocks or reaches the genesis block.
+    //!
+    void Refill();
+};
+
+//!
+//! \brief Get the difficulty window for the active chain.
+//!
+DifficultyWindow& GetDifficultyWindow();
+
 // Note that dDiff cannot be = 0 normally. This is set as default because you can't specify the output of
 // GetAverageDifficulty(nPosInterval) = to dDiff here.
 // The defeult confidence is 1-1/e which is the mean for the geometric distribution for small probabilities.
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "arith_uint256.h"
+#include "crypto/common.h"
 #include "gridcoin/staking/kernel.h"
 #include "txdb.h"
 #include "main.h"
@@ -179,13 +180,24 @@ int64_t GRC::GetWeight(int64_t nIntervalBeginning, int64_t nIntervalEnd)
     return min(nIntervalEnd - nIntervalBeginning - nStakeMinAge, (int64_t)nStakeMaxAge);
 }
 
+// Get the block that generated the stake modifier in effect at a given block.
+// The block index links each entry to it, so this only walks back for entries
+// that were never linked.
+static const CBlockIndex* GetStakeModifierBlock(const CBlockIndex* pindex)
+{
+    if (pindex->pmodifier)
+        return pindex->pmodifier;
+    while (pindex->pprev && !pindex->GeneratedStakeModifier())
+        pindex = pindex->pprev;
+    return pindex;
+}
+
 // Get the last stake modifier and its generation time from a given block
 static bool GetLastStakeModifier(const CBlockIndex* pindex, uint64_t& nStakeModifier, int64_t& nModifierTime)
 {
     if (!pindex)
         return error("GetLastStakeModifier: null pindex");
-    while (pindex && pindex->pprev && !pindex->GeneratedStakeModifier())
-        pindex = pindex->pprev;
+    pindex = GetStakeModifierBlock(pindex);
     if (!pindex->GeneratedStakeModifier())
         return error("GetLastStakeModifier: no generation at genesis block");
     nStakeModifier = pindex->nStakeModifier;
@@ -464,7 +476,7 @@ bool GRC::CalculateLegacyV3HashProof(
         << coinstake.nTime
         << por_nonce;
 
-    out_hash_proof = CBigNum(out.GetHash()).getuint256();
+    out_hash_proof = out.GetHash();
 
     return true;
 }
@@ -515,18 +527,62 @@ uint256 GRC::CalculateStakeHashV8(
     unsigned CoinTxN,
     unsigned nTimeTx,
     uint64_t StakeModifier)
+{
+    return CalculateStakeHashV8(CoinBlock.nTime, CoinTx.GetHash(), CoinTxN, nTimeTx, StakeModifier);
+}
+
+uint256 GRC::CalculateStakeHashV8(
+    unsigned nCoinBlockTime,
+    const uint256& CoinTxHash,
+    unsigned CoinTxN,
+    unsigned nTimeTx,
+    uint64_t StakeModifier)
 {
     CHashWriter ss(SER_GETHASH, 0);
 
     ss << StakeModifier;
-    ss << (CoinBlock.nTime & ~STAKE_TIMESTAMP_MASK);
-    ss << CoinTx.GetHash();
+    ss << (nCoinBlockTime & ~STAKE_TIMESTAMP_MASK);
+    ss << CoinTxHash;
     ss << CoinTxN;
     ss << (nTimeTx & ~STAKE_TIMESTAMP_MASK);
 
     return ss.GetHash();
 }
 
+std::vector<uint256> GRC::CalculateStakeHashesV8(
+    const std::vector<StakeKernelCandidate>& candidates,
+    unsigned nTimeTx,
+    uint64_t StakeModifier)
+{
+    // The preimage serialized by CalculateStakeHashV8() above:
+    //
+    //   (8)  stake modifier
+    //   (4)  masked block time
+    //   (32) transaction hash
+    //   (4)  output index
+    //   (4)  masked coinstake time
+    //
+    constexpr size_t PREIMAGE_SIZE = 8 + 4 + 32 + 4 + 4;
+
+    unsigned char preimage[PREIMAGE_SIZE];
+    WriteLE64(preimage, StakeModifier);
+    WriteLE32(preimage + 48, nTimeTx & ~STAKE_TIMESTAMP_MASK);
+
+    std::vector<uint256> hashes(candidates.size());
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const StakeKernelCandidate& candidate = candidates[i];
+
+        WriteLE32(preimage + 8, candidate.nCoinBlockTime & ~STAKE_TIMESTAMP_MASK);
+        memcpy(preimage + 12, candidate.CoinTxHash.begin(), 32);
+        WriteLE32(preimage + 44, candidate.CoinTxN);
+
+        CHash256().Write(preimage, sizeof(preimage)).Finalize(hashes[i].begin());
+    }
+
+    return hashes;
+}
+
 int64_t GRC::CalculateStakeWeightV8(const CTransaction &CoinTx, unsigned CoinTxN)
 {
     int64_t nValueIn = CoinTx.vout[CoinTxN].nValue;
@@ -539,20 +595,17 @@ int64_t GRC::CalculateStakeWeightV8(const CTransaction &CoinTx, unsigned CoinTxN
 bool GRC::FindStakeModifierRev(uint64_t& nStakeModifier,CBlockIndex* pindexPrev)
 {
     nStakeModifier = 0;
-    const CBlockIndex* pindex = pindexPrev;
 
-    while (1)
-    {
-        if(!pindex)
-            return error("FindStakeModifierRev: no previous block from %d",pindexPrev->nHeight);
+    if (!pindexPrev)
+        return error("FindStakeModifierRev: null pindex");
 
-        if (pindex->GeneratedStakeModifier())
-        {
-            nStakeModifier = pindex->nStakeModifier;
-            return true;
-        }
-        pindex = pindex->pprev;
-    }
+    const CBlockIndex* pindex = GetStakeModifierBlock(pindexPrev);
+
+    if (!pindex->GeneratedStakeModifier())
+        return error("FindStakeModifierRev: no previous block from %d",pindexPrev->nHeight);
+
+    nStakeModifier = pindex->nStakeModifier;
+    return true;
 }
 
 // Block Version 8+ check procedure
@@ -602,24 +655,45 @@ bool GRC::CheckProofOfStakeV8(
 
     //Stake refactoring TomasBrod
     int64_t Weight = CalculateStakeWeightV8(txPrev, prevout.n);
-    CBigNum bnHashProof(hashProofOfStake);
-
-    // Base target
-    CBigNum bnTarget;
-    bnTarget.SetCompact(Block.nBits);
-    // Weighted target
-    bnTarget *= Weight;
-
 
     LogPrint(BCLog::LogFlags::VERBOSE,
              "CheckProofOfStakeV8:%s Time1 %.f, Time2 %.f, Time3 %.f, Bits %u, Weight %.f\n"
              " Stk %72s\n"
-             " Trg %72s", generated_by_me?" Local,":"",
+             " Trg %72s (unweighted)", generated_by_me?" Local,":"",
              (double)header.nTime, (double)txPrev.nTime, (double)tx.nTime,
              Block.nBits, (double)Weight,
-             CBigNum(hashProofOfStake).GetHex(), bnTarget.GetHex()
+             hashProofOfStake.GetHex(), arith_uint256().SetCompact(Block.nBits).GetHex()
              );
 
     // Now check if proof-of-stake hash meets target protocol
-    return bnHashProof <= bnTarget;
+    return CheckStakeKernelHashV8(hashProofOfStake, Block.nBits, Weight);
+}
+
+bool GRC::CheckStakeKernelHashV8(const uint256& hash, unsigned int nBits, int64_t weight)
+{
+    bool negative;
+    bool overflow;
+    arith_uint256 target;
+    target.SetCompact(nBits, &negative, &overflow);
+
+    const arith_uint256 hash_num = UintToArith256(hash);
+
+    // A weighted target of zero only admits a zero hash, and a negative one
+    // admits none:
+    if (weight == 0 || (target == 0 && !overflow)) {
+        return hash_num == 0;
+    }
+
+    if (negative != (weight < 0)) {
+        return false;
+    }
+
+    // Compact targets that exceed 256 bits exceed every hash when weighted:
+    if (overflow) {
+        return true;
+    }
+
+    const uint64_t magnitude = weight < 0 ? -(uint64_t)weight : weight;
+
+    return arith_uint512(hash_num) <= arith_uint512(target) * arith_uint512(magnitude);
 }
@@ -103,5 +103,56 @@ uint256 CalculateStakeHashV8(
     unsigned nTimeTx,
     uint64_t StakeModifier);
 
+// Kernel for V8 from the time of the block that contains the coin
+uint256 CalculateStakeHashV8(
+    unsigned nCoinBlockTime,
+    const uint256& CoinTxHash,
+    unsigned CoinTxN,
+    unsigned nTimeTx,
+    uint64_t StakeModifier);
+
+//!
+//! \brief The inputs of the version 8 kernel hash that vary by coin.
+//!
+struct StakeKernelCandidate
+{
+    unsigned nCoinBlockTime; //!< Time of the block that contains the coin.
+    uint256 CoinTxHash;      //!< Hash of the transaction that produced the coin.
+    unsigned CoinTxN;        //!< Output index of the coin.
+};
+
+//!
+//! \brief Calculate the version 8 kernel hashes of many coins at once.
+//!
+//! The coins share the stake modifier and the coinstake time of a staking
+//! round. This packs each fixed-size kernel preimage into a buffer and hashes
+//! it without the serialization layer of CHashWriter.
+//!
+//! \param candidates    Coins to hash.
+//! \param nTimeTx       Time of the coinstake transaction.
+//! \param StakeModifier Stake modifier for the round.
+//!
+//! \return The kernel hash of each candidate in the same order.
+//!
+std::vector<uint256> CalculateStakeHashesV8(
+    const std::vector<StakeKernelCandidate>& candidates,
+    unsigned nTimeTx,
+    uint64_t StakeModifier);
+
 int64_t CalculateStakeWeightV8(const CTransaction &CoinTx, unsigned CoinTxN);
+
+//!
+//! \brief Check a version 8 kernel hash against the block target scaled by
+//! the weight of the staked coin.
+//!
+//! Scales the target in 512 bits. The result matches the unbounded CBigNum
+//! arithmetic that the check used before, without allocating.
+//!
+//! \param hash   Kernel hash from CalculateStakeHashV8().
+//! \param nBits  Compact target of the block.
+//! \param weight Weight from CalculateStakeWeightV8().
+//!
+//! \return \c true if the hash does not exceed the weighted target.
+//!
+bool CheckStakeKernelHashV8(const uint256& hash, unsigned int nBits, int64_t weight);
 } // namespace GRC
@@ -41,12 +41,12 @@ int64_t GRC::GetConstantBlockReward(const CBlockIndex* index)
     const int64_t MAX_CBR = DEFAULT_CBR * 2;
 
     int64_t reward = DEFAULT_CBR;
-    AppCacheEntry oCBReward = ReadCache(Section::PROTOCOL, "blockreward1");
+    const ProtocolParametersPtr params = GetProtocolParameters();
 
     //TODO: refactor the expire checking to subroutine
     //Note: time constant is same as GetBeaconPublicKey
-    if ((index->nTime - oCBReward.timestamp) <= (60 * 24 * 30 * 6 * 60)) {
-        reward = atoi64(oCBReward.value);
+    if ((index->nTime - params->block_reward_time) <= (60 * 24 * 30 * 6 * 60)) {
+        reward = params->block_reward;
     }
 
     reward = std::max(reward, MIN_CBR);
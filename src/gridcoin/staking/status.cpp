@@ -43,6 +43,9 @@ MinerStatus::MinerStatus(void)
     Clear();
     ClearReasonsNotStaking();
     CreatedCnt = AcceptedCnt = KernelsFound = 0;
+    m_rounds = 0;
+    m_kernel_hashes = 0;
+    m_last_round_usec = m_total_round_usec = 0;
 }
 
 void MinerStatus::Clear()
@@ -42,6 +42,11 @@ public:
     int64_t nLastCoinStakeSearchInterval;
     uint256 m_last_pos_tx_hash;
 
+    uint64_t m_rounds;             //!< Kernel searches run since startup.
+    int64_t m_last_round_usec;     //!< Duration of the last kernel search.
+    int64_t m_total_round_usec;    //!< Duration of all kernel searches.
+    uint64_t m_kernel_hashes;      //!< Stake kernels hashed since startup.
+
     void Clear();
     MinerStatus();
 
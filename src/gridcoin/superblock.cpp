@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "compat/endian.h"
+#include "crypto/common.h"
+#include "fs.h"
 #include "hash.h"
 #include "main.h"
 #include "gridcoin/superblock.h"
@@ -12,6 +14,8 @@
 #include "util/reverse_iterator.h"
 
 #include <boost/variant/apply_visitor.hpp>
+#include <deque>
+#include <map>
 #include <openssl/md5.h>
 
 using namespace GRC;
@@ -19,6 +23,23 @@ using namespace GRC;
 extern ScraperStatsAndVerifiedBeacons GetScraperStatsAndVerifiedBeacons(const ConvergedScraperStats& stats);
 
 namespace {
+//!
+//! \brief Get the Golomb-Rice parameter for the differences between a count
+//! of sorted, uniformly distributed 64-bit values.
+//!
+//! \return 63 minus the base-2 logarithm of the count, rounded down.
+//!
+uint8_t CpidRiceParameter(uint64_t count)
+{
+    uint8_t log2 = 0;
+
+    while ((count >> log2) > 1) {
+        ++log2;
+    }
+
+    return 63 - log2;
+}
+
 //!
 //! \brief Loads a provided set of scraper statistics into a superblock.
 //!
@@ -380,27 +401,41 @@ public:
     Superblock::ProjectIndex ExtractProjects() const
     {
         Superblock::ProjectIndex projects;
-        size_t start = 0;
-        size_t end = m_averages.find(";");
+        std::string name;
+        std::string average_rac_field;
+        std::string rac_field;
 
-        while (end != std::string::npos) {
-            std::string project_record = m_averages.substr(start, end - start);
-            std::vector<std::string> parts = split(project_record, ",");
+        for (size_t start = 0, end = m_averages.find(';');
+            end != std::string::npos;
+            start = end + 1, end = m_averages.find(';', start))
+        {
+            const size_t comma = m_averages.find(',', start);
 
-            start = end + 1;
-            end = m_averages.find(";", start);
+            if (comma >= end || comma == start) {
+                continue;
+            }
 
-            if (parts.size() < 2
-                || parts[0].empty()
-                || parts[0] == "NeuralNetwork") // Ignore network stats
-            {
+            name.assign(m_averages, start, comma - start);
+
+            if (name == "NeuralNetwork") { // Ignore network stats
                 continue;
             }
 
+            // Fields after the RAC field are ignored:
+            const size_t rac_comma = m_averages.find(',', comma + 1);
+            const bool has_rac = rac_comma < end;
+
+            average_rac_field.assign(m_averages, comma + 1, (has_rac ? rac_comma : end) - comma - 1);
+
+            if (has_rac) {
+                const size_t rac_end = std::min(end, m_averages.find(',', rac_comma + 1));
+                rac_field.assign(m_averages, rac_comma + 1, rac_end - rac_comma - 1);
+            }
+
             try {
-                projects.Add(std::move(parts[0]), Superblock::ProjectStats(
-                    std::stoi(parts[1]),                          // average RAC
-                    parts.size() > 2 ? std::stoi(parts[2]) : 0)); // RAC
+                projects.Add(name, Superblock::ProjectStats(
+                    std::stoi(average_rac_field),          // average RAC
+                    has_rac ? std::stoi(rac_field) : 0)); // RAC
 
             } catch (...) {
                 LogPrint(BCLog::LogFlags::SB,
@@ -456,23 +491,33 @@ private:
     {
         Superblock::CpidIndex magnitudes(m_zero_mags);
 
-        size_t start = 0;
-        size_t end = m_magnitudes.find(";");
-
-        while (end != std::string::npos) {
-            std::string cpid_record = m_magnitudes.substr(start, end - start);
-            std::vector<std::string> parts = split(cpid_record, ",");
+        // Superblocks hold thousands of records. Find the fields in place and
+        // reuse their buffers instead of allocating a substring and a vector
+        // of parts for each record:
+        //
+        std::string cpid_field;
+        std::string magnitude_field;
 
-            start = end + 1;
-            end = m_magnitudes.find(";", start);
+        for (size_t start = 0, end = m_magnitudes.find(';');
+            end != std::string::npos;
+            start = end + 1, end = m_magnitudes.find(';', start))
+        {
+            const size_t comma = m_magnitudes.find(',', start);
 
-            if (parts.size() != 2 || parts[0].empty()) {
+            // A record contains exactly two fields and a non-empty CPID:
+            if (comma >= end
+                || comma == start
+                || m_magnitudes.find(',', comma + 1) < end)
+            {
                 continue;
             }
 
-            if (const CpidOption cpid = MiningId::Parse(parts[0]).TryCpid()) {
+            cpid_field.assign(m_magnitudes, start, comma - start);
+            magnitude_field.assign(m_magnitudes, comma + 1, end - comma - 1);
+
+            if (const CpidOption cpid = MiningId::Parse(cpid_field).TryCpid()) {
                 try {
-                    magnitudes.AddLegacy(*cpid, std::stoi(parts[1]));
+                    magnitudes.AddLegacy(*cpid, std::stoi(magnitude_field));
                 } catch(...) {
                     LogPrint(BCLog::LogFlags::SB,
                         "LegacySuperblock: Failed to parse magnitude.\n");
@@ -525,6 +570,397 @@ struct QuorumHashToStringVisitor : boost::static_visitor<std::string>
         return HexStr(legacy_hash.begin(), legacy_hash.end());
     }
 };
+
+//!
+//! \brief Shares decoded superblocks by the hash of their containing blocks.
+//!
+//! A decoded superblock can hold tens of thousands of CPIDs. The quorum, the
+//! tally and the voting system each need superblocks, often the same ones,
+//! so this cache lets them share a single immutable copy of each superblock
+//! instead of reading and parsing the block again.
+//!
+//! The cache tracks superblocks with weak references so that it never keeps
+//! a superblock alive on its own, except for a few of the superblocks loaded
+//! from disk most recently. These avoid re-reading old superblocks for the
+//! repeated look-ups that happen when tallying the votes of older polls.
+//!
+class SuperblockCache
+{
+public:
+    //!
+    //! \brief Number of superblocks loaded from disk to keep alive.
+    //!
+    static constexpr size_t RECENT_SIZE = 4;
+
+    //!
+    //! \brief Get the decoded superblock for the specified block.
+    //!
+    //! \param block_hash Hash of the block that contains the superblock.
+    //!
+    //! \return The shared superblock or \c nullptr when no live copy exists.
+    //!
+    std::shared_ptr<const Superblock> Find(const uint256& block_hash)
+    {
+        LOCK(cs_superblock_cache);
+
+        const auto iter = m_superblocks.find(block_hash);
+
+        if (iter == m_superblocks.end()) {
+            return nullptr;
+        }
+
+        std::shared_ptr<const Superblock> superblock = iter->second.lock();
+
+        if (!superblock) {
+            m_superblocks.erase(iter);
+        }
+
+        return superblock;
+    }
+
+    //!
+    //! \brief Share a decoded superblock.
+    //!
+    //! \param block_hash Hash of the block that contains the superblock.
+    //! \param superblock The decoded superblock.
+    //! \param retain     Whether to keep the superblock alive while it is one
+    //! of the most recent stored with this flag.
+    //!
+    void Store(
+        const uint256& block_hash,
+        const std::shared_ptr<const Superblock>& superblock,
+        const bool retain)
+    {
+        LOCK(cs_superblock_cache);
+
+        // Drop the entries for superblocks that no longer exist. This keeps
+        // the map's size proportional to the number of live superblocks:
+        //
+        for (auto iter = m_superblocks.begin(); iter != m_superblocks.end();) {
+            if (iter->second.expired()) {
+                iter = m_superblocks.erase(iter);
+            } else {
+                ++iter;
+            }
+        }
+
+        m_superblocks[block_hash] = superblock;
+
+        if (retain) {
+            m_recent.emplace_back(superblock);
+
+            if (m_recent.size() > RECENT_SIZE) {
+                m_recent.pop_front();
+            }
+        }
+    }
+
+private:
+    CCriticalSection cs_superblock_cache;
+
+    //!
+    //! \brief Weak references to the decoded superblocks keyed by the hashes
+    //! of the blocks that contain them.
+    //!
+    std::map<uint256, std::weak_ptr<const Superblock>> m_superblocks;
+
+    //!
+    //! \brief Strong references to the superblocks loaded from disk most
+    //! recently.
+    //!
+    std::deque<std::shared_ptr<const Superblock>> m_recent;
+};
+
+SuperblockCache g_superblock_cache;
+
+//!
+//! \brief Stores decoded legacy superblocks on disk by the hash of their
+//! packed contracts.
+//!
+//! The text-packed legacy superblocks of the early chain hold thousands of
+//! CPID records that take far longer to parse than to read back in binary
+//! form. Every reindex parses the same contracts again, so this file keeps
+//! the decoded form of each one after its first decode. Because the entries
+//! depend only on the contents of a contract, they never become stale, and
+//! the file survives a reindex.
+//!
+//! Each record in the file contains the contract hash, the payload size, a
+//! checksum of the payload, and the payload. A torn record at the end of the
+//! file from an unclean shutdown is truncated when the file opens.
+//!
+class LegacySuperblockCache
+{
+public:
+    //!
+    //! \brief Begins the file so that other data is never read as records.
+    //!
+    static constexpr uint32_t FILE_MAGIC = 0x4c534243; // "LSBC"
+
+    //!
+    //! \brief Prevents a corrupt record from requesting a huge allocation.
+    //!
+    static constexpr uint32_t MAX_PAYLOAD_SIZE = 16 * 1024 * 1024;
+
+    LegacySuperblockCache() : m_end(0), m_open(false)
+    {
+    }
+
+    //!
+    //! \brief Index the records in the cache file or create it.
+    //!
+    //! \param path Location of the cache file.
+    //!
+    void Open(const fs::path& path)
+    {
+        LOCK(cs_legacy_cache);
+
+        m_path = path;
+        m_locations.clear();
+        m_end = 0;
+        m_open = false;
+
+        if (!Scan()) {
+            CAutoFile file(fsbridge::fopen(m_path, "wb"), SER_DISK, CLIENT_VERSION);
+
+            if (file.IsNull()) {
+                LogPrintf("WARNING: %s: failed to create %s", __func__, m_path.string());
+                return;
+            }
+
+            file << FILE_MAGIC;
+            m_locations.clear();
+            m_end = sizeof(FILE_MAGIC);
+        }
+
+        m_open = true;
+
+        LogPrint(BCLog::LogFlags::SB, "INFO: %s: %u legacy superblocks cached", __func__, m_locations.size());
+    }
+
+    //!
+    //! \brief Whether the cache file opened.
+    //!
+    bool IsOpen()
+    {
+        LOCK(cs_legacy_cache);
+
+        return m_open;
+    }
+
+    //!
+    //! \brief Load a decoded legacy superblock.
+    //!
+    //! \param key Hash of the packed contract.
+    //!
+    //! \return The superblock when the cache contains a valid record for it.
+    //!
+    boost::optional<Superblock> Find(const uint256& key)
+    {
+        LOCK(cs_legacy_cache);
+
+        const auto iter = m_locations.find(key);
+
+        if (!m_open || iter == m_locations.end()) {
+            return boost::none;
+        }
+
+        const Location& location = iter->second;
+        CAutoFile file(fsbridge::fopen(m_path, "rb"), SER_DISK, CLIENT_VERSION);
+        std::vector<unsigned char> payload(location.m_size);
+
+        try {
+            if (file.IsNull() || fseek(file.Get(), location.m_offset, SEEK_SET) != 0) {
+                throw std::ios_base::failure("seek failed");
+            }
+
+            file.read(CharCast(payload.data()), payload.size());
+
+            if (Checksum(payload) != location.m_checksum) {
+                throw std::ios_base::failure("checksum mismatch");
+            }
+
+            CDataStream stream(payload, SER_DISK, CLIENT_VERSION);
+
+            uint32_t zeros;
+            Superblock::MagnitudeStorageType magnitudes;
+            std::vector<std::pair<std::string, Superblock::ProjectStats>> projects;
+
+            stream >> VARINT(zeros) >> magnitudes >> projects;
+
+            // Legacy-packed superblocks always initialize to version 1:
+            Superblock superblock(1);
+            superblock.m_cpids = Superblock::CpidIndex(zeros);
+
+            for (const auto& cpid_pair : magnitudes) {
+                superblock.m_cpids.AddLegacy(cpid_pair.first, cpid_pair.second);
+            }
+
+            for (auto& project_pair : projects) {
+                superblock.m_projects.Add(std::move(project_pair.first), project_pair.second);
+            }
+
+            return superblock;
+        } catch (const std::exception& e) {
+            LogPrintf("WARNING: %s: dropped cached legacy superblock %s: %s",
+                __func__, key.ToString(), e.what());
+        }
+
+        // The contract decodes again and appends a fresh record:
+        m_locations.erase(iter);
+
+        return boost::none;
+    }
+
+    //!
+    //! \brief Append a decoded legacy superblock to the cache file.
+    //!
+    //! \param key        Hash of the packed contract.
+    //! \param superblock Decoded from the contract.
+    //!
+    void Store(const uint256& key, const Superblock& superblock)
+    {
+        CDataStream stream(SER_DISK, CLIENT_VERSION);
+        uint32_t zeros = superblock.m_cpids.Zeros();
+        std::vector<std::pair<std::string, Superblock::ProjectStats>> projects(
+            superblock.m_projects.begin(),
+            superblock.m_projects.end());
+
+        stream << VARINT(zeros)
+            << superblock.m_cpids.Legacy()
+            << projects;
+
+        const std::vector<unsigned char> payload(stream.begin(), stream.end());
+
+        LOCK(cs_legacy_cache);
+
+        if (!m_open || m_locations.count(key) || payload.size() > MAX_PAYLOAD_SIZE) {
+            return;
+        }
+
+        CAutoFile file(fsbridge::fopen(m_path, "ab"), SER_DISK, CLIENT_VERSION);
+
+        if (file.IsNull()) {
+            return;
+        }
+
+        Location location;
+        location.m_offset = m_end + sizeof(key) + 2 * sizeof(uint32_t);
+        location.m_size = payload.size();
+        location.m_checksum = Checksum(payload);
+
+        try {
+            file << key << location.m_size << location.m_checksum;
+            file.write(CharCast(payload.data()), payload.size());
+        } catch (const std::exception& e) {
+            LogPrintf("WARNING: %s: failed to write %s: %s", __func__, m_path.string(), e.what());
+
+            // A partial record is truncated the next time the file opens.
+            // Stop appending so that no record follows it:
+            m_open = false;
+            return;
+        }
+
+        m_locations.emplace(key, location);
+        m_end = location.m_offset + location.m_size;
+    }
+
+private:
+    //!
+    //! \brief The position of a record payload in the file.
+    //!
+    struct Location
+    {
+        uint64_t m_offset;   //!< Offset of the payload from the file start.
+        uint32_t m_size;     //!< Size of the payload in bytes.
+        uint32_t m_checksum; //!< Truncated hash of the payload.
+    };
+
+    CCriticalSection cs_legacy_cache;
+    fs::path m_path;
+    std::map<uint256, Location> m_locations;
+    uint64_t m_end; //!< Offset past the last complete record.
+    bool m_open;
+
+    static uint32_t Checksum(const std::vector<unsigned char>& payload)
+    {
+        const uint256 hash = Hash(payload.begin(), payload.end());
+
+        return ReadLE32(hash.begin());
+    }
+
+    //!
+    //! \brief Index the records of an existing file and truncate a torn
+    //! record at its end.
+    //!
+    //! \return \c false when the file does not exist or belongs to something
+    //! else.
+    //!
+    bool Scan()
+    {
+        CAutoFile file(fsbridge::fopen(m_path, "rb"), SER_DISK, CLIENT_VERSION);
+
+        if (file.IsNull()) {
+            return false;
+        }
+
+        uint64_t file_size;
+
+        try {
+            file_size = fs::file_size(m_path);
+
+            uint32_t magic;
+            file >> magic;
+
+            if (magic != FILE_MAGIC) {
+                LogPrintf("WARNING: %s: replacing unrecognized %s", __func__, m_path.string());
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+
+        m_end = sizeof(FILE_MAGIC);
+
+        while (m_end < file_size) {
+            uint256 key;
+            Location location;
+            location.m_offset = m_end + sizeof(key) + 2 * sizeof(uint32_t);
+
+            try {
+                file >> key >> location.m_size >> location.m_checksum;
+            } catch (const std::exception&) {
+                break;
+            }
+
+            if (location.m_size > MAX_PAYLOAD_SIZE
+                || location.m_offset + location.m_size > file_size
+                || fseek(file.Get(), location.m_size, SEEK_CUR) != 0)
+            {
+                break;
+            }
+
+            m_locations[key] = location;
+            m_end = location.m_offset + location.m_size;
+        }
+
+        file.fclose();
+
+        if (m_end < file_size) {
+            LogPrintf("WARNING: %s: truncating a partial record in %s", __func__, m_path.string());
+
+            try {
+                fs::resize_file(m_path, m_end);
+            } catch (const fs::filesystem_error& e) {
+                LogPrintf("WARNING: %s: %s", __func__, e.what());
+                return false;
+            }
+        }
+
+        return true;
+    }
+}; // LegacySuperblockCache
+
+LegacySuperblockCache g_legacy_superblock_cache;
 } // anonymous namespace
 
 // -----------------------------------------------------------------------------
@@ -594,6 +1030,118 @@ Superblock Superblock::FromStats(const ScraperStatsAndVerifiedBeacons& stats_and
     return superblock;
 }
 
+std::vector<unsigned char> Superblock::PackCpids(const MagnitudeStorageType& magnitudes)
+{
+    std::vector<unsigned char> packed;
+    packed.reserve(1 + magnitudes.size() * 15);
+
+    CVectorWriter writer(SER_NETWORK, PROTOCOL_VERSION, packed, 0);
+
+    const uint8_t P = CpidRiceParameter(magnitudes.size());
+    writer << P;
+
+    {
+        BitStreamWriter<CVectorWriter> bitwriter(writer);
+        uint64_t previous = 0;
+
+        for (size_t i = 0; i < magnitudes.size(); ++i) {
+            if (i > 0 && !(magnitudes[i - 1].first < magnitudes[i].first)) {
+                throw std::ios_base::failure("Superblock::PackCpids(): CPIDs out of order");
+            }
+
+            const uint64_t high = ReadBE64(magnitudes[i].first.Raw().data());
+            const uint64_t delta = high - previous;
+
+            // Write the quotient in unary (q 1's followed by one 0) and the
+            // remainder in P bits:
+            for (uint64_t q = delta >> P; q > 0;) {
+                const int nbits = q <= 64 ? static_cast<int>(q) : 64;
+                bitwriter.Write(~0ULL, nbits);
+                q -= nbits;
+            }
+
+            bitwriter.Write(0, 1);
+            bitwriter.Write(delta, P);
+
+            previous = high;
+        }
+    }
+
+    for (const auto& cpid_pair : magnitudes) {
+        writer.write(CharCast(cpid_pair.first.Raw().data() + 8), 8);
+    }
+
+    return packed;
+}
+
+void Superblock::UnpackCpids(
+    const std::vector<unsigned char>& packed,
+    const uint64_t count,
+    MagnitudeStorageType& magnitudes)
+{
+    magnitudes.clear();
+
+    // Check the count against the size before allocating for it. The lower
+    // halves alone take eight bytes for each CPID:
+    if (packed.empty() || (packed.size() - 1) / 8 < count) {
+        throw std::ios_base::failure("Superblock::UnpackCpids(): CPID count exceeds the data");
+    }
+
+    VectorReader reader(SER_NETWORK, PROTOCOL_VERSION, packed, 0);
+
+    uint8_t P;
+    reader >> P;
+
+    if (P > 63) {
+        throw std::ios_base::failure("Superblock::UnpackCpids(): invalid parameter");
+    }
+
+    std::vector<uint64_t> highs;
+    highs.reserve(count);
+
+    {
+        BitStreamReader<VectorReader> bitreader(reader);
+        uint64_t high = 0;
+
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t q = 0;
+
+            while (bitreader.Read(1) == 1) {
+                if (++q > (std::numeric_limits<uint64_t>::max() >> P)) {
+                    throw std::ios_base::failure("Superblock::UnpackCpids(): CPID overflow");
+                }
+            }
+
+            const uint64_t delta = (q << P) | bitreader.Read(P);
+
+            if (delta > std::numeric_limits<uint64_t>::max() - high) {
+                throw std::ios_base::failure("Superblock::UnpackCpids(): CPID overflow");
+            }
+
+            high += delta;
+            highs.push_back(high);
+        }
+    }
+
+    if (reader.size() != count * 8) {
+        throw std::ios_base::failure("Superblock::UnpackCpids(): unexpected data size");
+    }
+
+    magnitudes.reserve(count);
+
+    for (const uint64_t high : highs) {
+        Cpid cpid;
+        WriteBE64(cpid.Raw().data(), high);
+        reader.read(CharCast(cpid.Raw().data() + 8), 8);
+
+        if (!magnitudes.empty() && !(magnitudes.back().first < cpid)) {
+            throw std::ios_base::failure("Superblock::UnpackCpids(): CPIDs out of order");
+        }
+
+        magnitudes.emplace_back(cpid, 0);
+    }
+}
+
 Superblock Superblock::UnpackLegacy(const std::string& packed)
 {
     if (packed.empty()) {
@@ -610,6 +1158,37 @@ Superblock Superblock::UnpackLegacy(const std::string& packed)
     return superblock;
 }
 
+Superblock Superblock::UnpackLegacyCached(const std::string& packed)
+{
+    // Binary-packed magnitudes decode faster than a cache look-up:
+    if (packed.empty()
+        || packed.find("<BINARY>") != std::string::npos
+        || !g_legacy_superblock_cache.IsOpen())
+    {
+        return UnpackLegacy(packed);
+    }
+
+    const uint256 key = Hash(packed.begin(), packed.end());
+
+    if (boost::optional<Superblock> superblock = g_legacy_superblock_cache.Find(key)) {
+        return std::move(*superblock);
+    }
+
+    Superblock superblock = UnpackLegacy(packed);
+
+    // Contracts that fail to parse stay out of the cache:
+    if (!superblock.m_cpids.empty() || !superblock.m_projects.empty()) {
+        g_legacy_superblock_cache.Store(key, superblock);
+    }
+
+    return superblock;
+}
+
+void Superblock::OpenLegacyCache(const fs::path& path)
+{
+    g_legacy_superblock_cache.Open(path);
+}
+
 std::string Superblock::PackLegacy() const
 {
     std::stringstream out;
@@ -757,6 +1336,10 @@ double Superblock::CpidIndex::AverageMagnitude() const
 
 Magnitude Superblock::CpidIndex::MagnitudeOf(const Cpid& cpid) const
 {
+    if (m_lookup) {
+        return m_lookup->MagnitudeOf(cpid);
+    }
+
     if (m_legacy) {
         const auto iter = std::lower_bound(
             m_legacy_magnitudes.begin(),
@@ -795,6 +1378,8 @@ Superblock::CpidIndex::At(const size_t offset) const
 
 void Superblock::CpidIndex::Add(const Cpid cpid, const Magnitude magnitude)
 {
+    m_lookup.reset();
+
     // Only increment the total magnitude if the CPID does not already
     // exist in the index:
     switch (magnitude.Which()) {
@@ -843,6 +1428,8 @@ void Superblock::CpidIndex::RoundAndAdd(const Cpid cpid, const double magnitude)
 
 void Superblock::CpidIndex::AddLegacy(const Cpid cpid, const uint16_t magnitude)
 {
+    m_lookup.reset();
+
     m_legacy_magnitudes.emplace_back(cpid, magnitude);
 
     m_total_magnitude += magnitude * Magnitude::SCALE_FACTOR;
@@ -859,6 +1446,115 @@ uint256 Superblock::CpidIndex::HashSegments() const
     return hasher.GetHash();
 }
 
+void Superblock::CpidIndex::BuildLookup()
+{
+    if (empty()) {
+        m_lookup.reset();
+        return;
+    }
+
+    m_lookup = std::make_shared<const Lookup>(*this);
+}
+
+// -----------------------------------------------------------------------------
+// Class: Superblock::CpidIndex::Lookup
+// -----------------------------------------------------------------------------
+
+Superblock::CpidIndex::Lookup::Key::Key(const Cpid& cpid)
+    : m_high(ReadBE64(cpid.Raw().data()))
+    , m_low(ReadBE64(cpid.Raw().data() + 8))
+{
+}
+
+Superblock::CpidIndex::Lookup::Lookup(const CpidIndex& index)
+{
+    std::vector<std::pair<Key, uint32_t>> sorted;
+    sorted.reserve(index.size());
+
+    for (const auto& iter : index) {
+        sorted.emplace_back(Key(iter.Cpid()), iter.Magnitude().Scaled());
+    }
+
+    // Each segment is sorted by CPID, but the segments are not sorted with
+    // respect to each other. A stable sort preserves the order of any CPID
+    // duplicated in a legacy superblock so that look-ups select the first:
+    //
+    std::stable_sort(
+        sorted.begin(),
+        sorted.end(),
+        [](const std::pair<Key, uint32_t>& a, const std::pair<Key, uint32_t>& b) {
+            return a.first < b.first;
+        });
+
+    // Offset zero is unused so that the children of the node at offset k sit
+    // at offsets 2k and 2k + 1:
+    //
+    m_keys.assign(sorted.size() + 1, Key(Cpid()));
+    m_magnitudes.assign(sorted.size() + 1, 0);
+
+    // Fill the tree with an in-order traversal so that the sorted entries
+    // land in breadth-first order:
+    //
+    size_t next = 0;
+    size_t k = 1;
+
+    while (next < sorted.size()) {
+        // Descend to the left-most unvisited node:
+        while (k * 2 < m_keys.size()) {
+            k *= 2;
+        }
+
+        // Visit the node and any ancestors whose left subtrees are done:
+        while (true) {
+            m_keys[k] = sorted[next].first;
+            m_magnitudes[k] = sorted[next].second;
+            ++next;
+
+            if (k * 2 + 1 < m_keys.size()) {
+                k = k * 2 + 1;
+                break;
+            }
+
+            // Climb while we are the right child of the parent:
+            while (k & 1) {
+                k >>= 1;
+            }
+
+            k >>= 1;
+
+            if (k == 0) {
+                break;
+            }
+        }
+    }
+}
+
+Magnitude Superblock::CpidIndex::Lookup::MagnitudeOf(const Cpid& cpid) const
+{
+    const Key key(cpid);
+    const size_t count = m_keys.size();
+    size_t k = 1;
+
+    while (k < count) {
+        k = 2 * k + (m_keys[k] < key);
+    }
+
+    // Cancel the trailing right turns and one left turn to recover the node
+    // of the lower bound:
+    //
+    while (k & 1) {
+        k >>= 1;
+    }
+
+    k >>= 1;
+
+    if (k == 0 || !(m_keys[k] == key)) {
+        return Magnitude::Zero();
+    }
+
+    return Magnitude::FromScaled(m_magnitudes[k]);
+}
+
 // -----------------------------------------------------------------------------
 // Class: Superblock::ProjectStats
 // -----------------------------------------------------------------------------
@@ -1019,6 +1715,12 @@ SuperblockPtr SuperblockPtr::ReadFromDisk(const CBlockIndex* const pindex)
         return Empty();
     }
 
+    const uint256 block_hash = pindex->GetBlockHash();
+
+    if (auto superblock = g_superblock_cache.Find(block_hash)) {
+        return SuperblockPtr(std::move(superblock), pindex);
+    }
+
     CBlock block;
 
     if (!block.ReadFromDisk(pindex)) {
@@ -1026,7 +1728,15 @@ SuperblockPtr SuperblockPtr::ReadFromDisk(const CBlockIndex* const pindex)
         return Empty();
     }
 
-    return block.GetSuperblock(pindex);
+    SuperblockPtr superblock = block.GetSuperblock(pindex);
+    g_superblock_cache.Store(block_hash, superblock.m_superblock, true);
+
+    return superblock;
+}
+
+void SuperblockPtr::Share(const CBlockIndex* const pindex) const
+{
+    g_superblock_cache.Store(pindex->GetBlockHash(), m_superblock, false);
 }
 
 void SuperblockPtr::Rebind(const CBlockIndex* const pindex)
@@ -6,6 +6,7 @@
 
 #include "gridcoin/cpid.h"
 #include "gridcoin/magnitude.h"
+#include "fs.h"
 #include "gridcoin/scraper/fwd.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -14,7 +15,10 @@
 #include <boost/variant/variant.hpp>
 #include <iterator>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 extern int64_t SCRAPER_CMANIFEST_RETENTION_TIME;
 
@@ -258,6 +262,16 @@ public:
     //!
     static constexpr uint32_t CURRENT_VERSION = 2;
 
+    //!
+    //! \brief Version number of the superblock format that compresses the
+    //! CPIDs. See PackCpids().
+    //!
+    //! CONSENSUS: Nodes read and write this format but do not yet create or
+    //! accept version 3 superblocks in blocks. A mandatory release activates
+    //! it by raising CURRENT_VERSION.
+    //!
+    static constexpr uint32_t COMPRESSED_CPIDS_VERSION = 3;
+
     //!
     //! \brief The maximum allowed size of a serialized superblock in bytes.
     //!
@@ -294,6 +308,36 @@ public:
         return a.first < b;
     }
 
+    //!
+    //! \brief Encode the CPIDs of a magnitude mapping for version 3+
+    //! superblocks.
+    //!
+    //! The encoding stores the first eight bytes of each CPID as Golomb-Rice
+    //! coded differences to those of the CPID before it, followed by the last
+    //! eight bytes of each CPID as they are. CPIDs spread uniformly, so this
+    //! saves around log2(N) - 2 bits of each CPID in a set of N.
+    //!
+    //! \param magnitudes CPIDs in strictly ascending order.
+    //!
+    //! \throws std::ios_base::failure If the CPIDs are out of order.
+    //!
+    static std::vector<unsigned char> PackCpids(const MagnitudeStorageType& magnitudes);
+
+    //!
+    //! \brief Decode CPIDs encoded by PackCpids().
+    //!
+    //! \param packed     Output of PackCpids().
+    //! \param count      Number of CPIDs in the packed data.
+    //! \param magnitudes Replaced by the CPIDs with zero magnitudes.
+    //!
+    //! \throws std::ios_base::failure If the data is malformed or if the CPIDs
+    //! do not ascend strictly.
+    //!
+    static void UnpackCpids(
+        const std::vector<unsigned char>& packed,
+        const uint64_t count,
+        MagnitudeStorageType& magnitudes);
+
     //!
     //! \brief A collection that maps CPIDs to magnitudes for a particular
     //! magnitude precision category.
@@ -445,6 +489,47 @@ public:
             magnitude = ReadCompactSize(stream);
         }
 
+        //!
+        //! \brief Serialize a multibyte magnitude to the provided stream in
+        //! the format of version 3+ superblocks.
+        //!
+        //! Magnitude values smaller than 16512 serialize to no more than two
+        //! bytes as a VARINT.
+        //!
+        //! \param stream    The output stream.
+        //! \param magnitude A magnitude value.
+        //!
+        template <typename Stream>
+        static void WriteCompressedMagnitude(Stream& stream, const uint16_t magnitude)
+        {
+            WriteVarInt<Stream, VarIntMode::DEFAULT, uint16_t>(stream, magnitude);
+        }
+
+        template <typename Stream>
+        static void WriteCompressedMagnitude(Stream& stream, const uint8_t magnitude)
+        {
+            WriteMagnitude(stream, magnitude);
+        }
+
+        //!
+        //! \brief Deserialize a multibyte magnitude in the format of version
+        //! 3+ superblocks from the provided stream.
+        //!
+        //! \param stream    The input stream.
+        //! \param magnitude Set to the deserialized magnitude value.
+        //!
+        template <typename Stream>
+        static void ReadCompressedMagnitude(Stream& stream, uint16_t& magnitude)
+        {
+            magnitude = ReadVarInt<Stream, VarIntMode::DEFAULT, uint16_t>(stream);
+        }
+
+        template <typename Stream>
+        static void ReadCompressedMagnitude(Stream& stream, uint8_t& magnitude)
+        {
+            ReadMagnitude(stream, magnitude);
+        }
+
         //!
         //! \brief Record the serialized size of the magnitude map.
         //!
@@ -510,6 +595,49 @@ public:
             }
         }
 
+        //!
+        //! \brief Serialize the object to the provided stream in the format
+        //! of version 3+ superblocks.
+        //!
+        //! \param stream The output stream.
+        //!
+        template<typename Stream>
+        void SerializeCompressed(Stream& stream) const
+        {
+            WriteCompactSize(stream, m_magnitudes.size());
+            stream << PackCpids(m_magnitudes);
+
+            for (const auto& cpid_pair : m_magnitudes) {
+                WriteCompressedMagnitude(stream, (MagnitudeSize)cpid_pair.second);
+            }
+        }
+
+        //!
+        //! \brief Deserialize the object from the provided stream in the
+        //! format of version 3+ superblocks.
+        //!
+        //! \param stream          The input stream.
+        //! \param total_magnitude Increased by the value of each magnitude.
+        //!
+        template<typename Stream>
+        void UnserializeCompressed(Stream& stream, uint64_t& total_magnitude)
+        {
+            const uint64_t size = ReadCompactSize(stream);
+
+            std::vector<unsigned char> packed;
+            stream >> packed;
+
+            UnpackCpids(packed, size, m_magnitudes);
+
+            for (auto& cpid_pair : m_magnitudes) {
+                MagnitudeSize magnitude;
+                ReadCompressedMagnitude(stream, magnitude);
+
+                cpid_pair.second = magnitude;
+                total_magnitude += magnitude * Scale;
+            }
+        }
+
     private:
         MagnitudeStorageType m_magnitudes; //!< Maps CPIDs to magnitude values.
     }; // MagnitudeMap
@@ -843,6 +971,15 @@ public:
         //!
         uint256 HashSegments() const;
 
+        //!
+        //! \brief Build an immutable lookup table that speeds up calls to
+        //! \c MagnitudeOf().
+        //!
+        //! Call this after the index contains every CPID. Any later change to
+        //! the index discards the table.
+        //!
+        void BuildLookup();
+
         //!
         //! \brief Serialize the object to the provided stream.
         //!
@@ -874,6 +1011,7 @@ public:
         template<typename Stream>
         void Unserialize(Stream& stream)
         {
+            m_lookup.reset();
             m_total_magnitude = 0;
 
             m_small_magnitudes.Unserialize(stream, m_total_magnitude);
@@ -883,7 +1021,97 @@ public:
             VARINT(m_zero_magnitude_count).Unserialize(stream);
         }
 
+        //!
+        //! \brief Wraps a CPID index to serialize it in the format of version
+        //! 3+ superblocks.
+        //!
+        struct Compressed
+        {
+            CpidIndex& m_index;
+
+            template<typename Stream>
+            void Serialize(Stream& stream) const
+            {
+                m_index.m_small_magnitudes.SerializeCompressed(stream);
+                m_index.m_medium_magnitudes.SerializeCompressed(stream);
+                m_index.m_large_magnitudes.SerializeCompressed(stream);
+
+                VARINT(m_index.m_zero_magnitude_count).Serialize(stream);
+            }
+
+            template<typename Stream>
+            void Unserialize(Stream& stream)
+            {
+                m_index.m_lookup.reset();
+                m_index.m_total_magnitude = 0;
+
+                m_index.m_small_magnitudes.UnserializeCompressed(stream, m_index.m_total_magnitude);
+                m_index.m_medium_magnitudes.UnserializeCompressed(stream, m_index.m_total_magnitude);
+                m_index.m_large_magnitudes.UnserializeCompressed(stream, m_index.m_total_magnitude);
+
+                VARINT(m_index.m_zero_magnitude_count).Unserialize(stream);
+            }
+        };
+
     private:
+        //!
+        //! \brief A read-only table of the magnitudes in a CPID index sorted
+        //! for fast look-ups.
+        //!
+        //! The table stores the CPIDs of every segment in one array arranged
+        //! in Eytzinger (breadth-first) order. A search visits array offsets
+        //! that tend to share cache lines at the top levels of the implicit
+        //! tree, and each step computes the next index without branching on
+        //! the result of the comparison.
+        //!
+        class Lookup
+        {
+        public:
+            //!
+            //! \brief Build the table from the entries in a CPID index.
+            //!
+            //! \param index Contains the CPIDs and magnitudes to copy.
+            //!
+            explicit Lookup(const CpidIndex& index);
+
+            //!
+            //! \brief Get the magnitude of the specified CPID.
+            //!
+            //! \param cpid The CPID to look-up the magnitude for.
+            //!
+            //! \return The CPID's magnitude or zero if the table does not
+            //! contain the CPID.
+            //!
+            Magnitude MagnitudeOf(const Cpid& cpid) const;
+
+        private:
+            //!
+            //! \brief CPID bytes packed into two big-endian integers so they
+            //! compare in the same order as \c Cpid objects.
+            //!
+            struct Key
+            {
+                uint64_t m_high;
+                uint64_t m_low;
+
+                explicit Key(const Cpid& cpid);
+
+                bool operator<(const Key& other) const
+                {
+                    return (m_high < other.m_high)
+                        | ((m_high == other.m_high) & (m_low < other.m_low));
+                }
+
+                bool operator==(const Key& other) const
+                {
+                    return (m_high == other.m_high) & (m_low == other.m_low);
+                }
+            };
+
+            std::vector<Key> m_keys;            //!< One-based, Eytzinger order.
+            std::vector<uint32_t> m_magnitudes; //!< Scaled, parallel to keys.
+        }; // Lookup
+
         //!
         //! \brief Maps external CPIDs to magnitudes for magnitudes smaller
         //! than 1. These serialize as one byte.
@@ -946,6 +1174,14 @@ public:
         //! collection instead of incrementing the zero-magnitude counter.
         //!
         bool m_legacy;
+
+        //!
+        //! \brief Speeds up magnitude look-ups for a completed index. Shared
+        //! by copies of the index.
+        //!
+        //! Not serialized--memory only.
+        //!
+        std::shared_ptr<const Lookup> m_lookup;
     }; // CpidIndex
 
     //!
@@ -1224,6 +1460,10 @@ public:
     //! transaction to provide for a greater size. It includes total credit of
     //! each project to facilitate automated greylisting.
     //!
+    //! Version 3: Compresses the CPIDs of the CPID index with PackCpids() and
+    //! serializes large magnitudes as VARINTs. The superblock hash stays the
+    //! same as for the version 2 form of the same data.
+    //!
     uint32_t m_version = CURRENT_VERSION;
 
     //!
@@ -1251,7 +1491,12 @@ public:
             READWRITE(m_manifest_content_hint);
         }
 
-        READWRITE(m_cpids);
+        if (m_version >= COMPRESSED_CPIDS_VERSION && !(s.GetType() & SER_GETHASH)) {
+            READWRITE(CpidIndex::Compressed { m_cpids });
+        } else {
+            READWRITE(m_cpids);
+        }
+
         READWRITE(m_projects);
         READWRITE(m_verified_beacons);
     }
@@ -1317,6 +1562,31 @@ public:
     //!
     static Superblock UnpackLegacy(const std::string& packed);
 
+    //!
+    //! \brief Initialize a superblock from a legacy superblock contract and
+    //! reuse the result decoded from the same contract before.
+    //!
+    //! Imports text-packed contracts from the decoded cache opened by
+    //! OpenLegacyCache() and stores the contracts decoded for the first time.
+    //! Behaves like UnpackLegacy() for other contracts or when the cache is
+    //! not open.
+    //!
+    //! \param packed Legacy superblock contract as a string of XML-like text
+    //! data and binary-packed CPID/magnitude data.
+    //!
+    //! \return A new superblock instance that contains the imported contract
+    //! statistics.
+    //!
+    static Superblock UnpackLegacyCached(const std::string& packed);
+
+    //!
+    //! \brief Open the file of decoded legacy superblocks used by
+    //! UnpackLegacyCached().
+    //!
+    //! \param path Location of the cache file in the data directory.
+    //!
+    static void OpenLegacyCache(const fs::path& path);
+
     //!
     //! \brief Pack the superblock data into a legacy superblock contract.
     //!
@@ -1408,6 +1678,8 @@ public:
         Superblock&& superblock,
         const CBlockIndex* const pindex)
     {
+        superblock.m_cpids.BuildLookup();
+
         return SuperblockPtr(
             std::make_shared<const Superblock>(std::move(superblock)),
             pindex);
@@ -1443,6 +1715,7 @@ public:
     //!
     void Replace(Superblock superblock)
     {
+        superblock.m_cpids.BuildLookup();
         m_superblock = std::make_shared<const Superblock>(std::move(superblock));
     }
 
@@ -1453,6 +1726,14 @@ public:
     //!
     void Rebind(const CBlockIndex* const pindex);
 
+    //!
+    //! \brief Share the wrapped superblock object with later calls to
+    //! \c ReadFromDisk() for the same block while the object is alive.
+    //!
+    //! \param pindex Index of the block that contains the superblock.
+    //!
+    void Share(const CBlockIndex* const pindex) const;
+
     //!
     //! \brief Get the current age of the superblock.
     //!
@@ -1470,7 +1751,13 @@ public:
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action)
     {
-        READWRITE(m_superblock);
+        if (ser_action.ForRead()) {
+            Superblock superblock;
+            READWRITE(superblock);
+            Replace(std::move(superblock));
+        } else {
+            READWRITE(m_superblock);
+        }
     }
 
 private:
@@ -1534,6 +1821,10 @@ struct hash<GRC::QuorumHash>
         // Just convert the quorum hash into a value that we can store in a
         // size_t object. The hashes are already unique identifiers.
         //
+        // CONSENSUS: Do not salt this hash. The legacy superblock quorum
+        // breaks ties between equal vote weights by the iteration order of a
+        // map keyed by these hashes, so every node must produce the same one.
+        //
         size_t out = 0;
         const unsigned char* const bytes = quorum_hash.Raw();
 
@@ -1565,6 +1856,7 @@ struct ConvergedScraperStats
         nTime = 0;
         mScraperConvergedStats = {};
         PastConvergences = {};
+        PastConvergencesBySuperblock = {};
     }
 
     ConvergedScraperStats(const int64_t nTime_in, const ConvergedManifest& Convergence) : Convergence(Convergence)
@@ -1588,6 +1880,10 @@ struct ConvergedScraperStats
     // reduced nContentHash ------ SB Hash ---- Converged Manifest object
     std::map<uint32_t, std::pair<GRC::QuorumHash, ConvergedManifest>> PastConvergences;
 
+    // Counts the past convergences above by the hash of the superblock that they produce, so that superblock
+    // validation looks up the quorum hash directly. Two convergences can produce the same superblock.
+    std::unordered_map<GRC::QuorumHash, unsigned int> PastConvergencesBySuperblock;
+
     // New superblock object and hash.
     GRC::Superblock NewFormatSuperblock;
 
@@ -1600,10 +1896,30 @@ struct ConvergedScraperStats
             // This is specifically this form of insert to insure that if there is a hint "collision" the referenced
             // SB Hash and Convergence stored will be the LATER one.
 
-            PastConvergences[nReducedContentHash] = std::make_pair(NewFormatSuperblock.GetHash(), Convergence);
+            const GRC::QuorumHash superblock_hash = NewFormatSuperblock.GetHash();
+
+            PastConvergences[nReducedContentHash] = std::make_pair(superblock_hash, Convergence);
+            ++PastConvergencesBySuperblock[superblock_hash];
         }
     }
 
+    // Returns true when the cached superblock is the one that FromConvergence() would build from the passed
+    // convergence. The content hash covers the data of every converged part, and the remaining fields decide
+    // the hints, so the stats do not need to be computed again.
+    bool IsSuperblockCurrentFor(const ConvergedManifest& convergence, const uint32_t version) const
+    {
+        return Convergence.nContentHash != uint256()
+            && Convergence.nContentHash == convergence.nContentHash
+            && Convergence.bByParts == convergence.bByParts
+            && Convergence.nUnderlyingManifestContentHash == convergence.nUnderlyingManifestContentHash
+            && NewFormatSuperblock.m_version == version;
+    }
+
+    bool HasPastConvergenceForSuperblock(const GRC::QuorumHash& superblock_hash) const
+    {
+        return PastConvergencesBySuperblock.find(superblock_hash) != PastConvergencesBySuperblock.end();
+    }
+
     unsigned int DeleteOldConvergenceFromPastConvergencesMap()
     {
         unsigned int nDeleted = 0;
@@ -1616,7 +1932,7 @@ struct ConvergedScraperStats
             // aging. The erase advances the iterator in C++11.
             if (iter->second.second.timestamp < GetAdjustedTime() - SCRAPER_CMANIFEST_RETENTION_TIME)
             {
-                iter = PastConvergences.erase(iter);
+                iter = ErasePastConvergence(iter);
 
                 ++nDeleted;
             }
@@ -1629,4 +1945,68 @@ struct ConvergedScraperStats
         return nDeleted;
     }
 
+    // Estimates the memory held by the past convergences. The parts are shared with CSplitBlob::mapParts and
+    // between convergences, so each part counts once. A past convergence keeps its parts alive after the
+    // housekeeping loop deletes the manifests, so the part data counts in full.
+    uint64_t GetPastConvergencesMemoryUsage() const
+    {
+        std::set<const CSplitBlob::CPart*> parts;
+        uint64_t nBytes = 0;
+
+        for (const auto& iter : PastConvergences)
+        {
+            const ConvergedManifest& PastConvergence = iter.second.second;
+
+            nBytes += sizeof(iter) + PastConvergence.ConvergedManifestPartPtrsMap.size() * 64;
+
+            for (const auto& part : PastConvergence.ConvergedManifestPartPtrsMap)
+            {
+                // The parts of a converged manifest are all present, so their data does not change.
+                if (part.second != nullptr && parts.insert(part.second).second)
+                {
+                    nBytes += part.second->data.size();
+                }
+            }
+        }
+
+        return nBytes;
+    }
+
+    // Deletes the oldest past convergences until the estimate above fits in nMaxBytes. Keeps the newest one
+    // so that superblocks from the last convergence still validate from the cache.
+    unsigned int TrimPastConvergencesMap(const uint64_t nMaxBytes)
+    {
+        unsigned int nDeleted = 0;
+
+        while (PastConvergences.size() > 1 && GetPastConvergencesMemoryUsage() > nMaxBytes)
+        {
+            auto oldest = PastConvergences.begin();
+
+            for (auto iter = PastConvergences.begin(); iter != PastConvergences.end(); ++iter)
+            {
+                if (iter->second.second.timestamp < oldest->second.second.timestamp) oldest = iter;
+            }
+
+            ErasePastConvergence(oldest);
+
+            ++nDeleted;
+        }
+
+        return nDeleted;
+    }
+
+private:
+    std::map<uint32_t, std::pair<GRC::QuorumHash, ConvergedManifest>>::iterator
+    ErasePastConvergence(std::map<uint32_t, std::pair<GRC::QuorumHash, ConvergedManifest>>::iterator iter)
+    {
+        const auto by_superblock = PastConvergencesBySuperblock.find(iter->second.first);
+
+        if (by_superblock != PastConvergencesBySuperblock.end() && --by_superblock->second == 0)
+        {
+            PastConvergencesBySuperblock.erase(by_superblock);
+        }
+
+        return PastConvergences.erase(iter);
+    }
+
 };
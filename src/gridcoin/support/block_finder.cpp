@@ -5,6 +5,7 @@
 #include "main.h"
 #include "gridcoin/support/block_finder.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 using namespace GRC;
@@ -15,26 +16,13 @@ BlockFinder::BlockFinder()
 
 CBlockIndex* BlockFinder::FindByHeight(int height)
 {
-    // If the height is at the bottom half of the chain, start searching from
-    // the start to the end, otherwise search backwards from the end.
-    CBlockIndex *index = height < nBestHeight / 2
-            ? pindexGenesisBlock
-            : pindexBest;
+    CBlockIndex *index = pindexBest;
 
     if(index != nullptr)
     {
-        // Use the cache if it's closer to the target than the current
-        // start block.
-        if (cache && abs(height - index->nHeight) > std::abs(height - cache->nHeight))
-            index = cache;
-
-        // Traverse towards the tail.
-        while (index && index->pprev && index->nHeight > height)
-            index = index->pprev;
-
-        // Traverse towards the head.
-        while (index && index->pnext && index->nHeight < height)
-            index = index->pnext;
+        // Clamp the height to the chain and follow the skiplist pointers
+        // back from the tip.
+        index = index->GetAncestor(std::max(0, std::min(height, index->nHeight)));
     }
 
     cache = index;
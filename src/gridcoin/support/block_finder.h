@@ -21,8 +21,8 @@ public:
     //!
     //! \brief Find a block with a specific height.
     //!
-    //! Traverses the chain from head or tail, depending on what's closest to
-    //! find the block that matches \p height. This is a caching operation
+    //! Follows the skiplist pointers back from the head of the chain to find
+    //! the block that matches \p height in logarithmic time.
     //!
     //! \param nHeight Block height to find.
     //! \return The block with the height closest to \p nHeight if found, otherwise
@@ -33,9 +33,9 @@ public:
     //!
     //! \brief Find block by time.
     //!
-    //! Traverses the chain in the same way as FindByHeight() and stops at the
-    //! block which is not older than \p time, or the youngest block if it is
-    //! older than \p time.
+    //! Traverses the chain from the head, the tail or the block last found,
+    //! depending on what's closest, and stops at the block which is not older
+    //! than \p time, or the youngest block if it is older than \p time.
     //!
     //! \param time Block time to search for.
     //! \return The youngest block which is not older than \p time, or the
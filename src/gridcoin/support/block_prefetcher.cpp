@@ -0,0 +1,99 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/support/block_prefetcher.h"
+
+#include <boost/bind.hpp>
+
+using namespace GRC;
+
+constexpr size_t BlockPrefetcher::WINDOW_SIZE; // for clang
+constexpr size_t BlockPrefetcher::MAX_THREADS; // for clang
+
+BlockPrefetcher::BlockPrefetcher(std::vector<const CBlockIndex*> blocks)
+    : m_blocks(std::move(blocks))
+    , m_slots(WINDOW_SIZE)
+    , m_next(0)
+    , m_consumed(0)
+    , m_stop(false)
+{
+    size_t thread_count = std::min<size_t>(
+        MAX_THREADS,
+        std::max(1u, boost::thread::hardware_concurrency()));
+
+    thread_count = std::min(thread_count, m_blocks.size());
+
+    for (size_t i = 0; i < thread_count; ++i) {
+        m_threads.create_thread(boost::bind(&BlockPrefetcher::ThreadRead, this));
+    }
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_space_cond.notify_all();
+    m_threads.join_all();
+}
+
+bool BlockPrefetcher::Take(CBlock& block)
+{
+    boost::unique_lock<boost::mutex> lock(m_mutex);
+    Slot& slot = m_slots[m_consumed % WINDOW_SIZE];
+
+    while (!slot.m_filled) {
+        m_ready_cond.wait(lock);
+    }
+
+    block = std::move(slot.m_block);
+    const bool loaded = slot.m_loaded;
+
+    slot.m_filled = false;
+    ++m_consumed;
+
+    lock.unlock();
+    m_space_cond.notify_all();
+
+    return loaded;
+}
+
+void BlockPrefetcher::ThreadRead()
+{
+    while (true) {
+        size_t position;
+
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+
+            while (!m_stop && m_next < m_blocks.size()
+                && m_next >= m_consumed + WINDOW_SIZE)
+            {
+                m_space_cond.wait(lock);
+            }
+
+            if (m_stop || m_next >= m_blocks.size()) {
+                return;
+            }
+
+            position = m_next++;
+        }
+
+        CBlock block;
+        const bool loaded = block.ReadFromDisk(m_blocks[position], true);
+
+        {
+            boost::unique_lock<boost::mutex> lock(m_mutex);
+            Slot& slot = m_slots[position % WINDOW_SIZE];
+
+            slot.m_block = std::move(block);
+            slot.m_loaded = loaded;
+            slot.m_filled = true;
+        }
+
+        m_ready_cond.notify_all();
+    }
+}
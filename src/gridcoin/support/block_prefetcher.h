@@ -0,0 +1,95 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include "main.h"
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <vector>
+
+namespace GRC {
+//!
+//! \brief Reads blocks from disk on background threads ahead of a consumer
+//! that processes them in order.
+//!
+//! Reading and deserializing blocks dominates the time needed for sequential
+//! scans of the chain like wallet rescans and the statistics RPCs. The
+//! prefetcher overlaps that work with the consumer's. It stays a bounded
+//! number of blocks ahead of the consumer to limit memory use.
+//!
+class BlockPrefetcher
+{
+public:
+    //!
+    //! \brief Maximum number of blocks read ahead of the consumer.
+    //!
+    static constexpr size_t WINDOW_SIZE = 64;
+
+    //!
+    //! \brief Maximum number of threads that read blocks.
+    //!
+    static constexpr size_t MAX_THREADS = 4;
+
+    //!
+    //! \brief Start reading the supplied blocks.
+    //!
+    //! \param blocks Index entries of the blocks to read, in the order that
+    //! the consumer will take them.
+    //!
+    BlockPrefetcher(std::vector<const CBlockIndex*> blocks);
+
+    //!
+    //! \brief Stop any reads in progress and wait for the threads to exit.
+    //!
+    ~BlockPrefetcher();
+
+    //!
+    //! \brief Get the number of blocks to read.
+    //!
+    size_t size() const
+    {
+        return m_blocks.size();
+    }
+
+    //!
+    //! \brief Wait for the next block in order.
+    //!
+    //! \param block Receives the block read from disk.
+    //!
+    //! \return \c false if the block failed to load.
+    //!
+    bool Take(CBlock& block);
+
+private:
+    //!
+    //! \brief A block read from disk that waits for the consumer.
+    //!
+    struct Slot
+    {
+        Slot() : m_filled(false), m_loaded(false) { }
+
+        CBlock m_block; //!< Block read for the slot.
+        bool m_filled;  //!< Whether a reader stored a block in the slot.
+        bool m_loaded;  //!< Whether the block was read successfully.
+    };
+
+    const std::vector<const CBlockIndex*> m_blocks; //!< Blocks to read.
+    std::vector<Slot> m_slots;          //!< Ring of blocks read ahead.
+    size_t m_next;                      //!< Position of the next block to read.
+    size_t m_consumed;                  //!< Number of blocks taken so far.
+    bool m_stop;                        //!< Tells the readers to exit.
+    boost::mutex m_mutex;               //!< Guards the members above.
+    boost::condition_variable m_ready_cond; //!< Signals a filled slot.
+    boost::condition_variable m_space_cond; //!< Signals a free slot.
+    boost::thread_group m_threads;      //!< Threads that read blocks.
+
+    //!
+    //! \brief Entry point for a reader thread.
+    //!
+    void ThreadRead();
+}; // BlockPrefetcher
+} // namespace GRC
@@ -0,0 +1,169 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/support/csv.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+using namespace GRC;
+
+constexpr size_t CsvReader::CHUNK_SIZE; // for clang
+
+// -----------------------------------------------------------------------------
+// Class: CsvField
+// -----------------------------------------------------------------------------
+
+double CsvField::ToDouble() const
+{
+    // Copy short fields to the stack to supply strtod() with a terminated
+    // string. Statistics fields contain a small number of digits. Parse any
+    // pathological fields through std::stod() to retain the exact behavior:
+    //
+    char buffer[64];
+
+    if (size() >= sizeof(buffer)) {
+        return std::stod(ToString());
+    }
+
+    std::memcpy(buffer, m_begin, size());
+    buffer[size()] = '\0';
+
+    // Mirrors the error handling of std::stod():
+    const int saved_errno = errno;
+    errno = 0;
+
+    char* parse_end;
+    const double value = std::strtod(buffer, &parse_end);
+
+    if (parse_end == buffer) {
+        errno = saved_errno;
+        throw std::invalid_argument("stod");
+    }
+
+    if (errno == ERANGE) {
+        throw std::out_of_range("stod");
+    }
+
+    errno = saved_errno;
+
+    return value;
+}
+
+// -----------------------------------------------------------------------------
+// Class: CsvReader
+// -----------------------------------------------------------------------------
+
+CsvReader::CsvReader(std::istream& in, const char delimiter)
+    : m_in(in)
+    , m_delimiter(delimiter)
+    , m_buffer(CHUNK_SIZE)
+    , m_pos(0)
+    , m_end(0)
+{
+}
+
+bool CsvReader::NextLine()
+{
+    size_t scan_from = m_pos;
+
+    while (true) {
+        const char* const data = m_buffer.data();
+        const char* const newline = static_cast<const char*>(
+            std::memchr(data + scan_from, '\n', m_end - scan_from));
+
+        if (newline) {
+            m_line = CsvField(data + m_pos, newline);
+            m_pos = newline - data + 1;
+
+            break;
+        }
+
+        const size_t scanned = m_end - m_pos;
+
+        if (!Fill()) {
+            // Like std::getline(), return the remaining data as the last line
+            // if the stream does not end with a newline:
+            if (m_pos == m_end) {
+                return false;
+            }
+
+            m_line = CsvField(m_buffer.data() + m_pos, m_buffer.data() + m_end);
+            m_pos = m_end;
+
+            break;
+        }
+
+        scan_from = m_pos + scanned;
+    }
+
+    Tokenize();
+
+    return true;
+}
+
+CsvField CsvReader::Line() const
+{
+    return m_line;
+}
+
+const std::vector<CsvField>& CsvReader::Fields() const
+{
+    return m_fields;
+}
+
+bool CsvReader::Fill()
+{
+    if (!m_in) {
+        return false;
+    }
+
+    // Discard the processed data at the front of the buffer:
+    if (m_pos > 0) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_pos, m_end - m_pos);
+        m_end -= m_pos;
+        m_pos = 0;
+    }
+
+    // Grow the buffer when a single line exceeds its capacity:
+    if (m_buffer.size() - m_end < CHUNK_SIZE) {
+        m_buffer.resize(m_end + CHUNK_SIZE);
+    }
+
+    m_in.read(m_buffer.data() + m_end, CHUNK_SIZE);
+    const size_t count = m_in.gcount();
+
+    m_end += count;
+
+    return count > 0;
+}
+
+void CsvReader::Tokenize()
+{
+    m_fields.clear();
+
+    const char* field_begin = m_line.begin();
+    const char* iter = field_begin;
+
+    while (iter != m_line.end()) {
+        if (*iter != m_delimiter) {
+            ++iter;
+            continue;
+        }
+
+        m_fields.emplace_back(field_begin, iter);
+
+        // Compress adjacent delimiters:
+        while (iter != m_line.end() && *iter == m_delimiter) {
+            ++iter;
+        }
+
+        field_begin = iter;
+    }
+
+    m_fields.emplace_back(field_begin, m_line.end());
+}
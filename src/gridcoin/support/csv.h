@@ -0,0 +1,125 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#pragma once
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <vector>
+
+namespace GRC {
+//!
+//! \brief A non-owning view of a field in a line read by \c CsvReader.
+//!
+//! The view references the reader's buffer and remains valid only until the
+//! next call to \c CsvReader::NextLine().
+//!
+class CsvField
+{
+public:
+    CsvField() : m_begin(nullptr), m_end(nullptr)
+    {
+    }
+
+    CsvField(const char* begin, const char* end) : m_begin(begin), m_end(end)
+    {
+    }
+
+    const char* begin() const { return m_begin; }
+    const char* end() const { return m_end; }
+    size_t size() const { return m_end - m_begin; }
+    bool empty() const { return m_begin == m_end; }
+
+    //!
+    //! \brief Copy the characters of the field into a string.
+    //!
+    std::string ToString() const
+    {
+        return std::string(m_begin, m_end);
+    }
+
+    //!
+    //! \brief Parse the field as a floating-point number.
+    //!
+    //! This behaves exactly like \c std::stod() on a string that contains the
+    //! field, but it does not allocate memory for short fields.
+    //!
+    //! \throws std::invalid_argument If the field does not begin with a number.
+    //! \throws std::out_of_range     If the number exceeds the range of double.
+    //!
+    double ToDouble() const;
+
+private:
+    const char* m_begin; //!< First character of the field.
+    const char* m_end;   //!< Character after the last character of the field.
+};
+
+//!
+//! \brief Reads delimited text from a stream line by line and splits each line
+//! into fields without allocating memory for every line or field.
+//!
+//! The reader fills an internal buffer with large chunks of the stream and
+//! tokenizes lines in place. Like \c std::getline(), it splits lines on '\n'
+//! only. Like \c boost::split() with \c boost::token_compress_on, it treats a
+//! run of adjacent delimiters as a single delimiter.
+//!
+class CsvReader
+{
+public:
+    //!
+    //! \brief Initialize a reader for the provided stream.
+    //!
+    //! \param in        Stream to read delimited text from.
+    //! \param delimiter Character that separates fields in a line.
+    //!
+    CsvReader(std::istream& in, const char delimiter = ',');
+
+    //!
+    //! \brief Advance to the next line in the stream.
+    //!
+    //! \return \c false when the stream contains no more lines.
+    //!
+    bool NextLine();
+
+    //!
+    //! \brief Get the contents of the current line.
+    //!
+    CsvField Line() const;
+
+    //!
+    //! \brief Get the fields of the current line.
+    //!
+    //! A line always contains at least one, possibly empty, field.
+    //!
+    const std::vector<CsvField>& Fields() const;
+
+private:
+    //!
+    //! \brief Size of the chunks read from the stream.
+    //!
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    std::istream& m_in;              //!< Stream to read from.
+    const char m_delimiter;          //!< Separates fields in a line.
+    std::vector<char> m_buffer;      //!< Holds unprocessed stream data.
+    size_t m_pos;                    //!< Start of the next line in the buffer.
+    size_t m_end;                    //!< End of the valid data in the buffer.
+    CsvField m_line;                 //!< The current line.
+    std::vector<CsvField> m_fields;  //!< Fields of the current line.
+
+    //!
+    //! \brief Move any unprocessed data to the front of the buffer and read
+    //! another chunk from the stream.
+    //!
+    //! \return \c false if the stream contains no more data.
+    //!
+    bool Fill();
+
+    //!
+    //! \brief Split the current line into fields.
+    //!
+    void Tokenize();
+};
+} // namespace GRC
@@ -0,0 +1,135 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/support/xml.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace GRC;
+
+constexpr size_t XmlRecordReader::CHUNK_SIZE; // for clang
+
+// -----------------------------------------------------------------------------
+// Class: XmlRecordReader
+// -----------------------------------------------------------------------------
+
+XmlRecordReader::XmlRecordReader(std::istream& in, const std::string& tag)
+    : m_in(in)
+    , m_open("<" + tag + ">")
+    , m_close("</" + tag + ">")
+    , m_buffer(CHUNK_SIZE)
+    , m_pos(0)
+    , m_end(0)
+    , m_record_begin(0)
+    , m_record_end(0)
+{
+}
+
+bool XmlRecordReader::NextRecord()
+{
+    size_t open = Find(m_open, m_pos, m_end);
+
+    // Skip the data before the next record. Retain enough of the tail of the
+    // buffer to match an opening tag split across two chunks:
+    while (open == std::string::npos) {
+        if (m_end - m_pos >= m_open.size()) {
+            m_pos = m_end - m_open.size() + 1;
+        }
+
+        if (!Fill()) {
+            return false;
+        }
+
+        open = Find(m_open, m_pos, m_end);
+    }
+
+    m_pos = open;
+
+    // Offset from the start of the record to resume the search for the
+    // closing tag from. Fill() moves the record to the front of the buffer:
+    size_t scanned = m_open.size();
+    size_t close = Find(m_close, m_pos + scanned, m_end);
+
+    while (close == std::string::npos) {
+        const size_t size = m_end - m_pos;
+
+        if (size >= m_close.size()) {
+            scanned = std::max(scanned, size - m_close.size() + 1);
+        }
+
+        if (!Fill()) {
+            return false;
+        }
+
+        close = Find(m_close, m_pos + scanned, m_end);
+    }
+
+    m_record_begin = m_pos + m_open.size();
+    m_record_end = close;
+    m_pos = close + m_close.size();
+
+    return true;
+}
+
+std::string XmlRecordReader::Field(const std::string& tag) const
+{
+    const std::string open = "<" + tag + ">";
+    const std::string close = "</" + tag + ">";
+
+    const size_t value_begin = Find(open, m_record_begin, m_record_end);
+
+    if (value_begin == std::string::npos) {
+        return "";
+    }
+
+    const size_t value_end = Find(close, value_begin + open.size(), m_record_end);
+
+    if (value_end == std::string::npos) {
+        return "";
+    }
+
+    return std::string(
+        m_buffer.data() + value_begin + open.size(),
+        m_buffer.data() + value_end);
+}
+
+size_t XmlRecordReader::Find(const std::string& tag, const size_t from, const size_t to) const
+{
+    const char* const begin = m_buffer.data() + from;
+    const char* const end = m_buffer.data() + to;
+    const char* const found = std::search(begin, end, tag.begin(), tag.end());
+
+    if (found == end) {
+        return std::string::npos;
+    }
+
+    return found - m_buffer.data();
+}
+
+bool XmlRecordReader::Fill()
+{
+    if (!m_in) {
+        return false;
+    }
+
+    // Discard the processed data at the front of the buffer:
+    if (m_pos > 0) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_pos, m_end - m_pos);
+        m_end -= m_pos;
+        m_pos = 0;
+    }
+
+    // Grow the buffer when a single record exceeds its capacity:
+    if (m_buffer.size() - m_end < CHUNK_SIZE) {
+        m_buffer.resize(m_end + CHUNK_SIZE);
+    }
+
+    m_in.read(m_buffer.data() + m_end, CHUNK_SIZE);
+    const size_t count = m_in.gcount();
+
+    m_end += count;
+
+    return count > 0;
+}
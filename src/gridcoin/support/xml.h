@@ -4,7 +4,10 @@
 
 #pragma once
 
+#include <cstddef>
+#include <istream>
 #include <string>
+#include <vector>
 
 inline std::string ExtractXML(const std::string& xml, const std::string& key, const std::string& key_end)
 {
@@ -22,3 +25,79 @@ inline std::string ExtractXML(const std::string& xml, const std::string& key, co
 
     return xml.substr(loc + (key.length()), loc_end - loc - (key.length()));
 }
+
+namespace GRC {
+//!
+//! \brief Pulls the records of a flat XML export, like the BOINC statistics
+//! files, from a stream one at a time.
+//!
+//! The reader fills an internal buffer with large chunks of the stream and
+//! scans it for the next record element without splitting the data into lines
+//! or copying the contents of a record. A caller can stop reading at any point
+//! to avoid decompressing the rest of the stream.
+//!
+//! The reader does not validate the document. It treats the text between the
+//! next opening tag and the closing tag that follows as a record, so the record
+//! elements must not nest.
+//!
+class XmlRecordReader
+{
+public:
+    //!
+    //! \brief Initialize a reader for the provided stream.
+    //!
+    //! \param in  Stream to read XML text from.
+    //! \param tag Name of the record element, like "team" for \c <team>.
+    //!
+    XmlRecordReader(std::istream& in, const std::string& tag);
+
+    //!
+    //! \brief Advance to the next record in the stream.
+    //!
+    //! \return \c false when the stream contains no more complete records.
+    //!
+    bool NextRecord();
+
+    //!
+    //! \brief Get the text of a child element of the current record.
+    //!
+    //! \param tag Name of the child element, like "name" for \c <name>.
+    //!
+    //! \return The text between the first opening tag of the child element and
+    //! the closing tag that follows, or an empty string when the record does
+    //! not contain the element.
+    //!
+    std::string Field(const std::string& tag) const;
+
+private:
+    //!
+    //! \brief Size of the chunks read from the stream.
+    //!
+    static constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    std::istream& m_in;          //!< Stream to read from.
+    const std::string m_open;    //!< Opening tag of a record element.
+    const std::string m_close;   //!< Closing tag of a record element.
+    std::vector<char> m_buffer;  //!< Holds unprocessed stream data.
+    size_t m_pos;                //!< Start of the unprocessed data.
+    size_t m_end;                //!< End of the valid data in the buffer.
+    size_t m_record_begin;       //!< Start of the current record's contents.
+    size_t m_record_end;         //!< End of the current record's contents.
+
+    //!
+    //! \brief Find a tag in the buffer.
+    //!
+    //! \return The offset of the tag or \c std::string::npos if the valid data
+    //! after \p from does not contain it.
+    //!
+    size_t Find(const std::string& tag, const size_t from, const size_t to) const;
+
+    //!
+    //! \brief Move any unprocessed data to the front of the buffer and read
+    //! another chunk from the stream.
+    //!
+    //! \return \c false if the stream contains no more data.
+    //!
+    bool Fill();
+};
+} // namespace GRC
@@ -13,7 +13,9 @@
 #include "gridcoin/quorum.h"
 #include "gridcoin/superblock.h"
 #include "gridcoin/tally.h"
+#include "memusage.h"
 #include "util.h"
+#include "util/perf.h"
 
 #include <unordered_map>
 
@@ -58,6 +60,18 @@ void RepairZeroCpidIndex(CBlockIndex* const pindex)
     }
 }
 
+//!
+//! \brief Estimate the heap memory used by a map of research accounts.
+//!
+//! The accounts live in the slabs of the map's arena, so this counts the
+//! slabs and the bucket array instead of an allocation for each account.
+//!
+size_t AccountMapUsage(const ResearchAccountMap& accounts)
+{
+    return memusage::MallocUsage(sizeof(void*) * accounts.bucket_count())
+        + accounts.get_allocator().SlabBytes();
+}
+
 //!
 //! \brief Contains the two-week network average tally used to produce the
 //! magnitude unit for legacy research age reward calculations (version 10
@@ -226,6 +240,14 @@ public:
         return ResearchAccountRange(m_researchers);
     }
 
+    //!
+    //! \brief Estimate the heap memory used by the research accounts.
+    //!
+    size_t DynamicMemoryUsage() const
+    {
+        return AccountMapUsage(m_researchers);
+    }
+
     //!
     //! \brief Get the research account for the specified CPID.
     //!
@@ -367,6 +389,17 @@ public:
         return true;
     }
 
+    //!
+    //! \brief Wait for an accrual snapshot still being written to disk in the
+    //! background.
+    //!
+    void FlushAccrualSnapshots()
+    {
+        if (!m_snapshots.FinishPendingStore()) {
+            LogPrintf("%s: the last accrual snapshot failed to store", __func__);
+        }
+    }
+
     //!
     //! \brief Switch from legacy research age accrual calculations to the
     //! superblock snapshot accrual system.
@@ -449,6 +482,67 @@ public:
         return m_snapshots.EraseAll();
     }
 
+    //!
+    //! \brief Publish a new view of the tally after a change to the account
+    //! of the specified CPID.
+    //!
+    //! This copies only the shard that contains the account.
+    //!
+    //! \param cpid The CPID of the account that changed.
+    //!
+    void PublishAccount(const Cpid& cpid)
+    {
+        const TallyViewPtr view = std::atomic_load(&m_view);
+        const size_t shard_index = TallyView::ShardOf(cpid);
+
+        TallyView::ShardArray shards = view->Shards();
+        ResearchAccountMap shard = shards[shard_index]
+            ? *shards[shard_index]
+            : ResearchAccountMap();
+
+        const auto iter = m_researchers.find(cpid);
+
+        if (iter == m_researchers.end()) {
+            shard.erase(cpid);
+        } else {
+            shard[cpid] = iter->second;
+        }
+
+        shards[shard_index] = std::make_shared<const ResearchAccountMap>(std::move(shard));
+
+        Publish(std::move(shards));
+    }
+
+    //!
+    //! \brief Publish a new view of the tally from every research account.
+    //!
+    //! Call this after changes that affect many of the accounts at once.
+    //!
+    void PublishAll()
+    {
+        std::array<ResearchAccountMap, TallyView::SHARD_COUNT> maps;
+
+        for (const auto& account_pair : m_researchers) {
+            maps[TallyView::ShardOf(account_pair.first)].emplace(account_pair);
+        }
+
+        TallyView::ShardArray shards;
+
+        for (size_t i = 0; i < TallyView::SHARD_COUNT; ++i) {
+            shards[i] = std::make_shared<const ResearchAccountMap>(std::move(maps[i]));
+        }
+
+        Publish(std::move(shards));
+    }
+
+    //!
+    //! \brief Get the most recently published view of the tally.
+    //!
+    TallyViewPtr View() const
+    {
+        return std::atomic_load(&m_view);
+    }
+
 private:
     //!
     //! \brief An empty account to return as a reference when requesting an
@@ -456,6 +550,27 @@ private:
     //!
     const ResearchAccount m_new_account;
 
+    //!
+    //! \brief The last published view of the research accounts. Access with
+    //! \c std::atomic_load() and \c std::atomic_store() only.
+    //!
+    TallyViewPtr m_view = std::make_shared<const TallyView>();
+
+    //!
+    //! \brief Replace the published view of the tally.
+    //!
+    //! \param shards The partitions of the research accounts for the view.
+    //!
+    void Publish(TallyView::ShardArray shards)
+    {
+        const uint64_t epoch = std::atomic_load(&m_view)->Epoch() + 1;
+
+        std::atomic_store(&m_view, TallyViewPtr(std::make_shared<const TallyView>(
+            epoch,
+            std::move(shards),
+            m_current_superblock)));
+    }
+
     //!
     //! \brief The set of all research accounts in the network.
     //!
@@ -682,17 +797,213 @@ private:
     }
 }; // ResearcherTally
 
+//!
+//! \brief Maintains a running sum of the research subsidy paid in each block
+//! of the main chain for legacy recount windows.
+//!
+//! A legacy recount sums the research subsidy over two weeks of blocks. This
+//! index stores the cumulative subsidy by height from the lowest height that
+//! a recount asked for, so a recount only walks the blocks added since the
+//! last one. It stores a pointer to each block to detect a reorganization and
+//! rebuilds the sums above the fork point.
+//!
+class ResearchSubsidyIndex
+{
+public:
+    //!
+    //! \brief Get the total research subsidy paid from the specified height to
+    //! a block.
+    //!
+    //! \param pindex     The highest block in the range to sum.
+    //! \param low_height The lowest block height in the range to sum.
+    //!
+    //! \return Sum of the research subsidy in units of 1/100000000 GRC.
+    //!
+    int64_t Sum(const CBlockIndex* const pindex, const int64_t low_height)
+    {
+        if (!pindex || pindex->nHeight < low_height) {
+            return 0;
+        }
+
+        if (m_blocks.empty() || low_height < m_base_height) {
+            m_base_height = low_height;
+            m_blocks.clear();
+            m_sums.clear();
+        }
+
+        Sync(pindex);
+        Trim(low_height);
+
+        const int64_t total = m_sums[pindex->nHeight - m_base_height];
+
+        if (low_height == m_base_height) {
+            return total;
+        }
+
+        return total - m_sums[low_height - 1 - m_base_height];
+    }
+
+private:
+    int64_t m_base_height = 0;                //!< Height of the first entry.
+    std::vector<const CBlockIndex*> m_blocks; //!< Indexed blocks by height.
+    std::vector<int64_t> m_sums;              //!< Cumulative subsidy by height.
+
+    //!
+    //! \brief Index the blocks in the chain of the specified block that the
+    //! index does not contain yet.
+    //!
+    //! \param pindex The highest block to index.
+    //!
+    void Sync(const CBlockIndex* pindex)
+    {
+        std::vector<const CBlockIndex*> missing;
+
+        for (; pindex && pindex->nHeight >= m_base_height; pindex = pindex->pprev) {
+            const size_t offset = pindex->nHeight - m_base_height;
+
+            if (offset < m_blocks.size() && m_blocks[offset] == pindex) {
+                break;
+            }
+
+            missing.emplace_back(pindex);
+        }
+
+        if (missing.empty()) {
+            return;
+        }
+
+        // Drop the entries above the fork point:
+        const size_t keep = missing.back()->nHeight - m_base_height;
+
+        m_blocks.resize(keep);
+        m_sums.resize(keep);
+
+        for (auto iter = missing.rbegin(); iter != missing.rend(); ++iter) {
+            const int64_t previous = m_sums.empty() ? 0 : m_sums.back();
+
+            m_blocks.emplace_back(*iter);
+            m_sums.emplace_back(previous + (*iter)->nResearchSubsidy);
+        }
+    }
+
+    //!
+    //! \brief Drop the entries that later windows no longer need once they
+    //! make up most of the index.
+    //!
+    //! The cumulative sums stay valid after removing the front entries since
+    //! a window only subtracts the sum below its lowest height.
+    //!
+    //! \param low_height The lowest block height of the current window.
+    //!
+    void Trim(const int64_t low_height)
+    {
+        const int64_t stale = low_height - 1 - m_base_height;
+
+        if (stale <= 0 || static_cast<size_t>(stale) < m_blocks.size() / 2) {
+            return;
+        }
+
+        m_blocks.erase(m_blocks.begin(), m_blocks.begin() + stale);
+        m_sums.erase(m_sums.begin(), m_sums.begin() + stale);
+        m_base_height += stale;
+    }
+}; // ResearchSubsidyIndex
+
 ResearcherTally g_researcher_tally; //!< Tracks lifetime research rewards.
 NetworkTally g_network_tally;       //!< Tracks legacy two-week network averages.
+ResearchSubsidyIndex g_research_subsidy_index; //!< Sums legacy recount subsidy.
 
 } // Anonymous namespace
 
+// -----------------------------------------------------------------------------
+// Class: TallyView
+// -----------------------------------------------------------------------------
+
+constexpr size_t TallyView::SHARD_COUNT; // for clang
+
+TallyView::TallyView() : m_epoch(0), m_superblock(SuperblockPtr::Empty())
+{
+}
+
+TallyView::TallyView(uint64_t epoch, ShardArray shards, SuperblockPtr superblock)
+    : m_epoch(epoch)
+    , m_shards(std::move(shards))
+    , m_superblock(std::move(superblock))
+{
+}
+
+size_t TallyView::ShardOf(const Cpid& cpid)
+{
+    static_assert(SHARD_COUNT == 256, "One CPID byte selects the shard.");
+
+    // CPIDs are hashes so any byte distributes the accounts evenly:
+    return cpid.Raw()[0];
+}
+
+uint64_t TallyView::Epoch() const
+{
+    return m_epoch;
+}
+
+const TallyView::ShardArray& TallyView::Shards() const
+{
+    return m_shards;
+}
+
+const SuperblockPtr& TallyView::CurrentSuperblock() const
+{
+    return m_superblock;
+}
+
+const ResearchAccount& TallyView::GetAccount(const Cpid& cpid) const
+{
+    static const ResearchAccount new_account;
+
+    const Shard& shard = m_shards[ShardOf(cpid)];
+
+    if (!shard) {
+        return new_account;
+    }
+
+    const auto iter = shard->find(cpid);
+
+    if (iter == shard->end()) {
+        return new_account;
+    }
+
+    return iter->second;
+}
+
+int64_t TallyView::GetAccrual(
+    const Cpid& cpid,
+    const int64_t payment_time,
+    const CBlockIndex* const last_block_ptr) const
+{
+    if (!last_block_ptr) {
+        return 0;
+    }
+
+    if (last_block_ptr->nVersion < 11) {
+        LOCK(cs_main);
+        return Tally::GetAccrual(cpid, payment_time, last_block_ptr);
+    }
+
+    return Tally::GetSnapshotComputer(
+        cpid,
+        GetAccount(cpid),
+        payment_time,
+        last_block_ptr,
+        m_superblock)->Accrual();
+}
+
 // -----------------------------------------------------------------------------
 // Class: Tally
 // -----------------------------------------------------------------------------
 
 bool Tally::Initialize(CBlockIndex* pindex)
 {
+    PERF_SCOPE("Tally.Initialize");
+
     if (!pindex || !IsResearchAgeEnabled(pindex->nHeight)) {
         LogPrintf("Tally initialization not needed.");
 
@@ -709,6 +1020,7 @@ bool Tally::Initialize(CBlockIndex* pindex)
     const int64_t start_time = GetTimeMillis();
 
     g_researcher_tally.Initialize(pindex, Quorum::CurrentSuperblock());
+    g_researcher_tally.PublishAll();
 
     LogPrintf(
         "Tally initialization complete. Scan time %15" PRId64 "ms\n",
@@ -727,9 +1039,13 @@ bool Tally::ActivateSnapshotAccrual(const CBlockIndex* const pindex)
     //
     Quorum::CommitSuperblock(pindex->nHeight);
 
-    return g_researcher_tally.ActivateSnapshotAccrual(
+    const bool result = g_researcher_tally.ActivateSnapshotAccrual(
         pindex,
         Quorum::CurrentSuperblock());
+
+    g_researcher_tally.PublishAll();
+
+    return result;
 }
 
 bool Tally::IsLegacyTrigger(const uint64_t height)
@@ -772,6 +1088,26 @@ const ResearchAccount& Tally::GetAccount(const Cpid cpid)
     return g_researcher_tally.GetAccount(cpid);
 }
 
+TallyViewPtr Tally::View()
+{
+    return g_researcher_tally.View();
+}
+
+size_t Tally::DynamicMemoryUsage()
+{
+    size_t usage = g_researcher_tally.DynamicMemoryUsage();
+
+    if (const TallyViewPtr view = g_researcher_tally.View()) {
+        for (const auto& shard : view->Shards()) {
+            if (shard) {
+                usage += memusage::DynamicUsage(shard) + AccountMapUsage(*shard);
+            }
+        }
+    }
+
+    return usage;
+}
+
 int64_t Tally::GetAccrual(
     const Cpid cpid,
     const int64_t payment_time,
@@ -851,12 +1187,15 @@ AccrualComputer Tally::GetLegacyComputer(
 
 void Tally::RecordRewardBlock(const CBlockIndex* const pindex)
 {
+    PERF_SCOPE("Tally.RecordRewardBlock");
+
     if (!pindex || pindex->nResearchSubsidy <= 0) {
         return;
     }
 
     if (const CpidOption cpid = pindex->GetMiningId().TryCpid()) {
         g_researcher_tally.RecordRewardBlock(*cpid, pindex);
+        g_researcher_tally.PublishAccount(*cpid);
     }
 }
 
@@ -868,21 +1207,39 @@ void Tally::ForgetRewardBlock(const CBlockIndex* const pindex)
 
     if (const CpidOption cpid = pindex->GetMiningId().TryCpid()) {
         g_researcher_tally.ForgetRewardBlock(*cpid, pindex);
+        g_researcher_tally.PublishAccount(*cpid);
     }
 }
 
 bool Tally::ApplySuperblock(SuperblockPtr superblock)
 {
-    return g_researcher_tally.ApplySuperblock(std::move(superblock));
+    PERF_SCOPE("Tally.ApplySuperblock");
+
+    const bool result = g_researcher_tally.ApplySuperblock(std::move(superblock));
+
+    g_researcher_tally.PublishAll();
+
+    return result;
+}
+
+void Tally::FlushAccrualSnapshots()
+{
+    g_researcher_tally.FlushAccrualSnapshots();
 }
 
 bool Tally::RevertSuperblock()
 {
-    return g_researcher_tally.RevertSuperblock(Quorum::CurrentSuperblock());
+    const bool result = g_researcher_tally.RevertSuperblock(Quorum::CurrentSuperblock());
+
+    g_researcher_tally.PublishAll();
+
+    return result;
 }
 
 void Tally::LegacyRecount(const CBlockIndex* pindex)
 {
+    PERF_SCOPE("Tally.LegacyRecount");
+
     if (!pindex) {
         return;
     }
@@ -914,17 +1271,17 @@ void Tally::LegacyRecount(const CBlockIndex* pindex)
         g_network_tally.ApplySuperblock(Quorum::CurrentSuperblock());
     }
 
-    int64_t total_research_subsidy = 0;
-
-    while (pindex->nHeight > min_depth) {
-        if (!pindex->pprev) {
-            return;
-        }
-
-        pindex = pindex->pprev;
-
-        total_research_subsidy += pindex->nResearchSubsidy;
+    // The window spans the blocks from the minimum depth up to the block
+    // below the head. Skip the recount if the window reaches beyond the
+    // genesis block:
+    //
+    if (min_depth < 0 || !pindex->pprev) {
+        return;
     }
 
+    const int64_t total_research_subsidy = g_research_subsidy_index.Sum(
+        pindex->pprev,
+        min_depth);
+
     g_network_tally.Reset(total_research_subsidy);
 }
@@ -6,13 +6,113 @@
 
 #include "gridcoin/account.h"
 #include "gridcoin/accrual/computer.h"
+#include "gridcoin/superblock.h"
+
+#include <array>
+#include <memory>
 
 class CBlockIndex;
 
 namespace GRC {
 
 class Cpid;
-class SuperblockPtr;
+
+//!
+//! \brief An immutable view of the research accounts in the tally.
+//!
+//! The tally publishes a new view after each change to the research accounts.
+//! A reader can hold a view and calculate snapshot accrual from it without a
+//! lock on \c cs_main, so RPC and GUI queries do not wait for block connection.
+//!
+//! The view partitions the accounts into shards by CPID. Each shard is shared
+//! by consecutive views until an account in that shard changes, so recording
+//! a reward block only copies a small fraction of the accounts.
+//!
+class TallyView
+{
+public:
+    //!
+    //! \brief Number of partitions of the research accounts.
+    //!
+    static constexpr size_t SHARD_COUNT = 256;
+
+    using Shard = std::shared_ptr<const ResearchAccountMap>;
+    using ShardArray = std::array<Shard, SHARD_COUNT>;
+
+    //!
+    //! \brief Initialize an empty view.
+    //!
+    TallyView();
+
+    //!
+    //! \brief Initialize a view of the research accounts.
+    //!
+    //! \param epoch      Increases by one for each view published.
+    //! \param shards     The partitions of the research accounts.
+    //! \param superblock The current superblock for snapshot accrual.
+    //!
+    TallyView(uint64_t epoch, ShardArray shards, SuperblockPtr superblock);
+
+    //!
+    //! \brief Get the shard that stores the account for the specified CPID.
+    //!
+    static size_t ShardOf(const Cpid& cpid);
+
+    //!
+    //! \brief Get the sequence number of the view.
+    //!
+    uint64_t Epoch() const;
+
+    //!
+    //! \brief Get the partitions of the research accounts.
+    //!
+    const ShardArray& Shards() const;
+
+    //!
+    //! \brief Get the superblock that the view calculates snapshot accrual
+    //! from.
+    //!
+    const SuperblockPtr& CurrentSuperblock() const;
+
+    //!
+    //! \brief Get the research account for the specified CPID.
+    //!
+    //! \param cpid The CPID of the account to fetch.
+    //!
+    //! \return An account that matches the CPID or a blank account if no
+    //! research reward data exists for the CPID. The reference is valid for
+    //! the lifetime of the view.
+    //!
+    const ResearchAccount& GetAccount(const Cpid& cpid) const;
+
+    //!
+    //! \brief Calculate the research reward accrual for the specified CPID.
+    //!
+    //! Snapshot accrual (block version 11+) only reads the view. For older
+    //! blocks, this defers to the legacy calculation which requires a lock
+    //! on \c cs_main.
+    //!
+    //! \param cpid           CPID to calculate research accrual for.
+    //! \param payment_time   Time of payment to calculate rewards at.
+    //! \param last_block_ptr Refers to the block for the reward.
+    //!
+    //! \return Research reward accrual in units of 1/100000000 GRC.
+    //!
+    int64_t GetAccrual(
+        const Cpid& cpid,
+        const int64_t payment_time,
+        const CBlockIndex* const last_block_ptr) const;
+
+private:
+    uint64_t m_epoch;           //!< Sequence number of the view.
+    ShardArray m_shards;        //!< Partitions of the research accounts.
+    SuperblockPtr m_superblock; //!< Supplies magnitudes for accrual.
+}; // TallyView
+
+//!
+//! \brief A published view of the research accounts.
+//!
+typedef std::shared_ptr<const TallyView> TallyViewPtr;
 
 //!
 //! \brief The core Gridcoin tally system that processes magnitudes and reward
@@ -23,7 +123,8 @@ class SuperblockPtr;
 //! build a database of research reward context for each CPID in the network.
 //!
 //! THREAD SAFETY: This tally system interacts closely with pointers to blocks
-//! in the chain index. Always lock cs_main before calling its methods.
+//! in the chain index. Always lock cs_main before calling its methods, except
+//! for View() which readers may call without the lock.
 //!
 class Tally
 {
@@ -107,6 +208,23 @@ public:
     //!
     static const ResearchAccount& GetAccount(const Cpid cpid);
 
+    //!
+    //! \brief Get the most recently published view of the research accounts.
+    //!
+    //! This does not require a lock on \c cs_main.
+    //!
+    //! \return An immutable view of the tally as of its last change.
+    //!
+    static TallyViewPtr View();
+
+    //!
+    //! \brief Estimate the heap memory used by the research accounts and the
+    //! shards of the published view.
+    //!
+    //! Older views that a reader still holds are not counted.
+    //!
+    static size_t DynamicMemoryUsage();
+
     //!
     //! \brief Calculate the research reward accrual for the specified CPID.
     //!
@@ -219,6 +337,14 @@ public:
     //!
     static bool ApplySuperblock(SuperblockPtr superblock);
 
+    //!
+    //! \brief Wait for an accrual snapshot still being written to disk in the
+    //! background.
+    //!
+    //! Call this before shutting down.
+    //!
+    static void FlushAccrualSnapshots();
+
     //!
     //! \brief Reset the account data to a state before the provided superblock.
     //!
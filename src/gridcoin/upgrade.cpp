@@ -35,6 +35,7 @@ Upgrade::Upgrade()
     DownloadStatus.SnapshotDownloadFailed = false;
     DownloadStatus.SnapshotDownloadComplete = false;
     DownloadStatus.SnapshotDownloadProgress = 0;
+    DownloadStatus.SnapshotDownloadSHA256.clear();
     ExtractStatus.SnapshotExtractFailed = false;
     ExtractStatus.SnapshotExtractComplete = false;
     ExtractStatus.SnapshotExtractProgress = 0;
@@ -293,6 +294,29 @@ bool Upgrade::VerifySHA256SUM()
         return false;
     }
 
+    std::string FileSHA256SUM = DownloadStatus.SnapshotDownloadSHA256;
+
+    // The downloader hashes the data as it arrives. Read the file again only
+    // when it came from somewhere else:
+    if (FileSHA256SUM.empty())
+        FileSHA256SUM = HashSnapshotFile();
+
+    if (FileSHA256SUM.empty())
+        return false;
+
+    if (ServerSHA256SUM == FileSHA256SUM)
+        return true;
+
+    else
+    {
+        LogPrintf("Snapshot (VerifySHA256SUM): Mismatch of sha256sum of snapshot.zip (Server = %s / File = %s)", ServerSHA256SUM, FileSHA256SUM);
+
+        return false;
+    }
+}
+
+std::string Upgrade::HashSnapshotFile()
+{
     unsigned char digest[SHA256_DIGEST_LENGTH];
 
     SHA256_CTX ctx;
@@ -306,9 +330,9 @@ bool Upgrade::VerifySHA256SUM()
 
     if (!file)
     {
-        LogPrintf("Snapshot (VerifySHA256SUM): Failed to open snapshot.zip");
+        LogPrintf("Snapshot (HashSnapshotFile): Failed to open snapshot.zip");
 
-        return false;
+        return std::string();
     }
 
     while ((bytesread = fread(buffer, 1, sizeof(buffer), file)))
@@ -321,19 +345,9 @@ bool Upgrade::VerifySHA256SUM()
     for (int i = 0; i < SHA256_DIGEST_LENGTH; i++)
         sprintf(&mdString[i*2], "%02x", (unsigned int)digest[i]);
 
-    std::string FileSHA256SUM = {mdString};
-
     fclose(file);
 
-    if (ServerSHA256SUM == FileSHA256SUM)
-        return true;
-
-    else
-    {
-        LogPrintf("Snapshot (VerifySHA256SUM): Mismatch of sha256sum of snapshot.zip (Server = %s / File = %s)", ServerSHA256SUM, FileSHA256SUM);
-
-        return false;
-    }
+    return std::string(mdString);
 }
 
 bool Upgrade::CleanupBlockchainData()
@@ -397,7 +411,9 @@ bool Upgrade::ExtractSnapshot()
     struct zip* ZipArchive;
     struct zip_file* ZipFile;
     struct zip_stat ZipStat;
-    char Buf[1024*1024];
+    // This runs on a thread with a small stack on some platforms:
+    std::vector<char> Buffer(1024*1024);
+    char* Buf = Buffer.data();
     int err;
     uint64_t i, j;
     int64_t entries, len, sum;
@@ -411,7 +427,7 @@ bool Upgrade::ExtractSnapshot()
 
         if (ZipArchive == nullptr)
         {
-            zip_error_to_str(Buf, sizeof(Buf), err, errno);
+            zip_error_to_str(Buf, Buffer.size(), err, errno);
 
             ExtractStatus.SnapshotExtractFailed = true;
 
@@ -484,7 +500,7 @@ bool Upgrade::ExtractSnapshot()
                     {
                         boost::this_thread::interruption_point();
 
-                        len = zip_fread(ZipFile, Buf, 1024*1024);
+                        len = zip_fread(ZipFile, Buf, Buffer.size());
 
                         if (len < 0)
                         {
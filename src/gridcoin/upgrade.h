@@ -77,10 +77,21 @@ public:
     //!
     //! \brief Verify the SHA256SUM of snapshot.zip against snapshot.zip.sha256sum on gridcoin.us
     //!
+    //! Uses the hash computed during the download when available so that the
+    //! file need not be read again.
+    //!
     //! \return Bool on the success of matching SHA256SUM
     //!
     static bool VerifySHA256SUM();
 
+    //!
+    //! \brief Hash snapshot.zip on disk.
+    //!
+    //! \return The SHA256 of the file in hex, or an empty string if the file
+    //! cannot be opened.
+    //!
+    static std::string HashSnapshotFile();
+
     //!
     //! \brief Small function to delete the snapshot.zip file
     //!
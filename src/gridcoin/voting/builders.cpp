@@ -500,15 +500,15 @@ public:
             return;
         }
 
-        const boost::optional<uint256> beacon_txid = FindBeaconTxid(*beacon);
-
-        if (!beacon_txid) {
+        // The beacon registry records the transaction that advertised or last
+        // renewed the beacon:
+        if (beacon->m_txid.IsNull()) {
             LogPrint(LogFlags::VOTE, "%s: beacon tx not found", __func__);
             return;
         }
 
         claim.m_mining_id = m_researcher->Id();
-        claim.m_beacon_txid = *beacon_txid;
+        claim.m_beacon_txid = beacon->m_txid;
     }
 
     //!
@@ -558,60 +558,6 @@ public:
 private:
     const CWallet& m_wallet;          //!< Supplies the private signing key.
     const ResearcherPtr m_researcher; //!< Supplies beacon/magnitude context.
-
-    //!
-    //! \brief Get the hash of the transaction that contains the contract for
-    //! the beacon used to sign the claim.
-    //!
-    //! \param beacon The beacon used to sign the claim for matching to the
-    //! transaction.
-    //!
-    //! \return The hash of the transaction for the beacon contract if found.
-    //!
-    boost::optional<uint256> FindBeaconTxid(const Beacon& beacon) const
-    {
-        // TODO: This is rather slow, but we only need to do it once per vote.
-        // Store a reference to a wallet's beacon transactions and rewrite the
-        // lookup to avoid the chain scan:
-
-        const CBlockIndex* pindex = pindexBest;
-
-        if (!pindex) {
-            return boost::none;
-        }
-
-        const int64_t max_time = FutureDrift(beacon.m_timestamp, 0);
-        const int64_t min_time = pindex->nTime - Beacon::MAX_AGE;
-        CBlock block;
-
-        for (; pindex && pindex->nTime > max_time; pindex = pindex->pprev);
-
-        for (; pindex && pindex->nTime > min_time; pindex = pindex->pprev) {
-            if (pindex->nIsContract != 1) {
-                continue;
-            }
-
-            if (!block.ReadFromDisk(pindex)) {
-                break;
-            }
-
-            for (const auto& tx : block.vtx) {
-                for (const auto& contract : tx.GetContracts()) {
-                    if (contract.m_type != ContractType::BEACON) {
-                        continue;
-                    }
-
-                    auto payload = contract.SharePayloadAs<BeaconPayload>();
-
-                    if (payload->m_beacon.m_public_key == beacon.m_public_key) {
-                        return tx.GetHash();
-                    }
-                }
-            }
-        }
-
-        return boost::none;
-    }
 }; // MagnitudeClaimBuilder
 
 //!
@@ -3,9 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "main.h"
+#include "memusage.h"
+#include "streams.h"
 #include "gridcoin/contract/contract.h"
 #include "gridcoin/voting/payloads.h"
 #include "gridcoin/voting/registry.h"
+#include "gridcoin/voting/result.h"
 #include "gridcoin/voting/vote.h"
 #include "txdb.h"
 #include "ui_interface.h"
@@ -230,11 +233,17 @@ PollReference::PollReference()
     , m_ptitle(nullptr)
     , m_timestamp(0)
     , m_duration_days(0)
+    , m_result_tip(nullptr)
+    , m_result_final(false)
 {
 }
 
 PollOption PollReference::TryReadFromDisk(CTxDB& txdb) const
 {
+    if (m_poll) {
+        return *m_poll;
+    }
+
     CTransaction tx;
 
     if (!txdb.ReadDiskTx(*m_ptxid, tx)) {
@@ -247,6 +256,8 @@ PollOption PollReference::TryReadFromDisk(CTxDB& txdb) const
             auto payload = contract.PullPayloadAs<PollPayload>();
             payload.m_poll.m_timestamp = m_timestamp;
 
+            m_poll = std::make_shared<const Poll>(payload.m_poll);
+
             return std::move(payload.m_poll);
         }
     }
@@ -258,6 +269,10 @@ PollOption PollReference::TryReadFromDisk(CTxDB& txdb) const
 
 PollOption PollReference::TryReadFromDisk() const
 {
+    if (m_poll) {
+        return *m_poll;
+    }
+
     CTxDB txdb("r");
 
     return TryReadFromDisk(txdb);
@@ -305,10 +320,13 @@ int64_t PollReference::Expiration() const
 void PollReference::LinkVote(const uint256 txid)
 {
     m_votes.emplace_back(txid);
+    m_result.reset();
 }
 
 void PollReference::UnlinkVote(const uint256 txid)
 {
+    m_result.reset();
+
     for (auto it = m_votes.crbegin(), end = m_votes.crend(); it != end; ++it) {
         if (*it == txid) {
             m_votes.erase(std::next(it).base());
@@ -317,6 +335,26 @@ void PollReference::UnlinkVote(const uint256 txid)
     }
 }
 
+const PollResult* PollReference::TryCachedResult() const
+{
+    if (!m_result || !m_result_tip || !m_result_tip->IsInMainChain()) {
+        return nullptr;
+    }
+
+    if (!m_result_final && m_result_tip != pindexBest) {
+        return nullptr;
+    }
+
+    return m_result.get();
+}
+
+void PollReference::CacheResult(PollResult result, const bool final) const
+{
+    m_result = std::make_shared<const PollResult>(std::move(result));
+    m_result_tip = pindexBest;
+    m_result_final = final;
+}
+
 // -----------------------------------------------------------------------------
 // Class: PollRegistry
 // -----------------------------------------------------------------------------
@@ -326,6 +364,27 @@ const PollRegistry::Sequence PollRegistry::Polls() const
     return Sequence(m_polls);
 }
 
+size_t PollRegistry::DynamicMemoryUsage() const
+{
+    size_t usage = memusage::DynamicUsage(m_polls) + memusage::DynamicUsage(m_polls_by_txid);
+
+    for (const auto& poll_pair : m_polls) {
+        const PollReference& ref = poll_pair.second;
+
+        usage += memusage::DynamicUsage(poll_pair.first)
+            + memusage::DynamicUsage(ref.m_votes)
+            + memusage::DynamicUsage(ref.m_result);
+
+        // The serialized size approximates the strings and the choices:
+        if (ref.m_poll) {
+            usage += memusage::DynamicUsage(ref.m_poll)
+                + GetSerializeSize(*ref.m_poll, SER_NETWORK, PROTOCOL_VERSION);
+        }
+    }
+
+    return usage;
+}
+
 const PollReference* PollRegistry::TryLatestActive() const
 {
     if (m_latest_poll && !m_latest_poll->Expired(GetAdjustedTime())) {
@@ -435,6 +494,46 @@ void PollRegistry::Delete(const ContractContext& ctx)
     }
 }
 
+void PollRegistry::WriteSnapshot(CDataStream& stream) const
+{
+    WriteCompactSize(stream, m_polls.size());
+
+    for (const auto& poll_pair : m_polls) {
+        const PollReference& poll_ref = poll_pair.second;
+
+        stream << poll_pair.first
+            << poll_ref.Txid()
+            << poll_ref.m_timestamp
+            << poll_ref.m_duration_days
+            << poll_ref.m_votes;
+    }
+}
+
+void PollRegistry::ReadSnapshot(CDataStream& stream)
+{
+    Reset();
+
+    for (uint64_t count = ReadCompactSize(stream); count > 0; --count) {
+        std::string title;
+        uint256 txid;
+        PollReference poll;
+
+        stream >> title >> txid >> poll.m_timestamp >> poll.m_duration_days >> poll.m_votes;
+
+        auto result_pair = m_polls.emplace(std::move(title), std::move(poll));
+
+        if (!result_pair.second) {
+            continue;
+        }
+
+        PollReference& poll_ref = result_pair.first->second;
+        poll_ref.m_ptitle = &result_pair.first->first;
+
+        auto txid_pair = m_polls_by_txid.emplace(txid, &poll_ref);
+        poll_ref.m_ptxid = &txid_pair.first->first;
+    }
+}
+
 void PollRegistry::AddPoll(const ContractContext& ctx)
 {
     const auto payload = ctx->SharePayloadAs<PollPayload>();
@@ -454,6 +553,10 @@ void PollRegistry::AddPoll(const ContractContext& ctx)
         poll_ref.m_timestamp = ctx.m_tx.nTime;
         poll_ref.m_duration_days = payload->m_poll.m_duration_days;
 
+        Poll poll = payload->m_poll;
+        poll.m_timestamp = ctx.m_tx.nTime;
+        poll_ref.m_poll = std::make_shared<const Poll>(std::move(poll));
+
         m_latest_poll = &poll_ref;
 
         auto result_pair = m_polls_by_txid.emplace(ctx.m_tx.GetHash(), &poll_ref);
@@ -7,6 +7,10 @@
 #include "gridcoin/contract/handler.h"
 #include "gridcoin/voting/fwd.h"
 
+#include <memory>
+
+class CBlockIndex;
+class CDataStream;
 class CTxDB;
 
 namespace GRC {
@@ -22,7 +26,9 @@ class PollRegistry;
 //! contracts to avoid consuming memory to maintain this state.
 //!
 //! This class associates votes with polls and contains the transaction hash
-//! used to locate and load the poll contract from disk.
+//! used to locate and load the poll contract from disk. It keeps a copy of
+//! the poll body itself--a few kilobytes at most--so that listing polls does
+//! not read and deserialize every poll transaction for each request.
 //!
 class PollReference
 {
@@ -35,14 +41,18 @@ public:
     PollReference();
 
     //!
-    //! \brief Load the associated poll object from disk.
+    //! \brief Load the associated poll object.
+    //!
+    //! This reads the poll from disk only when the reference does not hold a
+    //! copy of the poll yet, such as after loading a contract state snapshot,
+    //! and then keeps the poll for later calls.
     //!
     //! \return An object that contains the associated poll if successful.
     //!
     PollOption TryReadFromDisk(CTxDB& txdb) const;
 
     //!
-    //! \brief Load the associated poll object from disk.
+    //! \brief Load the associated poll object.
     //!
     //! \return An object that contains the associated poll if successful.
     //!
@@ -105,12 +115,57 @@ public:
     //!
     void UnlinkVote(const uint256 txid);
 
+    //!
+    //! \brief Get the result counted for the poll by an earlier query if it
+    //! remains valid for the current chain.
+    //!
+    //! A cached result expires when a vote links to or unlinks from the poll
+    //! or when the block that was the chain tip at the time of counting leaves
+    //! the main chain. Results for active polls also expire when a new block
+    //! connects because the voting weight depends on the latest superblock,
+    //! money supply, and the state of claimed outputs.
+    //!
+    //! \return Points to the cached result or \c nullptr when the result must
+    //! be counted again.
+    //!
+    const PollResult* TryCachedResult() const;
+
+    //!
+    //! \brief Store the counted result of the poll for subsequent queries.
+    //!
+    //! \param result The result counted for the current chain tip.
+    //! \param final  Whether blocks connected after the current tip cannot
+    //! change the result. True for finished polls.
+    //!
+    void CacheResult(PollResult result, const bool final) const;
+
 private:
     const uint256* m_ptxid;       //!< Hash of the poll transaction.
     const std::string* m_ptitle;  //!< Title of the poll.
     int64_t m_timestamp;          //!< Timestamp of the poll transaction.
     uint32_t m_duration_days;     //!< Number of days the poll remains active.
     std::vector<uint256> m_votes; //!< Hashes of the linked vote transactions.
+
+    //!
+    //! \brief Body of the poll contract, loaded on demand for references
+    //! restored from a contract state snapshot.
+    //!
+    mutable std::shared_ptr<const Poll> m_poll;
+
+    //!
+    //! \brief Result counted by the last query for the poll.
+    //!
+    mutable std::shared_ptr<const PollResult> m_result;
+
+    //!
+    //! \brief Chain tip at the time that the cached result was counted.
+    //!
+    mutable const CBlockIndex* m_result_tip;
+
+    //!
+    //! \brief Whether new blocks cannot change the cached result.
+    //!
+    mutable bool m_result_final;
 }; // PollReference
 
 //!
@@ -118,7 +173,8 @@ private:
 //!
 //! THREAD SAFETY: This API uses the transaction database to read poll and vote
 //! contracts from disk. Always lock \c cs_main for the poll registry, for poll
-//! references, and for iterator lifetimes.
+//! references, and for iterator lifetimes. Poll references cache the results
+//! of poll queries under the same lock.
 //!
 class PollRegistry : public IContractHandler
 {
@@ -251,6 +307,14 @@ public:
     //!
     const Sequence Polls() const;
 
+    //!
+    //! \brief Estimate the heap memory used by the registry.
+    //!
+    //! \return Bytes used by the poll references, their vote hashes and the
+    //! cached poll objects.
+    //!
+    size_t DynamicMemoryUsage() const;
+
     //!
     //! \brief Get the most recent poll submitted to the network.
     //!
@@ -309,6 +373,23 @@ public:
     //!
     void Delete(const ContractContext& ctx) override;
 
+    //!
+    //! \brief Serialize the poll references and linked votes for a contract
+    //! state snapshot.
+    //!
+    //! \param stream Receives the serialized registry state.
+    //!
+    void WriteSnapshot(CDataStream& stream) const;
+
+    //!
+    //! \brief Replace the registry state with poll references from a contract
+    //! state snapshot.
+    //!
+    //! \param stream Contains the registry state serialized by
+    //! \c WriteSnapshot().
+    //!
+    void ReadSnapshot(CDataStream& stream);
+
 private:
     PollMapByTitle m_polls;             //!< Poll references keyed by title.
     PollMapByTxid m_polls_by_txid;      //!< Poll references keyed by TXID.
@@ -11,10 +11,15 @@
 #include "gridcoin/voting/poll.h"
 #include "gridcoin/voting/vote.h"
 #include "txdb.h"
-#include "util/reverse_iterator.h"
+#include "util/hasher.h"
+#include "util/memory.h"
+#include "util/threadpool.h"
 
+#include <atomic>
 #include <boost/optional.hpp>
+#include <boost/thread.hpp>
 #include <queue>
+#include <thread>
 #include <unordered_set>
 
 using namespace GRC;
@@ -40,17 +45,6 @@ public:
     }
 };
 
-//!
-//! \brief Hashes \c COutPoint objects to key a lookup table.
-//!
-struct OutPointHasher
-{
-    size_t operator()(const COutPoint& outpoint) const
-    {
-        return outpoint.hash.GetUint64() + outpoint.n;
-    }
-};
-
 //!
 //! \brief Contains an unprocesseed vote contract for a poll extracted from a
 //! transaction.
@@ -109,10 +103,56 @@ public:
         return PackVoteMessage(Vote(), m_tx);
     }
 
+    //!
+    //! \brief Serialize the vote message and verify the signatures of the
+    //! address claims in the vote.
+    //!
+    //! Signature verification dominates the cost of resolving the balance
+    //! claims in a vote. The vote counter calls this method concurrently
+    //! for each candidate before it resolves the claims of every vote in
+    //! order. The result does not depend on the other votes in the poll.
+    //!
+    //! Used for non-legacy vote contracts only.
+    //!
+    void Prepare()
+    {
+        m_message = PackMessage();
+
+        for (const auto& claim : Vote().m_claim.m_balance_claim.m_address_claims) {
+            m_valid_address_claims.emplace_back(claim.VerifySignature(m_message));
+        }
+    }
+
+    //!
+    //! \brief Get the vote message serialized by \c Prepare().
+    //!
+    const ClaimMessage& Message() const
+    {
+        return m_message;
+    }
+
+    //!
+    //! \brief Determine whether the signature of an address claim is valid.
+    //!
+    //! \param offset Offset of the address claim in the vote's balance claim.
+    //!
+    //! \return \c true if \c Prepare() verified the address claim signature.
+    //!
+    bool ValidAddressClaim(const size_t offset) const
+    {
+        return offset < m_valid_address_claims.size() && m_valid_address_claims[offset];
+    }
+
 private:
     const CTransaction m_tx;         //!< Transaction that contains a vote.
     const Contract& m_contract;      //!< The vote contract.
     const ContractPayload m_payload; //!< Contains the body of the vote.
+    ClaimMessage m_message;          //!< Serialized vote for claim checks.
+
+    //!
+    //! \brief Signature verification result for each address claim.
+    //!
+    std::vector<bool> m_valid_address_claims;
 }; // VoteCandidate
 
 //!
@@ -155,14 +195,13 @@ public:
     VoteDetail Resolve(const VoteCandidate& candidate)
     {
         const Vote& vote = candidate.Vote();
-        const ClaimMessage message = candidate.PackMessage();
 
         VoteDetail detail;
-        detail.m_amount = Resolve(vote.m_claim.m_balance_claim, message);
+        detail.m_amount = Resolve(vote.m_claim.m_balance_claim, candidate);
 
         if (m_poll.IncludesMagnitudeWeight()) {
             detail.m_mining_id = vote.m_claim.m_magnitude_claim.m_mining_id;
-            detail.m_magnitude = Resolve(vote.m_claim.m_magnitude_claim, message);
+            detail.m_magnitude = Resolve(vote.m_claim.m_magnitude_claim, candidate.Message());
         }
 
         return detail;
@@ -177,7 +216,7 @@ private:
     //! \brief Remembers the outputs claimed by a vote contract for balance
     //! claims to filter duplicate weight claims.
     //!
-    std::unordered_set<COutPoint, OutPointHasher> m_seen_txos;
+    std::unordered_set<COutPoint, SaltedOutPointHasher> m_seen_txos;
 
     //!
     //! \brief Remembers the CPID claimed by a vote contract for magnitude
@@ -279,17 +318,17 @@ private:
     //!
     //! \brief Resolve the claimed balance for a vote.
     //!
-    //! \param claim   The claim to resolve balance weight for.
-    //! \param message Serialized context for vote signature verification.
+    //! \param claim     The claim to resolve balance weight for.
+    //! \param candidate Contains the verified address claim signatures.
     //!
     //! \return Claimed amount in units of 1/100000000 GRC.
     //!
-    int64_t Resolve(const BalanceClaim& claim, const ClaimMessage& message)
+    int64_t Resolve(const BalanceClaim& claim, const VoteCandidate& candidate)
     {
         int64_t amount = 0;
 
-        for (const auto& address_claim : claim.m_address_claims) {
-            amount += Resolve(address_claim, message);
+        for (size_t i = 0; i < claim.m_address_claims.size(); ++i) {
+            amount += Resolve(claim.m_address_claims[i], candidate.ValidAddressClaim(i));
         }
 
         return amount;
@@ -298,17 +337,17 @@ private:
     //!
     //! \brief Resolve the claimed balance for an address.
     //!
-    //! \param claim   The claim to resolve balance weight for.
-    //! \param message Serialized context for vote signature verification.
+    //! \param claim           The claim to resolve balance weight for.
+    //! \param valid_signature Whether the claim signature passed verification.
     //!
     //! \return Claimed amount in units of 1/100000000 GRC.
     //!
     //! \throws InvalidVoteError If the vote fails to validate or if an IO
     //! error occurs.
     //!
-    int64_t Resolve(const AddressClaim& claim, const ClaimMessage& message)
+    int64_t Resolve(const AddressClaim& claim, const bool valid_signature)
     {
-        if (!claim.VerifySignature(message)) {
+        if (!valid_signature) {
             LogPrint(LogFlags::VOTE, "%s: bad address signature", __func__);
             throw InvalidVoteError();
         }
@@ -316,8 +355,25 @@ private:
         const CTxDestination address = claim.m_public_key.GetID();
         int64_t amount = 0;
 
+        std::vector<uint256> txids;
+        std::map<uint256, CTxIndex> tx_indexes;
+
+        txids.reserve(claim.m_outpoints.size());
+
         for (const auto& txo : claim.m_outpoints) {
-            amount += Resolve(txo, address);
+            txids.emplace_back(txo.hash);
+        }
+
+        // Voters may claim hundreds of outputs. Fetch the index entries for
+        // all of them at once rather than reading the database for each:
+        //
+        if (!m_txdb.ReadTxIndexes(txids, tx_indexes)) {
+            error("%s: failed to read tx indexes", __func__);
+            throw InvalidVoteError();
+        }
+
+        for (const auto& txo : claim.m_outpoints) {
+            amount += Resolve(txo, address, tx_indexes);
         }
 
         return amount;
@@ -326,28 +382,34 @@ private:
     //!
     //! \brief Resolve the claimed amount for an output.
     //!
-    //! \param txo     Refers to the output to resolve balance weight for.
-    //! \param address Must match the address of the resolved output.
+    //! \param txo        Refers to the output to resolve balance weight for.
+    //! \param address    Must match the address of the resolved output.
+    //! \param tx_indexes Index entries prefetched for the claimed outputs.
     //!
     //! \return Claimed amount in units of 1/100000000 GRC.
     //!
     //! \throws InvalidVoteError If the vote fails to validate or if an IO
     //! error occurs.
     //!
-    int64_t Resolve(const COutPoint& txo, const CTxDestination& address)
+    int64_t Resolve(
+        const COutPoint& txo,
+        const CTxDestination& address,
+        const std::map<uint256, CTxIndex>& tx_indexes)
     {
         if (m_seen_txos.find(txo) != m_seen_txos.end()) {
             LogPrint(LogFlags::VOTE, "%s: duplicate txo", __func__);
             return 0;
         }
 
-        CTxIndex tx_index;
+        const auto tx_index_iter = tx_indexes.find(txo.hash);
 
-        if (!m_txdb.ReadTxIndex(txo.hash, tx_index)) {
+        if (tx_index_iter == tx_indexes.end()) {
             LogPrint(LogFlags::VOTE, "%s: failed to read tx index", __func__);
             return 0;
         }
 
+        const CTxIndex& tx_index = tx_index_iter->second;
+
         CAutoFile file(OpenBlockFile(tx_index.pos), SER_DISK, CLIENT_VERSION);
 
         if (file.IsNull()) {
@@ -720,6 +782,7 @@ public:
         , m_poll(poll)
         , m_resolver(txdb, poll)
         , m_legacy(poll)
+        , m_counted_legacy(false)
     {
     }
 
@@ -770,15 +833,24 @@ public:
     //!
     void CountVotes(PollResult& result, const std::vector<uint256>& vote_txids)
     {
+        const std::vector<CandidatePtr> candidates = FetchVoteCandidates(vote_txids);
+
         m_votes.reserve(vote_txids.size());
 
-        for (const auto& txid : reverse_iterate(vote_txids)) {
+        // Resolve the votes from newest to oldest. Voting weight claims that
+        // overlap with a newer vote do not count towards an older vote:
+        //
+        for (size_t i = vote_txids.size(); i-- > 0;) {
             try {
-                ProcessVoteCandidate(FetchVoteCandidate(txid));
+                if (!candidates[i]) {
+                    throw InvalidVoteError();
+                }
+
+                ProcessVoteCandidate(*candidates[i]);
             } catch (const InvalidVoteError& e) {
                 LogPrint(LogFlags::VOTE, "%s: skipped invalid vote: %s",
                     __func__,
-                    txid.ToString());
+                    vote_txids[i].ToString());
 
                 ++result.m_invalid_votes;
             }
@@ -789,13 +861,90 @@ public:
         }
     }
 
+    //!
+    //! \brief Determine whether the counter tallied any legacy votes.
+    //!
+    //! Legacy vote weight depends on the superblock and money supply at the
+    //! chain tip rather than in the poll window.
+    //!
+    bool CountedLegacyVotes() const
+    {
+        return m_counted_legacy;
+    }
+
 private:
+    //!
+    //! \brief Owns a vote candidate. A candidate refers to the contract in
+    //! its transaction, so it cannot move once constructed.
+    //!
+    using CandidatePtr = std::unique_ptr<VoteCandidate>;
+
+    //!
+    //! \brief Maximum number of threads that load and verify vote contracts.
+    //!
+    static constexpr size_t MAX_THREADS = 8;
+
     CTxDB& m_txdb;
     const Poll& m_poll;
     std::vector<VoteDetail> m_votes;
     Weight m_magnitude_factor;
     VoteResolver m_resolver;
     LegacyVoteCounterContext m_legacy;
+    bool m_counted_legacy;
+
+    //!
+    //! \brief Load and prepare the vote candidates for the specified votes.
+    //!
+    //! Reading each vote transaction from disk and checking the signatures of
+    //! its claims does not depend on the other votes, so this spreads the work
+    //! over a bounded set of threads. Each thread reads from its own database
+    //! handle. The order of the results matches the order of the supplied vote
+    //! hashes so that the vote counter resolves overlapping weight claims the
+    //! same way regardless of the number of threads.
+    //!
+    //! \param vote_txids Hashes of the transactions that contain the votes.
+    //!
+    //! \return A candidate for each vote at the same offset as its hash, or
+    //! an empty pointer for a vote that failed to load.
+    //!
+    std::vector<CandidatePtr> FetchVoteCandidates(const std::vector<uint256>& vote_txids)
+    {
+        std::vector<CandidatePtr> candidates(vote_txids.size());
+        std::atomic<size_t> next_vote(0);
+
+        const auto worker = [&](CTxDB& txdb) {
+            for (size_t i = next_vote++; i < vote_txids.size(); i = next_vote++) {
+                try {
+                    candidates[i] = FetchVoteCandidate(txdb, vote_txids[i]);
+
+                    if (!candidates[i]->IsLegacy()) {
+                        candidates[i]->Prepare();
+                    }
+                } catch (const InvalidVoteError& e) {
+                    candidates[i].reset();
+                }
+            }
+        };
+
+        const size_t thread_count = std::min<size_t>(
+            std::max<size_t>(boost::thread::hardware_concurrency(), 1),
+            std::min(vote_txids.size(), MAX_THREADS));
+
+        const std::thread::id caller_id = std::this_thread::get_id();
+
+        // The calling thread takes a share of the work too, with the handle of
+        // the counter:
+        util::ParallelFor(util::Executor::IO, thread_count, [&](size_t) {
+            if (std::this_thread::get_id() == caller_id) {
+                worker(m_txdb);
+            } else {
+                CTxDB txdb("r");
+                worker(txdb);
+            }
+        });
+
+        return candidates;
+    }
 
     //!
     //! \brief Read a vote contract from disk for the specified transaction.
@@ -804,6 +953,7 @@ private:
     //! changes, we need to update this class to process all of the votes in
     //! each transaction.
     //!
+    //! \param txdb Database handle used to read the transaction.
     //! \param txid Hash of the transaction that contains the vote to load
     //! from disk.
     //!
@@ -812,11 +962,11 @@ private:
     //! \throws InvalidVoteError When the referenced transaction does not
     //! contain a well-formed vote contract.
     //!
-    VoteCandidate FetchVoteCandidate(const uint256 txid)
+    CandidatePtr FetchVoteCandidate(CTxDB& txdb, const uint256 txid) const
     {
         CTransaction tx;
 
-        if (!m_txdb.ReadDiskTx(txid, tx)) {
+        if (!txdb.ReadDiskTx(txid, tx)) {
             LogPrint(LogFlags::VOTE, "%s: failed to read vote tx", __func__);
             throw InvalidVoteError();
         }
@@ -841,7 +991,7 @@ private:
                 continue;
             }
 
-            return VoteCandidate(contract, std::move(tx));
+            return MakeUnique<VoteCandidate>(contract, std::move(tx));
         }
 
         LogPrint(LogFlags::VOTE, "%s: tx has no vote contract", __func__);
@@ -927,6 +1077,7 @@ private:
 
         m_votes.emplace_back(std::move(detail));
         m_legacy.RememberKey(vote.m_key);
+        m_counted_legacy = true;
     }
 
     //!
@@ -981,6 +1132,8 @@ private:
     }
 }; // VoteCounter
 
+constexpr size_t VoteCounter::MAX_THREADS; // for clang
+
 //!
 //! \brief Fetch the superblock used to calculate magnitude weight for the
 //! specified poll.
@@ -997,14 +1150,12 @@ SuperblockPtr ResolveSuperblockForPoll(const Poll& poll)
         return superblock;
     }
 
-    const CBlockIndex* pindex = pindexBest;
-
-    // Seek past the current superblock:
-    for (; pindex && pindex->nHeight >= superblock.m_height; pindex = pindex->pprev);
-
     // Find the superblock active at the end of the poll:
-    for (; pindex; pindex = pindex->pprev) {
-        if (pindex->nIsSuperBlock != 1 || poll.Expired(pindex->nTime)) {
+    for (const CBlockIndex* pindex = Quorum::FindSuperblockBefore(superblock.m_height);
+        pindex;
+        pindex = Quorum::FindSuperblockBefore(pindex->nHeight))
+    {
+        if (poll.Expired(pindex->nTime)) {
             continue;
         }
 
@@ -1035,7 +1186,7 @@ int64_t ResolveMoneySupplyForPoll(const Poll& poll)
 
     for (; pindex && pindex->nTime > poll_expiration; pindex = pindex->pprev);
 
-    return pindex->nTime;
+    return pindex ? pindex->nMoneySupply : 0;
 }
 } // Anonymous namespace
 
@@ -1073,6 +1224,10 @@ PollResult::PollResult(Poll poll)
 
 PollResultOption PollResult::BuildFor(const PollReference& poll_ref)
 {
+    if (const PollResult* cached_result = poll_ref.TryCachedResult()) {
+        return *cached_result;
+    }
+
     if (PollOption poll = poll_ref.TryReadFromDisk()) {
         CTxDB txdb("r");
         PollResult result(std::move(*poll));
@@ -1086,6 +1241,12 @@ PollResultOption PollResult::BuildFor(const PollReference& poll_ref)
 
         counter.CountVotes(result, poll_ref.Votes());
 
+        poll_ref.CacheResult(
+            result,
+            pindexBest
+                && result.m_poll.Expired(pindexBest->nTime)
+                && !counter.CountedLegacyVotes());
+
         return result;
     }
 
@@ -104,6 +104,10 @@ public:
     //!
     //! \brief Generate the result for the specified poll.
     //!
+    //! Returns the result cached in the poll reference when the votes and the
+    //! relevant chain state did not change since the last query. Otherwise,
+    //! this counts the votes from disk and caches the new result.
+    //!
     //! \param poll_ref Refers to the poll to generate the result for.
     //!
     //! \return An object that contains the calculated result for the poll or
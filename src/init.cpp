@@ -4,17 +4,26 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 
+#include "addressindex.h"
 #include "chainparams.h"
+#include "crypto/aes.h"
 #include "util.h"
 #include "net.h"
+#include "orphanblocks.h"
 #include "txdb.h"
 #include "wallet/walletdb.h"
 #include "banman.h"
 #include "rpcserver.h"
 #include "init.h"
+#include "metrics.h"
 #include "ui_interface.h"
 #include "scheduler.h"
 #include "gridcoin/gridcoin.h"
+#include "gridcoin/research_history.h"
+#include "gridcoin/superblock.h"
+#include "gridcoin/tally.h"
+#include "util/perf.h"
+#include "util/threadpool.h"
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -24,6 +33,7 @@
 
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/algorithm/string/predicate.hpp> // for startswith() and endswith()
+#include <future>
 
 static boost::thread_group threadGroup;
 static CScheduler scheduler;
@@ -104,11 +114,23 @@ void Shutdown(void* parg)
         threadGroup.interrupt_all();
         threadGroup.join_all();
 
+        GRC::Tally::FlushAccrualSnapshots();
+
+        if (pwalletMain)
+            pwalletMain->StopKeyPoolRefill();
+
         bitdb.Flush(false);
         StopNode();
         bitdb.Flush(true);
 
+        {
+            LOCK(cs_main);
+            FlushBlockIndex(true);
+        }
+
         StopRPCThreads();
+        StopMetricsServer();
+        util::StopExecutors();
 
         boost::filesystem::remove(GetPidFile());
         UnregisterWallet(pwalletMain);
@@ -119,6 +141,7 @@ void Shutdown(void* parg)
         //CTxDB().Close();
         MilliSleep(50);
         LogPrintf("Gridcoin exited");
+        LogInstance().StopAsyncLogging();
         fExit = true;
     }
     else
@@ -211,8 +234,22 @@ std::string HelpMessage()
         "  -pid=<file>            " + _("Specify pid file (default: gridcoind.pid)") + "\n" +
         "  -datadir=<dir>         " + _("Specify data directory") + "\n" +
         "  -wallet=<dir>          " + _("Specify wallet file (within data directory)") + "\n" +
-        "  -dbcache=<n>           " + _("Set database cache size in megabytes (default: 25)") + "\n" +
+        "  -dbcache=<n>           " + _("Set database cache size in megabytes (default: 1/64 of the physical memory, 25 to 512)") + "\n" +
+        "  -dbwritebuffer=<n>     " + _("Set the index database write buffer size in megabytes (default: 1/8 of -dbcache, 4 to 64, 4 times as large when importing blocks)") + "\n" +
+        "  -dbmaxopenfiles=<n>    " + _("Set the number of index database files to keep open (minimum: 64, default: 1000)") + "\n" +
+        "  -dbcompression         " + _("Compress the index database when built with libsnappy (default: 1)") + "\n" +
+        "  -blockcachesize=<n>    " + strprintf(_("Keep up to <n> megabytes of recently read blocks in memory (0 to disable, default: %u)"), DEFAULT_BLOCK_CACHE_SIZE) + "\n" +
+        "  -maxorphanblocksmb=<n> " + strprintf(_("Keep up to <n> megabytes of blocks that wait for their parents (default: %u)"), DEFAULT_MAX_ORPHAN_BLOCKS_SIZE) + "\n" +
+        "  -maxmempool=<n>        " + strprintf(_("Keep the transaction memory pool below <n> megabytes (default: %u)"), DEFAULT_MAX_MEMPOOL_SIZE) + "\n" +
+        "  -mempoolexpiry=<n>     " + strprintf(_("Do not keep transactions in the memory pool longer than <n> hours (default: %u)"), DEFAULT_MEMPOOL_EXPIRY) + "\n" +
+        "  -mmapblocks            " + _("Read blocks through memory-mapped block files (default: 0)") + "\n" +
+        "  -prune=<n>             " + strprintf(_("Delete old blocks that the node no longer needs to keep the block files near <n> megabytes (0 to disable, minimum: %u, default: 0)"), MIN_PRUNE_TARGET) + "\n" +
+        "  -headersfirst          " + _("Download block headers first and then fetch blocks from several peers at once (default: 1)") + "\n" +
         "  -dblogsize=<n>         " + _("Set database disk log size in megabytes (default: 100)") + "\n" +
+        "  -maxinvpermsg=<n>      " + strprintf(_("Announce up to <n> inventory entries per inv message (default: %u)"), DEFAULT_MAX_INV_PER_MESSAGE) + "\n" +
+        "  -msgthreads=<n>        " + strprintf(_("Set the number of threads that handle peer messages that do not need the chain lock (up to %d, 0 = none, default: %d)"), MAX_MESSAGE_WORKER_THREADS, DEFAULT_MESSAGE_WORKER_THREADS) + "\n" +
+        "  -par=<n>               " + strprintf(_("Set the number of script verification threads (up to %d, 0 = auto, <0 = leave that many cores free, default: %d)"), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS) + "\n" +
+        "  -sigcachesize=<n>      " + strprintf(_("Limit the signature cache to <n> megabytes (default: %d)"), DEFAULT_SIGNATURE_CACHE_SIZE) + "\n" +
         "  -timeout=<n>           " + _("Specify connection timeout in milliseconds (default: 5000)") + "\n" +
         "  -peertimeout=<n>       " + _("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: 45)") + "\n"
         "  -proxy=<ip:port>       " + _("Connect through socks proxy") + "\n" +
@@ -222,6 +259,7 @@ std::string HelpMessage()
         "  -port=<port>           " + _("Listen for connections on <port> (default: 32749 or testnet: 32748)") + "\n" +
         "  -maxconnections=<n>    "    + _("Maintain at most <n> connections to peers (default: 125)") + "\n" +
         "  -maxoutboundconnections=<n>"+ _("Maximum number of outbound connections (default: 8)") + "\n" +
+        "  -socketevents=<mode>   " + _("Socket readiness mechanism: epoll, kqueue or select (default: epoll on Linux, kqueue on BSD and macOS, otherwise select)") + "\n" +
         "  -addnode=<ip>          " + _("Add a node to connect to and attempt to keep the connection open") + "\n" +
         "  -connect=<ip>          " + _("Connect only to the specified node(s)") + "\n" +
         "  -seednode=<ip>         " + _("Connect to a node to retrieve peer addresses, and disconnect") + "\n" +
@@ -244,7 +282,8 @@ std::string HelpMessage()
 #endif
 #endif
         "  -paytxfee=<amt>        " + _("Fee per KB to add to transactions you send") + "\n" +
-        "  -mininput=<amt>        " + _("When creating transactions, ignore inputs with value less than this (default: 0.01)") + "\n";
+        "  -mininput=<amt>        " + _("When creating transactions, ignore inputs with value less than this (default: 0.01)") + "\n" +
+        "  -coinselectiontries=<n> " + _("Maximum number of steps to search for the best set of inputs when creating transactions (default: 100000)") + "\n";
 	if(fQtActive)
 		strUsage +=
         "  -server                " + _("Accept command line and JSON-RPC commands") + "\n";
@@ -257,8 +296,14 @@ std::string HelpMessage()
         "  -testnet               " + _("Use the test network") + "\n" +
         "  -debug                 " + _("Output extra debugging information.") + "\n" +
         "  -logtimestamps         " + _("Prepend debug output with timestamp") + "\n" +
+        "  -logasync              " + _("Write debug.log and scraper.log from a background thread (default: 0)") + "\n" +
+        "  -logasyncqueue=<n>     " + strprintf(_("Number of messages queued for the background log writer (default: %u)"), DEFAULT_LOGASYNC_QUEUE) + "\n" +
+        "  -logasyncdrop          " + _("Drop log messages instead of waiting when the background log writer falls behind (default: 0)") + "\n" +
         "  -shrinkdebugfile       " + _("Shrink debug.log file on client startup (default: 1 when no -debug)") + "\n" +
         "  -printtoconsole        " + _("Send trace/debug info to console instead of debug.log file") + "\n" +
+        "  -lockprofile           " + _("Record the wait and hold times of each lock site for getlockstats (default: 0)") + "\n" +
+        "  -perfstats             " + _("Record the durations of block validation, message processing, scraper, tally and staking code paths for getperfstats (default: 0)") + "\n" +
+        "  -schedulerthreads=<n>  " + strprintf(_("Number of threads that run background jobs (1 to %d, default: %d)"), MAX_SCHEDULER_THREADS, DEFAULT_SCHEDULER_THREADS) + "\n" +
 #ifdef WIN32
         "  -printtodebugger       " + _("Send trace/debug info to debugger") + "\n" +
 #endif
@@ -268,6 +313,13 @@ std::string HelpMessage()
         "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified IP address") + "\n" +
         "  -rpcconnect=<ip>       " + _("Send commands to node running on <ip> (default: 127.0.0.1)") + "\n" +
         "  -rpcthreads=<n>        " + _("Set the number of threads to service RPC calls (default: 4)") + "\n" +
+        "  -rpcworkqueue=<n>      " + _("Set the depth of the work queue to service RPC calls (default: 16)") + "\n" +
+        "  -rpcservertimeout=<n>  " + _("Timeout in seconds for reading an RPC request from a connection (default: 30)") + "\n" +
+        "  -rpcparallelbatch      " + _("Execute batched read-only RPC calls concurrently on the RPC threads (default: 0)") + "\n" +
+        "  -rpcblockcachesize=<n> " + _("Cache up to <n> MB of the JSON of deeply confirmed blocks for getblock, getblockbynumber and showblock (default: 0)") + "\n" +
+        "  -rpcblockcachedepth=<n> " + _("Only cache the JSON of blocks with at least <n> confirmations (default: 100)") + "\n" +
+        "  -metricsport=<port>    " + _("Serve Prometheus metrics over HTTP at /metrics on <port>. Enables -perfstats unless it is set to 0") + "\n" +
+        "  -metricsbind=<addr>    " + _("Bind the metrics server to the given address (default: 127.0.0.1)") + "\n" +
         "  -blocknotify=<cmd>     " + _("Execute command when the best block changes (%s in cmd is replaced by block hash)") + "\n" +
         "  -walletnotify=<cmd>    " + _("Execute command when a wallet transaction changes (%s in cmd is replaced by TxID)") + "\n" +
         "  -confchange            " + _("Require a confirmations for change (default: 0)") + "\n" +
@@ -275,9 +327,16 @@ std::string HelpMessage()
         "  -alertnotify=<cmd>     " + _("Execute command when a relevant alert is received (%s in cmd is replaced by message)") + "\n" +
         "  -upgradewallet         " + _("Upgrade wallet to latest format") + "\n" +
         "  -keypool=<n>           " + _("Set key pool size to <n> (default: 100)") + "\n" +
+        "  -keypoollowwater=<n>   " + _("Refill the key pool in the background when it holds <n> keys or fewer (default: half of -keypool)") + "\n" +
         "  -rescan                " + _("Rescan the block chain for missing wallet transactions") + "\n" +
+        "  -blockfilterindex      " + _("Store a compact filter for each connected block to speed up rescans (default: 0)") + "\n" +
+        "  -blockstatsindex       " + _("Store a summary of each connected block to speed up the block statistics RPCs (default: 0)") + "\n" +
+        "  -addressindex          " + _("Maintain an index of the balance, unspent outputs and history of each address for the address RPCs. Implies -spentindex (default: 0)") + "\n" +
+        "  -spentindex            " + _("Maintain an index of the input that spent each output for getspentinfo (default: 0)") + "\n" +
+        "  -researchindex         " + _("Maintain an index of the magnitude, research rewards and accrual of each CPID for researchhistory (default: 0)") + "\n" +
         "  -salvagewallet         " + _("Attempt to recover private keys from a corrupt wallet.dat") + "\n" +
         "  -zapwallettxes         " + _("Delete all wallet transactions and only recover those parts of the blockchain through -rescan on startup") + "\n" +
+        "  -assumevalid=<hex>     " + _("If this block is in the chain, assume that it and its ancestors have valid transaction signatures and skip their script checks (0 to verify all above the checkpoints)") + "\n" +
         "  -checkblocks=<n>       " + _("How many blocks to check at startup (default: 2500, 0 = all)") + "\n" +
         "  -checklevel=<n>        " + _("How thorough the block verification is (0-6, default: 1)") + "\n" +
         "  -loadblock=<file>      " + _("Imports blocks from external blk000?.dat file") + "\n" +
@@ -344,6 +403,8 @@ void InitLogging()
     fPrintToConsole = GetBoolArg("-printtoconsole");
     fPrintToDebugger = GetBoolArg("-printtodebugger");
     fLogTimestamps = GetBoolArg("-logtimestamps", true);
+    util::g_perf_enabled = GetBoolArg("-perfstats", false);
+    g_lock_profile = GetBoolArg("-lockprofile", false);
 
     LogInstance().m_print_to_file = !IsArgNegated("-debuglogfile");
     LogInstance().m_file_path = AbsPathForConfigVal(GetArg("-debuglogfile", DEFAULT_DEBUGLOGFILE));
@@ -419,6 +480,13 @@ void InitLogging()
        strprintf("Could not open debug log file %s", LogInstance().m_file_path.string());
     }
 
+    if (GetBoolArg("-logasync", DEFAULT_LOGASYNC))
+    {
+        LogInstance().StartAsyncLogging(
+            std::max<int64_t>(GetArg("-logasyncqueue", DEFAULT_LOGASYNC_QUEUE), 2),
+            GetBoolArg("-logasyncdrop", DEFAULT_LOGASYNC_DROP));
+    }
+
     if (!LogInstance().m_log_timestamps)
     {
         LogPrintf("Startup time: %s\n", FormatISO8601DateTime(GetTime()));
@@ -532,6 +600,36 @@ bool AppInit2(ThreadHandlerPtr threads)
 
     nNodeLifespan = GetArg("-addrlifespan", 7);
     fUseFastIndex = GetBoolArg("-fastindex", false);
+    fBlockFilterIndex = GetBoolArg("-blockfilterindex", false);
+    fBlockStatsIndex = GetBoolArg("-blockstatsindex", false);
+    fAddressIndex = GetBoolArg("-addressindex", false);
+    // Disconnecting a block restores the address index from the spent index:
+    fSpentIndex = GetBoolArg("-spentindex", false) || fAddressIndex;
+    fResearchIndex = GetBoolArg("-researchindex", false);
+    fMmapBlocks = GetBoolArg("-mmapblocks", false);
+    nPruneTarget = std::max<int64_t>(0, GetArg("-prune", 0)) * 1024 * 1024;
+
+    if (nPruneTarget > 0 && nPruneTarget < MIN_PRUNE_TARGET * 1024 * 1024) {
+        return InitError(strprintf(_("-prune must be at least %u megabytes"), MIN_PRUNE_TARGET));
+    }
+    fHeadersFirst = GetBoolArg("-headersfirst", true);
+    hashAssumeValid = uint256S(GetArg("-assumevalid", Params().GetConsensus().defaultAssumeValid.GetHex()));
+
+    if (!hashAssumeValid.IsNull()) {
+        LogPrintf("Assuming ancestors of block %s have valid transaction signatures.", hashAssumeValid.ToString());
+    } else {
+        LogPrintf("Validating transaction signatures for all blocks above the checkpoints.");
+    }
+    nBlockCacheSize = std::max<int64_t>(0, GetArg("-blockcachesize", DEFAULT_BLOCK_CACHE_SIZE)) * 1024 * 1024;
+
+    {
+        LOCK(cs_main);
+        g_orphan_blocks.SetMaxBytes(std::max<int64_t>(1, GetArg("-maxorphanblocksmb", DEFAULT_MAX_ORPHAN_BLOCKS_SIZE)) * 1024 * 1024);
+    }
+
+    mempool.SetLimits(
+        std::max<int64_t>(1, GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE)) * 1024 * 1024,
+        std::max<int64_t>(1, GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY)) * 60 * 60);
 
     nMinerSleep = GetArg("-minersleep", 8000);
 
@@ -639,7 +737,17 @@ bool AppInit2(ThreadHandlerPtr threads)
             InitWarning(_("Warning: -paytxfee is set very high! This is the transaction fee you will pay if you send a transaction."));
     }
 
+    // -par=0 means autodetect, but nScriptCheckThreads==0 means no concurrency
+    nScriptCheckThreads = GetArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
+    if (nScriptCheckThreads <= 0)
+        nScriptCheckThreads += boost::thread::hardware_concurrency();
+    if (nScriptCheckThreads <= 1)
+        nScriptCheckThreads = 0;
+    else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
+        nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+
     fConfChange = GetBoolArg("-confchange", false);
+    nCoinSelectionTries = std::max<int64_t>(1, GetArg("-coinselectiontries", DEFAULT_COIN_SELECTION_TRIES));
     fEnforceCanonical = GetBoolArg("-enforcecanonical", true);
 
     if (mapArgs.count("-mininput"))
@@ -656,9 +764,30 @@ bool AppInit2(ThreadHandlerPtr threads)
     // Initialize internal hashing code with SSE/AVX2 optimizations. In the future we will also have ARM/NEON optimizations.
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' AES implementation\n", AES256AutoDetect());
 
     LogPrintf("Block version 11 hard fork configured for block %d", Params().GetConsensus().BlockV11Height);
 
+    if (nScriptCheckThreads) {
+        LogPrintf("Using %u threads for script verification", nScriptCheckThreads);
+        for (int i = 0; i < nScriptCheckThreads - 1; i++)
+            threadGroup.create_thread(&ThreadScriptCheck);
+    }
+
+    nMaxInvPerMessage = std::max<int64_t>(1, std::min<int64_t>(
+        GetArg("-maxinvpermsg", DEFAULT_MAX_INV_PER_MESSAGE),
+        MAX_INV_SZ));
+
+    nMessageWorkerThreads = std::max(0, std::min<int>(
+        GetArg("-msgthreads", DEFAULT_MESSAGE_WORKER_THREADS),
+        MAX_MESSAGE_WORKER_THREADS));
+
+    if (nMessageWorkerThreads) {
+        LogPrintf("Using %u threads for message handling", nMessageWorkerThreads);
+        for (int i = 0; i < nMessageWorkerThreads; i++)
+            threadGroup.create_thread(&ThreadMessageWorker);
+    }
+
     fs::path datadir = GetDataDir();
     fs::path walletFileName = GetArg("-wallet", "wallet.dat");
 
@@ -881,6 +1010,23 @@ bool AppInit2(ThreadHandlerPtr threads)
         return false;
     }
 
+    // The address manager is not used before the node starts, so read
+    // peers.dat while the block index and the wallet load. The future joins
+    // the load when it goes out of scope if initialization fails first:
+    std::future<int64_t> addrmanLoaded = std::async(std::launch::async, [] {
+        const int64_t nLoadStart = GetTimeMillis();
+        CAddrDB adb;
+
+        if (!adb.Read(addrman)) {
+            LogPrintf("Invalid or missing peers.dat; recreating");
+        }
+
+        return GetTimeMillis() - nLoadStart;
+    });
+
+    // Reindexing replays the legacy superblock contracts of the early chain:
+    GRC::Superblock::OpenLegacyCache(GetDataDir() / "legacysuperblocks.dat");
+
     uiInterface.InitMessage(_("Loading block index..."));
     LogPrintf("Loading block index...");
     nStart = GetTimeMillis();
@@ -897,6 +1043,20 @@ bool AppInit2(ThreadHandlerPtr threads)
     }
     LogPrintf(" block index %15" PRId64 "ms", GetTimeMillis() - nStart);
 
+    if (fAddressIndex || fSpentIndex)
+    {
+        CTxDB txdb;
+        LOCK(cs_main);
+        LogPrintf("Address index covers blocks from height %d", InitAddressIndex(txdb, nBestHeight));
+    }
+
+    if (fResearchIndex)
+    {
+        CTxDB txdb;
+        LOCK(cs_main);
+        LogPrintf("Research history index covers blocks from height %d", GRC::InitResearchIndex(txdb, nBestHeight));
+    }
+
     if (GetBoolArg("-printblockindex") || GetBoolArg("-printblocktree"))
     {
         PrintBlockTree();
@@ -1065,13 +1225,12 @@ bool AppInit2(ThreadHandlerPtr threads)
     LogPrint(BCLog::LogFlags::NOISY, "Loading addresses...");
     nStart = GetTimeMillis();
 
-    {
-        CAddrDB adb;
-        if (!adb.Read(addrman))
-            LogPrintf("Invalid or missing peers.dat; recreating");
-    }
+    const int64_t nAddrmanLoadTime = addrmanLoaded.get();
 
-    LogPrintf("Loaded %i addresses from peers.dat  %" PRId64 "ms",  addrman.size(), GetTimeMillis() - nStart);
+    LogPrintf("Loaded %i addresses from peers.dat  %" PRId64 "ms (waited %" PRId64 "ms)",
+        addrman.size(),
+        nAddrmanLoadTime,
+        GetTimeMillis() - nStart);
 
 
     // ********************************************************* Step 11: start node
@@ -1096,6 +1255,9 @@ bool AppInit2(ThreadHandlerPtr threads)
     if (fServer)
         StartRPCThreads();
 
+    if (!StartMetricsServer())
+        InitWarning(_("Warning: could not start the metrics server. See debug.log for details."));
+
     // ********************************************************* Step 12: finished
 
     uiInterface.InitMessage(_("Done loading"));
@@ -1111,16 +1273,22 @@ bool AppInit2(ThreadHandlerPtr threads)
     int64_t nBalanceInQuestion;
     pwalletMain->FixSpentCoins(nMismatchSpent, nBalanceInQuestion);
 
-    // Start the lightweight task scheduler thread
+    // Start the lightweight task scheduler threads. Named jobs run serially
+    // within their own queue, so a slow job only delays the jobs behind it
+    // when every thread is busy:
+    const int nSchedulerThreads = std::max(1, std::min<int>(GetArg("-schedulerthreads", DEFAULT_SCHEDULER_THREADS), MAX_SCHEDULER_THREADS));
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
-    threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+
+    for (int i = 0; i < nSchedulerThreads; ++i) {
+        threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
+    }
 
     // TODO: Do we need this? It would require porting the Bitcoin signal handler.
     // GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
 
     scheduler.scheduleEvery([]{
         g_banman->DumpBanlist();
-    }, DUMP_BANS_INTERVAL * 1000);
+    }, DUMP_BANS_INTERVAL * 1000, "dumpbanlist");
 
     GRC::ScheduleBackgroundJobs(scheduler);
 
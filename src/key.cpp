@@ -2,11 +2,19 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "config/gridcoin-config.h"
+
+#include <cstring>
 #include <map>
 
 #include <openssl/ecdsa.h>
 #include <openssl/obj_mac.h>
 
+#ifdef USE_LIBSECP256K1
+#include <secp256k1.h>
+#include <secp256k1_recovery.h>
+#endif
+
 #include "key.h"
 
 // OpenSLL 1.1.0 changed EVP data structures to be opaque. In order to preserve
@@ -548,12 +556,308 @@ bool CKey::IsValid()
     return GetPubKey() == key2.GetPubKey();
 }
 
+#ifdef USE_LIBSECP256K1
+namespace {
+//!
+//! \brief Owns the read-only libsecp256k1 context shared by all signature
+//! verification and public key recovery calls.
+//!
+//! libsecp256k1 permits concurrent use of a context that is not modified
+//! after creation, so script check threads can verify in parallel.
+//!
+class Secp256k1VerifyContext
+{
+public:
+    Secp256k1VerifyContext()
+        : m_ctx(secp256k1_context_create(SECP256K1_CONTEXT_VERIFY))
+    {
+    }
+
+    ~Secp256k1VerifyContext()
+    {
+        if (m_ctx != nullptr) {
+            secp256k1_context_destroy(m_ctx);
+        }
+    }
+
+    const secp256k1_context* Get() const
+    {
+        return m_ctx;
+    }
+
+private:
+    secp256k1_context* m_ctx;
+};
+
+const secp256k1_context* GetVerifyContext()
+{
+    static const Secp256k1VerifyContext ctx;
+
+    return ctx.Get();
+}
+
+//!
+//! \brief Parse a DER-encoded ECDSA signature with the same permissive rules
+//! as the OpenSSL decoder that validated the existing chain.
+//!
+//! Supports arbitrary length integers and arbitrary length size descriptors
+//! and does not check for trailing garbage. On invalid R or S values, this
+//! produces a signature that fails verification instead of a parse error.
+//!
+int ecdsa_signature_parse_der_lax(
+    const secp256k1_context* ctx,
+    secp256k1_ecdsa_signature* sig,
+    const unsigned char *input,
+    size_t inputlen)
+{
+    size_t rpos, rlen, spos, slen;
+    size_t pos = 0;
+    size_t lenbyte;
+    unsigned char tmpsig[64] = {0};
+    int overflow = 0;
+
+    // Hack to initialize sig with a correctly-parsed but invalid signature:
+    secp256k1_ecdsa_signature_parse_compact(ctx, sig, tmpsig);
+
+    // Sequence tag byte
+    if (pos == inputlen || input[pos] != 0x30) {
+        return 0;
+    }
+    pos++;
+
+    // Sequence length bytes
+    if (pos == inputlen) {
+        return 0;
+    }
+    lenbyte = input[pos++];
+    if (lenbyte & 0x80) {
+        lenbyte -= 0x80;
+        if (lenbyte > inputlen - pos) {
+            return 0;
+        }
+        pos += lenbyte;
+    }
+
+    // Integer tag byte for R
+    if (pos == inputlen || input[pos] != 0x02) {
+        return 0;
+    }
+    pos++;
+
+    // Integer length for R
+    if (pos == inputlen) {
+        return 0;
+    }
+    lenbyte = input[pos++];
+    if (lenbyte & 0x80) {
+        lenbyte -= 0x80;
+        if (lenbyte > inputlen - pos) {
+            return 0;
+        }
+        while (lenbyte > 0 && input[pos] == 0) {
+            pos++;
+            lenbyte--;
+        }
+        static_assert(sizeof(size_t) >= 4, "size_t too small");
+        if (lenbyte >= 4) {
+            return 0;
+        }
+        rlen = 0;
+        while (lenbyte > 0) {
+            rlen = (rlen << 8) + input[pos];
+            pos++;
+            lenbyte--;
+        }
+    } else {
+        rlen = lenbyte;
+    }
+    if (rlen > inputlen - pos) {
+        return 0;
+    }
+    rpos = pos;
+    pos += rlen;
+
+    // Integer tag byte for S
+    if (pos == inputlen || input[pos] != 0x02) {
+        return 0;
+    }
+    pos++;
+
+    // Integer length for S
+    if (pos == inputlen) {
+        return 0;
+    }
+    lenbyte = input[pos++];
+    if (lenbyte & 0x80) {
+        lenbyte -= 0x80;
+        if (lenbyte > inputlen - pos) {
+            return 0;
+        }
+        while (lenbyte > 0 && input[pos] == 0) {
+            pos++;
+            lenbyte--;
+        }
+        if (lenbyte >= 4) {
+            return 0;
+        }
+        slen = 0;
+        while (lenbyte > 0) {
+            slen = (slen << 8) + input[pos];
+            pos++;
+            lenbyte--;
+        }
+    } else {
+        slen = lenbyte;
+    }
+    if (slen > inputlen - pos) {
+        return 0;
+    }
+    spos = pos;
+
+    // Ignore leading zeroes in R
+    while (rlen > 0 && input[rpos] == 0) {
+        rlen--;
+        rpos++;
+    }
+    // Copy R value
+    if (rlen > 32) {
+        overflow = 1;
+    } else {
+        std::memcpy(tmpsig + 32 - rlen, input + rpos, rlen);
+    }
+
+    // Ignore leading zeroes in S
+    while (slen > 0 && input[spos] == 0) {
+        slen--;
+        spos++;
+    }
+    // Copy S value
+    if (slen > 32) {
+        overflow = 1;
+    } else {
+        std::memcpy(tmpsig + 64 - slen, input + spos, slen);
+    }
+
+    if (!overflow) {
+        overflow = !secp256k1_ecdsa_signature_parse_compact(ctx, sig, tmpsig);
+    }
+    if (overflow) {
+        // Overwrite the result again with a correctly-parsed but invalid
+        // signature if parsing failed.
+        std::memset(tmpsig, 0, 64);
+        secp256k1_ecdsa_signature_parse_compact(ctx, sig, tmpsig);
+    }
+    return 1;
+}
+} // Anonymous namespace
+
+bool CPubKey::Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const
+{
+    if (!IsValid() || vchSig.empty()) {
+        return false;
+    }
+
+    const secp256k1_context* ctx = GetVerifyContext();
+    secp256k1_pubkey pubkey;
+    secp256k1_ecdsa_signature sig;
+
+    if (!secp256k1_ec_pubkey_parse(ctx, &pubkey, vchPubKey.data(), vchPubKey.size())) {
+        return false;
+    }
+
+    if (!ecdsa_signature_parse_der_lax(ctx, &sig, vchSig.data(), vchSig.size())) {
+        return false;
+    }
+
+    // libsecp256k1's ECDSA verification requires lower-S signatures, which
+    // the OpenSSL implementation never enforced, so normalize them first:
+    secp256k1_ecdsa_signature_normalize(ctx, &sig, &sig);
+
+    return secp256k1_ecdsa_verify(ctx, &sig, hash.begin(), &pubkey) == 1;
+}
+
+bool CPubKey::RecoverCompact(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    if (vchSig.size() != 65) {
+        return false;
+    }
+
+    const int nV = vchSig[0];
+
+    if (nV < 27 || nV >= 35) {
+        return false;
+    }
+
+    const int recid = (nV - 27) & 3;
+    const bool fCompressed = ((nV - 27) & 4) != 0;
+
+    const secp256k1_context* ctx = GetVerifyContext();
+    secp256k1_pubkey pubkey;
+    secp256k1_ecdsa_recoverable_signature sig;
+
+    if (!secp256k1_ecdsa_recoverable_signature_parse_compact(ctx, &sig, &vchSig[1], recid)) {
+        return false;
+    }
+
+    if (!secp256k1_ecdsa_recover(ctx, &pubkey, &sig, hash.begin())) {
+        return false;
+    }
+
+    unsigned char pub[65];
+    size_t publen = sizeof(pub);
+
+    secp256k1_ec_pubkey_serialize(
+        ctx,
+        pub,
+        &publen,
+        &pubkey,
+        fCompressed ? SECP256K1_EC_COMPRESSED : SECP256K1_EC_UNCOMPRESSED);
+
+    vchPubKey.assign(pub, pub + publen);
+
+    return true;
+}
+#else // USE_LIBSECP256K1
+bool CPubKey::Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const
+{
+    if (!IsValid() || vchSig.empty()) {
+        return false;
+    }
+
+    CKey key;
+
+    if (!key.SetPubKey(*this)) {
+        return false;
+    }
+
+    return key.Verify(hash, vchSig);
+}
+
+bool CPubKey::RecoverCompact(const uint256& hash, const std::vector<unsigned char>& vchSig)
+{
+    CKey key;
+
+    if (!key.SetCompactSignature(hash, vchSig)) {
+        return false;
+    }
+
+    *this = key.GetPubKey();
+
+    return true;
+}
+#endif // USE_LIBSECP256K1
+
 bool ECC_InitSanityCheck() {
     EC_KEY *pkey = EC_KEY_new_by_curve_name(NID_secp256k1);
     if(pkey == NULL)
         return false;
     EC_KEY_free(pkey);
 
+#ifdef USE_LIBSECP256K1
+    if (GetVerifyContext() == nullptr)
+        return false;
+#endif
+
     // Is there more EC functionality that could be missing?
     return true;
 }
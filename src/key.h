@@ -106,6 +106,36 @@ public:
         return vchPubKey.size() == 33;
     }
 
+    unsigned int size() const {
+        return vchPubKey.size();
+    }
+
+    //!
+    //! \brief Verify a DER-encoded ECDSA signature created by the private key
+    //! that corresponds to this public key.
+    //!
+    //! Uses libsecp256k1 when the node is built with it and falls back to the
+    //! OpenSSL implementation in \c CKey otherwise. Signature encodings that
+    //! OpenSSL accepts (lax DER and high-S values) remain valid.
+    //!
+    //! \param hash   The hash of the signed message.
+    //! \param vchSig The DER-encoded signature to check.
+    //!
+    //! \return \c true if the signature is valid for this public key.
+    //!
+    bool Verify(const uint256& hash, const std::vector<unsigned char>& vchSig) const;
+
+    //!
+    //! \brief Recover the public key from a compact signature created by
+    //! \c CKey::SignCompact().
+    //!
+    //! \param hash   The hash of the signed message.
+    //! \param vchSig The 65-byte compact signature.
+    //!
+    //! \return \c true if a valid public key was recovered into this object.
+    //!
+    bool RecoverCompact(const uint256& hash, const std::vector<unsigned char>& vchSig);
+
     std::vector<unsigned char> Raw() const {
         return vchPubKey;
     }
@@ -7,7 +7,9 @@
 
 #include "crypter.h"
 #include "sync.h"
+#include "util/hasher.h"
 #include <boost/signals2/signal.hpp>
+#include <unordered_map>
 
 class CScript;
 
@@ -44,8 +46,8 @@ public:
     }
 };
 
-typedef std::map<CKeyID, std::pair<CSecret, bool> > KeyMap;
-typedef std::map<CScriptID, CScript > ScriptMap;
+typedef std::unordered_map<CKeyID, std::pair<CSecret, bool>, SaltedUint160Hasher> KeyMap;
+typedef std::unordered_map<CScriptID, CScript, SaltedUint160Hasher> ScriptMap;
 
 /** Basic key store, that keeps keys in an address->secret map */
 class CBasicKeyStore : public CKeyStore
@@ -97,7 +99,7 @@ public:
     virtual bool GetCScript(const CScriptID &hash, CScript& redeemScriptOut) const;
 };
 
-typedef std::map<CKeyID, std::pair<CPubKey, std::vector<unsigned char> > > CryptedKeyMap;
+typedef std::unordered_map<CKeyID, std::pair<CPubKey, std::vector<unsigned char> >, SaltedUint160Hasher> CryptedKeyMap;
 
 /** Keystore which keeps the private keys encrypted.
  * It derives from the basic key store, which is used if no encryption is active.
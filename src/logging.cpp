@@ -13,6 +13,7 @@
 #include <boost/iostreams/filtering_stream.hpp>
 #include <boost/iostreams/filter/gzip.hpp>
 
+#include <algorithm>
 #include <mutex>
 #include <set>
 
@@ -235,14 +236,14 @@ std::vector<CLogCategoryActive> ListActiveLogCategories()
     return ret;
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string& str)
+std::string BCLog::Logger::LogTimestampStr(const std::string& str, bool started_new_line)
 {
     std::string strStamped;
 
     if (!m_log_timestamps)
         return str;
 
-    if (m_started_new_line) {
+    if (started_new_line) {
         int64_t nTimeMicros = GetTimeMicros();
         strStamped = FormatISO8601DateTime(nTimeMicros/1000000);
         if (m_log_time_micros) {
@@ -282,18 +283,32 @@ namespace BCLog {
     }
 }
 
-void BCLog::Logger::LogPrintStr(const std::string& str)
+std::string BCLog::Logger::FormatLogStr(const std::string& str)
 {
-    std::lock_guard<std::mutex> scoped_lock(m_cs);
     std::string str_prefixed = LogEscapeMessage(str);
 
-    if (m_log_threadnames && m_started_new_line) {
+    const bool started_new_line = m_started_new_line.exchange(!str.empty() && str[str.size()-1] == '\n');
+
+    if (m_log_threadnames && started_new_line) {
         str_prefixed.insert(0, "[" + util::ThreadGetInternalName() + "] ");
     }
 
-    str_prefixed = LogTimestampStr(str_prefixed);
+    return LogTimestampStr(str_prefixed, started_new_line);
+}
+
+void BCLog::Logger::LogPrintStr(const std::string& str)
+{
+    if (m_async.load(std::memory_order_relaxed)) {
+        std::shared_ptr<AsyncQueue> queue = std::atomic_load(&m_async_queue);
+
+        if (queue && queue->Push(FormatLogStr(str))) {
+            if (m_async_waiting.load(std::memory_order_relaxed)) m_async_cond.notify_one();
+            return;
+        }
+    }
 
-    m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
+    std::lock_guard<std::mutex> scoped_lock(m_cs);
+    const std::string str_prefixed = FormatLogStr(str);
 
     if (m_buffering) {
         // buffer if we haven't started logging yet
@@ -301,6 +316,11 @@ void BCLog::Logger::LogPrintStr(const std::string& str)
         return;
     }
 
+    WriteLogStr(str_prefixed);
+}
+
+void BCLog::Logger::WriteLogStr(const std::string& str_prefixed)
+{
     if (m_print_to_console) {
         // print to console
         fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
@@ -326,6 +346,243 @@ void BCLog::Logger::LogPrintStr(const std::string& str)
     }
 }
 
+namespace {
+size_t RoundUpToPowerOfTwo(size_t n)
+{
+    size_t power = 2;
+
+    while (power < n) {
+        power <<= 1;
+    }
+
+    return power;
+}
+} // anonymous namespace
+
+BCLog::AsyncQueue::AsyncQueue(size_t capacity, bool drop_when_full, Sink sink)
+    : m_cells(new Cell[RoundUpToPowerOfTwo(capacity)])
+    , m_mask(RoundUpToPowerOfTwo(capacity) - 1)
+    , m_drop_when_full(drop_when_full)
+    , m_sink(std::move(sink))
+{
+    for (size_t i = 0; i <= m_mask; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool BCLog::AsyncQueue::TryPush(std::string& str)
+{
+    size_t pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    Cell* cell;
+
+    for (;;) {
+        cell = &m_cells[pos & m_mask];
+        const size_t seq = cell->sequence.load(std::memory_order_acquire);
+        const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+
+        if (diff == 0) {
+            if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // The writer has not consumed this slot yet.
+        } else {
+            pos = m_enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->data = std::move(str);
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+    return true;
+}
+
+bool BCLog::AsyncQueue::Push(std::string str)
+{
+    ++m_producers;
+
+    bool queued = false;
+
+    while (m_open) {
+        if (TryPush(str)) {
+            queued = true;
+            break;
+        }
+
+        if (m_drop_when_full) {
+            ++m_dropped;
+            ++m_dropped_total;
+            queued = true;
+            break;
+        }
+
+        // Backpressure: wait for the writer to make room.
+        std::this_thread::yield();
+    }
+
+    --m_producers;
+
+    return queued;
+}
+
+bool BCLog::AsyncQueue::Drain()
+{
+    std::string batch;
+
+    for (;;) {
+        Cell& cell = m_cells[m_dequeue_pos & m_mask];
+        const size_t seq = cell.sequence.load(std::memory_order_acquire);
+
+        if ((intptr_t)seq - (intptr_t)(m_dequeue_pos + 1) < 0) {
+            break; // Empty, or a producer has not finished writing the slot.
+        }
+
+        batch += cell.data;
+        cell.data.clear();
+        cell.data.shrink_to_fit();
+        cell.sequence.store(m_dequeue_pos + m_mask + 1, std::memory_order_release);
+        ++m_dequeue_pos;
+    }
+
+    if (const uint64_t dropped = m_dropped.exchange(0)) {
+        batch += strprintf("WARNING: Logger: dropped %u messages because the log queue was full\n", dropped);
+    }
+
+    if (batch.empty()) {
+        return false;
+    }
+
+    m_sink(batch);
+
+    return true;
+}
+
+void BCLog::AsyncQueue::Close()
+{
+    m_open = false;
+
+    while (m_producers.load() > 0) {
+        std::this_thread::yield();
+    }
+}
+
+void BCLog::Logger::StartAsyncLogging(size_t capacity, bool drop_when_full)
+{
+    if (m_async) return;
+
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_cs);
+
+        // Messages buffered before StartLogging() are written in order by
+        // the caller, and a log without outputs has nothing to write:
+        if (m_buffering || (!m_print_to_console && !m_print_to_file)) return;
+    }
+
+    m_async_capacity = std::max<size_t>(capacity, 2);
+    m_async_drop = drop_when_full;
+
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_async_cs);
+        m_async_stop = false;
+    }
+
+    std::shared_ptr<AsyncQueue> queue = std::make_shared<AsyncQueue>(m_async_capacity, m_async_drop, [this](const std::string& batch) {
+        std::lock_guard<std::mutex> scoped_lock(m_cs);
+        WriteLogStr(batch);
+    });
+
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_async_cs);
+        m_async_queues.push_back(queue);
+    }
+
+    std::atomic_store(&m_async_queue, queue);
+
+    m_async_thread = std::thread(&BCLog::Logger::AsyncWriterThread, this);
+    m_async = true;
+}
+
+void BCLog::Logger::StopAsyncLogging()
+{
+    if (!m_async.exchange(false)) return;
+
+    std::vector<std::shared_ptr<AsyncQueue>> queues;
+
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_async_cs);
+        queues = m_async_queues;
+    }
+
+    // Callers that reach a closed queue write synchronously:
+    for (const auto& queue : queues) {
+        queue->Close();
+    }
+
+    {
+        std::lock_guard<std::mutex> scoped_lock(m_async_cs);
+        m_async_stop = true;
+    }
+
+    m_async_cond.notify_one();
+    m_async_thread.join();
+
+    std::lock_guard<std::mutex> scoped_lock(m_async_cs);
+    m_async_queues.clear();
+}
+
+std::shared_ptr<BCLog::AsyncQueue> BCLog::Logger::CreateAsyncQueue(AsyncQueue::Sink sink)
+{
+    std::lock_guard<std::mutex> scoped_lock(m_async_cs);
+
+    if (!m_async || m_async_stop) return nullptr;
+
+    std::shared_ptr<AsyncQueue> queue = std::make_shared<AsyncQueue>(m_async_capacity, m_async_drop, std::move(sink));
+    m_async_queues.push_back(queue);
+
+    return queue;
+}
+
+uint64_t BCLog::Logger::AsyncDropped() const
+{
+    std::shared_ptr<AsyncQueue> queue = std::atomic_load(&m_async_queue);
+
+    return queue ? queue->Dropped() : 0;
+}
+
+void BCLog::Logger::AsyncWriterThread()
+{
+    util::ThreadRename("logger");
+
+    std::unique_lock<std::mutex> lock(m_async_cs);
+
+    for (;;) {
+        const bool stop = m_async_stop;
+        const std::vector<std::shared_ptr<AsyncQueue>> queues = m_async_queues;
+
+        lock.unlock();
+
+        bool wrote = false;
+
+        for (const auto& queue : queues) {
+            wrote |= queue->Drain();
+        }
+
+        lock.lock();
+
+        // The queues are closed before the stop flag is set, so the drain
+        // above wrote everything:
+        if (stop) break;
+
+        if (!wrote) {
+            // Producers only notify while the writer waits. The timeout
+            // bounds the delay of a message queued just before the wait.
+            m_async_waiting = true;
+            m_async_cond.wait_for(lock, std::chrono::milliseconds(50));
+            m_async_waiting = false;
+        }
+    }
+}
+
 void BCLog::Logger::ShrinkDebugFile()
 {
     // Amount of debug.log to save at end when shrinking (must fit in memory)
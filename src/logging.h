@@ -10,10 +10,14 @@
 #include <tinyformat.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <boost/date_time/posix_time/posix_time.hpp>
@@ -24,6 +28,12 @@ static const bool DEFAULT_LOGTIMEMICROS = false;
 static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
+/** -logasync default */
+static const bool DEFAULT_LOGASYNC = false;
+/** -logasyncqueue default */
+static const size_t DEFAULT_LOGASYNC_QUEUE = 8192;
+/** -logasyncdrop default */
+static const bool DEFAULT_LOGASYNC_DROP = false;
 extern const char* const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -90,6 +100,64 @@ namespace BCLog {
         ALL         = ~(uint32_t)0,
     };
 
+    /**
+     * Bounded multi-producer, single-consumer ring of log text. Producers
+     * reserve a slot with a compare-and-swap and never take a lock. The
+     * background writer of the Logger drains the ring into a sink.
+     *
+     * When the ring is full, a producer either waits for the writer to make
+     * room or drops its message. The writer reports the dropped count in the
+     * log that lost the messages.
+     */
+    class AsyncQueue
+    {
+    public:
+        typedef std::function<void(const std::string&)> Sink;
+
+        /**
+         * @param capacity       Number of messages held. Rounded up to a power of two.
+         * @param drop_when_full Drop messages instead of waiting when the ring is full.
+         * @param sink           Writes a batch of messages. Called on the writer thread.
+         */
+        AsyncQueue(size_t capacity, bool drop_when_full, Sink sink);
+
+        /**
+         * Queue a message for the writer.
+         *
+         * @return false if the queue stopped. The caller writes the message itself.
+         */
+        bool Push(std::string str);
+
+        /** Write the queued messages to the sink. Called by the writer only. */
+        bool Drain();
+
+        /** Refuse new messages and wait for producers in Push() to finish. */
+        void Close();
+
+        /** Number of messages dropped because the ring was full. */
+        uint64_t Dropped() const { return m_dropped_total.load(std::memory_order_relaxed); }
+
+    private:
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            std::string data;
+        };
+
+        const std::unique_ptr<Cell[]> m_cells;
+        const size_t m_mask;
+        const bool m_drop_when_full;
+        const Sink m_sink;
+        std::atomic<size_t> m_enqueue_pos{0};
+        size_t m_dequeue_pos = 0;               //!< Accessed by the writer only.
+        std::atomic<bool> m_open{true};
+        std::atomic<int> m_producers{0};
+        std::atomic<uint64_t> m_dropped{0};       //!< Dropped since the writer last reported.
+        std::atomic<uint64_t> m_dropped_total{0};
+
+        bool TryPush(std::string& str);
+    };
+
     class Logger
     {
     private:
@@ -108,11 +176,31 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        std::string LogTimestampStr(const std::string& str, bool started_new_line);
+
+        /** Escape and prefix a message on the calling thread. */
+        std::string FormatLogStr(const std::string& str);
+
+        /** Write formatted text to the outputs. Requires m_cs. */
+        void WriteLogStr(const std::string& str_prefixed);
 
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks /* GUARDED_BY(m_cs) */ {};
 
+        /** Settings and state of the background writer. See StartAsyncLogging(). */
+        std::atomic<bool> m_async{false};
+        size_t m_async_capacity = DEFAULT_LOGASYNC_QUEUE;
+        bool m_async_drop = DEFAULT_LOGASYNC_DROP;
+        std::shared_ptr<AsyncQueue> m_async_queue;
+        std::mutex m_async_cs;
+        std::condition_variable m_async_cond;
+        std::vector<std::shared_ptr<AsyncQueue>> m_async_queues; // GUARDED_BY(m_async_cs)
+        bool m_async_stop = false;                               // GUARDED_BY(m_async_cs)
+        std::atomic<bool> m_async_waiting{false};
+        std::thread m_async_thread;
+
+        void AsyncWriterThread();
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -131,6 +219,9 @@ namespace BCLog {
         /** Returns whether logs will be written to any output */
         bool Enabled() const
         {
+            // The writer only runs while logging has an output:
+            if (m_async.load(std::memory_order_relaxed)) return true;
+
             std::lock_guard<std::mutex> scoped_lock(m_cs);
             return m_buffering || m_print_to_console || m_print_to_file || !m_print_callbacks.empty();
         }
@@ -155,6 +246,30 @@ namespace BCLog {
         /** Only for testing */
         void DisconnectTestLogger();
 
+        /**
+         * Move the writing of log messages to a background thread. Callers
+         * still format their messages, but hand them to a lock-free queue
+         * instead of writing under the logger mutex. Call after StartLogging().
+         *
+         * @param capacity       Messages that the queue of each log holds.
+         * @param drop_when_full Drop messages instead of waiting for room.
+         */
+        void StartAsyncLogging(size_t capacity, bool drop_when_full);
+
+        /** Write the queued messages and stop the background writer. */
+        void StopAsyncLogging();
+
+        /**
+         * Create a queue drained by the background writer for another log
+         * file, like scraper.log.
+         *
+         * @return nullptr unless the background writer runs.
+         */
+        std::shared_ptr<AsyncQueue> CreateAsyncQueue(AsyncQueue::Sink sink);
+
+        /** Get the number of messages dropped by the queue of debug.log. */
+        uint64_t AsyncDropped() const;
+
         void ShrinkDebugFile();
 
         bool archive(bool fImmediate, fs::path pfile_out);
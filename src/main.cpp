@@ -6,16 +6,25 @@
 #include "util.h"
 #include "net.h"
 #include "streams.h"
+#include "addressindex.h"
 #include "alert.h"
+#include "blockdownload.h"
+#include "blockencodings.h"
 #include "checkpoints.h"
+#include "checkqueue.h"
+#include "crypto/common.h"
+#include "crypto/sha256.h"
 #include "txdb.h"
 #include "init.h"
+#include "miner.h"
+#include "orphanblocks.h"
 #include "ui_interface.h"
 #include "gridcoin/beacon.h"
 #include "gridcoin/claim.h"
 #include "gridcoin/contract/contract.h"
 #include "gridcoin/project.h"
 #include "gridcoin/quorum.h"
+#include "gridcoin/research_history.h"
 #include "gridcoin/researcher.h"
 #include "gridcoin/scraper/scraper_net.h"
 #include "gridcoin/staking/difficulty.h"
@@ -24,16 +33,28 @@
 #include "gridcoin/staking/reward.h"
 #include "gridcoin/staking/status.h"
 #include "gridcoin/superblock.h"
+#include "gridcoin/support/block_prefetcher.h"
 #include "gridcoin/support/xml.h"
 #include "gridcoin/tally.h"
 #include "gridcoin/tx_message.h"
+#include "util/memory.h"
+#include "util/perf.h"
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <list>
 #include <math.h>
 
+#ifndef WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 extern bool AskForOutstandingBlocks(uint256 hashStart);
 extern bool GridcoinServices();
 
@@ -53,6 +74,10 @@ CCriticalSection cs_main;
 
 CTxMemPool mempool;
 
+int nScriptCheckThreads = 0;
+int nMessageWorkerThreads = 0;
+unsigned int nMaxInvPerMessage = DEFAULT_MAX_INV_PER_MESSAGE;
+
 extern double CoinToDouble(double surrogate);
 
 ///////////////////////MINOR VERSION////////////////////////////////
@@ -60,10 +85,51 @@ extern double CoinToDouble(double surrogate);
 extern int64_t GetCoinYearReward(int64_t nTime);
 
 BlockMap mapBlockIndex;
+
+namespace {
+//!
+//! \brief Allocates block index entries in contiguous slabs.
+//!
+//! Block index entries are never freed before shutdown, so the arena avoids
+//! the allocator overhead of each entry and places entries created together,
+//! like the chain loaded at startup, next to each other in memory.
+//!
+class BlockIndexArena
+{
+public:
+    CBlockIndex* New(const CBlockIndex& index)
+    {
+        if (m_used == SLAB_SIZE) {
+            m_slabs.emplace_back(new CBlockIndex[SLAB_SIZE]);
+            m_used = 0;
+        }
+
+        CBlockIndex* pindex = &m_slabs.back()[m_used++];
+        *pindex = index;
+
+        return pindex;
+    }
+
+private:
+    static constexpr size_t SLAB_SIZE = 4096; //!< Entries per slab.
+
+    std::vector<std::unique_ptr<CBlockIndex[]>> m_slabs;
+    size_t m_used = SLAB_SIZE; //!< Entries allocated from the last slab.
+};
+
+constexpr size_t BlockIndexArena::SLAB_SIZE; // for clang
+
+BlockIndexArena g_block_index_arena;
+} // anonymous namespace
+
+CBlockIndex* NewBlockIndex(const CBlockIndex& index)
+{
+    return g_block_index_arena.New(index);
+}
 set<pair<COutPoint, unsigned int> > setStakeSeen;
 
-CBigNum bnProofOfWorkLimit(ArithToUint256(~arith_uint256() >> 20)); // "standard" scrypt target limit for proof of work, results with 0,000244140625 proof-of-work difficulty
-CBigNum bnProofOfWorkLimitTestNet(ArithToUint256(~arith_uint256() >> 16));
+arith_uint256 bnProofOfWorkLimit = ~arith_uint256() >> 20; // "standard" scrypt target limit for proof of work, results with 0,000244140625 proof-of-work difficulty
+arith_uint256 bnProofOfWorkLimitTestNet = ~arith_uint256() >> 16;
 
 //Gridcoin Minimum Stake Age (16 Hours)
 unsigned int nStakeMinAge = 16 * 60 * 60; // 16 hours
@@ -85,9 +151,7 @@ CMedianFilter<int> cPeerBlockCounts(5, 0); // Amount of blocks that other nodes
 
 
 
-map<uint256, CBlock*> mapOrphanBlocks;
-multimap<uint256, CBlock*> mapOrphanBlocksByPrev;
-set<pair<COutPoint, unsigned int> > setStakeSeenOrphan;
+COrphanBlockPool g_orphan_blocks(DEFAULT_MAX_ORPHAN_BLOCKS_SIZE * 1024 * 1024);
 
 map<uint256, CTransaction> mapOrphanTransactions;
 map<uint256, set<uint256> > mapOrphanTransactionsByPrev;
@@ -131,6 +195,16 @@ globalStatusType GlobalStatusStruct;
 bool fColdBoot = true;
 bool fEnforceCanonical = true;
 bool fUseFastIndex = false;
+bool fBlockFilterIndex = false;
+bool fBlockStatsIndex = false;
+bool fAddressIndex = false;
+bool fSpentIndex = false;
+bool fResearchIndex = false;
+size_t nBlockCacheSize = DEFAULT_BLOCK_CACHE_SIZE * 1024 * 1024;
+bool fMmapBlocks = false;
+uint64_t nPruneTarget = 0;
+bool fHeadersFirst = true;
+uint256 hashAssumeValid;
 
 // Temporary block version 11 transition helpers:
 int64_t g_v11_timestamp = 0;
@@ -266,6 +340,21 @@ void SyncWithWallets(const CTransaction& tx, const CBlock* pblock, bool fUpdate,
         pwallet->AddToWalletIfInvolvingMe(tx, pblock, fUpdate);
 }
 
+// make sure all wallets know about the transactions in a connected block,
+// writing the changes and signalling the changed transactions of each wallet
+// in one batch
+void static SyncBlockWithWallets(const CBlock& block)
+{
+    for (auto const& pwallet : setpwalletRegistered)
+    {
+        LOCK(pwallet->cs_wallet);
+        CWalletWriteBatch batch(*pwallet);
+
+        for (auto const& tx : block.vtx)
+            pwallet->AddToWalletIfInvolvingMe(tx, &block, true);
+    }
+}
+
 // notify wallets about a new best chain
 void static SetBestChain(const CBlockLocator& loc)
 {
@@ -870,7 +959,72 @@ int64_t CTransaction::GetMinFee(unsigned int nBlockSize, enum GetMinFee_mode mod
     return nMinFee;
 }
 
-bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInputs)
+namespace {
+//!
+//! \brief Check the parts of a loose transaction that do not depend on the
+//! chain or on the memory pool.
+//!
+bool CheckLooseTransaction(const CTransaction& tx)
+{
+    if (!tx.CheckTransaction())
+        return error("AcceptToMemoryPool : CheckTransaction failed");
+
+    // Coinbase is only valid in a block, not as a loose transaction
+    if (tx.IsCoinBase())
+        return tx.DoS(100, error("AcceptToMemoryPool : coinbase as individual tx"));
+
+    // ppcoin: coinstake is also only valid in a block, not as a loose transaction
+    if (tx.IsCoinStake())
+        return tx.DoS(100, error("AcceptToMemoryPool : coinstake as individual tx"));
+
+    // Reject malformed contracts before parsing their payloads again in the
+    // contextual checks. CheckContracts() repeats these checks with inputs:
+    if (tx.nVersion > 1) {
+        if (tx.GetContracts().size() > 1)
+            return tx.DoS(100, error("%s: only one contract allowed in tx", __func__));
+
+        for (const auto& contract : tx.GetContracts()) {
+            if (contract.m_version <= 1)
+                return tx.DoS(100, error("%s: legacy contract", __func__));
+
+            if (!contract.WellFormed())
+                return tx.DoS(100, error("%s: malformed contract", __func__));
+        }
+    }
+
+    return true;
+}
+} // anonymous namespace
+
+bool PreValidateTransaction(const CTransaction& tx)
+{
+    if (!CheckLooseTransaction(tx))
+        return false;
+
+    CTxDB txdb("r");
+
+    for (unsigned int i = 0; i < tx.vin.size(); i++)
+    {
+        const COutPoint& prevout = tx.vin[i].prevout;
+        CTransaction txPrev;
+
+        // A transaction hash commits to the outputs, so a signature that
+        // fails against an output read here fails in any chain state. The
+        // contextual checks handle inputs that we cannot find yet:
+        if (!mempool.lookup(prevout.hash, txPrev) && !txPrev.ReadFromDisk(txdb, prevout))
+            continue;
+
+        if (prevout.n >= txPrev.vout.size())
+            continue;
+
+        if (!CScriptCheck(txPrev, tx, i, 0)())
+            return tx.DoS(100, error("%s: %s VerifySignature failed", __func__, tx.GetHash().ToString()));
+    }
+
+    return true;
+}
+
+bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInputs, bool fPreValidated)
 {
     AssertLockHeld(cs_main);
     if (pfMissingInputs)
@@ -894,16 +1048,8 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInput
         return error("AcceptToMemoryPool : v2 transaction too early");
     }
 
-    if (!tx.CheckTransaction())
-        return error("AcceptToMemoryPool : CheckTransaction failed");
-
-    // Coinbase is only valid in a block, not as a loose transaction
-    if (tx.IsCoinBase())
-        return tx.DoS(100, error("AcceptToMemoryPool : coinbase as individual tx"));
-
-    // ppcoin: coinstake is also only valid in a block, not as a loose transaction
-    if (tx.IsCoinStake())
-        return tx.DoS(100, error("AcceptToMemoryPool : coinstake as individual tx"));
+    if (!fPreValidated && !CheckLooseTransaction(tx))
+        return false;
 
     // Rather not work on nonstandard transactions
     if (!IsStandardTx(tx))
@@ -917,7 +1063,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInput
     }
 
     // is it already in the memory pool?
-    uint256 hash = tx.GetHash();
+    uint256 hash = tx.GetHash(true);
     if (pool.exists(hash))
         return false;
 
@@ -952,6 +1098,8 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInput
         }
     }
 
+    CTxMemPoolEntry entry;
+
     {
         CTxDB txdb("r");
 
@@ -1032,6 +1180,36 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInput
                 return false;
             }
         }
+
+        // Record the fee and the inputs for the pool limits and for block
+        // assembly while they are at hand:
+        entry.nFee = nFees;
+        entry.nTxSize = nSize;
+        entry.nTime = GetTime();
+        entry.fHaveInputs = true;
+
+        for (const auto& txin : tx.vin) {
+            const CTxIndex& txindex = mapInputs[txin.prevout.hash].first;
+
+            if (txindex.pos == CDiskTxPos(1,1,1)) {
+                entry.setParents.insert(txin.prevout.hash);
+                continue;
+            }
+
+            const CBlockIndex* pindex = txindex.GetBlockIndex();
+
+            if (!pindex || !pindex->IsInMainChain()) {
+                // The miner reads the inputs itself:
+                entry.fHaveInputs = false;
+                entry.vChainInputs.clear();
+                entry.setParents.clear();
+                break;
+            }
+
+            entry.vChainInputs.emplace_back(
+                pindex,
+                mapInputs[txin.prevout.hash].second.vout[txin.prevout.n].nValue);
+        }
     }
 
     // Store transaction in memory
@@ -1042,7 +1220,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInput
             LogPrint(BCLog::LogFlags::MEMPOOL, "AcceptToMemoryPool : replacing tx %s with new version", ptxOld->GetHash().ToString());
             pool.remove(*ptxOld);
         }
-        pool.addUnchecked(hash, tx);
+        pool.addUnchecked(hash, tx, std::move(entry));
     }
 
     ///// are we sure this is ok when loading transactions or restoring block txes
@@ -1050,20 +1228,60 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx, bool* pfMissingInput
     if (ptxOld)
         EraseFromWallets(ptxOld->GetHash());
 
+    // Make room by evicting the transactions with the lowest fee rates. This
+    // may evict the new transaction itself:
+    if (pool.Limit(GetTime()) && !pool.exists(hash))
+        return error("AcceptToMemoryPool : memory pool full, fee rate of %s too low", hash.ToString());
+
     LogPrint(BCLog::LogFlags::MEMPOOL, "AcceptToMemoryPool : accepted %s (poolsz %" PRIszu ")", hash.ToString(), pool.mapTx.size());
 
     return true;
 }
 
+CTxMemPool::CTxMemPool()
+    : nTransactionsUpdated(0)
+    , nTotalTxBytes(0)
+    , nTotalUsage(0)
+    , nMaxUsage(DEFAULT_MAX_MEMPOOL_SIZE * 1024 * 1024)
+    , nExpiry(DEFAULT_MEMPOOL_EXPIRY * 60 * 60)
+    , nExpired(0)
+    , nEvicted(0)
+{
+}
+
 bool CTxMemPool::addUnchecked(const uint256& hash, CTransaction &tx)
+{
+    CTxMemPoolEntry entry;
+    entry.nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+    entry.nTime = GetTime();
+
+    return addUnchecked(hash, tx, std::move(entry));
+}
+
+bool CTxMemPool::addUnchecked(const uint256& hash, CTransaction &tx, CTxMemPoolEntry entry)
 {
     // Add to memory pool without checking anything.  Don't call this directly,
     // call AcceptToMemoryPool to properly check the transaction first.
+    LOCK(cs);
+
+    // Adding a transaction twice would count its memory twice:
+    if (mapTx.count(hash))
+        return false;
+
     {
         mapTx[hash] = tx;
         for (unsigned int i = 0; i < tx.vin.size(); i++)
             mapNextTx[tx.vin[i].prevout] = CInPoint(&mapTx[hash], i);
+        nTransactionsUpdated++;
     }
+
+    entry.nUsage = EstimateUsage(tx, entry);
+    nTotalTxBytes += entry.nTxSize;
+    nTotalUsage += entry.nUsage;
+    setByFeeRate.emplace(entry.GetFeeRate(), hash);
+    setByTime.emplace(entry.nTime, hash);
+    mapEntries[hash] = std::move(entry);
+
     return true;
 }
 
@@ -1073,12 +1291,12 @@ bool CTxMemPool::remove(const CTransaction &tx, bool fRecursive)
     // Remove transaction from memory pool
     {
         LOCK(cs);
-        uint256 hash = tx.GetHash();
+        uint256 hash = tx.GetHash(true);
         if (mapTx.count(hash))
         {
             if (fRecursive) {
                 for (unsigned int i = 0; i < tx.vout.size(); i++) {
-                    std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(COutPoint(hash, i));
+                    const auto it = mapNextTx.find(COutPoint(hash, i));
                     if (it != mapNextTx.end())
                         remove(*it->second.ptx, true);
                 }
@@ -1086,6 +1304,18 @@ bool CTxMemPool::remove(const CTransaction &tx, bool fRecursive)
             for (auto const& txin : tx.vin)
                 mapNextTx.erase(txin.prevout);
             mapTx.erase(hash);
+
+            const auto entry_iter = mapEntries.find(hash);
+            if (entry_iter != mapEntries.end()) {
+                const CTxMemPoolEntry& entry = entry_iter->second;
+                nTotalTxBytes -= entry.nTxSize;
+                nTotalUsage -= entry.nUsage;
+                setByFeeRate.erase(std::make_pair(entry.GetFeeRate(), hash));
+                setByTime.erase(std::make_pair(entry.nTime, hash));
+                mapEntries.erase(entry_iter);
+            }
+
+            nTransactionsUpdated++;
         }
     }
     return true;
@@ -1097,7 +1327,7 @@ bool CTxMemPool::removeConflicts(const CTransaction &tx)
     LOCK(cs);
     for (auto const &txin : tx.vin)
     {
-        std::map<COutPoint, CInPoint>::iterator it = mapNextTx.find(txin.prevout);
+        const auto it = mapNextTx.find(txin.prevout);
         if (it != mapNextTx.end()) {
             const CTransaction &txConflict = *it->second.ptx;
             if (txConflict != tx)
@@ -1112,6 +1342,12 @@ void CTxMemPool::clear()
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    mapEntries.clear();
+    setByFeeRate.clear();
+    setByTime.clear();
+    nTotalTxBytes = 0;
+    nTotalUsage = 0;
+    nTransactionsUpdated++;
 }
 
 void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
@@ -1120,8 +1356,8 @@ void CTxMemPool::queryHashes(std::vector<uint256>& vtxid)
 
     LOCK(cs);
     vtxid.reserve(mapTx.size());
-    for (map<uint256, CTransaction>::iterator mi = mapTx.begin(); mi != mapTx.end(); ++mi)
-        vtxid.push_back((*mi).first);
+    for (const auto& tx_pair : mapTx)
+        vtxid.push_back(tx_pair.first);
 }
 
 void CTxMemPool::DiscardVersion1()
@@ -1138,6 +1374,89 @@ void CTxMemPool::DiscardVersion1()
     }
 }
 
+void CTxMemPool::SetLimits(size_t nMaxUsageIn, int64_t nExpiryIn)
+{
+    LOCK(cs);
+    nMaxUsage = nMaxUsageIn;
+    nExpiry = nExpiryIn;
+}
+
+unsigned int CTxMemPool::Limit(int64_t nNow)
+{
+    LOCK(cs);
+
+    const size_t nStartSize = mapTx.size();
+
+    // Removes the transaction at the front of an order along with the
+    // transactions that spend it:
+    const auto remove_first = [this](const uint256& hash) {
+        const auto iter = mapTx.find(hash);
+        if (iter != mapTx.end())
+            remove(iter->second, true);
+    };
+
+    while (!setByTime.empty() && setByTime.begin()->first + nExpiry < nNow)
+    {
+        const size_t nSize = mapTx.size();
+        remove_first(setByTime.begin()->second);
+        nExpired += nSize - mapTx.size();
+    }
+
+    while (nTotalUsage > nMaxUsage && !setByFeeRate.empty())
+    {
+        const uint256 hash = setByFeeRate.begin()->second;
+
+        LogPrint(BCLog::LogFlags::MEMPOOL, "%s: evicting tx %s with fee rate %g to stay under %" PRIszu " bytes",
+            __func__, hash.ToString(), setByFeeRate.begin()->first, nMaxUsage);
+
+        const size_t nSize = mapTx.size();
+        remove_first(hash);
+        nEvicted += nSize - mapTx.size();
+    }
+
+    return nStartSize - mapTx.size();
+}
+
+CTxMemPoolStats CTxMemPool::GetStats() const
+{
+    LOCK(cs);
+
+    CTxMemPoolStats stats;
+
+    stats.nTx = mapTx.size();
+    stats.nTxBytes = nTotalTxBytes;
+    stats.nUsage = nTotalUsage;
+    stats.nMaxUsage = nMaxUsage;
+    stats.nExpiry = nExpiry;
+    stats.dMinFeeRate = setByFeeRate.empty() ? 0 : setByFeeRate.begin()->first;
+    stats.nExpired = nExpired;
+    stats.nEvicted = nEvicted;
+
+    return stats;
+}
+
+size_t CTxMemPool::EstimateUsage(const CTransaction& tx, const CTxMemPoolEntry& entry)
+{
+    // A node of std::map or std::set holds three pointers and a color next
+    // to its value:
+    constexpr size_t nNode = 4 * sizeof(void*);
+
+    // A node of the unordered maps holds the next pointer and the cached hash
+    // next to its value, and the map keeps about one bucket pointer per node:
+    constexpr size_t nHashNode = 3 * sizeof(void*);
+
+    return entry.nTxSize // Approximates the scripts and the contract payloads.
+        + nHashNode + sizeof(std::pair<const uint256, CTransaction>)
+        + tx.vin.capacity() * sizeof(CTxIn)
+        + tx.vout.capacity() * sizeof(CTxOut)
+        + tx.vContracts.capacity() * sizeof(GRC::Contract)
+        + tx.vin.size() * (nHashNode + sizeof(std::pair<const COutPoint, CInPoint>))
+        + nHashNode + sizeof(std::pair<const uint256, CTxMemPoolEntry>)
+        + entry.vChainInputs.capacity() * sizeof(std::pair<const CBlockIndex*, int64_t>)
+        + entry.setParents.size() * (nNode + sizeof(uint256))
+        + 2 * (nNode + sizeof(std::pair<double, uint256>));
+}
+
 
 
 int CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex* &pindexRet) const
@@ -1218,18 +1537,25 @@ bool CWalletTx::AcceptWalletTransaction()
 
 int CTxIndex::GetDepthInMainChain() const
 {
+    const CBlockIndex* pindex = GetBlockIndex();
+    if (!pindex || !pindex->IsInMainChain())
+        return 0;
+    return 1 + nBestHeight - pindex->nHeight;
+}
+
+CBlockIndex* CTxIndex::GetBlockIndex() const
+{
+    if (pos == CDiskTxPos(1,1,1))
+        return nullptr;
     // Read block header
     CBlock block;
     if (!block.ReadFromDisk(pos.nFile, pos.nBlockPos, false))
-        return 0;
+        return nullptr;
     // Find the block in the index
     BlockMap::iterator mi = mapBlockIndex.find(block.GetHash(true));
     if (mi == mapBlockIndex.end())
-        return 0;
-    CBlockIndex* pindex = (*mi).second;
-    if (!pindex || !pindex->IsInMainChain())
-        return 0;
-    return 1 + nBestHeight - pindex->nHeight;
+        return nullptr;
+    return mi->second;
 }
 
 // Return transaction in tx, and if it was found inside a block, its hash is placed in hashBlock
@@ -1265,6 +1591,89 @@ bool GetTransaction(const uint256 &hash, CTransaction &tx, uint256 &hashBlock)
 //
 // CBlock and CBlockIndex
 //
+namespace {
+//!
+//! \brief Keeps the blocks most recently read from disk in memory.
+//!
+//! Contract replay, reorganizations, voting and the statistics RPCs read the
+//! same recent blocks repeatedly. The cache holds deserialized blocks up to a
+//! total serialized size of nBlockCacheSize bytes, and evicts the least
+//! recently used blocks first. A block never changes once stored at a hash,
+//! so entries need no invalidation.
+//!
+class BlockCache
+{
+public:
+    //!
+    //! \brief Copy a cached block.
+    //!
+    //! \return \c true if the cache contains the block.
+    //!
+    bool Get(const uint256& hash, CBlock& block)
+    {
+        LOCK(cs_cache);
+
+        const auto iter = m_index.find(hash);
+
+        if (iter == m_index.end()) {
+            return false;
+        }
+
+        // Move the entry to the front of the recency list:
+        m_entries.splice(m_entries.begin(), m_entries, iter->second);
+        block = iter->second->m_block;
+
+        return true;
+    }
+
+    //!
+    //! \brief Store a copy of a block read from disk.
+    //!
+    void Put(const uint256& hash, const CBlock& block)
+    {
+        const size_t size = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+
+        LOCK(cs_cache);
+
+        if (size > nBlockCacheSize || m_index.count(hash)) {
+            return;
+        }
+
+        m_entries.emplace_front(hash, block, size);
+        m_index.emplace(hash, m_entries.begin());
+        m_size += size;
+
+        while (m_size > nBlockCacheSize) {
+            m_size -= m_entries.back().m_size;
+            m_index.erase(m_entries.back().m_hash);
+            m_entries.pop_back();
+        }
+    }
+
+private:
+    struct Entry
+    {
+        Entry(const uint256& hash, const CBlock& block, const size_t size)
+            : m_hash(hash), m_block(block), m_size(size)
+        {
+        }
+
+        uint256 m_hash;
+        CBlock m_block;
+        size_t m_size; //!< Serialized size of the block.
+    };
+
+    typedef std::list<Entry> EntryList;
+
+    CCriticalSection cs_cache;
+    EntryList m_entries; //!< Most recently used first.
+    std::unordered_map<uint256, EntryList::iterator, BlockHasher> m_index;
+    size_t m_size = 0; //!< Serialized size of the cached blocks.
+};
+
+BlockCache g_block_cache;
+} // anonymous namespace
+
 bool CBlock::ReadFromDisk(const CBlockIndex* pindex, bool fReadTransactions)
 {
     if (!fReadTransactions)
@@ -1273,32 +1682,91 @@ bool CBlock::ReadFromDisk(const CBlockIndex* pindex, bool fReadTransactions)
         *(static_cast<CBlockHeader*>(this)) = pindex->GetBlockHeader();
         return true;
     }
+    if (nBlockCacheSize > 0 && g_block_cache.Get(pindex->GetBlockHash(), *this))
+        return true;
+    if (pindex->IsPruned())
+        return false;
     if (!ReadFromDisk(pindex->nFile, pindex->nBlockPos, fReadTransactions))
         return false;
     if (GetHash(true) != pindex->GetBlockHash())
         return error("CBlock::ReadFromDisk() : GetHash() doesn't match index");
+    if (nBlockCacheSize > 0)
+        g_block_cache.Put(pindex->GetBlockHash(), *this);
     return true;
 }
 
-static const CBlock* GetOrphanRoot(const CBlock* pblock)
+size_t CBlock::ReadFromSpan(Span<const unsigned char> data, int nType, int nVersion)
+{
+    SpanReader reader(nType, nVersion, data);
+    reader >> *this;
+
+    return data.size() - reader.size();
+}
+
+Span<const unsigned char> CBlock::ReadFromBuffer(
+    std::shared_ptr<const CSerializeData> buffer,
+    int nType,
+    int nVersion)
 {
-    // Work back to the first block in the orphan chain
-    while (mapOrphanBlocks.count(pblock->hashPrevBlock))
-        pblock = mapOrphanBlocks[pblock->hashPrevBlock];
-    return pblock;
+    const Span<const unsigned char> data(
+        reinterpret_cast<const unsigned char*>(buffer->data()),
+        buffer->size());
+
+    const size_t nSize = ReadFromSpan(data, nType, nVersion);
+
+    m_raw_data = std::move(buffer);
+    m_raw_size = nSize;
+
+    return data.subspan(nSize);
+}
+
+uint256 CBlock::BuildMerkleTree() const
+{
+    size_t nTreeSize = vtx.size();
+
+    for (size_t nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+        nTreeSize += (nSize + 1) / 2;
+
+    vMerkleTree.clear();
+    vMerkleTree.reserve(nTreeSize);
+
+    for (auto const& tx : vtx)
+        vMerkleTree.push_back(tx.GetHash());
+
+    size_t j = 0;
+    for (size_t nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+    {
+        // Adjacent hashes of a level form the 64-byte inputs of the next:
+        const size_t nPairs = nSize / 2;
+        vMerkleTree.resize(vMerkleTree.size() + nPairs);
+        SHA256D64(vMerkleTree[j + nSize].begin(), vMerkleTree[j].begin(), nPairs);
+
+        // An odd level pairs its last hash with itself:
+        if (nSize & 1)
+        {
+            const uint256& last = vMerkleTree[j + nSize - 1];
+            vMerkleTree.push_back(Hash(BEGIN(last), END(last), BEGIN(last), END(last)));
+        }
+
+        j += nSize;
+    }
+
+    return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
 }
 
 bool CheckProofOfWork(uint256 hash, unsigned int nBits)
 {
-    CBigNum bnTarget;
-    bnTarget.SetCompact(nBits);
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(nBits, &fNegative, &fOverflow);
 
     // Check range
-    if (bnTarget <= 0 || bnTarget > bnProofOfWorkLimit)
+    if (fNegative || bnTarget == 0 || fOverflow || bnTarget > bnProofOfWorkLimit)
         return error("CheckProofOfWork() : nBits below minimum work");
 
     // Check proof of work matches claimed amount
-    if (UintToArith256(hash) > UintToArith256(bnTarget.getuint256()))
+    if (UintToArith256(hash) > bnTarget)
         return error("CheckProofOfWork() : hash doesn't match nBits");
 
     return true;
@@ -1402,6 +1870,21 @@ bool CTransaction::FetchInputs(CTxDB& txdb, const map<uint256, CTxIndex>& mapTes
     if (IsCoinBase())
         return true; // Coinbase transactions have no inputs to fetch.
 
+    // Read the index entries of the inputs that the proposed changes do not
+    // contain in one sorted pass over the database:
+    std::vector<uint256> vHashes;
+    for (const auto& txin : vin)
+    {
+        if (!inputsRet.count(txin.prevout.hash)
+            && !((fBlock || fMiner) && mapTestPool.count(txin.prevout.hash)))
+        {
+            vHashes.push_back(txin.prevout.hash);
+        }
+    }
+
+    map<uint256, CTxIndex> mapPrefetched;
+    const bool fPrefetched = vHashes.size() > 1 && txdb.ReadTxIndexes(vHashes, mapPrefetched);
+
     for (unsigned int i = 0; i < vin.size(); i++)
     {
         COutPoint prevout = vin[i].prevout;
@@ -1416,6 +1899,13 @@ bool CTransaction::FetchInputs(CTxDB& txdb, const map<uint256, CTxIndex>& mapTes
             // Get txindex from current proposed changes
             txindex = mapTestPool.find(prevout.hash)->second;
         }
+        else if (fPrefetched)
+        {
+            const auto mi = mapPrefetched.find(prevout.hash);
+            fFound = mi != mapPrefetched.end();
+            if (fFound)
+                txindex = mi->second;
+        }
         else
         {
             // Read txindex from txdb
@@ -1491,6 +1981,36 @@ int64_t CTransaction::GetValueIn(const MapPrevTx& inputs) const
 
 }
 
+namespace {
+//!
+//! \brief Published by PublishChainTipView(). Swapped atomically.
+//!
+std::shared_ptr<const ChainTipView> g_chain_tip_view = std::make_shared<const ChainTipView>();
+} // anonymous namespace
+
+void PublishChainTipView()
+{
+    auto view = std::make_shared<ChainTipView>();
+
+    if (pindexBest) {
+        view->hashBestChain = pindexBest->GetBlockHash();
+        view->nHeight = pindexBest->nHeight;
+        view->nTime = pindexBest->GetBlockTime();
+        view->nMoneySupply = pindexBest->nMoneySupply;
+        view->dDifficulty = GRC::GetCurrentDifficulty();
+        view->dTargetDifficulty = GRC::GetTargetDifficulty();
+        view->superblock = GRC::Quorum::CurrentSuperblock();
+        view->pending = GRC::Quorum::PendingSuperblock();
+    }
+
+    std::atomic_store(&g_chain_tip_view, std::shared_ptr<const ChainTipView>(std::move(view)));
+}
+
+std::shared_ptr<const ChainTipView> GetChainTipView()
+{
+    return std::atomic_load(&g_chain_tip_view);
+}
+
 static void UpdateSyncTime(const CBlockIndex* const pindexBest)
 {
     if (pindexBest && pindexBest->pprev) {
@@ -1502,6 +2022,9 @@ static void UpdateSyncTime(const CBlockIndex* const pindexBest)
     if (!OutOfSyncByAge()) {
         g_nTimeBestReceived.store(GetAdjustedTime());
     }
+
+    GRC::GetDifficultyWindow().SetTip(pindexBest);
+    PublishChainTipView();
 }
 
 bool OutOfSyncByAge()
@@ -1537,8 +2060,29 @@ unsigned int CTransaction::GetP2SHSigOpCount(const MapPrevTx& inputs) const
     return nSigOps;
 }
 
+bool CScriptCheck::operator()() const
+{
+    PERF_SCOPE("ScriptCheck");
+
+    const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
+
+    return VerifyScript(scriptSig, scriptPubKey, *ptxTo, nIn, nHashType);
+}
+
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+
+void ThreadScriptCheck()
+{
+    RenameThread("grc-scriptch");
+    scriptcheckqueue.Thread();
+}
+
+namespace {
+bool IsAssumedValid(const uint256& hash);
+} // anonymous namespace
+
 bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTxIndex>& mapTestPool, const CDiskTxPos& posThisTx,
-    const CBlockIndex* pindexBlock, bool fBlock, bool fMiner)
+    const CBlockIndex* pindexBlock, bool fBlock, bool fMiner, std::vector<CScriptCheck>* pvChecks)
 {
     // Take over previous transactions' spent pointers
     // fBlock is true when this is called from AcceptBlock when a new best-block is added to the blockchain
@@ -1548,6 +2092,16 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
     {
         int64_t nValueIn = 0;
         int64_t nFees = 0;
+
+        // Skip ECDSA signature verification when connecting blocks (fBlock=true)
+        // before the last blockchain checkpoint or below the -assumevalid block.
+        // This is safe because block merkle hashes are still computed and
+        // checked, and any change will be caught at the next checkpoint or
+        // change the hash of the assumed valid block.
+        const bool fSkipSignatures = fBlock
+            && (nBestHeight < Checkpoints::GetTotalBlocksEstimate()
+                || (pindexBlock && IsAssumedValid(pindexBlock->GetBlockHash())));
+
         for (unsigned int i = 0; i < vin.size(); i++)
         {
             COutPoint prevout = vin[i].prevout;
@@ -1612,14 +2166,16 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
 
             }
 
-            // Skip ECDSA signature verification when connecting blocks (fBlock=true)
-            // before the last blockchain checkpoint. This is safe because block merkle hashes are
-            // still computed and checked, and any change will be caught at the next checkpoint.
-
-            if (!(fBlock && (nBestHeight < Checkpoints::GetTotalBlocksEstimate())))
+            if (!fSkipSignatures)
             {
                 // Verify signature
-                if (!VerifySignature(txPrev, *this, i, 0))
+                CScriptCheck check(txPrev, *this, i, 0);
+                if (pvChecks)
+                {
+                    pvChecks->push_back(CScriptCheck());
+                    check.swap(pvChecks->back());
+                }
+                else if (!check())
                 {
                     return DoS(100,error("ConnectInputs() : %s VerifySignature failed", GetHash().ToString().substr(0,10).c_str()));
                 }
@@ -1663,22 +2219,52 @@ bool CTransaction::ConnectInputs(CTxDB& txdb, MapPrevTx inputs, map<uint256, CTx
 
 bool CBlock::DisconnectBlock(CTxDB& txdb, CBlockIndex* pindex)
 {
-    // Disconnect in reverse order
+    const uint256 hashBlock = pindex->GetBlockHash();
     bool bDiscTxFailed = false;
-    for (int i = vtx.size()-1; i >= 0; i--)
+    CBlockUndo undo;
+
+    if (txdb.ReadBlockUndo(hashBlock, undo))
     {
-        if (!vtx[i].DisconnectInputs(txdb))
+        // Restore the spent transaction indexes as they were before the
+        // block connected:
+        for (const auto& entry : undo.vSpentTxIndex)
         {
-            bDiscTxFailed = true;
+            if (!txdb.UpdateTxIndex(entry.first, entry.second))
+                return error("DisconnectBlock() : UpdateTxIndex failed");
         }
-    }
 
-    // Update block index on disk without changing it in memory.
-    // The memory index structure will be changed after the db commits.
-    // Brod: I do not like this...
-    if (pindex->pprev)
-    {
-        CDiskBlockIndex blockindexPrev(pindex->pprev);
+        // See CTransaction::DisconnectInputs() for why this may fail:
+        for (const auto& tx : vtx)
+            txdb.EraseTxIndex(tx);
+
+        if (!txdb.EraseBlockUndo(hashBlock))
+            return error("DisconnectBlock() : EraseBlockUndo failed");
+    }
+    else
+    {
+        // No undo record for blocks connected deeper than BLOCK_UNDO_DEPTH
+        // or by older versions. Disconnect in reverse order:
+        for (int i = vtx.size()-1; i >= 0; i--)
+        {
+            if (!vtx[i].DisconnectInputs(txdb))
+            {
+                bDiscTxFailed = true;
+            }
+        }
+    }
+
+    if ((fAddressIndex || fSpentIndex) && !DisconnectAddressIndex(txdb, *this, pindex->nHeight))
+        return error("DisconnectBlock() : reverting the address index failed");
+
+    if (fResearchIndex && !GRC::DisconnectResearchHistory(txdb, pindex->nHeight))
+        return error("DisconnectBlock() : reverting the research history failed");
+
+    // Update block index on disk without changing it in memory.
+    // The memory index structure will be changed after the db commits.
+    // Brod: I do not like this...
+    if (pindex->pprev)
+    {
+        CDiskBlockIndex blockindexPrev(pindex->pprev);
         blockindexPrev.hashNext.SetNull();
         if (!txdb.WriteBlockIndex(blockindexPrev))
             return error("DisconnectBlock() : WriteBlockIndex failed");
@@ -1711,6 +2297,8 @@ const GRC::Claim& CBlock::GetClaim() const
 
 GRC::Claim CBlock::PullClaim()
 {
+    ReleaseRawData();
+
     if (nVersion >= 11 || !vtx[0].vContracts.empty()) {
         return vtx[0].vContracts[0].PullPayloadAs<GRC::Claim>();
     }
@@ -1740,45 +2328,48 @@ GRC::SuperblockPtr CBlock::GetSuperblock(const CBlockIndex* const pindex) const
 namespace {
 int64_t ReturnCurrentMoneySupply(CBlockIndex* pindexcurrent)
 {
-    if (pindexcurrent->pprev)
-    {
-        // If previous exists, and previous money supply > Genesis, OK to use it:
-        if (pindexcurrent->pprev->nHeight > 11 && pindexcurrent->pprev->nMoneySupply > nGenesisSupply)
-        {
-            return pindexcurrent->pprev->nMoneySupply;
-        }
-    }
+    const CBlockIndex* const pindexPrev = pindexcurrent->pprev;
+
     // Special case where block height < 12, use standard old logic:
-    if (pindexcurrent->nHeight < 12)
-    {
-        return (pindexcurrent->pprev? pindexcurrent->pprev->nMoneySupply : 0);
+    if (pindexcurrent->nHeight < 12) {
+        return pindexPrev ? pindexPrev->nMoneySupply : 0;
     }
-    // At this point, either the last block pointer was NULL, or the client erased the money supply previously, fix it:
-    CBlockIndex* pblockIndex = pindexcurrent;
-    CBlockIndex* pblockMemory = pindexcurrent;
-    int nMinDepth = (pindexcurrent->nHeight)-140000;
-    if (nMinDepth < 12) nMinDepth=12;
-    while (pblockIndex->nHeight > nMinDepth)
-    {
-        pblockIndex = pblockIndex->pprev;
-        LogPrintf("Money Supply height %d", pblockIndex->nHeight);
 
-        if (pblockIndex == NULL || !pblockIndex->IsInMainChain()) continue;
-        if (pblockIndex == pindexGenesisBlock)
-        {
+    // Each connected block stores the money supply in its index entry, so the
+    // previous block normally supplies it directly:
+    if (pindexPrev && pindexPrev->nMoneySupply > nGenesisSupply) {
+        return pindexPrev->nMoneySupply;
+    }
+
+    // An index written by an old client may lack the money supply. Resume
+    // from the nearest ancestor that has one. Warn once instead of logging
+    // every block of the walk:
+    static bool fWarned = false;
+
+    if (!fWarned) {
+        LogPrintf("WARNING: %s: block %d has no money supply. Resolving it from"
+            " the nearest ancestor. Consider -reindex.", __func__, pindexcurrent->nHeight);
+        fWarned = true;
+    }
+
+    const int nMinDepth = std::max(12, pindexcurrent->nHeight - 140000);
+
+    for (const CBlockIndex* pindex = pindexPrev;
+        pindex && pindex->nHeight > nMinDepth;
+        pindex = pindex->pprev)
+    {
+        if (pindex == pindexGenesisBlock) {
             return nGenesisSupply;
         }
-        if (pblockIndex->nMoneySupply > nGenesisSupply)
-        {
-            //Set index back to original pointer
-            pindexcurrent = pblockMemory;
-            //Return last valid money supply
-            return pblockIndex->nMoneySupply;
+
+        if (pindex->nMoneySupply > nGenesisSupply) {
+            return pindex->nMoneySupply;
         }
     }
-    // At this point, we fall back to the old logic with a minimum of the genesis supply (should never happen - if it did, blockchain will need rebuilt anyway due to other fields being invalid):
-    pindexcurrent = pblockMemory;
-    return (pindexcurrent->pprev? pindexcurrent->pprev->nMoneySupply : nGenesisSupply);
+
+    // Should never happen. If it did, the block index needs a rebuild anyway
+    // because other fields would be invalid too:
+    return pindexPrev ? pindexPrev->nMoneySupply : nGenesisSupply;
 }
 
 bool GetCoinstakeAge(CTxDB& txdb, const CBlock& block, uint64_t& out_coin_age)
@@ -2114,7 +2705,10 @@ bool TryLoadSuperblock(
             superblock.m_timestamp);
     }
 
-    GRC::Quorum::PushSuperblock(std::move(superblock));
+    GRC::Quorum::PushSuperblock(std::move(superblock), pindex);
+
+    // The verified beacons and the superblock age changed:
+    WakeScraper(true);
 
     return true;
 }
@@ -2126,6 +2720,8 @@ bool GridcoinConnectBlock(
     const int64_t total_claimed,
     const int64_t fees)
 {
+    PERF_SCOPE("GridcoinConnectBlock");
+
     const GRC::Claim& claim = block.GetClaim();
 
     if (pindex->nHeight > nGrandfather) {
@@ -2176,6 +2772,8 @@ bool GridcoinConnectBlock(
 
 bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
 {
+    PERF_SCOPE("ConnectBlock");
+
     // Check it again in case a previous version let a bad block in, but skip BlockSig checking
     if (!CheckBlock(pindex->nHeight, !fJustCheck, !fJustCheck, false, false))
     {
@@ -2195,6 +2793,9 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
     }
 
     map<uint256, CTxIndex> mapQueuedChanges;
+    std::vector<CScript> vSpentScripts; // for the compact block filter
+    CAddressIndexUpdate addressIndexUpdate(pindex->nHeight);
+    CBlockUndo undo;
     int64_t nFees = 0;
     int64_t nValueIn = 0;
     int64_t nValueOut = 0;
@@ -2203,6 +2804,10 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
 
     bool bIsDPOR = false;
 
+    // Script checks for the whole block are handed to the verification
+    // worker pool (-par) and collected before anything is committed:
+    CCheckQueueControl<CScriptCheck> control(nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+
     if (nVersion >= 8 && pindex->nStakeModifier == 0 && pindex->nStakeModifierChecksum == 0)
     {
         uint256 tmp_hashProof;
@@ -2212,7 +2817,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
 
     for (auto &tx : vtx)
     {
-        uint256 hashTx = tx.GetHash();
+        uint256 hashTx = tx.GetHash(true);
 
         // Do not allow blocks that contain transactions which 'overwrite' older transactions,
         // unless those are already completely spent.
@@ -2252,6 +2857,17 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
             if (!tx.FetchInputs(txdb, mapQueuedChanges, true, false, mapInputs, fInvalid))
                 return false;
 
+            // Record the state of the indexes that this transaction spends
+            // from before the block first changes them:
+            if (!fJustCheck)
+            {
+                for (const auto& input : mapInputs)
+                {
+                    if (!mapQueuedChanges.count(input.first))
+                        undo.vSpentTxIndex.emplace_back(input.first, input.second.first);
+                }
+            }
+
             // Add in sigops done by pay-to-script-hash inputs;
             // this is to prevent a "rogue miner" from creating
             // an incredibly-expensive-to-validate block.
@@ -2259,6 +2875,16 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
             if (nSigOps > MAX_BLOCK_SIGOPS)
                 return DoS(100, error("ConnectBlock[] : too many sigops"));
 
+            if (fBlockFilterIndex && !fJustCheck)
+            {
+                for (const auto& txin : tx.vin)
+                {
+                    const CTransaction& txPrev = mapInputs[txin.prevout.hash].second;
+                    if (txin.prevout.n < txPrev.vout.size())
+                        vSpentScripts.push_back(txPrev.vout[txin.prevout.n].scriptPubKey);
+                }
+            }
+
             int64_t nTxValueIn = tx.GetValueIn(mapInputs);
             int64_t nTxValueOut = tx.GetValueOut();
             nValueIn += nTxValueIn;
@@ -2306,13 +2932,21 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
                 return false;
             }
 
-            if (!tx.ConnectInputs(txdb, mapInputs, mapQueuedChanges, posThisTx, pindex, true, false))
+            std::vector<CScriptCheck> vChecks;
+            if (!tx.ConnectInputs(txdb, mapInputs, mapQueuedChanges, posThisTx, pindex, true, false, nScriptCheckThreads ? &vChecks : nullptr))
                 return false;
+            control.Add(vChecks);
         }
 
+        if ((fAddressIndex || fSpentIndex) && !fJustCheck)
+            addressIndexUpdate.AddTransaction(tx, mapInputs);
+
         mapQueuedChanges[hashTx] = CTxIndex(posThisTx, tx.vout.size());
     }
 
+    if (!control.Wait())
+        return DoS(100, error("ConnectBlock[] : script verification failed"));
+
     if (IsResearchAgeEnabled(pindex->nHeight)
         && !GridcoinConnectBlock(*this, pindex, txdb, nStakeReward, nFees))
     {
@@ -2340,6 +2974,31 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
             return error("ConnectBlock[] : UpdateTxIndex failed");
     }
 
+    if (fBlockFilterIndex && !txdb.WriteBlockFilter(BlockFilter(*this, vSpentScripts)))
+        return error("ConnectBlock[] : WriteBlockFilter failed");
+
+    if (fBlockStatsIndex && !txdb.WriteBlockStats(pindex->GetBlockHash(), CBlockStats(*this)))
+        return error("ConnectBlock[] : WriteBlockStats failed");
+
+    if ((fAddressIndex || fSpentIndex) && !addressIndexUpdate.Write(txdb))
+        return error("ConnectBlock[] : writing the address index failed");
+
+    if (fResearchIndex && IsResearchAgeEnabled(pindex->nHeight) && !GRC::WriteResearchHistory(txdb, pindex))
+        return error("ConnectBlock[] : writing the research history failed");
+
+    if (!txdb.WriteBlockUndo(pindex->GetBlockHash(), undo))
+        return error("ConnectBlock[] : WriteBlockUndo failed");
+
+    // A reorganization deeper than this falls back to reading the previous
+    // transaction indexes:
+    if (pindex->nHeight > BLOCK_UNDO_DEPTH)
+    {
+        const CBlockIndex* pindexExpired = pindex->GetAncestor(pindex->nHeight - BLOCK_UNDO_DEPTH);
+
+        if (pindexExpired && !txdb.EraseBlockUndo(pindexExpired->GetBlockHash()))
+            return error("ConnectBlock[] : EraseBlockUndo failed");
+    }
+
     // Update block index on disk without changing it in memory.
     // The memory index structure will be changed after the db commits.
     if (pindex->pprev)
@@ -2351,8 +3010,7 @@ bool CBlock::ConnectBlock(CTxDB& txdb, CBlockIndex* pindex, bool fJustCheck)
     }
 
     // Watch for transactions paying to me
-    for (auto const& tx : vtx)
-        SyncWithWallets(tx, this, true);
+    SyncBlockWithWallets(*this);
 
     return true;
 }
@@ -2403,6 +3061,15 @@ bool ForceReorganizeToHash(uint256 NewHash)
 bool DisconnectBlocksBatch(CTxDB& txdb, list<CTransaction>& vResurrect, unsigned& cnt_dis, CBlockIndex* pcommon)
 {
     set<string> vRereadCPIDs;
+
+    // Read the blocks to disconnect on background threads while the loop
+    // reverts the blocks read before them:
+    std::vector<const CBlockIndex*> vDisconnect;
+    for (const CBlockIndex* pindex = pindexBest; pindex && pindex != pcommon; pindex = pindex->pprev)
+        vDisconnect.push_back(pindex);
+
+    GRC::BlockPrefetcher prefetcher(std::move(vDisconnect));
+
     while(pindexBest != pcommon)
     {
         if(!pindexBest->pprev)
@@ -2411,7 +3078,7 @@ bool DisconnectBlocksBatch(CTxDB& txdb, list<CTransaction>& vResurrect, unsigned
         LogPrint(BCLog::LogFlags::VERBOSE, "DisconnectBlocksBatch: %s",pindexBest->GetBlockHash().GetHex());
 
         CBlock block;
-        if (!block.ReadFromDisk(pindexBest))
+        if (!prefetcher.Take(block))
             return error("DisconnectBlocksBatch: ReadFromDisk for disconnect failed"); /*fatal*/
         if (!block.DisconnectBlock(txdb, pindexBest))
             return error("DisconnectBlocksBatch: DisconnectBlock %s failed", pindexBest->GetBlockHash().ToString().c_str()); /*fatal*/
@@ -2482,8 +3149,97 @@ bool DisconnectBlocksBatch(CTxDB& txdb, list<CTransaction>& vResurrect, unsigned
     return true;
 }
 
+namespace {
+//!
+//! \brief Block index entries added since they were last written to disk.
+//!
+//! AddToBlockIndex() does not write new entries on its own. Blocks that
+//! extend the chain write their entries in the same database transaction
+//! that connects them and moves the tip, so a node that restarts after a
+//! crash finds the index consistent with the chain tip that it recorded.
+//! Entries for blocks that do not connect are written in one batch when
+//! FlushBlockIndex() runs. A crash loses those entries only, and the node
+//! requests the blocks again from peers.
+//!
+//! Guarded by cs_main.
+//!
+std::set<CBlockIndex*> setDirtyBlockIndex;
+
+//!
+//! \brief Time of the last flush of the entries that did not connect.
+//!
+int64_t nLastBlockIndexFlush = 0;
+
+//!
+//! \brief Maximum number of unwritten entries before a flush.
+//!
+constexpr size_t MAX_DIRTY_BLOCK_INDEX = 500;
+
+//!
+//! \brief Seconds between flushes of the entries that did not connect.
+//!
+constexpr int64_t BLOCK_INDEX_FLUSH_INTERVAL = 60;
+
+//!
+//! \brief Add the unwritten block index entries to a database transaction.
+//!
+//! \return \c false if a write failed.
+//!
+bool WriteDirtyBlockIndex(CTxDB& txdb)
+{
+    for (const auto& pindex : setDirtyBlockIndex) {
+        if (!txdb.WriteBlockIndex(CDiskBlockIndex(pindex))) {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // anonymous namespace
+
+bool FlushBlockIndex(bool fForce)
+{
+    AssertLockHeld(cs_main);
+
+    if (setDirtyBlockIndex.empty()) {
+        return true;
+    }
+
+    if (!fForce
+        && setDirtyBlockIndex.size() < MAX_DIRTY_BLOCK_INDEX
+        && GetAdjustedTime() - nLastBlockIndexFlush < BLOCK_INDEX_FLUSH_INTERVAL)
+    {
+        return true;
+    }
+
+    CTxDB txdb;
+
+    if (!txdb.TxnBegin()) {
+        return error("%s: TxnBegin failed", __func__);
+    }
+
+    if (!WriteDirtyBlockIndex(txdb)) {
+        txdb.TxnAbort();
+        return error("%s: WriteBlockIndex failed", __func__);
+    }
+
+    if (!txdb.TxnCommit()) {
+        return error("%s: TxnCommit failed", __func__);
+    }
+
+    LogPrint(BCLog::LogFlags::VERBOSE, "%s: wrote %" PRIszu " block index entries",
+        __func__, setDirtyBlockIndex.size());
+
+    setDirtyBlockIndex.clear();
+    nLastBlockIndexFlush = GetAdjustedTime();
+
+    return true;
+}
+
 bool ReorganizeChain(CTxDB& txdb, unsigned &cnt_dis, unsigned &cnt_con, CBlock &blockNew, CBlockIndex* pindexNew)
 {
+    PERF_SCOPE("ReorganizeChain");
+
     assert(pindexNew);
     //assert(!pindexNew->pnext);
     //assert(pindexBest || hashBestChain == pindexBest->GetBlockHash());
@@ -2535,6 +3291,18 @@ bool ReorganizeChain(CTxDB& txdb, unsigned &cnt_dis, unsigned &cnt_con, CBlock &
         }
     }
 
+    for(CBlockIndex *p = pindexNew; p != pcommon; p=p->pprev)
+        vConnect.push_front(p);
+
+    // Start reading the blocks of the new branch so that the reads overlap
+    // with the disconnects. The new tip is already in memory:
+    std::unique_ptr<GRC::BlockPrefetcher> prefetcher;
+    if (vConnect.size() > 1)
+    {
+        std::vector<const CBlockIndex*> vRead(vConnect.begin(), std::prev(vConnect.end()));
+        prefetcher = MakeUnique<GRC::BlockPrefetcher>(std::move(vRead));
+    }
+
     /* disconnect blocks */
     if(pcommon!=pindexBest)
     {
@@ -2555,9 +3323,6 @@ bool ReorganizeChain(CTxDB& txdb, unsigned &cnt_dis, unsigned &cnt_con, CBlock &
 
     if (LogInstance().WillLogCategory(BCLog::LogFlags::VERBOSE) && cnt_dis > 0) LogPrintf("ReorganizeChain: disconnected %d blocks",cnt_dis);
 
-    for(CBlockIndex *p = pindexNew; p != pcommon; p=p->pprev)
-        vConnect.push_front(p);
-
     /* Connect blocks */
     for(auto const pindex : vConnect)
     {
@@ -2566,7 +3331,7 @@ bool ReorganizeChain(CTxDB& txdb, unsigned &cnt_dis, unsigned &cnt_con, CBlock &
 
         if(pindex!=pindexNew)
         {
-            if (!block.ReadFromDisk(pindex))
+            if (!prefetcher->Take(block))
                 return error("ReorganizeChain: ReadFromDisk for connect failed");
             assert(pindex->GetBlockHash()==block.GetHash(true));
         }
@@ -2585,6 +3350,14 @@ bool ReorganizeChain(CTxDB& txdb, unsigned &cnt_dis, unsigned &cnt_con, CBlock &
         if (!txdb.TxnBegin())
             return error("ReorganizeChain: TxnBegin failed");
 
+        // Write any new block index entries with the first block connected.
+        // ConnectBlock() overwrites the entries that it changes:
+        if (!WriteDirtyBlockIndex(txdb))
+        {
+            txdb.TxnAbort();
+            return error("ReorganizeChain: WriteBlockIndex failed");
+        }
+
         if (pindexGenesisBlock == NULL)
         {
             if(hash != (!fTestNet ? hashGenesisBlock : hashGenesisBlockTestNet))
@@ -2625,6 +3398,8 @@ bool ReorganizeChain(CTxDB& txdb, unsigned &cnt_dis, unsigned &cnt_con, CBlock &
         if (!txdb.TxnCommit())
             return error("ReorganizeChain: TxnCommit failed");
 
+        setDirtyBlockIndex.clear();
+
         // Add to current best branch
         if(pindex->pprev)
         {
@@ -2679,6 +3454,8 @@ bool SetBestChain(CTxDB& txdb, CBlock &blockNew, CBlockIndex* pindexNew)
     if(!success)
         return false;
 
+    GRC::CheckpointContracts(txdb, pindexBest);
+
     /* Fix up after block connecting */
 
     // Update best block in wallet (so we can detect restored wallets)
@@ -2718,7 +3495,7 @@ bool SetBestChain(CTxDB& txdb, CBlock &blockNew, CBlockIndex* pindexNew)
 // age (trust score) of competing branches.
 bool CTransaction::GetCoinAge(CTxDB& txdb, uint64_t& nCoinAge) const
 {
-    CBigNum bnCentSecond = 0;  // coin age in the unit of cent-seconds
+    arith_uint256 bnCentSecond = 0;  // coin age in the unit of cent-seconds
     nCoinAge = 0;
 
     if (IsCoinBase())
@@ -2746,16 +3523,17 @@ bool CTransaction::GetCoinAge(CTxDB& txdb, uint64_t& nCoinAge) const
         }
 
         int64_t nValueIn = txPrev.vout[txin.prevout.n].nValue;
-        bnCentSecond += CBigNum(nValueIn) * (nTime-txPrev.nTime) / CENT;
+        // Amounts of outputs in the chain are never negative:
+        bnCentSecond += arith_uint256(nValueIn) * (nTime-txPrev.nTime) / arith_uint256(CENT);
 
         if (LogInstance().WillLogCategory(BCLog::LogFlags::VERBOSE) && GetBoolArg("-printcoinage"))
             LogPrintf("coin age nValueIn=%" PRId64 " nTimeDiff=%d bnCentSecond=%s", nValueIn, nTime - txPrev.nTime, bnCentSecond.ToString());
     }
 
-    CBigNum bnCoinDay = bnCentSecond * CENT / COIN / (24 * 60 * 60);
+    arith_uint256 bnCoinDay = bnCentSecond * CENT / arith_uint256(COIN) / arith_uint256(24 * 60 * 60);
     if (LogInstance().WillLogCategory(BCLog::LogFlags::VERBOSE) && GetBoolArg("-printcoinage"))
         LogPrintf("coin age bnCoinDay=%s", bnCoinDay.ToString());
-    nCoinAge = bnCoinDay.getuint64();
+    nCoinAge = bnCoinDay.GetLow64();
     return true;
 }
 
@@ -2767,15 +3545,14 @@ bool CBlock::AddToBlockIndex(unsigned int nFile, unsigned int nBlockPos, const u
         return error("AddToBlockIndex() : %s already exists", hash.ToString().substr(0,20).c_str());
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(nFile, nBlockPos, *this);
-    if (!pindexNew)
-        return error("AddToBlockIndex() : new CBlockIndex failed");
+    CBlockIndex* pindexNew = NewBlockIndex(CBlockIndex(nFile, nBlockPos, *this));
     pindexNew->phashBlock = &hash;
     BlockMap::iterator miPrev = mapBlockIndex.find(hashPrevBlock);
     if (miPrev != mapBlockIndex.end())
     {
         pindexNew->pprev = (*miPrev).second;
         pindexNew->nHeight = pindexNew->pprev->nHeight + 1;
+        pindexNew->BuildSkip();
     }
 
     // ppcoin: compute chain trust score
@@ -2796,6 +3573,7 @@ bool CBlock::AddToBlockIndex(unsigned int nFile, unsigned int nBlockPos, const u
         LogPrintf("AddToBlockIndex() : ComputeNextStakeModifier() failed");
     }
     pindexNew->SetStakeModifier(nStakeModifier, fGeneratedStakeModifier);
+    pindexNew->BuildStakeModifierLink();
     pindexNew->nStakeModifierChecksum = GRC::GetStakeModifierChecksum(pindexNew);
 
     // Add to mapBlockIndex
@@ -2804,27 +3582,29 @@ bool CBlock::AddToBlockIndex(unsigned int nFile, unsigned int nBlockPos, const u
         setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
     pindexNew->phashBlock = &((*mi).first);
 
-    // Write to disk block index
-    CTxDB txdb;
-    if (!txdb.TxnBegin())
-        return false;
-    txdb.WriteBlockIndex(CDiskBlockIndex(pindexNew));
-    if (!txdb.TxnCommit())
-        return false;
-
     LOCK(cs_main);
 
+    // Written to disk with the transaction that connects the block or by
+    // the next flush:
+    setDirtyBlockIndex.insert(pindexNew);
+
     // New best
+    CTxDB txdb;
     if (pindexNew->nChainTrust > nBestChainTrust)
         if (!SetBestChain(txdb, *this, pindexNew))
             return false;
 
+    if (!FlushBlockIndex(false))
+        return false;
+
     if (pindexNew == pindexBest)
     {
         // Notify UI to display prev block's coinbase if it was ours
         static uint256 hashPrevBestCoinBase;
         UpdatedTransaction(hashPrevBestCoinBase);
         hashPrevBestCoinBase = vtx[0].GetHash();
+
+        WakeStakeMiner();
     }
 
     uiInterface.NotifyBlocksChanged();
@@ -2833,6 +3613,8 @@ bool CBlock::AddToBlockIndex(unsigned int nFile, unsigned int nBlockPos, const u
 
 bool CBlock::CheckBlock(int height1, bool fCheckPOW, bool fCheckMerkleRoot, bool fCheckSig, bool fLoadingIndex) const
 {
+    PERF_SCOPE("CheckBlock");
+
     // Allow the genesis block to pass.
     if(hashPrevBlock.IsNull() &&
        GetHash(true) == (fTestNet ? hashGenesisBlockTestNet : hashGenesisBlock))
@@ -2941,7 +3723,7 @@ bool CBlock::CheckBlock(int height1, bool fCheckPOW, bool fCheckMerkleRoot, bool
     set<uint256> uniqueTx;
     for (auto const& tx : vtx)
     {
-        uniqueTx.insert(tx.GetHash());
+        uniqueTx.insert(tx.GetHash(true));
     }
     if (uniqueTx.size() != vtx.size())
         return DoS(100, error("CheckBlock[] : duplicate transaction"));
@@ -2963,6 +3745,8 @@ bool CBlock::CheckBlock(int height1, bool fCheckPOW, bool fCheckMerkleRoot, bool
 
 bool CBlock::AcceptBlock(bool generated_by_me)
 {
+    PERF_SCOPE("AcceptBlock");
+
     AssertLockHeld(cs_main);
 
     if (nVersion > CURRENT_VERSION)
@@ -3122,14 +3906,67 @@ bool CBlock::AcceptBlock(bool generated_by_me)
 }
 
 
+/** Turn the lowest '1' bit in the binary representation of a number into a '0'. */
+static inline int InvertLowestOne(int n) { return n & (n - 1); }
+
+/** Compute what height to jump back to with the CBlockIndex::pskip pointer. */
+static inline int GetSkipHeight(int height) {
+    if (height < 2)
+        return 0;
+
+    // Determine which height to jump back to. Any number strictly lower than height is acceptable,
+    // but the following expression seems to perform well in simulations (max 110 steps to go back
+    // up to 2**18 blocks).
+    return (height & 1) ? InvertLowestOne(InvertLowestOne(height - 1)) + 1 : InvertLowestOne(height);
+}
+
+const CBlockIndex* CBlockIndex::GetAncestor(int height) const
+{
+    if (height > nHeight || height < 0)
+        return NULL;
+
+    const CBlockIndex* pindexWalk = this;
+    int heightWalk = nHeight;
+    while (heightWalk > height) {
+        int heightSkip = GetSkipHeight(heightWalk);
+        int heightSkipPrev = GetSkipHeight(heightWalk - 1);
+        if (pindexWalk->pskip != NULL &&
+            (heightSkip == height ||
+             (heightSkip > height && !(heightSkipPrev < heightSkip - 2 &&
+                                       heightSkipPrev >= height)))) {
+            // Only follow pskip if pprev->pskip isn't better than pskip->pprev.
+            pindexWalk = pindexWalk->pskip;
+            heightWalk = heightSkip;
+        } else {
+            assert(pindexWalk->pprev);
+            pindexWalk = pindexWalk->pprev;
+            heightWalk--;
+        }
+    }
+    return pindexWalk;
+}
+
+CBlockIndex* CBlockIndex::GetAncestor(int height)
+{
+    return const_cast<CBlockIndex*>(static_cast<const CBlockIndex*>(this)->GetAncestor(height));
+}
+
+void CBlockIndex::BuildSkip()
+{
+    if (pprev)
+        pskip = pprev->GetAncestor(GetSkipHeight(nHeight));
+}
+
 arith_uint256 CBlockIndex::GetBlockTrust() const
 {
-    CBigNum bnTarget;
-    bnTarget.SetCompact(nBits);
-    if (bnTarget <= 0) return 0;
-    int64_t block_mag = 0;
-    uint256 chaintrust = (((CBigNum(1)<<256) / (bnTarget+1)) - (block_mag)).getuint256();
-    return UintToArith256(chaintrust);
+    bool fNegative;
+    bool fOverflow;
+    arith_uint256 bnTarget;
+    bnTarget.SetCompact(nBits, &fNegative, &fOverflow);
+    if (fNegative || fOverflow || bnTarget == 0) return 0;
+    // 2**256 / (bnTarget+1) without the 257-bit numerator. Compact targets
+    // are below 2**255, so bnTarget+1 does not wrap:
+    return (~bnTarget / (bnTarget + 1)) + 1;
 }
 
 bool GridcoinServices()
@@ -3219,21 +4056,53 @@ bool AskForOutstandingBlocks(uint256 hashStart)
     return true;
 }
 
+BlockDownloadScheduler g_block_download;
+
+namespace {
+//!
+//! \brief Determine whether a block may skip its script checks because it is
+//! an ancestor of the -assumevalid block.
+//!
+//! A peer cannot forge the hash of the assumed block, so a header chain that
+//! contains it links the block to it. The block index does not store headers
+//! ahead of the blocks, so this only applies to the blocks that headers-first
+//! synchronization downloads. The contract, claim and superblock checks still
+//! run for these blocks.
+//!
+//! The block hash does not cover the block signature, so every block checks
+//! it: a peer could otherwise replace the signature of a proof-of-stake block
+//! without changing its hash.
+//!
+//! \param hash Hash of the block to check.
+//!
+bool IsAssumedValid(const uint256& hash)
+{
+    AssertLockHeld(cs_main);
+
+    if (hashAssumeValid.IsNull()) {
+        return false;
+    }
+
+    return g_block_download.IsAncestorOf(hash, hashAssumeValid);
+}
+} // anonymous namespace
+
 bool ProcessBlock(CNode* pfrom, CBlock* pblock, bool generated_by_me)
 {
     AssertLockHeld(cs_main);
+    PERF_SCOPE("ProcessBlock");
 
     // Check for duplicate
     uint256 hash = pblock->GetHash(true);
     if (mapBlockIndex.count(hash))
         return error("ProcessBlock() : already have block %d %s", mapBlockIndex[hash]->nHeight, hash.ToString().c_str());
-    if (mapOrphanBlocks.count(hash))
+    if (g_orphan_blocks.Contains(hash))
         return error("ProcessBlock() : already have block (orphan) %s", hash.ToString().c_str());
 
     // ppcoin: check proof-of-stake
     // Limited duplicity on stake: prevents block flood attack
     // Duplicate stake allowed only when there is orphan child block
-    if (pblock->IsProofOfStake() && setStakeSeen.count(pblock->GetProofOfStake()) && !mapOrphanBlocksByPrev.count(hash))
+    if (pblock->IsProofOfStake() && setStakeSeen.count(pblock->GetProofOfStake()) && !g_orphan_blocks.HasChildren(hash))
         return error("ProcessBlock() : duplicate proof-of-stake (%s, %d) for block %s", pblock->GetProofOfStake().first.ToString().c_str(),
         pblock->GetProofOfStake().second,
         hash.ToString().c_str());
@@ -3274,22 +4143,30 @@ bool ProcessBlock(CNode* pfrom, CBlock* pblock, bool generated_by_me)
         {
             // Limited duplicity on stake: prevents block flood attack
             // Duplicate stake allowed only when there is orphan child block
-            if (setStakeSeenOrphan.count(pblock->GetProofOfStake()) &&
-                !mapOrphanBlocksByPrev.count(hash))
+            if (g_orphan_blocks.HasStake(pblock->GetProofOfStake()) &&
+                !g_orphan_blocks.HasChildren(hash))
                 return error("ProcessBlock() : duplicate proof-of-stake (%s, %d) for orphan block %s",
                              pblock->GetProofOfStake().first.ToString().c_str(),
                              pblock->GetProofOfStake().second,
                              hash.ToString().c_str());
-            else
-                setStakeSeenOrphan.insert(pblock->GetProofOfStake());
         }
 
-        CBlock* pblock2 = new CBlock(*pblock);
-        mapOrphanBlocks.insert(make_pair(hash, pblock2));
-        mapOrphanBlocksByPrev.insert(make_pair(pblock->hashPrevBlock, pblock2));
+        const CBlock* const pblock2 = g_orphan_blocks.Add(*pblock, pfrom->GetId(), GetTime());
+
+        // The pool evicts a block that does not fit. The headers-first
+        // download requests it again when its turn comes:
+        if (!pblock2) {
+            return true;
+        }
+
+        // The headers-first download requests blocks out of order and asks
+        // for the missing parents itself:
+        if (fHeadersFirst && g_block_download.IsScheduled(hash)) {
+            return true;
+        }
 
         // Ask this guy to fill in what we're missing
-        const CBlock* const pblock_root = GetOrphanRoot(pblock2);
+        const CBlock* const pblock_root = g_orphan_blocks.GetRoot(pblock2);
         pfrom->PushGetBlocks(pindexBest, pblock_root->GetHash(true));
         // ppcoin: getblocks may not obtain the ancestor block rejected
         // earlier by duplicate-stake check so we ask for it again directly
@@ -3305,7 +4182,10 @@ bool ProcessBlock(CNode* pfrom, CBlock* pblock, bool generated_by_me)
             // request time first to guarantee that the node does not postpone
             // the message:
             //
-            mapAlreadyAskedFor[ancestor_request] = 0;
+            {
+                LOCK(cs_mapAlreadyAskedFor);
+                mapAlreadyAskedFor[ancestor_request] = 0;
+            }
             pfrom->AskFor(ancestor_request);
         }
 
@@ -3321,22 +4201,16 @@ bool ProcessBlock(CNode* pfrom, CBlock* pblock, bool generated_by_me)
     vWorkQueue.push_back(hash);
     for (unsigned int i = 0; i < vWorkQueue.size(); i++)
     {
-        uint256 hashPrev = vWorkQueue[i];
-        for (multimap<uint256, CBlock*>::iterator mi = mapOrphanBlocksByPrev.lower_bound(hashPrev);
-             mi != mapOrphanBlocksByPrev.upper_bound(hashPrev);
-             ++mi)
+        for (const auto& pblockOrphan : g_orphan_blocks.TakeChildren(vWorkQueue[i]))
         {
-            CBlock* pblockOrphan = mi->second;
             if (pblockOrphan->AcceptBlock(generated_by_me))
                 vWorkQueue.push_back(pblockOrphan->GetHash(true));
-            mapOrphanBlocks.erase(pblockOrphan->GetHash(true));
-            setStakeSeenOrphan.erase(pblockOrphan->GetProofOfStake());
-            delete pblockOrphan;
         }
-        mapOrphanBlocksByPrev.erase(hashPrev);
-
     }
 
+    if (nPruneTarget > 0 && !IsInitialBlockDownload())
+        PruneBlockFiles();
+
     return true;
 }
 
@@ -3356,13 +4230,9 @@ bool CBlock::CheckBlockSignature() const
 
     if (whichType == TX_PUBKEY)
     {
-        valtype& vchPubKey = vSolutions[0];
-        CKey key;
-        if (!key.SetPubKey(vchPubKey))
-            return false;
         if (vchBlockSig.empty())
             return false;
-        return key.Verify(GetHash(true), vchBlockSig);
+        return CPubKey(vSolutions[0]).Verify(GetHash(true), vchBlockSig);
     }
 
     return false;
@@ -3410,70 +4280,588 @@ FILE* OpenBlockFile(unsigned int nFile, unsigned int nBlockPos, const char* pszM
     return file;
 }
 
-static unsigned int nCurrentBlockFile = 1;
-
-FILE* AppendBlockFile(unsigned int& nFileRet)
+namespace {
+//!
+//! \brief Maps the block files into memory for reading.
+//!
+//! A mapping covers the size of the file when it was mapped. Blocks are only
+//! ever appended to the files, so a request past the end of a mapping maps
+//! the file again at its new size. Readers hold a reference to the mapping
+//! that they read from, so a new mapping does not invalidate a read that is
+//! in progress.
+//!
+class MappedBlockFiles
 {
-    nFileRet = 0;
-    while (true)
+public:
+    //!
+    //! \brief A read-only mapping of a block file.
+    //!
+    class Mapping
     {
-        FILE* file = OpenBlockFile(nCurrentBlockFile, 0, "ab");
-        if (!file)
-            return NULL;
-        if (fseek(file, 0, SEEK_END) != 0)
-            return NULL;
-        // FAT32 file size max 4GB, fseek and ftell max 2GB, so we must stay under 2GB
-        if (ftell(file) < (long)(0x7F000000 - MAX_SIZE))
+    public:
+        Mapping(const char* data, size_t size) : m_data(data), m_size(size)
         {
-            nFileRet = nCurrentBlockFile;
-            return file;
         }
-        fclose(file);
-        nCurrentBlockFile++;
-    }
-}
 
-bool LoadBlockIndex(bool fAllowNew)
-{
-    LOCK(cs_main);
+        ~Mapping()
+        {
+#ifndef WIN32
+            munmap(const_cast<char*>(m_data), m_size);
+#endif
+        }
 
-    if (fTestNet)
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        const char* const m_data; //!< Start of the mapped file.
+        const size_t m_size;      //!< Size of the mapped file.
+    };
+
+    typedef std::shared_ptr<const Mapping> MappingPtr;
+
+    //!
+    //! \brief Get a mapping of a block file that contains the given range.
+    //!
+    //! \return A null pointer if the file cannot be mapped or does not
+    //! contain the range.
+    //!
+    MappingPtr Get(const unsigned int nFile, const uint64_t nEnd)
     {
-        // GLOBAL TESTNET SETTINGS - R HALFORD
-        pchMessageStart[0] = 0xcd;
-        pchMessageStart[1] = 0xf2;
-        pchMessageStart[2] = 0xc0;
-        pchMessageStart[3] = 0xef;
-        bnProofOfWorkLimit = bnProofOfWorkLimitTestNet; // 16 bits PoW target limit for testnet
-        nStakeMinAge = 1 * 60 * 60; // test net min age is 1 hour
-        nCoinbaseMaturity = 10; // test maturity is 10 blocks
-        nGrandfather = 196550;
-        nNewIndex = 10;
-        nNewIndex2 = 36500;
-        //1-24-2016
-        MAX_OUTBOUND_CONNECTIONS = (int)GetArg("-maxoutboundconnections", 8);
+        LOCK(cs_mappings);
 
-        // Temporary transition to version 2 beacons after the block version 11
-        // hard-fork:
-        //
-        g_v11_legacy_beacon_days = 7;
-    }
+        MappingPtr& mapping = m_mappings[nFile];
 
-    LogPrintf("Mode=%s", fTestNet ? "TestNet" : "Prod");
+        if (!mapping || mapping->m_size < nEnd) {
+            mapping = Map(nFile);
+        }
 
-    //
-    // Load block index
-    //
-    CTxDB txdb("cr+");
-    if (!txdb.LoadBlockIndex())
-        return false;
+        if (!mapping || mapping->m_size < nEnd) {
+            return nullptr;
+        }
 
-    //
-    // Init with genesis block
-    //
-    if (mapBlockIndex.empty())
+        return mapping;
+    }
+
+    //!
+    //! \brief Drop the mapping of a block file deleted by pruning.
+    //!
+    void Forget(const unsigned int nFile)
     {
-        if (!fAllowNew)
+        LOCK(cs_mappings);
+
+        m_mappings.erase(nFile);
+    }
+
+private:
+    CCriticalSection cs_mappings;
+    std::map<unsigned int, MappingPtr> m_mappings;
+
+    static MappingPtr Map(const unsigned int nFile)
+    {
+#ifdef WIN32
+        return nullptr;
+#else
+        const std::string path = BlockFilePath(nFile).string();
+        const int fd = open(path.c_str(), O_RDONLY);
+
+        if (fd == -1) {
+            return nullptr;
+        }
+
+        struct stat st;
+        void* data = MAP_FAILED;
+
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        close(fd);
+
+        if (data == MAP_FAILED) {
+            LogPrint(BCLog::LogFlags::NOISY, "%s: cannot map %s", __func__, path);
+            return nullptr;
+        }
+
+        return std::make_shared<const Mapping>(static_cast<const char*>(data), st.st_size);
+#endif
+    }
+};
+
+MappedBlockFiles g_mapped_block_files;
+} // anonymous namespace
+
+bool ReadBlockFromMappedFile(unsigned int nFile, unsigned int nBlockPos, int nSerFlags, CBlock& block)
+{
+    // The size of the block precedes it in the file:
+    if (nFile < 1 || nFile == (unsigned int)-1 || nBlockPos < sizeof(pchMessageStart) + sizeof(unsigned int))
+        return false;
+
+    MappedBlockFiles::MappingPtr mapping = g_mapped_block_files.Get(nFile, nBlockPos);
+
+    if (!mapping)
+        return false;
+
+    const unsigned int nSize = ReadLE32(
+        reinterpret_cast<const unsigned char*>(mapping->m_data + nBlockPos - sizeof(unsigned int)));
+
+    if (nSize > MAX_BLOCK_SIZE)
+        return false;
+
+    mapping = g_mapped_block_files.Get(nFile, (uint64_t)nBlockPos + nSize);
+
+    if (!mapping)
+        return false;
+
+    SpanReader(nSerFlags, CLIENT_VERSION, mapping->m_data + nBlockPos, nSize) >> block;
+
+    return true;
+}
+
+static unsigned int nCurrentBlockFile = 1;
+
+//!
+//! \brief Get the numbers of the block files in the data directory.
+//!
+//! \return The total size of the files in bytes.
+//!
+static uint64_t ListBlockFiles(std::vector<unsigned int>& vFiles)
+{
+    uint64_t nTotalSize = 0;
+
+    for (filesystem::directory_iterator it(GetDataDir()), end; it != end; ++it)
+    {
+        const std::string name = it->path().filename().string();
+        unsigned int nFile = 0;
+
+        if (name.size() == 12 && name.compare(7, 4, ".dat") == 0
+            && sscanf(name.c_str(), "blk%04u", &nFile) == 1)
+        {
+            vFiles.push_back(nFile);
+            nTotalSize += filesystem::file_size(it->path());
+        }
+    }
+
+    std::sort(vFiles.begin(), vFiles.end());
+
+    return nTotalSize;
+}
+
+FILE* AppendBlockFile(unsigned int& nFileRet)
+{
+    // Pruning deletes old block files. Start at the last file rather than in
+    // a gap in the numbering because the transaction index still refers to
+    // the positions of pruned transactions in the deleted files:
+    static bool fFoundLastBlockFile = false;
+    if (!fFoundLastBlockFile)
+    {
+        std::vector<unsigned int> vFiles;
+        ListBlockFiles(vFiles);
+
+        if (!vFiles.empty())
+            nCurrentBlockFile = std::max(nCurrentBlockFile, vFiles.back());
+        fFoundLastBlockFile = true;
+    }
+
+    nFileRet = 0;
+    while (true)
+    {
+        FILE* file = OpenBlockFile(nCurrentBlockFile, 0, "ab");
+        if (!file)
+            return NULL;
+        if (fseek(file, 0, SEEK_END) != 0)
+            return NULL;
+        // FAT32 file size max 4GB, fseek and ftell max 2GB, so we must stay under 2GB
+        if (ftell(file) < (long)(0x7F000000 - MAX_SIZE))
+        {
+            nFileRet = nCurrentBlockFile;
+            return file;
+        }
+        fclose(file);
+        nCurrentBlockFile++;
+    }
+}
+
+namespace {
+//!
+//! \brief Determine whether a node that prunes its block files still needs
+//! the data of a block.
+//!
+//! The node keeps every block younger than the maximum beacon age for beacon
+//! renewals and reorganizations, contract and superblock blocks for contract
+//! replay, vote tallies, and research accrual, and any block with unspent
+//! outputs because inputs and stakes read their previous transactions from
+//! the block files.
+//!
+bool IsBlockRetained(CTxDB& txdb, const CBlockIndex* const pindex, const CBlock& block)
+{
+    if (pindex == pindexGenesisBlock
+        || (int64_t)pindex->nTime + GRC::Beacon::MAX_AGE >= (int64_t)pindexBest->nTime)
+    {
+        return true;
+    }
+
+    if (!pindex->IsInMainChain())
+        return false;
+
+    if (pindex->nIsContract || pindex->nIsSuperBlock)
+        return true;
+
+    for (const auto& tx : block.vtx)
+    {
+        CTxIndex txindex;
+
+        if (!txdb.ReadTxIndex(tx.GetHash(), txindex))
+            continue;
+
+        for (size_t i = 0; i < tx.vout.size() && i < txindex.vSpent.size(); ++i)
+        {
+            const CTxOut& txout = tx.vout[i];
+
+            // Nothing spends empty coinstake markers, burns, or data outputs:
+            if (txout.nValue == 0
+                || (!txout.scriptPubKey.empty() && txout.scriptPubKey[0] == OP_RETURN))
+            {
+                continue;
+            }
+
+            if (txindex.vSpent[i].IsNull())
+                return true;
+        }
+    }
+
+    return false;
+}
+
+//!
+//! \brief Write the new location of a block's data to the block index.
+//!
+//! The caller updates the entry in memory after the transaction commits.
+//!
+bool WriteBlockPos(CTxDB& txdb, CBlockIndex* const pindex, const unsigned int nFile, const unsigned int nBlockPos)
+{
+    CDiskBlockIndex diskindex(pindex);
+    diskindex.nFile = nFile;
+    diskindex.nBlockPos = nBlockPos;
+
+    if (!txdb.WriteBlockIndex(diskindex))
+        return error("%s: failed to write block index", __func__);
+
+    return true;
+}
+
+//!
+//! \brief Append a retained block to the current block file and point the
+//! block and transaction indexes at the new copy.
+//!
+//! \param mapMoved Receives the old and new locations of the transactions
+//! whose index entries now point at the new copy.
+//!
+bool MoveBlock(
+    CTxDB& txdb,
+    CBlockIndex* const pindex,
+    CBlock& block,
+    unsigned int& nFile,
+    unsigned int& nBlockPos,
+    std::map<CDiskTxPos, CDiskTxPos>& mapMoved)
+{
+    const CDiskTxPos posOldBlock(pindex->nFile, pindex->nBlockPos, 0);
+
+    if (!block.WriteToDisk(nFile, nBlockPos))
+        return error("%s: failed to write block %s", __func__, pindex->GetBlockHash().ToString());
+
+    if (!WriteBlockPos(txdb, pindex, nFile, nBlockPos))
+        return false;
+
+    if (!pindex->IsInMainChain())
+        return true;
+
+    for (const auto& tx : block.vtx)
+    {
+        const uint256 hash = tx.GetHash();
+        CTxIndex txindex;
+
+        if (!txdb.ReadTxIndex(hash, txindex)
+            || txindex.pos.nFile != posOldBlock.nFile
+            || txindex.pos.nBlockPos != posOldBlock.nBlockPos)
+        {
+            continue;
+        }
+
+        // Block serialization does not change, so each transaction stays at
+        // the same offset from the start of the block:
+        const CDiskTxPos posOld = txindex.pos;
+        const CDiskTxPos posNew(nFile, nBlockPos, posOld.nTxPos - posOld.nBlockPos + nBlockPos);
+
+        txindex.pos = posNew;
+
+        if (!txdb.UpdateTxIndex(hash, txindex))
+            return error("%s: failed to update tx index for %s", __func__, hash.ToString());
+
+        mapMoved.emplace(posOld, posNew);
+
+        // The spent flags of the previous outputs refer to the position of
+        // the spending transaction:
+        for (const auto& txin : tx.vin)
+        {
+            CTxIndex txindexPrev;
+
+            if (txin.prevout.IsNull()
+                || !txdb.ReadTxIndex(txin.prevout.hash, txindexPrev)
+                || txin.prevout.n >= txindexPrev.vSpent.size()
+                || txindexPrev.vSpent[txin.prevout.n] != posOld)
+            {
+                continue;
+            }
+
+            txindexPrev.vSpent[txin.prevout.n] = posNew;
+
+            if (!txdb.UpdateTxIndex(txin.prevout.hash, txindexPrev))
+                return error("%s: failed to update tx index for %s", __func__, txin.prevout.hash.ToString());
+        }
+    }
+
+    return true;
+}
+
+//!
+//! \brief Point the undo records of the recent blocks at the new locations of
+//! the transactions moved out of a pruned block file.
+//!
+//! The undo records hold the transaction index entries as they were before
+//! each block connected, and DisconnectBlock() writes them back unchanged, so
+//! their positions must follow the moved transactions like the index does.
+//!
+bool RelocateBlockUndo(CTxDB& txdb, const std::map<CDiskTxPos, CDiskTxPos>& mapMoved)
+{
+    if (mapMoved.empty())
+        return true;
+
+    const auto relocate = [&mapMoved](CDiskTxPos& pos) {
+        const auto iter = mapMoved.find(pos);
+
+        if (iter == mapMoved.end())
+            return false;
+
+        pos = iter->second;
+        return true;
+    };
+
+    // ConnectBlock() keeps the undo records of the last BLOCK_UNDO_DEPTH blocks:
+    for (const CBlockIndex* pindex = pindexBest;
+        pindex && pindex->nHeight > nBestHeight - BLOCK_UNDO_DEPTH;
+        pindex = pindex->pprev)
+    {
+        CBlockUndo undo;
+
+        if (!txdb.ReadBlockUndo(pindex->GetBlockHash(), undo))
+            continue;
+
+        bool fChanged = false;
+
+        for (auto& entry : undo.vSpentTxIndex)
+        {
+            fChanged |= relocate(entry.second.pos);
+
+            for (auto& spent : entry.second.vSpent)
+                fChanged |= relocate(spent);
+        }
+
+        if (fChanged && !txdb.WriteBlockUndo(pindex->GetBlockHash(), undo))
+            return error("%s: failed to write undo record for %s", __func__, pindex->GetBlockHash().ToString());
+    }
+
+    return true;
+}
+
+//!
+//! \brief Move the retained blocks out of an old block file and delete it.
+//!
+//! \param nFile   Number of the block file to prune.
+//! \param vBlocks Block index entries of the blocks stored in the file.
+//!
+bool PruneBlockFile(const unsigned int nFile, std::vector<CBlockIndex*>& vBlocks)
+{
+    const filesystem::path path = BlockFilePath(nFile);
+
+    // Keep the retained blocks in the order of the file:
+    std::sort(vBlocks.begin(), vBlocks.end(), [](const CBlockIndex* a, const CBlockIndex* b) {
+        return a->nBlockPos < b->nBlockPos;
+    });
+
+    // New locations of the blocks, or zero for pruned blocks, applied to the
+    // block index in memory when the database transaction commits:
+    std::vector<std::pair<unsigned int, unsigned int>> vNewPos(vBlocks.size());
+    std::map<CDiskTxPos, CDiskTxPos> mapMovedTx;
+    size_t nMoved = 0;
+
+    CTxDB txdb;
+
+    if (!txdb.TxnBegin())
+        return false;
+
+    for (size_t i = 0; i < vBlocks.size(); ++i)
+    {
+        CBlockIndex* const pindex = vBlocks[i];
+        CBlock block;
+
+        if (!block.ReadFromDisk(pindex->nFile, pindex->nBlockPos))
+        {
+            txdb.TxnAbort();
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        }
+
+        bool fOk;
+
+        if (IsBlockRetained(txdb, pindex, block))
+        {
+            fOk = MoveBlock(txdb, pindex, block, vNewPos[i].first, vNewPos[i].second, mapMovedTx);
+            ++nMoved;
+        }
+        else
+        {
+            fOk = WriteBlockPos(txdb, pindex, 0, 0);
+        }
+
+        if (!fOk)
+        {
+            txdb.TxnAbort();
+            return false;
+        }
+    }
+
+    if (!RelocateBlockUndo(txdb, mapMovedTx))
+    {
+        txdb.TxnAbort();
+        return false;
+    }
+
+    if (!txdb.TxnCommit())
+        return error("%s: failed to commit the block index", __func__);
+
+    for (size_t i = 0; i < vBlocks.size(); ++i)
+    {
+        vBlocks[i]->nFile = vNewPos[i].first;
+        vBlocks[i]->nBlockPos = vNewPos[i].second;
+    }
+
+    g_mapped_block_files.Forget(nFile);
+    filesystem::remove(path);
+
+    LogPrintf("%s: pruned %s: %" PRIszu " blocks, %" PRIszu " retained",
+        __func__, path.filename().string(), vBlocks.size(), nMoved);
+
+    return true;
+}
+
+//!
+//! \brief Whether the last call to PruneBlockFiles() stopped at the file limit
+//! with the block files still above the target.
+//!
+bool g_prune_pending = false;
+} // anonymous namespace
+
+bool PruneBlockFiles()
+{
+    AssertLockHeld(cs_main);
+
+    if (nPruneTarget == 0 || !pindexBest)
+        return true;
+
+    if (!g_prune_pending && nBestHeight % PRUNE_INTERVAL != 0)
+        return true;
+
+    g_prune_pending = false;
+
+    std::vector<unsigned int> vFiles;
+    uint64_t nTotalSize = ListBlockFiles(vFiles);
+
+    // Never prune the file that new blocks append to:
+    std::vector<unsigned int> vCandidates;
+
+    for (const auto& nFile : vFiles)
+    {
+        if (nFile >= nCurrentBlockFile || vCandidates.size() == MAX_PRUNE_FILES_PER_BLOCK)
+            break;
+
+        vCandidates.push_back(nFile);
+    }
+
+    if (nTotalSize <= nPruneTarget || vCandidates.empty())
+        return true;
+
+    // Collect the blocks of every candidate file in one pass over the index:
+    std::map<unsigned int, std::vector<CBlockIndex*>> mapFileBlocks;
+
+    for (const auto& nFile : vCandidates)
+        mapFileBlocks[nFile];
+
+    for (const auto& entry : mapBlockIndex)
+    {
+        const auto iter = mapFileBlocks.find(entry.second->nFile);
+
+        if (iter != mapFileBlocks.end())
+            iter->second.push_back(entry.second);
+    }
+
+    for (const auto& nFile : vCandidates)
+    {
+        if (nTotalSize <= nPruneTarget)
+            return true;
+
+        if (!PruneBlockFile(nFile, mapFileBlocks[nFile]))
+            return error("%s: failed to prune blk%04u.dat", __func__, nFile);
+
+        // The retained blocks moved to the current file:
+        std::vector<unsigned int> vRemaining;
+        nTotalSize = ListBlockFiles(vRemaining);
+    }
+
+    g_prune_pending = nTotalSize > nPruneTarget;
+
+    return true;
+}
+
+bool LoadBlockIndex(bool fAllowNew)
+{
+    LOCK(cs_main);
+
+    if (fTestNet)
+    {
+        // GLOBAL TESTNET SETTINGS - R HALFORD
+        pchMessageStart[0] = 0xcd;
+        pchMessageStart[1] = 0xf2;
+        pchMessageStart[2] = 0xc0;
+        pchMessageStart[3] = 0xef;
+        bnProofOfWorkLimit = bnProofOfWorkLimitTestNet; // 16 bits PoW target limit for testnet
+        nStakeMinAge = 1 * 60 * 60; // test net min age is 1 hour
+        nCoinbaseMaturity = 10; // test maturity is 10 blocks
+        nGrandfather = 196550;
+        nNewIndex = 10;
+        nNewIndex2 = 36500;
+        //1-24-2016
+        MAX_OUTBOUND_CONNECTIONS = (int)GetArg("-maxoutboundconnections", 8);
+
+        // Temporary transition to version 2 beacons after the block version 11
+        // hard-fork:
+        //
+        g_v11_legacy_beacon_days = 7;
+    }
+
+    LogPrintf("Mode=%s", fTestNet ? "TestNet" : "Prod");
+
+    //
+    // Load block index
+    //
+    CTxDB txdb("cr+");
+    if (!txdb.LoadBlockIndex())
+        return false;
+
+    //
+    // Init with genesis block
+    //
+    if (mapBlockIndex.empty())
+    {
+        if (!fAllowNew)
             return false;
 
         // Genesis block - Genesis2
@@ -3640,62 +5028,269 @@ void PrintBlockTree()
     }
 }
 
-bool LoadExternalBlockFile(FILE* fileIn)
+namespace {
+//!
+//! \brief A FIFO queue of bounded size that connects the stages of the block
+//! import pipeline.
+//!
+template<typename T>
+class ImportQueue
 {
-    int64_t nStart = GetTimeMillis();
-    int nLoaded = 0;
+public:
+    explicit ImportQueue(const size_t capacity) : m_capacity(capacity), m_closed(false)
     {
-        LOCK(cs_main);
-        try {
-            CAutoFile blkdat(fileIn, SER_DISK, CLIENT_VERSION);
-            unsigned int nPos = 0;
-            while (nPos != (unsigned int)-1 && !fRequestShutdown)
-            {
-                unsigned char pchData[65536];
-                do {
-                    fseek(blkdat.Get(), nPos, SEEK_SET);
-                    int nRead = fread(pchData, 1, sizeof(pchData), blkdat.Get());
-                    if (nRead <= 8)
-                    {
-                        nPos = (unsigned int)-1;
-                        break;
-                    }
-                    void* nFind = memchr(pchData, pchMessageStart[0], nRead+1-sizeof(pchMessageStart));
-                    if (nFind)
-                    {
-                        if (memcmp(nFind, pchMessageStart, sizeof(pchMessageStart))==0)
-                        {
-                            nPos += ((unsigned char*)nFind - pchData) + sizeof(pchMessageStart);
-                            break;
-                        }
-                        nPos += ((unsigned char*)nFind - pchData) + 1;
-                    }
-                    else
-                        nPos += sizeof(pchData) - sizeof(pchMessageStart) + 1;
-                } while(!fRequestShutdown);
-                if (nPos == (unsigned int)-1)
-                    break;
-                fseek(blkdat.Get(), nPos, SEEK_SET);
-                unsigned int nSize;
+    }
+
+    //!
+    //! \brief Add an item to the queue. Blocks while the queue is full.
+    //!
+    //! \return \c false if the queue closed before the item was added.
+    //!
+    bool Push(T&& item)
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        while (m_items.size() >= m_capacity && !m_closed) {
+            m_cond_not_full.wait(lock);
+        }
+
+        if (m_closed) {
+            return false;
+        }
+
+        m_items.push_back(std::move(item));
+        m_cond_not_empty.notify_one();
+
+        return true;
+    }
+
+    //!
+    //! \brief Take the next item from the queue. Blocks while the queue is
+    //! empty.
+    //!
+    //! \return \c false if the queue is closed and holds no more items.
+    //!
+    bool Pop(T& item)
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        while (m_items.empty() && !m_closed) {
+            m_cond_not_empty.wait(lock);
+        }
+
+        if (m_items.empty()) {
+            return false;
+        }
+
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_cond_not_full.notify_one();
+
+        return true;
+    }
+
+    //!
+    //! \brief Close the queue. Consumers drain the remaining items and then
+    //! stop. Producers stop immediately.
+    //!
+    void Close()
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        m_closed = true;
+        m_cond_not_empty.notify_all();
+        m_cond_not_full.notify_all();
+    }
+
+    //!
+    //! \brief Close the queue and discard the remaining items.
+    //!
+    void Abort()
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        m_closed = true;
+        m_items.clear();
+        m_cond_not_empty.notify_all();
+        m_cond_not_full.notify_all();
+    }
+
+private:
+    const size_t m_capacity;
+    bool m_closed;
+    std::deque<T> m_items;
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond_not_empty;
+    boost::condition_variable m_cond_not_full;
+};
+
+//!
+//! \brief Number of blocks that each stage of the import pipeline may run
+//! ahead of the next one.
+//!
+constexpr size_t IMPORT_QUEUE_DEPTH = 256;
+
+//!
+//! \brief Number of blocks that the decoder hashes together. Early blocks
+//! have scrypt hashes that CBlockHeader::CacheHashes() computes in batches.
+//!
+constexpr size_t IMPORT_HASH_BATCH = 4 * SCRYPT_BATCH_LANES;
+
+//!
+//! \brief The serialized bytes of a block read from the file.
+//!
+typedef CDataStream RawBlock;
+
+//!
+//! \brief Import pipeline stage that finds the blocks in a file and reads
+//! their serialized bytes.
+//!
+//! Blocks in the file follow the network magic bytes and the size of the
+//! block. Bytes that do not form a valid header are skipped.
+//!
+void ReadExternalBlocks(FILE* fileIn, ImportQueue<RawBlock>& raw_blocks)
+{
+    RenameThread("grc-loadblk");
+
+    try {
+        CBufferedFile blkdat(fileIn, 2 * MAX_BLOCK_SIZE, MAX_BLOCK_SIZE + 8, SER_DISK, CLIENT_VERSION);
+        uint64_t nRewind = blkdat.GetPos();
+
+        while (!blkdat.eof() && !fRequestShutdown) {
+            blkdat.SetPos(nRewind);
+            nRewind++; // start one byte further next time, in case of failure
+
+            unsigned int nSize = 0;
+
+            try {
+                // Locate a header:
+                unsigned char buf[sizeof(pchMessageStart)];
+                blkdat.FindByte(pchMessageStart[0]);
+                nRewind = blkdat.GetPos() + 1;
+                blkdat >> buf;
+
+                if (memcmp(buf, pchMessageStart, sizeof(pchMessageStart)) != 0) {
+                    continue;
+                }
+
                 blkdat >> nSize;
-                if (nSize > 0 && nSize <= MAX_BLOCK_SIZE)
-                {
-                    CBlock block;
-                    blkdat >> block;
-                    if (ProcessBlock(NULL,&block,false))
-                    {
-                        nLoaded++;
-                        LogPrintf("Blocks/s: %f", nLoaded / ((GetTimeMillis() - nStart) / 1000.0));
-                        nPos += 4 + nSize;
-                    }
+
+                if (nSize == 0 || nSize > MAX_BLOCK_SIZE) {
+                    continue;
                 }
+            } catch (const std::exception&) {
+                // No valid block header found before the end of the file.
+                break;
+            }
+
+            RawBlock raw(SER_DISK, CLIENT_VERSION);
+            raw.resize(nSize);
+            blkdat.read(&raw[0], nSize);
+            nRewind = blkdat.GetPos();
+
+            if (!raw_blocks.Push(std::move(raw))) {
+                break;
+            }
+        }
+    } catch (const std::exception& e) {
+        LogPrintf("%s: I/O error caught during load: %s", __func__, e.what());
+    }
+
+    raw_blocks.Close();
+}
+
+//!
+//! \brief Import pipeline stage that deserializes the blocks read from the
+//! file.
+//!
+void DeserializeExternalBlocks(ImportQueue<RawBlock>& raw_blocks, ImportQueue<CBlock>& blocks)
+{
+    RenameThread("grc-loadblk-dec");
+
+    RawBlock raw(SER_DISK, CLIENT_VERSION);
+    std::vector<CBlock> batch;
+    bool more = true;
+
+    while (more) {
+        more = raw_blocks.Pop(raw);
+
+        if (more) {
+            CBlock block;
+
+            try {
+                raw >> block;
+            } catch (const std::exception& e) {
+                LogPrintf("%s: Deserialize error caught during load: %s", __func__, e.what());
+                continue;
+            }
+
+            batch.push_back(std::move(block));
+
+            if (batch.size() < IMPORT_HASH_BATCH) {
+                continue;
+            }
+        }
+
+        // Validation reads the cached hashes with GetHash(true):
+        std::vector<CBlockHeader*> headers;
+
+        for (auto& block : batch) {
+            headers.push_back(&block);
+        }
+
+        CBlockHeader::CacheHashes(headers);
+
+        for (auto& block : batch) {
+            if (!blocks.Push(std::move(block))) {
+                raw_blocks.Abort();
+                more = false;
+                break;
             }
         }
-        catch (std::exception &e) {
-            LogPrintf("%s() : Deserialize or I/O error caught during load",
-                   __PRETTY_FUNCTION__);
+
+        batch.clear();
+    }
+
+    blocks.Close();
+}
+} // anonymous namespace
+
+bool LoadExternalBlockFile(FILE* fileIn)
+{
+    int64_t nStart = GetTimeMillis();
+    int nLoaded = 0;
+
+    // Reading the file, deserializing the blocks, and validating them run
+    // as a pipeline so that the I/O and decoding overlap with validation:
+    //
+    ImportQueue<RawBlock> raw_blocks(IMPORT_QUEUE_DEPTH);
+    ImportQueue<CBlock> blocks(IMPORT_QUEUE_DEPTH);
+
+    boost::thread reader(std::bind(&ReadExternalBlocks, fileIn, std::ref(raw_blocks)));
+    boost::thread decoder(std::bind(&DeserializeExternalBlocks, std::ref(raw_blocks), std::ref(blocks)));
+
+    CBlock block;
+
+    while (!fRequestShutdown && blocks.Pop(block))
+    {
+        LOCK(cs_main);
+
+        if (ProcessBlock(NULL, &block, false))
+        {
+            nLoaded++;
+
+            if (nLoaded % 1000 == 0)
+                LogPrintf("Blocks/s: %f", nLoaded / ((GetTimeMillis() - nStart) / 1000.0));
         }
     }
+
+    // Stop the earlier stages if validation stopped first:
+    blocks.Abort();
+    raw_blocks.Abort();
+
+    decoder.join();
+    reader.join();
+
     LogPrintf("Loaded %i blocks from external file in %" PRId64 "ms", nLoaded, GetTimeMillis() - nStart);
     return nLoaded > 0;
 }
@@ -3767,8 +5362,9 @@ bool static AlreadyHave(CTxDB& txdb, const CInv& inv)
         }
 
     case MSG_BLOCK:
+    case MSG_CMPCT_BLOCK:
         return mapBlockIndex.count(inv.hash) ||
-               mapOrphanBlocks.count(inv.hash);
+               g_orphan_blocks.Contains(inv.hash);
     }
     // Don't know what it is, just say we already got one
     return true;
@@ -3782,8 +5378,183 @@ bool static AlreadyHave(CTxDB& txdb, const CInv& inv)
 // a large 4-byte int at any alignment.
 unsigned char pchMessageStart[4] = { 0x70, 0x35, 0x22, 0x05 };
 
+namespace {
+//!
+//! \brief Serialized block messages recently sent to peers.
+//!
+CSharedMessageCache g_block_messages(16 * 1024 * 1024);
+
+//!
+//! \brief Serialized "headers" replies recently sent to peers.
+//!
+//! Peers that synchronize headers from the same block send the same requests
+//! in turn, so one reply of up to 1000 headers serves all of them.
+//!
+CSharedMessageCache g_header_messages(4 * 1024 * 1024);
+
+//!
+//! \brief Number of blocks below the tip that peers may request in compact
+//! form. The memory pool no longer holds the transactions of older blocks.
+//!
+constexpr int MAX_CMPCTBLOCK_DEPTH = 10;
+
+//!
+//! \brief Maximum number of compact blocks that wait for missing
+//! transactions.
+//!
+constexpr size_t MAX_PARTIAL_BLOCKS = 16;
+
+//!
+//! \brief Maximum number of compact blocks that wait for missing transactions
+//! from one peer.
+//!
+constexpr size_t MAX_PARTIAL_BLOCKS_PER_PEER = 4;
+
+//!
+//! \brief Seconds to wait for the "blocktxn" reply to a compact block before
+//! dropping it.
+//!
+constexpr int64_t PARTIAL_BLOCK_TIMEOUT = 60;
+
+//!
+//! \brief A compact block that waits for its missing transactions.
+//!
+struct PartialBlock
+{
+    NodeId node;   //!< Peer asked for the missing transactions.
+    int64_t time;  //!< Time of the "getblocktxn" request.
+    std::shared_ptr<PartiallyDownloadedBlock> block;
+};
+
+//!
+//! \brief Compact blocks that wait for a "blocktxn" reply, by block hash.
+//!
+//! Guarded by cs_main.
+//!
+std::map<uint256, PartialBlock> g_partial_blocks;
+
+//!
+//! \brief Make room for a compact block from a peer that waits for missing
+//! transactions.
+//!
+//! Drops the blocks that waited too long first. A peer that already reached
+//! its limit gives up its oldest block, so that one peer that never answers
+//! cannot crowd out the blocks of the other peers. When the blocks of all of
+//! the peers reach the overall limit, the oldest one goes.
+//!
+void ReservePartialBlock(const NodeId node, const int64_t now)
+{
+    AssertLockHeld(cs_main);
+
+    auto oldest = g_partial_blocks.end();
+    auto oldest_of_peer = g_partial_blocks.end();
+    size_t peer_count = 0;
+
+    for (auto iter = g_partial_blocks.begin(); iter != g_partial_blocks.end();) {
+        if (iter->second.time + PARTIAL_BLOCK_TIMEOUT < now) {
+            LogPrint(BCLog::LogFlags::NET, "compact block %s from peer %d timed out",
+                iter->first.ToString(), iter->second.node);
+
+            iter = g_partial_blocks.erase(iter);
+            continue;
+        }
+
+        if (oldest == g_partial_blocks.end() || iter->second.time < oldest->second.time) {
+            oldest = iter;
+        }
+
+        if (iter->second.node == node) {
+            ++peer_count;
+
+            if (oldest_of_peer == g_partial_blocks.end()
+                || iter->second.time < oldest_of_peer->second.time)
+            {
+                oldest_of_peer = iter;
+            }
+        }
+
+        ++iter;
+    }
+
+    if (peer_count >= MAX_PARTIAL_BLOCKS_PER_PEER) {
+        g_partial_blocks.erase(oldest_of_peer);
+    } else if (g_partial_blocks.size() >= MAX_PARTIAL_BLOCKS) {
+        g_partial_blocks.erase(oldest);
+    }
+}
+
+//!
+//! \brief Get the request to send for a block announced by a peer.
+//!
+//! Near the tip, peers that support compact blocks send the block in compact
+//! form because the memory pool holds most of its transactions.
+//!
+CInv GetBlockRequest(const CNode* pfrom, const CInv& inv)
+{
+    if (inv.type == MSG_BLOCK && pfrom->fSupportsCompactBlocks && !IsInitialBlockDownload()) {
+        return CInv(MSG_CMPCT_BLOCK, inv.hash);
+    }
+
+    return inv;
+}
+
+//!
+//! \brief Ask a peer for a block in full.
+//!
+void RequestFullBlock(CNode* pfrom, const uint256& hash)
+{
+    pfrom->PushMessage("getdata", std::vector<CInv> { CInv(MSG_BLOCK, hash) });
+}
+
+//!
+//! \brief Accept a block that a peer sent in full or that the node rebuilt
+//! from a compact block.
+//!
+void ProcessReceivedBlock(CNode* pfrom, CBlock& block)
+{
+    AssertLockHeld(cs_main);
+
+    const uint256 hashBlock = block.GetHash(true);
+
+    LogPrintf(" Received block %s; ", hashBlock.ToString());
+    if (LogInstance().WillLogCategory(BCLog::LogFlags::NOISY)) block.print();
+
+    CInv inv(MSG_BLOCK, hashBlock);
+    pfrom->AddInventoryKnown(inv);
+
+    // A peer answers a compact block request for a block too deep to rebuild
+    // from the memory pool with the full block:
+    {
+        LOCK(cs_mapAlreadyAskedFor);
+        pfrom->setCompactBlocksAsked.erase(hashBlock);
+    }
+
+    const bool fAccepted = ProcessBlock(pfrom, &block, false);
+
+    if (fAccepted)
+    {
+        {
+            LOCK(cs_mapAlreadyAskedFor);
+            mapAlreadyAskedFor.erase(inv);
+            mapAlreadyAskedFor.erase(CInv(MSG_CMPCT_BLOCK, hashBlock));
+        }
+        pfrom->nTrust++;
+    }
+
+    g_block_download.BlockReceived(hashBlock, fAccepted);
+
+    if (block.nDoS)
+    {
+            pfrom->Misbehaving(block.nDoS);
+            pfrom->nTrust--;
+    }
+}
+} // anonymous namespace
+
 bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv, int64_t nTimeReceived)
 {
+    util::PerfTimer perf_timer("ProcessMessage.", strCommand);
+
     RandAddSeedPerfmon();
 
     LogPrint(BCLog::LogFlags::NOISY, "received: %s from %s (%" PRIszu " bytes)", strCommand, pfrom->addrName, vRecv.size());
@@ -3905,6 +5676,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         pfrom->PushMessage("verack");
         pfrom->ssSend.SetVersion(min(pfrom->nVersion, PROTOCOL_VERSION));
 
+        // Offer to receive blocks in compact form. Peers that do not know the
+        // message ignore it:
+        pfrom->PushMessage("sendcmpct", false, (uint64_t)1);
+
 
         if (!pfrom->fInbound)
         {
@@ -3933,7 +5708,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
         // Ask the first connected node for block updates
         static int nAskedForBlocks = 0;
-        if (!pfrom->fClient && !pfrom->fOneShot &&
+        if (!fHeadersFirst && !pfrom->fClient && !pfrom->fOneShot &&
             (pfrom->nStartingHeight > (nBestHeight - 144)) &&
              (nAskedForBlocks < 1 || (vNodes.size() <= 1 && nAskedForBlocks < 1)))
         {
@@ -4083,10 +5858,15 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
             LogPrint(BCLog::LogFlags::NOISY, " got inventory: %s  %s", inv.ToString(), fAlreadyHave ? "have" : "new");
 
-            if (!fAlreadyHave)
-                pfrom->AskFor(inv);
-            else if (inv.type == MSG_BLOCK && mapOrphanBlocks.count(inv.hash)) {
-                pfrom->PushGetBlocks(pindexBest, GetOrphanRoot(mapOrphanBlocks[inv.hash])->GetHash(true));
+            // The headers-first download requests the blocks that it knows:
+            if (fHeadersFirst && inv.type == MSG_BLOCK && g_block_download.IsActive()) {
+                if (!fAlreadyHave && !g_block_download.IsScheduled(inv.hash))
+                    pfrom->AskFor(GetBlockRequest(pfrom, inv));
+            }
+            else if (!fAlreadyHave)
+                pfrom->AskFor(GetBlockRequest(pfrom, inv));
+            else if (inv.type == MSG_BLOCK && g_orphan_blocks.Contains(inv.hash)) {
+                pfrom->PushGetBlocks(pindexBest, g_orphan_blocks.GetRoot(g_orphan_blocks.Get(inv.hash))->GetHash(true));
             } else if (nInv == nLastBlock) {
                 // In case we are on a very long side-chain, it is possible that we already have
                 // the last block in an inv bundle sent in response to getblocks. Try to detect
@@ -4126,25 +5906,52 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
               LogPrint(BCLog::LogFlags::NET, "received getdata for: %s", inv.ToString());
             }
 
-            if (inv.type == MSG_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_CMPCT_BLOCK)
             {
                 // Send block from disk
                 BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
                 if (mi != mapBlockIndex.end())
                 {
-                    CBlock block;
-                    block.ReadFromDisk((*mi).second);
-
-                    // TODO: drop legacy "command nonce" removal transition in the next
-                    // release after the mandatory version:
-                    //
-                    if (pfrom->nVersion >= PROTOCOL_VERSION) {
-                        pfrom->PushMessage("encrypt", block);
-                    } else {
-                        std::string acid;
-                        pfrom->PushMessage("encrypt", block, acid);
+                    // Send recent blocks in compact form when asked. Older
+                    // blocks go in full because the peer's memory pool will
+                    // not contain their transactions:
+                    if (inv.type == MSG_CMPCT_BLOCK && mi->second->nHeight + MAX_CMPCTBLOCK_DEPTH >= nBestHeight)
+                    {
+                        CBlock block;
+                        if (block.ReadFromDisk(mi->second))
+                            pfrom->PushMessage("cmpctblock", CBlockHeaderAndShortTxIDs(block));
+                        continue;
+                    }
+
+                    // Peers that download the same block share one copy of
+                    // the serialized message:
+                    const int nSendVersion = pfrom->ssSend.GetVersion();
+                    const bool fLegacy = pfrom->nVersion < PROTOCOL_VERSION;
+                    const uint256 key = (CHashWriter(SER_GETHASH, 0) << inv.hash << nSendVersion << fLegacy).GetHash();
+
+                    CSharedMessage message = g_block_messages.Get(key);
+
+                    if (!message)
+                    {
+                        CBlock block;
+                        if (!block.ReadFromDisk((*mi).second))
+                            continue;
+
+                        // TODO: drop legacy "command nonce" removal transition in the next
+                        // release after the mandatory version:
+                        //
+                        if (!fLegacy) {
+                            message = MakeSharedMessage(nSendVersion, "encrypt", block);
+                        } else {
+                            std::string acid;
+                            message = MakeSharedMessage(nSendVersion, "encrypt", block, acid);
+                        }
+
+                        g_block_messages.Put(key, message);
                     }
 
+                    pfrom->PushSharedMessage(std::move(message));
+
                     // Trigger them to send a getblocks request for the next batch of inventory
                     if (inv.hash == pfrom->hashContinue)
                     {
@@ -4285,16 +6092,76 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 pindex = pindex->pnext;
         }
 
+        LogPrintf("getheaders %d to %s", (pindex ? pindex->nHeight : -1), hashStop.ToString().substr(0,20));
+
+        const CBlockIndex* pindexFirst = pindex;
+        const CBlockIndex* pindexLast = NULL;
+        int nCount = 0;
+        for (; pindex; pindex = pindex->pnext)
+        {
+            pindexLast = pindex;
+            if (++nCount >= 1000 || pindex->GetBlockHash() == hashStop)
+                break;
+        }
+
+        if (!pindexLast)
+        {
+            pfrom->PushMessage("headers", vector<CBlockHeader>());
+            return true;
+        }
+
+        // The last header commits to every header before it, so the first
+        // and the last blocks identify the reply:
+        const int nSendVersion = pfrom->ssSend.GetVersion();
+        const uint256 key = (CHashWriter(SER_GETHASH, 0)
+            << pindexFirst->GetBlockHash()
+            << pindexLast->GetBlockHash()
+            << nSendVersion).GetHash();
+
+        CSharedMessage message = g_header_messages.Get(key);
+
+        if (!message)
+        {
+            vector<CBlockHeader> vHeaders;
+            vHeaders.reserve(nCount);
+
+            for (const CBlockIndex* p = pindexFirst; p != pindexLast->pnext; p = p->pnext)
+                vHeaders.push_back(p->GetBlockHeader());
+
+            message = MakeSharedMessage(nSendVersion, "headers", vHeaders);
+            g_header_messages.Put(key, message);
+        }
+
+        pfrom->PushSharedMessage(std::move(message));
+    }
+    else if (strCommand == "headers")
+    {
         vector<CBlockHeader> vHeaders;
-        int nLimit = 1000;
-        LogPrintf("getheaders %d to %s", (pindex ? pindex->nHeight : -1), hashStop.ToString().substr(0,20));
-        for (; pindex; pindex = pindex->pnext)
+        vRecv >> vHeaders;
+
+        if (vHeaders.size() > BlockDownloadScheduler::MAX_HEADERS_RESULTS)
         {
-            vHeaders.push_back(pindex->GetBlockHeader());
-            if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
-                break;
+            pfrom->Misbehaving(20);
+            return error("message headers size() = %" PRIszu "", vHeaders.size());
+        }
+
+        // Hash the scrypt headers of early blocks in batches before taking
+        // cs_main. ReceiveHeaders() reads the cached hashes with GetHash(true):
+        if (fHeadersFirst)
+        {
+            std::vector<CBlockHeader*> headers;
+            headers.reserve(vHeaders.size());
+
+            for (auto& header : vHeaders)
+                headers.push_back(&header);
+
+            CBlockHeader::CacheHashes(headers);
         }
-        pfrom->PushMessage("headers", vHeaders);
+
+        LOCK(cs_main);
+
+        if (fHeadersFirst)
+            g_block_download.ReceiveHeaders(pfrom, vHeaders);
     }
     else if (strCommand == "tx")
     {
@@ -4306,13 +6173,27 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
+        if (mempool.exists(inv.hash))
+            return true;
+
+        // Run the checks that do not need cs_main first. On a message worker
+        // thread, a flood of transactions then holds up blocks less:
+        if (!PreValidateTransaction(tx))
+        {
+            if (tx.nDoS) pfrom->Misbehaving(tx.nDoS);
+            return true;
+        }
+
         LOCK(cs_main);
 
         bool fMissingInputs = false;
-        if (AcceptToMemoryPool(mempool, tx, &fMissingInputs))
+        if (AcceptToMemoryPool(mempool, tx, &fMissingInputs, true))
         {
             RelayTransaction(tx, inv.hash);
-            mapAlreadyAskedFor.erase(inv);
+            {
+                LOCK(cs_mapAlreadyAskedFor);
+                mapAlreadyAskedFor.erase(inv);
+            }
             vWorkQueue.push_back(inv.hash);
             vEraseQueue.push_back(inv.hash);
 
@@ -4332,7 +6213,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                     {
                         LogPrintf("   accepted orphan tx %s", orphanTxHash.ToString().substr(0,10));
                         RelayTransaction(orphanTx, orphanTxHash);
-                        mapAlreadyAskedFor.erase(CInv(MSG_TX, orphanTxHash));
+                        {
+                            LOCK(cs_mapAlreadyAskedFor);
+                            mapAlreadyAskedFor.erase(CInv(MSG_TX, orphanTxHash));
+                        }
                         vWorkQueue.push_back(orphanTxHash);
                         vEraseQueue.push_back(orphanTxHash);
                         pfrom->nTrust++;
@@ -4366,38 +6250,185 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     {
         //Response from getblocks, message = block
 
+        // Read the block straight from the message buffer. The block keeps
+        // the buffer to write the same bytes to disk:
+        CSerializeData buffer;
+        vRecv.Compact();
+        vRecv.SwapBuffer(buffer);
+
         CBlock block;
-        vRecv >> block;
+        const Span<const unsigned char> rest = block.ReadFromBuffer(
+            std::make_shared<const CSerializeData>(std::move(buffer)),
+            vRecv.GetType(),
+            vRecv.GetVersion());
 
         // TODO: drop legacy "command nonce" removal transition in the next
         // release after the mandatory version:
         //
         if (pfrom->nVersion < PROTOCOL_VERSION) {
             std::string acid;
-            vRecv >> acid;
+            SpanReader(vRecv.GetType(), vRecv.GetVersion(), rest) >> acid;
         }
 
-        uint256 hashBlock = block.GetHash(true);
+        LOCK(cs_main);
+
+        ProcessReceivedBlock(pfrom, block);
+    }
 
-        LogPrintf(" Received block %s; ", hashBlock.ToString());
-        if (LogInstance().WillLogCategory(BCLog::LogFlags::NOISY)) block.print();
 
-        CInv inv(MSG_BLOCK, hashBlock);
-        pfrom->AddInventoryKnown(inv);
+    else if (strCommand == "sendcmpct")
+    {
+        bool fAnnounce = false;
+        uint64_t nCompactVersion = 0;
+        vRecv >> fAnnounce >> nCompactVersion;
+
+        if (nCompactVersion == 1)
+            pfrom->fSupportsCompactBlocks = true;
+    }
+
+
+    else if (strCommand == "cmpctblock")
+    {
+        CBlockHeaderAndShortTxIDs cmpctblock;
+        vRecv >> cmpctblock;
+
+        const uint256 hashBlock = cmpctblock.header.GetHash(true);
 
         LOCK(cs_main);
 
-        if (ProcessBlock(pfrom, &block, false))
+        // Reconstructing a block costs a pass over the memory pool and may
+        // hold state for its missing transactions, so only accept compact
+        // blocks that the node asked this peer for:
         {
-            mapAlreadyAskedFor.erase(inv);
-            pfrom->nTrust++;
+            LOCK(cs_mapAlreadyAskedFor);
+
+            if (!pfrom->setCompactBlocksAsked.erase(hashBlock))
+            {
+                LogPrint(BCLog::LogFlags::NET, "ignoring unrequested compact block %s from peer %d",
+                    hashBlock.ToString(), pfrom->GetId());
+                return true;
+            }
+
+            mapAlreadyAskedFor.erase(CInv(MSG_CMPCT_BLOCK, hashBlock));
+        }
+
+        if (mapBlockIndex.count(hashBlock) || g_orphan_blocks.Contains(hashBlock))
+            return true;
+
+        // An orphan cannot connect until its ancestors arrive, so fetch it in
+        // full and let the orphan handling ask for its parents:
+        if (!mapBlockIndex.count(cmpctblock.header.hashPrevBlock))
+        {
+            RequestFullBlock(pfrom, hashBlock);
+            return true;
+        }
+
+        auto partial = std::make_shared<PartiallyDownloadedBlock>();
+        const ReadStatus status = partial->InitData(cmpctblock, mempool);
+
+        if (status == ReadStatus::INVALID)
+        {
+            pfrom->Misbehaving(100);
+            return error("invalid compact block %s from peer %d", hashBlock.ToString(), pfrom->GetId());
+        }
+
+        if (status == ReadStatus::FAILED)
+        {
+            RequestFullBlock(pfrom, hashBlock);
+            return true;
+        }
+
+        BlockTransactionsRequest req;
+        req.blockhash = hashBlock;
+        req.indexes = partial->GetMissing();
+
+        if (req.indexes.empty())
+        {
+            CBlock block;
+
+            if (partial->FillBlock(block, {}) != ReadStatus::OK)
+                RequestFullBlock(pfrom, hashBlock);
+            else
+                ProcessReceivedBlock(pfrom, block);
+
+            return true;
+        }
+
+        LogPrint(BCLog::LogFlags::NET, "compact block %s is missing %" PRIszu " of %" PRIszu " transactions",
+            hashBlock.ToString(), req.indexes.size(), cmpctblock.BlockTxCount());
+
+        const int64_t nNow = GetAdjustedTime();
+
+        g_partial_blocks.erase(hashBlock);
+        ReservePartialBlock(pfrom->GetId(), nNow);
+
+        g_partial_blocks[hashBlock] = PartialBlock { pfrom->GetId(), nNow, partial };
+        pfrom->PushMessage("getblocktxn", req);
+    }
+
+
+    else if (strCommand == "getblocktxn")
+    {
+        BlockTransactionsRequest req;
+        vRecv >> req;
+
+        LOCK(cs_main);
+
+        BlockMap::iterator mi = mapBlockIndex.find(req.blockhash);
+
+        if (mi == mapBlockIndex.end() || mi->second->nHeight + MAX_CMPCTBLOCK_DEPTH < nBestHeight)
+            return true;
+
+        CBlock block;
+        if (!block.ReadFromDisk(mi->second))
+            return true;
+
+        BlockTransactions resp(req);
+        resp.txn.reserve(req.indexes.size());
+
+        for (const auto& index : req.indexes)
+        {
+            if (index >= block.vtx.size())
+            {
+                pfrom->Misbehaving(100);
+                return error("getblocktxn index out of bounds from peer %d", pfrom->GetId());
+            }
+
+            resp.txn.push_back(block.vtx[index]);
         }
-        if (block.nDoS)
+
+        pfrom->PushMessage("blocktxn", resp);
+    }
+
+
+    else if (strCommand == "blocktxn")
+    {
+        BlockTransactions resp;
+        vRecv >> resp;
+
+        LOCK(cs_main);
+
+        auto iter = g_partial_blocks.find(resp.blockhash);
+
+        if (iter == g_partial_blocks.end() || iter->second.node != pfrom->GetId())
+            return true;
+
+        const std::shared_ptr<PartiallyDownloadedBlock> partial = iter->second.block;
+        g_partial_blocks.erase(iter);
+
+        CBlock block;
+        const ReadStatus status = partial->FillBlock(block, resp.txn);
+
+        if (status == ReadStatus::INVALID)
         {
-                pfrom->Misbehaving(block.nDoS);
-                pfrom->nTrust--;
+            pfrom->Misbehaving(100);
+            return error("invalid blocktxn for %s from peer %d", resp.blockhash.ToString(), pfrom->GetId());
         }
 
+        if (status == ReadStatus::FAILED)
+            RequestFullBlock(pfrom, resp.blockhash);
+        else
+            ProcessReceivedBlock(pfrom, block);
     }
 
 
@@ -4523,7 +6554,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             LogPrintf("pong %s %s: %s, %" PRIx64 " expected, %" PRIx64 " received, %" PRIu64 " bytes"
                 , pfrom->addr.ToString()
                 , pfrom->strSubVer
-                , sProblem, pfrom->nPingNonceSent, nonce, nAvail);
+                , sProblem, pfrom->nPingNonceSent.load(), nonce, nAvail);
         }
         if (bPingFinished) {
             pfrom->nPingNonceSent = 0;
@@ -4561,14 +6592,10 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 
     else if (strCommand == "scraperindex")
     {
-        LOCK(CScraperManifest::cs_mapManifest);
-
         CScraperManifest::RecvManifest(pfrom,vRecv);
     }
     else if (strCommand == "part")
     {
-        LOCK(CSplitBlob::cs_mapParts);
-
         CSplitBlob::RecvPart(pfrom,vRecv);
     }
 
@@ -4595,6 +6622,223 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
     return true;
 }
 
+// Run ProcessMessage() and log the exceptions that it throws.
+bool static HandleMessage(CNode* pfrom, const string& strCommand, CDataStream& vRecv, int64_t nTimeReceived)
+{
+    const unsigned int nMessageSize = vRecv.size();
+    const int64_t nStartUsec = GetTimeMicros();
+    bool fRet = false;
+
+    try
+    {
+        fRet = ProcessMessage(pfrom, strCommand, vRecv, nTimeReceived);
+    }
+    catch (std::ios_base::failure& e)
+    {
+        if (strstr(e.what(), "end of data"))
+        {
+            // Allow exceptions from under-length message on vRecv
+            LogPrintf("ProcessMessages(%s, %u bytes) : Exception '%s' caught, normally caused by a message being shorter than its stated length", strCommand, nMessageSize, e.what());
+        }
+        else if (strstr(e.what(), "size too large"))
+        {
+            // Allow exceptions from over-long size
+            LogPrintf("ProcessMessages(%s, %u bytes) : Exception '%s' caught", strCommand, nMessageSize, e.what());
+        }
+        else
+        {
+            PrintExceptionContinue(&e, "ProcessMessages()");
+        }
+    }
+    catch (std::exception& e) {
+        PrintExceptionContinue(&e, "ProcessMessages()");
+    } catch (...) {
+        PrintExceptionContinue(NULL, "ProcessMessages()");
+    }
+
+    if (!fRet)
+    {
+       LogPrint(BCLog::LogFlags::NOISY, "ProcessMessage(%s, %u bytes) FAILED", strCommand, nMessageSize);
+    }
+
+    pfrom->RecordMessageRecv(
+        strCommand,
+        nMessageSize + CMessageHeader::HEADER_SIZE,
+        GetTimeMicros() - nStartUsec);
+
+    return fRet;
+}
+
+namespace {
+//!
+//! \brief Determine whether the message worker threads may handle a message.
+//!
+//! The handlers for these commands do not take cs_main and only touch state
+//! guarded by their own locks. The scraper commands take the longest: they
+//! hash the payload, and a manifest needs a signature check.
+//!
+//! The transaction handler takes cs_main only after it checks the structure
+//! and the input signatures of a transaction, so several workers verify
+//! transactions at once.
+//!
+//! Address relay ("gridaddr") stays on the message handler thread because
+//! SendMessages() reads the address queues of the nodes without a lock.
+//!
+bool IsConcurrentCommand(const std::string& strCommand)
+{
+    return strCommand == "ping"
+        || strCommand == "pong"
+        || strCommand == "part"
+        || strCommand == "scraperindex"
+        || strCommand == "tx";
+}
+
+//!
+//! \brief Queues messages for the message worker threads.
+//!
+//! Each node has its own queue. A worker takes one message from the node at
+//! the front of the ready list and moves the node to the back when more of
+//! its messages wait, so a node that sends many messages cannot starve the
+//! others. Only one worker handles the messages of a node at a time, so the
+//! messages of a node complete in the order received.
+//!
+class MessageWorkQueue
+{
+public:
+    //!
+    //! \brief Queue a message for a worker.
+    //!
+    //! \param pnode Node that sent the message. Holds a reference until a
+    //! worker handles the message.
+    //!
+    void Push(CNode* pnode, std::string strCommand, CDataStream vRecv, int64_t nTimeReceived)
+    {
+        pnode->AddRef();
+        pnode->nWorkQueueSize += vRecv.size();
+
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            PeerQueue& queue = m_peers[pnode];
+
+            queue.m_tasks.push_back({ std::move(strCommand), std::move(vRecv), nTimeReceived });
+
+            if (!queue.m_active && queue.m_tasks.size() == 1) {
+                m_ready.push_back(pnode);
+            }
+        }
+
+        m_cond.notify_one();
+    }
+
+    //!
+    //! \brief Handle queued messages until the thread is interrupted.
+    //!
+    void Thread()
+    {
+        while (true) {
+            CNode* pnode;
+            Task task;
+
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+
+                while (m_ready.empty()) {
+                    m_cond.wait(lock);
+                }
+
+                pnode = m_ready.front();
+                m_ready.pop_front();
+
+                PeerQueue& queue = m_peers[pnode];
+                task = std::move(queue.m_tasks.front());
+                queue.m_tasks.pop_front();
+                queue.m_active = true;
+            }
+
+            const size_t nSize = task.m_recv.size();
+
+            if (!pnode->fDisconnect) {
+                HandleMessage(pnode, task.m_command, task.m_recv, task.m_time);
+            }
+
+            g_recv_buffers.Recycle(task.m_recv);
+
+            bool fDrained = false;
+
+            {
+                boost::lock_guard<boost::mutex> lock(m_mutex);
+                auto iter = m_peers.find(pnode);
+
+                if (iter->second.m_tasks.empty()) {
+                    m_peers.erase(iter);
+                    fDrained = true;
+                } else {
+                    iter->second.m_active = false;
+                    m_ready.push_back(pnode);
+                }
+            }
+
+            if (!fDrained) {
+                m_cond.notify_one();
+            }
+
+            pnode->nWorkQueueSize -= nSize;
+
+            {
+                LOCK(cs_vNodes);
+                pnode->Release();
+            }
+
+            // The message handler stops passing messages from a node with a
+            // full queue:
+            if (fDrained) {
+                WakeMessageHandler();
+            }
+        }
+    }
+
+private:
+    //!
+    //! \brief A message waiting for a worker.
+    //!
+    struct Task
+    {
+        std::string m_command; //!< Message command.
+        CDataStream m_recv;    //!< Message payload.
+        int64_t m_time;        //!< Time received in microseconds.
+
+        Task() : m_recv(SER_NETWORK, PROTOCOL_VERSION), m_time(0) { }
+
+        Task(std::string command, CDataStream recv, int64_t time)
+            : m_command(std::move(command)), m_recv(std::move(recv)), m_time(time)
+        {
+        }
+    };
+
+    //!
+    //! \brief Messages from one node.
+    //!
+    struct PeerQueue
+    {
+        std::deque<Task> m_tasks; //!< Messages in the order received.
+        bool m_active = false;    //!< Whether a worker handles a message now.
+    };
+
+    boost::mutex m_mutex;                //!< Guards the members below.
+    boost::condition_variable m_cond;    //!< Signals a node in m_ready.
+    std::map<CNode*, PeerQueue> m_peers; //!< Queues of nodes with messages.
+    std::deque<CNode*> m_ready;          //!< Nodes waiting for a worker.
+}; // MessageWorkQueue
+
+MessageWorkQueue g_message_workers;
+} // anonymous namespace
+
+void ThreadMessageWorker()
+{
+    RenameThread("grc-msgworker");
+    g_message_workers.Thread();
+}
+
 // requires LOCK(cs_vRecvMsg)
 bool ProcessMessages(CNode* pfrom)
 {
@@ -4614,6 +6858,10 @@ bool ProcessMessages(CNode* pfrom)
         if (pfrom->nSendSize >= SendBufferSize())
             break;
 
+        // Let the message workers catch up with the node:
+        if (pfrom->nWorkQueueSize >= ReceiveFloodSize())
+            break;
+
         // get next message
         CNetMessage& msg = *it;
 
@@ -4662,52 +6910,36 @@ bool ProcessMessages(CNode* pfrom)
             continue;
         }
 
-        // Process message
-        bool fRet = false;
-        try
-        {
-            fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
-            if (fShutdown)
-                break;
-        }
-        catch (std::ios_base::failure& e)
+        // Hand off messages that do not need cs_main once the node sent
+        // its version:
+        if (nMessageWorkerThreads > 0 && pfrom->nVersion != 0 && IsConcurrentCommand(strCommand))
         {
-            if (strstr(e.what(), "end of data"))
-            {
-                // Allow exceptions from under-length message on vRecv
-                LogPrintf("ProcessMessages(%s, %u bytes) : Exception '%s' caught, normally caused by a message being shorter than its stated length", strCommand, nMessageSize, e.what());
-            }
-            else if (strstr(e.what(), "size too large"))
-            {
-                // Allow exceptions from over-long size
-                LogPrintf("ProcessMessages(%s, %u bytes) : Exception '%s' caught", strCommand, nMessageSize, e.what());
-            }
-            else
-            {
-                PrintExceptionContinue(&e, "ProcessMessages()");
-            }
-        }
-        catch (std::exception& e) {
-            PrintExceptionContinue(&e, "ProcessMessages()");
-        } catch (...) {
-            PrintExceptionContinue(NULL, "ProcessMessages()");
+            g_message_workers.Push(pfrom, std::move(strCommand), std::move(vRecv), msg.nTime);
+            continue;
         }
 
-        if (!fRet)
-        {
-           LogPrint(BCLog::LogFlags::NOISY, "ProcessMessage(%s, %u bytes) FAILED", strCommand, nMessageSize);
-        }
+        // Process message
+        HandleMessage(pfrom, strCommand, vRecv, msg.nTime);
+
+        if (fShutdown)
+            break;
     }
 
     // In case the connection got shut down, its receive buffer was wiped
-    if (!pfrom->fDisconnect)
+    if (!pfrom->fDisconnect) {
+        for (auto done = pfrom->vRecvMsg.begin(); done != it; ++done) {
+            g_recv_buffers.Recycle(done->vRecv);
+        }
+
         pfrom->vRecvMsg.erase(pfrom->vRecvMsg.begin(), it);
+        pfrom->UpdateRecvSize();
+    }
 
     return fOk;
 }
 
 // Note: this function requires a lock on cs_main before calling. (See below comments.)
-bool SendMessages(CNode* pto, bool fSendTrickle)
+bool SendMessages(CNode* pto)
 {
     // Some comments and TODOs in order...
     // 1. This function never returns anything but true... (try to find a return other than true).
@@ -4791,11 +7023,15 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
         nLastRebroadcast =  GetAdjustedTime();
     }
 
+    const int64_t nNowMicros = GetTimeMicros();
+
     //
     // Message: addr
     //
-    if (fSendTrickle)
+    if (pto->nNextAddrSend < nNowMicros)
     {
+        pto->nNextAddrSend = PoissonNextSend(nNowMicros, AVG_ADDRESS_BROADCAST_INTERVAL);
+
         vector<CAddress> vAddr;
         vAddr.reserve(pto->vAddrToSend.size());
         for (auto const& addr : pto->vAddrToSend)
@@ -4821,56 +7057,52 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
     //
     // Message: inventory
     //
+    // Transactions and scraper manifests go out in batches at random
+    // intervals for each peer so that the order of announcements across
+    // peers does not reveal their origin. Blocks and parts go out at once.
+    //
+    bool fSendTrickle = false;
+    if (pto->nNextInvSend < nNowMicros)
+    {
+        fSendTrickle = true;
+        pto->nNextInvSend = PoissonNextSend(
+            nNowMicros,
+            pto->fInbound ? INVENTORY_BROADCAST_INTERVAL : INVENTORY_BROADCAST_INTERVAL / 2.0);
+    }
+
     vector<CInv> vInv;
     vector<CInv> vInvWait;
     {
         LOCK(pto->cs_inventory);
-        vInv.reserve(pto->vInventoryToSend.size());
-        vInvWait.reserve(pto->vInventoryToSend.size());
+        vInv.reserve(std::min<size_t>(pto->vInventoryToSend.size(), nMaxInvPerMessage));
+        unsigned int nTxBudget = INVENTORY_BROADCAST_MAX;
         for (auto const& inv : pto->vInventoryToSend)
         {
-            if (pto->setInventoryKnown.count(inv))
+            if (pto->filterInventoryKnown.contains(inv))
                 continue;
 
-            // trickle out tx inv to protect privacy
-            if (inv.type == MSG_TX && !fSendTrickle)
+            if (inv.type == MSG_TX || inv.type == MSG_SCRAPERINDEX)
             {
-                // 1/4 of tx invs blast to all immediately
-                static arith_uint256 hashSalt;
-                if (hashSalt == 0)
-                    hashSalt = UintToArith256(GetRandHash());
-                uint256 hashRand = ArithToUint256(UintToArith256(inv.hash) ^ hashSalt);
-                hashRand = Hash(hashRand.begin(), hashRand.end());
-                bool fTrickleWait = ((UintToArith256(hashRand) & 3) != 0);
-
-                // always trickle our own transactions
-                if (!fTrickleWait)
-                {
-                    CWalletTx wtx;
-                    if (GetTransaction(inv.hash, wtx))
-                        if (wtx.fFromMe)
-                            fTrickleWait = true;
-                }
-
-                if (fTrickleWait)
+                // Rate-limit transactions. The rest wait for the next batch:
+                if (!fSendTrickle || (inv.type == MSG_TX && nTxBudget == 0))
                 {
                     vInvWait.push_back(inv);
                     continue;
                 }
+
+                if (inv.type == MSG_TX)
+                    --nTxBudget;
             }
 
-            // returns true if wasn't already contained in the set
-            if (pto->setInventoryKnown.insert(inv).second)
+            pto->filterInventoryKnown.insert(inv);
+            vInv.push_back(inv);
+            if (vInv.size() >= nMaxInvPerMessage)
             {
-                vInv.push_back(inv);
-                if (vInv.size() >= 1000)
-                {
-                    pto->PushMessage("inv", vInv);
-                    vInv.clear();
-                }
+                pto->PushMessage("inv", vInv);
+                vInv.clear();
             }
         }
-        pto->vInventoryToSend = vInvWait;
+        pto->vInventoryToSend = std::move(vInvWait);
     }
     if (!vInv.empty())
         pto->PushMessage("inv", vInv);
@@ -4881,20 +7113,30 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
     //
     vector<CInv> vGetData;
     int64_t nNow =  GetAdjustedTime() * 1000000;
+    ExpireAlreadyAskedFor(nNow);
     CTxDB txdb("r");
-    while (!pto->mapAskFor.empty() && (*pto->mapAskFor.begin()).first <= nNow)
+    while (true)
     {
-        const CInv& inv = (*pto->mapAskFor.begin()).second;
+        CInv inv;
 
-        // mapAlreadyAskedFor gains an entry when the node enqueues a request
-        // for the object from a peer, and the node removes the entry when it
-        // receives the object. If the request does not exist in this map, we
-        // don't need to ask for the object again:
-        //
-        if (mapAlreadyAskedFor.find(inv) == mapAlreadyAskedFor.end())
+        // The message workers hold the scraper locks when they take this
+        // lock, so do not hold it across the checks below:
         {
+            LOCK(cs_mapAlreadyAskedFor);
+
+            if (pto->mapAskFor.empty() || (*pto->mapAskFor.begin()).first > nNow)
+                break;
+
+            inv = (*pto->mapAskFor.begin()).second;
             pto->mapAskFor.erase(pto->mapAskFor.begin());
-            continue;
+
+            // mapAlreadyAskedFor gains an entry when the node enqueues a request
+            // for the object from a peer, and the node removes the entry when it
+            // receives the object. If the request does not exist in this map, we
+            // don't need to ask for the object again:
+            //
+            if (mapAlreadyAskedFor.find(inv) == mapAlreadyAskedFor.end())
+                continue;
         }
 
         bool fAlreadyHave = AlreadyHave(txdb, inv);
@@ -4917,13 +7159,24 @@ bool SendMessages(CNode* pto, bool fSendTrickle)
                 vGetData.clear();
             }
 
-            mapAlreadyAskedFor[inv] = nNow;
+            {
+                LOCK(cs_mapAlreadyAskedFor);
+                mapAlreadyAskedFor[inv] = nNow;
+
+                if (inv.type == MSG_CMPCT_BLOCK)
+                    pto->setCompactBlocksAsked.insert(inv.hash);
+            }
         }
-        pto->mapAskFor.erase(pto->mapAskFor.begin());
     }
     if (!vGetData.empty())
         pto->PushMessage("getdata", vGetData);
 
+    //
+    // Message: getheaders and getdata for the headers-first download
+    //
+    if (fHeadersFirst)
+        g_block_download.SendRequests(pto);
+
     return true;
 }
 
@@ -12,13 +12,16 @@
 #include "net.h"
 #include "gridcoin/contract/contract.h"
 #include "gridcoin/cpid.h"
+#include "gridcoin/superblock.h"
 #include "sync.h"
 #include "script.h"
 #include "scrypt.h"
+#include "util/hasher.h"
 
 #include <map>
 #include <unordered_map>
 #include <set>
+#include <tuple>
 
 class CWallet;
 class CBlock;
@@ -86,7 +89,6 @@ extern const std::string strMessageMagic;
 extern CCriticalSection cs_setpwalletRegistered;
 extern std::set<CWallet*> setpwalletRegistered;
 extern unsigned char pchMessageStart[4];
-extern std::map<uint256, CBlock*> mapOrphanBlocks;
 
 // Settings
 extern int64_t nTransactionFee;
@@ -94,6 +96,16 @@ extern int64_t nReserveBalance;
 extern int64_t nMinimumInputValue;
 
 extern bool fUseFastIndex;
+extern bool fBlockFilterIndex;
+extern bool fBlockStatsIndex;
+extern bool fAddressIndex;
+extern bool fSpentIndex;
+extern bool fResearchIndex;
+extern size_t nBlockCacheSize;
+extern bool fMmapBlocks;
+extern uint64_t nPruneTarget;
+extern bool fHeadersFirst;
+extern uint256 hashAssumeValid;
 extern unsigned int nDerivationMethodIndex;
 
 extern bool fEnforceCanonical;
@@ -101,6 +113,44 @@ extern bool fEnforceCanonical;
 // Minimum disk space required - used in CheckDiskSpace()
 static const uint64_t nMinDiskSpace = 52428800;
 
+/** Maximum number of script-checking threads allowed */
+static const int MAX_SCRIPTCHECK_THREADS = 16;
+/** -par default (number of script-checking threads, 0 = auto) */
+static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of message worker threads allowed */
+static const int MAX_MESSAGE_WORKER_THREADS = 8;
+/** -msgthreads default (number of message worker threads, 0 = none) */
+static const int DEFAULT_MESSAGE_WORKER_THREADS = 2;
+/** -blockcachesize default (megabytes of recently read blocks to keep) */
+static const unsigned int DEFAULT_BLOCK_CACHE_SIZE = 32;
+/** Smallest block file footprint in megabytes accepted by -prune. */
+static const uint64_t MIN_PRUNE_TARGET = 550;
+/** Number of blocks between attempts to prune the block files. */
+static const int PRUNE_INTERVAL = 500;
+/** Maximum number of block files pruned for each connected block. */
+static const size_t MAX_PRUNE_FILES_PER_BLOCK = 2;
+/** -maxorphanblocksmb default (megabytes of blocks that wait for their parents) */
+static const unsigned int DEFAULT_MAX_ORPHAN_BLOCKS_SIZE = 64;
+/** Number of blocks below the tip that keep undo records for reorganizations */
+static const int BLOCK_UNDO_DEPTH = 1000;
+/** Average seconds between address broadcasts to a peer */
+static const int AVG_ADDRESS_BROADCAST_INTERVAL = 30;
+/** Average seconds between trickled inventory broadcasts to an inbound peer.
+ *  Outbound peers receive them twice as often. */
+static const int INVENTORY_BROADCAST_INTERVAL = 5;
+/** Maximum number of transactions announced to a peer per broadcast */
+static const unsigned int INVENTORY_BROADCAST_MAX = 7 * INVENTORY_BROADCAST_INTERVAL;
+/** -maxinvpermsg default (inventory entries per "inv" message) */
+static const unsigned int DEFAULT_MAX_INV_PER_MESSAGE = 1000;
+/** -maxmempool default (megabytes of memory for memory pool transactions) */
+static const unsigned int DEFAULT_MAX_MEMPOOL_SIZE = 300;
+/** -mempoolexpiry default (hours that a transaction may wait in the memory pool) */
+static const unsigned int DEFAULT_MEMPOOL_EXPIRY = 336;
+
+extern int nScriptCheckThreads;
+extern int nMessageWorkerThreads;
+extern unsigned int nMaxInvPerMessage;
+
 extern std::string  msMiningErrors;
 extern std::string  msMiningErrorsIncluded;
 extern std::string  msMiningErrorsExcluded;
@@ -125,6 +175,7 @@ extern globalStatusType GlobalStatusStruct;
 class CReserveKey;
 class CTxDB;
 class CTxIndex;
+class CScriptCheck;
 
 void RegisterWallet(CWallet* pwalletIn);
 void UnregisterWallet(CWallet* pwalletIn);
@@ -133,11 +184,41 @@ bool ProcessBlock(CNode* pfrom, CBlock* pblock, bool Generated_By_Me);
 bool CheckDiskSpace(uint64_t nAdditionalBytes=0);
 FILE* OpenBlockFile(unsigned int nFile, unsigned int nBlockPos, const char* pszMode="rb");
 FILE* AppendBlockFile(unsigned int& nFileRet);
+/** Deserialize a block directly from a memory-mapped block file.
+ * @return false if the block file cannot be mapped. Throws on
+ * deserialization errors.
+ */
+bool ReadBlockFromMappedFile(unsigned int nFile, unsigned int nBlockPos, int nSerFlags, CBlock& block);
+/** Delete the data of old blocks that the node no longer needs until the
+ * block files fit in nPruneTarget bytes. Retained blocks move from the old
+ * files to the end of the current one.
+ *
+ * Runs every PRUNE_INTERVAL blocks. Each call prunes at most
+ * MAX_PRUNE_FILES_PER_BLOCK files so that it holds cs_main for a bounded
+ * time, and the calls for the following blocks continue until the files fit.
+ * @return false if the block or transaction index could not be updated.
+ */
+bool PruneBlockFiles();
 bool LoadBlockIndex(bool fAllowNew=true);
+/** Allocate a block index entry from the block index arena, initialized as
+ * a copy of the supplied entry. Entries live until shutdown.
+ * @note requires lock cs_main held, or exclusive access during startup.
+ */
+CBlockIndex* NewBlockIndex(const CBlockIndex& index);
+/** Write the block index entries of blocks that did not connect to the
+ * chain since the last flush.
+ * @param fForce Write now instead of when the interval or the entry limit
+ * elapses.
+ */
+bool FlushBlockIndex(bool fForce);
 void PrintBlockTree();
+/** Run an instance of the script checking thread */
+void ThreadScriptCheck();
+/** Run an instance of the thread that handles messages without cs_main */
+void ThreadMessageWorker();
 
 bool ProcessMessages(CNode* pfrom);
-bool SendMessages(CNode* pto, bool fSendTrickle);
+bool SendMessages(CNode* pto);
 bool LoadExternalBlockFile(FILE* fileIn);
 
 bool CheckProofOfWork(uint256 hash, unsigned int nBits);
@@ -153,9 +234,52 @@ std::string DefaultWalletAddress();
 
 bool OutOfSyncByAge();
 
-/** (try to) add transaction to memory pool **/
+//!
+//! \brief Immutable summary of the best chain that the node publishes after
+//! each change of the tip.
+//!
+//! Read-only RPCs that poll the state of the chain answer from the current
+//! view without taking cs_main. A view never changes after publication, so
+//! its fields always describe the same block.
+//!
+struct ChainTipView
+{
+    uint256 hashBestChain;             //!< Hash of the tip.
+    int nHeight = -1;                  //!< Height of the tip.
+    int64_t nTime = 0;                 //!< Timestamp of the tip.
+    int64_t nMoneySupply = 0;          //!< Money supply at the tip.
+    double dDifficulty = 0;            //!< Difficulty of the last proof-of-stake block.
+    double dTargetDifficulty = 0;      //!< Difficulty required of the next block.
+    GRC::SuperblockPtr superblock;     //!< Superblock active at the tip.
+    GRC::SuperblockPtr pending;        //!< Superblock waiting for the tally to commit it.
+};
+
+//!
+//! \brief Rebuild and publish the chain tip view from the current tip.
+//!
+//! Requires a lock on cs_main.
+//!
+void PublishChainTipView();
+
+//!
+//! \brief Get the most recently published chain tip view. Takes no locks
+//! besides the atomic swap of the pointer.
+//!
+std::shared_ptr<const ChainTipView> GetChainTipView();
+
+/** Run the checks of AcceptToMemoryPool that depend on the transaction
+ *  alone: its structure and the structure of its contracts. Then verify the
+ *  signatures of the inputs found in the chain or in the memory pool so that
+ *  the signature cache answers for them when AcceptToMemoryPool connects the
+ *  inputs. Does not require cs_main.
+ *  @return false if the transaction is invalid. Sets tx.nDoS.
+ */
+bool PreValidateTransaction(const CTransaction& tx);
+/** (try to) add transaction to memory pool
+ *  @param fPreValidated Skip the checks that PreValidateTransaction() ran.
+ */
 bool AcceptToMemoryPool(CTxMemPool& pool, CTransaction &tx,
-                        bool* pfMissingInputs);
+                        bool* pfMissingInputs, bool fPreValidated = false);
 bool SetBestChain(CTxDB& txdb, CBlock &blockNew, CBlockIndex* pindexNew);
 
 /** Position on disk for a particular transaction. */
@@ -166,6 +290,12 @@ public:
     unsigned int nBlockPos;
     unsigned int nTxPos;
 
+#if !defined(WORDS_BIGENDIAN)
+    //! Vectors of positions serialize in bulk: the fields have no padding and
+    //! sit in memory in their little-endian serialized form.
+    static constexpr bool BULK_SERIALIZABLE = true;
+#endif
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -203,6 +333,11 @@ public:
         return !(a == b);
     }
 
+    friend bool operator<(const CDiskTxPos& a, const CDiskTxPos& b)
+    {
+        return std::tie(a.nFile, a.nBlockPos, a.nTxPos) < std::tie(b.nFile, b.nBlockPos, b.nTxPos);
+    }
+
 
     std::string ToString() const
     {
@@ -218,6 +353,8 @@ public:
     }
 };
 
+static_assert(sizeof(CDiskTxPos) == 12, "CDiskTxPos serializes in bulk and must not have padding");
+
 
 
 /** An inpoint - a combination of a transaction and an index n into its vin */
@@ -304,7 +441,7 @@ public:
     explicit CTxIn(COutPoint prevoutIn, CScript scriptSigIn=CScript(), unsigned int nSequenceIn=std::numeric_limits<unsigned int>::max())
     {
         prevout = prevoutIn;
-        scriptSig = scriptSigIn;
+        scriptSig = std::move(scriptSigIn);
         nSequence = nSequenceIn;
     }
 
@@ -388,7 +525,7 @@ public:
     CTxOut(int64_t nValueIn, CScript scriptPubKeyIn)
     {
         nValue = nValueIn;
-        scriptPubKey = scriptPubKeyIn;
+        scriptPubKey = std::move(scriptPubKeyIn);
     }
 
     ADD_SERIALIZE_METHODS;
@@ -507,6 +644,11 @@ public:
         } else {
             READWRITE(hashBoinc);
         }
+
+        if (ser_action.ForRead()) {
+            m_hash_cache.SetNull();
+            m_legacy_contracts_parsed = false;
+        }
     }
 
     void SetNull()
@@ -519,6 +661,8 @@ public:
         nDoS = 0;  // Denial-of-service prevention
         hashBoinc = "";
         vContracts.clear();
+        m_hash_cache.SetNull();
+        m_legacy_contracts_parsed = false;
     }
 
     bool IsNull() const
@@ -526,8 +670,26 @@ public:
         return (vin.empty() && vout.empty());
     }
 
-    uint256 GetHash() const
+    uint256 GetHash(const bool use_cache = false) const
     {
+        // Like the block hash cache of CBlockHeader, the transaction hash
+        // cache serves the validation of a block and the memory pool, where
+        // each transaction is hashed several times. The fields of the class
+        // are public, so only deserialization and SetNull() clear the cache.
+        //
+        // Pass use_cache only for a transaction that no longer changes, like
+        // one received from a peer or read from disk, under a lock that the
+        // other readers of the object hold too (usually cs_main). Never read
+        // the cache while building or signing a transaction.
+        //
+        if (use_cache) {
+            if (m_hash_cache.IsNull()) {
+                m_hash_cache = SerializeHash(*this);
+            }
+
+            return m_hash_cache;
+        }
+
         return SerializeHash(*this);
     }
 
@@ -736,11 +898,13 @@ public:
         @param[in] pindexBlock
         @param[in] fBlock	true if called from ConnectBlock
         @param[in] fMiner	true if called from CreateNewBlock
+        @param[out] pvChecks	If not null, script checks are pushed onto it instead of being performed inline
         @return Returns true if all checks succeed
      */
     bool ConnectInputs(CTxDB& txdb, MapPrevTx inputs,
                        std::map<uint256, CTxIndex>& mapTestPool, const CDiskTxPos& posThisTx,
-                       const CBlockIndex* pindexBlock, bool fBlock, bool fMiner);
+                       const CBlockIndex* pindexBlock, bool fBlock, bool fMiner,
+                       std::vector<CScriptCheck>* pvChecks = nullptr);
 
     bool CheckTransaction() const;
 
@@ -758,13 +922,21 @@ public:
     //!
     //! \brief Get the contracts contained in the transaction.
     //!
+    //! Version 1 transactions parse the legacy contract in \c hashBoinc on
+    //! the first call only. Validation, the contract handlers and the RPC
+    //! share the parsed contract after that.
+    //!
     //! \return The set of contracts contained in the transaction. Version 1
     //! transactions can only store one contract.
     //!
     const std::vector<GRC::Contract>& GetContracts() const
     {
-        if (nVersion == 1 && vContracts.empty() && GRC::Contract::Detect(hashBoinc)) {
-            REF(vContracts).emplace_back(GRC::Contract::Parse(hashBoinc));
+        if (nVersion == 1 && !m_legacy_contracts_parsed) {
+            if (vContracts.empty() && GRC::Contract::Detect(hashBoinc)) {
+                REF(vContracts).emplace_back(GRC::Contract::Parse(hashBoinc));
+            }
+
+            m_legacy_contracts_parsed = true;
         }
 
         return vContracts;
@@ -778,6 +950,8 @@ public:
     std::vector<GRC::Contract> PullContracts()
     {
         GetContracts(); // Populate vContracts for legacy transactions.
+        m_hash_cache.SetNull();
+        m_legacy_contracts_parsed = false;
 
         return std::move(vContracts);
     }
@@ -791,6 +965,39 @@ public:
 
 protected:
     const CTxOut& GetOutputFor(const CTxIn& input, const MapPrevTx& inputs) const;
+
+private:
+    mutable uint256 m_hash_cache;
+
+    //! Whether GetContracts() looked for a legacy contract in hashBoinc.
+    mutable bool m_legacy_contracts_parsed;
+};
+
+/** Closure representing one script verification.
+ *  Note that this stores references to the spending transaction.
+ */
+class CScriptCheck
+{
+private:
+    CScript scriptPubKey;
+    const CTransaction *ptxTo;
+    unsigned int nIn;
+    int nHashType;
+
+public:
+    CScriptCheck() : ptxTo(nullptr), nIn(0), nHashType(0) {}
+    CScriptCheck(const CTransaction& txFromIn, const CTransaction& txToIn, unsigned int nInIn, int nHashTypeIn) :
+        scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey),
+        ptxTo(&txToIn), nIn(nInIn), nHashType(nHashTypeIn) { }
+
+    bool operator()() const;
+
+    void swap(CScriptCheck &check) {
+        scriptPubKey.swap(check.scriptPubKey);
+        std::swap(ptxTo, check.ptxTo);
+        std::swap(nIn, check.nIn);
+        std::swap(nHashType, check.nHashType);
+    }
 };
 
 /** Check for standard transaction types
@@ -860,9 +1067,19 @@ public:
 
 
 
+/** Value of the version field that marks a CTxIndex record in the compact
+ * encoding. Records in the legacy encoding store the client version that wrote
+ * them in this field, which stays far below it.
+ */
+static const int TXINDEX_COMPACT_VERSION = 0x40000000;
+
 /**  A txdb record that contains the disk location of a transaction and the
  * locations of transactions that spend its outputs.  vSpent is really only
  * used as a flag, but having the location is very helpful for debugging.
+ *
+ * On disk, the record uses a compact encoding: varint positions, and a bitmap
+ * of the spent outputs followed by the positions of those outputs only. It
+ * still reads records in the legacy encoding of fixed-size positions.
  */
 class CTxIndex
 {
@@ -881,18 +1098,70 @@ public:
         vSpent.resize(nOutputs);
     }
 
-    ADD_SERIALIZE_METHODS;
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        if (s.GetType() & SER_GETHASH) {
+            s << pos << vSpent;
+            return;
+        }
 
-    template <typename Stream, typename Operation>
-    inline void SerializationOp(Stream& s, Operation ser_action)
+        const int nVersion = TXINDEX_COMPACT_VERSION;
+        s << nVersion;
+
+        SerializePos(s, pos);
+
+        std::vector<unsigned char> vSpentBits((vSpent.size() + 7) / 8, 0);
+
+        for (size_t i = 0; i < vSpent.size(); ++i) {
+            if (!vSpent[i].IsNull()) {
+                vSpentBits[i / 8] |= 1 << (i % 8);
+            }
+        }
+
+        WriteCompactSize(s, vSpent.size());
+
+        for (const auto& bits : vSpentBits) {
+            ser_writedata8(s, bits);
+        }
+
+        for (const auto& spent : vSpent) {
+            if (!spent.IsNull()) {
+                SerializePos(s, spent);
+            }
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
     {
-        if (!(s.GetType() & SER_GETHASH)) {
-            int nVersion = s.GetVersion();
-            READWRITE(nVersion);
+        if (s.GetType() & SER_GETHASH) {
+            s >> pos >> vSpent;
+            return;
+        }
+
+        int nVersion;
+        s >> nVersion;
+
+        if (nVersion != TXINDEX_COMPACT_VERSION) {
+            s >> pos >> vSpent;
+            return;
         }
 
-        READWRITE(pos);
-        READWRITE(vSpent);
+        UnserializePos(s, pos);
+
+        vSpent.assign(ReadCompactSize(s), CDiskTxPos());
+        std::vector<unsigned char> vSpentBits((vSpent.size() + 7) / 8);
+
+        for (auto& bits : vSpentBits) {
+            bits = ser_readdata8(s);
+        }
+
+        for (size_t i = 0; i < vSpent.size(); ++i) {
+            if (vSpentBits[i / 8] & (1 << (i % 8))) {
+                UnserializePos(s, vSpent[i]);
+            }
+        }
     }
 
     void SetNull()
@@ -918,6 +1187,69 @@ public:
     }
     int GetDepthInMainChain() const;
 
+    //! Find the block that contains the transaction. Reads the block header
+    //! from disk. Returns \c nullptr for a memory pool position.
+    CBlockIndex* GetBlockIndex() const;
+
+private:
+    //! Write a position in the compact encoding. The file number is offset by
+    //! one so that a null position takes a single byte, and the transaction
+    //! offset is relative to the block. The offset wraps around for positions
+    //! that precede their block, which still decodes exactly.
+    template <typename Stream>
+    static void SerializePos(Stream& s, const CDiskTxPos& pos)
+    {
+        unsigned int nFile = pos.nFile + 1;
+        s << VARINT(nFile);
+
+        if (pos.IsNull()) {
+            return;
+        }
+
+        unsigned int nBlockPos = pos.nBlockPos;
+        unsigned int nTxOffset = pos.nTxPos - pos.nBlockPos;
+        s << VARINT(nBlockPos) << VARINT(nTxOffset);
+    }
+
+    template <typename Stream>
+    static void UnserializePos(Stream& s, CDiskTxPos& pos)
+    {
+        unsigned int nFile;
+        s >> VARINT(nFile);
+
+        if (nFile == 0) {
+            pos.SetNull();
+            return;
+        }
+
+        unsigned int nTxOffset;
+        pos.nFile = nFile - 1;
+        s >> VARINT(pos.nBlockPos) >> VARINT(nTxOffset);
+        pos.nTxPos = pos.nBlockPos + nTxOffset;
+    }
+};
+
+
+/** Undo record written when a block is connected. It stores the index
+ * entries of the transactions that the block spends from as they were
+ * before the block connected, so that disconnecting the block restores
+ * them without reading each previous transaction index from disk.
+ *
+ * Entries of transactions created and spent within the same block are not
+ * stored because disconnecting the block erases them.
+ */
+class CBlockUndo
+{
+public:
+    std::vector<std::pair<uint256, CTxIndex>> vSpentTxIndex;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        READWRITE(vSpentTxIndex);
+    }
 };
 
 
@@ -1019,6 +1351,34 @@ public:
         return scrypt_blockhash(CVOIDBEGIN(nVersion));
     }
 
+    //!
+    //! \brief Fill the hash caches of a batch of headers for GetHash(true).
+    //!
+    //! Hashes the scrypt headers of early blocks several at a time. Only call
+    //! for headers that no other thread reads yet.
+    //!
+    static void CacheHashes(const std::vector<CBlockHeader*>& headers)
+    {
+        std::vector<CBlockHeader*> pow_headers;
+        std::vector<const void*> inputs;
+
+        for (const auto& header : headers) {
+            if (header->nVersion >= 7) {
+                header->m_hash_cache = SerializeHash(*header);
+            } else {
+                pow_headers.push_back(header);
+                inputs.push_back(CVOIDBEGIN(header->nVersion));
+            }
+        }
+
+        std::vector<uint256> hashes(inputs.size());
+        scrypt_blockhash_batch(inputs.data(), hashes.data(), inputs.size());
+
+        for (size_t i = 0; i < pow_headers.size(); ++i) {
+            pow_headers[i]->m_hash_cache = hashes[i];
+        }
+    }
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
@@ -1049,6 +1409,11 @@ public:
     // memory only
     mutable std::vector<uint256> vMerkleTree;
 
+    //! Message buffer that the block was read from by ReadFromBuffer().
+    std::shared_ptr<const CSerializeData> m_raw_data;
+    //! Number of bytes of the block at the start of m_raw_data.
+    size_t m_raw_size;
+
     // Denial-of-service detection:
     mutable int nDoS;
     bool DoS(int nDoSIn, bool fIn) const { nDoS += nDoSIn; return fIn; }
@@ -1079,6 +1444,10 @@ public:
             const_cast<CBlock*>(this)->vtx.clear();
             const_cast<CBlock*>(this)->vchBlockSig.clear();
         }
+
+        if (ser_action.ForRead()) {
+            const_cast<CBlock*>(this)->ReleaseRawData();
+        }
     }
 
     void SetNull()
@@ -1088,9 +1457,54 @@ public:
         vtx.clear();
         vchBlockSig.clear();
         vMerkleTree.clear();
+        ReleaseRawData();
         nDoS = 0;
     }
 
+    //!
+    //! \brief Deserialize the block from the start of a span of bytes.
+    //!
+    //! \param data     Serialized block, perhaps followed by other data.
+    //! \param nType    Serialization type of the data.
+    //! \param nVersion Serialization version of the data.
+    //!
+    //! \return The number of bytes that the block occupies.
+    //!
+    //! \throws std::ios_base::failure If the data ends before the block.
+    //!
+    size_t ReadFromSpan(Span<const unsigned char> data, int nType, int nVersion);
+
+    //!
+    //! \brief Deserialize the block from the start of a received message and
+    //! keep the message buffer.
+    //!
+    //! WriteToDisk() then stores the bytes of the message as they are instead
+    //! of serializing the block again. The network and the disk serialize the
+    //! block the same way.
+    //!
+    //! \param buffer   Message payload. The block shares ownership of it.
+    //! \param nType    Serialization type of the message.
+    //! \param nVersion Serialization version of the message.
+    //!
+    //! \return The bytes that follow the block in the message.
+    //!
+    //! \throws std::ios_base::failure If the message ends before the block.
+    //!
+    Span<const unsigned char> ReadFromBuffer(
+        std::shared_ptr<const CSerializeData> buffer,
+        int nType,
+        int nVersion);
+
+    //!
+    //! \brief Drop the message buffer kept by ReadFromBuffer(). Call it before
+    //! changing the block or to free the buffer of a block that stays around.
+    //!
+    void ReleaseRawData()
+    {
+        m_raw_data.reset();
+        m_raw_size = 0;
+    }
+
     CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
@@ -1143,24 +1557,13 @@ public:
         return maxTransactionTime;
     }
 
-    uint256 BuildMerkleTree() const
-    {
-        vMerkleTree.clear();
-        for (auto const& tx : vtx)
-            vMerkleTree.push_back(tx.GetHash());
-        int j = 0;
-        for (int nSize = vtx.size(); nSize > 1; nSize = (nSize + 1) / 2)
-        {
-            for (int i = 0; i < nSize; i += 2)
-            {
-                int i2 = std::min(i+1, nSize-1);
-                vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                           BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
-            }
-            j += nSize;
-        }
-        return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
-    }
+    //!
+    //! \brief Compute the merkle tree of the transactions and return its root.
+    //!
+    //! Hashes the pairs of each level with the batched SHA256D64() that runs
+    //! several hashes at once on the SIMD implementations of the CPU.
+    //!
+    uint256 BuildMerkleTree() const;
 
     std::vector<uint256> GetMerkleBranch(int nIndex) const
     {
@@ -1201,8 +1604,9 @@ public:
         if (fileout.IsNull())
             return error("CBlock::WriteToDisk() : AppendBlockFile failed");
 
-        // Write index header
-        unsigned int nSize = GetSerializeSize(fileout, *this);
+        // Write index header. A block read by ReadFromBuffer() stores the
+        // bytes of the message:
+        unsigned int nSize = m_raw_data ? m_raw_size : GetSerializeSize(fileout, *this);
         fileout << pchMessageStart << nSize;
 
         // Write block
@@ -1210,7 +1614,12 @@ public:
         if (fileOutPos < 0)
             return error("CBlock::WriteToDisk() : ftell failed");
         nBlockPosRet = fileOutPos;
-        fileout << *this;
+
+        if (m_raw_data) {
+            fileout.write(m_raw_data->data(), m_raw_size);
+        } else {
+            fileout << *this;
+        }
 
         // Flush stdio buffers and commit to disk before returning
         fflush(fileout.Get());
@@ -1226,14 +1635,17 @@ public:
 
         const int ser_flags = SER_DISK | (fReadTransactions ? 0 : SER_BLOCKHEADERONLY);
 
-        // Open history file to read
-        CAutoFile filein(OpenBlockFile(nFile, nBlockPos, "rb"), ser_flags, CLIENT_VERSION);
-        if (filein.IsNull())
-            return error("CBlock::ReadFromDisk() : OpenBlockFile failed");
-
         // Read block
         try {
-            filein >> *this;
+            if (!fMmapBlocks || !ReadBlockFromMappedFile(nFile, nBlockPos, ser_flags, *this))
+            {
+                // Open history file to read
+                CAutoFile filein(OpenBlockFile(nFile, nBlockPos, "rb"), ser_flags, CLIENT_VERSION);
+                if (filein.IsNull())
+                    return error("CBlock::ReadFromDisk() : OpenBlockFile failed");
+
+                filein >> *this;
+            }
         }
         catch (std::exception &e) {
             return error("%s() : deserialize or I/O error", __PRETTY_FUNCTION__);
@@ -1295,21 +1707,28 @@ private:
 class CBlockIndex
 {
 public:
+    // The fields are grouped by alignment so that the entry carries no
+    // padding. The node keeps millions of these in memory.
+
     const uint256* phashBlock;
     CBlockIndex* pprev;
     CBlockIndex* pnext;
-    unsigned int nFile;
-    unsigned int nBlockPos;
-    arith_uint256 nChainTrust; // ppcoin: trust score of block chain
-    int nHeight;
+    CBlockIndex* pskip; // pointer to an ancestor for efficient lookups
+    CBlockIndex* pmodifier; // block that generated the stake modifier in effect; in-memory only
 
     int64_t nMint;
     int64_t nMoneySupply;
     // Gridcoin (7-11-2015) Add new Accrual Fields to block index
-    GRC::Cpid cpid;
     int64_t nResearchSubsidy;
     int64_t nInterestSubsidy;
     double nMagnitude;
+    uint64_t nStakeModifier; // hash modifier for proof-of-stake
+
+    arith_uint256 nChainTrust; // ppcoin: trust score of block chain
+    GRC::Cpid cpid;
+    unsigned int nFile;
+    unsigned int nBlockPos;
+    int nHeight;
     // Indicators (9-13-2015)
     unsigned int nIsSuperBlock;
     unsigned int nIsContract;
@@ -1324,7 +1743,6 @@ public:
         INVESTOR_CPID        = (1 << 4), // CPID equals "INVESTOR"
     };
 
-    uint64_t nStakeModifier; // hash modifier for proof-of-stake
     unsigned int nStakeModifierChecksum; // checksum of index; in-memory only
 
     // proof-of-stake specific fields
@@ -1375,6 +1793,8 @@ public:
         phashBlock = NULL;
         pprev = NULL;
         pnext = NULL;
+        pskip = NULL;
+        pmodifier = NULL;
         nFile = 0;
         nBlockPos = 0;
         nHeight = 0;
@@ -1401,6 +1821,12 @@ public:
         nIsContract = 0;
     }
 
+    //! \brief Whether -prune deleted the block data from the block files.
+    bool IsPruned() const
+    {
+        return nFile == 0;
+    }
+
     CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
@@ -1426,6 +1852,15 @@ public:
 
     arith_uint256 GetBlockTrust() const;
 
+    // Build the skiplist pointer for this entry. pprev and the skiplist
+    // pointers of the ancestors must be set.
+    void BuildSkip();
+
+    // Efficiently find an ancestor of this block. Returns NULL when the
+    // height is out of range.
+    CBlockIndex* GetAncestor(int height);
+    const CBlockIndex* GetAncestor(int height) const;
+
     bool IsInMainChain() const
     {
         return (pnext || this == pindexBest);
@@ -1497,6 +1932,14 @@ public:
             nFlags |= BLOCK_STAKE_MODIFIER;
     }
 
+    // Point pmodifier at the block that generated the stake modifier in
+    // effect at this block. Requires the stake modifier flag of this block
+    // and pmodifier of the previous block.
+    void BuildStakeModifierLink()
+    {
+        pmodifier = GeneratedStakeModifier() ? this : (pprev ? pprev->pmodifier : NULL);
+    }
+
     void SetMiningId(GRC::MiningId mining_id)
     {
         nFlags &= ~(EMPTY_CPID | INVESTOR_CPID);
@@ -1824,20 +2267,90 @@ public:
 
 
 
+//!
+//! \brief Data about a memory pool transaction recorded when the pool accepts
+//! it so that block assembly need not read each input from disk again.
+//!
+class CTxMemPoolEntry
+{
+public:
+    int64_t nFee;         //!< Value of the inputs minus the value of the outputs.
+    unsigned int nTxSize; //!< Serialized size of the transaction.
+    int64_t nTime;        //!< Time that the pool accepted the transaction.
+    size_t nUsage;        //!< Estimated memory used by the transaction.
+
+    //! Whether vChainInputs and setParents describe every input. When false,
+    //! block assembly reads the inputs from disk.
+    bool fHaveInputs;
+
+    //! Block that confirms each input spent from the chain with its value.
+    std::vector<std::pair<const CBlockIndex*, int64_t>> vChainInputs;
+
+    //! Memory pool transactions that the transaction spends outputs of. The
+    //! pool's mapNextTx links the other way, from parents to children.
+    std::set<uint256> setParents;
+
+    CTxMemPoolEntry() : nFee(0), nTxSize(0), nTime(0), nUsage(0), fHaveInputs(false) { }
+
+    //! Get the fee paid per 1000 bytes of the transaction.
+    double GetFeeRate() const { return nTxSize ? nFee * 1000.0 / nTxSize : 0; }
+};
+
+//! Usage figures of the memory pool.
+struct CTxMemPoolStats
+{
+    size_t nTx;          //!< Number of transactions held.
+    uint64_t nTxBytes;   //!< Serialized size of the transactions held.
+    size_t nUsage;       //!< Estimated memory used by the transactions held.
+    size_t nMaxUsage;    //!< Limit of nUsage.
+    int64_t nExpiry;     //!< Seconds that a transaction may wait in the pool.
+    double dMinFeeRate;  //!< Lowest fee per 1000 bytes of a transaction held.
+    uint64_t nExpired;   //!< Transactions removed because of their age.
+    uint64_t nEvicted;   //!< Transactions removed to stay under the limit.
+};
+
 class CTxMemPool
 {
 public:
     mutable CCriticalSection cs;
-    std::map<uint256, CTransaction> mapTx;
-    std::map<COutPoint, CInPoint> mapNextTx;
+    std::unordered_map<uint256, CTransaction, SaltedUint256Hasher> mapTx;
+    std::unordered_map<COutPoint, CInPoint, SaltedOutPointHasher> mapNextTx;
+    std::unordered_map<uint256, CTxMemPoolEntry, SaltedUint256Hasher> mapEntries;
+
+    // Incremented whenever a transaction enters or leaves the pool.
+    unsigned int nTransactionsUpdated;
+
+    CTxMemPool();
 
     bool addUnchecked(const uint256& hash, CTransaction &tx);
+    bool addUnchecked(const uint256& hash, CTransaction &tx, CTxMemPoolEntry entry);
     bool remove(const CTransaction &tx, bool fRecursive = false);
     bool removeConflicts(const CTransaction &tx);
     void clear();
     void queryHashes(std::vector<uint256>& vtxid);
     void DiscardVersion1();
 
+    //! Change the memory limit and the expiry age. Takes effect on the next
+    //! call to Limit().
+    void SetLimits(size_t nMaxUsageIn, int64_t nExpiryIn);
+
+    //!
+    //! \brief Remove transactions that waited longer than the expiry age and
+    //! then evict the transactions with the lowest fee rates, along with the
+    //! transactions that spend them, until the pool fits its memory limit.
+    //!
+    //! \param nNow Current time in seconds.
+    //!
+    //! \return Number of transactions removed.
+    //!
+    unsigned int Limit(int64_t nNow);
+
+    //! Get the usage figures of the pool.
+    CTxMemPoolStats GetStats() const;
+
+    //! Estimate the memory used by a transaction in the pool.
+    static size_t EstimateUsage(const CTransaction& tx, const CTxMemPoolEntry& entry);
+
     unsigned long size() const
     {
         LOCK(cs);
@@ -1850,14 +2363,39 @@ public:
         return (mapTx.count(hash) != 0);
     }
 
+    unsigned int GetTransactionsUpdated() const
+    {
+        LOCK(cs);
+        return nTransactionsUpdated;
+    }
+
+    //! Get the admission data of a transaction. Requires cs.
+    //! \return \c nullptr when the pool holds no data for the transaction.
+    const CTxMemPoolEntry* GetEntry(const uint256& hash) const
+    {
+        AssertLockHeld(cs);
+        const auto iter = mapEntries.find(hash);
+        return iter == mapEntries.end() ? nullptr : &iter->second;
+    }
+
     bool lookup(uint256 hash, CTransaction& result) const
     {
         LOCK(cs);
-        std::map<uint256, CTransaction>::const_iterator i = mapTx.find(hash);
+        const auto i = mapTx.find(hash);
         if (i == mapTx.end()) return false;
         result = i->second;
         return true;
     }
+
+private:
+    std::set<std::pair<double, uint256>> setByFeeRate; //!< Eviction order.
+    std::set<std::pair<int64_t, uint256>> setByTime;   //!< Expiry order.
+    uint64_t nTotalTxBytes;                            //!< Sum of nTxSize.
+    size_t nTotalUsage;                                //!< Sum of nUsage.
+    size_t nMaxUsage;                                  //!< Limit of nTotalUsage.
+    int64_t nExpiry;                                   //!< Seconds before expiry.
+    uint64_t nExpired;                                 //!< Transactions expired.
+    uint64_t nEvicted;                                 //!< Transactions evicted.
 };
 
 extern CTxMemPool mempool;
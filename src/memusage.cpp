@@ -0,0 +1,313 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "init.h"
+#include "main.h"
+#include "memusage.h"
+#include "orphanblocks.h"
+#include "script.h"
+#include "txdb.h"
+#include "gridcoin/appcache.h"
+#include "gridcoin/beacon.h"
+#include "gridcoin/scraper/scraper_net.h"
+#include "gridcoin/superblock.h"
+#include "gridcoin/tally.h"
+#include "gridcoin/voting/registry.h"
+#include "wallet/wallet.h"
+
+#include <fstream>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
+extern std::map<uint256, CTransaction> mapOrphanTransactions;
+extern std::map<uint256, std::set<uint256>> mapOrphanTransactionsByPrev;
+extern CCriticalSection cs_ConvergedScraperStatsCache;
+extern ConvergedScraperStats ConvergedScraperStatsCache;
+
+namespace {
+size_t ManifestUsage(const CScraperManifest& manifest)
+{
+    size_t usage = memusage::MallocUsage(sizeof(CScraperManifest))
+        + memusage::MallocUsage(sizeof(memusage::stl_shared_counter))
+        + memusage::DynamicUsage(manifest.sCManifestName)
+        + memusage::DynamicUsage(manifest.signature)
+        + memusage::DynamicUsage(manifest.projects)
+        + memusage::DynamicUsage(manifest.vParts);
+
+    for (const auto& entry : manifest.projects) {
+        usage += memusage::DynamicUsage(entry.project) + memusage::DynamicUsage(entry.ETag);
+    }
+
+    return usage;
+}
+
+size_t ConvergedManifestUsage(const ConvergedManifest& convergence)
+{
+    // The converged parts belong to the manifests, so only the references to
+    // them count here:
+    size_t usage = memusage::DynamicUsage(convergence.ConvergedManifestPartPtrsMap)
+        + memusage::DynamicUsage(convergence.mIncludedScraperManifests)
+        + memusage::DynamicUsage(convergence.vIncludedScrapers)
+        + memusage::DynamicUsage(convergence.vExcludedScrapers)
+        + memusage::DynamicUsage(convergence.vScrapersNotPublishing)
+        + memusage::DynamicUsage(convergence.mIncludedScrapersbyProject)
+        + memusage::DynamicUsage(convergence.mIncludedProjectsbyScraper)
+        + memusage::DynamicUsage(convergence.mScraperConvergenceCountbyProject)
+        + memusage::DynamicUsage(convergence.vExcludedProjects);
+
+    for (const auto& part_pair : convergence.ConvergedManifestPartPtrsMap) {
+        usage += memusage::DynamicUsage(part_pair.first);
+    }
+
+    for (const auto& scraper_pair : convergence.mIncludedScraperManifests) {
+        usage += memusage::DynamicUsage(scraper_pair.first);
+    }
+
+    for (const auto& scraper_pair : convergence.mIncludedScrapersbyProject) {
+        usage += memusage::DynamicUsage(scraper_pair.first) + memusage::DynamicUsage(scraper_pair.second);
+    }
+
+    for (const auto& scraper_pair : convergence.mIncludedProjectsbyScraper) {
+        usage += memusage::DynamicUsage(scraper_pair.first) + memusage::DynamicUsage(scraper_pair.second);
+    }
+
+    return usage;
+}
+
+MemoryUsageEntry BlockIndexUsage()
+{
+    LOCK(cs_main);
+
+    // The block index arena allocates the entries in slabs, so they have no
+    // allocator overhead. The stake set holds an entry for each block:
+    return {
+        "block_index",
+        mapBlockIndex.size(),
+        memusage::DynamicUsage(mapBlockIndex)
+            + mapBlockIndex.size() * sizeof(CBlockIndex)
+            + memusage::DynamicUsage(setStakeSeen),
+    };
+}
+
+MemoryUsageEntry MemPoolUsage()
+{
+    const CTxMemPoolStats stats = mempool.GetStats();
+
+    return { "mempool", stats.nTx, stats.nUsage };
+}
+
+MemoryUsageEntry OrphanBlockUsage()
+{
+    LOCK(cs_main);
+
+    // The serialized size approximates the transactions and the signatures
+    // that the blocks allocate:
+    const OrphanBlockStats stats = g_orphan_blocks.GetStats();
+
+    return { "orphan_blocks", stats.nBlocks, stats.nBytes };
+}
+
+MemoryUsageEntry OrphanTransactionUsage()
+{
+    LOCK(cs_main);
+
+    size_t usage = memusage::DynamicUsage(mapOrphanTransactions)
+        + memusage::DynamicUsage(mapOrphanTransactionsByPrev);
+
+    for (const auto& tx_pair : mapOrphanTransactions) {
+        usage += GetSerializeSize(tx_pair.second, SER_NETWORK, PROTOCOL_VERSION);
+    }
+
+    for (const auto& prev_pair : mapOrphanTransactionsByPrev) {
+        usage += memusage::DynamicUsage(prev_pair.second);
+    }
+
+    return { "orphan_transactions", mapOrphanTransactions.size(), usage };
+}
+
+MemoryUsageEntry ScraperPartUsage()
+{
+    LOCK(CSplitBlob::cs_mapParts);
+
+    size_t usage = memusage::DynamicUsage(CSplitBlob::mapParts);
+
+    for (const auto& part_pair : CSplitBlob::mapParts) {
+        usage += memusage::MallocUsage(part_pair.second.data.capacity())
+            + memusage::DynamicUsage(part_pair.second.refs);
+    }
+
+    return { "scraper_parts", CSplitBlob::mapParts.size(), usage };
+}
+
+MemoryUsageEntry ScraperManifestUsage()
+{
+    LOCK(CScraperManifest::cs_mapManifest);
+
+    size_t usage = memusage::DynamicUsage(CScraperManifest::mapManifest)
+        + memusage::DynamicUsage(CScraperManifest::mapPendingDeletedManifest)
+        + memusage::DynamicUsage(CScraperManifest::mapManifestByScraper)
+        + memusage::DynamicUsage(CScraperManifest::mapManifestByTime)
+        + memusage::DynamicUsage(CScraperManifest::mapProjectPartsByHash);
+
+    for (const auto& manifest_pair : CScraperManifest::mapManifest) {
+        usage += ManifestUsage(*manifest_pair.second);
+    }
+
+    for (const auto& manifest_pair : CScraperManifest::mapPendingDeletedManifest) {
+        usage += ManifestUsage(*manifest_pair.second.second);
+    }
+
+    for (const auto& scraper_pair : CScraperManifest::mapManifestByScraper) {
+        usage += memusage::DynamicUsage(scraper_pair.first) + memusage::DynamicUsage(scraper_pair.second);
+    }
+
+    return {
+        "scraper_manifests",
+        CScraperManifest::mapManifest.size() + CScraperManifest::mapPendingDeletedManifest.size(),
+        usage,
+    };
+}
+
+MemoryUsageEntry ScraperConvergenceUsage()
+{
+    LOCK(cs_ConvergedScraperStatsCache);
+
+    const ConvergedScraperStats& cache = ConvergedScraperStatsCache;
+
+    size_t usage = memusage::MallocUsage(cache.mScraperConvergedStats.size() * sizeof(ScraperStats::value_type))
+        + ConvergedManifestUsage(cache.Convergence)
+        + memusage::DynamicUsage(cache.PastConvergences)
+        + memusage::DynamicUsage(cache.PastConvergencesBySuperblock)
+        + GetSerializeSize(cache.NewFormatSuperblock, SER_NETWORK, PROTOCOL_VERSION);
+
+    for (const auto& entry : cache.mScraperConvergedStats) {
+        usage += memusage::DynamicUsage(entry.first.objectID)
+            + memusage::DynamicUsage(entry.second.statskey.objectID);
+    }
+
+    for (const auto& past_pair : cache.PastConvergences) {
+        usage += ConvergedManifestUsage(past_pair.second.second);
+    }
+
+    return { "scraper_convergence", cache.mScraperConvergedStats.size(), usage };
+}
+
+MemoryUsageEntry BeaconRegistryUsage()
+{
+    LOCK(cs_main);
+
+    const GRC::BeaconRegistry& beacons = GRC::GetBeaconRegistry();
+
+    return {
+        "beacons",
+        beacons.Beacons().size() + beacons.PendingBeacons().size(),
+        beacons.DynamicMemoryUsage(),
+    };
+}
+
+MemoryUsageEntry PollRegistryUsage()
+{
+    LOCK(cs_main);
+
+    const GRC::PollRegistry& polls = GRC::GetPollRegistry();
+    const GRC::PollRegistry::Sequence sequence = polls.Polls();
+    uint64_t count = 0;
+
+    for (auto iter = sequence.begin(); iter != sequence.end(); ++iter) {
+        ++count;
+    }
+
+    return { "polls", count, polls.DynamicMemoryUsage() };
+}
+
+MemoryUsageEntry AppCacheUsage()
+{
+    LOCK(cs_main);
+
+    return {
+        "appcache",
+        ReadCacheSection(Section::PROTOCOL).size() + ReadCacheSection(Section::SCRAPER).size(),
+        AppCacheDynamicUsage(),
+    };
+}
+
+MemoryUsageEntry TallyUsage()
+{
+    LOCK(cs_main);
+
+    return { "tally", GRC::Tally::Accounts().size(), GRC::Tally::DynamicMemoryUsage() };
+}
+
+MemoryUsageEntry WalletUsage()
+{
+    if (!pwalletMain) {
+        return { "wallet", 0, 0 };
+    }
+
+    LOCK(pwalletMain->cs_wallet);
+
+    // The serialized size approximates the scripts, the previous transactions
+    // and the metadata strings of each wallet transaction:
+    size_t usage = memusage::DynamicUsage(pwalletMain->mapWallet);
+
+    for (const auto& tx_pair : pwalletMain->mapWallet) {
+        usage += GetSerializeSize(tx_pair.second, SER_DISK, CLIENT_VERSION);
+    }
+
+    return { "wallet", pwalletMain->mapWallet.size(), usage };
+}
+
+MemoryUsageEntry SignatureCacheUsage()
+{
+    // The cache reserves its full size at startup:
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+
+    return { "signature_cache", stats.nEntries, stats.nMaxBytes };
+}
+
+MemoryUsageEntry LevelDBUsage()
+{
+    CTxDB txdb("r");
+
+    return { "leveldb", 0, txdb.GetMemoryUsage() };
+}
+} // anonymous namespace
+
+std::vector<MemoryUsageEntry> GetMemoryUsage()
+{
+    return {
+        BlockIndexUsage(),
+        MemPoolUsage(),
+        OrphanBlockUsage(),
+        OrphanTransactionUsage(),
+        ScraperPartUsage(),
+        ScraperManifestUsage(),
+        ScraperConvergenceUsage(),
+        BeaconRegistryUsage(),
+        PollRegistryUsage(),
+        AppCacheUsage(),
+        TallyUsage(),
+        WalletUsage(),
+        SignatureCacheUsage(),
+        LevelDBUsage(),
+    };
+}
+
+uint64_t GetResidentMemory()
+{
+#if defined(__linux__)
+    // The second field of statm counts the resident pages:
+    std::ifstream statm("/proc/self/statm");
+    uint64_t pages = 0;
+    uint64_t resident = 0;
+
+    if (statm >> pages >> resident) {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+#endif
+
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Copyright (c) 2015-2017 The Bitcoin Core developers
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_MEMUSAGE_H
+#define BITCOIN_MEMUSAGE_H
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//!
+//! \brief Estimates of the heap memory held by the standard containers.
+//!
+//! The estimates count the allocations of the containers themselves. Values
+//! that own further allocations need those added by the caller.
+//!
+namespace memusage {
+//!
+//! \brief Estimate the memory that malloc() uses for an allocation, with its
+//! chunk header and rounding on glibc.
+//!
+static inline size_t MallocUsage(size_t alloc)
+{
+    if (alloc == 0) {
+        return 0;
+    } else if (sizeof(void*) == 8) {
+        return ((alloc + 31) >> 4) << 4;
+    } else if (sizeof(void*) == 4) {
+        return ((alloc + 15) >> 3) << 3;
+    }
+
+    return alloc;
+}
+
+//! Node of a std::map or std::set.
+template <typename X>
+struct stl_tree_node
+{
+private:
+    int color;
+    void* parent;
+    void* left;
+    void* right;
+    X x;
+};
+
+//! Node of a std::unordered_map or std::unordered_set.
+template <typename X>
+struct unordered_node : private X
+{
+private:
+    void* ptr;
+};
+
+//! Control block of a std::shared_ptr allocated with std::make_shared().
+struct stl_shared_counter
+{
+    void* vtable;
+    int use_count;
+    int weak_count;
+};
+
+static inline size_t DynamicUsage(const std::string& s)
+{
+    // Short strings fit in place:
+    return s.capacity() > 15 ? MallocUsage(s.capacity() + 1) : 0;
+}
+
+template <typename X>
+static inline size_t DynamicUsage(const std::vector<X>& v)
+{
+    return MallocUsage(v.capacity() * sizeof(X));
+}
+
+template <typename X, typename Y>
+static inline size_t DynamicUsage(const std::set<X, Y>& s)
+{
+    return MallocUsage(sizeof(stl_tree_node<X>)) * s.size();
+}
+
+template <typename X, typename Y>
+static inline size_t DynamicUsage(const std::multiset<X, Y>& s)
+{
+    return MallocUsage(sizeof(stl_tree_node<X>)) * s.size();
+}
+
+template <typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const std::map<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y>>)) * m.size();
+}
+
+template <typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const std::multimap<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(stl_tree_node<std::pair<const X, Y>>)) * m.size();
+}
+
+template <typename X, typename Y>
+static inline size_t DynamicUsage(const std::unordered_set<X, Y>& s)
+{
+    return MallocUsage(sizeof(unordered_node<X>)) * s.size()
+        + MallocUsage(sizeof(void*) * s.bucket_count());
+}
+
+template <typename X, typename Y, typename Z>
+static inline size_t DynamicUsage(const std::unordered_map<X, Y, Z>& m)
+{
+    return MallocUsage(sizeof(unordered_node<std::pair<const X, Y>>)) * m.size()
+        + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
+template <typename X>
+static inline size_t DynamicUsage(const std::shared_ptr<X>& p)
+{
+    // A shared object counts once for each owner, which overstates objects
+    // that several containers share:
+    return p ? MallocUsage(sizeof(X)) + MallocUsage(sizeof(stl_shared_counter)) : 0;
+}
+} // namespace memusage
+
+//!
+//! \brief Estimated memory use of one subsystem of the node.
+//!
+struct MemoryUsageEntry
+{
+    std::string name;   //!< Identifies the subsystem in RPC and GUI output.
+    uint64_t entries;   //!< Number of items held by the subsystem.
+    uint64_t bytes;     //!< Estimated heap memory that the items use.
+};
+
+//!
+//! \brief Estimate the memory used by the major in-memory structures.
+//!
+//! Takes the locks of each structure in turn, including \c cs_main, so the
+//! figures describe slightly different moments. Callers must not hold the
+//! locks of the wallet or the scraper.
+//!
+//! \return An entry for each subsystem in a fixed order.
+//!
+std::vector<MemoryUsageEntry> GetMemoryUsage();
+
+//!
+//! \brief Get the resident set size of the process.
+//!
+//! \return Size in bytes, or zero when the platform does not report it.
+//!
+uint64_t GetResidentMemory();
+
+#endif // BITCOIN_MEMUSAGE_H
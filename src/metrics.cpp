@@ -0,0 +1,443 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "metrics.h"
+#include "net.h"
+#include "rpcprotocol.h"
+#include "gridcoin/staking/status.h"
+#include "gridcoin/superblock.h"
+#include "util.h"
+#include "util/perf.h"
+
+#include <boost/asio.hpp>
+#include <cmath>
+#include <memory>
+#include <thread>
+
+namespace asio = boost::asio;
+
+extern CCriticalSection cs_ConvergedScraperStatsCache;
+extern ConvergedScraperStats ConvergedScraperStatsCache;
+
+namespace {
+//! Largest request header that the server reads.
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+
+//! Seconds that a client may take to send its request.
+constexpr long REQUEST_TIMEOUT = 10;
+
+//!
+//! \brief Writes metric families in the Prometheus text exposition format.
+//!
+class MetricsWriter
+{
+public:
+    void Family(const std::string& name, const char* type, const char* help)
+    {
+        m_out += "# HELP " + name + " " + help + "\n";
+        m_out += "# TYPE " + name + " " + type + "\n";
+    }
+
+    void Sample(const std::string& name, const std::string& labels, double value)
+    {
+        m_out += name;
+
+        if (!labels.empty()) {
+            m_out += "{" + labels + "}";
+        }
+
+        // Print counts exactly and durations without binary noise:
+        if (value == std::floor(value) && std::fabs(value) < 1e15) {
+            m_out += strprintf(" %.0f\n", value);
+        } else {
+            m_out += strprintf(" %.9g\n", value);
+        }
+    }
+
+    void Sample(const std::string& name, double value)
+    {
+        Sample(name, "", value);
+    }
+
+    void Gauge(const std::string& name, const char* help, double value)
+    {
+        Family(name, "gauge", help);
+        Sample(name, value);
+    }
+
+    void Counter(const std::string& name, const char* help, double value)
+    {
+        Family(name, "counter", help);
+        Sample(name, value);
+    }
+
+    std::string& Output()
+    {
+        return m_out;
+    }
+
+private:
+    std::string m_out;
+};
+
+std::string Label(const std::string& key, const std::string& value)
+{
+    std::string escaped;
+    escaped.reserve(value.size());
+
+    for (const char c : value) {
+        switch (c) {
+            case '\\': escaped += "\\\\"; break;
+            case '"':  escaped += "\\\""; break;
+            case '\n': escaped += "\\n";  break;
+            default:   escaped += c;
+        }
+    }
+
+    return key + "=\"" + escaped + "\"";
+}
+
+void WriteChainMetrics(MetricsWriter& out)
+{
+    const std::shared_ptr<const ChainTipView> view = GetChainTipView();
+
+    if (!view) {
+        return;
+    }
+
+    out.Gauge("gridcoin_block_height", "Height of the chain tip.", view->nHeight);
+    out.Gauge("gridcoin_block_time_seconds", "Timestamp of the chain tip.", view->nTime);
+    out.Gauge("gridcoin_difficulty", "Difficulty of the last proof-of-stake block.", view->dDifficulty);
+    out.Gauge("gridcoin_money_supply_coins", "Money supply at the chain tip.", view->nMoneySupply / (double)COIN);
+}
+
+void WriteMempoolMetrics(MetricsWriter& out)
+{
+    const CTxMemPoolStats stats = mempool.GetStats();
+
+    out.Gauge("gridcoin_mempool_transactions", "Transactions in the memory pool.", stats.nTx);
+    out.Gauge("gridcoin_mempool_bytes", "Serialized size of the transactions in the memory pool.", stats.nTxBytes);
+    out.Gauge("gridcoin_mempool_usage_bytes", "Estimated memory used by the memory pool.", stats.nUsage);
+    out.Counter("gridcoin_mempool_expired_total", "Transactions removed from the memory pool because of their age.", stats.nExpired);
+    out.Counter("gridcoin_mempool_evicted_total", "Transactions removed to keep the memory pool under its limit.", stats.nEvicted);
+}
+
+void WriteNetworkMetrics(MetricsWriter& out)
+{
+    size_t nInbound = 0;
+    size_t nOutbound = 0;
+
+    {
+        LOCK(cs_vNodes);
+
+        for (const auto& pnode : vNodes) {
+            ++(pnode->fInbound ? nInbound : nOutbound);
+        }
+    }
+
+    out.Family("gridcoin_peers", "gauge", "Connected peers.");
+    out.Sample("gridcoin_peers", Label("direction", "inbound"), nInbound);
+    out.Sample("gridcoin_peers", Label("direction", "outbound"), nOutbound);
+
+    out.Family("gridcoin_network_bytes_total", "counter", "Bytes transferred with all peers.");
+    out.Sample("gridcoin_network_bytes_total", Label("direction", "recv"), CNode::GetTotalBytesRecv());
+    out.Sample("gridcoin_network_bytes_total", Label("direction", "sent"), CNode::GetTotalBytesSent());
+
+    const MessageStatsMap stats = CNode::GetTotalMessageStats();
+
+    out.Family("gridcoin_message_bytes_total", "counter", "Bytes of messages by command including headers.");
+
+    for (const auto& entry : stats) {
+        const std::string command = Label("command", entry.first);
+
+        out.Sample("gridcoin_message_bytes_total", command + "," + Label("direction", "recv"), entry.second.nBytesRecv);
+        out.Sample("gridcoin_message_bytes_total", command + "," + Label("direction", "sent"), entry.second.nBytesSent);
+    }
+
+    out.Family("gridcoin_messages_total", "counter", "Messages by command.");
+
+    for (const auto& entry : stats) {
+        const std::string command = Label("command", entry.first);
+
+        out.Sample("gridcoin_messages_total", command + "," + Label("direction", "recv"), entry.second.nMsgsRecv);
+        out.Sample("gridcoin_messages_total", command + "," + Label("direction", "sent"), entry.second.nMsgsSent);
+    }
+}
+
+void WriteStakingMetrics(MetricsWriter& out)
+{
+    uint64_t nRounds;
+    uint64_t nKernelHashes;
+    int64_t nTotalRoundUsec;
+    uint64_t nKernelsFound;
+    uint64_t nCreated;
+    uint64_t nAccepted;
+    uint64_t nWeight;
+    bool fAbleToStake;
+
+    {
+        LOCK(g_miner_status.lock);
+
+        nRounds = g_miner_status.m_rounds;
+        nKernelHashes = g_miner_status.m_kernel_hashes;
+        nTotalRoundUsec = g_miner_status.m_total_round_usec;
+        nKernelsFound = g_miner_status.KernelsFound;
+        nCreated = g_miner_status.CreatedCnt;
+        nAccepted = g_miner_status.AcceptedCnt;
+        nWeight = g_miner_status.WeightSum;
+        fAbleToStake = g_miner_status.able_to_stake;
+    }
+
+    out.Gauge("gridcoin_staking_able", "Whether the wallet is able to stake.", fAbleToStake);
+    out.Gauge("gridcoin_staking_weight", "Combined weight of the coins that the wallet stakes.", nWeight);
+    out.Counter("gridcoin_staking_attempts_total", "Stake kernel searches.", nRounds);
+    out.Counter("gridcoin_staking_search_seconds_total", "Time spent on stake kernel searches.", nTotalRoundUsec / 1e6);
+    out.Counter("gridcoin_staking_kernel_hashes_total", "Stake kernels hashed. The rate gives the kernel hashes per second.", nKernelHashes);
+    out.Counter("gridcoin_staking_kernels_found_total", "Stake kernels that met the target.", nKernelsFound);
+    out.Counter("gridcoin_staking_blocks_created_total", "Blocks created by the staking loop.", nCreated);
+    out.Counter("gridcoin_staking_blocks_accepted_total", "Staked blocks accepted by the node.", nAccepted);
+}
+
+void WriteScraperMetrics(MetricsWriter& out)
+{
+    int64_t nTimestamp;
+    bool fByParts;
+    size_t nIncludedScrapers;
+    size_t nExcludedProjects;
+
+    {
+        LOCK(cs_ConvergedScraperStatsCache);
+
+        const ConvergedManifest& convergence = ConvergedScraperStatsCache.Convergence;
+
+        nTimestamp = convergence.timestamp;
+        fByParts = convergence.bByParts;
+        nIncludedScrapers = convergence.vIncludedScrapers.size();
+        nExcludedProjects = convergence.vExcludedProjects.size();
+    }
+
+    out.Gauge("gridcoin_scraper_convergence_timestamp_seconds", "Time of the cached scraper convergence or 0 for none.", nTimestamp);
+    out.Gauge("gridcoin_scraper_convergence_by_parts", "Whether the cached convergence formed by project.", fByParts);
+    out.Gauge("gridcoin_scraper_convergence_scrapers", "Scrapers included in the cached convergence.", nIncludedScrapers);
+    out.Gauge("gridcoin_scraper_convergence_excluded_projects", "Projects missing from the cached convergence.", nExcludedProjects);
+}
+
+void WritePerfMetrics(MetricsWriter& out)
+{
+    const std::string name = "gridcoin_duration_seconds";
+
+    out.Family(name, "histogram",
+        "Durations of the instrumented code paths, including lock contention. Recorded with -perfstats.");
+
+    for (const auto& snapshot : util::GetPerfSnapshots()) {
+        const std::string path = Label("path", snapshot.name);
+        uint64_t cumulative = 0;
+
+        for (size_t i = 0; i + 1 < snapshot.histogram.size(); ++i) {
+            cumulative += snapshot.histogram[i];
+
+            const double bound = (uint64_t(2) << i) / 1e6;
+
+            out.Sample(name + "_bucket", path + "," + Label("le", strprintf("%.9g", bound)), cumulative);
+        }
+
+        out.Sample(name + "_bucket", path + "," + Label("le", "+Inf"), snapshot.count);
+        out.Sample(name + "_sum", path, snapshot.total_us / 1e6);
+        out.Sample(name + "_count", path, snapshot.count);
+    }
+}
+
+//!
+//! \brief Answers one HTTP request on a metrics connection and closes it.
+//!
+class MetricsSession : public std::enable_shared_from_this<MetricsSession>
+{
+public:
+    explicit MetricsSession(ioContext& io_context)
+        : m_socket(io_context)
+        , m_timer(io_context)
+        , m_buffer(MAX_REQUEST_SIZE)
+    {
+    }
+
+    asio::ip::tcp::socket& Socket()
+    {
+        return m_socket;
+    }
+
+    void Start()
+    {
+        auto self = shared_from_this();
+
+        m_timer.expires_from_now(boost::posix_time::seconds(REQUEST_TIMEOUT));
+        m_timer.async_wait([self](const boost::system::error_code& error) {
+            if (!error) {
+                boost::system::error_code ignored;
+                self->m_socket.close(ignored);
+            }
+        });
+
+        asio::async_read_until(m_socket, m_buffer, "\r\n\r\n", [self](const boost::system::error_code& error, size_t) {
+            self->Reply(error);
+        });
+    }
+
+private:
+    asio::ip::tcp::socket m_socket;
+    asio::deadline_timer m_timer;
+    boost::asio::streambuf m_buffer;
+    std::string m_reply;
+
+    void Reply(const boost::system::error_code& error)
+    {
+        boost::system::error_code ignored;
+        m_timer.cancel(ignored);
+
+        if (error) {
+            m_socket.close(ignored);
+            return;
+        }
+
+        std::istream stream(&m_buffer);
+        std::string method;
+        std::string path;
+        stream >> method >> path;
+
+        const char* status = "200 OK";
+        std::string body;
+
+        if (method != "GET") {
+            status = "405 Method Not Allowed";
+        } else if (path != "/metrics") {
+            status = "404 Not Found";
+        } else {
+            body = FormatMetrics();
+        }
+
+        m_reply = strprintf(
+            "HTTP/1.1 %s\r\n"
+            "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+            "Content-Length: %" PRIszu "\r\n"
+            "Connection: close\r\n"
+            "\r\n",
+            status,
+            body.size());
+        m_reply += body;
+
+        auto self = shared_from_this();
+
+        asio::async_write(m_socket, asio::buffer(m_reply), [self](const boost::system::error_code&, size_t) {
+            boost::system::error_code ignored;
+            self->m_socket.shutdown(asio::ip::tcp::socket::shutdown_both, ignored);
+            self->m_socket.close(ignored);
+        });
+    }
+};
+
+ioContext* metrics_io_context = nullptr;
+std::unique_ptr<asio::ip::tcp::acceptor> metrics_acceptor;
+std::thread metrics_thread;
+
+void Accept()
+{
+    auto session = std::make_shared<MetricsSession>(*metrics_io_context);
+
+    metrics_acceptor->async_accept(session->Socket(), [session](const boost::system::error_code& error) {
+        if (error == asio::error::operation_aborted || !metrics_acceptor->is_open()) {
+            return;
+        }
+
+        if (!error) {
+            session->Start();
+        }
+
+        Accept();
+    });
+}
+} // anonymous namespace
+
+std::string FormatMetrics()
+{
+    MetricsWriter out;
+
+    WriteChainMetrics(out);
+    WriteMempoolMetrics(out);
+    WriteNetworkMetrics(out);
+    WriteStakingMetrics(out);
+    WriteScraperMetrics(out);
+    WritePerfMetrics(out);
+
+    return std::move(out.Output());
+}
+
+bool StartMetricsServer()
+{
+    if (!mapArgs.count("-metricsport")) {
+        return true;
+    }
+
+    const int64_t nPort = GetArg("-metricsport", 0);
+
+    if (nPort <= 0 || nPort > 65535) {
+        return error("%s: invalid -metricsport: %s", __func__, mapArgs["-metricsport"]);
+    }
+
+    const std::string strBind = GetArg("-metricsbind", DEFAULT_METRICS_BIND);
+    boost::system::error_code ec;
+    const asio::ip::address address = asio::ip::address::from_string(strBind, ec);
+
+    if (ec) {
+        return error("%s: invalid -metricsbind address: %s", __func__, strBind);
+    }
+
+    assert(metrics_io_context == nullptr);
+    metrics_io_context = new ioContext();
+
+    try {
+        const asio::ip::tcp::endpoint endpoint(address, nPort);
+
+        metrics_acceptor.reset(new asio::ip::tcp::acceptor(*metrics_io_context));
+        metrics_acceptor->open(endpoint.protocol());
+        metrics_acceptor->set_option(asio::ip::tcp::acceptor::reuse_address(true));
+        metrics_acceptor->bind(endpoint);
+        metrics_acceptor->listen(asio::socket_base::max_connections);
+    } catch (const boost::system::system_error& e) {
+        metrics_acceptor.reset();
+        delete metrics_io_context;
+        metrics_io_context = nullptr;
+
+        return error("%s: failed to listen on %s port %d: %s", __func__, strBind, nPort, e.what());
+    }
+
+    // The histograms need the timers:
+    util::g_perf_enabled = GetBoolArg("-perfstats", true);
+
+    Accept();
+
+    metrics_thread = std::thread(&TraceThread<std::function<void()>>, "metrics", std::function<void()>([] {
+        metrics_io_context->run();
+    }));
+
+    LogPrintf("Metrics server listening on %s port %d", strBind, nPort);
+
+    return true;
+}
+
+void StopMetricsServer()
+{
+    if (!metrics_io_context) {
+        return;
+    }
+
+    metrics_io_context->stop();
+
+    if (metrics_thread.joinable()) {
+        metrics_thread.join();
+    }
+
+    metrics_acceptor.reset();
+    delete metrics_io_context;
+    metrics_io_context = nullptr;
+}
@@ -0,0 +1,38 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_METRICS_H
+#define BITCOIN_METRICS_H
+
+#include <string>
+
+/** -metricsbind default */
+static const char* const DEFAULT_METRICS_BIND = "127.0.0.1";
+
+//!
+//! \brief Render the node metrics in the Prometheus text exposition format.
+//!
+//! Reads the published chain tip view, the memory pool, peer and traffic
+//! counters, the staking status, the scraper convergence and the durations
+//! recorded by the util/perf.h timers. Takes no lock on cs_main.
+//!
+std::string FormatMetrics();
+
+//!
+//! \brief Start the HTTP server that answers GET /metrics requests when the
+//! node runs with -metricsport.
+//!
+//! The server listens on -metricsbind and enables the util/perf.h timers
+//! unless started with -perfstats=0.
+//!
+//! \return \c false if the server failed to listen on the port.
+//!
+bool StartMetricsServer();
+
+//!
+//! \brief Stop the metrics server if it runs.
+//!
+void StopMetricsServer();
+
+#endif // BITCOIN_METRICS_H
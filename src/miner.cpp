@@ -18,6 +18,7 @@
 #include "gridcoin/staking/status.h"
 #include "gridcoin/tally.h"
 #include "util.h"
+#include "util/perf.h"
 #include "wallet/wallet.h"
 
 #include <memory>
@@ -25,6 +26,8 @@
 #include <tuple>
 #include <random>
 
+#include <boost/thread.hpp>
+
 using namespace std;
 
 //////////////////////////////////////////////////////////////////////////////
@@ -164,8 +167,219 @@ bool TrySignClaim(
 {
     return TrySignClaim(pwallet, const_cast<GRC::Claim&>(claim), block, dry_run);
 }
+
+//!
+//! \brief Caches the inputs of the stake kernel hash for the coins that the
+//! wallet stakes.
+//!
+//! The version 8 kernel only needs the hash of the transaction that produced
+//! a coin and the time of the block that contains it. Without the cache, each
+//! staking round read the transaction index and the block from disk for every
+//! coin. An entry records the hash of the containing block, so a coin moved
+//! by a reorganization fails validation and reloads. The staking round drops
+//! the entries of coins that it no longer selects, such as spent coins.
+//!
+//! Only the stake miner thread uses the cache.
+//!
+class StakeKernelCache
+{
+public:
+    //!
+    //! \brief Get the time of the block that contains a coin.
+    //!
+    //! \param coin_tx Wallet transaction that produced the coin.
+    //! \param txdb    Reads the transaction index when the wallet does not
+    //! know the block of the transaction and Prefetch() did not read it.
+    //!
+    //! \return The block time, or \c 0 when the coin is not in the main chain.
+    //!
+    unsigned int GetBlockTime(const CWalletTx& coin_tx, CTxDB& txdb)
+    {
+        AssertLockHeld(cs_main);
+
+        const uint256 tx_hash = coin_tx.GetHash();
+        const auto iter = m_entries.find(tx_hash);
+
+        if (iter != m_entries.end()) {
+            if (IsInMainChain(iter->second.m_block_hash)) {
+                return iter->second.m_block_time;
+            }
+
+            m_entries.erase(iter);
+        }
+
+        Entry entry;
+
+        // The wallet may still record a block disconnected by a reorg. Then
+        // the transaction index knows where the transaction confirmed again:
+        if (IsInMainChain(coin_tx.hashBlock)) {
+            entry.m_block_hash = coin_tx.hashBlock;
+        } else {
+            CTxIndex txindex;
+            CBlock block;
+
+            const auto txindex_iter = m_txindexes.find(tx_hash);
+
+            if (txindex_iter != m_txindexes.end()) {
+                txindex = txindex_iter->second;
+            } else if (!txdb.ReadTxIndex(tx_hash, txindex)) {
+                return 0;
+            }
+
+            if (!block.ReadFromDisk(txindex.pos.nFile, txindex.pos.nBlockPos, false)) {
+                return 0;
+            }
+
+            entry.m_block_hash = block.GetHash(true);
+
+            if (!IsInMainChain(entry.m_block_hash)) {
+                return 0;
+            }
+        }
+
+        entry.m_block_time = mapBlockIndex.at(entry.m_block_hash)->nTime;
+        m_entries.emplace(tx_hash, entry);
+
+        return entry.m_block_time;
+    }
+
+    //!
+    //! \brief Read the transaction index entries that GetBlockTime() needs
+    //! for a staking round in one pass over the database.
+    //!
+    //! Only coins without a valid entry whose wallet transaction records no
+    //! block in the main chain need the index, which usually means none, or
+    //! all of the coins after a reorganization or a wallet import.
+    //!
+    void Prefetch(const vector<pair<const CWalletTx*, unsigned int>>& coins, CTxDB& txdb)
+    {
+        AssertLockHeld(cs_main);
+
+        std::vector<uint256> hashes;
+
+        m_txindexes.clear();
+
+        for (const auto& coin : coins) {
+            const auto iter = m_entries.find(coin.first->GetHash());
+
+            if ((iter == m_entries.end() || !IsInMainChain(iter->second.m_block_hash))
+                && !IsInMainChain(coin.first->hashBlock))
+            {
+                hashes.push_back(coin.first->GetHash());
+            }
+        }
+
+        if (hashes.size() > 1 && !txdb.ReadTxIndexes(hashes, m_txindexes)) {
+            m_txindexes.clear();
+        }
+    }
+
+    //!
+    //! \brief Remove the entries of coins missing from the selected set.
+    //!
+    void Retain(const vector<pair<const CWalletTx*, unsigned int>>& coins)
+    {
+        std::set<uint256> selected;
+
+        for (const auto& coin : coins) {
+            selected.insert(coin.first->GetHash());
+        }
+
+        for (auto iter = m_entries.begin(); iter != m_entries.end();) {
+            if (selected.count(iter->first)) {
+                ++iter;
+            } else {
+                iter = m_entries.erase(iter);
+            }
+        }
+    }
+
+private:
+    //!
+    //! \brief Kernel inputs of a coin.
+    //!
+    struct Entry
+    {
+        uint256 m_block_hash;      //!< Block that contains the transaction.
+        unsigned int m_block_time; //!< Time of that block.
+    };
+
+    std::map<uint256, Entry> m_entries; //!< Entries by transaction hash.
+    std::map<uint256, CTxIndex> m_txindexes; //!< Read by Prefetch().
+
+    static bool IsInMainChain(const uint256& block_hash)
+    {
+        const auto iter = mapBlockIndex.find(block_hash);
+
+        return iter != mapBlockIndex.end() && iter->second->IsInMainChain();
+    }
+};
+
+StakeKernelCache g_stake_kernel_cache;
+
+//!
+//! \brief Wakes the stake miner when a staking round can find new kernels.
+//!
+//! The miner masks the coinstake time with STAKE_TIMESTAMP_MASK, so the kernel
+//! hashes only change when a new time slot opens or when a new chain tip
+//! changes the stake modifier and target. The scheduler sleeps until one of
+//! those events instead of polling at the -minersleep interval.
+//!
+class StakeScheduler
+{
+public:
+    //! Wake the miner for a new chain tip.
+    void NotifyTip()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            m_tip_changed = true;
+        }
+
+        m_cond.notify_all();
+    }
+
+    //!
+    //! \brief Sleep until the time slot after \p last_slot opens or until a
+    //! new chain tip arrives.
+    //!
+    //! \param last_slot Masked coinstake time of the last kernel search.
+    //!
+    void WaitForNextRound(const int64_t last_slot)
+    {
+        const int64_t next_slot_ms = (last_slot + GRC::STAKE_TIMESTAMP_MASK + 1) * 1000;
+
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        while (!m_tip_changed && !fShutdown) {
+            // Same clock as GetAdjustedTime(), with millisecond resolution:
+            const int64_t now_ms = GetTimeMillis() + GetTimeOffset() * 1000;
+
+            if (now_ms >= next_slot_ms) {
+                break;
+            }
+
+            // Wake at least once a second to notice a shutdown:
+            m_cond.wait_for(lock, boost::chrono::milliseconds(std::min<int64_t>(next_slot_ms - now_ms, 1000)));
+        }
+
+        m_tip_changed = false;
+    }
+
+private:
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    bool m_tip_changed = false;
+};
+
+StakeScheduler g_stake_scheduler;
 } // anonymous namespace
 
+void WakeStakeMiner()
+{
+    g_stake_scheduler.NotifyTip();
+}
+
 // We want to sort transactions by priority and fee, so:
 typedef std::tuple<double, double, CTransaction*> TxPriority;
 class TxPriorityCompare
@@ -245,6 +459,31 @@ boost::optional<CWalletTx> GetLastStake(CWallet& wallet)
     return stake_tx;
 }
 
+namespace {
+//!
+//! \brief Determine whether the inputs recorded for a memory pool transaction
+//! still hold: each block that confirms a chain input remains in the main
+//! chain, and each parent remains in the pool. Requires cs_main and
+//! mempool.cs.
+//!
+bool IsMemPoolEntryCurrent(const CTxMemPoolEntry& entry)
+{
+    for (const auto& input : entry.vChainInputs) {
+        if (!input.first->IsInMainChain()) {
+            return false;
+        }
+    }
+
+    for (const auto& hash_parent : entry.setParents) {
+        if (!mempool.mapTx.count(hash_parent)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+} // anonymous namespace
+
 // CreateRestOfTheBlock: collect transactions into block and fill in header
 bool CreateRestOfTheBlock(CBlock &block, CBlockIndex* pindexPrev)
 {
@@ -303,7 +542,7 @@ bool CreateRestOfTheBlock(CBlock &block, CBlockIndex* pindexPrev)
         // This vector will be sorted into a priority queue:
         vector<TxPriority> vecPriority;
         vecPriority.reserve(mempool.mapTx.size());
-        for (map<uint256, CTransaction>::iterator mi = mempool.mapTx.begin(); mi != mempool.mapTx.end(); ++mi)
+        for (auto mi = mempool.mapTx.begin(); mi != mempool.mapTx.end(); ++mi)
         {
             CTransaction& tx = (*mi).second;
             if (tx.IsCoinBase() || tx.IsCoinStake() || !IsFinalTx(tx, nHeight))
@@ -326,7 +565,38 @@ bool CreateRestOfTheBlock(CBlock &block, CBlockIndex* pindexPrev)
             double dPriority = 0;
             int64_t nTotalIn = 0;
             bool fMissingInputs = false;
-            for (auto const& txin : tx.vin)
+
+            const auto depend_on = [&](const uint256& hash_parent) {
+                // Has to wait for dependencies
+                if (!porphan)
+                {
+                    // Use list for automatic deletion
+                    vOrphan.push_back(COrphan(&tx));
+                    porphan = &vOrphan.back();
+                    LogPrint(BCLog::LogFlags::NOISY, "Orphan tx %s ",tx.GetHash().GetHex());
+                    msMiningErrorsExcluded += tx.GetHash().GetHex() + ":ORPHAN;";
+                }
+                mapDependers[hash_parent].push_back(porphan);
+                porphan->setDependsOn.insert(hash_parent);
+            };
+
+            // Use the inputs recorded when the pool accepted the transaction
+            // unless later blocks moved them:
+            const CTxMemPoolEntry* entry = mempool.GetEntry(mi->first);
+
+            if (entry && entry->fHaveInputs && IsMemPoolEntryCurrent(*entry))
+            {
+                for (const auto& input : entry->vChainInputs)
+                {
+                    int nConf = 1 + nBestHeight - input.first->nHeight;
+                    dPriority += (double)input.second * nConf;
+                }
+                for (const auto& hash_parent : entry->setParents)
+                    depend_on(hash_parent);
+
+                nTotalIn = entry->nFee + tx.GetValueOut();
+            }
+            else for (auto const& txin : tx.vin)
             {
                 // Read prev transaction
                 CTransaction txPrev;
@@ -349,17 +619,7 @@ bool CreateRestOfTheBlock(CBlock &block, CBlockIndex* pindexPrev)
                         break;
                     }
 
-                    // Has to wait for dependencies
-                    if (!porphan)
-                    {
-                        // Use list for automatic deletion
-                        vOrphan.push_back(COrphan(&tx));
-                        porphan = &vOrphan.back();
-                        LogPrint(BCLog::LogFlags::NOISY, "Orphan tx %s ",tx.GetHash().GetHex());
-                        msMiningErrorsExcluded += tx.GetHash().GetHex() + ":ORPHAN;";
-                    }
-                    mapDependers[txin.prevout.hash].push_back(porphan);
-                    porphan->setDependsOn.insert(txin.prevout.hash);
+                    depend_on(txin.prevout.hash);
                     nTotalIn += mempool.mapTx[txin.prevout.hash].vout[txin.prevout.n].nValue;
                     continue;
                 }
@@ -372,7 +632,9 @@ bool CreateRestOfTheBlock(CBlock &block, CBlockIndex* pindexPrev)
             if (fMissingInputs) continue;
 
             // Priority is sum(valuein * age) / txsize
-            unsigned int nTxSize = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+            unsigned int nTxSize = entry
+                ? entry->nTxSize
+                : ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
             dPriority /= nTxSize;
 
             // This is a more accurate fee-per-kilobyte than is used by the client code, because the
@@ -551,8 +813,9 @@ bool CreateCoinStake( CBlock &blocknew, CKey &key,
     vector<const CWalletTx*> &StakeInputs,
     CWallet &wallet, CBlockIndex* pindexPrev )
 {
+    PERF_SCOPE("Staking.CreateCoinStake");
+
     int64_t CoinWeight;
-    CBigNum StakeKernelHash;
     CTxDB txdb("r");
     int64_t StakeWeightSum = 0;
     double StakeValueSum = 0;
@@ -583,56 +846,76 @@ bool CreateCoinStake( CBlock &blocknew, CKey &key,
     LogPrint(BCLog::LogFlags::MINER, "CreateCoinStake: Staking nTime/16= %d Bits= %u",
     txnew.nTime/16,blocknew.nBits);
 
-    for(const auto& pcoin : CoinsToStake)
+    uint64_t StakeModifier = 0;
+    const bool fStakeModifier = GRC::FindStakeModifierRev(StakeModifier,pindexPrev);
+
+    // Look up the block times of all the coins at once so the kernel loop
+    // below only hashes:
+    vector<unsigned int> CoinBlockTimes;
+    CoinBlockTimes.reserve(CoinsToStake.size());
     {
+        LOCK2(cs_main, wallet.cs_wallet);
+
+        g_stake_kernel_cache.Retain(CoinsToStake);
+        g_stake_kernel_cache.Prefetch(CoinsToStake, txdb);
+
+        for (const auto& pcoin : CoinsToStake)
+            CoinBlockTimes.push_back(g_stake_kernel_cache.GetBlockTime(*pcoin.first, txdb));
+    }
+
+    // Hash the kernels of all the coins in one pass:
+    vector<GRC::StakeKernelCandidate> Candidates;
+    Candidates.reserve(CoinsToStake.size());
+
+    for (size_t i = 0; i < CoinsToStake.size(); ++i)
+        Candidates.push_back({ CoinBlockTimes[i], CoinsToStake[i].first->GetHash(), CoinsToStake[i].second });
+
+    const vector<uint256> KernelHashes = fStakeModifier
+        ? GRC::CalculateStakeHashesV8(Candidates, txnew.nTime, StakeModifier)
+        : vector<uint256>();
+
+    {
+        LOCK(g_miner_status.lock);
+        g_miner_status.m_kernel_hashes += KernelHashes.size();
+    }
+
+    for (size_t i = 0; i < CoinsToStake.size(); ++i)
+    {
+        const auto& pcoin = CoinsToStake[i];
         const CTransaction &CoinTx =*pcoin.first; //transaction that produced this coin
         unsigned int CoinTxN =pcoin.second; //index of this coin inside it
 
-        CTxIndex txindex;
-        {
-            LOCK2(cs_main, wallet.cs_wallet);
-            if (!txdb.ReadTxIndex(pcoin.first->GetHash(), txindex))
-                continue; //error?
-        }
-
-        CBlock CoinBlock; //Block which contains CoinTx
-        {
-            LOCK2(cs_main, wallet.cs_wallet);
-            if (!CoinBlock.ReadFromDisk(txindex.pos.nFile, txindex.pos.nBlockPos, false))
-                continue;
-        }
+        if (CoinBlockTimes[i] == 0)
+            continue;
 
         StakeValueSum += CoinTx.vout[CoinTxN].nValue / (double)COIN;
 
-        uint64_t StakeModifier = 0;
-        if(!GRC::FindStakeModifierRev(StakeModifier,pindexPrev))
+        if (!fStakeModifier)
             continue;
+
         CoinWeight = GRC::CalculateStakeWeightV8(CoinTx,CoinTxN);
-        StakeKernelHash.setuint256(GRC::CalculateStakeHashV8(CoinBlock,CoinTx,CoinTxN,txnew.nTime,StakeModifier));
+        const uint256& StakeKernelHash = KernelHashes[i];
 
-        CBigNum StakeTarget;
-        StakeTarget.SetCompact(blocknew.nBits);
-        StakeTarget*=CoinWeight;
         StakeWeightSum += CoinWeight;
         StakeWeightMin=std::min(StakeWeightMin,CoinWeight);
         StakeWeightMax=std::max(StakeWeightMax,CoinWeight);
-        double StakeKernelDiff = GRC::GetBlockDifficulty(StakeKernelHash.GetCompact())*CoinWeight;
+        double StakeKernelDiff = GRC::GetBlockDifficulty(UintToArith256(StakeKernelHash).GetCompact())*CoinWeight;
 
         LogPrint(BCLog::LogFlags::MINER,
                  "CreateCoinStake: V%d Time %d, Bits %u, Weight %" PRId64 "\n"
                  " Stk %72s\n"
-                 " Trg %72s\n"
+                 " Trg %72s (unweighted)\n"
                  " Diff %0.7f of %0.7f",
                  blocknew.nVersion,
                  txnew.nTime,
                  blocknew.nBits,
                  CoinWeight,
                  StakeKernelHash.GetHex(),
-                 StakeTarget.GetHex(),
+                 arith_uint256().SetCompact(blocknew.nBits).GetHex(),
                  StakeKernelDiff,
                  GRC::GetBlockDifficulty(blocknew.nBits));
 
-        if( StakeKernelHash <= StakeTarget )
+        if (GRC::CheckStakeKernelHashV8(StakeKernelHash, blocknew.nBits, CoinWeight))
         {
             // Found a kernel
             LogPrintf("CreateCoinStake: Found Kernel;");
@@ -1332,10 +1615,21 @@ void StakeMiner(CWallet *pwallet)
     // vSideStakeAlloc is an out parameter.
     bool fEnableSideStaking = GetSideStakingStatusAndAlloc(vSideStakeAlloc);
 
+    // The chain tip and masked coinstake time of the last kernel search:
+    uint256 hashLastSearchTip;
+    int64_t nLastSearchSlot = 0;
+    bool fSearched = false;
+
     while (!fShutdown)
     {
-        //wait for next round
-        MilliSleep(nMinerSleep);
+        //wait for next round. Poll while the wallet cannot stake, and
+        //otherwise sleep until the kernels can change:
+        if (fSearched)
+            g_stake_scheduler.WaitForNextRound(nLastSearchSlot);
+        else
+            MilliSleep(nMinerSleep);
+
+        fSearched = false;
 
         CBlockIndex* pindexPrev = pindexBest;
         CBlock StakeBlock;
@@ -1371,6 +1665,17 @@ void StakeMiner(CWallet *pwallet)
 
         // * Create a bare block
         StakeBlock.nTime= GetAdjustedTime();
+
+        // Skip a round woken for a tip and time slot already searched:
+        const int64_t nSearchSlot = StakeBlock.nTime & ~GRC::STAKE_TIMESTAMP_MASK;
+        fSearched = true;
+
+        if (pindexPrev->GetBlockHash() == hashLastSearchTip && nSearchSlot == nLastSearchSlot)
+            continue;
+
+        hashLastSearchTip = pindexPrev->GetBlockHash();
+        nLastSearchSlot = nSearchSlot;
+
         StakeBlock.nNonce= 0;
         StakeBlock.nBits = GRC::GetNextTargetRequired(pindexPrev);
         StakeBlock.vtx.resize(2);
@@ -1381,7 +1686,18 @@ void StakeMiner(CWallet *pwallet)
         CKey BlockKey;
         vector<const CWalletTx*> StakeInputs;
 
-        if( !CreateCoinStake( StakeBlock, BlockKey, StakeInputs, *pwallet, pindexPrev ) )
+        const int64_t nSearchStart = GetTimeMicros();
+        const bool fKernel = CreateCoinStake( StakeBlock, BlockKey, StakeInputs, *pwallet, pindexPrev );
+
+        {
+            LOCK(g_miner_status.lock);
+
+            g_miner_status.m_rounds++;
+            g_miner_status.m_last_round_usec = GetTimeMicros() - nSearchStart;
+            g_miner_status.m_total_round_usec += g_miner_status.m_last_round_usec;
+        }
+
+        if (!fKernel)
             continue;
         StakeBlock.nTime= StakeTX.nTime;
 
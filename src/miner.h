@@ -17,6 +17,11 @@ typedef std::vector< std::pair<std::string, double> > SideStakeAlloc;
 
 extern unsigned int nMinerSleep;
 
+//!
+//! \brief Wake the stake miner to search for a kernel on a new chain tip.
+//!
+void WakeStakeMiner();
+
 // Note the below constant controls the minimum value allowed for post
 // split UTXO size. It is int64_t but in GRC so that it matches the entry in the config file.
 // It will be converted to Halfords in GetNumberOfStakeOutputs by multiplying by COIN.
@@ -13,11 +13,15 @@
 #include "init.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "util/memory.h"
 #include "gridcoin/gridcoin.h"
 
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/thread.hpp>
+#include <cmath>
+#include <cstring>
 #include <inttypes.h>
+#include <set>
 
 #if !defined(HAVE_MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
@@ -25,6 +29,18 @@
 
 #ifdef WIN32
   #include <string.h>
+#else
+  #include <sys/uio.h>
+#endif
+
+#if defined(__linux__)
+ #define USE_EPOLL
+ #include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+ #define USE_KQUEUE
+ #include <sys/types.h>
+ #include <sys/event.h>
+ #include <sys/time.h>
 #endif
 
 #ifdef USE_UPNP
@@ -80,7 +96,8 @@ CCriticalSection cs_vAddedNodes;
 map<CInv, CDataStream> mapRelay;
 deque<pair<int64_t, CInv> > vRelayExpiration;
 CCriticalSection cs_mapRelay;
-map<CInv, int64_t> mapAlreadyAskedFor;
+std::unordered_map<CInv, int64_t, CInvHasher> mapAlreadyAskedFor;
+CCriticalSection cs_mapAlreadyAskedFor;
 
 static deque<string> vOneShots;
 CCriticalSection cs_vOneShots;
@@ -112,6 +129,28 @@ namespace {
     CBlockLocator g_getblocks_locator;
 }
 
+void ExpireAlreadyAskedFor(int64_t nNow)
+{
+    static int64_t nLastExpire = 0;
+
+    LOCK(cs_mapAlreadyAskedFor);
+
+    if (nNow - nLastExpire < 60 * 1000000)
+        return;
+
+    nLastExpire = nNow;
+
+    const int64_t nCutoff = nNow - ALREADY_ASKED_FOR_TIMEOUT * 1000000;
+
+    for (auto it = mapAlreadyAskedFor.begin(); it != mapAlreadyAskedFor.end();)
+    {
+        if (it->second < nCutoff)
+            it = mapAlreadyAskedFor.erase(it);
+        else
+            ++it;
+    }
+}
+
 void AddOneShot(string strDest)
 {
     LOCK(cs_vOneShots);
@@ -575,6 +614,32 @@ void AddressCurrentlyConnected(const CService& addr)
 
 std::atomic<uint64_t> CNode::nTotalBytesRecv{ 0 };
 std::atomic<uint64_t> CNode::nTotalBytesSent{ 0 };
+CCriticalSection CNode::cs_totalMsgStats;
+MessageStatsMap CNode::mapTotalMsgStats;
+
+const std::string MESSAGE_STATS_OTHER = "*other*";
+
+namespace {
+//!
+//! \brief Commands that the message statistics count by name.
+//!
+//! The statistics file any other command under MESSAGE_STATS_OTHER so that a
+//! peer cannot grow the maps by sending made-up commands.
+//!
+const std::set<std::string> MESSAGE_STATS_COMMANDS = {
+    "alert", "aries", "blocktxn", "cmpctblock", "encrypt", "getaddr",
+    "getblocks", "getblocktxn", "getdata", "getheaders", "gridaddr",
+    "headers", "inv", "mempool", "part", "ping", "pong", "reply",
+    "scraperindex", "sendcmpct", "tx", "verack", "version",
+};
+
+const std::string& MessageStatsCommand(const std::string& strCommand)
+{
+    const auto iter = MESSAGE_STATS_COMMANDS.find(strCommand);
+
+    return iter == MESSAGE_STATS_COMMANDS.end() ? MESSAGE_STATS_OTHER : *iter;
+}
+} // anonymous namespace
 
 CNode* FindNode(const CNetAddr& ip)
 {
@@ -674,8 +739,11 @@ void CNode::CloseSocketDisconnect()
 
         // in case this fails, we'll empty the recv buffer when the CNode is deleted
         TRY_LOCK(cs_vRecvMsg, lockRecv);
-        if (lockRecv)
+        if (lockRecv) {
             vRecvMsg.clear();
+            nRecvSize = 0;
+            fPauseRecv = false;
+        }
     }
 }
 
@@ -862,6 +930,14 @@ void CNode::copyStats(CNodeStats &stats)
     stats.dPingWait = (((double)nPingUsecWait) / 1e6);
     stats.addrLocal = addrLocal.IsValid() ? addrLocal.ToString() : "";
 
+    // Atomics updated whenever the queues change:
+    stats.nSendQueueSize = nSendSize;
+    stats.nRecvQueueSize = nRecvSize;
+
+    {
+        LOCK(cs_msgStats);
+        stats.mapMsgStats = mapMsgStats;
+    }
 }
 
 
@@ -880,9 +956,10 @@ void CNode::CopyNodeStats(std::vector<CNodeStats>& vstats)
 
 
 // requires LOCK(cs_vRecvMsg)
-bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
+bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& fComplete)
 {
     nRecvBytes += nBytes;
+    fComplete = false;
 
     while (nBytes > 0) {
 
@@ -906,10 +983,14 @@ bool CNode::ReceiveMsgBytes(const char *pch, unsigned int nBytes)
         pch += handled;
         nBytes -= handled;
 
-        if (msg.complete())
+        if (msg.complete()) {
             msg.nTime = GetTimeMicros();
+            fComplete = true;
+        }
     }
 
+    UpdateRecvSize();
+
     return true;
 }
 
@@ -951,7 +1032,18 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
     if (vRecv.size() < nDataPos + nCopy) {
         // Allocate up to 256 KiB ahead, but never more than the total message size.
-        vRecv.resize(std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024));
+        const size_t nSize = std::min(hdr.nMessageSize, nDataPos + nCopy + 256 * 1024);
+
+        if (vRecv.capacity() < nSize) {
+            // Move the bytes received so far into a pooled buffer of the next
+            // size class and recycle the smaller one:
+            CSerializeData buffer = g_recv_buffers.Take(nSize);
+            buffer.assign(vRecv.begin(), vRecv.begin() + nDataPos);
+            vRecv.SwapBuffer(buffer);
+            g_recv_buffers.Give(std::move(buffer));
+        }
+
+        vRecv.resize(nSize);
     }
 
     memcpy(&vRecv[nDataPos], pch, nCopy);
@@ -962,26 +1054,220 @@ int CNetMessage::readData(const char *pch, unsigned int nBytes)
 
 
 
+constexpr size_t CReceiveBufferPool::MIN_BUFFER_SIZE;  // for clang
+constexpr size_t CReceiveBufferPool::MAX_BUFFER_SIZE;  // for clang
+constexpr size_t CReceiveBufferPool::MAX_POOLED_BYTES; // for clang
+
+CReceiveBufferPool g_recv_buffers;
+
+namespace {
+//!
+//! \brief Get the smallest size class that holds the specified size.
+//!
+size_t ReceiveBufferClass(size_t nSize)
+{
+    size_t nClass = 0;
+
+    while ((CReceiveBufferPool::MIN_BUFFER_SIZE << nClass) < nSize) {
+        ++nClass;
+    }
+
+    return nClass;
+}
+} // anonymous namespace
+
+CReceiveBufferPool::CReceiveBufferPool()
+    : m_free(ReceiveBufferClass(MAX_BUFFER_SIZE) + 1)
+    , m_bytes(0)
+    , m_hits(0)
+    , m_misses(0)
+{
+}
+
+CSerializeData CReceiveBufferPool::Take(size_t nSize)
+{
+    CSerializeData buffer;
+
+    if (nSize > MAX_BUFFER_SIZE) {
+        buffer.reserve(nSize);
+        return buffer;
+    }
+
+    const size_t nClass = ReceiveBufferClass(nSize);
+
+    {
+        LOCK(cs);
+
+        if (!m_free[nClass].empty()) {
+            buffer.swap(m_free[nClass].back());
+            m_free[nClass].pop_back();
+            m_bytes -= buffer.capacity();
+            ++m_hits;
+
+            return buffer;
+        }
+
+        ++m_misses;
+    }
+
+    buffer.reserve(MIN_BUFFER_SIZE << nClass);
+
+    return buffer;
+}
+
+void CReceiveBufferPool::Give(CSerializeData&& buffer)
+{
+    const size_t nCapacity = buffer.capacity();
+
+    if (nCapacity < MIN_BUFFER_SIZE || nCapacity > MAX_BUFFER_SIZE) {
+        return;
+    }
+
+    // File the buffer under the largest class that it fills:
+    size_t nClass = ReceiveBufferClass(nCapacity);
+
+    if ((MIN_BUFFER_SIZE << nClass) > nCapacity) {
+        --nClass;
+    }
+
+    buffer.clear();
+
+    LOCK(cs);
+
+    if (m_bytes + nCapacity > MAX_POOLED_BYTES) {
+        return;
+    }
+
+    m_bytes += nCapacity;
+    m_free[nClass].emplace_back(std::move(buffer));
+}
+
+void CReceiveBufferPool::Recycle(CDataStream& stream)
+{
+    CSerializeData buffer;
+    stream.SwapBuffer(buffer);
+
+    Give(std::move(buffer));
+}
+
+ReceiveBufferPoolStats CReceiveBufferPool::GetStats()
+{
+    LOCK(cs);
+
+    ReceiveBufferPoolStats stats;
+
+    stats.nBuffers = 0;
+    stats.nBytes = m_bytes;
+    stats.nHits = m_hits;
+    stats.nMisses = m_misses;
+
+    for (const auto& buffers : m_free) {
+        stats.nBuffers += buffers.size();
+    }
+
+    return stats;
+}
+
+void FinalizeMessageHeader(CDataStream& ss)
+{
+    // Set the size
+    unsigned int nSize = ss.size() - CMessageHeader::HEADER_SIZE;
+    memcpy((char*)&ss[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
+
+    // Set the checksum
+    uint256 hash = Hash(ss.begin() + CMessageHeader::HEADER_SIZE, ss.end());
+    unsigned int nChecksum = 0;
+    memcpy(&nChecksum, &hash, sizeof(nChecksum));
+    assert(ss.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
+    memcpy((char*)&ss[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+}
+
+CSharedMessage CSharedMessageCache::Get(const uint256& key)
+{
+    LOCK(cs);
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+        if (it->first == key) {
+            entries.splice(entries.begin(), entries, it);
+            return entries.front().second;
+        }
+    }
+
+    return nullptr;
+}
+
+void CSharedMessageCache::Put(const uint256& key, CSharedMessage message)
+{
+    if (message->size() > nMaxBytes)
+        return;
+
+    LOCK(cs);
+
+    nBytes += message->size();
+    entries.emplace_front(key, std::move(message));
+
+    while (nBytes > nMaxBytes) {
+        nBytes -= entries.back().second->size();
+        entries.pop_back();
+    }
+}
+
+namespace {
+//! Maximum number of queued messages passed to one sendmsg() call.
+constexpr size_t MAX_SEND_IOV = 64;
+} // anonymous namespace
+
 // requires LOCK(cs_vSend)
 void SocketSendData(CNode *pnode)
 {
-    std::deque<CSerializeData>::iterator it = pnode->vSendMsg.begin();
+    std::deque<CSharedMessage>::iterator it = pnode->vSendMsg.begin();
 
     while (it != pnode->vSendMsg.end())
     {
-        const CSerializeData &data = *it;
-        assert(data.size() > pnode->nSendOffset);
+        assert((*it)->size() > pnode->nSendOffset);
+#ifdef WIN32
+        const CSerializeData &data = **it;
         int nBytes = send(pnode->hSocket, &data[pnode->nSendOffset], data.size() - pnode->nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+#else
+        // Gather the queued messages into one system call:
+        struct iovec iov[MAX_SEND_IOV];
+        size_t nIov = 0;
+
+        for (auto itIov = it; itIov != pnode->vSendMsg.end() && nIov < MAX_SEND_IOV; ++itIov, ++nIov) {
+            const size_t nOffset = nIov == 0 ? pnode->nSendOffset : 0;
+            iov[nIov].iov_base = const_cast<char*>((*itIov)->data() + nOffset);
+            iov[nIov].iov_len = (*itIov)->size() - nOffset;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = nIov;
+
+        int nBytes = sendmsg(pnode->hSocket, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+#endif
         if (nBytes > 0) {
             pnode->nLastSend = GetAdjustedTime();
             pnode->nSendBytes += nBytes;
-            pnode->nSendOffset += nBytes;
             pnode->RecordBytesSent(nBytes);
-            if (pnode->nSendOffset == data.size()) {
+
+            // Advance past the messages sent in full:
+            size_t nRemaining = nBytes;
+            while (nRemaining > 0) {
+                const size_t nMessageLeft = (*it)->size() - pnode->nSendOffset;
+
+                if (nRemaining < nMessageLeft) {
+                    pnode->nSendOffset += nRemaining;
+                    break;
+                }
+
+                nRemaining -= nMessageLeft;
                 pnode->nSendOffset = 0;
-                pnode->nSendSize -= data.size();
+                pnode->nSendSize -= (*it)->size();
                 it++;
-            } else {
+            }
+
+            if (pnode->nSendOffset != 0) {
                 // could not send full message; stop sending more
                 break;
             }
@@ -1034,12 +1320,421 @@ void ThreadSocketHandler(void* parg)
     LogPrintf("ThreadSocketHandler exited");
 }
 
+namespace {
+//!
+//! \brief Waits for readiness of the sockets serviced by the socket handler
+//! thread.
+//!
+//! The select() backend rebuilds its descriptor sets on every pass and
+//! cannot watch descriptors above FD_SETSIZE. The epoll (Linux) and kqueue
+//! (BSD, macOS) backends keep the registrations in the kernel across passes
+//! and only make a system call for a socket when its interest changes, so a
+//! pass costs time in proportion to the sockets that are ready.
+//!
+//! The kernel backends are level-triggered. The socket handler reads at
+//! most one buffer from a socket in each pass and skips sockets with busy
+//! locks, so an edge-triggered registration could miss data that remains
+//! in a socket's buffer.
+//!
+class SocketEvents
+{
+public:
+    //!
+    //! \brief Readiness notification mechanisms.
+    //!
+    enum class Mode
+    {
+        SELECT,
+        EPOLL,
+        KQUEUE,
+    };
+
+    //!
+    //! \brief The readiness that the handler waits for on a socket.
+    //!
+    struct Interest
+    {
+        SOCKET m_socket; //!< Socket to watch.
+        NodeId m_owner;  //!< Node that owns the socket, or -1 to listen.
+        bool m_recv;     //!< Wait for data to read.
+        bool m_send;     //!< Wait for space to write.
+    };
+
+    //!
+    //! \brief Sockets found ready by Wait().
+    //!
+    struct Ready
+    {
+        std::set<SOCKET> m_recv;  //!< Sockets with data to read.
+        std::set<SOCKET> m_send;  //!< Sockets with space to write.
+        std::set<SOCKET> m_error; //!< Sockets with an error or a hangup.
+    };
+
+    //!
+    //! \brief Initialize the preferred backend, or select() if the backend
+    //! is not available.
+    //!
+    explicit SocketEvents(Mode mode) : m_mode(Mode::SELECT), m_fd(-1)
+    {
+#ifdef USE_EPOLL
+        if (mode == Mode::EPOLL) {
+            m_fd = epoll_create1(EPOLL_CLOEXEC);
+        }
+#endif
+#ifdef USE_KQUEUE
+        if (mode == Mode::KQUEUE) {
+            m_fd = kqueue();
+        }
+#endif
+        if (m_fd != -1) {
+            m_mode = mode;
+        } else if (mode != Mode::SELECT) {
+            LogPrintf("%s: %s unavailable, falling back to select()", __func__, ModeToString(mode));
+        }
+    }
+
+    ~SocketEvents()
+    {
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+        if (m_fd != -1) {
+            close(m_fd);
+        }
+#endif
+    }
+
+    SocketEvents(const SocketEvents&) = delete;
+    SocketEvents& operator=(const SocketEvents&) = delete;
+
+    //!
+    //! \brief Get the mode that the platform supports best.
+    //!
+    static Mode DefaultMode()
+    {
+#if defined(USE_EPOLL)
+        return Mode::EPOLL;
+#elif defined(USE_KQUEUE)
+        return Mode::KQUEUE;
+#else
+        return Mode::SELECT;
+#endif
+    }
+
+    //!
+    //! \brief Parse the value of the -socketevents option.
+    //!
+    static Mode ParseMode(const std::string& value)
+    {
+        if (value == "epoll") return Mode::EPOLL;
+        if (value == "kqueue") return Mode::KQUEUE;
+        if (value == "select") return Mode::SELECT;
+
+        LogPrintf("%s: unknown -socketevents mode \"%s\"", __func__, value);
+
+        return DefaultMode();
+    }
+
+    static std::string ModeToString(const Mode mode)
+    {
+        switch (mode) {
+            case Mode::SELECT: return "select";
+            case Mode::EPOLL:  return "epoll";
+            case Mode::KQUEUE: return "kqueue";
+        }
+
+        return "unknown";
+    }
+
+    Mode GetMode() const
+    {
+        return m_mode;
+    }
+
+    //!
+    //! \brief Wait until a socket becomes ready or the timeout elapses.
+    //!
+    //! \param interests  Readiness to wait for. Sockets not included are no
+    //! longer watched.
+    //! \param timeout_ms Maximum time to wait in milliseconds.
+    //!
+    //! \return Sockets found ready.
+    //!
+    Ready Wait(const std::vector<Interest>& interests, const int timeout_ms)
+    {
+        switch (m_mode) {
+            case Mode::EPOLL:  return WaitEpoll(interests, timeout_ms);
+            case Mode::KQUEUE: return WaitKqueue(interests, timeout_ms);
+            case Mode::SELECT: break;
+        }
+
+        return WaitSelect(interests, timeout_ms);
+    }
+
+private:
+    //!
+    //! \brief A socket registered with the kernel backend.
+    //!
+    struct Registration
+    {
+        NodeId m_owner; //!< Node that owned the socket when registered.
+        bool m_recv;    //!< Registered to wait for data to read.
+        bool m_send;    //!< Registered to wait for space to write.
+    };
+
+    Mode m_mode; //!< Active backend.
+    int m_fd;    //!< epoll or kqueue descriptor.
+
+    //!
+    //! \brief Sockets registered with the kernel backend. The kernel drops
+    //! the registration of a socket when it closes, so a registration also
+    //! records the owner to detect a socket number reused by a new node.
+    //!
+    std::map<SOCKET, Registration> m_registered;
+
+    Ready WaitSelect(const std::vector<Interest>& interests, const int timeout_ms)
+    {
+        struct timeval timeout;
+        timeout.tv_sec  = timeout_ms / 1000;
+        timeout.tv_usec = (timeout_ms % 1000) * 1000;
+
+        fd_set fdsetRecv;
+        fd_set fdsetSend;
+        fd_set fdsetError;
+        FD_ZERO(&fdsetRecv);
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        SOCKET hSocketMax = 0;
+        bool have_fds = false;
+
+        for (const auto& interest : interests) {
+            if (interest.m_recv) FD_SET(interest.m_socket, &fdsetRecv);
+            if (interest.m_send) FD_SET(interest.m_socket, &fdsetSend);
+            if (interest.m_owner != -1) FD_SET(interest.m_socket, &fdsetError);
+
+            hSocketMax = max(hSocketMax, interest.m_socket);
+            have_fds = true;
+        }
+
+        Ready ready;
+
+        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+
+        if (nSelect == SOCKET_ERROR)
+        {
+            if (have_fds)
+            {
+                int nErr = WSAGetLastError();
+                LogPrint(BCLog::LogFlags::NOISY, "socket select error %d", nErr);
+
+                // Let the receive path discover the broken sockets:
+                for (const auto& interest : interests)
+                    ready.m_recv.insert(interest.m_socket);
+            }
+            MilliSleep(timeout_ms);
+
+            return ready;
+        }
+
+        for (const auto& interest : interests) {
+            if (FD_ISSET(interest.m_socket, &fdsetRecv)) ready.m_recv.insert(interest.m_socket);
+            if (FD_ISSET(interest.m_socket, &fdsetSend)) ready.m_send.insert(interest.m_socket);
+            if (FD_ISSET(interest.m_socket, &fdsetError)) ready.m_error.insert(interest.m_socket);
+        }
+
+        return ready;
+    }
+
+    //!
+    //! \brief Remove the registrations of sockets that the handler no longer
+    //! watches and return the previous registration of each watched socket.
+    //!
+    //! \param interests Readiness to wait for.
+    //! \param previous  Receives the registrations that still apply, in the
+    //! order of \p interests. A socket number reused by a new owner has no
+    //! previous registration.
+    //! \param stale     Receives the sockets to deregister.
+    //!
+    void DiffRegistrations(
+        const std::vector<Interest>& interests,
+        std::vector<Registration>& previous,
+        std::vector<SOCKET>& stale)
+    {
+        std::map<SOCKET, Registration> registered;
+        previous.reserve(interests.size());
+
+        for (const auto& interest : interests) {
+            Registration prev { interest.m_owner, false, false };
+            auto iter = m_registered.find(interest.m_socket);
+
+            if (iter != m_registered.end()) {
+                if (iter->second.m_owner == interest.m_owner) {
+                    prev = iter->second;
+                } else {
+                    stale.push_back(interest.m_socket);
+                }
+
+                m_registered.erase(iter);
+            }
+
+            previous.push_back(prev);
+            registered[interest.m_socket] = { interest.m_owner, interest.m_recv, interest.m_send };
+        }
+
+        for (const auto& entry : m_registered) {
+            stale.push_back(entry.first);
+        }
+
+        m_registered.swap(registered);
+    }
+
+    Ready WaitEpoll(const std::vector<Interest>& interests, const int timeout_ms)
+    {
+        Ready ready;
+#ifdef USE_EPOLL
+        std::vector<Registration> previous;
+        std::vector<SOCKET> stale;
+
+        DiffRegistrations(interests, previous, stale);
+
+        // Closed sockets are already gone from the epoll set:
+        for (const auto& socket : stale) {
+            epoll_ctl(m_fd, EPOLL_CTL_DEL, socket, nullptr);
+        }
+
+        for (size_t i = 0; i < interests.size(); ++i) {
+            const Interest& interest = interests[i];
+            const Registration& prev = previous[i];
+
+            const bool was_registered = prev.m_recv || prev.m_send;
+
+            if (was_registered && prev.m_recv == interest.m_recv && prev.m_send == interest.m_send) {
+                continue;
+            }
+
+            struct epoll_event event;
+            event.events = (interest.m_recv ? static_cast<uint32_t>(EPOLLIN) : 0u)
+                | (interest.m_send ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+            event.data.fd = interest.m_socket;
+
+            if (epoll_ctl(m_fd, was_registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, interest.m_socket, &event) == -1) {
+                // The socket closed and its number was reused since the last
+                // pass, or it is still registered after a failed removal:
+                if (epoll_ctl(m_fd, was_registered ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, interest.m_socket, &event) == -1) {
+                    ready.m_error.insert(interest.m_socket);
+                }
+            }
+        }
+
+        std::vector<struct epoll_event> events(std::max<size_t>(interests.size(), 1));
+        const int count = epoll_wait(m_fd, events.data(), events.size(), timeout_ms);
+
+        if (count == -1) {
+            if (errno != EINTR) {
+                LogPrint(BCLog::LogFlags::NOISY, "socket epoll error %d", errno);
+            }
+
+            return ready;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const SOCKET socket = events[i].data.fd;
+
+            if (events[i].events & EPOLLIN) ready.m_recv.insert(socket);
+            if (events[i].events & EPOLLOUT) ready.m_send.insert(socket);
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) ready.m_error.insert(socket);
+        }
+#endif
+        return ready;
+    }
+
+    Ready WaitKqueue(const std::vector<Interest>& interests, const int timeout_ms)
+    {
+        Ready ready;
+#ifdef USE_KQUEUE
+        std::vector<Registration> previous;
+        std::vector<SOCKET> stale;
+        std::vector<struct kevent> changes;
+
+        DiffRegistrations(interests, previous, stale);
+
+        // Closed sockets are already gone from the kqueue. Deletes of
+        // filters that do not exist fail, so submit each one on its own:
+        for (const auto& socket : stale) {
+            struct kevent change;
+
+            EV_SET(&change, socket, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+            kevent(m_fd, &change, 1, nullptr, 0, nullptr);
+            EV_SET(&change, socket, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+            kevent(m_fd, &change, 1, nullptr, 0, nullptr);
+        }
+
+        for (size_t i = 0; i < interests.size(); ++i) {
+            const Interest& interest = interests[i];
+            const Registration& prev = previous[i];
+
+            if (interest.m_recv != prev.m_recv) {
+                changes.emplace_back();
+                EV_SET(&changes.back(), interest.m_socket, EVFILT_READ,
+                    interest.m_recv ? EV_ADD | EV_ENABLE : EV_DISABLE, 0, 0, nullptr);
+            }
+
+            if (interest.m_send != prev.m_send) {
+                changes.emplace_back();
+                EV_SET(&changes.back(), interest.m_socket, EVFILT_WRITE,
+                    interest.m_send ? EV_ADD | EV_ENABLE : EV_DISABLE, 0, 0, nullptr);
+            }
+        }
+
+        // A filter that the handler stops waiting for stays registered but
+        // disabled until the socket closes. Failed changes are reported in
+        // the event list, so it has room for those too:
+        std::vector<struct kevent> events(std::max<size_t>(interests.size() * 2 + changes.size(), 1));
+
+        struct timespec timeout;
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = (timeout_ms % 1000) * 1000000;
+
+        const int count = kevent(m_fd, changes.data(), changes.size(), events.data(), events.size(), &timeout);
+
+        if (count == -1) {
+            if (errno != EINTR) {
+                LogPrint(BCLog::LogFlags::NOISY, "socket kqueue error %d", errno);
+            }
+
+            return ready;
+        }
+
+        for (int i = 0; i < count; ++i) {
+            const SOCKET socket = events[i].ident;
+
+            if (events[i].flags & EV_ERROR) {
+                // A change failed, e.g. EV_DISABLE of a filter that a closed
+                // socket took with it. The receive path detects the error:
+                if (events[i].data != 0) ready.m_error.insert(socket);
+                continue;
+            }
+
+            if (events[i].filter == EVFILT_READ) ready.m_recv.insert(socket);
+            if (events[i].filter == EVFILT_WRITE) ready.m_send.insert(socket);
+            if (events[i].flags & EV_EOF) ready.m_error.insert(socket);
+        }
+#endif
+        return ready;
+    }
+};
+} // anonymous namespace
+
 void ThreadSocketHandler2(void* parg)
 {
     LogPrint(BCLog::LogFlags::NOISY, "ThreadSocketHandler started");
     list<CNode*> vNodesDisconnected;
     unsigned int nPrevNodeCount = 0;
 
+    SocketEvents socket_events(SocketEvents::ParseMode(
+        GetArg("-socketevents", SocketEvents::ModeToString(SocketEvents::DefaultMode()))));
+
+    LogPrintf("Using %s for socket events", SocketEvents::ModeToString(socket_events.GetMode()));
+
     while (true)
     {
         //
@@ -1120,26 +1815,17 @@ void ThreadSocketHandler2(void* parg)
         //
         // Find which sockets have data to receive
         //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
+        const int timeout_ms = 50; // frequency to poll pnode->vSend
 
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        std::vector<SocketEvents::Interest> interests;
 
         for (auto const& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket, &fdsetRecv);
-            hSocketMax = max(hSocketMax, hListenSocket);
-            have_fds = true;
+            interests.push_back({ hListenSocket, -1, true, false });
         }
         {
             LOCK(cs_vNodes);
+            interests.reserve(interests.size() + vNodes.size());
+
             for (auto const& pnode : vNodes)
             {
                 if (pnode->hSocket == INVALID_SOCKET)
@@ -1147,43 +1833,27 @@ void ThreadSocketHandler2(void* parg)
                 {
                     TRY_LOCK(pnode->cs_vSend, lockSend);
                     if (lockSend) {
-                        // do not read, if draining write queue
-                        if (!pnode->vSendMsg.empty())
-                            FD_SET(pnode->hSocket, &fdsetSend);
-                        else
-                            FD_SET(pnode->hSocket, &fdsetRecv);
-                        FD_SET(pnode->hSocket, &fdsetError);
-                        hSocketMax = max(hSocketMax, pnode->hSocket);
-                        have_fds = true;
+                        // do not read, if draining write queue or if the
+                        // receive queue is full
+                        const bool fSend = !pnode->vSendMsg.empty();
+                        const bool fRecv = !fSend && !pnode->fPauseRecv;
+                        interests.push_back({ pnode->hSocket, pnode->GetId(), fRecv, fSend });
                     }
                 }
             }
         }
 
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+        const SocketEvents::Ready ready = socket_events.Wait(interests, timeout_ms);
+
         if (fShutdown)
             return;
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrint(BCLog::LogFlags::NOISY, "socket select error %d", nErr);
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            MilliSleep(timeout.tv_usec/1000);
-        }
 
 
         //
         // Accept new connections
         //
         for (auto const& hListenSocket : vhListenSocket)
-        if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv))
+        if (hListenSocket != INVALID_SOCKET && ready.m_recv.count(hListenSocket))
         {
             struct sockaddr_storage sockaddr;
             socklen_t len = sizeof(sockaddr);
@@ -1255,7 +1925,7 @@ void ThreadSocketHandler2(void* parg)
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetRecv) || FD_ISSET(pnode->hSocket, &fdsetError))
+            if (ready.m_recv.count(pnode->hSocket) || ready.m_error.count(pnode->hSocket))
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
@@ -1271,8 +1941,11 @@ void ThreadSocketHandler2(void* parg)
                         int nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                         if (nBytes > 0)
                         {
-                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes))
+                            bool fComplete = false;
+                            if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, fComplete))
                                 pnode->CloseSocketDisconnect();
+                            else if (fComplete)
+                                WakeMessageHandler();
                             pnode->nLastRecv = GetAdjustedTime();
                             pnode->RecordBytesRecv(nBytes);
                         }
@@ -1307,11 +1980,17 @@ void ThreadSocketHandler2(void* parg)
             //
             if (pnode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            if (ready.m_send.count(pnode->hSocket))
             {
                 TRY_LOCK(pnode->cs_vSend, lockSend);
-                if (lockSend)
+                if (lockSend) {
+                    const bool fWasFull = pnode->nSendSize >= SendBufferSize();
                     SocketSendData(pnode);
+
+                    // Messages wait while the send buffer is full:
+                    if (fWasFull && pnode->nSendSize < SendBufferSize())
+                        WakeMessageHandler();
+                }
             }
 
             //
@@ -1566,6 +2245,64 @@ void ThreadDNSAddressSeed(void* parg)
     LogPrint(BCLog::LogFlags::NOISY, "ThreadDNSAddressSeed exited");
 }
 
+namespace {
+//!
+//! \brief Resolve the DNS seeds and add the addresses that they return.
+//!
+//! \param found Incremented by the number of addresses added.
+//!
+void ResolveDNSSeeds(int& found)
+{
+    // Each lookup blocks until the resolver answers or times out, so
+    // resolve the seeds at the same time and add the results in order:
+    struct SeedResults
+    {
+        vector<vector<CNetAddr>> vSeedAddrs;
+        vector<CNetAddr> vSeedSources;
+    };
+
+    // The join below is an interruption point. When shutdown interrupts it,
+    // the resolvers detach while getaddrinfo() may still block, so they own
+    // a share of the results rather than pointing into this stack frame:
+    auto results = std::make_shared<SeedResults>();
+    results->vSeedAddrs.resize(ARRAYLEN(strDNSSeed));
+    results->vSeedSources.resize(ARRAYLEN(strDNSSeed));
+    boost::thread_group resolvers;
+
+    for (unsigned int seed_idx = 0; seed_idx < ARRAYLEN(strDNSSeed); seed_idx++) {
+        resolvers.create_thread([seed_idx, results]() {
+            RenameThread("grc-dnsseed");
+
+            if (!LookupHost(strDNSSeed[seed_idx][1], results->vSeedAddrs[seed_idx])) {
+                results->vSeedAddrs[seed_idx].clear();
+            }
+
+            results->vSeedSources[seed_idx] = CNetAddr(strDNSSeed[seed_idx][0], true);
+        });
+    }
+
+    resolvers.join_all();
+
+    const vector<vector<CNetAddr>>& vSeedAddrs = results->vSeedAddrs;
+    const vector<CNetAddr>& vSeedSources = results->vSeedSources;
+
+    for (unsigned int seed_idx = 0; seed_idx < ARRAYLEN(strDNSSeed); seed_idx++) {
+        vector<CAddress> vAdd;
+
+        for (auto const& ip : vSeedAddrs[seed_idx])
+        {
+            int nOneDay = 24*3600;
+            CAddress addr = CAddress(CService(ip, GetDefaultPort()));
+            addr.nTime = GetAdjustedTime() - 3*nOneDay - GetRand(4*nOneDay); // use a random age between 3 and 7 days old
+            vAdd.push_back(addr);
+            found++;
+        }
+
+        addrman.Add(vAdd, vSeedSources[seed_idx]);
+    }
+}
+} // anonymous namespace
+
 void ThreadDNSAddressSeed2(void* parg)
 {
     LogPrint(BCLog::LogFlags::NOISY, "ThreadDNSAddressSeed started");
@@ -1575,25 +2312,12 @@ void ThreadDNSAddressSeed2(void* parg)
     {
         LogPrint(BCLog::LogFlags::NOISY, "Loading addresses from DNS seeds (could take a while)");
 
-        for (unsigned int seed_idx = 0; seed_idx < ARRAYLEN(strDNSSeed); seed_idx++) {
-            if (HaveNameProxy()) {
+        if (HaveNameProxy()) {
+            for (unsigned int seed_idx = 0; seed_idx < ARRAYLEN(strDNSSeed); seed_idx++) {
                 AddOneShot(strDNSSeed[seed_idx][1]);
-            } else {
-                vector<CNetAddr> vaddr;
-                vector<CAddress> vAdd;
-                if (LookupHost(strDNSSeed[seed_idx][1], vaddr))
-                {
-                    for (auto const& ip : vaddr)
-                    {
-                        int nOneDay = 24*3600;
-                        CAddress addr = CAddress(CService(ip, GetDefaultPort()));
-                        addr.nTime = GetAdjustedTime() - 3*nOneDay - GetRand(4*nOneDay); // use a random age between 3 and 7 days old
-                        vAdd.push_back(addr);
-                        found++;
-                    }
-                }
-                addrman.Add(vAdd, CNetAddr(strDNSSeed[seed_idx][0], true));
             }
+        } else {
+            ResolveDNSSeeds(found);
         }
     }
 
@@ -1663,6 +2387,100 @@ void ThreadDumpAddress(void* parg)
     LogPrintf("ThreadDumpAddress exited");
 }
 
+namespace {
+//!
+//! \brief Number of threads that connect to the peers selected from addrman.
+//!
+//! A connection attempt blocks for up to -timeout milliseconds when the peer
+//! does not answer. The threads let the selection continue with the next
+//! outbound slot meanwhile.
+//!
+constexpr int OUTBOUND_CONNECTION_THREADS = 4;
+
+//!
+//! \brief A selected peer waiting for a connection thread.
+//!
+struct OutboundAttempt
+{
+    CAddress addr;
+    std::unique_ptr<CSemaphoreGrant> grant; //!< Outbound slot for the peer.
+};
+
+boost::mutex mutexOutbound;
+boost::condition_variable condOutbound;
+std::deque<OutboundAttempt> vOutboundQueue;
+
+//!
+//! \brief Network groups of the queued and running attempts. Selection skips
+//! them like the groups of connected peers. Guarded by mutexOutbound.
+//!
+std::multiset<std::vector<unsigned char>> setOutboundGroupsInFlight;
+
+void ThreadOpenOutbound(void* parg)
+{
+    RenameThread("grc-opencon");
+
+    try
+    {
+        while (!fShutdown)
+        {
+            OutboundAttempt attempt;
+
+            {
+                boost::unique_lock<boost::mutex> lock(mutexOutbound);
+
+                while (vOutboundQueue.empty())
+                    condOutbound.wait(lock);
+
+                attempt = std::move(vOutboundQueue.front());
+                vOutboundQueue.pop_front();
+            }
+
+            OpenNetworkConnection(attempt.addr, attempt.grant.get());
+
+            boost::lock_guard<boost::mutex> lock(mutexOutbound);
+            setOutboundGroupsInFlight.erase(setOutboundGroupsInFlight.find(attempt.addr.GetGroup()));
+        }
+    }
+    catch (std::exception& e)
+    {
+        PrintException(&e, "ThreadOpenOutbound()");
+    }
+    catch(boost::thread_interrupted&)
+    {
+        LogPrintf("ThreadOpenOutbound exited (interrupt)");
+        return;
+    }
+    catch (...)
+    {
+        PrintException(NULL, "ThreadOpenOutbound()");
+    }
+    LogPrintf("ThreadOpenOutbound exited");
+}
+
+//!
+//! \brief Queue a connection attempt for the connection threads.
+//!
+//! \param addr  Peer selected from addrman.
+//! \param grant Outbound slot to pass to the attempt.
+//!
+void QueueOutboundAttempt(const CAddress& addr, CSemaphoreGrant& grant)
+{
+    OutboundAttempt attempt;
+    attempt.addr = addr;
+    attempt.grant = MakeUnique<CSemaphoreGrant>();
+    grant.MoveTo(*attempt.grant);
+
+    {
+        boost::lock_guard<boost::mutex> lock(mutexOutbound);
+        setOutboundGroupsInFlight.insert(addr.GetGroup());
+        vOutboundQueue.push_back(std::move(attempt));
+    }
+
+    condOutbound.notify_one();
+}
+} // anonymous namespace
+
 void ThreadOpenConnections(void* parg)
 {
     // Make this thread recognisable as the connection opening thread
@@ -1751,6 +2569,55 @@ uint64_t CNode::GetTotalBytesSent()
     return nTotalBytesSent;
 }
 
+void CNode::RecordMessageRecv(const std::string& strCommand, uint64_t nBytes, int64_t nTimeUsec)
+{
+    const std::string& strKey = MessageStatsCommand(strCommand);
+
+    {
+        LOCK(cs_msgStats);
+        CMessageStats& stats = mapMsgStats[strKey];
+        ++stats.nMsgsRecv;
+        stats.nBytesRecv += nBytes;
+        stats.nProcessTimeUsec += nTimeUsec;
+    }
+
+    LOCK(cs_totalMsgStats);
+    CMessageStats& stats = mapTotalMsgStats[strKey];
+    ++stats.nMsgsRecv;
+    stats.nBytesRecv += nBytes;
+    stats.nProcessTimeUsec += nTimeUsec;
+}
+
+void CNode::RecordMessageSent(const CSerializeData& message)
+{
+    if (message.size() < CMessageHeader::HEADER_SIZE) {
+        return;
+    }
+
+    // The command follows the message start in the header, padded with NULs:
+    const char* pszCommand = message.data() + CMessageHeader::MESSAGE_START_SIZE;
+    const std::string strCommand(pszCommand, strnlen(pszCommand, CMessageHeader::COMMAND_SIZE));
+    const std::string& strKey = MessageStatsCommand(strCommand);
+
+    {
+        LOCK(cs_msgStats);
+        CMessageStats& stats = mapMsgStats[strKey];
+        ++stats.nMsgsSent;
+        stats.nBytesSent += message.size();
+    }
+
+    LOCK(cs_totalMsgStats);
+    CMessageStats& stats = mapTotalMsgStats[strKey];
+    ++stats.nMsgsSent;
+    stats.nBytesSent += message.size();
+}
+
+MessageStatsMap CNode::GetTotalMessageStats()
+{
+    LOCK(cs_totalMsgStats);
+    return mapTotalMsgStats;
+}
+
 void ThreadOpenConnections2(void* parg)
 {
     LogPrint(BCLog::LogFlags::NOISY, "ThreadOpenConnections started");
@@ -1776,6 +2643,12 @@ void ThreadOpenConnections2(void* parg)
         }
     }
 
+    for (int i = 0; i < OUTBOUND_CONNECTION_THREADS; i++)
+    {
+        if (!netThreads->createThread(ThreadOpenOutbound, NULL, "ThreadOpenOutbound" + std::to_string(i)))
+            LogPrintf("Error: createThread(ThreadOpenOutbound) failed");
+    }
+
     // Initiate network connections
     int64_t nStart = GetAdjustedTime();
     while (true)
@@ -1829,6 +2702,14 @@ void ThreadOpenConnections2(void* parg)
             }
         }
 
+        // Count the attempts in progress as connected so that two attempts
+        // do not pick the same network group:
+        {
+            boost::lock_guard<boost::mutex> lock(mutexOutbound);
+            setConnected.insert(setOutboundGroupsInFlight.begin(), setOutboundGroupsInFlight.end());
+            nOutbound += setOutboundGroupsInFlight.size();
+        }
+
         int64_t nANow = GetAdjustedTime();
 
         int nTries = 0;
@@ -1864,7 +2745,7 @@ void ThreadOpenConnections2(void* parg)
         }
 
         if (addrConnect.IsValid())
-            OpenNetworkConnection(addrConnect, &grant);
+            QueueOutboundAttempt(addrConnect, grant);
     }
 }
 
@@ -2015,11 +2896,51 @@ void ThreadMessageHandler(void* parg)
     LogPrintf("ThreadMessageHandler exited");
 }
 
+namespace {
+//!
+//! \brief Guards fMsgProcWake.
+//!
+boost::mutex mutexMsgProc;
+
+//!
+//! \brief Signals the message handler thread that it has work to do.
+//!
+boost::condition_variable condMsgProc;
+
+//!
+//! \brief Set when work arrives for the message handler thread.
+//!
+bool fMsgProcWake = false;
+
+//!
+//! \brief Maximum time that the message handler sleeps without a wake-up.
+//! Trickled inventory, address relay and pings are sent on this interval.
+//!
+constexpr int64_t MESSAGE_HANDLER_INTERVAL_MS = 100;
+} // anonymous namespace
+
+int64_t PoissonNextSend(int64_t nNow, double average_interval_seconds)
+{
+    return nNow + (int64_t)(log1p(GetRand(1ULL << 48) * -0.0000000000000035527136788 /* -1/2^48 */) * average_interval_seconds * -1000000.0 + 0.5);
+}
+
+void WakeMessageHandler()
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mutexMsgProc);
+        fMsgProcWake = true;
+    }
+
+    condMsgProc.notify_one();
+}
+
 void ThreadMessageHandler2(void* parg)
 {
     LogPrint(BCLog::LogFlags::NOISY, "ThreadMessageHandler started");
     while (!fShutdown)
     {
+        bool fMoreWork = false;
+
         vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
@@ -2029,9 +2950,6 @@ void ThreadMessageHandler2(void* parg)
         }
 
         // Poll the connected nodes for messages
-        CNode* pnodeTrickle = NULL;
-        if (!vNodesCopy.empty())
-            pnodeTrickle = vNodesCopy[GetRand(vNodesCopy.size())];
         for (auto const& pnode : vNodesCopy)
         {
             if (pnode->fDisconnect)
@@ -2042,8 +2960,26 @@ void ThreadMessageHandler2(void* parg)
             {
                 TRY_LOCK(pnode->cs_vRecvMsg, lockRecv);
                 if (lockRecv)
+                {
                     if (!ProcessMessages(pnode))
                         pnode->CloseSocketDisconnect();
+
+                    // Complete messages remain when the send buffer filled.
+                    // The message workers wake the thread when their queue
+                    // for the node drains:
+                    if (!pnode->fDisconnect
+                        && !pnode->vRecvMsg.empty()
+                        && pnode->vRecvMsg.front().complete()
+                        && pnode->nSendSize < SendBufferSize()
+                        && pnode->nWorkQueueSize < ReceiveFloodSize())
+                    {
+                        fMoreWork = true;
+                    }
+                }
+                else
+                {
+                    fMoreWork = true;
+                }
             }
 
             if (fShutdown)
@@ -2065,7 +3001,7 @@ void ThreadMessageHandler2(void* parg)
                     TRY_LOCK(pnode->cs_vSend, lockSend);
                     if (lockSend)
                     {
-                        SendMessages(pnode, pnode == pnodeTrickle);
+                        SendMessages(pnode);
                     }
                 }
             }
@@ -2080,9 +3016,22 @@ void ThreadMessageHandler2(void* parg)
                 pnode->Release();
         }
 
-        // Wait and allow messages to bunch up.
-        // we're sleeping, but we must always check fShutdown after doing this.
-        MilliSleep(100);
+        // Sleep until a node receives a complete message or has data to
+        // send, or until the poll interval elapses. We must always check
+        // fShutdown after doing this.
+        {
+            boost::unique_lock<boost::mutex> lock(mutexMsgProc);
+
+            if (!fMoreWork) {
+                condMsgProc.wait_for(
+                    lock,
+                    boost::chrono::milliseconds(MESSAGE_HANDLER_INTERVAL_MS),
+                    [] { return fMsgProcWake; });
+            }
+
+            fMsgProcWake = false;
+        }
+
         if (fRequestShutdown)
             StartShutdown();
         if (fShutdown)
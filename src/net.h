@@ -7,15 +7,22 @@
 
 #include <deque>
 #include <array>
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <boost/thread.hpp>
 #include <atomic>
 #include <openssl/rand.h>
 
 #include "netbase.h"
+#include "bloom.h"
 #include "mruset.h"
 #include "protocol.h"
 #include "streams.h"
 #include "addrman.h"
+#include "crypto/siphash.h"
 
 #ifndef WIN32
 #include <arpa/inet.h>
@@ -31,6 +38,10 @@ extern int nBestHeight;
 static const int PING_INTERVAL = 2 * 60;
 /** Time after which to disconnect, after waiting for a ping response (or inactivity). */
 static const int TIMEOUT_INTERVAL = 20 * 60;
+/** Number of recent inventory items that a node remembers a peer knows. */
+static const unsigned int INVENTORY_KNOWN_MAX = 5000;
+/** Time after which to forget a request for an object that did not arrive (in seconds). */
+static const int64_t ALREADY_ASKED_FOR_TIMEOUT = 20 * 60;
 extern int MAX_OUTBOUND_CONNECTIONS;
 extern int PEER_TIMEOUT;
 
@@ -52,6 +63,65 @@ bool BindListenPort(const CService &bindAddr, std::string& strError=REF(std::str
 void StartNode(void* parg);
 bool StopNode();
 void SocketSendData(CNode *pnode);
+
+/** A serialized message, header included, that send queues can share. */
+typedef std::shared_ptr<const CSerializeData> CSharedMessage;
+
+/** Fill in the size and checksum of a message serialized after a
+ * CMessageHeader at the start of the stream.
+ */
+void FinalizeMessageHeader(CDataStream& ss);
+
+/** Serialize a message once so that the send queues of many nodes can
+ * share it.
+ *
+ * @param nVersion Version of the serialization format that the receiving
+ * nodes expect. See CNode::ssSend.
+ */
+template<typename... Args>
+CSharedMessage MakeSharedMessage(int nVersion, const char* pszCommand, const Args&... args)
+{
+    CDataStream ss(SER_NETWORK, nVersion);
+    ss.SetSecret(false);
+    ss << CMessageHeader(pszCommand, 0);
+    // Expands to one stream insertion per argument:
+    (void)std::initializer_list<int>{ (ss << args, 0)... };
+    FinalizeMessageHeader(ss);
+
+    auto data = std::make_shared<CSerializeData>();
+    ss.GetAndClear(*data);
+
+    return data;
+}
+
+/** Keeps recently built shared messages for objects that many nodes
+ * request, like blocks and scraper parts, bounded by their total size.
+ */
+class CSharedMessageCache
+{
+public:
+    explicit CSharedMessageCache(size_t nMaxBytesIn) : nMaxBytes(nMaxBytesIn), nBytes(0) { }
+
+    /** @return the message built for the key, or null if not cached. */
+    CSharedMessage Get(const uint256& key);
+
+    /** Store a message for the key, evicting the least recently used. */
+    void Put(const uint256& key, CSharedMessage message);
+
+private:
+    CCriticalSection cs;
+    std::list<std::pair<uint256, CSharedMessage>> entries; // most recent first
+    size_t nMaxBytes;
+    size_t nBytes;
+};
+/** Wake the message handler thread to process new messages or send queued
+ * data before its poll interval elapses.
+ */
+void WakeMessageHandler();
+/** Return a time in microseconds for an event that happens on average
+ * every average_interval_seconds, as a Poisson process would space them.
+ */
+int64_t PoissonNextSend(int64_t nNow, double average_interval_seconds);
 extern std::vector<CNode*> vNodes;
 extern CCriticalSection cs_vNodes;
 
@@ -94,6 +164,7 @@ enum
     MSG_BLOCK,
     MSG_PART,
     MSG_SCRAPERINDEX,
+    MSG_CMPCT_BLOCK,
 };
 
 
@@ -126,7 +197,40 @@ extern CAddrMan addrman;
 extern std::map<CInv, CDataStream> mapRelay;
 extern std::deque<std::pair<int64_t, CInv> > vRelayExpiration;
 extern CCriticalSection cs_mapRelay;
-extern std::map<CInv, int64_t> mapAlreadyAskedFor;
+/** Hashes inventory items with a random key, so that peers cannot choose
+ *  items that collide in the request table. */
+class CInvHasher
+{
+private:
+    uint64_t k0;
+    uint64_t k1;
+
+public:
+    CInvHasher()
+        : k0(GetRand(std::numeric_limits<uint64_t>::max()))
+        , k1(GetRand(std::numeric_limits<uint64_t>::max()))
+    {
+    }
+
+    size_t operator()(const CInv& inv) const
+    {
+        return CSipHasher(k0, k1).Write((uint64_t)inv.type).Write(inv.hash.begin(), inv.hash.size()).Finalize();
+    }
+};
+
+//! Time of the latest request for each object that the node asked peers for.
+extern std::unordered_map<CInv, int64_t, CInvHasher> mapAlreadyAskedFor;
+//! Guards mapAlreadyAskedFor and the mapAskFor and setCompactBlocksAsked of
+//! each node.
+extern CCriticalSection cs_mapAlreadyAskedFor;
+
+/** Forget the requests older than ALREADY_ASKED_FOR_TIMEOUT for objects that
+ *  never arrived or that the node had already, so that a later announcement
+ *  asks for them again. Runs at most once a minute.
+ *
+ *  @param nNow Current adjusted time in microseconds.
+ */
+void ExpireAlreadyAskedFor(int64_t nNow);
 extern ThreadHandler* netThreads;
 
 
@@ -134,6 +238,22 @@ extern std::vector<std::string> vAddedNodes;
 extern CCriticalSection cs_vAddedNodes;
 
 
+//! Traffic counters of one message command.
+struct CMessageStats
+{
+    uint64_t nMsgsRecv = 0;        //!< Messages received.
+    uint64_t nBytesRecv = 0;       //!< Bytes received, including headers.
+    uint64_t nMsgsSent = 0;        //!< Messages queued for sending.
+    uint64_t nBytesSent = 0;       //!< Bytes queued for sending, including headers.
+    int64_t nProcessTimeUsec = 0;  //!< Time spent in ProcessMessage().
+};
+
+//! Traffic counters by message command.
+typedef std::map<std::string, CMessageStats> MessageStatsMap;
+
+//! Command that message statistics file unknown commands under.
+extern const std::string MESSAGE_STATS_OTHER;
+
 class CNodeStats
 {
 public:
@@ -157,11 +277,67 @@ public:
     double dPingWait;
 	std::string addrLocal;
 	int nTrust;
+    size_t nSendQueueSize;
+    size_t nRecvQueueSize;
+    MessageStatsMap mapMsgStats;
 };
 
 
 
 
+//! Usage counters of the receive buffer pool.
+struct ReceiveBufferPoolStats
+{
+    size_t nBuffers;     //!< Free buffers held.
+    size_t nBytes;       //!< Capacity of the free buffers held.
+    uint64_t nHits;      //!< Buffers handed out from the pool.
+    uint64_t nMisses;    //!< Buffers allocated because the pool had none.
+};
+
+//!
+//! \brief Recycles the buffers that hold the payloads of received messages.
+//!
+//! The pool sorts free buffers into power-of-two size classes. A message
+//! takes a buffer of the smallest class that fits its payload and the node
+//! gives the buffer back after it processes the message, so the next message
+//! of a similar size reuses the allocation instead of growing a new one.
+//!
+class CReceiveBufferPool
+{
+public:
+    static constexpr size_t MIN_BUFFER_SIZE = 1024;              //!< Smallest class.
+    static constexpr size_t MAX_BUFFER_SIZE = 4 * 1024 * 1024;   //!< Largest class.
+    static constexpr size_t MAX_POOLED_BYTES = 32 * 1024 * 1024; //!< Limit of free capacity.
+
+    CReceiveBufferPool();
+
+    //!
+    //! \brief Get an empty buffer that can hold at least \p nSize bytes.
+    //!
+    CSerializeData Take(size_t nSize);
+
+    //!
+    //! \brief Return a buffer to the pool. Frees buffers outside the size
+    //! classes and buffers beyond MAX_POOLED_BYTES.
+    //!
+    void Give(CSerializeData&& buffer);
+
+    //! Move the buffer of a processed message back to the pool.
+    void Recycle(CDataStream& stream);
+
+    ReceiveBufferPoolStats GetStats();
+
+private:
+    CCriticalSection cs;
+    std::vector<std::vector<CSerializeData>> m_free; //!< Free buffers by class.
+    size_t m_bytes;                                  //!< Capacity of m_free.
+    uint64_t m_hits;                                 //!< Buffers reused.
+    uint64_t m_misses;                               //!< Buffers allocated.
+};
+
+//! Receive buffers shared by all peers.
+extern CReceiveBufferPool g_recv_buffers;
+
 class CNetMessage {
 public:
     bool in_data;                   // parsing header (false) or data (true)
@@ -176,7 +352,9 @@ public:
     int64_t nTime;                  // time (in microseconds) of message receipt.
 
     CNetMessage(int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn) {
+        hdrbuf.SetSecret(false);
         hdrbuf.resize(24);
+        vRecv.SetSecret(false);
         in_data = false;
         nHdrPos = 0;
         nDataPos = 0;
@@ -212,14 +390,16 @@ public:
     uint64_t nServices;
     SOCKET hSocket;
     CDataStream ssSend;
-    size_t nSendSize; // total size of all vSendMsg entries
+    std::atomic<size_t> nSendSize; // total size of all vSendMsg entries
     size_t nSendOffset; // offset inside the first vSendMsg already sent
     std::atomic<uint64_t> nSendBytes {0};
-    std::deque<CSerializeData> vSendMsg;
+    std::deque<CSharedMessage> vSendMsg;
     CCriticalSection cs_vSend;
 
     std::deque<CNetMessage> vRecvMsg;
     CCriticalSection cs_vRecvMsg;
+    std::atomic<size_t> nRecvSize {0}; // total size of vRecvMsg as of its last change
+    std::atomic<bool> fPauseRecv {false}; // stop reading while vRecvMsg is full
     std::atomic<uint64_t> nRecvBytes {0};
     int nRecvVersion;
 
@@ -275,16 +455,18 @@ public:
     uint256 hashCheckpointKnown; // ppcoin: known sent sync-checkpoint
 
     // inventory based relay
-    mruset<CInv> setInventoryKnown;
+    CRollingBloomFilter filterInventoryKnown;
     std::vector<CInv> vInventoryToSend;
     CCriticalSection cs_inventory;
     std::multimap<int64_t, CInv> mapAskFor;
+    // Blocks requested from the peer in compact form and not received yet.
+    std::set<uint256> setCompactBlocksAsked;
 
     // Ping time measurement:
     // The pong reply we're expecting, or 0 if no pong expected.
-    uint64_t nPingNonceSent;
+    std::atomic<uint64_t> nPingNonceSent;
     // Time (in usec) the last ping was sent, or 0 if no ping was ever sent.
-    int64_t nPingUsecStart;
+    std::atomic<int64_t> nPingUsecStart;
     // Last measured round-trip time.
     std::atomic<int64_t> nPingUsecTime{0};
     // Best measured round-trip time.
@@ -293,10 +475,22 @@ public:
     // Whether a ping is requested.
     bool fPingQueued;
 
-    CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn = "", bool fInboundIn=false) : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000)
+    // Times in microseconds of the next address and trickled inventory
+    // broadcasts to the peer.
+    int64_t nNextAddrSend;
+    int64_t nNextInvSend;
+
+    // Bytes of received messages waiting for the message worker threads.
+    std::atomic<size_t> nWorkQueueSize{0};
+
+    // Whether the peer reconstructs blocks from "cmpctblock" messages.
+    std::atomic<bool> fSupportsCompactBlocks{false};
+
+    CNode(SOCKET hSocketIn, CAddress addrIn, std::string addrNameIn = "", bool fInboundIn=false) : ssSend(SER_NETWORK, INIT_PROTO_VERSION), setAddrKnown(5000), filterInventoryKnown(INVENTORY_KNOWN_MAX, 0.000001)
     {
 
         nServices = 0;
+        ssSend.SetSecret(false);
         hSocket = hSocketIn;
         nRecvVersion = INIT_PROTO_VERSION;
         nLastSend = 0;
@@ -326,10 +520,11 @@ public:
 		nOrphanCountViolations=0;
 		nTrust = 0;
         hashCheckpointKnown.SetNull();
-        setInventoryKnown.max_size(SendBufferSize() / 1000);
         nPingNonceSent = 0;
         nPingUsecStart = 0;
         fPingQueued = false;
+        nNextAddrSend = 0;
+        nNextInvSend = 0;
 
         // Be shy and don't send version until we hear
         if (hSocket != INVALID_SOCKET && !fInbound)
@@ -360,6 +555,11 @@ private:
     // Network usage totals
     static std::atomic<uint64_t> nTotalBytesRecv;
     static std::atomic<uint64_t> nTotalBytesSent;
+    static CCriticalSection cs_totalMsgStats;
+    static MessageStatsMap mapTotalMsgStats;
+
+    CCriticalSection cs_msgStats;
+    MessageStatsMap mapMsgStats;
 
 
 public:
@@ -384,7 +584,21 @@ public:
     }
 
     // requires LOCK(cs_vRecvMsg)
-    bool ReceiveMsgBytes(const char *pch, unsigned int nBytes);
+    // Refresh nRecvSize and pause reading from the socket while the queue
+    // exceeds the receive buffer limit. Reading only pauses when a complete
+    // message waits at the front, because processing it frees space. A single
+    // incomplete message over the limit disconnects the peer instead.
+    void UpdateRecvSize()
+    {
+        nRecvSize = GetTotalRecvSize();
+        fPauseRecv = nRecvSize >= ReceiveFloodSize()
+            && !vRecvMsg.empty()
+            && vRecvMsg.front().complete();
+    }
+
+    // requires LOCK(cs_vRecvMsg)
+    // fComplete is set if the bytes completed at least one message.
+    bool ReceiveMsgBytes(const char *pch, unsigned int nBytes, bool& fComplete);
 
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn)
@@ -426,7 +640,7 @@ public:
     {
         {
             LOCK(cs_inventory);
-            setInventoryKnown.insert(inv);
+            filterInventoryKnown.insert(inv);
         }
     }
 
@@ -434,13 +648,19 @@ public:
     {
         {
             LOCK(cs_inventory);
-            if (!setInventoryKnown.count(inv))
-                vInventoryToSend.push_back(inv);
+            if (filterInventoryKnown.contains(inv))
+                return;
+
+            vInventoryToSend.push_back(inv);
         }
+
+        WakeMessageHandler();
     }
 
     void AskFor(const CInv& inv)
     {
+        LOCK(cs_mapAlreadyAskedFor);
+
         // We're using mapAskFor as a priority queue,
         // the key is the earliest time the request can be sent
         int64_t& nRequestTime = mapAlreadyAskedFor[inv];
@@ -486,28 +706,39 @@ public:
         if (ssSend.size() == 0)
             return;
 
-        // Set the size
-        unsigned int nSize = ssSend.size() - CMessageHeader::HEADER_SIZE;
-        memcpy((char*)&ssSend[CMessageHeader::MESSAGE_SIZE_OFFSET], &nSize, sizeof(nSize));
+        FinalizeMessageHeader(ssSend);
 
-        // Set the checksum
-        uint256 hash = Hash(ssSend.begin() + CMessageHeader::HEADER_SIZE, ssSend.end());
-        unsigned int nChecksum = 0;
-        memcpy(&nChecksum, &hash, sizeof(nChecksum));
-        assert(ssSend.size () >= CMessageHeader::CHECKSUM_OFFSET + sizeof(nChecksum));
-        memcpy((char*)&ssSend[CMessageHeader::CHECKSUM_OFFSET], &nChecksum, sizeof(nChecksum));
+        LogPrint(BCLog::LogFlags::NOISY, "(%d bytes)", ssSend.size() - CMessageHeader::HEADER_SIZE);
 
-        LogPrint(BCLog::LogFlags::NOISY, "(%d bytes)", nSize);
+        auto data = std::make_shared<CSerializeData>();
+        ssSend.GetAndClear(*data);
+        QueueMessage(std::move(data));
 
-        std::deque<CSerializeData>::iterator it = vSendMsg.insert(vSendMsg.end(), CSerializeData());
-        ssSend.GetAndClear(*it);
-        nSendSize += (*it).size();
+        LEAVE_CRITICAL_SECTION(cs_vSend);
+    }
+
+    // requires LOCK(cs_vSend)
+    void QueueMessage(CSharedMessage message)
+    {
+        RecordMessageSent(*message);
+
+        nSendSize += message->size();
+        vSendMsg.push_back(std::move(message));
 
         // If write queue empty, attempt "optimistic write"
-        if (it == vSendMsg.begin())
+        if (vSendMsg.size() == 1)
             SocketSendData(this);
+    }
 
-        LEAVE_CRITICAL_SECTION(cs_vSend);
+    /** Queue a message built by MakeSharedMessage() without copying it. */
+    void PushSharedMessage(CSharedMessage message)
+    {
+        LOCK(cs_vSend);
+        assert(ssSend.size() == 0);
+
+        LogPrint(BCLog::LogFlags::NOISY, "sending shared message (%d bytes)", message->size());
+
+        QueueMessage(std::move(message));
     }
 
     void PushVersion();
@@ -644,6 +875,21 @@ public:
     static uint64_t GetTotalBytesRecv();
     static uint64_t GetTotalBytesSent();
 
+    //!
+    //! \brief Count a processed message in the statistics of its command.
+    //!
+    //! \param strCommand   Command of the message.
+    //! \param nBytes       Size of the message including its header.
+    //! \param nTimeUsec    Time that ProcessMessage() spent on the message.
+    //!
+    void RecordMessageRecv(const std::string& strCommand, uint64_t nBytes, int64_t nTimeUsec);
+
+    //! Count a serialized message queued for sending.
+    void RecordMessageSent(const CSerializeData& message);
+
+    //! Get the traffic counters by command across all peers since startup.
+    static MessageStatsMap GetTotalMessageStats();
+
     friend class BanMan;
 
 };
@@ -1258,6 +1258,25 @@ static inline int NetmaskBits(uint8_t x)
     }
 }
 
+int CSubNet::GetPrefixLength() const
+{
+    int bits = 0;
+    int n = 0;
+    for (; n < 16 && netmask[n] == 0xff; ++n)
+        bits += 8;
+    if (n < 16) {
+        const int tail = NetmaskBits(netmask[n]);
+        if (tail < 0)
+            return -1;
+        bits += tail;
+        ++n;
+    }
+    for (; n < 16; ++n)
+        if (netmask[n] != 0x00)
+            return -1;
+    return bits;
+}
+
 std::string CSubNet::ToString() const
 {
     /* Parse binary 1{n}0{N-n} to see if mask can be represented as /n */
@@ -111,6 +111,12 @@ class CSubNet
 
         bool Match(const CNetAddr &addr) const;
 
+        /// Network (base) address, normalized according to the netmask
+        const CNetAddr& GetNetwork() const { return network; }
+        /// Number of leading 1-bits of the 128-bit netmask, or -1 if the
+        /// netmask is not a prefix
+        int GetPrefixLength() const;
+
         std::string ToString() const;
         bool IsValid() const;
 
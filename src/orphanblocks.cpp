@@ -0,0 +1,194 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "orphanblocks.h"
+#include "util/memory.h"
+
+constexpr int64_t COrphanBlockPool::ORPHAN_BLOCK_EXPIRE_TIME; // for clang
+
+COrphanBlockPool::COrphanBlockPool(size_t max_bytes)
+    : m_bytes(0)
+    , m_max_bytes(max_bytes)
+    , m_added(0)
+    , m_expired(0)
+    , m_evicted(0)
+{
+}
+
+const CBlock* COrphanBlockPool::Get(const uint256& hash) const
+{
+    const auto iter = m_blocks.find(hash);
+
+    if (iter == m_blocks.end()) {
+        return nullptr;
+    }
+
+    return iter->second.m_block.get();
+}
+
+const CBlock* COrphanBlockPool::GetRoot(const CBlock* block) const
+{
+    for (const CBlock* parent = Get(block->hashPrevBlock);
+        parent;
+        parent = Get(block->hashPrevBlock))
+    {
+        block = parent;
+    }
+
+    return block;
+}
+
+const CBlock* COrphanBlockPool::Add(const CBlock& block, NodeId from, int64_t now)
+{
+    const uint256 hash = block.GetHash(true);
+
+    if (Contains(hash)) {
+        return Get(hash);
+    }
+
+    Entry entry;
+    entry.m_block = MakeUnique<CBlock>(block);
+    entry.m_block->ReleaseRawData();
+    entry.m_from = from;
+    entry.m_time = now;
+    entry.m_bytes = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+
+    m_bytes += entry.m_bytes;
+    m_peer_bytes[from] += entry.m_bytes;
+    m_by_prev.emplace(block.hashPrevBlock, hash);
+
+    if (block.IsProofOfStake()) {
+        m_stakes.insert(block.GetProofOfStake());
+    }
+
+    m_blocks.emplace(hash, std::move(entry));
+    ++m_added;
+
+    Limit(now);
+
+    return Get(hash);
+}
+
+std::vector<std::unique_ptr<CBlock>> COrphanBlockPool::TakeChildren(const uint256& hash_prev)
+{
+    std::vector<uint256> hashes;
+    const auto range = m_by_prev.equal_range(hash_prev);
+
+    for (auto iter = range.first; iter != range.second; ++iter) {
+        hashes.push_back(iter->second);
+    }
+
+    std::vector<std::unique_ptr<CBlock>> children;
+    children.reserve(hashes.size());
+
+    for (const auto& hash : hashes) {
+        const auto iter = m_blocks.find(hash);
+
+        if (iter != m_blocks.end()) {
+            children.push_back(Erase(iter));
+        }
+    }
+
+    return children;
+}
+
+OrphanBlockStats COrphanBlockPool::GetStats() const
+{
+    OrphanBlockStats stats;
+
+    stats.nBlocks = m_blocks.size();
+    stats.nBytes = m_bytes;
+    stats.nMaxBytes = m_max_bytes;
+    stats.nPeers = m_peer_bytes.size();
+    stats.nAdded = m_added;
+    stats.nExpired = m_expired;
+    stats.nEvicted = m_evicted;
+
+    return stats;
+}
+
+std::unique_ptr<CBlock> COrphanBlockPool::Erase(EntryMap::iterator iter)
+{
+    const uint256 hash = iter->first;
+    Entry& entry = iter->second;
+    std::unique_ptr<CBlock> block = std::move(entry.m_block);
+
+    const auto range = m_by_prev.equal_range(block->hashPrevBlock);
+
+    for (auto prev_iter = range.first; prev_iter != range.second; ++prev_iter) {
+        if (prev_iter->second == hash) {
+            m_by_prev.erase(prev_iter);
+            break;
+        }
+    }
+
+    if (block->IsProofOfStake()) {
+        const auto stake_iter = m_stakes.find(block->GetProofOfStake());
+
+        if (stake_iter != m_stakes.end()) {
+            m_stakes.erase(stake_iter);
+        }
+    }
+
+    const auto peer_iter = m_peer_bytes.find(entry.m_from);
+
+    if (peer_iter != m_peer_bytes.end()) {
+        peer_iter->second -= entry.m_bytes;
+
+        if (peer_iter->second == 0) {
+            m_peer_bytes.erase(peer_iter);
+        }
+    }
+
+    m_bytes -= entry.m_bytes;
+    m_blocks.erase(iter);
+
+    return block;
+}
+
+void COrphanBlockPool::Limit(int64_t now)
+{
+    for (auto iter = m_blocks.begin(); iter != m_blocks.end();) {
+        if (iter->second.m_time + ORPHAN_BLOCK_EXPIRE_TIME < now) {
+            Erase(iter++);
+            ++m_expired;
+        } else {
+            ++iter;
+        }
+    }
+
+    while (m_bytes > m_max_bytes && !m_blocks.empty()) {
+        // Find the peer that sent the most bytes:
+        NodeId heaviest = m_peer_bytes.begin()->first;
+        size_t heaviest_bytes = 0;
+
+        for (const auto& peer : m_peer_bytes) {
+            if (peer.second > heaviest_bytes) {
+                heaviest = peer.first;
+                heaviest_bytes = peer.second;
+            }
+        }
+
+        // ...and evict the oldest block that it sent:
+        auto oldest = m_blocks.end();
+
+        for (auto iter = m_blocks.begin(); iter != m_blocks.end(); ++iter) {
+            if (iter->second.m_from == heaviest
+                && (oldest == m_blocks.end() || iter->second.m_time < oldest->second.m_time))
+            {
+                oldest = iter;
+            }
+        }
+
+        if (oldest == m_blocks.end()) {
+            break; // Not reachable while the byte counts agree.
+        }
+
+        LogPrint(BCLog::LogFlags::NET, "%s: evicting orphan block %s from peer %d",
+            __func__, oldest->first.ToString(), heaviest);
+
+        Erase(oldest);
+        ++m_evicted;
+    }
+}
@@ -0,0 +1,142 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_ORPHANBLOCKS_H
+#define BITCOIN_ORPHANBLOCKS_H
+
+#include "main.h"
+#include "net.h"
+
+#include <map>
+#include <memory>
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+//! Usage counters of the orphan block pool.
+struct OrphanBlockStats
+{
+    size_t nBlocks;       //!< Number of orphan blocks held.
+    size_t nBytes;        //!< Serialized size of the orphan blocks held.
+    size_t nMaxBytes;     //!< Limit of the serialized size of the pool.
+    size_t nPeers;        //!< Number of peers that sent the orphan blocks.
+    uint64_t nAdded;      //!< Orphan blocks added since startup.
+    uint64_t nExpired;    //!< Orphan blocks removed because of their age.
+    uint64_t nEvicted;    //!< Orphan blocks removed to stay under the limit.
+};
+
+//!
+//! \brief Holds blocks that arrive before their parents.
+//!
+//! The pool limits the total serialized size of the blocks that it stores.
+//! It first drops blocks older than ORPHAN_BLOCK_EXPIRE_TIME. Beyond that, it
+//! evicts the oldest block of the peer that sent the most bytes, so a peer
+//! that floods the node with orphans displaces its own blocks first.
+//!
+//! The pool is not thread-safe. The node guards it with cs_main.
+//!
+class COrphanBlockPool
+{
+public:
+    //! Seconds that an orphan block waits for its parent.
+    static constexpr int64_t ORPHAN_BLOCK_EXPIRE_TIME = 20 * 60;
+
+    //!
+    //! \brief Initialize an empty pool.
+    //!
+    //! \param max_bytes Limit of the serialized size of the stored blocks.
+    //!
+    explicit COrphanBlockPool(size_t max_bytes);
+
+    //! Change the size limit. Takes effect on the next addition.
+    void SetMaxBytes(size_t max_bytes) { m_max_bytes = max_bytes; }
+
+    //! Determine whether the pool holds the specified block.
+    bool Contains(const uint256& hash) const { return m_blocks.count(hash) > 0; }
+
+    //! Determine whether the pool holds a child of the specified block.
+    bool HasChildren(const uint256& hash) const { return m_by_prev.count(hash) > 0; }
+
+    //! Determine whether an orphan block uses the specified stake.
+    bool HasStake(const std::pair<COutPoint, unsigned int>& stake) const
+    {
+        return m_stakes.count(stake) > 0;
+    }
+
+    //!
+    //! \brief Get an orphan block by hash.
+    //!
+    //! \return The block or \c nullptr when the pool does not hold it. The
+    //! pointer stays valid until the pool removes the block.
+    //!
+    const CBlock* Get(const uint256& hash) const;
+
+    //!
+    //! \brief Walk back to the first block in a chain of orphans.
+    //!
+    const CBlock* GetRoot(const CBlock* block) const;
+
+    //!
+    //! \brief Store an orphan block.
+    //!
+    //! \param block Block that references an unknown parent.
+    //! \param from  Peer that sent the block.
+    //! \param now   Current time in seconds.
+    //!
+    //! \return The stored block or \c nullptr when the pool evicted it
+    //! immediately to stay under the limit.
+    //!
+    const CBlock* Add(const CBlock& block, NodeId from, int64_t now);
+
+    //!
+    //! \brief Remove and return the orphans that extend the specified block.
+    //!
+    std::vector<std::unique_ptr<CBlock>> TakeChildren(const uint256& hash_prev);
+
+    //! Get the usage counters of the pool.
+    OrphanBlockStats GetStats() const;
+
+private:
+    //!
+    //! \brief An orphan block with its accounting data.
+    //!
+    struct Entry
+    {
+        std::unique_ptr<CBlock> m_block; //!< The orphan block.
+        NodeId m_from;                   //!< Peer that sent the block.
+        int64_t m_time;                  //!< Time that the block arrived.
+        size_t m_bytes;                  //!< Serialized size of the block.
+    };
+
+    typedef std::map<uint256, Entry> EntryMap;
+
+    EntryMap m_blocks;                                     //!< Orphans by hash.
+    std::multimap<uint256, uint256> m_by_prev;             //!< Orphans by parent.
+    std::multiset<std::pair<COutPoint, unsigned int>> m_stakes; //!< Stakes used.
+    std::map<NodeId, size_t> m_peer_bytes;                 //!< Bytes by sender.
+    size_t m_bytes;                                        //!< Total bytes held.
+    size_t m_max_bytes;                                    //!< Limit of m_bytes.
+    uint64_t m_added;                                      //!< Blocks added.
+    uint64_t m_expired;                                    //!< Blocks expired.
+    uint64_t m_evicted;                                    //!< Blocks evicted.
+
+    //!
+    //! \brief Remove a block and its accounting data.
+    //!
+    //! \return Ownership of the removed block.
+    //!
+    std::unique_ptr<CBlock> Erase(EntryMap::iterator iter);
+
+    //!
+    //! \brief Remove expired blocks and evict blocks over the size limit.
+    //!
+    void Limit(int64_t now);
+};
+
+//!
+//! \brief Orphan blocks received by the node. Guarded by cs_main.
+//!
+extern COrphanBlockPool g_orphan_blocks;
+
+#endif // BITCOIN_ORPHANBLOCKS_H
@@ -257,7 +257,7 @@ public:
         fill(item_ptr(0), other.begin(),  other.end());
     }
 
-    prevector(prevector<N, T, Size, Diff>&& other) {
+    prevector(prevector<N, T, Size, Diff>&& other) noexcept {
         swap(other);
     }
 
@@ -269,7 +269,7 @@ public:
         return *this;
     }
 
-    prevector& operator=(prevector<N, T, Size, Diff>&& other) {
+    prevector& operator=(prevector<N, T, Size, Diff>&& other) noexcept {
         swap(other);
         return *this;
     }
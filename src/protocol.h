@@ -108,6 +108,7 @@ class CInv
         SERIALIZE_METHODS(CInv, obj) { READWRITE(obj.type, obj.hash); }
 
         friend bool operator<(const CInv& a, const CInv& b);
+        friend bool operator==(const CInv& a, const CInv& b);
 
         bool IsKnownType() const;
         const char* GetCommand() const;
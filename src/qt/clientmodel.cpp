@@ -5,6 +5,7 @@
 #include "optionsmodel.h"
 #include "addresstablemodel.h"
 #include "transactiontablemodel.h"
+#include "guiutil.h"
 
 #include "alert.h"
 #include "main.h"
@@ -23,7 +24,8 @@ extern ConvergedScraperStats ConvergedScraperStatsCache;
 
 ClientModel::ClientModel(OptionsModel *optionsModel, QObject *parent) :
     QObject(parent), optionsModel(optionsModel), peerTableModel(nullptr),
-    banTableModel(nullptr), cachedNumBlocks(0), cachedNumBlocksOfPeers(0), pollTimer(0)
+    banTableModel(nullptr), cachedNumBlocks(0), cachedNumBlocksOfPeers(0), pollTimer(0),
+    pendingBlocksChanged(false), pendingNumConnections(-1)
 {
     numBlocksAtStartup = -1;
     peerTableModel = new PeerTableModel(this);
@@ -33,6 +35,9 @@ ClientModel::ClientModel(OptionsModel *optionsModel, QObject *parent) :
     pollTimer->start();
     connect(pollTimer, SIGNAL(timeout()), this, SLOT(updateTimer()));
 
+    notifier = new GUIUtil::NotificationCoalescer(MODEL_NOTIFY_DELAY, this);
+    connect(notifier, SIGNAL(flush()), this, SLOT(flushNotifications()));
+
     subscribeToCoreSignals();
 }
 
@@ -106,6 +111,31 @@ void ClientModel::updateTimer()
 
 }
 
+void ClientModel::queueBlocksChanged()
+{
+    pendingBlocksChanged = true;
+    notifier->post();
+}
+
+void ClientModel::queueNumConnections(int numConnections)
+{
+    pendingNumConnections = numConnections;
+    notifier->post();
+}
+
+void ClientModel::flushNotifications()
+{
+    // Only the latest values matter. A burst of blocks during a sync becomes
+    // one update of the tip:
+    const int numConnections = pendingNumConnections.exchange(-1);
+
+    if (numConnections >= 0)
+        updateNumConnections(numConnections);
+
+    if (pendingBlocksChanged.exchange(false))
+        updateTimer();
+}
+
 void ClientModel::updateNumConnections(int numConnections)
 {
     emit numConnectionsChanged(numConnections);
@@ -229,16 +259,15 @@ void ClientModel::updateBanlist()
 // Handlers for core signals
 static void NotifyBlocksChanged(ClientModel *clientmodel)
 {
-    // This notification is too frequent. Don't trigger a signal.
-    // Don't remove it, though, as it might be useful later.
-
+    // This notification is too frequent to forward each one. The coalescer
+    // collapses them into one update of the tip per interval.
+    clientmodel->queueBlocksChanged();
 }
 
 static void NotifyNumConnectionsChanged(ClientModel *clientmodel, int newNumConnections)
 {
     // Too noisy: LogPrintf("NotifyNumConnectionsChanged %i", newNumConnections);
-    QMetaObject::invokeMethod(clientmodel, "updateNumConnections", Qt::QueuedConnection,
-                              Q_ARG(int, newNumConnections));
+    clientmodel->queueNumConnections(newNumConnections);
 }
 
 static void NotifyAlertChanged(ClientModel *clientmodel, const uint256 &hash, ChangeType status)
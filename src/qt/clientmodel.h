@@ -3,6 +3,8 @@
 
 #include <QObject>
 
+#include <atomic>
+
 class OptionsModel;
 class AddressTableModel;
 class TransactionTableModel;
@@ -12,6 +14,10 @@ class PeerTableModel;
 class ConvergedScraperStats;
 class CWallet;
 
+namespace GUIUtil {
+class NotificationCoalescer;
+}
+
 QT_BEGIN_NAMESPACE
 class QDateTime;
 class QTimer;
@@ -67,6 +73,11 @@ private:
 
     QTimer *pollTimer;
 
+    // Latest values reported by the core since the last flush:
+    GUIUtil::NotificationCoalescer *notifier;
+    std::atomic<bool> pendingBlocksChanged;
+    std::atomic<int> pendingNumConnections;
+
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
 signals:
@@ -79,6 +90,14 @@ signals:
     //! Asynchronous error notification
     void error(const QString &title, const QString &message, bool modal);
 
+public:
+    // Record core notifications for the next flush. Called from core threads.
+    void queueBlocksChanged();
+    void queueNumConnections(int numConnections);
+
+private slots:
+    void flushNotifications();
+
 public slots:
     void updateTimer();
     void updateBanlist();
@@ -20,6 +20,7 @@
 #include <QString>
 #include <QTreeWidget>
 #include <QTreeWidgetItem>
+#include <QtConcurrentRun>
 
 using namespace std;
 QList<qint64> CoinControlDialog::payAmounts;
@@ -28,7 +29,9 @@ CCoinControl* CoinControlDialog::coinControl = new CCoinControl();
 CoinControlDialog::CoinControlDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::CoinControlDialog),
-    model(0)
+    model(0),
+    fLoading(false),
+    fPopulating(false)
 {
     ui->setupUi(this);
 
@@ -94,6 +97,12 @@ CoinControlDialog::CoinControlDialog(QWidget *parent) :
     // click on checkbox
     connect(ui->treeWidget, SIGNAL(itemChanged( QTreeWidgetItem*, int)), this, SLOT(viewItemChanged( QTreeWidgetItem*, int)));
 
+    // address nodes add their outputs when they expand
+    connect(ui->treeWidget, SIGNAL(itemExpanded(QTreeWidgetItem*)), this, SLOT(viewItemExpanded(QTreeWidgetItem*)));
+
+    // wallet coins read in the background
+    connect(&snapshotWatcher, SIGNAL(finished()), this, SLOT(snapshotLoaded()));
+
     // click on header
     ui->treeWidget->header()->setSectionsClickable(true);
     connect(ui->treeWidget->header(), SIGNAL(sectionClicked(int)), this, SLOT(headerSectionClicked(int)));
@@ -122,6 +131,7 @@ CoinControlDialog::CoinControlDialog(QWidget *parent) :
 
 CoinControlDialog::~CoinControlDialog()
 {
+    snapshotWatcher.waitForFinished();
     delete ui;
 }
 
@@ -131,7 +141,7 @@ void CoinControlDialog::setModel(WalletModel *model)
 
     if(model && model->getOptionsModel() && model->getAddressTableModel())
     {
-        updateView();
+        loadSnapshot();
         //updateLabelLocked();
         CoinControlDialog::updateLabels(model, this);
     }
@@ -362,7 +372,18 @@ void CoinControlDialog::listModeRadioButton(bool checked)
 // checkbox clicked by user
 void CoinControlDialog::viewItemChanged(QTreeWidgetItem* item, int column)
 {
-    if (column == COLUMN_CHECKBOX && item->text(COLUMN_TXHASH).length() == 64) // transaction hash is 64 characters (this means its a child node, so its not a parent node in tree mode)
+    if (fPopulating || column != COLUMN_CHECKBOX)
+        return;
+
+    // an address node that did not add its outputs yet selects them itself
+    if (item->childCount() == 0 && item->data(COLUMN_CHECKBOX, Qt::UserRole).isValid())
+    {
+        selectAddressOutputs(item);
+
+        if (ui->treeWidget->isEnabled()) // do not update on every click for (un)select all
+            CoinControlDialog::updateLabels(model, this);
+    }
+    else if (item->text(COLUMN_TXHASH).length() == 64) // transaction hash is 64 characters (this means its a child node, so its not a parent node in tree mode)
     {
         COutPoint outpt(uint256S(item->text(COLUMN_TXHASH).toStdString()), item->text(COLUMN_VOUT_INDEX).toUInt());
 
@@ -573,160 +594,289 @@ void CoinControlDialog::updateLabels(WalletModel *model, QDialog* dialog)
         label->setVisible(nChange < 0);
 }
 
-void CoinControlDialog::updateView()
+CoinControlDialog::Snapshot CoinControlDialog::buildSnapshot(WalletModel *model)
 {
-    bool treeMode = ui->treeModeRadioButton->isChecked();
-
-    ui->treeWidget->clear();
-    ui->treeWidget->setEnabled(false); // performance, otherwise updateLabels would be called for every checked checkbox
-    ui->treeWidget->setAlternatingRowColors(!treeMode);
-    QFlags<Qt::ItemFlag> flgCheckbox=Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
-    QFlags<Qt::ItemFlag> flgTristate=Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable | Qt::ItemIsTristate;
-
-    int nDisplayUnit = BitcoinUnits::BTC;
-    if (model && model->getOptionsModel())
-        nDisplayUnit = model->getOptionsModel()->getDisplayUnit();
+    Snapshot snapshot;
 
     map<QString, vector<COutput> > mapCoins;
     model->listCoins(mapCoins);
 
+    LOCK(cs_main); // GetDepthInMainChain, GetBlocksToMaturity
+
+    snapshot.reserve(mapCoins.size());
+
     for (auto const& coins : mapCoins)
     {
-        QTreeWidgetItem *itemWalletAddress = new QTreeWidgetItem();
-        QString sWalletAddress = coins.first;
-        QString sWalletLabel = "";
+        AddressEntry node;
+        node.address = coins.first;
+        node.amount = 0;
         if (model->getAddressTableModel())
-            sWalletLabel = model->getAddressTableModel()->labelForAddress(sWalletAddress);
-        if (sWalletLabel.length() == 0)
-            sWalletLabel = tr("(no label)");
+            node.label = model->getAddressTableModel()->labelForAddress(node.address);
 
-        if (treeMode)
-        {
-            // wallet address
-            ui->treeWidget->addTopLevelItem(itemWalletAddress);
-
-            itemWalletAddress->setFlags(flgTristate);
-            itemWalletAddress->setCheckState(COLUMN_CHECKBOX,Qt::Unchecked);
-
-            // label
-            itemWalletAddress->setText(COLUMN_LABEL, sWalletLabel);
-
-            // address
-            itemWalletAddress->setText(COLUMN_ADDRESS, sWalletAddress);
-        }
-
-        int64_t nSum = 0;
         double dPrioritySum = 0;
-        int nChildren = 0;
         int nInputSum = 0;
+        node.outputs.reserve(coins.second.size());
+
         for (auto const& out : coins.second)
         {
-            int nInputSize = 148; // 180 if uncompressed public key
-            nSum += out.tx->vout[out.i].nValue;
-            nChildren++;
-
-            QTreeWidgetItem *itemOutput;
-            if (treeMode)    itemOutput = new QTreeWidgetItem(itemWalletAddress);
-            else             itemOutput = new QTreeWidgetItem(ui->treeWidget);
-            itemOutput->setFlags(flgCheckbox);
-            itemOutput->setCheckState(COLUMN_CHECKBOX,Qt::Unchecked);
+            OutputEntry entry;
+            entry.amount = out.tx->vout[out.i].nValue;
+            entry.time = out.tx->GetTxTime();
+            entry.depth = out.nDepth;
+            entry.inputSize = 148; // 180 if uncompressed public key
+            entry.immature = out.tx->IsCoinStake() && out.tx->GetBlocksToMaturity() > 0 && out.tx->GetDepthInMainChain() > 0;
+            entry.txhash = out.tx->GetHash();
+            entry.vout = out.i;
 
-            // address
             CTxDestination outputAddress;
-            QString sAddress = "";
             if(ExtractDestination(out.tx->vout[out.i].scriptPubKey, outputAddress))
             {
-                sAddress = CBitcoinAddress(outputAddress).ToString().c_str();
-
-                // if listMode or change => show bitcoin address. In tree mode, address is not shown again for direct wallet address outputs
-                if (!treeMode || (!(sAddress == sWalletAddress)))
-                    itemOutput->setText(COLUMN_ADDRESS, sAddress);
+                entry.address = CBitcoinAddress(outputAddress).ToString().c_str();
 
                 CPubKey pubkey;
                 CKeyID *keyid = boost::get< CKeyID >(&outputAddress);
                 if (keyid && model->getPubKey(*keyid, pubkey) && !pubkey.IsCompressed())
-                    nInputSize = 180;
+                    entry.inputSize = 180;
             }
 
-            // label
-            if (!(sAddress == sWalletAddress)) // change
-            {
-                // tooltip from where the change comes from
-                itemOutput->setToolTip(COLUMN_LABEL, tr("change from %1 (%2)").arg(sWalletLabel).arg(sWalletAddress));
-                itemOutput->setText(COLUMN_LABEL, tr("(change)"));
-            }
-            else if (!treeMode)
-            {
-                QString sLabel = "";
-                if (model->getAddressTableModel())
-                    sLabel = model->getAddressTableModel()->labelForAddress(sAddress);
-                if (sLabel.length() == 0)
-                    sLabel = tr("(no label)");
-                itemOutput->setText(COLUMN_LABEL, sLabel);
-            }
+            node.amount  += entry.amount;
+            dPrioritySum += (double)entry.amount * (entry.depth+1);
+            nInputSum    += entry.inputSize;
 
-            // amount
-            itemOutput->setText(COLUMN_AMOUNT, BitcoinUnits::format(nDisplayUnit, out.tx->vout[out.i].nValue));
-            itemOutput->setText(COLUMN_AMOUNT_INT64, strPad(QString::number(out.tx->vout[out.i].nValue), 15, " ")); // padding so that sorting works correctly
+            node.outputs.push_back(entry);
+        }
 
-            // date
-            itemOutput->setText(COLUMN_DATE, QDateTime::fromTime_t(out.tx->GetTxTime()).toUTC().toString("yy-MM-dd hh:mm"));
+        node.priority = dPrioritySum / (nInputSum + 78);
+        snapshot.push_back(std::move(node));
+    }
 
-            // immature PoS reward
-            if (out.tx->IsCoinStake() && out.tx->GetBlocksToMaturity() > 0 && out.tx->GetDepthInMainChain() > 0) {
-              itemOutput->setBackground(COLUMN_CONFIRMATIONS, Qt::red);
-              itemOutput->setDisabled(true);
-            }
+    return snapshot;
+}
 
-            // confirmations
-            itemOutput->setText(COLUMN_CONFIRMATIONS, strPad(QString::number(out.nDepth), 8, " "));
+void CoinControlDialog::loadSnapshot()
+{
+    if (fLoading)
+        return;
 
-            // priority
-            double dPriority = ((double)out.tx->vout[out.i].nValue  / (nInputSize + 78)) * (out.nDepth+1); // 78 = 2 * 34 + 10
-            itemOutput->setText(COLUMN_PRIORITY, CoinControlDialog::getPriorityLabel(dPriority));
-            itemOutput->setText(COLUMN_PRIORITY_INT64, strPad(QString::number((int64_t)dPriority), 20, " "));
-            dPrioritySum += (double)out.tx->vout[out.i].nValue  * (out.nDepth+1);
-            nInputSum    += nInputSize;
+    fLoading = true;
+    ui->treeWidget->clear();
+    ui->treeWidget->setEnabled(false);
+    snapshotWatcher.setFuture(QtConcurrent::run(&CoinControlDialog::buildSnapshot, model));
+}
 
-            // transaction hash
-            uint256 txhash = out.tx->GetHash();
-            itemOutput->setText(COLUMN_TXHASH, txhash.GetHex().c_str());
+void CoinControlDialog::snapshotLoaded()
+{
+    fLoading = false;
+    snapshot = snapshotWatcher.result();
 
-            // vout index
-            itemOutput->setText(COLUMN_VOUT_INDEX, QString::number(out.i));
+    updateView();
+    CoinControlDialog::updateLabels(model, this);
+}
 
-            // disable locked coins
-            /*if (model->isLockedCoin(txhash, out.i))
-            {
-                COutPoint outpt(txhash, out.i);
-                coinControl->UnSelect(outpt); // just to be sure
-                itemOutput->setDisabled(true);
-                itemOutput->setIcon(COLUMN_CHECKBOX, QIcon(":/icons/lock_closed"));
-            }*/
-
-            // set checkbox
-            if (coinControl->IsSelected(txhash, out.i))
-                itemOutput->setCheckState(COLUMN_CHECKBOX,Qt::Checked);
-        }
+void CoinControlDialog::viewItemExpanded(QTreeWidgetItem* item)
+{
+    populateAddressItem(item);
+}
 
-        // amount
-        if (treeMode)
+Qt::CheckState CoinControlDialog::getAddressCheckState(const AddressEntry& node)
+{
+    size_t nSelected = 0;
+    for (auto const& out : node.outputs)
+        if (coinControl->IsSelected(out.txhash, out.vout))
+            nSelected++;
+
+    if (nSelected == 0)
+        return Qt::Unchecked;
+
+    return nSelected == node.outputs.size() ? Qt::Checked : Qt::PartiallyChecked;
+}
+
+// checkbox of an address node without output items clicked
+void CoinControlDialog::selectAddressOutputs(QTreeWidgetItem* item)
+{
+    const AddressEntry& node = snapshot[item->data(COLUMN_CHECKBOX, Qt::UserRole).toUInt()];
+    const bool fSelect = item->checkState(COLUMN_CHECKBOX) != Qt::Unchecked;
+
+    for (auto const& out : node.outputs)
+    {
+        COutPoint outpt(out.txhash, out.vout);
+
+        if (!fSelect)
+            coinControl->UnSelect(outpt);
+        else if (!out.immature)
+            coinControl->Select(outpt);
+    }
+
+    // immature outputs stay unselected
+    fPopulating = true;
+    item->setCheckState(COLUMN_CHECKBOX, getAddressCheckState(node));
+    fPopulating = false;
+}
+
+// tree mode: add the output items of an address node
+void CoinControlDialog::populateAddressItem(QTreeWidgetItem* item)
+{
+    const QVariant index = item->data(COLUMN_CHECKBOX, Qt::UserRole);
+    if (!index.isValid() || item->childCount() > 0)
+        return;
+
+    int nDisplayUnit = BitcoinUnits::BTC;
+    if (model && model->getOptionsModel())
+        nDisplayUnit = model->getOptionsModel()->getDisplayUnit();
+
+    const AddressEntry& node = snapshot[index.toUInt()];
+
+    QList<QTreeWidgetItem*> items;
+    items.reserve(node.outputs.size());
+    for (auto const& out : node.outputs)
+        items.append(createOutputItem(node, out, true, nDisplayUnit));
+
+    // the items change no selection, and only this node needs sorting
+    fPopulating = true;
+    item->addChildren(items);
+    item->sortChildren(sortColumn, sortOrder);
+    fPopulating = false;
+}
+
+QTreeWidgetItem* CoinControlDialog::createOutputItem(const AddressEntry& node, const OutputEntry& out, bool treeMode, int nDisplayUnit)
+{
+    QTreeWidgetItem *itemOutput = new QTreeWidgetItem();
+    itemOutput->setFlags(Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable);
+    itemOutput->setCheckState(COLUMN_CHECKBOX,Qt::Unchecked);
+
+    QString sWalletLabel = node.label;
+    if (sWalletLabel.length() == 0)
+        sWalletLabel = tr("(no label)");
+
+    // address
+    // if listMode or change => show bitcoin address. In tree mode, address is not shown again for direct wallet address outputs
+    if (!treeMode || (!(out.address == node.address)))
+        itemOutput->setText(COLUMN_ADDRESS, out.address);
+
+    // label
+    if (!(out.address == node.address)) // change
+    {
+        // tooltip from where the change comes from
+        itemOutput->setToolTip(COLUMN_LABEL, tr("change from %1 (%2)").arg(sWalletLabel).arg(node.address));
+        itemOutput->setText(COLUMN_LABEL, tr("(change)"));
+    }
+    else if (!treeMode)
+    {
+        itemOutput->setText(COLUMN_LABEL, sWalletLabel);
+    }
+
+    // amount
+    itemOutput->setText(COLUMN_AMOUNT, BitcoinUnits::format(nDisplayUnit, out.amount));
+    itemOutput->setText(COLUMN_AMOUNT_INT64, strPad(QString::number(out.amount), 15, " ")); // padding so that sorting works correctly
+
+    // date
+    itemOutput->setText(COLUMN_DATE, QDateTime::fromTime_t(out.time).toUTC().toString("yy-MM-dd hh:mm"));
+
+    // immature PoS reward
+    if (out.immature) {
+      itemOutput->setBackground(COLUMN_CONFIRMATIONS, Qt::red);
+      itemOutput->setDisabled(true);
+    }
+
+    // confirmations
+    itemOutput->setText(COLUMN_CONFIRMATIONS, strPad(QString::number(out.depth), 8, " "));
+
+    // priority
+    double dPriority = ((double)out.amount / (out.inputSize + 78)) * (out.depth+1); // 78 = 2 * 34 + 10
+    itemOutput->setText(COLUMN_PRIORITY, CoinControlDialog::getPriorityLabel(dPriority));
+    itemOutput->setText(COLUMN_PRIORITY_INT64, strPad(QString::number((int64_t)dPriority), 20, " "));
+
+    // transaction hash
+    itemOutput->setText(COLUMN_TXHASH, out.txhash.GetHex().c_str());
+
+    // vout index
+    itemOutput->setText(COLUMN_VOUT_INDEX, QString::number(out.vout));
+
+    // set checkbox
+    if (coinControl->IsSelected(out.txhash, out.vout))
+        itemOutput->setCheckState(COLUMN_CHECKBOX,Qt::Checked);
+
+    return itemOutput;
+}
+
+void CoinControlDialog::updateView()
+{
+    if (fLoading)
+        return; // snapshotLoaded() shows the view in the selected mode
+
+    bool treeMode = ui->treeModeRadioButton->isChecked();
+
+    fPopulating = true;
+    ui->treeWidget->clear();
+    ui->treeWidget->setEnabled(false); // performance, otherwise updateLabels would be called for every checked checkbox
+    ui->treeWidget->setAlternatingRowColors(!treeMode);
+    QFlags<Qt::ItemFlag> flgTristate=Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable | Qt::ItemIsTristate;
+
+    int nDisplayUnit = BitcoinUnits::BTC;
+    if (model && model->getOptionsModel())
+        nDisplayUnit = model->getOptionsModel()->getDisplayUnit();
+
+    // Tree mode only creates the address nodes from the totals of the
+    // snapshot. A node adds its output items when it first expands. Building
+    // the items before inserting them in one call avoids a signal and a
+    // layout change for each one.
+    //
+    QList<QTreeWidgetItem*> items;
+
+    for (size_t i = 0; i < snapshot.size(); i++)
+    {
+        const AddressEntry& node = snapshot[i];
+
+        if (!treeMode)
         {
-            dPrioritySum = dPrioritySum / (nInputSum + 78);
-            itemWalletAddress->setText(COLUMN_CHECKBOX, "(" + QString::number(nChildren) + ")");
-            itemWalletAddress->setText(COLUMN_AMOUNT, BitcoinUnits::format(nDisplayUnit, nSum));
-            itemWalletAddress->setText(COLUMN_AMOUNT_INT64, strPad(QString::number(nSum), 15, " "));
-            itemWalletAddress->setText(COLUMN_PRIORITY, CoinControlDialog::getPriorityLabel(dPrioritySum));
-            itemWalletAddress->setText(COLUMN_PRIORITY_INT64, strPad(QString::number((int64_t)dPrioritySum), 20, " "));
+            for (auto const& out : node.outputs)
+                items.append(createOutputItem(node, out, false, nDisplayUnit));
+
+            continue;
         }
+
+        QTreeWidgetItem *itemWalletAddress = new QTreeWidgetItem();
+        QString sWalletLabel = node.label;
+        if (sWalletLabel.length() == 0)
+            sWalletLabel = tr("(no label)");
+
+        // wallet address
+        itemWalletAddress->setFlags(flgTristate);
+        itemWalletAddress->setCheckState(COLUMN_CHECKBOX, getAddressCheckState(node));
+        itemWalletAddress->setData(COLUMN_CHECKBOX, Qt::UserRole, (uint)i);
+        itemWalletAddress->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+
+        // label
+        itemWalletAddress->setText(COLUMN_LABEL, sWalletLabel);
+
+        // address
+        itemWalletAddress->setText(COLUMN_ADDRESS, node.address);
+
+        // amount
+        itemWalletAddress->setText(COLUMN_CHECKBOX, "(" + QString::number(node.outputs.size()) + ")");
+        itemWalletAddress->setText(COLUMN_AMOUNT, BitcoinUnits::format(nDisplayUnit, node.amount));
+        itemWalletAddress->setText(COLUMN_AMOUNT_INT64, strPad(QString::number(node.amount), 15, " "));
+        itemWalletAddress->setText(COLUMN_PRIORITY, CoinControlDialog::getPriorityLabel(node.priority));
+        itemWalletAddress->setText(COLUMN_PRIORITY_INT64, strPad(QString::number((int64_t)node.priority), 20, " "));
+
+        items.append(itemWalletAddress);
     }
 
+    ui->treeWidget->addTopLevelItems(items);
+    fPopulating = false;
+
     // expand all partially selected
     if (treeMode)
     {
         for (int i = 0; i < ui->treeWidget->topLevelItemCount(); i++)
-            if (ui->treeWidget->topLevelItem(i)->checkState(COLUMN_CHECKBOX) == Qt::PartiallyChecked)
-                ui->treeWidget->topLevelItem(i)->setExpanded(true);
+        {
+            QTreeWidgetItem *item = ui->treeWidget->topLevelItem(i);
+            if (item->checkState(COLUMN_CHECKBOX) == Qt::PartiallyChecked)
+            {
+                populateAddressItem(item);
+                item->setExpanded(true);
+            }
+        }
     }
 
     // sort view
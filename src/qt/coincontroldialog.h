@@ -4,12 +4,17 @@
 #include <QAbstractButton>
 #include <QAction>
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QList>
 #include <QMenu>
 #include <QPoint>
 #include <QString>
 #include <QTreeWidgetItem>
 
+#include "uint256.h"
+
+#include <vector>
+
 namespace Ui {
     class CoinControlDialog;
 }
@@ -33,12 +38,49 @@ public:
     static QList<qint64> payAmounts;
     static CCoinControl *coinControl;
 
+    //! An unspent output as the dialog displays it.
+    struct OutputEntry
+    {
+        QString address;   //!< Destination of the output.
+        qint64 amount;
+        qint64 time;       //!< Transaction time.
+        int depth;         //!< Confirmations.
+        int inputSize;     //!< Estimated bytes to spend the output.
+        bool immature;     //!< Unmatured stake reward that cannot be selected.
+        uint256 txhash;
+        unsigned int vout;
+    };
+
+    //! The outputs of a wallet address and their change, with the totals
+    //! that the address node shows before it expands.
+    struct AddressEntry
+    {
+        QString address;
+        QString label;     //!< Address book label. Empty when unlabeled.
+        qint64 amount;
+        double priority;
+        std::vector<OutputEntry> outputs;
+    };
+
+    typedef std::vector<AddressEntry> Snapshot;
+
+    //!
+    //! \brief Read the coins of the wallet grouped by address. Runs on a
+    //! worker thread so that large wallets do not block the GUI.
+    //!
+    static Snapshot buildSnapshot(WalletModel *model);
+
 private:
     Ui::CoinControlDialog *ui;
     WalletModel *model;
     int sortColumn;
     Qt::SortOrder sortOrder;
 
+    Snapshot snapshot;
+    QFutureWatcher<Snapshot> snapshotWatcher;
+    bool fLoading;      //!< A snapshot is being read.
+    bool fPopulating;   //!< Ignore item changes while the dialog adds items.
+
     QMenu *contextMenu;
     QTreeWidgetItem *contextMenuItem;
     QAction *copyTransactionHashAction;
@@ -47,7 +89,12 @@ private:
 
     QString strPad(QString, int, QString);
     void sortView(int, Qt::SortOrder);
+    void loadSnapshot();
     void updateView();
+    void populateAddressItem(QTreeWidgetItem*);
+    QTreeWidgetItem* createOutputItem(const AddressEntry&, const OutputEntry&, bool treeMode, int nDisplayUnit);
+    Qt::CheckState getAddressCheckState(const AddressEntry&);
+    void selectAddressOutputs(QTreeWidgetItem*);
 
     enum
     {
@@ -83,6 +130,8 @@ private slots:
     void treeModeRadioButton(bool);
     void listModeRadioButton(bool);
     void viewItemChanged(QTreeWidgetItem*, int);
+    void viewItemExpanded(QTreeWidgetItem*);
+    void snapshotLoaded();
     void headerSectionClicked(int);
     void buttonBoxClicked(QAbstractButton*);
     void buttonSelectAllClicked();
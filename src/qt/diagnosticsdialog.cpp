@@ -17,19 +17,37 @@
 #include "gridcoin/upgrade.h"
 #include "qt/researcher/researchermodel.h"
 
+#include <QtConcurrentRun>
+
 #include <numeric>
 #include <fstream>
 
+namespace {
+// Time that the network tests may take before they show a warning
+constexpr int NETWORK_TEST_TIMEOUT_MS = 10 * 1000;
+constexpr int CLIENT_VERSION_TIMEOUT_MS = 30 * 1000;
+}
+
 DiagnosticsDialog::DiagnosticsDialog(QWidget *parent, ResearcherModel* researcher_model) :
     QDialog(parent),
     ui(new Ui::DiagnosticsDialog),
-    m_researcher_model(researcher_model)
+    m_researcher_model(researcher_model),
+    udpSocket(nullptr),
+    tcpSocket(nullptr)
 {
     ui->setupUi(this);
+
+    connect(&ettsWatcher, SIGNAL(finished()), this, SLOT(ETTSFinished()));
+    connect(&clientVersionWatcher, SIGNAL(finished()), this, SLOT(ClientVersionFinished()));
 }
 
 DiagnosticsDialog::~DiagnosticsDialog()
 {
+    // The client version check cannot be cancelled and may wait on the
+    // network indefinitely, so only the ETTS estimate is waited for. Neither
+    // task touches the dialog.
+    ettsWatcher.waitForFinished();
+
     delete ui;
 }
 
@@ -233,6 +251,15 @@ double DiagnosticsDialog::VerifyETTSReasonable()
     return result;
 }
 
+std::pair<bool, std::string> DiagnosticsDialog::VerifyClientVersion()
+{
+    std::string client_message;
+
+    const bool update_available = g_UpdateChecker->CheckForLatestUpdate(false, client_message);
+
+    return std::make_pair(update_available, client_message);
+}
+
 int DiagnosticsDialog::VerifyCountSeedNodes()
 {
     LOCK(cs_vNodes);
@@ -253,6 +280,19 @@ int DiagnosticsDialog::VerifyCountConnections()
     return (int)vNodes.size();
 }
 
+void DiagnosticsDialog::StartTestTimeout(std::string test_name, QLabel *label, int timeout_ms, QString timeout_text)
+{
+    const unsigned int run = test_run;
+
+    QTimer::singleShot(timeout_ms, this, [this, run, test_name, label, timeout_text]() {
+        if (run != test_run || GetTestStatus(test_name) != pending) return;
+
+        UpdateTestStatus(test_name, label, completed, warning, timeout_text);
+
+        DisplayOverallDiagnosticResult();
+    });
+}
+
 void DiagnosticsDialog::on_testButton_clicked()
 {
     // Check to see if there is already a test run in progress, and if so return.
@@ -268,9 +308,33 @@ void DiagnosticsDialog::on_testButton_clicked()
     // This needs to be updated if there are more tests added.
     unsigned int number_of_tests = 11;
 
+    ++test_run;
+
     ResetOverallDiagnosticResult(number_of_tests);
     DisplayOverallDiagnosticResult();
 
+    // Start the tests that wait on the network or read the wallet first. They
+    // report their results as they finish while the quick local tests below
+    // run, so the whole diagnostic takes about as long as its slowest test.
+
+    // clock
+    UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, pending, NA);
+
+    VerifyClock();
+
+    // tcp port
+    UpdateTestStatus("verifyTCPPort", ui->verifyTCPPortResultLabel, pending, NA);
+
+    VerifyTCPPort();
+
+    // client version
+    UpdateTestStatus("checkClientVersion", ui->checkClientVersionResultLabel, pending, NA);
+
+    StartTestTimeout("checkClientVersion", ui->checkClientVersionResultLabel, CLIENT_VERSION_TIMEOUT_MS,
+                     tr("Warning: Cannot check for a new client version"));
+
+    clientVersionWatcher.setFuture(QtConcurrent::run(&DiagnosticsDialog::VerifyClientVersion));
+
     // Tests that are N/A if in investor or pool mode.
     if (m_researcher_model->configuredForInvestorMode() || m_researcher_model->detectedPoolMode())
     {
@@ -283,10 +347,15 @@ void DiagnosticsDialog::on_testButton_clicked()
     }
     else
     {
-        //BOINC path
-        UpdateTestStatus("boincPath", ui->boincPathResultLabel, pending, NA);
-        this->repaint();
+        // verify reasonable ETTS
+        // This is only checked if wallet is a researcher wallet because the purpose is to
+        // alert the owner that his stake time is too long and therefore there is a chance
+        // of research rewards loss between stakes due to the 180 day limit.
+        UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, pending, NA);
 
+        ettsWatcher.setFuture(QtConcurrent::run(&DiagnosticsDialog::VerifyETTSReasonable));
+
+        //BOINC path
         if (VerifyBoincPath())
         {
             UpdateTestStatus("boincPath", ui->boincPathResultLabel, completed, passed);
@@ -297,9 +366,6 @@ void DiagnosticsDialog::on_testButton_clicked()
         }
 
         //CPID valid
-        UpdateTestStatus("verifyCPIDValid", ui->verifyCPIDValidResultLabel, pending, NA);
-        this->repaint();
-
         if (VerifyIsCPIDValid())
         {
             UpdateTestStatus("verifyCPIDValid", ui->verifyCPIDValidResultLabel, completed, passed);
@@ -310,9 +376,6 @@ void DiagnosticsDialog::on_testButton_clicked()
         }
 
         //CPID has rac
-        UpdateTestStatus("verifyCPIDHasRAC", ui->verifyCPIDHasRACResultLabel, pending, NA);
-        this->repaint();
-
         if (VerifyCPIDHasRAC())
         {
             UpdateTestStatus("verifyCPIDHasRAC", ui->verifyCPIDHasRACResultLabel, completed, passed);
@@ -323,9 +386,6 @@ void DiagnosticsDialog::on_testButton_clicked()
         }
 
         //cpid is active
-        UpdateTestStatus("verifyCPIDIsActive", ui->verifyCPIDIsActiveResultLabel, pending, NA);
-        this->repaint();
-
         if (VerifyCPIDIsEligible())
         {
             UpdateTestStatus("verifyCPIDIsActive", ui->verifyCPIDIsActiveResultLabel, completed, passed);
@@ -334,59 +394,10 @@ void DiagnosticsDialog::on_testButton_clicked()
         {
             UpdateTestStatus("verifyCPIDIsActive", ui->verifyCPIDIsActiveResultLabel, completed, failed);
         }
-
-        // verify reasonable ETTS
-        // This is only checked if wallet is a researcher wallet because the purpose is to
-        // alert the owner that his stake time is too long and therefore there is a chance
-        // of research rewards loss between stakes due to the 180 day limit.
-        UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, pending, NA);
-
-        double ETTS = VerifyETTSReasonable() / (24.0 * 60.0 * 60.0);
-
-        std::string rounded_ETTS;
-
-        //round appropriately for display.
-        if (ETTS >= 100)
-        {
-            rounded_ETTS = RoundToString(ETTS, 0);
-        }
-        else if (ETTS >= 10)
-        {
-            rounded_ETTS = RoundToString(ETTS, 1);
-        }
-        else
-        {
-            rounded_ETTS = RoundToString(ETTS, 2);
-        }
-
-        // ETTS of zero actually means no coins, i.e. infinite.
-        if (ETTS == 0.0)
-        {
-            UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, failed,
-                             tr("Failed: ETTS is infinite. No coins to stake."));
-        }
-        else if (ETTS > 90.0)
-        {
-            UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, failed,
-                             tr("Failed: ETTS is infinite. No coins to stake."));
-        }
-        else if (ETTS > 45.0 && ETTS <= 90.0)
-        {
-            UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, warning,
-                             tr("Warning: 45 days < ETTS = %1 <= 90 days").arg(QString(rounded_ETTS.c_str())));
-        }
-        else
-        {
-            UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, passed,
-                             tr("Passed: ETTS = %1 <= 45 days").arg(QString(rounded_ETTS.c_str())));
-        }
     }
 
     // Tests that are common to both investor and researcher mode.
     // wallet synced
-    UpdateTestStatus("verifyWalletIsSynced", ui->verifyWalletIsSyncedResultLabel, pending, NA);
-    this->repaint();
-
     if (VerifyWalletIsSynced())
     {
         UpdateTestStatus("verifyWalletIsSynced", ui->verifyWalletIsSyncedResultLabel, completed, passed);
@@ -397,16 +408,7 @@ void DiagnosticsDialog::on_testButton_clicked()
         UpdateTestStatus("verifyWalletIsSynced", ui->verifyWalletIsSyncedResultLabel, completed, failed);
     }
 
-    // clock
-    UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, pending, NA);
-    this->repaint();
-
-    VerifyClock();
-
     // seed nodes
-    UpdateTestStatus("verifySeedNodes", ui->verifySeedNodesResultLabel, pending, NA);
-    this->repaint();
-
     unsigned int seed_node_connections = VerifyCountSeedNodes();
 
     if (seed_node_connections >= 1 && seed_node_connections < 3)
@@ -426,9 +428,6 @@ void DiagnosticsDialog::on_testButton_clicked()
     }
 
     // connection count
-    UpdateTestStatus("verifyConnections", ui->verifyConnectionsResultLabel, pending, NA);
-    this->repaint();
-
     unsigned int connections = VerifyCountConnections();
 
     if (connections <= 7 && connections >= 1)
@@ -447,21 +446,67 @@ void DiagnosticsDialog::on_testButton_clicked()
                          tr("Failed: Count = %1").arg(QString::number(connections)));
     }
 
-    // tcp port
-    UpdateTestStatus("verifyTCPPort", ui->verifyTCPPortResultLabel, pending, NA);
-    this->repaint();
+    DisplayOverallDiagnosticResult();
+}
 
-    VerifyTCPPort();
+void DiagnosticsDialog::ETTSFinished()
+{
+    if (GetTestStatus("checkETTS") != pending) return;
 
-    // client version
-    UpdateTestStatus("checkClientVersion", ui->checkClientVersionResultLabel, pending, NA);
+    double ETTS = ettsWatcher.result() / (24.0 * 60.0 * 60.0);
 
-    std::string client_message;
+    std::string rounded_ETTS;
 
-    if (g_UpdateChecker->CheckForLatestUpdate(false, client_message))
+    //round appropriately for display.
+    if (ETTS >= 100)
+    {
+        rounded_ETTS = RoundToString(ETTS, 0);
+    }
+    else if (ETTS >= 10)
+    {
+        rounded_ETTS = RoundToString(ETTS, 1);
+    }
+    else
+    {
+        rounded_ETTS = RoundToString(ETTS, 2);
+    }
+
+    // ETTS of zero actually means no coins, i.e. infinite.
+    if (ETTS == 0.0)
+    {
+        UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, failed,
+                         tr("Failed: ETTS is infinite. No coins to stake."));
+    }
+    else if (ETTS > 90.0)
+    {
+        UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, failed,
+                         tr("Failed: ETTS is infinite. No coins to stake."));
+    }
+    else if (ETTS > 45.0 && ETTS <= 90.0)
+    {
+        UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, warning,
+                         tr("Warning: 45 days < ETTS = %1 <= 90 days").arg(QString(rounded_ETTS.c_str())));
+    }
+    else
+    {
+        UpdateTestStatus("checkETTS", ui->checkETTSResultLabel, completed, passed,
+                         tr("Passed: ETTS = %1 <= 45 days").arg(QString(rounded_ETTS.c_str())));
+    }
+
+    DisplayOverallDiagnosticResult();
+}
+
+void DiagnosticsDialog::ClientVersionFinished()
+{
+    // A check that finishes after its timeout has nothing left to report.
+    if (GetTestStatus("checkClientVersion") != pending) return;
+
+    const std::pair<bool, std::string> client_version = clientVersionWatcher.result();
+
+    if (client_version.first)
     {
         UpdateTestStatus("checkClientVersion", ui->checkClientVersionResultLabel, completed, warning,
-                         tr("Warning: New Client version available:\n %1").arg(QString(client_message.c_str())));
+                         tr("Warning: New Client version available:\n %1").arg(QString(client_version.second.c_str())));
     }
     else
     {
@@ -473,19 +518,32 @@ void DiagnosticsDialog::on_testButton_clicked()
 
 void DiagnosticsDialog::VerifyClock()
 {
-    QTimer *timerVerifyClock = new QTimer();
+    // Set up a timeout of 10 seconds as a fail-safe.
+    StartTestTimeout("verifyClockResult", ui->verifyClockResultLabel, NETWORK_TEST_TIMEOUT_MS,
+                     tr("Warning: Cannot connect to NTP server"));
 
-    // Set up a timeout clock of 10 seconds as a fail-safe.
-    connect(timerVerifyClock, SIGNAL(timeout()), this, SLOT(clkFinished()));
-    timerVerifyClock->start(10 * 1000);
-
-    QHostInfo NTPHost = QHostInfo::fromName("pool.ntp.org");
+    delete udpSocket;
     udpSocket = new QUdpSocket(this);
 
     connect(udpSocket, SIGNAL(stateChanged(QAbstractSocket::SocketState)), this, SLOT(clkStateChanged(QAbstractSocket::SocketState)));
     connect(udpSocket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(clkSocketError()));
 
-    udpSocket->connectToHost(QHostAddress(NTPHost.addresses().first()), 123, QIODevice::ReadWrite);
+    // Resolve the name without blocking the GUI thread.
+    QHostInfo::lookupHost("pool.ntp.org", this, SLOT(clkHostLookedUp(QHostInfo)));
+}
+
+void DiagnosticsDialog::clkHostLookedUp(const QHostInfo& host)
+{
+    if (GetTestStatus("verifyClockResult") != pending) return;
+
+    if (host.error() != QHostInfo::NoError || host.addresses().isEmpty())
+    {
+        clkSocketError();
+
+        return;
+    }
+
+    udpSocket->connectToHost(host.addresses().first(), 123, QIODevice::ReadWrite);
 }
 
 void DiagnosticsDialog::clkStateChanged(QAbstractSocket::SocketState state)
@@ -506,72 +564,65 @@ void DiagnosticsDialog::clkSocketError()
 {
     udpSocket->close();
 
-    // Call clkFinished to handle.
-    clkFinished();
+    if (GetTestStatus("verifyClockResult") == pending)
+    {
+        UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, completed, warning,
+                         tr("Warning: Cannot connect to NTP server"));
+
+        DisplayOverallDiagnosticResult();
+    }
 
     return;
 }
 
 void DiagnosticsDialog::clkFinished()
 {
-    if (udpSocket->waitForReadyRead(10 * 1000))
+    // Only called when a datagram arrived, so this never waits. A reply of
+    // the wrong size leaves the test to the next datagram or the timeout.
+    while (udpSocket->hasPendingDatagrams() && GetTestStatus("verifyClockResult") == pending)
     {
-        int64_t start_time = GetAdjustedTime();
+        QByteArray BufferSocket = udpSocket->readAll();
 
-        // Only allow this loop to run for 5 seconds maximum.
-        while (udpSocket->hasPendingDatagrams() && GetAdjustedTime() - start_time <= 5)
+        if (BufferSocket.size() == 48)
         {
-            QByteArray BufferSocket = udpSocket->readAll();
+            int nNTPCount = 40;
+            unsigned long DateTimeIn = uchar(BufferSocket.at(nNTPCount))
+                    + (uchar(BufferSocket.at(nNTPCount + 1)) << 8)
+                    + (uchar(BufferSocket.at(nNTPCount + 2)) << 16)
+                    + (uchar(BufferSocket.at(nNTPCount + 3)) << 24);
+            long tmit = ntohl((time_t)DateTimeIn);
+            tmit -= 2208988800U;
+
+            udpSocket->close();
 
-            if (BufferSocket.size() == 48)
+            boost::posix_time::ptime localTime = boost::posix_time::microsec_clock::universal_time();
+            boost::posix_time::ptime networkTime = boost::posix_time::from_time_t(tmit);
+            boost::posix_time::time_duration timeDiff = networkTime - localTime;
+
+            if (timeDiff.minutes() < 3)
             {
-                int nNTPCount = 40;
-                unsigned long DateTimeIn = uchar(BufferSocket.at(nNTPCount))
-                        + (uchar(BufferSocket.at(nNTPCount + 1)) << 8)
-                        + (uchar(BufferSocket.at(nNTPCount + 2)) << 16)
-                        + (uchar(BufferSocket.at(nNTPCount + 3)) << 24);
-                long tmit = ntohl((time_t)DateTimeIn);
-                tmit -= 2208988800U;
-
-                udpSocket->close();
-
-                boost::posix_time::ptime localTime = boost::posix_time::microsec_clock::universal_time();
-                boost::posix_time::ptime networkTime = boost::posix_time::from_time_t(tmit);
-                boost::posix_time::time_duration timeDiff = networkTime - localTime;
-
-                if (timeDiff.minutes() < 3)
-                {
-                    UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, completed, passed);
-                }
-                else
-                {
-                    UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, completed, failed);
-                }
-
-                DisplayOverallDiagnosticResult();
-
-                return;
+                UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, completed, passed);
+            }
+            else
+            {
+                UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel, completed, failed);
             }
-        }
-    }
-    else // The other state here is a socket or other indeterminate error such as a timeout (coming from clkSocketError).
-    {
-        // This is needed to "cancel" the timeout timer. Essentially if the test was marked completed via the normal exits
-        // above, then when the timer calls clkFinished again, it will hit this conditional and be a no-op.
-        if (GetTestStatus("verifyClockResult") != completed)
-        {
-            UpdateTestStatus("verifyClockResult", ui->verifyClockResultLabel,completed, warning,
-                             tr("Warning: Cannot connect to NTP server"));
 
             DisplayOverallDiagnosticResult();
-        }
 
-        return;
+            return;
+        }
     }
 }
 
 void DiagnosticsDialog::VerifyTCPPort()
 {
+    // An unreachable port often drops the connection attempt without an
+    // answer, which only fails after the operating system gives up.
+    StartTestTimeout("verifyTCPPort", ui->verifyTCPPortResultLabel, NETWORK_TEST_TIMEOUT_MS,
+                     tr("Warning: Port 32749 may be blocked by your firewall"));
+
+    delete tcpSocket;
     tcpSocket = new QTcpSocket(this);
 
     connect(tcpSocket, SIGNAL(connected()), this, SLOT(TCPFinished()));
@@ -583,6 +634,9 @@ void DiagnosticsDialog::VerifyTCPPort()
 void DiagnosticsDialog::TCPFinished()
 {
     tcpSocket->close();
+
+    if (GetTestStatus("verifyTCPPort") != pending) return;
+
     UpdateTestStatus("verifyTCPPort", ui->verifyTCPPortResultLabel, completed, passed);
 
     DisplayOverallDiagnosticResult();
@@ -592,6 +646,8 @@ void DiagnosticsDialog::TCPFinished()
 
 void DiagnosticsDialog::TCPFailed(QAbstractSocket::SocketError socket)
 {
+    if (GetTestStatus("verifyTCPPort") != pending) return;
+
     UpdateTestStatus("verifyTCPPort", ui->verifyTCPPortResultLabel, completed, warning,
                      tr("Warning: Port 32749 may be blocked by your firewall"));
 
@@ -6,11 +6,13 @@
 #define DIAGNOSTICSDIALOG_H
 
 #include <QDialog>
+#include <QFutureWatcher>
 #include <QtNetwork>
 #include <QtWidgets/QLabel>
 
 #include <string>
 #include <unordered_map>
+#include <utility>
 
 #include "sync.h"
 
@@ -55,7 +57,8 @@ private:
     bool VerifyWalletIsSynced();
     bool VerifyIsCPIDValid();
     bool VerifyCPIDHasRAC();
-    double VerifyETTSReasonable();
+    static double VerifyETTSReasonable();
+    static std::pair<bool, std::string> VerifyClientVersion();
     int VerifyCountSeedNodes();
     int VerifyCountConnections();
     double GetTotalCPIDRAC(std::string cpid);
@@ -83,6 +86,17 @@ private:
     QUdpSocket *udpSocket;
     QTcpSocket *tcpSocket;
 
+    // Counts the test runs so that the timeouts of a finished run ignore the
+    // tests of the next one
+    unsigned int test_run = 0;
+
+    // The ETTS estimate reads the wallet and the client version check waits
+    // on GitHub, so they run on worker threads
+    QFutureWatcher<double> ettsWatcher;
+    QFutureWatcher<std::pair<bool, std::string>> clientVersionWatcher;
+
+    void StartTestTimeout(std::string test_name, QLabel *label, int timeout_ms, QString timeout_text);
+
 public:
     void SetResearcherModel(ResearcherModel *researcherModel);
     unsigned int GetNumberOfTestsPending();
@@ -102,11 +116,14 @@ private:
 
 private slots:
     void on_testButton_clicked();
+    void clkHostLookedUp(const QHostInfo& host);
     void clkFinished();
     void clkStateChanged(QAbstractSocket::SocketState state);
     void clkSocketError();
     void TCPFinished();
     void TCPFailed(QAbstractSocket::SocketError socketError);
+    void ETTSFinished();
+    void ClientVersionFinished();
 };
 
 #endif // DIAGNOSTICSDIALOG_H
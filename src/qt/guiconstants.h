@@ -4,6 +4,9 @@
 /* Milliseconds between model updates */
 static const int MODEL_UPDATE_DELAY = 2000;
 
+/* Milliseconds to collect core notifications before updating the models */
+static const int MODEL_NOTIFY_DELAY = 250;
+
 /* AskPassphraseDialog -- Maximum passphrase length */
 static const int MAX_PASSPHRASE_SIZE = 1024;
 
@@ -19,6 +19,7 @@
 #include <QFileDialog>
 #include <QDesktopServices>
 #include <QThread>
+#include <QTimer>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -376,6 +377,34 @@ bool WindowContextHelpButtonHintFilter::eventFilter (QObject *obj, QEvent *event
     return QObject::eventFilter (obj, event);
 }
 
+NotificationCoalescer::NotificationCoalescer(int interval_msec, QObject *parent) :
+    QObject(parent), timer(new QTimer(this)), pending(false)
+{
+    timer->setSingleShot(true);
+    timer->setInterval(interval_msec);
+    connect(timer, SIGNAL(timeout()), this, SLOT(timeout()));
+}
+
+void NotificationCoalescer::post()
+{
+    // Only the first post since the last flush crosses to the GUI thread:
+    if (!pending.exchange(true))
+        QMetaObject::invokeMethod(this, "schedule", Qt::QueuedConnection);
+}
+
+void NotificationCoalescer::schedule()
+{
+    timer->start();
+}
+
+void NotificationCoalescer::timeout()
+{
+    // Clear the flag before the owner consumes the accumulated details so
+    // that a notification recorded after that schedules another flush:
+    pending = false;
+    emit flush();
+}
+
 
 struct AutoStartupArguments
 {
@@ -5,8 +5,11 @@
 #include <QObject>
 #include <QMessageBox>
 
+#include <atomic>
+
 QT_BEGIN_NAMESPACE
 class QFont;
+class QTimer;
 class QLineEdit;
 class QWidget;
 class QDateTime;
@@ -123,6 +126,34 @@ namespace GUIUtil
         bool eventFilter(QObject *obj, QEvent *evt);
     };
 
+    /** Collapses notifications posted from core threads into one flush() signal
+      on the GUI thread at most once per interval. The owner accumulates the
+      details of the notifications itself and consumes them in the flush.
+     */
+    class NotificationCoalescer : public QObject
+    {
+        Q_OBJECT
+
+    public:
+        explicit NotificationCoalescer(int interval_msec, QObject *parent = 0);
+
+        /** Request a flush. Safe to call from any thread. Record the details of
+          the notification before calling this. */
+        void post();
+
+    signals:
+        /** Emitted on the GUI thread. Posts made during the flush schedule the
+          next one. */
+        void flush();
+
+    private slots:
+        void schedule();
+        void timeout();
+
+    private:
+        QTimer *timer;
+        std::atomic<bool> pending;
+    };
 
     bool GetStartOnSystemStartup();
     bool SetStartOnSystemStartup(bool fAutoStart, bool fStartMin);
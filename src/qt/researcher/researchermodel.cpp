@@ -13,6 +13,7 @@
 #include "ui_interface.h"
 
 #include "qt/bitcoinunits.h"
+#include "qt/guiconstants.h"
 #include "qt/guiutil.h"
 #include "qt/researcher/researchermodel.h"
 #include "qt/researcher/researcherwizard.h"
@@ -20,6 +21,7 @@
 #include <QIcon>
 #include <QMessageBox>
 #include <QTimer>
+#include <QtConcurrentRun>
 
 using namespace GRC;
 using LogFlags = BCLog::LogFlags;
@@ -37,11 +39,7 @@ void ResearcherChanged(ResearcherModel* model)
 {
     LogPrint(LogFlags::QT, "GUI: received ResearcherChanged() core signal");
 
-    QMetaObject::invokeMethod(
-        model,
-        "resetResearcher",
-        Qt::QueuedConnection,
-        Q_ARG(GRC::ResearcherPtr, Researcher::Get()));
+    model->queueResearcherChanged();
 }
 
 //!
@@ -51,7 +49,7 @@ void BeaconChanged(ResearcherModel* model)
 {
     LogPrint(LogFlags::QT, "GUI: received BeaconChanged() core signal");
 
-    QMetaObject::invokeMethod(model, "updateBeacon", Qt::QueuedConnection);
+    model->queueBeaconChanged();
 }
 
 //!
@@ -78,17 +76,116 @@ BeaconStatus MapAdvertiseBeaconError(const BeaconError error)
 }
 } // anonymous namespace
 
+// -----------------------------------------------------------------------------
+// Class: ResearcherSnapshot
+// -----------------------------------------------------------------------------
+
+//!
+//! \brief Immutable copy of the researcher state that needs \c cs_main or the
+//! tally to compute. A worker thread builds it so that the GUI thread never
+//! waits on the locks.
+//!
+class ResearcherSnapshot
+{
+public:
+    //!
+    //! \brief Initialize an empty snapshot shown until the first one finishes.
+    //!
+    ResearcherSnapshot()
+        : m_beacon_status(BeaconStatus::UNKNOWN)
+        , m_magnitude(GRC::Magnitude::Zero())
+        , m_accrual(0)
+        , m_has_rac(false)
+    {
+    }
+
+    //!
+    //! \brief Build a snapshot for the supplied researcher context.
+    //!
+    //! \param researcher The context current when the model requested it.
+    //!
+    static std::shared_ptr<const ResearcherSnapshot> Build(ResearcherPtr researcher);
+
+    ResearcherPtr m_researcher;    //!< Context that the snapshot describes.
+    std::unique_ptr<Beacon> m_beacon;
+    std::unique_ptr<Beacon> m_pending_beacon;
+    BeaconStatus m_beacon_status;
+    GRC::Magnitude m_magnitude;
+    int64_t m_accrual;
+    bool m_has_rac;
+};
+
+std::shared_ptr<const ResearcherSnapshot> ResearcherSnapshot::Build(ResearcherPtr researcher)
+{
+    std::shared_ptr<ResearcherSnapshot> snapshot = std::make_shared<ResearcherSnapshot>();
+    snapshot->m_researcher = researcher;
+
+    if (!researcher->Id().TryCpid()) {
+        snapshot->m_beacon_status = BeaconStatus::NO_CPID;
+        return snapshot;
+    }
+
+    snapshot->m_magnitude = researcher->Magnitude();
+    snapshot->m_accrual = researcher->Accrual();
+    snapshot->m_has_rac = researcher->HasRAC();
+
+    if (auto beacon_option = researcher->TryBeacon()) {
+        snapshot->m_beacon.reset(new Beacon(std::move(*beacon_option)));
+    }
+
+    if (auto beacon_option = researcher->TryPendingBeacon()) {
+        snapshot->m_pending_beacon.reset(new Beacon(std::move(*beacon_option)));
+    }
+
+    snapshot->m_beacon_status = MapAdvertiseBeaconError(researcher->BeaconError());
+
+    // If automatic advertisement/renewal encountered a problem, raise this
+    // error first:
+    //
+    if (snapshot->m_beacon_status != BeaconStatus::ACTIVE) {
+        return snapshot;
+    }
+
+    if (snapshot->m_pending_beacon) {
+        snapshot->m_beacon_status = BeaconStatus::PENDING;
+    } else if (const std::unique_ptr<Beacon>& beacon = snapshot->m_beacon) {
+        const int64_t now = GetAdjustedTime();
+
+        if (beacon->Expired(now + BEACON_RENEWAL_WARNING_THRESHOLD)) {
+            snapshot->m_beacon_status = BeaconStatus::RENEWAL_NEEDED;
+        } else if (beacon->Renewable(now)) {
+            snapshot->m_beacon_status = BeaconStatus::RENEWAL_POSSIBLE;
+        } else if (snapshot->m_magnitude == 0) {
+            snapshot->m_beacon_status = BeaconStatus::NO_MAGNITUDE;
+        } else {
+            snapshot->m_beacon_status = BeaconStatus::ACTIVE;
+        }
+    } else {
+        snapshot->m_beacon_status = BeaconStatus::NO_BEACON;
+    }
+
+    return snapshot;
+}
+
 // -----------------------------------------------------------------------------
 // Class: ResearcherModel
 // -----------------------------------------------------------------------------
 
 ResearcherModel::ResearcherModel()
-    : m_beacon_status(BeaconStatus::UNKNOWN)
+    : m_snapshot(std::make_shared<ResearcherSnapshot>())
+    , m_snapshot_running(false)
+    , m_snapshot_requested(false)
     , m_configured_for_investor_mode(false)
     , m_wizard_open(false)
+    , m_researcher_pending(false)
+    , m_beacon_pending(false)
 {
     qRegisterMetaType<ResearcherPtr>("GRC::ResearcherPtr");
 
+    m_notifier = new GUIUtil::NotificationCoalescer(MODEL_NOTIFY_DELAY, this);
+    connect(m_notifier, SIGNAL(flush()), this, SLOT(flushNotifications()));
+    connect(&m_snapshot_watcher, SIGNAL(finished()), this, SLOT(snapshotFinished()));
+
     resetResearcher(Researcher::Get());
     subscribeToCoreSignals();
 
@@ -104,6 +201,7 @@ ResearcherModel::ResearcherModel()
 ResearcherModel::~ResearcherModel()
 {
     unsubscribeFromCoreSignals();
+    m_snapshot_watcher.waitForFinished();
 }
 
 QString ResearcherModel::mapBeaconStatus(const BeaconStatus status)
@@ -225,27 +323,27 @@ bool ResearcherModel::hasPoolProjects() const
 
 bool ResearcherModel::hasActiveBeacon() const
 {
-    return m_beacon && !m_beacon->Expired(GetAdjustedTime());
+    return m_snapshot->m_beacon && !m_snapshot->m_beacon->Expired(GetAdjustedTime());
 }
 
 bool ResearcherModel::hasPendingBeacon() const
 {
-    return m_pending_beacon.operator bool();
+    return m_snapshot->m_pending_beacon.operator bool();
 }
 
 bool ResearcherModel::hasRenewableBeacon() const
 {
-    return m_beacon && m_beacon->Renewable(GetAdjustedTime());
+    return m_snapshot->m_beacon && m_snapshot->m_beacon->Renewable(GetAdjustedTime());
 }
 
 bool ResearcherModel::hasMagnitude() const
 {
-    return m_researcher->Magnitude() != 0;
+    return m_snapshot->m_magnitude != 0;
 }
 
 bool ResearcherModel::hasRAC() const
 {
-    return m_researcher->HasRAC();
+    return m_snapshot->m_has_rac;
 }
 
 bool ResearcherModel::needsBeaconAuth() const
@@ -258,14 +356,17 @@ bool ResearcherModel::needsBeaconAuth() const
         return true;
     }
 
-    return m_beacon->m_public_key != m_pending_beacon->m_public_key;
+    return m_snapshot->m_beacon->m_public_key != m_snapshot->m_pending_beacon->m_public_key;
 }
 
 bool ResearcherModel::needsV2BeaconUpgrade() const
 {
-    return m_beacon
-        && m_beacon->m_timestamp <= g_v11_timestamp
-        && (!m_pending_beacon || m_pending_beacon->m_timestamp <= g_v11_timestamp);
+    const std::unique_ptr<Beacon>& beacon = m_snapshot->m_beacon;
+    const std::unique_ptr<Beacon>& pending_beacon = m_snapshot->m_pending_beacon;
+
+    return beacon
+        && beacon->m_timestamp <= g_v11_timestamp
+        && (!pending_beacon || pending_beacon->m_timestamp <= g_v11_timestamp);
 }
 
 QString ResearcherModel::email() const
@@ -280,12 +381,12 @@ QString ResearcherModel::formatCpid() const
 
 QString ResearcherModel::formatMagnitude() const
 {
-    return QString::fromStdString(m_researcher->Magnitude().ToString());
+    return QString::fromStdString(m_snapshot->m_magnitude.ToString());
 }
 
 QString ResearcherModel::formatAccrual(const int display_unit) const
 {
-    return BitcoinUnits::formatWithUnit(display_unit, m_researcher->Accrual());
+    return BitcoinUnits::formatWithUnit(display_unit, m_snapshot->m_accrual);
 }
 
 QString ResearcherModel::formatStatus() const
@@ -301,53 +402,53 @@ QString ResearcherModel::formatBoincPath() const
 
 BeaconStatus ResearcherModel::getBeaconStatus() const
 {
-    return m_beacon_status;
+    return m_snapshot->m_beacon_status;
 }
 
 QString ResearcherModel::formatBeaconStatus() const
 {
-    return mapBeaconStatus(m_beacon_status);
+    return mapBeaconStatus(m_snapshot->m_beacon_status);
 }
 
 QIcon ResearcherModel::getBeaconStatusIcon() const
 {
-    return mapBeaconStatusIcon(m_beacon_status);
+    return mapBeaconStatusIcon(m_snapshot->m_beacon_status);
 }
 
 QString ResearcherModel::formatBeaconAge() const
 {
-    if (!m_beacon) {
+    if (!m_snapshot->m_beacon) {
         return QString();
     }
 
-    return GUIUtil::formatDurationStr(m_beacon->Age(GetAdjustedTime()));
+    return GUIUtil::formatDurationStr(m_snapshot->m_beacon->Age(GetAdjustedTime()));
 }
 
 QString ResearcherModel::formatTimeToBeaconExpiration() const
 {
-    if (!m_beacon) {
+    if (!m_snapshot->m_beacon) {
         return QString();
     }
 
-    return GUIUtil::formatDurationStr(Beacon::MAX_AGE - m_beacon->Age(GetAdjustedTime()));
+    return GUIUtil::formatDurationStr(Beacon::MAX_AGE - m_snapshot->m_beacon->Age(GetAdjustedTime()));
 }
 
 QString ResearcherModel::formatBeaconAddress() const
 {
-    if (!m_beacon) {
+    if (!m_snapshot->m_beacon) {
         return QString();
     }
 
-    return QString::fromStdString(m_beacon->GetAddress().ToString());
+    return QString::fromStdString(m_snapshot->m_beacon->GetAddress().ToString());
 }
 
 QString ResearcherModel::formatBeaconVerificationCode() const
 {
-    if (!m_pending_beacon) {
+    if (!m_snapshot->m_pending_beacon) {
         return QString();
     }
 
-    return QString::fromStdString(m_pending_beacon->GetVerificationCode());
+    return QString::fromStdString(m_snapshot->m_pending_beacon->GetVerificationCode());
 }
 
 std::vector<ProjectRow> ResearcherModel::buildProjectTable(bool with_mag) const
@@ -456,10 +557,7 @@ void ResearcherModel::reload()
 
 void ResearcherModel::refresh()
 {
-    updateBeacon();
-
-    emit magnitudeChanged();
-    emit accrualChanged();
+    requestSnapshot();
 }
 
 void ResearcherModel::resetResearcher(ResearcherPtr researcher)
@@ -494,58 +592,41 @@ bool ResearcherModel::switchToInvestor()
 
 void ResearcherModel::updateBeacon()
 {
-    const CpidOption cpid = m_researcher->Id().TryCpid();
-
-    if (!cpid) {
-        m_beacon.reset(nullptr);
-        m_beacon_status = BeaconStatus::NO_CPID;
-
-        emit beaconChanged();
+    requestSnapshot();
+}
 
+void ResearcherModel::requestSnapshot()
+{
+    // Track the running state ourselves. QFutureWatcher::isRunning() is not
+    // reliable for Qt <5.6.0. See https://bugreports.qt.io/browse/QTBUG-12358
+    if (m_snapshot_running) {
+        m_snapshot_requested = true;
         return;
     }
 
-    if (auto beacon_option = m_researcher->TryBeacon()) {
-        m_beacon.reset(new Beacon(std::move(*beacon_option)));
-    } else {
-        m_beacon.reset(nullptr);
-    }
+    m_snapshot_running = true;
+    m_snapshot_requested = false;
+    m_snapshot_watcher.setFuture(QtConcurrent::run(&ResearcherSnapshot::Build, m_researcher));
+}
 
-    if (auto beacon_option = m_researcher->TryPendingBeacon()) {
-        m_pending_beacon.reset(new Beacon(std::move(*beacon_option)));
-    } else {
-        m_pending_beacon.reset(nullptr);
-    }
+void ResearcherModel::snapshotFinished()
+{
+    m_snapshot_running = false;
 
-    m_beacon_status = MapAdvertiseBeaconError(m_researcher->BeaconError());
+    SnapshotPtr snapshot = m_snapshot_watcher.result();
+
+    // Discard a snapshot of a researcher context replaced while it ran:
+    if (snapshot->m_researcher == m_researcher) {
+        m_snapshot = std::move(snapshot);
 
-    // If automatic advertisement/renewal encountered a problem, raise this
-    // error first:
-    //
-    if (m_beacon_status != BeaconStatus::ACTIVE) {
         emit beaconChanged();
-        return;
+        emit magnitudeChanged();
+        emit accrualChanged();
     }
 
-    if (m_pending_beacon) {
-        m_beacon_status = BeaconStatus::PENDING;
-    } else if (m_beacon) {
-        const int64_t now = GetAdjustedTime();
-
-        if (m_beacon->Expired(now + BEACON_RENEWAL_WARNING_THRESHOLD)) {
-            m_beacon_status = BeaconStatus::RENEWAL_NEEDED;
-        } else if (m_beacon->Renewable(now)) {
-            m_beacon_status = BeaconStatus::RENEWAL_POSSIBLE;
-        } else if (m_researcher->Magnitude() == 0) {
-            m_beacon_status = BeaconStatus::NO_MAGNITUDE;
-        } else {
-            m_beacon_status = BeaconStatus::ACTIVE;
-        }
-    } else {
-        m_beacon_status = BeaconStatus::NO_BEACON;
+    if (m_snapshot_requested || m_snapshot->m_researcher != m_researcher) {
+        requestSnapshot();
     }
-
-    emit beaconChanged();
 }
 
 BeaconStatus ResearcherModel::advertiseBeacon()
@@ -560,6 +641,30 @@ void ResearcherModel::onWizardClose()
     m_wizard_open = false;
 }
 
+void ResearcherModel::queueResearcherChanged()
+{
+    m_researcher_pending = true;
+    m_notifier->post();
+}
+
+void ResearcherModel::queueBeaconChanged()
+{
+    m_beacon_pending = true;
+    m_notifier->post();
+}
+
+void ResearcherModel::flushNotifications()
+{
+    // Resetting the researcher refreshes the beacon status too:
+    const bool beacon_pending = m_beacon_pending.exchange(false);
+
+    if (m_researcher_pending.exchange(false)) {
+        resetResearcher(Researcher::Get());
+    } else if (beacon_pending) {
+        updateBeacon();
+    }
+}
+
 void ResearcherModel::subscribeToCoreSignals()
 {
     // Connect signals to client
@@ -571,5 +676,5 @@ void ResearcherModel::unsubscribeFromCoreSignals()
 {
     // Disconnect signals from client
     uiInterface.ResearcherChanged.disconnect(boost::bind(ResearcherChanged, this));
-    uiInterface.ResearcherChanged.disconnect(boost::bind(BeaconChanged, this));
+    uiInterface.BeaconChanged.disconnect(boost::bind(BeaconChanged, this));
 }
@@ -5,7 +5,9 @@
 #ifndef RESEARCHERMODEL_H
 #define RESEARCHERMODEL_H
 
+#include <atomic>
 #include <memory>
+#include <QFutureWatcher>
 #include <QObject>
 
 QT_BEGIN_NAMESPACE
@@ -13,8 +15,13 @@ class QIcon;
 QT_END_NAMESPACE
 
 class ResearcherWizard;
+class ResearcherSnapshot;
 class WalletModel;
 
+namespace GUIUtil {
+class NotificationCoalescer;
+}
+
 namespace GRC {
 class Beacon;
 class Researcher;
@@ -111,17 +118,46 @@ public:
 
     std::vector<ProjectRow> buildProjectTable(bool with_mag = true) const;
 
+    //!
+    //! \brief Schedule a reload of the researcher context. Safe to call from
+    //! core threads. Repeated calls before the next flush apply once.
+    //!
+    void queueResearcherChanged();
+
+    //!
+    //! \brief Schedule a refresh of the beacon status. Safe to call from core
+    //! threads. Repeated calls before the next flush apply once.
+    //!
+    void queueBeaconChanged();
+
 private:
+    typedef std::shared_ptr<const ResearcherSnapshot> SnapshotPtr;
+
     GRC::ResearcherPtr m_researcher;
-    std::unique_ptr<GRC::Beacon> m_beacon;
-    std::unique_ptr<GRC::Beacon> m_pending_beacon;
-    BeaconStatus m_beacon_status;
+    SnapshotPtr m_snapshot;
+    QFutureWatcher<SnapshotPtr> m_snapshot_watcher;
+    bool m_snapshot_running;
+    bool m_snapshot_requested;
     bool m_configured_for_investor_mode;
     bool m_wizard_open;
 
+    GUIUtil::NotificationCoalescer* m_notifier;
+    std::atomic<bool> m_researcher_pending;
+    std::atomic<bool> m_beacon_pending;
+
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
 
+    //!
+    //! \brief Start building a snapshot of the magnitude, accrual and beacon
+    //! status on a worker thread.
+    //!
+    //! If a snapshot is already in progress, the model starts another when it
+    //! finishes because the running one may miss the change that triggered
+    //! this request.
+    //!
+    void requestSnapshot();
+
 signals:
     void researcherChanged();
     void beaconChanged();
@@ -138,6 +174,10 @@ public slots:
     void updateBeacon();
     BeaconStatus advertiseBeacon();
     void onWizardClose();
+
+private slots:
+    void flushNotifications();
+    void snapshotFinished();
 };
 
 #endif // RESEARCHERMODEL_H
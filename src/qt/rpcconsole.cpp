@@ -9,6 +9,7 @@
 #include "rpcprotocol.h"
 #include "guiutil.h"
 #include "main.h"
+#include "memusage.h"
 #endif
 
 #include <QThread>
@@ -618,6 +619,35 @@ void RPCConsole::on_tabWidget_currentChanged(int index)
     {
         ui->lineEdit->setFocus();
     }
+    else if(ui->tabWidget->widget(index) == ui->tab_memory)
+    {
+        on_refreshMemoryButton_clicked();
+    }
+}
+
+void RPCConsole::on_refreshMemoryButton_clicked()
+{
+    const std::vector<MemoryUsageEntry> usage = GetMemoryUsage();
+    const uint64_t resident = GetResidentMemory();
+    uint64_t total = 0;
+
+    ui->memoryTable->setRowCount(usage.size() + 1);
+
+    for (size_t i = 0; i < usage.size(); ++i) {
+        ui->memoryTable->setItem(i, 0, new QTableWidgetItem(QString::fromStdString(usage[i].name)));
+        ui->memoryTable->setItem(i, 1, new QTableWidgetItem(QString::number(usage[i].entries)));
+        ui->memoryTable->setItem(i, 2, new QTableWidgetItem(FormatBytes(usage[i].bytes)));
+
+        total += usage[i].bytes;
+    }
+
+    ui->memoryTable->setItem(usage.size(), 0, new QTableWidgetItem(tr("Total")));
+    ui->memoryTable->setItem(usage.size(), 1, new QTableWidgetItem(QString()));
+    ui->memoryTable->setItem(usage.size(), 2, new QTableWidgetItem(FormatBytes(total)));
+
+    ui->memoryResidentLabel->setText(resident > 0
+        ? tr("Resident size: %1").arg(FormatBytes(resident))
+        : tr("Resident size: N/A"));
 }
 
 void RPCConsole::on_openDebugLogfileButton_clicked()
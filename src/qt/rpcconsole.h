@@ -59,6 +59,8 @@ private slots:
     void hideEvent(QHideEvent *event);
     /** clear traffic graph */
     void on_clearTrafficGraphButton_clicked();
+    /** estimate the memory used by each subsystem for the Memory tab */
+    void on_refreshMemoryButton_clicked();
     /** Show custom context menu on Peers tab */
     void showPeersTableContextMenu(const QPoint& point);
     /** Show custom context menu on Bans tab */
@@ -17,6 +17,14 @@
 #include <QIcon>
 #include <QDateTime>
 #include <QtAlgorithms>
+#include <QtConcurrentRun>
+
+#include <atomic>
+#include <set>
+
+// Number of wallet transactions to decompose per acquisition of the locks
+// while loading the table.
+static const int LOAD_PAGE_SIZE = 1000;
 
 // Amount column is right-aligned it contains numbers
 static int column_alignments[] = {
@@ -51,7 +59,10 @@ public:
     TransactionTablePriv(CWallet *wallet, WalletModel *walletModel, TransactionTableModel *parent):
             wallet(wallet),
             walletModel(walletModel),
-            parent(parent)
+            parent(parent),
+            cancelLoad(false),
+            loading(false),
+            reloadRequested(false)
     {
     }
     CWallet *wallet;
@@ -64,37 +75,110 @@ public:
      */
     QList<TransactionRecord> cachedWallet;
 
-    /* Query entire wallet anew from core.
+    /* Records built by the background load. Swapped into cachedWallet on the
+     * GUI thread when the load finishes.
      */
-    void loadWallet()
+    QList<TransactionRecord> loadedWallet;
+
+    /* Set to stop a background load early. */
+    std::atomic<bool> cancelLoad;
+
+    /* Whether a background load runs. Only accessed on the GUI thread. */
+    bool loading;
+
+    /* Whether to load again after the running load finishes. */
+    bool reloadRequested;
+
+    /* Transactions that changed while loading. Replayed after the swap. */
+    std::set<uint256> pendingUpdates;
+
+    /* Query entire wallet anew from core. Runs on a background thread and
+     * takes the locks for one page of transactions at a time so that neither
+     * the GUI nor the core stall while decomposing a large wallet.
+     */
+    void loadWallet(bool fLimitTxnDisplay, int64_t limitTxnDateTime)
     {
-        cachedWallet.clear();
+        loadedWallet.clear();
+
+        uint256 lastHash;
+        bool started = false;
+
+        while (!cancelLoad)
         {
             LOCK2(cs_main, wallet->cs_wallet);
 
-            bool fLimitTxnDisplay = walletModel->getOptionsModel()->getLimitTxnDisplay();
-            int64_t limitTxnDateTime = walletModel->getOptionsModel()->getLimitTxnDateTime();
+            // Resume after the last transaction seen, since the wallet may
+            // have changed while the locks were released:
+            std::map<uint256, CWalletTx>::iterator it = started
+                ? wallet->mapWallet.upper_bound(lastHash)
+                : wallet->mapWallet.begin();
 
-            for(std::map<uint256, CWalletTx>::iterator it = wallet->mapWallet.begin(); it != wallet->mapWallet.end(); ++it)
+            for (int n = 0; it != wallet->mapWallet.end() && n < LOAD_PAGE_SIZE; ++it, ++n)
             {
                 if (TransactionRecord::showTransaction(it->second, fLimitTxnDisplay, limitTxnDateTime))
                 {
-                    cachedWallet.append(TransactionRecord::decomposeTransaction(wallet, it->second));
+                    loadedWallet.append(TransactionRecord::decomposeTransaction(wallet, it->second));
                 }
+
+                lastHash = it->first;
+                started = true;
             }
+
+            if (it == wallet->mapWallet.end())
+                break;
         }
     }
 
-
-    /* Update QList using new query from core.
+    /* Start a background query of the wallet. The table keeps showing the
+     * current records until the query finishes.
      */
     void refreshWallet()
     {
-        parent->beginResetModel();
+        if (loading)
+        {
+            reloadRequested = true;
+            return;
+        }
+
+        loading = true;
+
+        bool fLimitTxnDisplay = walletModel->getOptionsModel()->getLimitTxnDisplay();
+        int64_t limitTxnDateTime = walletModel->getOptionsModel()->getLimitTxnDateTime();
+
+        parent->loadWatcher.setFuture(QtConcurrent::run(
+            this, &TransactionTablePriv::loadWallet, fLimitTxnDisplay, limitTxnDateTime));
+    }
+
+    /* Replace the table with the result of the background query.
+     */
+    void loadFinished()
+    {
+        loading = false;
 
-        loadWallet();
+        if (cancelLoad)
+            return;
 
+        if (reloadRequested)
+        {
+            // The next query reads every transaction that changed so far:
+            reloadRequested = false;
+            pendingUpdates.clear();
+            refreshWallet();
+            return;
+        }
+
+        parent->beginResetModel();
+        cachedWallet.swap(loadedWallet);
+        loadedWallet.clear();
         parent->endResetModel();
+
+        std::set<uint256> updates;
+        updates.swap(pendingUpdates);
+
+        for (const uint256& hash : updates)
+        {
+            updateWallet(hash, CT_UPDATED);
+        }
     }
 
     /* Update our model of the wallet incrementally by core transaction, to synchronize our model of the wallet
@@ -105,6 +189,15 @@ public:
     void updateWallet(const uint256 &hash, int status)
     {
         LogPrint(BCLog::LogFlags::VERBOSE, "updateWallet %s %i", hash.ToString(), status);
+
+        // The background query may or may not see this change. Check the
+        // transaction again once the query finishes:
+        if (loading)
+        {
+            pendingUpdates.insert(hash);
+            return;
+        }
+
         {
             LOCK2(cs_main, wallet->cs_wallet);
 
@@ -256,7 +349,9 @@ TransactionTableModel::TransactionTableModel(CWallet* wallet, WalletModel *paren
 {
     columns << QString() << tr("Date") << tr("Type") << tr("Address") << tr("Amount");
 
-    priv->loadWallet();
+    connect(&loadWatcher, SIGNAL(finished()), this, SLOT(loadFinished()));
+
+    priv->refreshWallet();
 
     connect(walletModel->getOptionsModel(), SIGNAL(displayUnitChanged(int)), this, SLOT(updateDisplayUnit()));
     connect(walletModel->getOptionsModel(), SIGNAL(LimitTxnDisplayChanged(bool)), this, SLOT(refreshWallet()));
@@ -264,6 +359,9 @@ TransactionTableModel::TransactionTableModel(CWallet* wallet, WalletModel *paren
 
 TransactionTableModel::~TransactionTableModel()
 {
+    priv->cancelLoad = true;
+    loadWatcher.waitForFinished();
+
     delete priv;
 }
 
@@ -280,6 +378,11 @@ void TransactionTableModel::refreshWallet()
     priv->refreshWallet();
 }
 
+void TransactionTableModel::loadFinished()
+{
+    priv->loadFinished();
+}
+
 void TransactionTableModel::updateConfirmations()
 {
     // Blocks came in since last poll.
@@ -2,6 +2,7 @@
 #define TRANSACTIONTABLEMODEL_H
 
 #include <QAbstractTableModel>
+#include <QFutureWatcher>
 #include <QStringList>
 
 class CWallet;
@@ -62,6 +63,7 @@ private:
     WalletModel *walletModel;
     QStringList columns;
     TransactionTablePriv *priv;
+    QFutureWatcher<void> loadWatcher;
 
     QString lookupAddress(const std::string &address, bool tooltip) const;
     QVariant addressColor(const TransactionRecord *wtx) const;
@@ -80,6 +82,9 @@ public slots:
     void updateConfirmations();
     void updateDisplayUnit();
 
+private slots:
+    void loadFinished();
+
     friend class TransactionTablePriv;
 };
 
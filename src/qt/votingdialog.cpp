@@ -60,6 +60,7 @@ static int column_alignments[] = {
 // VotingTableModel
 //
 VotingTableModel::VotingTableModel(void)
+    : data_(std::make_shared<std::vector<VotingItem>>())
 {
     columns_
         << tr("#")
@@ -72,17 +73,10 @@ VotingTableModel::VotingTableModel(void)
         ;
 }
 
-VotingTableModel::~VotingTableModel(void)
-{
-    for(ssize_t i=0; i < data_.size(); i++)
-        if (data_.at(i))
-            delete data_.at(i);
-}
-
 int VotingTableModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent);
-    return data_.size();
+    return data_->size();
 }
 
 int VotingTableModel::columnCount(const QModelIndex &parent) const
@@ -212,8 +206,8 @@ QVariant VotingTableModel::headerData(int section, Qt::Orientation orientation,
 
 const VotingItem *VotingTableModel::index(int row) const
 {
-    if ((row >= 0) && (row < data_.size()))
-        return data_[row];
+    if ((row >= 0) && (static_cast<size_t>(row) < data_->size()))
+        return &(*data_)[row];
     return 0;
 }
 
@@ -235,79 +229,68 @@ Qt::ItemFlags VotingTableModel::flags(const QModelIndex &index) const
 }
 
 namespace {
-VotingItem* BuildPollItem(const PollRegistry::Sequence::Iterator& iter)
+bool BuildPollItem(const PollRegistry::Sequence::Iterator& iter, VotingItem& item)
 {
     const PollResultOption result = PollResult::BuildFor(iter->Ref());
 
     if (!result) {
-        return nullptr;
+        return false;
     }
 
     const Poll& poll = result->m_poll;
 
-    VotingItem *item = new VotingItem;
-    item->pollTxid_ = iter->Ref().Txid();
-    item->expiration_ = QDateTime::fromMSecsSinceEpoch(poll.Expiration() * 1000);
-    item->shareType_ = QString::fromStdString(poll.WeightTypeToString());
-    item->totalParticipants_ = result->m_votes.size();
-    item->totalShares_ = result->m_total_weight / (double)COIN;
+    item.pollTxid_ = iter->Ref().Txid();
+    item.expiration_ = QDateTime::fromMSecsSinceEpoch(poll.Expiration() * 1000);
+    item.shareType_ = QString::fromStdString(poll.WeightTypeToString());
+    item.totalParticipants_ = result->m_votes.size();
+    item.totalShares_ = result->m_total_weight / (double)COIN;
 
-    item->title_ = QString::fromStdString(poll.m_title).replace("_"," ");
-    item->question_ = QString::fromStdString(poll.m_question).replace("_"," ");
-    item->url_ = QString::fromStdString(poll.m_url).trimmed();
+    item.title_ = QString::fromStdString(poll.m_title).replace("_"," ");
+    item.question_ = QString::fromStdString(poll.m_question).replace("_"," ");
+    item.url_ = QString::fromStdString(poll.m_url).trimmed();
 
-    if (!item->url_.startsWith("http://") && !item->url_.startsWith("https://")) {
-        item->url_.prepend("http://");
+    if (!item.url_.startsWith("http://") && !item.url_.startsWith("https://")) {
+        item.url_.prepend("http://");
     }
 
     for (size_t i = 0; i < result->m_responses.size(); ++i) {
-        item->vectorOfAnswers_.emplace_back(
+        item.vectorOfAnswers_.emplace_back(
             poll.Choices().At(i)->m_label,
             result->m_responses[i].m_weight / (double)COIN,
             result->m_responses[i].m_votes);
     }
 
     if (!result->m_votes.empty()) {
-        item->bestAnswer_ = QString::fromStdString(result->WinnerLabel()).replace("_"," ");
+        item.bestAnswer_ = QString::fromStdString(result->WinnerLabel()).replace("_"," ");
     }
 
-    return item;
+    return true;
 }
 } // Anonymous namespace
 
-void VotingTableModel::resetData(bool history)
+VotingTableModel::Snapshot VotingTableModel::buildData(bool history)
 {
-    // data: erase
-    if (data_.size()) {
-        beginRemoveRows(QModelIndex(), 0, data_.size() - 1);
-        for(ssize_t i=0; i < data_.size(); i++)
-            if (data_.at(i))
-                delete data_.at(i);
-        data_.clear();
-        endRemoveRows();
-    }
+    std::shared_ptr<std::vector<VotingItem>> items = std::make_shared<std::vector<VotingItem>>();
 
-    // retrieve data
-    std::vector<VotingItem *> items;
+    LOCK(cs_main);
 
-    {
-        LOCK(cs_main);
+    for (const auto iter : GetPollRegistry().Polls().OnlyActive(!history)) {
+        VotingItem item;
 
-        for (const auto iter : GetPollRegistry().Polls().OnlyActive(!history)) {
-            if (VotingItem* item = BuildPollItem(iter)) {
-                item->rowNumber_ = items.size() + 1;
-                items.push_back(item);
-            }
+        if (BuildPollItem(iter, item)) {
+            item.rowNumber_ = items->size() + 1;
+            items->push_back(std::move(item));
         }
     }
 
-    // data: populate
-    if (items.size()) {
-        beginInsertRows(QModelIndex(), 0, items.size() - 1);
-        for(size_t i=0; i < items.size(); i++)
-            data_.append(items[i]);
-        endInsertRows();
-    }
+    return items;
+}
+
+void VotingTableModel::resetData(Snapshot data)
+{
+    beginResetModel();
+    data_ = std::move(data);
+    endResetModel();
 }
 
 // VotingProxyModel
@@ -424,6 +407,7 @@ VotingDialog::VotingDialog(QWidget *parent)
     // have to track the running state ourselves. See
     // https://bugreports.qt.io/browse/QTBUG-12358
     watcher.setProperty("running", false);
+    pendingHistory = -1;
     connect(&watcher, SIGNAL(finished()), this, SLOT(onLoadingFinished()));
     loadingIndicator = new QLabel(this);
     loadingIndicator->move(50,170);
@@ -445,15 +429,21 @@ void VotingDialog::setModel(WalletModel *wallet_model)
 
 void VotingDialog::loadPolls(bool history)
 {
-    bool isRunning = watcher.property("running").toBool();
-    if (tableModel_&& !isRunning)
+    if (!tableModel_)
+        return;
+
+    // A running load may have read the polls before the change that caused
+    // this request. Start again once it finishes:
+    if (watcher.property("running").toBool())
     {
-        loadingIndicator->setText(tr("...loading data!"));
-        loadingIndicator->show();
-        QFuture<void> future = QtConcurrent::run(tableModel_, &VotingTableModel::resetData, history);
-        watcher.setProperty("running", true);
-        watcher.setFuture(future);
+        pendingHistory = history;
+        return;
     }
+
+    loadingIndicator->setText(tr("...loading data!"));
+    loadingIndicator->show();
+    watcher.setProperty("running", true);
+    watcher.setFuture(QtConcurrent::run(&VotingTableModel::buildData, history));
 }
 
 void VotingDialog::resetData(void)
@@ -470,6 +460,17 @@ void VotingDialog::onLoadingFinished(void)
 {
     watcher.setProperty("running", false);
 
+    if (pendingHistory >= 0)
+    {
+        // Discard the stale result:
+        const bool history = pendingHistory;
+        pendingHistory = -1;
+        loadPolls(history);
+        return;
+    }
+
+    tableModel_->resetData(watcher.result());
+
     int rowsCount = tableView_->verticalHeader()->count();
     if (rowsCount > 0) {
         loadingIndicator->hide();
@@ -7,6 +7,7 @@
 
 #include "uint256.h"
 
+#include <memory>
 #include <time.h>
 #include <QAbstractTableModel>
 #include <QDialog>
@@ -23,6 +24,7 @@
 #include <QListWidgetItem>
 #include <QDateTime>
 #include <QFuture>
+#include <QFutureWatcher>
 #include <QtGlobal>
 #include <QtWidgets>
 
@@ -89,8 +91,12 @@ class VotingTableModel
     Q_OBJECT
 
 public:
+    //!
+    //! \brief Immutable list of polls built on a worker thread.
+    //!
+    typedef std::shared_ptr<const std::vector<VotingItem>> Snapshot;
+
     explicit VotingTableModel();
-    ~VotingTableModel();
 
     enum ColumnIndex {
         RowNumber = 0,
@@ -121,11 +127,21 @@ public:
     const VotingItem *index(int row) const;
     QModelIndex index(int row, int column, const QModelIndex &parent=QModelIndex()) const;
     Qt::ItemFlags flags(const QModelIndex &) const;
-    void resetData(bool history);
+
+    //!
+    //! \brief Tally the polls. Takes \c cs_main, so call it from a worker.
+    //!
+    static Snapshot buildData(bool history);
+
+    //!
+    //! \brief Replace the rows with a finished snapshot. Call it on the GUI
+    //! thread.
+    //!
+    void resetData(Snapshot data);
 
 private:
     QStringList columns_;
-    QList<VotingItem *> data_;
+    Snapshot data_;
 };
 
 
@@ -174,7 +190,8 @@ private:
     VotingVoteDialog *voteDialog_;
     NewPollDialog *pollDialog_;
     QLabel *loadingIndicator;
-    QFutureWatcher<void> watcher;
+    QFutureWatcher<VotingTableModel::Snapshot> watcher;
+    int pendingHistory; // -1 = none, else the history flag of a queued load
 
 private:
     virtual void showEvent(QShowEvent *);
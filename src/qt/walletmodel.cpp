@@ -3,6 +3,7 @@
 #include "optionsmodel.h"
 #include "addresstablemodel.h"
 #include "transactiontablemodel.h"
+#include "guiutil.h"
 
 #include "ui_interface.h"
 #include "wallet/wallet.h"
@@ -26,6 +27,11 @@ WalletModel::WalletModel(CWallet *wallet, OptionsModel *optionsModel, QObject *p
     addressTableModel = new AddressTableModel(wallet, this);
     transactionTableModel = new TransactionTableModel(wallet, this);
 
+    // Rescans and syncs change many transactions in a burst. Apply them in
+    // batches rather than one queued call per transaction:
+    transactionNotifier = new GUIUtil::NotificationCoalescer(MODEL_NOTIFY_DELAY, this);
+    connect(transactionNotifier, SIGNAL(flush()), this, SLOT(flushTransactions()));
+
     // This timer will be fired repeatedly to update the balance
     pollTimer = new QTimer(this);
     connect(pollTimer, SIGNAL(timeout()), this, SLOT(pollBalanceChanged()));
@@ -141,6 +147,48 @@ void WalletModel::updateTransaction(const QString &hash, int status)
     }
 }
 
+void WalletModel::queueTransactionUpdate(const uint256 &hash)
+{
+    {
+        std::lock_guard<std::mutex> lock(cs_pendingTransactions);
+        pendingTransactions.insert(hash);
+    }
+
+    transactionNotifier->post();
+}
+
+void WalletModel::flushTransactions()
+{
+    std::set<uint256> updates;
+    {
+        std::lock_guard<std::mutex> lock(cs_pendingTransactions);
+        updates.swap(pendingTransactions);
+    }
+
+    if (updates.empty())
+        return;
+
+    if (transactionTableModel)
+    {
+        // The table derives new and deleted transactions from the state of
+        // the wallet, so an update covers any sequence of changes:
+        for (const uint256& hash : updates)
+            transactionTableModel->updateTransaction(QString::fromStdString(hash.GetHex()), CT_UPDATED);
+
+        emit transactionUpdated();
+    }
+
+    checkBalanceChanged();
+
+    int newNumTransactions = getNumTransactions();
+    if (cachedNumTransactions != newNumTransactions)
+    {
+        cachedNumTransactions = newNumTransactions;
+
+        emit numTransactionsChanged(newNumTransactions);
+    }
+}
+
 void WalletModel::updateAddressBook(const QString &address, const QString &label, bool isMine, int status)
 {
     if(addressTableModel)
@@ -360,9 +408,7 @@ static void NotifyAddressBookChanged(WalletModel *walletmodel, CWallet *wallet,
 static void NotifyTransactionChanged(WalletModel *walletmodel, CWallet *wallet, const uint256 &hash, ChangeType status)
 {
     LogPrint(BCLog::LogFlags::VERBOSE, "NotifyTransactionChanged %s status=%i", hash.GetHex(), status);
-    QMetaObject::invokeMethod(walletmodel, "updateTransaction", Qt::QueuedConnection,
-                              Q_ARG(QString, QString::fromStdString(hash.GetHex())),
-                              Q_ARG(int, status));
+    walletmodel->queueTransactionUpdate(hash);
 }
 
 // This is ugly but is the easiest way to support the wide range of boost versions and deal with the
@@ -4,9 +4,12 @@
 #include <QObject>
 #include <vector>
 #include <map>
+#include <mutex>
+#include <set>
 
 #include "support/allocators/secure.h" /* for SecureString */
 #include "wallet/ismine.h"
+#include "uint256.h"
 
 class OptionsModel;
 class AddressTableModel;
@@ -16,9 +19,12 @@ class CKeyID;
 class CPubKey;
 class COutput;
 class COutPoint;
-class uint256;
 class CCoinControl;
 
+namespace GUIUtil {
+class NotificationCoalescer;
+}
+
 QT_BEGIN_NAMESPACE
 class QTimer;
 QT_END_NAMESPACE
@@ -75,6 +81,9 @@ public:
     // Check address for validity
     bool validateAddress(const QString &address);
 
+    // Queue a changed transaction for the next flush. Called from core threads.
+    void queueTransactionUpdate(const uint256 &hash);
+
     // Return status record for SendCoins, contains error id + information
     struct SendCoinsReturn
     {
@@ -148,6 +157,12 @@ private:
 
     QTimer *pollTimer;
 
+    // Transactions changed by the core since the last flush. Filled by the
+    // core threads and drained on the GUI thread.
+    GUIUtil::NotificationCoalescer *transactionNotifier;
+    std::mutex cs_pendingTransactions;
+    std::set<uint256> pendingTransactions;
+
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
     void checkBalanceChanged();
@@ -158,6 +173,8 @@ public slots:
     void updateStatus();
     /* New transaction, or transaction changed status */
     void updateTransaction(const QString &hash, int status);
+    /* Apply the transaction changes collected since the last flush */
+    void flushTransactions();
     /* New, updated or removed address book entry */
     void updateAddressBook(const QString &address, const QString &label, bool isMine, int status);
     /* Current, immature or unconfirmed balance might have changed - emit 'balanceChanged' if so */
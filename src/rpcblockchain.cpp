@@ -7,6 +7,8 @@
 #include "rpcserver.h"
 #include "rpcprotocol.h"
 #include "init.h" // for pwalletMain
+#include "memusage.h"
+#include "orphanblocks.h"
 #include "checkpoints.h"
 #include "txdb.h"
 #include "gridcoin/appcache.h"
@@ -17,6 +19,7 @@
 #include "gridcoin/contract/message.h"
 #include "gridcoin/project.h"
 #include "gridcoin/quorum.h"
+#include "gridcoin/research_history.h"
 #include "gridcoin/researcher.h"
 #include "gridcoin/staking/difficulty.h"
 #include "gridcoin/superblock.h"
@@ -24,7 +27,13 @@
 #include "gridcoin/tally.h"
 #include "gridcoin/tx_message.h"
 #include "util.h"
+#include "util/perf.h"
+#include "util/threadpool.h"
 
+#include <algorithm>
+#include <limits>
+#include <list>
+#include <memory>
 #include <univalue.h>
 
 extern CCriticalSection cs_ConvergedScraperStatsCache;
@@ -79,24 +88,31 @@ UniValue ClaimToJson(const GRC::Claim& claim, const CBlockIndex* const pindex)
     return json;
 }
 
+UniValue ProjectStatsToJson(const GRC::Superblock::ProjectStats& stats)
+{
+    UniValue project(UniValue::VOBJ);
+
+    project.pushKV("average_rac", stats.m_average_rac);
+    project.pushKV("rac", stats.m_rac);
+    project.pushKV("total_credit", stats.m_total_credit);
+
+    return project;
+}
+
 UniValue SuperblockToJson(const GRC::Superblock& superblock)
 {
     UniValue magnitudes(UniValue::VOBJ);
 
+    // The CPIDs in a superblock are unique, so skip the linear search for an
+    // existing key in pushKV():
     for (const auto& cpid_iter : superblock.m_cpids) {
-        magnitudes.pushKV(cpid_iter.Cpid().ToString(), cpid_iter.Magnitude().Floating());
+        magnitudes.__pushKV(cpid_iter.Cpid().ToString(), ValueFromMagnitude(cpid_iter.Magnitude()));
     }
 
     UniValue projects(UniValue::VOBJ);
 
     for (const auto& project_pair : superblock.m_projects) {
-        UniValue project(UniValue::VOBJ);
-
-        project.pushKV("average_rac", project_pair.second.m_average_rac);
-        project.pushKV("rac", project_pair.second.m_rac);
-        project.pushKV("total_credit", project_pair.second.m_total_credit);
-
-        projects.pushKV(project_pair.first, project);
+        projects.pushKV(project_pair.first, ProjectStatsToJson(project_pair.second));
     }
 
     UniValue beacons(UniValue::VARR);
@@ -120,10 +136,60 @@ UniValue SuperblockToJson(const GRC::SuperblockPtr& superblock)
     return SuperblockToJson(*superblock);
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool fPrintTransactionDetail)
+//! Write the same document as SuperblockToJson() one entry at a time.
+void SuperblockToJsonStream(const GRC::Superblock& superblock, JSONStreamWriter& out)
 {
-    UniValue result(UniValue::VOBJ);
+    out.BeginObject();
+    out.KV("version", (int)superblock.m_version);
+
+    out.Key("magnitudes");
+    out.BeginObject();
+
+    for (const auto& cpid_iter : superblock.m_cpids) {
+        out.KV(cpid_iter.Cpid().ToString(), ValueFromMagnitude(cpid_iter.Magnitude()));
+    }
+
+    out.EndObject();
+
+    out.Key("projects");
+    out.BeginObject();
+
+    for (const auto& project_pair : superblock.m_projects) {
+        out.KV(project_pair.first, ProjectStatsToJson(project_pair.second));
+    }
+
+    out.EndObject();
+
+    out.Key("beacons");
+    out.BeginArray();
+
+    for (const auto& key_id : superblock.m_verified_beacons.m_verified) {
+        out.Value(key_id.ToString());
+    }
+
+    out.EndArray();
+    out.EndObject();
+}
+
+namespace {
+//!
+//! \brief Members of the JSON form of a block that depend on the state of the
+//! chain. Computing them requires a lock on cs_main.
+//!
+struct BlockFieldsJson
+{
+    UniValue header;   //!< Members before the transactions.
+    UniValue claim;    //!< Members between the transactions and the superblock.
+    UniValue trailer;  //!< Members after the superblock.
+    bool fSuperblock;  //!< Whether the block contains a superblock.
+};
+
+BlockFieldsJson GetBlockFieldsJson(const CBlock& block, const CBlockIndex* blockindex)
+{
+    BlockFieldsJson fields;
+    UniValue& result = fields.header;
 
+    result.setObject();
     result.pushKV("hash", block.GetHash().GetHex());
 
     CMerkleTx txGen(block.vtx[0]);
@@ -164,39 +230,102 @@ UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool fP
     result.pushKV("modifier", strprintf("%016" PRIx64, blockindex->nStakeModifier));
     result.pushKV("modifierchecksum", strprintf("%08x", blockindex->nStakeModifierChecksum));
 
-    UniValue txinfo(UniValue::VARR);
+    fields.claim.setObject();
 
-    for (auto const& tx : block.vtx)
-    {
-        if (fPrintTransactionDetail)
-        {
-            UniValue entry(UniValue::VOBJ);
+    if (block.IsProofOfStake())
+        fields.claim.pushKV("signature", HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end()));
 
-            entry.pushKV("txid", tx.GetHash().GetHex());
-            TxToJSON(tx, uint256(), entry);
+    fields.claim.pushKV("claim", ClaimToJson(block.GetClaim(), blockindex));
 
-            txinfo.push_back(entry);
-        }
-        else
-            txinfo.push_back(tx.GetHash().GetHex());
+    if (LogInstance().WillLogCategory(BCLog::LogFlags::NET)) fields.claim.pushKV("BoincHash",block.vtx[0].hashBoinc);
+
+    fields.trailer.setObject();
+    fields.trailer.pushKV("fees_collected", ValueFromAmount(GetFeesCollected(block)));
+    fields.trailer.pushKV("IsSuperBlock", (int)blockindex->nIsSuperBlock);
+    fields.trailer.pushKV("IsContract", (int)blockindex->nIsContract);
+
+    fields.fSuperblock = blockindex->nIsSuperBlock == 1;
+
+    return fields;
+}
+
+UniValue BlockTxToJson(const CTransaction& tx, bool fPrintTransactionDetail)
+{
+    if (!fPrintTransactionDetail)
+        return tx.GetHash().GetHex();
+
+    UniValue entry(UniValue::VOBJ);
+
+    entry.pushKV("txid", tx.GetHash().GetHex());
+    TxToJSON(tx, uint256(), entry);
+
+    return entry;
+}
+
+void PushFields(JSONStreamWriter& out, const UniValue& fields)
+{
+    const std::vector<std::string>& keys = fields.getKeys();
+    const std::vector<UniValue>& values = fields.getValues();
+
+    for (size_t i = 0; i < keys.size(); ++i) {
+        out.KV(keys[i], values[i]);
     }
+}
 
-    result.pushKV("tx", txinfo);
+//!
+//! \brief Write the same document as blockToJSON() from the members computed
+//! under cs_main. Writing the transactions and the superblock needs no lock.
+//!
+void blockToJSONStream(
+    const CBlock& block,
+    const BlockFieldsJson& fields,
+    bool fPrintTransactionDetail,
+    JSONStreamWriter& out)
+{
+    out.BeginObject();
+    PushFields(out, fields.header);
 
-    if (block.IsProofOfStake())
-        result.pushKV("signature", HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end()));
+    out.Key("tx");
+    out.BeginArray();
+
+    for (auto const& tx : block.vtx) {
+        out.Value(BlockTxToJson(tx, fPrintTransactionDetail));
+    }
+
+    out.EndArray();
+
+    PushFields(out, fields.claim);
+
+    if (fPrintTransactionDetail && fields.fSuperblock) {
+        out.Key("superblock");
+        SuperblockToJsonStream(*block.GetSuperblock(), out);
+    }
+
+    PushFields(out, fields.trailer);
+    out.EndObject();
+}
+} // anonymous namespace
+
+UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool fPrintTransactionDetail)
+{
+    BlockFieldsJson fields = GetBlockFieldsJson(block, blockindex);
+    UniValue result = std::move(fields.header);
+
+    UniValue txinfo(UniValue::VARR);
 
-    result.pushKV("claim", ClaimToJson(block.GetClaim(), blockindex));
+    for (auto const& tx : block.vtx)
+    {
+        txinfo.push_back(BlockTxToJson(tx, fPrintTransactionDetail));
+    }
 
-    if (LogInstance().WillLogCategory(BCLog::LogFlags::NET)) result.pushKV("BoincHash",block.vtx[0].hashBoinc);
+    result.pushKV("tx", txinfo);
+    result.pushKVs(fields.claim);
 
-    if (fPrintTransactionDetail && blockindex->nIsSuperBlock == 1) {
+    if (fPrintTransactionDetail && fields.fSuperblock) {
         result.pushKV("superblock", SuperblockToJson(block.GetSuperblock()));
     }
 
-    result.pushKV("fees_collected", ValueFromAmount(GetFeesCollected(block)));
-    result.pushKV("IsSuperBlock", (int)blockindex->nIsSuperBlock);
-    result.pushKV("IsContract", (int)blockindex->nIsContract);
+    result.pushKVs(fields.trailer);
 
     return result;
 }
@@ -235,9 +364,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
                 "\n"
                 "Returns the hash of the best block in the longest block chain\n");
 
-    LOCK(cs_main);
-
-    return hashBestChain.GetHex();
+    return GetChainTipView()->hashBestChain.GetHex();
 }
 
 UniValue getblockcount(const UniValue& params, bool fHelp)
@@ -248,9 +375,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
                 "\n"
                 "Returns the number of blocks in the longest block chain\n");
 
-    LOCK(cs_main);
-
-    return nBestHeight;
+    return GetChainTipView()->nHeight;
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -261,11 +386,11 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
                 "\n"
                 "Returns the difficulty as a multiple of the minimum difficulty\n");
 
-    LOCK(cs_main);
+    const std::shared_ptr<const ChainTipView> tip = GetChainTipView();
 
     UniValue obj(UniValue::VOBJ);
-    obj.pushKV("current", GRC::GetCurrentDifficulty());
-    obj.pushKV("target", GRC::GetTargetDifficulty());
+    obj.pushKV("current", tip->dDifficulty);
+    obj.pushKV("target", tip->dTargetDifficulty);
 
     return obj;
 }
@@ -316,6 +441,30 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
     return a;
 }
 
+UniValue getmempoolinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getmempoolinfo\n"
+                "\n"
+                "Displays usage and limits of the transaction memory pool\n");
+
+    const CTxMemPoolStats stats = mempool.GetStats();
+
+    UniValue res(UniValue::VOBJ);
+
+    res.pushKV("size", (uint64_t)stats.nTx);
+    res.pushKV("bytes", stats.nTxBytes);
+    res.pushKV("usage", (uint64_t)stats.nUsage);
+    res.pushKV("maxmempool", (uint64_t)stats.nMaxUsage);
+    res.pushKV("expiry_hours", stats.nExpiry / (60 * 60));
+    res.pushKV("minfeerate", ValueFromAmount((int64_t)stats.dMinFeeRate));
+    res.pushKV("expired", stats.nExpired);
+    res.pushKV("evicted", stats.nEvicted);
+
+    return res;
+}
+
 UniValue getblockhash(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 1)
@@ -381,9 +530,7 @@ UniValue getblockbynumber(const UniValue& params, bool fHelp)
     LOCK(cs_main);
 
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hashBestChain];
-    while (pblockindex->nHeight > nHeight)
-        pblockindex = pblockindex->pprev;
+    CBlockIndex* pblockindex = mapBlockIndex[hashBestChain]->GetAncestor(nHeight);
 
     uint256 hash = *pblockindex->phashBlock;
 
@@ -393,6 +540,259 @@ UniValue getblockbynumber(const UniValue& params, bool fHelp)
     return blockToJSON(block, pblockindex, params.size() > 1 ? params[1].get_bool() : false);
 }
 
+namespace {
+//!
+//! \brief Holds the serialized JSON documents of deeply confirmed blocks for
+//! the streaming block RPCs.
+//!
+//! Apart from its confirmations member, the document of a block in the main
+//! chain only changes when a reorganization removes the block. An entry keeps
+//! the text on either side of the confirmation count, and the RPCs only read
+//! an entry while the main chain contains the block at -rpcblockcachedepth or
+//! deeper. A reorganization deeper than that bypasses the stale entries, and
+//! the least recently used entries drop out once the documents exceed
+//! -rpcblockcachesize.
+//!
+class BlockJsonCache
+{
+public:
+    //!
+    //! \brief The text of a block document around its confirmation count.
+    //!
+    struct Document
+    {
+        std::string m_prefix; //!< Text up to the confirmation count.
+        std::string m_suffix; //!< Text after the confirmation count.
+    };
+
+    typedef std::shared_ptr<const Document> DocumentPtr;
+
+    //!
+    //! \brief Get the cached document of a block.
+    //!
+    //! \param hash    Hash of the block.
+    //! \param verbose Whether the document contains transaction details.
+    //!
+    //! \return The document, or \c nullptr when the cache does not hold it.
+    //!
+    DocumentPtr Get(const uint256& hash, const bool verbose)
+    {
+        LOCK(m_lock);
+
+        const auto iter = m_index.find(Key(hash, verbose));
+
+        if (iter == m_index.end()) {
+            return nullptr;
+        }
+
+        m_entries.splice(m_entries.begin(), m_entries, iter->second);
+
+        return iter->second->second;
+    }
+
+    //!
+    //! \brief Store the document of a block and evict the least recently used
+    //! documents beyond the size limit.
+    //!
+    void Put(const uint256& hash, const bool verbose, DocumentPtr document, const size_t max_bytes)
+    {
+        LOCK(m_lock);
+
+        const Key key(hash, verbose);
+
+        if (m_index.count(key)) {
+            return;
+        }
+
+        m_bytes += DocumentSize(*document);
+        m_entries.emplace_front(key, std::move(document));
+        m_index.emplace(key, m_entries.begin());
+
+        while (m_bytes > max_bytes && !m_entries.empty()) {
+            m_bytes -= DocumentSize(*m_entries.back().second);
+            m_index.erase(m_entries.back().first);
+            m_entries.pop_back();
+        }
+    }
+
+private:
+    typedef std::pair<uint256, bool> Key;
+    typedef std::list<std::pair<Key, DocumentPtr>> EntryList;
+
+    CCriticalSection m_lock;
+    EntryList m_entries;                       //!< Most recently used first.
+    std::map<Key, EntryList::iterator> m_index;
+    size_t m_bytes = 0;                        //!< Size of the cached text.
+
+    static size_t DocumentSize(const Document& document)
+    {
+        return document.m_prefix.size() + document.m_suffix.size();
+    }
+};
+
+BlockJsonCache g_block_json_cache;
+
+//!
+//! \brief Split the document of a block around its confirmation count, which
+//! GetBlockFieldsJson() writes as the second member after the hash.
+//!
+BlockJsonCache::DocumentPtr SplitBlockDocument(const std::string& text)
+{
+    static const std::string key = "\"confirmations\":";
+
+    const size_t key_pos = text.find(key);
+
+    if (key_pos == std::string::npos) {
+        return nullptr;
+    }
+
+    const size_t value_pos = key_pos + key.size();
+    const size_t suffix_pos = text.find_first_not_of("-0123456789", value_pos);
+
+    if (suffix_pos == std::string::npos) {
+        return nullptr;
+    }
+
+    auto document = std::make_shared<BlockJsonCache::Document>();
+    document->m_prefix = text.substr(0, value_pos);
+    document->m_suffix = text.substr(suffix_pos);
+
+    return document;
+}
+
+//!
+//! \brief Write the document of a block, from the cache when the block is
+//! deep enough.
+//!
+//! \param pblockindex Locates the block to write. Must not be \c nullptr.
+//!
+void StreamBlock(const CBlockIndex* pblockindex, const bool fPrintTransactionDetail, JSONStreamWriter& out)
+{
+    const size_t max_bytes = std::max<int64_t>(0, GetArg("-rpcblockcachesize", 0)) * 1024 * 1024;
+    // The tip has no next block hash yet:
+    const int min_depth = std::max<int64_t>(2, GetArg("-rpcblockcachedepth", 100));
+    const uint256 hash = pblockindex->GetBlockHash();
+
+    BlockJsonCache::DocumentPtr document;
+    CBlock block;
+    BlockFieldsJson fields;
+    int depth = 0;
+
+    {
+        LOCK(cs_main);
+
+        if (max_bytes > 0 && pblockindex->IsInMainChain()) {
+            depth = nBestHeight - pblockindex->nHeight + 1;
+        }
+
+        if (depth > 0 && depth >= min_depth) {
+            document = g_block_json_cache.Get(hash, fPrintTransactionDetail);
+        } else {
+            depth = 0;
+        }
+
+        if (!document) {
+            block.ReadFromDisk(pblockindex, true);
+            fields = GetBlockFieldsJson(block, pblockindex);
+        }
+    }
+
+    if (document) {
+        out.Raw(document->m_prefix);
+        out.Raw(std::to_string(depth));
+        out.Raw(document->m_suffix);
+        return;
+    }
+
+    if (depth == 0) {
+        blockToJSONStream(block, fields, fPrintTransactionDetail, out);
+        return;
+    }
+
+    // Build the whole document to cache it. The writer never reaches its
+    // flush size, so the sink does nothing:
+    JSONStreamWriter document_out([](const std::string&) { }, std::numeric_limits<size_t>::max() / 2);
+    blockToJSONStream(block, fields, fPrintTransactionDetail, document_out);
+
+    const std::string text = document_out.TakeBuffer();
+
+    if (BlockJsonCache::DocumentPtr split = SplitBlockDocument(text)) {
+        g_block_json_cache.Put(hash, fPrintTransactionDetail, std::move(split), max_bytes);
+    }
+
+    out.Raw(text);
+}
+} // anonymous namespace
+void getblock_stream(const UniValue& params, JSONStreamWriter& out)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getblock(params, true); // Throws the usage.
+
+    const uint256 hash = uint256S(params[0].get_str());
+    const bool fPrintTransactionDetail = params.size() > 1 ? params[1].get_bool() : false;
+
+    const CBlockIndex* pblockindex;
+
+    {
+        LOCK(cs_main);
+
+        const auto iter = mapBlockIndex.find(hash);
+
+        if (iter == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+
+        pblockindex = iter->second;
+    }
+
+    StreamBlock(pblockindex, fPrintTransactionDetail, out);
+}
+
+void getblockbynumber_stream(const UniValue& params, JSONStreamWriter& out)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getblockbynumber(params, true); // Throws the usage.
+
+    const int nHeight = params[0].get_int();
+    const bool fPrintTransactionDetail = params.size() > 1 ? params[1].get_bool() : false;
+
+    const CBlockIndex* pblockindex;
+
+    {
+        LOCK(cs_main);
+
+        if (nHeight < 0 || nHeight > nBestHeight)
+            throw runtime_error("Block number out of range");
+
+        pblockindex = pindexBest->GetAncestor(nHeight);
+    }
+
+    StreamBlock(pblockindex, fPrintTransactionDetail, out);
+}
+
+void showblock_stream(const UniValue& params, JSONStreamWriter& out)
+{
+    if (params.size() != 1)
+        showblock(params, true); // Throws the usage.
+
+    const int nHeight = params[0].get_int();
+
+    const CBlockIndex* pblockindex;
+
+    {
+        LOCK(cs_main);
+
+        if (nHeight < 0 || nHeight > nBestHeight)
+            throw runtime_error("Block number out of range\n");
+
+        pblockindex = RPCBlockFinder.FindByHeight(nHeight);
+
+        if (pblockindex == nullptr)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    }
+
+    StreamBlock(pblockindex, false, out);
+}
+
 UniValue backupprivatekeys(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -418,6 +818,68 @@ UniValue backupprivatekeys(const UniValue& params, bool fHelp)
     return res;
 }
 
+namespace {
+//!
+//! \brief Maximum number of outputs in one rain transaction.
+//!
+//! A rain output pays to a key hash and serializes to 34 bytes. This bound
+//! keeps the outputs of a transaction under a fifth of MAX_STANDARD_TX_SIZE
+//! and leaves the rest for the inputs that fund them.
+//!
+constexpr size_t MAX_RAIN_OUTPUTS_PER_TX = 500;
+
+//!
+//! \brief Collect the magnitudes of the CPIDs to rain on from the converged
+//! statistics.
+//!
+//! Seeks to the range of entries for the rain dimension instead of copying
+//! and scanning the whole set of statistics.
+//!
+//! \param project The project to limit the rain to, or "*" for all projects.
+//!
+//! \return CPIDs and their rounded, non-zero magnitudes, ordered by CPID.
+//!
+std::vector<std::pair<GRC::Cpid, double>> GetRainMagnitudes(const std::string& project)
+{
+    std::vector<std::pair<GRC::Cpid, double>> magnitudes;
+
+    ScraperObjectStatsKey first;
+    size_t prefix_size = 0;
+
+    if (project == "*") {
+        first.objecttype = statsobjecttype::byCPID;
+    } else {
+        // Keys of per-project entries have the form "project,cpid":
+        first.objecttype = statsobjecttype::byCPIDbyProject;
+        first.objectID = project + ",";
+        prefix_size = first.objectID.size();
+    }
+
+    LOCK(cs_ConvergedScraperStatsCache);
+
+    const ScraperStats& stats = ConvergedScraperStatsCache.mScraperConvergedStats;
+
+    for (auto iter = stats.lower_bound(first); iter != stats.end(); ++iter) {
+        const ScraperObjectStatsKey& key = iter->first;
+
+        if (key.objecttype != first.objecttype
+            || key.objectID.compare(0, prefix_size, first.objectID) != 0)
+        {
+            break;
+        }
+
+        const double magnitude = std::round(iter->second.statsvalue.dMag);
+
+        // Zero mag CPIDs do not get paid.
+        if (!magnitude) continue;
+
+        magnitudes.emplace_back(GRC::Cpid::Parse(key.objectID.substr(prefix_size)), magnitude);
+    }
+
+    return magnitudes;
+}
+} // anonymous namespace
+
 UniValue rainbymagnitude(const UniValue& params, bool fHelp)
     {
     if (fHelp || (params.size() < 2 || params.size() > 3))
@@ -428,7 +890,10 @@ UniValue rainbymagnitude(const UniValue& params, bool fHelp)
                 "<amount> --> Required: Specify amount of coins to be rained in double precision float\n"
                 "[message] -> Optional: Provide a message rained to all rainees\n"
                 "\n"
-                "rain coins by magnitude on network");
+                "rain coins by magnitude on network\n"
+                "\n"
+                "Rains to more than " + std::to_string(MAX_RAIN_OUTPUTS_PER_TX) + " recipients are split into several\n"
+                "transactions. Each transaction carries the message and pays its own fee.");
 
     UniValue res(UniValue::VOBJ);
 
@@ -454,147 +919,133 @@ UniValue rainbymagnitude(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_MISC_ERROR, "Wallet has not formed a convergence from statistics information.");
     }
 
-    ScraperStats mScraperConvergedStats;
-    {
-        LOCK(cs_ConvergedScraperStatsCache);
-
-        // Make a local copy of the cached stats in the convergence and release the lock.
-        mScraperConvergedStats = ConvergedScraperStatsCache.mScraperConvergedStats;
-    }
+    const std::vector<std::pair<GRC::Cpid, double>> vCPIDMagnitudes = GetRainMagnitudes(sProject);
 
-    LogPrint(BCLog::LogFlags::VERBOSE, "rainbymagnitude: mScraperConvergedStats size = %u", mScraperConvergedStats.size());
+    LogPrint(BCLog::LogFlags::VERBOSE, "rainbymagnitude: %u CPIDs with magnitude", vCPIDMagnitudes.size());
 
     double dTotalAmount = 0;
     int64_t nTotalAmount = 0;
 
     double dTotalMagnitude = 0;
 
-    statsobjecttype rainbymagmode = (sProject == "*" ? statsobjecttype::byCPID : statsobjecttype::byCPIDbyProject);
-
     const int64_t now = GetAdjustedTime(); // Time to calculate beacon expiration from
 
-    //------- CPID ------------- beacon address -- Mag
-    std::map<GRC::Cpid, std::pair<CBitcoinAddress, double>> mCPIDRain;
-
-    for (const auto& entry : mScraperConvergedStats)
-    {
-        // Only consider entries along the specified dimension
-        if (entry.first.objecttype == rainbymagmode)
-        {
-            GRC::Cpid CPIDKey;
-
-            if (rainbymagmode == statsobjecttype::byCPIDbyProject)
-            {
-                std::vector<std::string> vObjectStatsKey = split(entry.first.objectID, ",");
-
-                // Only process elements that match the specified project if in project level rain.
-                if (vObjectStatsKey[0] != sProject) continue;
+    //-------------------- beacon address -- Mag
+    std::vector<std::pair<CBitcoinAddress, double>> vCPIDRain;
+    vCPIDRain.reserve(vCPIDMagnitudes.size());
 
-                CPIDKey = GRC::Cpid::Parse(vObjectStatsKey[1]);
-            }
-            else
-            {
-                CPIDKey = GRC::Cpid::Parse(entry.first.objectID);
-            }
-
-            double dCPIDMag = std::round(entry.second.statsvalue.dMag);
-
-            // Zero mag CPIDs do not get paid.
-            if (!dCPIDMag) continue;
+    const GRC::BeaconRegistry& beacons = GRC::GetBeaconRegistry();
 
-            CBitcoinAddress address;
+    for (const auto& entry : vCPIDMagnitudes)
+    {
+        const GRC::BeaconOption beacon = beacons.TryActive(entry.first, now);
 
-            if (const GRC::BeaconOption beacon = GRC::GetBeaconRegistry().TryActive(CPIDKey, now))
-            {
-                address = beacon->GetAddress();
-            }
-            else
-            {
-                continue;
-            }
+        if (!beacon) continue;
 
-            LogPrint(BCLog::LogFlags::VERBOSE, "INFO: rainbymagnitude: address = %s.", address.ToString());
+        CBitcoinAddress address = beacon->GetAddress();
 
-            mCPIDRain[CPIDKey] = std::make_pair(address, dCPIDMag);
+        LogPrint(BCLog::LogFlags::VERBOSE, "rainmagnitude: CPID = %s, address = %s, dCPIDMag = %f",
+                              entry.first.ToString(), address.ToString(), entry.second);
 
-            // Increment the accumulated mag. This will be equal to the total mag of the valid CPIDs entered
-            // into the RAIN map, and will be used to normalize the payments.
-            dTotalMagnitude += dCPIDMag;
+        vCPIDRain.emplace_back(std::move(address), entry.second);
 
-            LogPrint(BCLog::LogFlags::VERBOSE, "rainmagnitude: CPID = %s, address = %s, dCPIDMag = %f",
-                                  CPIDKey.ToString(), address.ToString(), dCPIDMag);
-        }
+        // Increment the accumulated mag. This will be equal to the total mag of the valid CPIDs entered
+        // into the RAIN list, and will be used to normalize the payments.
+        dTotalMagnitude += entry.second;
     }
 
-    if (mCPIDRain.empty() || !dTotalMagnitude)
+    if (vCPIDRain.empty() || !dTotalMagnitude)
     {
         throw JSONRPCError(RPC_MISC_ERROR, "No CPIDs to pay and/or total CPID magnitude is zero. This could be caused by an incorrect project specified.");
     }
 
     std::vector<std::pair<CScript, int64_t> > vecSend;
+    vecSend.reserve(vCPIDRain.size());
 
     // Setup the payment vector now that the CPID entries and mags have been validated and the total mag is computed.
-    for(const auto& iter : mCPIDRain)
+    for (const auto& iter : vCPIDRain)
     {
-        double dCPIDMag = iter.second.second;
+        double dPayout = (iter.second / dTotalMagnitude) * dAmount;
 
-            double dPayout = (dCPIDMag / dTotalMagnitude) * dAmount;
+        dTotalAmount += dPayout;
 
-            dTotalAmount += dPayout;
+        CScript scriptPubKey;
+        scriptPubKey.SetDestination(iter.first.Get());
 
-            CScript scriptPubKey;
-            scriptPubKey.SetDestination(iter.second.first.Get());
+        int64_t nAmount = roundint64(dPayout * COIN);
+        nTotalAmount += nAmount;
 
-            int64_t nAmount = roundint64(dPayout * COIN);
-            nTotalAmount += nAmount;
+        vecSend.push_back(std::make_pair(std::move(scriptPubKey), nAmount));
 
-            vecSend.push_back(std::make_pair(scriptPubKey, nAmount));
-
-            LogPrint(BCLog::LogFlags::VERBOSE, "rainmagnitude: address = %s, amount = %f", iter.second.first.ToString(), CoinToDouble(nAmount));
+        LogPrint(BCLog::LogFlags::VERBOSE, "rainmagnitude: address = %s, amount = %f", iter.first.ToString(), CoinToDouble(nAmount));
     }
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    CWalletTx wtx;
-    wtx.mapValue["comment"] = "Rain By Magnitude";
-    wtx.vContracts.emplace_back(GRC::MakeContract<GRC::TxMessage>(
-        GRC::ContractAction::ADD,
-        "Rain By Magnitude: " + sMessage));
-
     EnsureWalletIsUnlocked();
     // Check funds
     double dBalance = pwalletMain->GetBalance();
 
     if (dTotalAmount > dBalance)
         throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Account has insufficient funds");
-    // Send
-    CReserveKey keyChange(pwalletMain);
 
-    int64_t nFeeRequired = 0;
-    bool fCreated = pwalletMain->CreateTransaction(vecSend, wtx, keyChange, nFeeRequired);
+    const size_t nTransactions = (vecSend.size() + MAX_RAIN_OUTPUTS_PER_TX - 1) / MAX_RAIN_OUTPUTS_PER_TX;
 
-    LogPrintf("Rain By Magnitude Transaction Created.");
+    int64_t nTotalFee = 0;
+    UniValue txids(UniValue::VARR);
 
-    if (!fCreated)
+    for (size_t i = 0; i < nTransactions; ++i)
     {
-        if (nTotalAmount + nFeeRequired > pwalletMain->GetBalance())
-            throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Insufficient funds");
+        const auto first = vecSend.begin() + i * MAX_RAIN_OUTPUTS_PER_TX;
+        const auto last = vecSend.begin() + std::min(vecSend.size(), (i + 1) * MAX_RAIN_OUTPUTS_PER_TX);
+        const std::vector<std::pair<CScript, int64_t>> vecSendPart(first, last);
 
-        throw JSONRPCError(RPC_WALLET_ERROR, "Transaction creation failed");
-    }
+        // Transactions committed already stay committed when a later one
+        // fails, so the error lists them:
+        const std::string sSent = txids.empty()
+            ? ""
+            : strprintf(" after sending %u of %u transactions: %s", i, nTransactions, txids.write());
 
-    LogPrintf("Committing.");
-    // Rain the recipients
-    if (!pwalletMain->CommitTransaction(wtx, keyChange))
-    {
-        LogPrintf("Rain By Magnitude Commit failed.");
+        CWalletTx wtx;
+        wtx.mapValue["comment"] = "Rain By Magnitude";
+        wtx.vContracts.emplace_back(GRC::MakeContract<GRC::TxMessage>(
+            GRC::ContractAction::ADD,
+            "Rain By Magnitude: " + sMessage));
+
+        // Send
+        CReserveKey keyChange(pwalletMain);
+
+        int64_t nFeeRequired = 0;
+        bool fCreated = pwalletMain->CreateTransaction(vecSendPart, wtx, keyChange, nFeeRequired);
+
+        if (!fCreated)
+        {
+            if (nTotalAmount + nTotalFee + nFeeRequired > pwalletMain->GetBalance())
+                throw JSONRPCError(RPC_WALLET_INSUFFICIENT_FUNDS, "Insufficient funds" + sSent);
+
+            throw JSONRPCError(RPC_WALLET_ERROR, "Transaction creation failed" + sSent);
+        }
+
+        // Rain the recipients
+        if (!pwalletMain->CommitTransaction(wtx, keyChange))
+        {
+            LogPrintf("Rain By Magnitude Commit failed.");
+
+            throw JSONRPCError(RPC_WALLET_ERROR, "Transaction commit failed" + sSent);
+        }
+
+        nTotalFee += nFeeRequired;
+        txids.push_back(wtx.GetHash().GetHex());
+
+        LogPrintf("rainbymagnitude: committed transaction %u of %u with %u recipients: %s",
+                  i + 1, nTransactions, vecSendPart.size(), wtx.GetHash().ToString());
+    }
 
-        throw JSONRPCError(RPC_WALLET_ERROR, "Transaction commit failed");
-}
     res.pushKV("Rain By Magnitude",  "Sent");
-    res.pushKV("TXID", wtx.GetHash().GetHex());
+    res.pushKV("TXID", txids[0].get_str());
+    res.pushKV("TXIDs", txids);
     res.pushKV("Rain Amount Sent", dTotalAmount);
-    res.pushKV("TX Fee", ValueFromAmount(nFeeRequired));
+    res.pushKV("TX Fee", ValueFromAmount(nTotalFee));
     res.pushKV("# of Recipients", (uint64_t)vecSend.size());
 
     if (!sMessage.empty())
@@ -747,26 +1198,67 @@ UniValue revokebeacon(const UniValue& params, bool fHelp)
 
 UniValue beaconreport(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 0)
+    if (fHelp || params.size() > 2)
         throw runtime_error(
-                "beaconreport\n"
+                "beaconreport ( count \"after_cpid\" )\n"
+                "\n"
+                "count        -> Optional: maximum number of beacons to return.\n"
+                "after_cpid   -> Optional: return beacons for CPIDs ordered after this one.\n"
                 "\n"
-                "Displays list of valid beacons in the network\n");
+                "Displays list of valid beacons in the network sorted by CPID. Pass the\n"
+                "last CPID of a page as after_cpid to request the next page.\n");
+
+    size_t count = std::numeric_limits<size_t>::max();
+
+    if (params.size() > 0) {
+        if (params[0].get_int() < 1) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count.");
+        }
+
+        count = params[0].get_int();
+    }
+
+    const GRC::CpidOption after_cpid = params.size() > 1
+        ? GRC::MiningId::Parse(params[1].get_str()).TryCpid()
+        : boost::none;
+
+    if (params.size() > 1 && !after_cpid) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid CPID.");
+    }
 
     UniValue results(UniValue::VARR);
 
-    std::vector<std::pair<GRC::Cpid, GRC::Beacon>> active_beacons;
+    typedef std::pair<GRC::Cpid, GRC::Beacon> BeaconPair;
+    std::vector<BeaconPair> active_beacons;
 
-    // Minimize the lock on cs_main.
+    const auto compare = [](const BeaconPair& a, const BeaconPair& b) {
+        return a.first < b.first;
+    };
+
+    // Minimize the lock on cs_main. The registry stores beacons in a hash map
+    // so we select the page with a bounded max-heap instead of copying every
+    // beacon in the registry:
     {
         LOCK(cs_main);
 
-        const auto& beacon_map = GRC::GetBeaconRegistry().Beacons();
+        for (const auto& beacon_pair : GRC::GetBeaconRegistry().Beacons()) {
+            if (after_cpid && !(*after_cpid < beacon_pair.first)) {
+                continue;
+            }
 
-        active_beacons.reserve(beacon_map.size());
-        active_beacons.assign(beacon_map.begin(), beacon_map.end());
+            if (active_beacons.size() < count) {
+                active_beacons.emplace_back(beacon_pair);
+                std::push_heap(active_beacons.begin(), active_beacons.end(), compare);
+            } else if (beacon_pair.first < active_beacons.front().first) {
+                std::pop_heap(active_beacons.begin(), active_beacons.end(), compare);
+                active_beacons.back() = beacon_pair;
+                std::push_heap(active_beacons.begin(), active_beacons.end(), compare);
+            }
+        }
     }
 
+    std::sort_heap(active_beacons.begin(), active_beacons.end(), compare);
+
     for (const auto& beacon_pair : active_beacons)
     {
         UniValue entry(UniValue::VOBJ);
@@ -863,24 +1355,58 @@ UniValue beaconconvergence(const UniValue& params, bool fHelp)
 
 UniValue pendingbeaconreport(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 0)
+    if (fHelp || params.size() > 2)
         throw runtime_error(
-                "pendingbeaconreport\n"
+                "pendingbeaconreport ( count \"after_key_id\" )\n"
+                "\n"
+                "count          -> Optional: maximum number of beacons to return.\n"
+                "after_key_id   -> Optional: return beacons for key IDs ordered after this one.\n"
                 "\n"
-                "Displays pending beacons directly from the beacon registry.\n");
+                "Displays pending beacons directly from the beacon registry sorted by the\n"
+                "key ID reported in the address field. Pass the last address of a page as\n"
+                "after_key_id to request the next page.\n");
+
+    size_t count = std::numeric_limits<size_t>::max();
+    boost::optional<CKeyID> after_key_id;
+
+    if (params.size() > 0) {
+        if (params[0].get_int() < 1) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid count.");
+        }
+
+        count = params[0].get_int();
+    }
+
+    if (params.size() > 1) {
+        const std::string key_id_hex = params[1].get_str();
+
+        if (key_id_hex.size() != 40 || !IsHex(key_id_hex)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid key ID.");
+        }
+
+        uint160 key_id;
+        key_id.SetHex(key_id_hex);
+
+        after_key_id = CKeyID(key_id);
+    }
 
     UniValue results(UniValue::VARR);
 
     std::vector<std::pair<CKeyID, GRC::PendingBeacon>> pending_beacons;
 
-    // Minimize the lock on cs_main.
+    // Minimize the lock on cs_main. Copy only the requested page:
     {
         LOCK(cs_main);
 
         const auto& pending_beacon_map = GRC::GetBeaconRegistry().PendingBeacons();
 
-        pending_beacons.reserve(pending_beacon_map.size());
-        pending_beacons.assign(pending_beacon_map.begin(), pending_beacon_map.end());
+        auto iter = after_key_id
+            ? pending_beacon_map.upper_bound(*after_key_id)
+            : pending_beacon_map.begin();
+
+        for (; iter != pending_beacon_map.end() && pending_beacons.size() < count; ++iter) {
+            pending_beacons.emplace_back(*iter);
+        }
     }
 
     for (const auto& pending_beacon_pair : pending_beacons)
@@ -943,7 +1469,7 @@ UniValue beaconstatus(const UniValue& params, bool fHelp)
         entry.pushKV("address", beacon->GetAddress().ToString());
         entry.pushKV("public_key", beacon->m_public_key.ToString());
         entry.pushKV("private_key_available", beacon->WalletHasPrivateKey(pwalletMain));
-        entry.pushKV("magnitude", GRC::Quorum::GetMagnitude(*cpid).Floating());
+        entry.pushKV("magnitude", ValueFromMagnitude(GRC::Quorum::GetMagnitude(*cpid)));
         entry.pushKV("verification_code", beacon->GetVerificationCode());
         entry.pushKV("is_mine", is_mine);
 
@@ -1067,6 +1593,85 @@ UniValue lifetime(const UniValue& params, bool fHelp)
     return results;
 }
 
+UniValue researchhistory(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+        throw runtime_error(
+                "researchhistory <cpid> [startheight [endheight]]\n"
+                "\n"
+                "<cpid>        -> CPID to look up\n"
+                "[startheight] -> Optional first block height to include\n"
+                "[endheight]   -> Optional last block height to include\n"
+                "\n"
+                "Displays the magnitude of a CPID in each superblock, its research\n"
+                "reward claims, and its accrual at each superblock snapshot.\n"
+                "Requires -researchindex. The index covers the blocks connected\n"
+                "since it was enabled.\n");
+
+    if (!fResearchIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Research history index not enabled. Restart with -researchindex.");
+
+    const GRC::MiningId mining_id = GRC::MiningId::Parse(params[0].get_str());
+    const GRC::CpidOption cpid = mining_id.TryCpid();
+
+    if (!cpid) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid CPID.");
+    }
+
+    const int start_height = params.size() > 1 ? params[1].get_int() : 0;
+    const int end_height = params.size() > 2 ? params[2].get_int() : std::numeric_limits<int>::max();
+
+    UniValue magnitudes(UniValue::VARR);
+    UniValue rewards(UniValue::VARR);
+    UniValue accruals(UniValue::VARR);
+
+    CTxDB txdb("r");
+
+    const bool read = GRC::ReadResearchHistory(txdb, *cpid,
+        [&](const GRC::ResearchHistoryKey& key, int64_t value) {
+            if (key.m_height < start_height) {
+                return true;
+            }
+
+            if (key.m_height > end_height) {
+                return false;
+            }
+
+            UniValue entry(UniValue::VOBJ);
+            entry.pushKV("height", key.m_height);
+
+            switch (key.m_kind) {
+                case GRC::ResearchHistoryKind::MAGNITUDE:
+                    entry.pushKV("magnitude", GRC::Magnitude::FromScaled(value).Floating());
+                    magnitudes.push_back(entry);
+                    break;
+                case GRC::ResearchHistoryKind::REWARD:
+                    entry.pushKV("amount", ValueFromAmount(value));
+                    rewards.push_back(entry);
+                    break;
+                case GRC::ResearchHistoryKind::ACCRUAL:
+                    entry.pushKV("accrual", ValueFromAmount(value));
+                    accruals.push_back(entry);
+                    break;
+            }
+
+            return true;
+        });
+
+    if (!read) {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the research history index");
+    }
+
+    UniValue res(UniValue::VOBJ);
+
+    res.pushKV("cpid", cpid->ToString());
+    res.pushKV("magnitudes", magnitudes);
+    res.pushKV("rewards", rewards);
+    res.pushKV("accruals", accruals);
+
+    return res;
+}
+
 UniValue magnitude(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -1158,12 +1763,13 @@ UniValue superblockage(const UniValue& params, bool fHelp)
 
     UniValue res(UniValue::VOBJ);
 
-    const GRC::SuperblockPtr superblock = GRC::Quorum::CurrentSuperblock();
+    const std::shared_ptr<const ChainTipView> tip = GetChainTipView();
+    const GRC::SuperblockPtr& superblock = tip->superblock;
 
     res.pushKV("Superblock Age", superblock.Age(GetAdjustedTime()));
     res.pushKV("Superblock Timestamp", TimestampToHRDate(superblock.m_timestamp));
     res.pushKV("Superblock Block Number", superblock.m_height);
-    res.pushKV("Pending Superblock Height", GRC::Quorum::PendingSuperblock().m_height);
+    res.pushKV("Pending Superblock Height", tip->pending.m_height);
 
     return res;
 }
@@ -1810,15 +2416,15 @@ UniValue getblockchaininfo(const UniValue& params, bool fHelp)
                 "\n"
                 "Displays data on current blockchain\n");
 
-    LOCK(cs_main);
+    const std::shared_ptr<const ChainTipView> tip = GetChainTipView();
 
     UniValue res(UniValue::VOBJ), diff(UniValue::VOBJ);
 
-    res.pushKV("blocks", nBestHeight);
+    res.pushKV("blocks", tip->nHeight);
     res.pushKV("in_sync", !OutOfSyncByAge());
-    res.pushKV("moneysupply", ValueFromAmount(pindexBest->nMoneySupply));
-    diff.pushKV("current", GRC::GetCurrentDifficulty());
-    diff.pushKV("target", GRC::GetTargetDifficulty());
+    res.pushKV("moneysupply", ValueFromAmount(tip->nMoneySupply));
+    diff.pushKV("current", tip->dDifficulty);
+    diff.pushKV("target", tip->dTargetDifficulty);
     res.pushKV("difficulty", diff);
     res.pushKV("testnet", fTestNet);
     res.pushKV("errors", GetWarnings("statusbar"));
@@ -1859,6 +2465,227 @@ UniValue memorypool(const UniValue& params, bool fHelp)
     return res;
 }
 
+UniValue getsigcacheinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getsigcacheinfo\n"
+                "\n"
+                "Displays signature verification cache usage and hit rate\n");
+
+    const SignatureCacheStats stats = GetSignatureCacheStats();
+    const uint64_t lookups = stats.nHits + stats.nMisses;
+
+    UniValue res(UniValue::VOBJ);
+
+    res.pushKV("entries", (uint64_t)stats.nEntries);
+    res.pushKV("max_entries", (uint64_t)stats.nMaxEntries);
+    res.pushKV("max_bytes", (uint64_t)stats.nMaxBytes);
+    res.pushKV("hits", stats.nHits);
+    res.pushKV("misses", stats.nMisses);
+    res.pushKV("hit_rate", lookups > 0 ? (double)stats.nHits / lookups : 0.0);
+    res.pushKV("inserts", stats.nInserts);
+    res.pushKV("evictions", stats.nEvictions);
+
+    return res;
+}
+
+UniValue getexecutorinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getexecutorinfo\n"
+                "\n"
+                "Displays the load of the shared thread pools that started. The\n"
+                "utilization is the share of the time since the pool started that its\n"
+                "workers spent running tasks.\n");
+
+    UniValue res(UniValue::VOBJ);
+
+    for (const auto& stats : util::GetExecutorStats()) {
+        UniValue entry(UniValue::VOBJ);
+
+        entry.pushKV("threads", (uint64_t)stats.threads);
+        entry.pushKV("active", (uint64_t)stats.active);
+        entry.pushKV("queued", (uint64_t)stats.queued);
+        entry.pushKV("completed", stats.completed);
+        entry.pushKV("stolen", stats.stolen);
+        entry.pushKV("busy_ms", stats.busy_us / 1000);
+
+        const double capacity_us = (double)stats.uptime_us * stats.threads;
+        entry.pushKV("utilization", capacity_us > 0 ? stats.busy_us / capacity_us : 0.0);
+
+        res.pushKV(stats.name, entry);
+    }
+
+    return res;
+}
+
+UniValue getmemoryinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getmemoryinfo\n"
+                "\n"
+                "Displays the estimated memory used by the major in-memory structures\n"
+                "of the node and the resident set size of the process. The estimates\n"
+                "count the container allocations and the data that they own, so they\n"
+                "fall short of the resident size by the code, the stacks and the\n"
+                "allocator fragmentation.\n");
+
+    UniValue res(UniValue::VOBJ);
+    UniValue subsystems(UniValue::VOBJ);
+    uint64_t total = 0;
+
+    for (const auto& usage : GetMemoryUsage()) {
+        UniValue entry(UniValue::VOBJ);
+
+        entry.pushKV("entries", usage.entries);
+        entry.pushKV("bytes", usage.bytes);
+
+        subsystems.pushKV(usage.name, entry);
+        total += usage.bytes;
+    }
+
+    res.pushKV("resident", GetResidentMemory());
+    res.pushKV("estimated_total", total);
+    res.pushKV("subsystems", subsystems);
+
+    return res;
+}
+
+UniValue getperfstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+                "getperfstats [reset]\n"
+                "\n"
+                "[reset] -> Clear the counters after reading them (default: false)\n"
+                "\n"
+                "Displays the durations of the instrumented code paths recorded while\n"
+                "the node runs with -perfstats. The histogram buckets count the calls\n"
+                "by duration in powers of two microseconds.\n");
+
+    const bool reset = params.size() > 0 && params[0].get_bool();
+
+    UniValue res(UniValue::VOBJ);
+    UniValue counters(UniValue::VOBJ);
+
+    res.pushKV("enabled", util::g_perf_enabled.load());
+
+    for (const auto& snapshot : util::GetPerfSnapshots()) {
+        if (snapshot.count == 0) {
+            continue;
+        }
+
+        UniValue counter(UniValue::VOBJ);
+        UniValue histogram(UniValue::VOBJ);
+
+        for (size_t i = 0; i < snapshot.histogram.size(); ++i) {
+            if (snapshot.histogram[i] > 0) {
+                const std::string bound = i + 1 < snapshot.histogram.size()
+                    ? "<" + std::to_string(uint64_t(2) << i)
+                    : ">=" + std::to_string(uint64_t(1) << i);
+
+                histogram.pushKV(bound, snapshot.histogram[i]);
+            }
+        }
+
+        counter.pushKV("count", snapshot.count);
+        counter.pushKV("total_us", snapshot.total_us);
+        counter.pushKV("average_us", snapshot.total_us / snapshot.count);
+        counter.pushKV("max_us", snapshot.max_us);
+        counter.pushKV("histogram_us", histogram);
+
+        counters.pushKV(snapshot.name, counter);
+    }
+
+    res.pushKV("counters", counters);
+
+    if (reset) {
+        util::ResetPerfCounters();
+    }
+
+    return res;
+}
+
+UniValue getlockstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+                "getlockstats [reset]\n"
+                "\n"
+                "[reset] -> Clear the statistics after reading them (default: false)\n"
+                "\n"
+                "Displays the contention of each LOCK() and TRY_LOCK() site recorded\n"
+                "while the node runs with -lockprofile, ordered by time spent waiting.\n");
+
+    const bool reset = params.size() > 0 && params[0].get_bool();
+
+    std::vector<CLockSiteStats::Snapshot> sites = GetLockProfile();
+
+    std::sort(sites.begin(), sites.end(), [](const CLockSiteStats::Snapshot& a, const CLockSiteStats::Snapshot& b) {
+        return a.nWaitUsec > b.nWaitUsec;
+    });
+
+    UniValue res(UniValue::VOBJ);
+    UniValue list(UniValue::VARR);
+
+    for (const auto& site : sites) {
+        if (site.nLocks == 0 && site.nTryFailures == 0) {
+            continue;
+        }
+
+        UniValue entry(UniValue::VOBJ);
+
+        entry.pushKV("lock", site.strName);
+        entry.pushKV("site", strprintf("%s:%d", site.strFile, site.nLine));
+        entry.pushKV("locks", site.nLocks);
+        entry.pushKV("contended", site.nContended);
+        entry.pushKV("wait_us", site.nWaitUsec);
+        entry.pushKV("max_wait_us", site.nMaxWaitUsec);
+        entry.pushKV("hold_us", site.nHoldUsec);
+        entry.pushKV("max_hold_us", site.nMaxHoldUsec);
+        entry.pushKV("try_failures", site.nTryFailures);
+
+        list.push_back(entry);
+    }
+
+    res.pushKV("enabled", g_lock_profile.load());
+    res.pushKV("sites", list);
+
+    if (reset) {
+        ResetLockProfile();
+    }
+
+    return res;
+}
+
+UniValue getorphanblockinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+                "getorphanblockinfo\n"
+                "\n"
+                "Displays usage of the pool of blocks that wait for their parents\n");
+
+    LOCK(cs_main);
+
+    const OrphanBlockStats stats = g_orphan_blocks.GetStats();
+
+    UniValue res(UniValue::VOBJ);
+
+    res.pushKV("blocks", (uint64_t)stats.nBlocks);
+    res.pushKV("bytes", (uint64_t)stats.nBytes);
+    res.pushKV("max_bytes", (uint64_t)stats.nMaxBytes);
+    res.pushKV("peers", (uint64_t)stats.nPeers);
+    res.pushKV("added", stats.nAdded);
+    res.pushKV("expired", stats.nExpired);
+    res.pushKV("evicted", stats.nEvicted);
+
+    return res;
+}
+
 UniValue networktime(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -1927,7 +2754,7 @@ UniValue SuperblockReport(int lookback, bool displaycontract, std::string cpid)
 
                 if (cpid_parsed)
                 {
-                    c.pushKV("Magnitude", superblock.m_cpids.MagnitudeOf(*cpid_parsed).Floating());
+                    c.pushKV("Magnitude", ValueFromMagnitude(superblock.m_cpids.MagnitudeOf(*cpid_parsed)));
                 }
 
                 if (displaycontract)
@@ -1950,7 +2777,7 @@ UniValue MagnitudeReport(const GRC::Cpid cpid)
     const GRC::AccrualComputer calc = GRC::Tally::GetComputer(cpid, now, pindexBest);
 
     json.pushKV("CPID", cpid.ToString());
-    json.pushKV("Magnitude (Last Superblock)", GRC::Quorum::GetMagnitude(cpid).Floating());
+    json.pushKV("Magnitude (Last Superblock)", ValueFromMagnitude(GRC::Quorum::GetMagnitude(cpid)));
     json.pushKV("Current Magnitude Unit", calc->MagnitudeUnit());
 
     json.pushKV("First Payment Time", TimestampToHRDate(account.FirstRewardTime()));
@@ -166,6 +166,10 @@ static const CRPCConvertParam vRPCConvertParams[] =
 
     // Mining
     { "advertisebeacon"        , 0 },
+    { "beaconreport"           , 0 },
+    { "pendingbeaconreport"    , 0 },
+    { "researchhistory"        , 1 },
+    { "researchhistory"        , 2 },
     { "superblocks"            , 0 },
     { "superblocks"            , 1 },
 
@@ -177,6 +181,8 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "getblockstats"          , 0 },
     { "getblockstats"          , 1 },
     { "getblockstats"          , 2 },
+    { "getlockstats"           , 0 },
+    { "getperfstats"           , 0 },
     { "inspectaccrualsnapshot" , 0 },
     { "listmanifests"          , 0 },
     { "sendalert"              , 2 },
@@ -193,10 +199,14 @@ static const CRPCConvertParam vRPCConvertParams[] =
 
     // Network
     { "getaddednodeinfo"       , 0 },
+    { "getaddresstxids"        , 1 },
+    { "getaddresstxids"        , 2 },
     { "getblock"               , 1 },
     { "getblockbynumber"       , 0 },
     { "getblockbynumber"       , 1 },
     { "getblockhash"           , 0 },
+    { "getnetmsgstats"         , 0 },
+    { "getspentinfo"           , 1 },
     { "setban"                 , 2 },
     { "setban"                 , 3 },
     { "showblock"              , 0 },
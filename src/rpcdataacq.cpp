@@ -4,6 +4,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "blockstats.h"
 #include "main.h"
 #include "rpcserver.h"
 #include "txdb.h"
@@ -96,39 +97,48 @@ UniValue rpc_getblockstats(const UniValue& params, bool fHelp)
     double diff_max=0;
     double diff_min=INT_MAX;
     int64_t super_count = 0;
+    // Collect the blocks first so that their stats load in one pass:
+    std::vector<const CBlockIndex*> vBlocks;
     for( ; (cur
             &&( cur->nHeight>=lowheight )
-            &&( blockcount<maxblocks )
+            &&( (long)vBlocks.size()<maxblocks )
         );
         cur= cur->pprev
         )
     {
-        if(cur->nHeight>highheight)
-            continue;
-        if(l_first>cur->nHeight)
+        if(cur->nHeight<=highheight)
+            vBlocks.push_back(cur);
+    }
+
+    std::vector<CBlockStats> vStats;
+    if(!LoadBlockStats(vBlocks, vStats))
+        throw runtime_error("failed to read block");
+
+    for (size_t i = 0; i < vBlocks.size(); ++i)
+    {
+        const CBlockIndex* const pindex = vBlocks[i];
+        const CBlockStats& stats = vStats[i];
+        if(l_first>pindex->nHeight)
         {
-            l_first=cur->nHeight;
-            l_first_time=cur->nTime;
+            l_first=pindex->nHeight;
+            l_first_time=pindex->nTime;
         }
-        if(l_last<cur->nHeight)
+        if(l_last<pindex->nHeight)
         {
-            l_last=cur->nHeight;
-            l_last_time=cur->nTime;
+            l_last=pindex->nHeight;
+            l_last_time=pindex->nTime;
         }
         blockcount++;
-        CBlock block;
-        if(!block.ReadFromDisk(cur->nFile,cur->nBlockPos,true))
-            throw runtime_error("failed to read block");
-        assert(block.vtx.size() > 0);
+        assert(stats.nTxCount > 0);
         unsigned txcountinblock = 0;
-        if(block.vtx.size()>=2)
+        if(stats.nTxCount>=2)
         {
-            txcountinblock+=block.vtx.size()-2;
-            if(block.vtx[1].IsCoinStake())
+            txcountinblock+=stats.nTxCount-2;
+            if(stats.fCoinStake)
             {
                 poscount++;
                 //stakeinputtotal+=block.vtx[1].vin[0].nValue;
-                double diff = GRC::GetDifficulty(cur);
+                double diff = GRC::GetDifficulty(pindex);
                 diff_sum += diff;
                 diff_max=std::max(diff_max,diff);
                 diff_min=std::min(diff_min,diff);
@@ -138,20 +148,19 @@ UniValue rpc_getblockstats(const UniValue& params, bool fHelp)
         }
         transactioncount+=txcountinblock;
         emptyblockscount+=(txcountinblock==0);
-        c_blockversion[block.nVersion]++;
-        const Claim claim = block.GetClaim();
-        c_cpid[claim.m_mining_id.ToString()]++;
-        c_org[claim.m_organization]++;
-        c_version[claim.m_client_version]++;
-        researchtotal += claim.m_research_subsidy;
-        interesttotal += claim.m_block_subsidy;
-        researchcount += claim.HasResearchReward();
-        minttotal+=cur->nMint;
-        unsigned sizeblock = GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+        c_blockversion[stats.nBlockVersion]++;
+        c_cpid[stats.m_mining_id.ToString()]++;
+        c_org[stats.m_organization]++;
+        c_version[stats.m_client_version]++;
+        researchtotal += stats.nResearchSubsidy;
+        interesttotal += stats.nBlockSubsidy;
+        researchcount += stats.HasResearchReward();
+        minttotal+=pindex->nMint;
+        unsigned sizeblock = stats.nSize;
         size_min_blk=std::min(size_min_blk,sizeblock);
         size_max_blk=std::max(size_max_blk,sizeblock);
         size_sum_blk+=sizeblock;
-        super_count += (claim.ContainsSuperblock());
+        super_count += stats.fSuperblock;
     }
 
     {
@@ -499,10 +508,22 @@ UniValue rpc_exportstats(const UniValue& params, bool fHelp)
     "fra_quorumvote cnt_quorumvote fra_quorumcur cnt_quorumcurr  "
     "avenz_magnitude  \n";
 
-    while( (blockcount < maxblocks) && cur && cur->pprev )
+    // Collect the blocks first so that their stats load in one pass:
+    std::vector<const CBlockIndex*> vBlocks;
+    for( ; cur && cur->pprev && ((long)vBlocks.size() < maxblocks); cur = cur->pprev )
     {
-        if(cur->nHeight>endblock)
-            continue;
+        if(cur->nHeight<=endblock)
+            vBlocks.push_back(cur);
+    }
+
+    std::vector<CBlockStats> vStats;
+    if(!LoadBlockStats(vBlocks, vStats))
+        throw runtime_error("failed to read block");
+
+    for (size_t i = 0; i < vBlocks.size(); ++i)
+    {
+        const CBlockIndex* const cur = vBlocks[i];
+        const CBlockStats& stats = vStats[i];
 
         double i_diff = GRC::GetDifficulty(cur);
         sum_diff= sum_diff + i_diff;
@@ -517,29 +538,24 @@ UniValue rpc_exportstats(const UniValue& params, bool fHelp)
         cnt_investor += !! (cur->nFlags & CBlockIndex::INVESTOR_CPID);
         cnt_contract += !! cur->nIsContract;
 
-        CBlock block;
-        if(!block.ReadFromDisk(cur->nFile,cur->nBlockPos,true))
-            throw runtime_error("failed to read block");
-
-        cnt_trans += block.vtx.size()-2; /* 2 transactions are special */
-        cnt_empty += ( block.vtx.size()<=2 );
-        double i_size = GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+        cnt_trans += stats.nTxCount-2; /* 2 transactions are special */
+        cnt_empty += ( stats.nTxCount<=2 );
+        double i_size = stats.nSize;
         sum_size= sum_size + i_size;
         min_size=std::min(min_size,i_size);
         max_size=std::max(max_size,i_size);
 
-        const Claim& claim = block.GetClaim();
-        cnt_quorumvote += (claim.m_quorum_hash.Valid());
-        if (claim.m_quorum_hash.Valid()
-            && claim.m_quorum_hash != "d41d8cd98f00b204e9800998ecf8427e")
+        cnt_quorumvote += (stats.m_quorum_hash.Valid());
+        if (stats.m_quorum_hash.Valid()
+            && stats.m_quorum_hash != "d41d8cd98f00b204e9800998ecf8427e")
         {
             cnt_quorumcurr += 1;
         }
 
-        const double i_research = claim.m_research_subsidy;
+        const double i_research = stats.nResearchSubsidy;
         sum_research= sum_research + i_research;
         max_research=std::max(max_research,i_research);
-        const double i_interest = claim.m_block_subsidy;
+        const double i_interest = stats.nBlockSubsidy;
         sum_interest= sum_interest + i_interest;
         max_interest=std::max(max_interest,i_interest);
 
@@ -606,8 +622,6 @@ UniValue rpc_exportstats(const UniValue& params, bool fHelp)
             cnt_quorumcurr = 0;
             cnt_contract = 0;
         }
-        /* This is very important */
-        cur = cur->pprev;
     }
 
     result1.pushKV("file", o_path.string());
@@ -642,12 +656,25 @@ UniValue rpc_getrecentblocks(const UniValue& params, bool fHelp)
         cur= pindexBest;
     }
 
+    std::vector<const CBlockIndex*> vBlocks;
     for( ; (cur
             &&( blockcount<maxblocks )
         );
         cur= cur->pprev, ++blockcount
         )
     {
+        vBlocks.push_back(cur);
+    }
+
+    const bool fStats = (detail<100 && detail>=20) || (detail>=120);
+    std::vector<CBlockStats> vStats;
+    if(fStats && !LoadBlockStats(vBlocks, vStats))
+        throw runtime_error("failed to read block");
+
+    for (size_t i = 0; i < vBlocks.size(); ++i)
+    {
+        const CBlockIndex* const cur = vBlocks[i];
+
         /* detail:
             0 height: hash
             1 height: hash diff spacing, flg
@@ -701,35 +728,31 @@ UniValue rpc_getrecentblocks(const UniValue& params, bool fHelp)
             result2.pushKV("magnitude", cur->nMagnitude );
         }
 
-        if( (detail<100 && detail>=20) || (detail>=120) )
+        if(fStats)
         {
-            CBlock block;
-            if(!block.ReadFromDisk(cur->nFile,cur->nBlockPos,true))
-                throw runtime_error("failed to read block");
-            //assert(block.vtx.size() > 0);
-            const Claim& claim = block.GetClaim();
+            const CBlockStats& stats = vStats[i];
 
             if(detail<100)
             {
                 if(detail>=20)
                 {
-                    line+="<|>"+claim.m_organization
-                        + "<|>"+claim.m_client_version
-                        + "<|>"+ToString(block.vtx.size()-2);
+                    line+="<|>"+stats.m_organization
+                        + "<|>"+stats.m_client_version
+                        + "<|>"+ToString(stats.nTxCount-2);
                 }
                 if(detail==21)
                 {
-                    line+="<|>"+claim.m_mining_id.ToString()
-                        + "<|>"+(claim.m_quorum_hash.Valid() ? claim.m_quorum_hash.ToString() : "--");
+                    line+="<|>"+stats.m_mining_id.ToString()
+                        + "<|>"+(stats.m_quorum_hash.Valid() ? stats.m_quorum_hash.ToString() : "--");
                 }
             }
             else
             {
-                result2.pushKV("organization", claim.m_organization);
-                result2.pushKV("cversion", claim.m_client_version);
-                result2.pushKV("quorum_hash", claim.m_quorum_hash.ToString());
-                result2.pushKV("superblocksize", claim.m_quorum_hash.ToString());
-                result2.pushKV("vtxsz", (int64_t)block.vtx.size() );
+                result2.pushKV("organization", stats.m_organization);
+                result2.pushKV("cversion", stats.m_client_version);
+                result2.pushKV("quorum_hash", stats.m_quorum_hash.ToString());
+                result2.pushKV("superblocksize", stats.m_quorum_hash.ToString());
+                result2.pushKV("vtxsz", (int64_t)stats.nTxCount );
             }
         }
         if(detail<100)
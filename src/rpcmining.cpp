@@ -75,6 +75,11 @@ UniValue getmininginfo(const UniValue& params, bool fHelp)
         obj.pushKV("mining-created", g_miner_status.CreatedCnt);
         obj.pushKV("mining-accepted", g_miner_status.AcceptedCnt);
         obj.pushKV("mining-kernels-found", g_miner_status.KernelsFound);
+        obj.pushKV("mining-rounds", g_miner_status.m_rounds);
+        obj.pushKV("mining-round-time-ms", g_miner_status.m_last_round_usec / 1000.0);
+        obj.pushKV("mining-round-time-avg-ms", g_miner_status.m_rounds > 0
+            ? g_miner_status.m_total_round_usec / 1000.0 / g_miner_status.m_rounds
+            : 0.0);
     }
 
     int64_t nMinStakeSplitValue = 0;
@@ -256,13 +261,11 @@ UniValue auditsnapshotaccrual(const UniValue& params, bool fHelp)
 
     for (; pindex && pindex->nHeight > max_depth; pindex = pindex->pprev);
 
-    for (const CBlockIndex* pindex_superblock = pindex;
-        pindex_superblock;
-        pindex_superblock = pindex_superblock->pprev)
-    {
-        if (pindex_superblock->nIsSuperBlock == 1) {
+    if (pindex) {
+        if (const CBlockIndex* pindex_superblock
+            = GRC::Quorum::FindSuperblockBefore(pindex->nHeight + 1))
+        {
             superblock = SuperblockPtr::ReadFromDisk(pindex_superblock);
-            break;
         }
     }
 
@@ -405,40 +408,88 @@ UniValue comparesnapshotaccrual(const UniValue& params, bool fHelp)
     return result;
 }
 
+namespace {
+//!
+//! \brief Stream the records of an accrual snapshot file into a JSON object.
+//!
+//! \param reader Reads the snapshot file to convert.
+//!
+//! \return The version, height and records of the snapshot sorted by CPID.
+//!
+UniValue AccrualSnapshotToJson(AccrualSnapshotReader& reader)
+{
+    uint32_t version;
+    uint64_t height;
+
+    UniValue records_out(UniValue::VOBJ);
+    std::vector<std::pair<Cpid, int64_t>> unsorted_records;
+
+    // Snapshots in the current format store the records sorted by CPID, so
+    // we only need to collect and sort the records of older snapshots:
+    //
+    reader.ReadEach(version, height, [&](const Cpid& cpid, const int64_t accrual) {
+        if (version >= AccrualSnapshot::SORTED_VERSION) {
+            records_out.pushKV(cpid.ToString(), ValueFromAmount(accrual));
+        } else {
+            unsorted_records.emplace_back(cpid, accrual);
+        }
+    });
+
+    std::sort(unsorted_records.begin(), unsorted_records.end());
+
+    for (const auto& record_pair : unsorted_records) {
+        records_out.pushKV(record_pair.first.ToString(), ValueFromAmount(record_pair.second));
+    }
+
+    UniValue result(UniValue::VOBJ);
+
+    result.pushKV("version", (uint64_t)version);
+    result.pushKV("height", height);
+    result.pushKV("records", records_out);
+
+    return result;
+}
+} // anonymous namespace
+
 UniValue inspectaccrualsnapshot(const UniValue& params, bool fHelp)
 {
-    if (fHelp || params.size() > 1)
+    if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
-            "inspectaccrualsnapshot <height>\n"
+            "inspectaccrualsnapshot <height> [cpid]\n"
             "\n"
-            "<height> --> block height (and file name) of the snapshot"
+            "<height> --> block height (and file name) of the snapshot\n"
+            "[cpid] ----> optional: only display the accrual of this CPID"
             "\n"
             "Display the contents of an accrual snapshot from accrual repository on disk.\n");
 
 
-    const fs::path snapshot_path = SnapshotPath(params[0].get_int());
-    const AccrualSnapshot snapshot = AccrualSnapshotReader(snapshot_path).Read();
+    const uint64_t height = params[0].get_int();
+    const fs::path snapshot_path = SnapshotPath(height);
 
-    UniValue result(UniValue::VOBJ);
+    AccrualSnapshotReader reader(snapshot_path);
 
-    result.pushKV("version", (uint64_t)snapshot.m_version);
-    result.pushKV("height", snapshot.m_height);
+    if (reader.IsNull()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "No snapshot exists at the specified height.");
+    }
 
-    const AccrualSnapshot::AccrualMap& records = snapshot.m_records;
-    const std::map<Cpid, int64_t> sorted_records(records.begin(), records.end());
+    if (params.size() > 1) {
+        const GRC::MiningId mining_id = GRC::MiningId::Parse(params[1].get_str());
+        const GRC::CpidOption cpid = mining_id.TryCpid();
 
-    UniValue records_out(UniValue::VOBJ);
+        if (!cpid) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid CPID.");
+        }
 
-    for (const auto& record_pair : sorted_records) {
-        const Cpid& cpid = record_pair.first;
-        const int64_t accrual = record_pair.second;
+        UniValue result(UniValue::VOBJ);
 
-        records_out.pushKV(cpid.ToString(), ValueFromAmount(accrual));
-    }
+        result.pushKV("height", height);
+        result.pushKV("cpid", cpid->ToString());
+        result.pushKV("accrual", ValueFromAmount(reader.FindAccrual(*cpid)));
 
-    result.pushKV("records", records_out);
+        return result;
+    }
 
-    return result;
+    return AccrualSnapshotToJson(reader);
 }
 
 UniValue parseaccrualsnapshotfile(const UniValue& params, bool fHelp)
@@ -451,8 +502,6 @@ UniValue parseaccrualsnapshotfile(const UniValue& params, bool fHelp)
                 "\n"
                 "Parses accrual snapshot from a valid snapshot file.\n");
 
-    UniValue res(UniValue::VOBJ);
-
     boost::filesystem::path snapshot_path = params[0].get_str();
 
     if (!boost::filesystem::is_regular_file(snapshot_path))
@@ -460,22 +509,7 @@ UniValue parseaccrualsnapshotfile(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid snapshot file specified.");
     }
 
-    const AccrualSnapshot snapshot = AccrualSnapshotReader(snapshot_path).Read();
-    const AccrualSnapshot::AccrualMap& records = snapshot.m_records;
-    const std::map<Cpid, int64_t> sorted_records(records.begin(), records.end());
-
-    UniValue accruals(UniValue::VOBJ);
-
-    for (const auto& iter : sorted_records)
-    {
-        UniValue entry(UniValue::VOBJ);
-
-        accruals.pushKV(iter.first.ToString(), ValueFromAmount(iter.second));
-    }
-
-    res.pushKV("version", (uint64_t) snapshot.m_version);
-    res.pushKV("height", snapshot.m_height);
-    res.pushKV("records", accruals);
+    AccrualSnapshotReader reader(snapshot_path);
 
-    return res;
+    return AccrualSnapshotToJson(reader);
 }
@@ -359,6 +359,24 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
         obj.pushKV("startingheight", stats.nStartingHeight);
         obj.pushKV("nTrust", stats.nTrust);
         obj.pushKV("banscore", stats.nMisbehavior);
+        obj.pushKV("sendqueuebytes", (uint64_t)stats.nSendQueueSize);
+        obj.pushKV("recvqueuebytes", (uint64_t)stats.nRecvQueueSize);
+
+        UniValue sent_per_msg(UniValue::VOBJ);
+        UniValue recv_per_msg(UniValue::VOBJ);
+
+        for (const auto& entry : stats.mapMsgStats) {
+            if (entry.second.nBytesSent > 0) {
+                sent_per_msg.pushKV(entry.first, entry.second.nBytesSent);
+            }
+
+            if (entry.second.nBytesRecv > 0) {
+                recv_per_msg.pushKV(entry.first, entry.second.nBytesRecv);
+            }
+        }
+
+        obj.pushKV("bytessent_per_msg", sent_per_msg);
+        obj.pushKV("bytesrecv_per_msg", recv_per_msg);
 
         ret.push_back(obj);
     }
@@ -373,15 +391,92 @@ UniValue getnettotals(const UniValue& params, bool fHelp)
                 "getnettotals\n"
                 "\n"
                 "Returns information about network traffic, including bytes in, bytes out,\n"
-                "and current time\n");
+                "the bytes waiting in the peer queues, and current time\n");
+
+    vector<CNodeStats> vstats;
+    CNode::CopyNodeStats(vstats);
+
+    uint64_t nSendQueueSize = 0;
+    uint64_t nRecvQueueSize = 0;
+
+    for (const auto& stats : vstats) {
+        nSendQueueSize += stats.nSendQueueSize;
+        nRecvQueueSize += stats.nRecvQueueSize;
+    }
 
     UniValue obj(UniValue::VOBJ);
     obj.pushKV("totalbytesrecv", CNode::GetTotalBytesRecv());
     obj.pushKV("totalbytessent", CNode::GetTotalBytesSent());
+    obj.pushKV("sendqueuebytes", nSendQueueSize);
+    obj.pushKV("recvqueuebytes", nRecvQueueSize);
+
+    const ReceiveBufferPoolStats pool_stats = g_recv_buffers.GetStats();
+    UniValue pool(UniValue::VOBJ);
+
+    pool.pushKV("buffers", (uint64_t)pool_stats.nBuffers);
+    pool.pushKV("bytes", (uint64_t)pool_stats.nBytes);
+    pool.pushKV("hits", pool_stats.nHits);
+    pool.pushKV("misses", pool_stats.nMisses);
+
+    obj.pushKV("recvbufferpool", pool);
     obj.pushKV("timemillis", GetTimeMillis());
     return obj;
 }
 
+UniValue getnetmsgstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+                "getnetmsgstats [peerid]\n"
+                "\n"
+                "[peerid] -> Optional. Only report the messages of this peer.\n"
+                "\n"
+                "Returns the traffic counters of each message command since startup\n"
+                "or since the peer connected. Time values are in microseconds.\n");
+
+    MessageStatsMap mapMsgStats;
+
+    if (params.size() > 0) {
+        const NodeId id = params[0].get_int();
+        bool fFound = false;
+
+        vector<CNodeStats> vstats;
+        CNode::CopyNodeStats(vstats);
+
+        for (auto& stats : vstats) {
+            if (stats.id == id) {
+                mapMsgStats = std::move(stats.mapMsgStats);
+                fFound = true;
+                break;
+            }
+        }
+
+        if (!fFound) {
+            throw JSONRPCError(RPC_CLIENT_NODE_NOT_CONNECTED, "Node not found in connected nodes");
+        }
+    } else {
+        mapMsgStats = CNode::GetTotalMessageStats();
+    }
+
+    UniValue obj(UniValue::VOBJ);
+
+    for (const auto& entry : mapMsgStats) {
+        const CMessageStats& stats = entry.second;
+        UniValue msg(UniValue::VOBJ);
+
+        msg.pushKV("msgsrecv", stats.nMsgsRecv);
+        msg.pushKV("bytesrecv", stats.nBytesRecv);
+        msg.pushKV("msgssent", stats.nMsgsSent);
+        msg.pushKV("bytessent", stats.nBytesSent);
+        msg.pushKV("processtime", stats.nProcessTimeUsec);
+        msg.pushKV("avgprocesstime", stats.nMsgsRecv > 0 ? stats.nProcessTimeUsec / (int64_t)stats.nMsgsRecv : 0);
+
+        obj.pushKV(entry.first, msg);
+    }
+
+    return obj;
+}
+
 
 
 // ppcoin: send alert.
@@ -62,6 +62,17 @@ std::string rfc1123Time()
     return std::string(buffer);
 }
 
+static const char* HTTPStatusString(int nStatus)
+{
+    if (nStatus == HTTP_OK) return "OK";
+    if (nStatus == HTTP_BAD_REQUEST) return "Bad Request";
+    if (nStatus == HTTP_FORBIDDEN) return "Forbidden";
+    if (nStatus == HTTP_NOT_FOUND) return "Not Found";
+    if (nStatus == HTTP_INTERNAL_SERVER_ERROR) return "Internal Server Error";
+    if (nStatus == HTTP_SERVICE_UNAVAILABLE) return "Service Unavailable";
+    return "";
+}
+
 std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive)
 {
     if (nStatus == HTTP_UNAUTHORIZED)
@@ -81,13 +92,6 @@ std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive)
             "</HEAD>\r\n"
             "<BODY><H1>401 Unauthorized.</H1></BODY>\r\n"
             "</HTML>\r\n", rfc1123Time().c_str(), FormatFullVersion().c_str());
-    const char *cStatus;
-         if (nStatus == HTTP_OK) cStatus = "OK";
-    else if (nStatus == HTTP_BAD_REQUEST) cStatus = "Bad Request";
-    else if (nStatus == HTTP_FORBIDDEN) cStatus = "Forbidden";
-    else if (nStatus == HTTP_NOT_FOUND) cStatus = "Not Found";
-    else if (nStatus == HTTP_INTERNAL_SERVER_ERROR) cStatus = "Internal Server Error";
-    else cStatus = "";
     return strprintf(
             "HTTP/1.1 %d %s\r\n"
             "Date: %s\r\n"
@@ -98,7 +102,7 @@ std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive)
             "\r\n"
             "%s",
         nStatus,
-        cStatus,
+        HTTPStatusString(nStatus),
         rfc1123Time(),
         keepalive ? "keep-alive" : "close",
         strMsg.size(),
@@ -106,6 +110,28 @@ std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive)
         strMsg);
 }
 
+std::string HTTPChunkedReplyHeader(int nStatus, bool keepalive)
+{
+    return strprintf(
+            "HTTP/1.1 %d %s\r\n"
+            "Date: %s\r\n"
+            "Connection: %s\r\n"
+            "Transfer-Encoding: chunked\r\n"
+            "Content-Type: application/json\r\n"
+            "Server: gridcoin-json-rpc/%s\r\n"
+            "\r\n",
+        nStatus,
+        HTTPStatusString(nStatus),
+        rfc1123Time(),
+        keepalive ? "keep-alive" : "close",
+        FormatFullVersion());
+}
+
+std::string HTTPChunk(const std::string& strData)
+{
+    return strprintf("%x\r\n", strData.size()) + strData + "\r\n";
+}
+
 int ReadHTTPHeaders(std::basic_istream<char>& stream, std::map<std::string, std::string>& mapHeadersRet)
 {
     int nLen = 0;
@@ -181,6 +207,34 @@ int ReadHTTPStatus(std::basic_istream<char>& stream, int &proto)
     return atoi(vWords[1].c_str());
 }
 
+//! Read the body of a reply sent with the chunked transfer encoding.
+static bool ReadHTTPChunks(std::basic_istream<char>& stream, std::string& strMessageRet)
+{
+    std::string str;
+
+    while (std::getline(stream, str))
+    {
+        // Stops at the CR or at a chunk extension:
+        const size_t nChunk = strtoul(str.c_str(), NULL, 16);
+
+        if (nChunk == 0)
+            return (bool)std::getline(stream, str); // No trailers.
+
+        if (nChunk > MAX_SIZE - strMessageRet.size())
+            return false;
+
+        const size_t nOffset = strMessageRet.size();
+        strMessageRet.resize(nOffset + nChunk);
+        stream.read(&strMessageRet[nOffset], nChunk);
+
+        // Skip the CRLF after the data:
+        if (!std::getline(stream, str))
+            return false;
+    }
+
+    return false;
+}
+
 int ReadHTTPMessage(std::basic_istream<char>& stream, std::map<std::string,
                     std::string>& mapHeadersRet, std::string& strMessageRet,
                     int nProto)
@@ -194,7 +248,14 @@ int ReadHTTPMessage(std::basic_istream<char>& stream, std::map<std::string,
         return HTTP_INTERNAL_SERVER_ERROR;
 
     // Read message
-    if (nLen > 0)
+    const auto encoding = mapHeadersRet.find("transfer-encoding");
+
+    if (encoding != mapHeadersRet.end() && encoding->second == "chunked")
+    {
+        if (!ReadHTTPChunks(stream, strMessageRet))
+            return HTTP_INTERNAL_SERVER_ERROR;
+    }
+    else if (nLen > 0)
     {
         std::vector<char> vch(nLen);
         stream.read(&vch[0], nLen);
@@ -258,3 +319,96 @@ UniValue JSONRPCError(int code, const std::string& message)
     error.pushKV("message", message);
     return error;
 }
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t flush_bytes)
+    : m_sink(std::move(sink))
+    , m_flush_bytes(flush_bytes)
+    , m_after_key(false)
+    , m_started(false)
+{
+    m_buffer.reserve(flush_bytes + flush_bytes / 4);
+}
+
+void JSONStreamWriter::Separate()
+{
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+
+    if (!m_first.empty()) {
+        if (!m_first.back()) m_buffer += ',';
+        m_first.back() = false;
+    }
+}
+
+void JSONStreamWriter::MaybeFlush()
+{
+    if (m_buffer.size() >= m_flush_bytes) Flush();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    m_buffer += '{';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    m_buffer += '}';
+    m_first.pop_back();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    m_buffer += '[';
+    m_first.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    m_buffer += ']';
+    m_first.pop_back();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    Separate();
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separate();
+    m_buffer += value.write();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Raw(const std::string& text)
+{
+    m_buffer += text;
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Flush()
+{
+    if (m_buffer.empty()) return;
+
+    m_started = true;
+    m_sink(m_buffer);
+    m_buffer.clear();
+}
+
+std::string JSONStreamWriter::TakeBuffer()
+{
+    std::string buffer;
+    buffer.swap(m_buffer);
+
+    return buffer;
+}
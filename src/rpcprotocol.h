@@ -5,10 +5,12 @@
 
 #pragma once
 
+#include <functional>
 #include <list>
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 #include <boost/iostreams/concepts.hpp>
 #include <boost/iostreams/stream.hpp>
 #include <boost/asio.hpp>
@@ -37,6 +39,7 @@ enum HTTPStatusCode
     HTTP_FORBIDDEN             = 403,
     HTTP_NOT_FOUND             = 404,
     HTTP_INTERNAL_SERVER_ERROR = 500,
+    HTTP_SERVICE_UNAVAILABLE   = 503,
 };
 
 // Bitcoin RPC error codes
@@ -182,6 +185,10 @@ private:
 
 std::string HTTPPost(const std::string& strMsg, const std::map<std::string,std::string>& mapRequestHeaders);
 std::string HTTPReply(int nStatus, const std::string& strMsg, bool keepalive);
+/** Header of a reply whose body follows with chunked transfer encoding. */
+std::string HTTPChunkedReplyHeader(int nStatus, bool keepalive);
+/** Encode data as one chunk of a chunked reply. Empty data ends the reply. */
+std::string HTTPChunk(const std::string& strData);
 bool ReadHTTPRequestLine(std::basic_istream<char>& stream, int &proto,
                          std::string& http_method, std::string& http_uri);
 int ReadHTTPStatus(std::basic_istream<char>& stream, int &proto);
@@ -193,3 +200,66 @@ UniValue JSONRPCReplyObj(const UniValue& result, const UniValue& error, const Un
 std::string JSONRPCReply(const UniValue& result, const UniValue& error, const UniValue& id);
 UniValue JSONRPCError(int code, const std::string& message);
 
+/**
+ * Writes a JSON document piece by piece and passes the text to a sink in
+ * chunks of about the configured size. An RPC that streams its result holds
+ * only the pieces not yet written instead of the complete UniValue tree and
+ * its serialized copy.
+ *
+ * The writer inserts the separators. It does not validate the structure of
+ * the document.
+ */
+class JSONStreamWriter
+{
+public:
+    typedef std::function<void(const std::string&)> Sink;
+
+    /**
+     * @param sink        Receives the text written so far when the buffer
+     *                    reaches flush_bytes and on Flush().
+     * @param flush_bytes Size of the buffered text that triggers the sink.
+     */
+    JSONStreamWriter(Sink sink, size_t flush_bytes = 64 * 1024);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    /** Write the key of the next member of an object. */
+    void Key(const std::string& key);
+
+    /** Write a complete value, for example a small object. */
+    void Value(const UniValue& value);
+
+    /** Write a member of an object. */
+    void KV(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    /** Append text verbatim. */
+    void Raw(const std::string& text);
+
+    /** Pass the buffered text to the sink. */
+    void Flush();
+
+    /** Whether the sink received any text yet. */
+    bool Started() const { return m_started; }
+
+    /** Take the buffered text without passing it to the sink. */
+    std::string TakeBuffer();
+
+private:
+    Sink m_sink;
+    const size_t m_flush_bytes;
+    std::string m_buffer;
+    std::vector<bool> m_first; //!< Whether each open object or array is still empty.
+    bool m_after_key;
+    bool m_started;
+
+    void Separate();
+    void MaybeFlush();
+};
+
@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "addressindex.h"
 #include "init.h"
 #include "main.h"
 #include "gridcoin/beacon.h"
@@ -1026,6 +1027,15 @@ UniValue scanforunspent(const UniValue& params, bool fHelp)
 
     std::unordered_multimap<int64_t, std::pair<uint256, unsigned int>> uMultisig;
 
+    // With the compact block filter index, only read the blocks that may
+    // contain outputs to the address:
+    GCSFilter::Element filterElement;
+    {
+        CScript scriptAddress;
+        scriptAddress.SetDestination(Address.Get());
+        filterElement.assign(scriptAddress.begin(), scriptAddress.end());
+    }
+
     {
         LOCK(cs_main);
 
@@ -1036,10 +1046,20 @@ UniValue scanforunspent(const UniValue& params, bool fHelp)
         if (!pblkindex)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
+        CTxDB txdbFilter("r");
+
         while (pblkindex->nHeight < nBlockEnd)
         {
             pblkindex = pblkindex->pnext;
 
+            BlockFilter filter;
+            if (fBlockFilterIndex
+                && txdbFilter.ReadBlockFilter(pblkindex->GetBlockHash(), filter)
+                && !filter.GetFilter().Match(filterElement))
+            {
+                continue;
+            }
+
             CBlock block;
 
             if (!block.ReadFromDisk(pblkindex, true))
@@ -1617,3 +1637,169 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp)
 
     return hashTx.GetHex();
 }
+
+namespace {
+//! Get the address index key of an address parameter.
+uint160 AddressIndexHashFromParam(const UniValue& param)
+{
+    if (!fAddressIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index not enabled. Restart with -addressindex.");
+
+    CBitcoinAddress address(param.get_str());
+
+    if (!address.IsValid())
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid Gridcoin Address");
+
+    CScript script;
+    script.SetDestination(address.Get());
+
+    return GetAddressIndexHash(script);
+}
+} // anonymous namespace
+
+UniValue getaddressbalance(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+                "getaddressbalance <address>\n"
+                "\n"
+                "<address> -> Address to sum the outputs of\n"
+                "\n"
+                "Returns the balance and the total received amount of an address.\n"
+                "Requires -addressindex. The index covers the blocks connected\n"
+                "since it was enabled.\n");
+
+    const uint160 hashScript = AddressIndexHashFromParam(params[0]);
+
+    int64_t nBalance = 0;
+    int64_t nReceived = 0;
+
+    CTxDB txdb("r");
+
+    if (!ReadAddressHistory(txdb, hashScript, [&](const CAddressIndexKey& key, int64_t nValue) {
+            nBalance += nValue;
+
+            if (!key.fSpending)
+                nReceived += nValue;
+
+            return true;
+        }))
+    {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    }
+
+    UniValue result(UniValue::VOBJ);
+
+    result.pushKV("balance", ValueFromAmount(nBalance));
+    result.pushKV("received", ValueFromAmount(nReceived));
+
+    return result;
+}
+
+UniValue getaddresstxids(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() < 1 || params.size() > 3)
+        throw runtime_error(
+                "getaddresstxids <address> [start] [end]\n"
+                "\n"
+                "<address> -> Address to list the transactions of\n"
+                "[start] ---> Lowest block height to include\n"
+                "[end] -----> Highest block height to include\n"
+                "\n"
+                "Returns the IDs of the transactions that paid or spent from an\n"
+                "address in order of block height. Requires -addressindex.\n");
+
+    const uint160 hashScript = AddressIndexHashFromParam(params[0]);
+    const int nStart = params.size() > 1 ? params[1].get_int() : 0;
+    const int nEnd = params.size() > 2 ? params[2].get_int() : std::numeric_limits<int>::max();
+
+    UniValue result(UniValue::VARR);
+    uint256 hashLast;
+
+    CTxDB txdb("r");
+
+    if (!ReadAddressHistory(txdb, hashScript, [&](const CAddressIndexKey& key, int64_t) {
+            if (key.nHeight > nEnd)
+                return false;
+
+            // The entries of one transaction are adjacent:
+            if (key.nHeight >= nStart && key.txid != hashLast) {
+                result.push_back(key.txid.GetHex());
+                hashLast = key.txid;
+            }
+
+            return true;
+        }))
+    {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    }
+
+    return result;
+}
+
+UniValue getaddressutxos(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+                "getaddressutxos <address>\n"
+                "\n"
+                "<address> -> Address to list the unspent outputs of\n"
+                "\n"
+                "Returns the unspent outputs of an address. Requires -addressindex.\n");
+
+    const uint160 hashScript = AddressIndexHashFromParam(params[0]);
+
+    UniValue result(UniValue::VARR);
+
+    CTxDB txdb("r");
+
+    if (!ReadAddressUnspent(txdb, hashScript, [&](const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+            UniValue entry(UniValue::VOBJ);
+
+            entry.pushKV("txid", key.outpoint.hash.GetHex());
+            entry.pushKV("vout", (int)key.outpoint.n);
+            entry.pushKV("amount", ValueFromAmount(value.nValue));
+            entry.pushKV("scriptPubKey", HexStr(value.script.begin(), value.script.end()));
+            entry.pushKV("height", value.nHeight);
+
+            result.push_back(entry);
+
+            return true;
+        }))
+    {
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to read the address index");
+    }
+
+    return result;
+}
+
+UniValue getspentinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 2)
+        throw runtime_error(
+                "getspentinfo <txid> <vout>\n"
+                "\n"
+                "<txid> -> Transaction that contains the output\n"
+                "<vout> -> Position of the output\n"
+                "\n"
+                "Returns the input that spent an output. Requires -spentindex.\n");
+
+    if (!fSpentIndex)
+        throw JSONRPCError(RPC_MISC_ERROR, "Spent index not enabled. Restart with -spentindex.");
+
+    const COutPoint prevout(ParseHashV(params[0], "txid"), params[1].get_int());
+    CSpentIndexValue spent;
+
+    CTxDB txdb("r");
+
+    if (!ReadSpentIndex(txdb, prevout, spent))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unable to get spent info");
+
+    UniValue result(UniValue::VOBJ);
+
+    result.pushKV("txid", spent.txid.GetHex());
+    result.pushKV("index", (int)spent.nInput);
+    result.pushKV("height", spent.nHeight);
+
+    return result;
+}
@@ -7,6 +7,7 @@
 #include "sync.h"
 #include "ui_interface.h"
 #include "base58.h"
+#include "gridcoin/magnitude.h"
 #include "rpcserver.h"
 #include "rpcclient.h"
 #include "rpcprotocol.h"
@@ -23,10 +24,14 @@
 #include <boost/asio/ssl.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/shared_ptr.hpp>
+#include <deque>
+#include <functional>
 #include <list>
 #include <algorithm>
 
+#include <atomic>
 #include <memory>
+#include <sstream>
 
 using namespace std;
 using namespace boost;
@@ -111,11 +116,17 @@ int64_t AmountFromValue(const UniValue& value)
 
 UniValue ValueFromAmount(int64_t amount)
 {
-    bool sign = amount < 0;
-    int64_t n_abs = (sign ? -amount : amount);
-    int64_t quotient = n_abs / COIN;
-    int64_t remainder = n_abs % COIN;
-    return UniValue(UniValue::VNUM, strprintf("%s%d.%08d", sign ? "-" : "", quotient, remainder));
+    UniValue value;
+    value.setFixed(amount, 8);
+    return value;
+}
+
+UniValue ValueFromMagnitude(const GRC::Magnitude magnitude)
+{
+    // Matches the output of the double from Magnitude::Floating():
+    UniValue value;
+    value.setFixed(magnitude.Scaled(), 2, true);
+    return value;
 }
 
 
@@ -359,6 +370,7 @@ static const CRPCCommand vRPCCommands[] =
     { "myneuralhash",            &myneuralhash,            cat_mining        },
     { "neuralhash",              &neuralhash,              cat_mining        },
     { "pendingbeaconreport",     &pendingbeaconreport,     cat_mining        },
+    { "researchhistory",         &researchhistory,         cat_mining        },
     { "resetcpids",              &resetcpids,              cat_mining        },
     { "revokebeacon",            &revokebeacon,            cat_mining        },
     { "superblockage",           &superblockage,           cat_mining        },
@@ -373,8 +385,14 @@ static const CRPCCommand vRPCCommands[] =
     { "debug10",                 &debug10,                 cat_developer     },
     { "exportstats1",            &rpc_exportstats,         cat_developer     },
     { "getblockstats",           &rpc_getblockstats,       cat_developer     },
+    { "getexecutorinfo",         &getexecutorinfo,         cat_developer     },
     { "getlistof",               &getlistof,               cat_developer     },
+    { "getlockstats",            &getlockstats,            cat_developer     },
+    { "getmemoryinfo",           &getmemoryinfo,           cat_developer     },
+    { "getorphanblockinfo",      &getorphanblockinfo,      cat_developer     },
+    { "getperfstats",            &getperfstats,            cat_developer     },
     { "getrecentblocks",         &rpc_getrecentblocks,     cat_developer     },
+    { "getsigcacheinfo",         &getsigcacheinfo,         cat_developer     },
     { "getsupervotes",           &rpc_getsupervotes,       cat_developer     },
     { "inspectaccrualsnapshot",  &inspectaccrualsnapshot,  cat_developer     },
     { "listdata",                &listdata,                cat_developer     },
@@ -413,6 +431,9 @@ static const CRPCCommand vRPCCommands[] =
     { "clearbanned",             &clearbanned,             cat_network       },
     { "currenttime",             &currenttime,             cat_network       },
     { "getaddednodeinfo",        &getaddednodeinfo,        cat_network       },
+    { "getaddressbalance",       &getaddressbalance,       cat_network       },
+    { "getaddresstxids",         &getaddresstxids,         cat_network       },
+    { "getaddressutxos",         &getaddressutxos,         cat_network       },
     { "getbestblockhash",        &getbestblockhash,        cat_network       },
     { "getblock",                &getblock,                cat_network       },
     { "getblockbynumber",        &getblockbynumber,        cat_network       },
@@ -422,9 +443,12 @@ static const CRPCCommand vRPCCommands[] =
     { "getconnectioncount",      &getconnectioncount,      cat_network       },
     { "getdifficulty",           &getdifficulty,           cat_network       },
     { "getinfo",                 &getinfo,                 cat_network       },
+    { "getmempoolinfo",          &getmempoolinfo,          cat_network       },
+    { "getnetmsgstats",          &getnetmsgstats,          cat_network       },
     { "getnettotals",            &getnettotals,            cat_network       },
     { "getpeerinfo",             &getpeerinfo,             cat_network       },
     { "getrawmempool",           &getrawmempool,           cat_network       },
+    { "getspentinfo",            &getspentinfo,            cat_network       },
     { "listbanned",              &listbanned,              cat_network       },
     { "memorypool",              &memorypool,              cat_network       },
     { "networktime",             &networktime,             cat_network       },
@@ -459,6 +483,39 @@ static constexpr const char* DEPRECATED_RPCS[] {
         "vote",
 };
 
+// Read-only commands that the entries of a batch may run concurrently when
+// -rpcparallelbatch is set. Each of them takes the locks that it needs.
+static constexpr const char* PARALLEL_RPCS[] {
+        "decoderawtransaction",
+        "decodescript",
+        "getbestblockhash",
+        "getblock",
+        "getblockbynumber",
+        "getblockchaininfo",
+        "getblockcount",
+        "getblockhash",
+        "getcheckpoint",
+        "getconnectioncount",
+        "getdifficulty",
+        "getmempoolinfo",
+        "getrawmempool",
+        "getrawtransaction",
+        "showblock",
+        "validateaddress",
+};
+
+// Commands that write their result to the connection while they build it.
+// Large results then need neither a complete UniValue tree nor its serialized
+// copy in memory:
+static const struct {
+    const char* name;
+    rpcstreamfn_type actor;
+} vRPCStreamCommands[] = {
+    { "getblock",         &getblock_stream         },
+    { "getblockbynumber", &getblockbynumber_stream },
+    { "showblock",        &showblock_stream        },
+};
+
 CRPCTable::CRPCTable()
 {
     unsigned int vcidx;
@@ -469,6 +526,24 @@ CRPCTable::CRPCTable()
         pcmd = &vRPCCommands[vcidx];
         mapCommands[pcmd->name] = pcmd;
     }
+
+    for (const auto& command : PARALLEL_RPCS) {
+        setParallelCommands.insert(command);
+    }
+
+    for (const auto& command : vRPCStreamCommands) {
+        mapStreamCommands[command.name] = command.actor;
+    }
+}
+
+bool CRPCTable::IsParallelSafe(const std::string& method) const
+{
+    return setParallelCommands.count(method) > 0;
+}
+
+bool CRPCTable::HasStream(const std::string& method) const
+{
+    return mapStreamCommands.count(method) > 0;
 }
 
 const CRPCCommand *CRPCTable::operator[](string name) const
@@ -513,14 +588,321 @@ bool ClientAllowed(const boost::asio::ip::address& address)
     return false;
 }
 
-void ServiceConnection(AcceptedConnection *conn);
+//! Writes part of a reply to the connection before the request finishes.
+typedef std::function<void(const std::string&)> RPCWriteFn;
+
+static std::string ServiceRequest(
+    const std::string& strURI,
+    map<string, string>& mapHeaders,
+    const std::string& strRequest,
+    const std::string& strPeer,
+    int nProto,
+    const RPCWriteFn& write,
+    bool& fKeepAlive);
+
+/**
+ * Bounded queue of parsed RPC requests that the RPC worker threads execute.
+ * The connection thread only reads requests and writes replies, so slow or
+ * idle keep-alive clients do not occupy the threads that run the calls.
+ */
+class RPCWorkQueue
+{
+public:
+    explicit RPCWorkQueue(size_t nMaxDepth) : m_max_depth(nMaxDepth), m_running(true)
+    {
+    }
+
+    /** Queue a request. Returns false when the queue is full. */
+    bool Enqueue(std::function<void()> item)
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+
+            if (!m_running || m_queue.size() >= m_max_depth)
+                return false;
+
+            m_queue.push_back(std::move(item));
+        }
+
+        m_cond.notify_one();
+        return true;
+    }
+
+    /** Execute queued requests until Interrupt() is called. */
+    void Run()
+    {
+        while (true)
+        {
+            std::function<void()> item;
+
+            {
+                boost::unique_lock<boost::mutex> lock(m_mutex);
+
+                while (m_running && m_queue.empty())
+                    m_cond.wait(lock);
+
+                if (!m_running)
+                    return;
+
+                item = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+
+            item();
+        }
+    }
+
+    /** Stop the worker threads and drop the requests not yet started. */
+    void Interrupt()
+    {
+        {
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            m_running = false;
+            m_queue.clear();
+        }
+
+        m_cond.notify_all();
+    }
+
+private:
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+    std::deque<std::function<void()>> m_queue;
+    const size_t m_max_depth;
+    bool m_running;
+};
+
+static RPCWorkQueue* rpc_work_queue = NULL;
+static int64_t nRPCServerTimeout = DEFAULT_RPC_SERVER_TIMEOUT;
+static int64_t nRPCThreads = 4;
+static bool fRPCParallelBatch = DEFAULT_RPC_PARALLEL_BATCH;
+
+/**
+ * An accepted RPC connection. It reads each HTTP request with asynchronous
+ * operations on the RPC I/O thread, hands the parsed request to the work
+ * queue, and writes the reply when a worker finishes it. The session keeps
+ * itself alive through the handlers that it passes to asio.
+ *
+ * Only one operation on the socket is outstanding at any time: a read, the
+ * queued request, or the write of a reply.
+ */
+template <typename Protocol>
+class RPCSession : public std::enable_shared_from_this<RPCSession<Protocol>>
+{
+public:
+    RPCSession(ioContext& io_context, std::unique_ptr<AcceptedConnectionImpl<Protocol>> conn, bool fUseSSL)
+        : m_conn(std::move(conn))
+        , m_use_ssl(fUseSSL)
+        , m_busy(false)
+        , m_timer(io_context)
+        , m_buffer(MAX_SIZE)
+        , m_write_failed(false)
+    {
+    }
+
+    void Start()
+    {
+        if (!m_use_ssl)
+        {
+            ReadRequest();
+            return;
+        }
+
+        auto self = this->shared_from_this();
+
+        StartTimer();
+        m_conn->sslStream.async_handshake(ssl::stream_base::server, [self](const boost::system::error_code& error) {
+            if (error)
+                self->Close();
+            else
+                self->ReadRequest();
+        });
+    }
+
+private:
+    std::unique_ptr<AcceptedConnectionImpl<Protocol>> m_conn;
+    const bool m_use_ssl;
+    bool m_busy;                      //!< A worker owns the request. Accessed on the I/O thread only.
+    deadline_timer m_timer;          //!< Closes connections that do not send a request in time.
+    boost::asio::streambuf m_buffer; //!< Bytes received and not yet parsed.
+    std::string m_reply;             //!< Reply in flight.
+    bool m_write_failed;             //!< A write from the worker thread failed.
+
+    void StartTimer()
+    {
+        auto self = this->shared_from_this();
+
+        m_timer.expires_from_now(boost::posix_time::seconds(nRPCServerTimeout));
+        m_timer.async_wait([self](const boost::system::error_code& error) {
+            if (!error && !self->m_busy)
+                self->Close();
+        });
+    }
+
+    void Close()
+    {
+        boost::system::error_code ignored;
+        m_timer.cancel(ignored);
+        m_conn->sslStream.lowest_layer().close(ignored);
+    }
+
+    void ReadRequest()
+    {
+        if (fShutdown)
+        {
+            Close();
+            return;
+        }
+
+        auto self = this->shared_from_this();
+        auto handler = [self](const boost::system::error_code& error, size_t nHeaderSize) {
+            if (error)
+                self->Close();
+            else
+                self->OnHeaders(nHeaderSize);
+        };
+
+        m_busy = false;
+        StartTimer();
+
+        if (m_use_ssl)
+            asio::async_read_until(m_conn->sslStream, m_buffer, "\r\n\r\n", handler);
+        else
+            asio::async_read_until(m_conn->sslStream.next_layer(), m_buffer, "\r\n\r\n", handler);
+    }
+
+    void OnHeaders(size_t nHeaderSize)
+    {
+        // Peek at the headers for the size of the body. The request is parsed
+        // for real once the whole body arrived:
+        std::istringstream headers(std::string(
+            asio::buffers_begin(m_buffer.data()),
+            asio::buffers_begin(m_buffer.data()) + nHeaderSize));
+
+        std::string strRequestLine;
+        std::getline(headers, strRequestLine);
+
+        map<string, string> mapHeaders;
+        const int nLen = ReadHTTPHeaders(headers, mapHeaders);
+
+        if (nLen < 0 || nLen > (int)MAX_SIZE - (int)nHeaderSize)
+        {
+            Write(HTTPReply(HTTP_BAD_REQUEST, "", false), false);
+            return;
+        }
+
+        const size_t nRequestSize = nHeaderSize + nLen;
+
+        if (m_buffer.size() >= nRequestSize)
+        {
+            OnRequest();
+            return;
+        }
+
+        auto self = this->shared_from_this();
+        auto handler = [self](const boost::system::error_code& error, size_t) {
+            if (error)
+                self->Close();
+            else
+                self->OnRequest();
+        };
+
+        const auto completion = asio::transfer_exactly(nRequestSize - m_buffer.size());
+
+        if (m_use_ssl)
+            asio::async_read(m_conn->sslStream, m_buffer, completion, handler);
+        else
+            asio::async_read(m_conn->sslStream.next_layer(), m_buffer, completion, handler);
+    }
+
+    void OnRequest()
+    {
+        m_busy = true;
+
+        boost::system::error_code ignored;
+        m_timer.cancel(ignored);
+
+        int nProto = 0;
+        map<string, string> mapHeaders;
+        string strRequest, strMethod, strURI;
+
+        std::istream stream(&m_buffer);
+
+        if (!ReadHTTPRequestLine(stream, nProto, strMethod, strURI))
+        {
+            Close();
+            return;
+        }
+
+        ReadHTTPMessage(stream, mapHeaders, strRequest, nProto);
+
+        auto self = this->shared_from_this();
+        const std::string strPeer = m_conn->peer_address_to_string();
+
+        const bool fQueued = rpc_work_queue && rpc_work_queue->Enqueue(
+            [self, strURI, mapHeaders, strRequest, strPeer, nProto]() mutable {
+                bool fKeepAlive = false;
+                std::string strReply = ServiceRequest(
+                    strURI, mapHeaders, strRequest, strPeer, nProto,
+                    [self](const std::string& strData) { self->WriteSync(strData); },
+                    fKeepAlive);
+
+                self->Write(std::move(strReply), fKeepAlive);
+            });
+
+        if (!fQueued)
+        {
+            LogPrintf("WARNING: RPC request from %s rejected: work queue depth exceeded\n", strPeer);
+            Write(HTTPReply(HTTP_SERVICE_UNAVAILABLE, "Work queue depth exceeded", false), false);
+        }
+    }
+
+    void Write(std::string strReply, bool fKeepAlive)
+    {
+        m_reply = std::move(strReply);
+
+        auto self = this->shared_from_this();
+        auto handler = [self, fKeepAlive](const boost::system::error_code& error, size_t) {
+            if (error || !fKeepAlive)
+                self->Close();
+            else
+                self->ReadRequest();
+        };
+
+        if (m_use_ssl)
+            asio::async_write(m_conn->sslStream, asio::buffer(m_reply), handler);
+        else
+            asio::async_write(m_conn->sslStream.next_layer(), asio::buffer(m_reply), handler);
+    }
+
+public:
+    /**
+     * Write part of a reply from the worker that owns the request. No other
+     * operation on the socket is outstanding while m_busy is set, so the
+     * worker may block on the socket until Write() sends the rest.
+     */
+    void WriteSync(const std::string& strData)
+    {
+        if (m_write_failed)
+            return;
+
+        boost::system::error_code error;
+
+        if (m_use_ssl)
+            asio::write(m_conn->sslStream, asio::buffer(strData), error);
+        else
+            asio::write(m_conn->sslStream.next_layer(), asio::buffer(strData), error);
+
+        m_write_failed = !!error;
+    }
+};
 
 // Forward declaration required for RPCListen
 template <typename Protocol>
 static void RPCAcceptHandler(boost::shared_ptr< basic_socket_acceptor<Protocol> > acceptor,
                              ssl::context& context,
                              bool fUseSSL,
-                             AcceptedConnection* conn,
+                             AcceptedConnectionImpl<Protocol>* conn,
                              const boost::system::error_code& error);
 
 /**
@@ -552,9 +934,11 @@ template <typename Protocol>
 static void RPCAcceptHandler(boost::shared_ptr< basic_socket_acceptor<Protocol> > acceptor,
                              ssl::context& context,
                              const bool fUseSSL,
-                             AcceptedConnection* conn,
+                             AcceptedConnectionImpl<Protocol>* conn,
                              const boost::system::error_code& error)
 {
+    std::unique_ptr<AcceptedConnectionImpl<Protocol>> owned_conn(conn);
+
     // Immediately start accepting new connections, except when we're cancelled or our socket is closed.
     if (error != asio::error::operation_aborted && acceptor->is_open())
         RPCListen(acceptor, context, fUseSSL);
@@ -571,14 +955,14 @@ static void RPCAcceptHandler(boost::shared_ptr< basic_socket_acceptor<Protocol>
             // Only send a 403 if we're not using SSL to prevent a DoS during the SSL handshake.
             if (!fUseSSL)
                 conn->stream() << HTTPReply(HTTP_FORBIDDEN, "", false) << std::flush;
+
+            conn->close();
         }
         else
-            ServiceConnection(conn);
-
-        conn->close();
+        {
+            std::make_shared<RPCSession<Protocol>>(GetIOServiceFromPtr(acceptor), std::move(owned_conn), fUseSSL)->Start();
+        }
     }
-
-    delete conn;
 }
 
 void StartRPCThreads()
@@ -696,9 +1080,17 @@ void StartRPCThreads()
         return;
     }
 
+    nRPCServerTimeout = std::max<int64_t>(GetArg("-rpcservertimeout", DEFAULT_RPC_SERVER_TIMEOUT), 1);
+    rpc_work_queue = new RPCWorkQueue(std::max<int64_t>(GetArg("-rpcworkqueue", DEFAULT_RPC_WORK_QUEUE), 1));
+    nRPCThreads = std::max<int64_t>(GetArg("-rpcthreads", 4), 1);
+    fRPCParallelBatch = GetBoolArg("-rpcparallelbatch", DEFAULT_RPC_PARALLEL_BATCH);
+
+    // One thread runs the asynchronous connection handling. The others
+    // execute the queued calls:
     rpc_worker_group = new boost::thread_group();
-    for (int i = 0; i < GetArg("-rpcthreads", 4); i++)
-        rpc_worker_group->create_thread(boost::bind(&ioContext::run, rpc_io_service));
+    rpc_worker_group->create_thread(boost::bind(&ioContext::run, rpc_io_service));
+    for (int i = 0; i < nRPCThreads; i++)
+        rpc_worker_group->create_thread(boost::bind(&RPCWorkQueue::Run, rpc_work_queue));
 }
 
 void StopRPCThreads()
@@ -710,12 +1102,15 @@ void StopRPCThreads()
         return;
     }
 
+    rpc_work_queue->Interrupt();
     rpc_io_service->stop();
     if (rpc_worker_group != NULL)
         rpc_worker_group->join_all();
 
     delete rpc_worker_group;
     rpc_worker_group = NULL;
+    delete rpc_work_queue;
+    rpc_work_queue = NULL;
     delete rpc_ssl_context;
     rpc_ssl_context = NULL;
     delete rpc_io_service;
@@ -788,95 +1183,251 @@ static UniValue JSONRPCExecOne(const UniValue& req)
     return rpc_result;
 }
 
-static string JSONRPCExecBatch(const UniValue& vReq)
+//! Determine whether every entry of a batch calls a parallel-safe command.
+static bool IsParallelBatch(const UniValue& vReq)
 {
-    UniValue ret(UniValue::VARR);
     for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    {
+        if (!vReq[reqIdx].isObject())
+            return false;
 
-    return UniValue(ret).write() + "\n";
+        const UniValue& method = find_value(vReq[reqIdx].get_obj(), "method");
+
+        if (!method.isStr() || !tableRPC.IsParallelSafe(method.get_str()))
+            return false;
+    }
+
+    return true;
 }
 
-void ServiceConnection(AcceptedConnection *conn)
+/**
+ * Entries of a batch shared by the threads that execute them. Each thread
+ * claims the next entry until none remain, and stores the reply at the
+ * position of its entry so that the replies keep the order of the batch.
+ */
+class ParallelBatch
 {
-    bool fRun = true;
-    while (fRun && !fShutdown)
+public:
+    explicit ParallelBatch(const UniValue& vReq) : m_reqs(vReq), m_next(0), m_done(0), m_results(vReq.size())
     {
-        int nProto = 0;
-        map<string, string> mapHeaders;
-        string strRequest, strMethod, strURI;
+    }
 
-        // Read HTTP request line
-        if (!ReadHTTPRequestLine(conn->stream(), nProto, strMethod, strURI))
-            break;
+    //! Execute entries until none remain unclaimed.
+    void Work()
+    {
+        for (size_t i = m_next++; i < m_results.size(); i = m_next++)
+        {
+            UniValue result = JSONRPCExecOne(m_reqs[i]);
 
-        // Read HTTP message headers and body
-        ReadHTTPMessage(conn->stream(), mapHeaders, strRequest, nProto);
+            boost::lock_guard<boost::mutex> lock(m_mutex);
+            m_results[i] = std::move(result);
 
-        if (strURI != "/") {
-            conn->stream() << HTTPReply(HTTP_NOT_FOUND, "", false) << std::flush;
-            break;
+            if (++m_done == m_results.size())
+                m_cond.notify_all();
         }
+    }
 
-        // Check authorization
-        if (mapHeaders.count("authorization") == 0)
-        {
-            conn->stream() << HTTPReply(HTTP_UNAUTHORIZED, "", false) << std::flush;
-            break;
-        }
-        if (!HTTPAuthorized(mapHeaders))
-        {
-            LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", conn->peer_address_to_string());
-            /* Deter brute-forcing short passwords.
-               If this results in a DOS the user really
-               shouldn't have their RPC port exposed.*/
-            if (mapArgs["-rpcpassword"].size() < 20)
-                MilliSleep(250);
-
-            conn->stream() << HTTPReply(HTTP_UNAUTHORIZED, "", false) << std::flush;
+    //! Wait for the entries claimed by other threads and take the replies.
+    std::vector<UniValue> Wait()
+    {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+
+        while (m_done < m_results.size())
+            m_cond.wait(lock);
+
+        return std::move(m_results);
+    }
+
+private:
+    // Only read for claimed entries, which finish before the caller of
+    // Wait() releases the batch:
+    const UniValue& m_reqs;
+    std::atomic<size_t> m_next;
+    size_t m_done;
+    std::vector<UniValue> m_results;
+    boost::mutex m_mutex;
+    boost::condition_variable m_cond;
+};
+
+static std::vector<UniValue> JSONRPCExecParallel(const UniValue& vReq)
+{
+    auto batch = std::make_shared<ParallelBatch>(vReq);
+
+    // Borrow idle RPC workers. The calling worker executes entries as well,
+    // so the batch finishes even when the work queue is full:
+    const size_t nHelpers = std::min<size_t>(nRPCThreads - 1, vReq.size() - 1);
+
+    for (size_t i = 0; i < nHelpers; ++i)
+    {
+        if (!rpc_work_queue->Enqueue([batch]() { batch->Work(); }))
             break;
-        }
-        if (mapHeaders["connection"] == "close")
-            fRun = false;
+    }
 
-        JSONRequest jreq;
-        try
-        {
-            // Parse request
-            UniValue valRequest(UniValue::VSTR);
-            if (!valRequest.read(strRequest))
-                throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
+    batch->Work();
 
-            string strReply;
+    return batch->Wait();
+}
 
-            // singleton request
-            if (valRequest.isObject()) {
-                jreq.parse(valRequest);
+static string JSONRPCExecBatch(const UniValue& vReq)
+{
+    UniValue ret(UniValue::VARR);
 
-                UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+    if (fRPCParallelBatch && rpc_work_queue && vReq.size() > 1 && IsParallelBatch(vReq))
+    {
+        for (auto& result : JSONRPCExecParallel(vReq))
+            ret.push_back(std::move(result));
+    }
+    else
+    {
+        for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
+            ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
+    }
 
-                // Send reply
-                strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+    return UniValue(ret).write() + "\n";
+}
 
-            // array of requests
-            } else if (valRequest.isArray())
-                strReply = JSONRPCExecBatch(valRequest.get_array());
-            else
-                throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+/**
+ * Execute a request for a command that streams its result. The reply uses the
+ * chunked transfer encoding once the result outgrows the buffer of the writer
+ * and a normal reply otherwise.
+ *
+ * \return The rest of the HTTP reply to send.
+ */
+static std::string ServiceStreamRequest(
+    const JSONRequest& jreq,
+    bool fRun,
+    const RPCWriteFn& write,
+    bool& fKeepAlive)
+{
+    bool fHeaderSent = false;
 
-            conn->stream() << HTTPReply(HTTP_OK, strReply, fRun) << std::flush;
-        }
-        catch (UniValue& objError)
-        {
-            ErrorReply(conn->stream(), objError, jreq.id);
-            break;
-        }
-        catch (std::exception& e)
-        {
-            ErrorReply(conn->stream(), JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
-            break;
-        }
+    JSONStreamWriter out([&](const std::string& strData) {
+        if (!fHeaderSent)
+            write(HTTPChunkedReplyHeader(HTTP_OK, fRun));
+
+        fHeaderSent = true;
+        write(HTTPChunk(strData));
+    });
+
+    out.Raw("{\"result\":");
+
+    try
+    {
+        tableRPC.executeStream(jreq.strMethod, jreq.params, out);
+    }
+    catch (...)
+    {
+        // Before the first chunk, the caller can still send an error reply:
+        if (!out.Started())
+            throw;
+
+        // ...otherwise, the client already received part of a successful
+        // reply. Close the connection without the final chunk so that the
+        // client notices the truncated reply:
+        LogPrintf("ERROR: RPC %s failed while streaming its result\n", jreq.strMethod);
+        fKeepAlive = false;
+
+        return "";
+    }
+
+    out.Raw(",\"error\":null,\"id\":" + jreq.id.write() + "}\n");
+    fKeepAlive = fRun;
+
+    if (!out.Started())
+        return HTTPReply(HTTP_OK, out.TakeBuffer(), fRun);
+
+    out.Flush();
+
+    return HTTPChunk("");
+}
+
+/**
+ * Execute one HTTP request on an RPC worker thread.
+ *
+ * \param nProto     HTTP minor version of the request.
+ * \param write      Sends part of the reply before the request finishes.
+ * \param fKeepAlive Set to whether the connection stays open for the next request.
+ *
+ * \return The HTTP reply to send.
+ */
+static std::string ServiceRequest(
+    const std::string& strURI,
+    map<string, string>& mapHeaders,
+    const std::string& strRequest,
+    const std::string& strPeer,
+    int nProto,
+    const RPCWriteFn& write,
+    bool& fKeepAlive)
+{
+    fKeepAlive = false;
+
+    if (fShutdown)
+        return HTTPReply(HTTP_SERVICE_UNAVAILABLE, "", false);
+
+    if (strURI != "/")
+        return HTTPReply(HTTP_NOT_FOUND, "", false);
+
+    // Check authorization
+    if (mapHeaders.count("authorization") == 0)
+        return HTTPReply(HTTP_UNAUTHORIZED, "", false);
+
+    if (!HTTPAuthorized(mapHeaders))
+    {
+        LogPrintf("ThreadRPCServer incorrect password attempt from %s\n", strPeer);
+        /* Deter brute-forcing short passwords.
+           If this results in a DOS the user really
+           shouldn't have their RPC port exposed.*/
+        if (mapArgs["-rpcpassword"].size() < 20)
+            MilliSleep(250);
+
+        return HTTPReply(HTTP_UNAUTHORIZED, "", false);
     }
+
+    const bool fRun = mapHeaders["connection"] != "close";
+
+    JSONRequest jreq;
+    std::ostringstream stream;
+    try
+    {
+        // Parse request
+        UniValue valRequest(UniValue::VSTR);
+        if (!valRequest.read(strRequest))
+            throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
+
+        string strReply;
+
+        // singleton request
+        if (valRequest.isObject()) {
+            jreq.parse(valRequest);
+
+            // Chunked replies need HTTP/1.1:
+            if (nProto >= 1 && tableRPC.HasStream(jreq.strMethod))
+                return ServiceStreamRequest(jreq, fRun, write, fKeepAlive);
+
+            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
+
+            // Send reply
+            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+
+        // array of requests
+        } else if (valRequest.isArray())
+            strReply = JSONRPCExecBatch(valRequest.get_array());
+        else
+            throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
+
+        fKeepAlive = fRun;
+        return HTTPReply(HTTP_OK, strReply, fRun);
+    }
+    catch (UniValue& objError)
+    {
+        ErrorReply(stream, objError, jreq.id);
+    }
+    catch (std::exception& e)
+    {
+        ErrorReply(stream, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+    }
+
+    return stream.str();
 }
 
 UniValue CRPCTable::execute(const std::string& strMethod, const UniValue& params) const
@@ -913,6 +1464,21 @@ UniValue CRPCTable::execute(const std::string& strMethod, const UniValue& params
     }
 }
 
+void CRPCTable::executeStream(const std::string& strMethod, const UniValue& params, JSONStreamWriter& out) const
+{
+    const auto iter = mapStreamCommands.find(strMethod);
+    if (iter == mapStreamCommands.end())
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
+
+    try
+    {
+        iter->second(params, out);
+    }
+    catch (std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+}
 
 std::vector<std::string> CRPCTable::listCommands() const
 {
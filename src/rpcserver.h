@@ -8,12 +8,24 @@
 #include <string>
 #include <list>
 #include <map>
+#include <set>
 
 class CBlockIndex;
 class uint256;
 
+namespace GRC {
+class Magnitude;
+}
+
 #include <univalue.h>
 
+/** -rpcworkqueue default (maximum number of queued RPC requests) */
+static const int DEFAULT_RPC_WORK_QUEUE = 16;
+/** -rpcservertimeout default (seconds to wait for the next request of a connection) */
+static const int DEFAULT_RPC_SERVER_TIMEOUT = 30;
+/** -rpcparallelbatch default (run read-only batch entries concurrently) */
+static const bool DEFAULT_RPC_PARALLEL_BATCH = false;
+
 void StartRPCThreads();
 void StopRPCThreads();
 int CommandLineRPC(int argc, char *argv[]);
@@ -32,8 +44,13 @@ void RPCTypeCheck(const UniValue& params,
 void RPCTypeCheckObj(const UniValue& o,
                   const std::map<std::string, UniValue::VType>& typesExpected, bool fAllowNull=false);
 
+class JSONStreamWriter;
+
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
 
+/** Writes the result of a command to a stream instead of returning it. */
+typedef void(*rpcstreamfn_type)(const UniValue& params, JSONStreamWriter& out);
+
 enum rpccategory
 {
     cat_null,
@@ -59,6 +76,8 @@ class CRPCTable
 {
 private:
     std::map<std::string, const CRPCCommand*> mapCommands;
+    std::set<std::string> setParallelCommands;
+    std::map<std::string, rpcstreamfn_type> mapStreamCommands;
 public:
     CRPCTable();
     const CRPCCommand* operator[](std::string name) const;
@@ -73,6 +92,27 @@ public:
      */
     UniValue execute(const std::string &method, const UniValue& params) const;
 
+    /**
+     * Determine whether a method only reads state and takes the locks that it
+     * needs itself, so that the entries of a batch may run it concurrently.
+     */
+    bool IsParallelSafe(const std::string& method) const;
+
+    /**
+     * Determine whether a method can write its result to a stream.
+     */
+    bool HasStream(const std::string& method) const;
+
+    /**
+     * Execute a method that writes its result to a stream.
+     * @param method   Method to execute
+     * @param params   Array of arguments (JSON objects)
+     * @param out      Receives the result of the call.
+     * @throws an exception when an error happens. The stream may hold part
+     * of the result in that case.
+     */
+    void executeStream(const std::string& method, const UniValue& params, JSONStreamWriter& out) const;
+
     /**
     * Returns a list of registered commands
     * @returns List of registered commands.
@@ -85,6 +125,7 @@ extern const CRPCTable tableRPC;
 extern int64_t nWalletUnlockTime;
 extern int64_t AmountFromValue(const UniValue& value);
 extern UniValue ValueFromAmount(int64_t amount);
+extern UniValue ValueFromMagnitude(const GRC::Magnitude magnitude);
 
 extern std::string HelpRequiringPassphrase();
 extern void EnsureWalletIsUnlocked();
@@ -179,6 +220,7 @@ extern UniValue magnitude(const UniValue& params, bool fHelp);
 extern UniValue myneuralhash(const UniValue& params, bool fHelp);
 extern UniValue neuralhash(const UniValue& params, bool fHelp);
 extern UniValue pendingbeaconreport(const UniValue& params, bool fHelp);
+extern UniValue researchhistory(const UniValue& params, bool fHelp);
 extern UniValue resetcpids(const UniValue& params, bool fHelp);
 extern UniValue revokebeacon(const UniValue& params, bool fHelp);
 extern UniValue superblockage(const UniValue& params, bool fHelp);
@@ -193,7 +235,13 @@ extern UniValue debug(const UniValue& params, bool fHelp);
 extern UniValue debug10(const UniValue& params, bool fHelp);
 extern UniValue debug2(const UniValue& params, bool fHelp);
 extern UniValue rpc_getblockstats(const UniValue& params, bool fHelp);
+extern UniValue getexecutorinfo(const UniValue& params, bool fHelp);
 extern UniValue getlistof(const UniValue& params, bool fHelp);
+extern UniValue getlockstats(const UniValue& params, bool fHelp);
+extern UniValue getmemoryinfo(const UniValue& params, bool fHelp);
+extern UniValue getorphanblockinfo(const UniValue& params, bool fHelp);
+extern UniValue getperfstats(const UniValue& params, bool fHelp);
+extern UniValue getsigcacheinfo(const UniValue& params, bool fHelp);
 extern UniValue inspectaccrualsnapshot(const UniValue& params, bool fHelp);
 extern UniValue listdata(const UniValue& params, bool fHelp);
 extern UniValue listprojects(const UniValue& params, bool fHelp);
@@ -230,9 +278,15 @@ extern UniValue askforoutstandingblocks(const UniValue& params, bool fHelp);
 extern UniValue clearbanned(const UniValue& params, bool fHelp);
 extern UniValue currenttime(const UniValue& params, bool fHelp);
 extern UniValue getaddednodeinfo(const UniValue& params, bool fHelp);
+extern UniValue getaddressbalance(const UniValue& params, bool fHelp);
+extern UniValue getaddresstxids(const UniValue& params, bool fHelp);
+extern UniValue getaddressutxos(const UniValue& params, bool fHelp);
 extern UniValue getbestblockhash(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
 extern UniValue getblockbynumber(const UniValue& params, bool fHelp);
+extern void getblock_stream(const UniValue& params, JSONStreamWriter& out);
+extern void getblockbynumber_stream(const UniValue& params, JSONStreamWriter& out);
+extern void showblock_stream(const UniValue& params, JSONStreamWriter& out);
 extern UniValue getblockchaininfo(const UniValue& params, bool fHelp);
 extern UniValue getblockcount(const UniValue& params, bool fHelp);
 extern UniValue getblockhash(const UniValue& params, bool fHelp);
@@ -240,10 +294,13 @@ extern UniValue getcheckpoint(const UniValue& params, bool fHelp);
 extern UniValue getconnectioncount(const UniValue& params, bool fHelp);
 extern UniValue getdifficulty(const UniValue& params, bool fHelp);
 extern UniValue getinfo(const UniValue& params, bool fHelp); // To Be Deprecated --> getblockchaininfo getnetworkinfo getwalletinfo
+extern UniValue getmempoolinfo(const UniValue& params, bool fHelp);
+extern UniValue getnetmsgstats(const UniValue& params, bool fHelp);
 extern UniValue getnettotals(const UniValue& params, bool fHelp);
 extern UniValue getnetworkinfo(const UniValue& params, bool fHelp);
 extern UniValue getpeerinfo(const UniValue& params, bool fHelp);
 extern UniValue getrawmempool(const UniValue& params, bool fHelp);
+extern UniValue getspentinfo(const UniValue& params, bool fHelp);
 extern UniValue listbanned(const UniValue& params, bool fHelp);
 extern UniValue memorypool(const UniValue& params, bool fHelp);
 extern UniValue networktime(const UniValue& params, bool fHelp);
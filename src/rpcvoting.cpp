@@ -128,7 +128,7 @@ UniValue VoteDetailsToJson(const PollResult& result)
 
         vote.pushKV("amount", ValueFromAmount(detail.m_amount));
         vote.pushKV("cpid", detail.m_mining_id.ToString());
-        vote.pushKV("magnitude", detail.m_magnitude.Floating());
+        vote.pushKV("magnitude", ValueFromMagnitude(detail.m_magnitude));
 
         UniValue answers(UniValue::VARR);
         PollResult::Weight total_weight = 0;
@@ -6,6 +6,7 @@
 
 //#include <random.h>
 #include "util.h"
+#include "util/perf.h"
 #include <reverselock.h>
 
 #include <assert.h>
@@ -86,14 +87,63 @@ void CScheduler::serviceQueue()
             if (shouldStop() || taskQueue.empty())
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            // Skip the tasks of serial queues that another thread is servicing.
+            // That thread wakes the others when its task finishes:
+            TaskQueue::iterator taskIter = findRunnableTask();
+
+            if (taskIter == taskQueue.end()) {
+                newTaskScheduled.wait(lock);
+                continue;
+            }
+
+            if (taskIter->first > boost::chrono::system_clock::now()) {
+#if BOOST_VERSION < 105000
+                newTaskScheduled.timed_wait(lock, toPosixTime(taskIter->first));
+#else
+                newTaskScheduled.wait_until<>(lock, taskIter->first);
+#endif
+                continue;
+            }
+
+            const boost::chrono::system_clock::time_point scheduledTime = taskIter->first;
+            Task task = std::move(taskIter->second);
+            taskQueue.erase(taskIter);
+
+            if (!task.name.empty()) {
+                runningQueues.insert(task.name);
+            }
 
             {
                 // Unlock before calling f, so it can reschedule itself or another task
                 // without deadlocking:
                 reverse_lock<boost::unique_lock<boost::mutex> > rlock(lock);
-                f();
+
+                const boost::chrono::system_clock::time_point start = boost::chrono::system_clock::now();
+
+                try {
+                    task.f();
+                } catch (...) {
+                    boost::unique_lock<boost::mutex> relock(newTaskMutex);
+                    runningQueues.erase(task.name);
+                    throw;
+                }
+
+                if (util::g_perf_enabled && !task.name.empty()) {
+                    const auto micros = [](boost::chrono::system_clock::duration d) {
+                        return static_cast<uint64_t>(std::max<int64_t>(0,
+                            boost::chrono::duration_cast<boost::chrono::microseconds>(d).count()));
+                    };
+
+                    util::GetPerfCounter("scheduler." + task.name)
+                        .Record(micros(boost::chrono::system_clock::now() - start));
+                    util::GetPerfCounter("scheduler." + task.name + ".late")
+                        .Record(micros(start - scheduledTime));
+                }
+            }
+
+            if (!task.name.empty()) {
+                runningQueues.erase(task.name);
+                newTaskScheduled.notify_all();
             }
         } catch (...) {
             --nThreadsServicingQueue;
@@ -104,6 +154,20 @@ void CScheduler::serviceQueue()
     newTaskScheduled.notify_one();
 }
 
+CScheduler::TaskQueue::iterator CScheduler::findRunnableTask()
+{
+    TaskQueue::iterator iter = taskQueue.begin();
+
+    while (iter != taskQueue.end()
+        && !iter->second.name.empty()
+        && runningQueues.count(iter->second.name))
+    {
+        ++iter;
+    }
+
+    return iter;
+}
+
 void CScheduler::stop(bool drain)
 {
     {
@@ -116,29 +180,31 @@ void CScheduler::stop(bool drain)
     newTaskScheduled.notify_all();
 }
 
-void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t)
+void CScheduler::schedule(CScheduler::Function f, boost::chrono::system_clock::time_point t,
+                          const std::string& name)
 {
     {
         boost::unique_lock<boost::mutex> lock(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        taskQueue.insert(std::make_pair(t, Task{ std::move(f), name }));
     }
-    newTaskScheduled.notify_one();
+    // Wake every thread: the first one may wait on a task of a busy queue.
+    newTaskScheduled.notify_all();
 }
 
-void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleFromNow(CScheduler::Function f, int64_t deltaMilliSeconds, const std::string& name)
 {
-    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds));
+    schedule(f, boost::chrono::system_clock::now() + boost::chrono::milliseconds(deltaMilliSeconds), name);
 }
 
-static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds)
+static void Repeat(CScheduler* s, CScheduler::Function f, int64_t deltaMilliSeconds, const std::string& name)
 {
     f();
-    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds), deltaMilliSeconds);
+    s->scheduleFromNow(std::bind(&Repeat, s, f, deltaMilliSeconds, name), deltaMilliSeconds, name);
 }
 
-void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds)
+void CScheduler::scheduleEvery(CScheduler::Function f, int64_t deltaMilliSeconds, const std::string& name)
 {
-    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds), deltaMilliSeconds);
+    scheduleFromNow(std::bind(&Repeat, this, f, deltaMilliSeconds, name), deltaMilliSeconds, name);
 }
 
 size_t CScheduler::getQueueInfo(boost::chrono::system_clock::time_point &first,
@@ -13,9 +13,16 @@
 #include <boost/chrono/chrono.hpp>
 #include <boost/thread.hpp>
 #include <map>
+#include <set>
+#include <string>
 
 #include <sync.h>
 
+/** -schedulerthreads default */
+static const int DEFAULT_SCHEDULER_THREADS = 2;
+/** Maximum number of scheduler threads */
+static const int MAX_SCHEDULER_THREADS = 8;
+
 //
 // Simple class for background tasks that should be run
 // periodically or once "after a while"
@@ -27,6 +34,12 @@
 // s->scheduleFromNow(std::bind(Class::func, this, argument), 3);
 // boost::thread* t = new boost::thread(std::bind(CScheduler::serviceQueue, s));
 //
+// More than one thread may run serviceQueue. Tasks scheduled with the same
+// non-empty name form a serial queue: no two of them run at the same time.
+// Unnamed tasks run concurrently. With -perfstats, the scheduler records the
+// runtime and lateness of each named task in the util/perf.h counters named
+// "scheduler.<name>" and "scheduler.<name>.late".
+//
 // ... then at program shutdown, clean up the thread running serviceQueue:
 // t->interrupt();
 // t->join();
@@ -43,17 +56,18 @@ public:
     typedef std::function<void()> Function;
 
     // Call func at/after time t
-    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now());
+    void schedule(Function f, boost::chrono::system_clock::time_point t=boost::chrono::system_clock::now(),
+                  const std::string& name="");
 
     // Convenience method: call f once deltaMilliSeconds from now
-    void scheduleFromNow(Function f, int64_t deltaMilliSeconds);
+    void scheduleFromNow(Function f, int64_t deltaMilliSeconds, const std::string& name="");
 
     // Another convenience method: call f approximately
     // every deltaMilliSeconds forever, starting deltaMilliSeconds from now.
     // To be more precise: every time f is finished, it
     // is rescheduled to run deltaMilliSeconds later. If you
     // need more accurate scheduling, don't use this method.
-    void scheduleEvery(Function f, int64_t deltaMilliSeconds);
+    void scheduleEvery(Function f, int64_t deltaMilliSeconds, const std::string& name="");
 
     // To keep things as simple as possible, there is no unschedule.
 
@@ -75,10 +89,22 @@ public:
     bool AreThreadsServicingQueue() const;
 
 private:
-    std::multimap<boost::chrono::system_clock::time_point, Function> taskQueue;
+    struct Task
+    {
+        Function f;
+        std::string name; // Serial queue of the task, or empty.
+    };
+
+    typedef std::multimap<boost::chrono::system_clock::time_point, Task> TaskQueue;
+
+    TaskQueue taskQueue;
+    std::set<std::string> runningQueues; // Serial queues with a running task
     boost::condition_variable newTaskScheduled;
     mutable boost::mutex newTaskMutex;
     int nThreadsServicingQueue;
+
+    // First task that no other thread blocks by running a task of its queue
+    TaskQueue::iterator findRunnableTask();
     bool stopRequested;
     bool stopWhenEmpty;
     bool shouldStop() const { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
@@ -8,11 +8,20 @@ using namespace std;
 #include "script.h"
 #include "keystore.h"
 #include "bignum.h"
+#include "crypto/sha256.h"
 #include "key.h"
 #include "main.h"
 #include "streams.h"
 #include "sync.h"
 #include "util.h"
+#include "util/threadpool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <thread>
+#include <unordered_set>
 
 bool CheckSig(vector<unsigned char> vchSig, vector<unsigned char> vchPubKey, CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
 
@@ -324,18 +333,21 @@ static bool IsCanonicalSignature(const valtype &vchSig) {
 
 bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, const CTransaction& txTo, unsigned int nIn, int nHashType)
 {
-    CAutoBN_CTX pctx;
     CScript::const_iterator pc = script.begin();
     CScript::const_iterator pend = script.end();
     CScript::const_iterator pbegincodehash = script.begin();
     opcodetype opcode;
-    valtype vchPushValue;
+    Span<const unsigned char> vchPushValue;
     vector<bool> vfExec;
     vector<valtype> altstack;
     if (script.size() > 10000)
         return false;
     int nOpCount = 0;
 
+    // Standard scripts stay well below this depth, so the stack vector does
+    // not reallocate as they push:
+    stack.reserve(stack.size() + 8);
+
 
     try
     {
@@ -371,7 +383,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                 return false;
 
             if (fExec && 0 <= opcode && opcode <= OP_PUSHDATA4)
-                stack.push_back(vchPushValue);
+                stack.emplace_back(vchPushValue.begin(), vchPushValue.end());
             else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -397,8 +409,10 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                 case OP_16:
                 {
                     // ( -- value)
-                    CBigNum bn((int)opcode - (int)(OP_1 - 1));
-                    stack.push_back(bn.getvch());
+                    // The CBigNum encoding of -1 is 0x81, and of 1 to 16 is
+                    // the single byte of the value:
+                    const int n = (int)opcode - (int)(OP_1 - 1);
+                    stack.emplace_back(1, n < 0 ? 0x81 : n);
                 }
                 break;
 
@@ -505,8 +519,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                         return false;
                     valtype vch1 = stacktop(-2);
                     valtype vch2 = stacktop(-1);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    stack.push_back(std::move(vch1));
+                    stack.push_back(std::move(vch2));
                 }
                 break;
 
@@ -518,9 +532,9 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     valtype vch1 = stacktop(-3);
                     valtype vch2 = stacktop(-2);
                     valtype vch3 = stacktop(-1);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
-                    stack.push_back(vch3);
+                    stack.push_back(std::move(vch1));
+                    stack.push_back(std::move(vch2));
+                    stack.push_back(std::move(vch3));
                 }
                 break;
 
@@ -531,8 +545,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                         return false;
                     valtype vch1 = stacktop(-4);
                     valtype vch2 = stacktop(-3);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    stack.push_back(std::move(vch1));
+                    stack.push_back(std::move(vch2));
                 }
                 break;
 
@@ -541,11 +555,11 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     // (x1 x2 x3 x4 x5 x6 -- x3 x4 x5 x6 x1 x2)
                     if (stack.size() < 6)
                         return false;
-                    valtype vch1 = stacktop(-6);
-                    valtype vch2 = stacktop(-5);
+                    valtype vch1 = std::move(stacktop(-6));
+                    valtype vch2 = std::move(stacktop(-5));
                     stack.erase(stack.end()-6, stack.end()-4);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    stack.push_back(std::move(vch1));
+                    stack.push_back(std::move(vch2));
                 }
                 break;
 
@@ -566,7 +580,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                         return false;
                     valtype vch = stacktop(-1);
                     if (CastToBool(vch))
-                        stack.push_back(vch);
+                        stack.push_back(std::move(vch));
                 }
                 break;
 
@@ -593,7 +607,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     if (stack.size() < 1)
                         return false;
                     valtype vch = stacktop(-1);
-                    stack.push_back(vch);
+                    stack.push_back(std::move(vch));
                 }
                 break;
 
@@ -612,7 +626,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     if (stack.size() < 2)
                         return false;
                     valtype vch = stacktop(-2);
-                    stack.push_back(vch);
+                    stack.push_back(std::move(vch));
                 }
                 break;
 
@@ -627,10 +641,15 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     popstack(stack);
                     if (n < 0 || n >= (int)stack.size())
                         return false;
-                    valtype vch = stacktop(-n-1);
+                    valtype vch;
                     if (opcode == OP_ROLL)
+                    {
+                        vch = std::move(stacktop(-n-1));
                         stack.erase(stack.end()-n-1);
-                    stack.push_back(vch);
+                    }
+                    else
+                        vch = stacktop(-n-1);
+                    stack.push_back(std::move(vch));
                 }
                 break;
 
@@ -800,14 +819,14 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     //    fEqual = !fEqual;
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fEqual ? vchTrue : vchFalse);
                     if (opcode == OP_EQUALVERIFY)
                     {
-                        if (fEqual)
-                            popstack(stack);
-                        else
+                        // The result would be pushed and popped again:
+                        if (!fEqual)
                             return false;
                     }
+                    else
+                        stack.push_back(fEqual ? vchTrue : vchFalse);
                 }
                 break;
 
@@ -880,20 +899,31 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                         bn = bn1 - bn2;
                         break;
 
+                    // These opcodes are disabled above. Only they need a
+                    // CAutoBN_CTX, so they create their own:
                     case OP_MUL:
+                    {
+                        CAutoBN_CTX pctx;
                         if (!BN_mul(&bn, &bn1, &bn2, pctx))
                             return false;
                         break;
+                    }
 
                     case OP_DIV:
+                    {
+                        CAutoBN_CTX pctx;
                         if (!BN_div(&bn, NULL, &bn1, &bn2, pctx))
                             return false;
                         break;
+                    }
 
                     case OP_MOD:
+                    {
+                        CAutoBN_CTX pctx;
                         if (!BN_mod(&bn, &bn1, &bn2, pctx))
                             return false;
                         break;
+                    }
 
                     case OP_LSHIFT:
                         if (bn2 < bnZero || bn2 > CBigNum(2048))
@@ -964,25 +994,27 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
                     if (stack.size() < 1)
                         return false;
                     valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    unsigned char vchHash[32];
+                    const size_t nHashSize = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
                     if (opcode == OP_RIPEMD160)
-                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA1)
-                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA256)
-                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH160)
                     {
                         uint160 hash160 = Hash160(vch);
-                        memcpy(vchHash.data(), &hash160, sizeof(hash160));
+                        memcpy(vchHash, &hash160, sizeof(hash160));
                     }
                     else if (opcode == OP_HASH256)
                     {
                         uint256 hash = Hash(vch.begin(), vch.end());
-                        memcpy(vchHash.data(), &hash, sizeof(hash));
+                        memcpy(vchHash, &hash, sizeof(hash));
                     }
-                    popstack(stack);
-                    stack.push_back(vchHash);
+                    // Replace the input in place. This reuses its buffer when
+                    // it is at least as large as the hash, as public keys are:
+                    vch.assign(vchHash, vchHash + nHashSize);
                 }
                 break;
 
@@ -1014,14 +1046,13 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
 
                     popstack(stack);
                     popstack(stack);
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
                     if (opcode == OP_CHECKSIGVERIFY)
                     {
-                        if (fSuccess)
-                            popstack(stack);
-                        else
+                        if (!fSuccess)
                             return false;
                     }
+                    else
+                        stack.push_back(fSuccess ? vchTrue : vchFalse);
                 }
                 break;
 
@@ -1145,131 +1176,322 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, co
 
 
 
-uint256 SignatureHash(CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+namespace {
+/**
+ * Serializes the transaction that a legacy signature hash commits to. It
+ * writes the same bytes as a copy of the transaction with the scripts of the
+ * other inputs blanked and the outputs trimmed for the hash type, but it
+ * streams them from the original transaction without copying it. Hashing a
+ * transaction for each of its N inputs copied N transactions before.
+ */
+class CTransactionSignatureSerializer
 {
-    static const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
+private:
+    const CTransaction& txTo;  //!< reference to the spending transaction (the one being serialized)
+    const CScript& scriptCode; //!< output script being consumed
+    const unsigned int nIn;    //!< input index of txTo being signed
+    const bool fAnyoneCanPay;  //!< whether the hashtype has the SIGHASH_ANYONECANPAY flag set
+    const bool fHashSingle;    //!< whether the hashtype is SIGHASH_SINGLE
+    const bool fHashNone;      //!< whether the hashtype is SIGHASH_NONE
 
-    if (nIn >= txTo.vin.size())
+public:
+    CTransactionSignatureSerializer(const CTransaction& txToIn, const CScript& scriptCodeIn, unsigned int nInIn, int nHashTypeIn)
+        : txTo(txToIn)
+        , scriptCode(scriptCodeIn)
+        , nIn(nInIn)
+        , fAnyoneCanPay(!!(nHashTypeIn & SIGHASH_ANYONECANPAY))
+        , fHashSingle((nHashTypeIn & 0x1f) == SIGHASH_SINGLE)
+        , fHashNone((nHashTypeIn & 0x1f) == SIGHASH_NONE)
     {
-        LogPrintf("ERROR: SignatureHash() : nIn=%d out of range", nIn);
-        return one;
     }
-    CTransaction txTmp(txTo);
 
-    // In case concatenating two scripts ends up with two codeseparators,
-    // or an extra one at the end, this prevents all those possible incompatibilities.
-    scriptCode.FindAndDelete(CScript(OP_CODESEPARATOR));
+    /** Serialize an input of txTo */
+    template<typename S>
+    void SerializeInput(S &s, unsigned int nInput) const
+    {
+        // In case of SIGHASH_ANYONECANPAY, only the input being signed is serialized
+        if (fAnyoneCanPay)
+            nInput = nIn;
 
-    // Blank out other inputs' signatures
-    for (unsigned int i = 0; i < txTmp.vin.size(); i++)
-        txTmp.vin[i].scriptSig = CScript();
-    txTmp.vin[nIn].scriptSig = scriptCode;
+        ::Serialize(s, txTo.vin[nInput].prevout);
 
-    // Blank out some of the outputs
-    if ((nHashType & 0x1f) == SIGHASH_NONE)
-    {
-        // Wildcard payee
-        txTmp.vout.clear();
+        // Blank out other inputs' signatures
+        if (nInput != nIn)
+            ::Serialize(s, CScript());
+        else
+            ::Serialize(s, scriptCode);
 
         // Let the others update at will
-        for (unsigned int i = 0; i < txTmp.vin.size(); i++)
-            if (i != nIn)
-                txTmp.vin[i].nSequence = 0;
+        if (nInput != nIn && (fHashSingle || fHashNone))
+            ::Serialize(s, (unsigned int)0);
+        else
+            ::Serialize(s, txTo.vin[nInput].nSequence);
     }
-    else if ((nHashType & 0x1f) == SIGHASH_SINGLE)
+
+    /** Serialize an output of txTo */
+    template<typename S>
+    void SerializeOutput(S &s, unsigned int nOutput) const
     {
         // Only lock-in the txout payee at same index as txin
-        unsigned int nOut = nIn;
-        if (nOut >= txTmp.vout.size())
-        {
-            LogPrintf("ERROR: SignatureHash() : nOut=%d out of range", nOut);
-            return one;
-        }
-        txTmp.vout.resize(nOut+1);
-        for (unsigned int i = 0; i < nOut; i++)
-            txTmp.vout[i].SetNull();
+        if (fHashSingle && nOutput != nIn)
+            ::Serialize(s, CTxOut());
+        else
+            ::Serialize(s, txTo.vout[nOutput]);
+    }
 
-        // Let the others update at will
-        for (unsigned int i = 0; i < txTmp.vin.size(); i++)
-            if (i != nIn)
-                txTmp.vin[i].nSequence = 0;
+    /** Serialize txTo */
+    template<typename S>
+    void Serialize(S &s) const
+    {
+        ::Serialize(s, txTo.nVersion);
+        ::Serialize(s, txTo.nTime);
+
+        // Serialize vin
+        const unsigned int nInputs = fAnyoneCanPay ? 1 : txTo.vin.size();
+        ::WriteCompactSize(s, nInputs);
+        for (unsigned int nInput = 0; nInput < nInputs; nInput++)
+            SerializeInput(s, nInput);
+
+        // Serialize vout
+        const unsigned int nOutputs = fHashNone ? 0 : (fHashSingle ? nIn + 1 : txTo.vout.size());
+        ::WriteCompactSize(s, nOutputs);
+        for (unsigned int nOutput = 0; nOutput < nOutputs; nOutput++)
+            SerializeOutput(s, nOutput);
+
+        ::Serialize(s, txTo.nLockTime);
+
+        if (txTo.nVersion >= 2)
+            ::Serialize(s, txTo.vContracts);
+        else
+            ::Serialize(s, txTo.hashBoinc);
+    }
+};
+} // anonymous namespace
+
+uint256 SignatureHash(CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+{
+    static const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
+
+    if (nIn >= txTo.vin.size())
+    {
+        LogPrintf("ERROR: SignatureHash() : nIn=%d out of range", nIn);
+        return one;
     }
 
-    // Blank out other inputs completely, not recommended for open transactions
-    if (nHashType & SIGHASH_ANYONECANPAY)
+    // Check for invalid use of SIGHASH_SINGLE
+    if ((nHashType & 0x1f) == SIGHASH_SINGLE && nIn >= txTo.vout.size())
     {
-        txTmp.vin[0] = txTmp.vin[nIn];
-        txTmp.vin.resize(1);
+        LogPrintf("ERROR: SignatureHash() : nOut=%d out of range", nIn);
+        return one;
     }
 
+    // In case concatenating two scripts ends up with two codeseparators,
+    // or an extra one at the end, this prevents all those possible incompatibilities.
+    scriptCode.FindAndDelete(CScript(OP_CODESEPARATOR));
+
     // Serialize and hash
-    CDataStream ss(SER_GETHASH, 0);
-    ss.reserve(10000);
-    ss << txTmp << nHashType;
-    return Hash(ss.begin(), ss.end());
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << CTransactionSignatureSerializer(txTo, scriptCode, nIn, nHashType) << nHashType;
+    return ss.GetHash();
 }
 
 
 // Valid signature cache, to avoid doing expensive ECDSA signature checking
 // twice for every transaction (once when accepted into memory pool, and
 // again when accepted into the block chain)
-
+//
+// Entries are stored as a salted SHA256 digest of (signature hash, signature,
+// public key) so that every entry has the same small, fixed size and the
+// cache can be bounded in bytes. The entries are spread across shards that
+// each have their own reader/writer lock: lookups only take a shared lock so
+// concurrent script check threads never wait on each other to read, and
+// inserts only contend with readers of the same shard.
+
+namespace {
 class CSignatureCache
 {
 private:
-     // sigdata_type is (signature hash, signature, public key):
-    typedef std::tuple<uint256, std::vector<unsigned char>, std::vector<unsigned char> > sigdata_type;
-    std::set< sigdata_type> setValid;
-    CCriticalSection cs_sigcache;
+    static constexpr size_t SHARD_COUNT = 16;
+
+    //! Approximate memory used by one entry: the digest in the slot vector,
+    //! and the digest plus node and bucket overhead in the lookup set.
+    static constexpr size_t BYTES_PER_ENTRY = sizeof(uint256) * 2 + 4 * sizeof(void*);
+
+    struct EntryHasher
+    {
+        size_t operator()(const uint256& entry) const
+        {
+            // Entries are salted digests, so any 64 bits are well-distributed:
+            return entry.GetUint64(1);
+        }
+    };
+
+    struct Shard
+    {
+        mutable boost::shared_mutex mutex;
+        std::unordered_set<uint256, EntryHasher> setValid;
+        std::vector<uint256> vSlots;
+    };
+
+    const uint256 nonce;
+    const size_t nMaxEntriesPerShard;
+    Shard shards[SHARD_COUNT];
+
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+    std::atomic<uint64_t> nInserts;
+    std::atomic<uint64_t> nEvictions;
+
+    static size_t MaxEntriesPerShard()
+    {
+        int64_t nMaxEntries;
+
+        // -maxsigcachesize is the legacy limit expressed as a number of
+        // entries. Honor it when set so existing configurations still work:
+        if (IsArgSet("-maxsigcachesize")) {
+            nMaxEntries = GetArg("-maxsigcachesize", 0);
+        } else {
+            int64_t nMaxMegabytes = GetArg("-sigcachesize", DEFAULT_SIGNATURE_CACHE_SIZE);
+            nMaxMegabytes = std::min<int64_t>(std::max<int64_t>(nMaxMegabytes, 0), MAX_SIGNATURE_CACHE_SIZE);
+            nMaxEntries = (nMaxMegabytes << 20) / BYTES_PER_ENTRY;
+        }
+
+        if (nMaxEntries <= 0) {
+            return 0;
+        }
+
+        return std::max<size_t>(1, nMaxEntries / SHARD_COUNT);
+    }
+
+    uint256 ComputeEntry(
+        const uint256& hash,
+        const std::vector<unsigned char>& vchSig,
+        const std::vector<unsigned char>& pubKey) const
+    {
+        uint256 entry;
+
+        CSHA256()
+            .Write(nonce.begin(), nonce.size())
+            .Write(hash.begin(), hash.size())
+            .Write(vchSig.data(), vchSig.size())
+            .Write(pubKey.data(), pubKey.size())
+            .Finalize(entry.begin());
+
+        return entry;
+    }
+
+    Shard& ShardFor(const uint256& entry)
+    {
+        return shards[entry.GetUint64(0) % SHARD_COUNT];
+    }
 
 public:
+    CSignatureCache()
+        : nonce(GetRandHash())
+        , nMaxEntriesPerShard(MaxEntriesPerShard())
+        , nHits(0)
+        , nMisses(0)
+        , nInserts(0)
+        , nEvictions(0)
+    {
+        for (auto& shard : shards) {
+            shard.setValid.reserve(nMaxEntriesPerShard);
+            shard.vSlots.reserve(nMaxEntriesPerShard);
+        }
+    }
+
     bool
     Get(uint256 hash, const std::vector<unsigned char>& vchSig, const std::vector<unsigned char>& pubKey)
     {
-        LOCK(cs_sigcache);
+        if (nMaxEntriesPerShard == 0) {
+            return false;
+        }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        std::set<sigdata_type>::iterator mi = setValid.find(k);
-        if (mi != setValid.end())
-            return true;
-        return false;
+        const uint256 entry = ComputeEntry(hash, vchSig, pubKey);
+        const Shard& shard = ShardFor(entry);
+
+        bool fFound;
+        {
+            boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+            fFound = shard.setValid.count(entry) > 0;
+        }
+
+        ++(fFound ? nHits : nMisses);
+
+        return fFound;
     }
 
     void Set(uint256 hash, const std::vector<unsigned char>& vchSig, const std::vector<unsigned char>& pubKey)
     {
-        // DoS prevention: limit cache size to less than 10MB
-        // (~200 bytes per cache entry times 50,000 entries)
-        // Since there are a maximum of 20,000 signature operations per block
-        // 50,000 is a reasonable default.
-        int64_t nMaxCacheSize = GetArg("-maxsigcachesize", 50000);
-        if (nMaxCacheSize <= 0) return;
+        if (nMaxEntriesPerShard == 0) {
+            return;
+        }
 
-        LOCK(cs_sigcache);
+        const uint256 entry = ComputeEntry(hash, vchSig, pubKey);
+        Shard& shard = ShardFor(entry);
 
-        while (static_cast<int64_t>(setValid.size()) > nMaxCacheSize)
-        {
-            // Evict a random entry. Random because that helps
-            // foil would-be DoS attackers who might try to pre-generate
-            // and re-use a set of valid signatures just-slightly-greater
-            // than our cache size.
-            uint256 randomHash = GetRandHash();
-            std::vector<unsigned char> unused;
-            std::set<sigdata_type>::iterator it =
-                setValid.lower_bound(sigdata_type(randomHash, unused, unused));
-            if (it == setValid.end())
-                it = setValid.begin();
-            setValid.erase(*it);
+        boost::unique_lock<boost::shared_mutex> lock(shard.mutex);
+
+        if (!shard.setValid.insert(entry).second) {
+            return;
+        }
+
+        ++nInserts;
+
+        if (shard.vSlots.size() < nMaxEntriesPerShard) {
+            shard.vSlots.push_back(entry);
+            return;
         }
 
-        sigdata_type k(hash, vchSig, pubKey);
-        setValid.insert(k);
+        // Evict a random entry. Random because that helps
+        // foil would-be DoS attackers who might try to pre-generate
+        // and re-use a set of valid signatures just-slightly-greater
+        // than our cache size.
+        uint256& slot = shard.vSlots[GetRand(shard.vSlots.size())];
+        shard.setValid.erase(slot);
+        slot = entry;
+
+        ++nEvictions;
+    }
+
+    SignatureCacheStats GetStats() const
+    {
+        SignatureCacheStats stats;
+
+        stats.nHits = nHits.load();
+        stats.nMisses = nMisses.load();
+        stats.nInserts = nInserts.load();
+        stats.nEvictions = nEvictions.load();
+        stats.nEntries = 0;
+        stats.nMaxEntries = nMaxEntriesPerShard * SHARD_COUNT;
+        stats.nMaxBytes = stats.nMaxEntries * BYTES_PER_ENTRY;
+
+        for (const auto& shard : shards) {
+            boost::shared_lock<boost::shared_mutex> lock(shard.mutex);
+            stats.nEntries += shard.vSlots.size();
+        }
+
+        return stats;
     }
 };
 
+CSignatureCache& GetSignatureCache()
+{
+    static CSignatureCache signatureCache;
+
+    return signatureCache;
+}
+} // Anonymous namespace
+
+SignatureCacheStats GetSignatureCacheStats()
+{
+    return GetSignatureCache().GetStats();
+}
+
 bool CheckSig(vector<unsigned char> vchSig, vector<unsigned char> vchPubKey, CScript scriptCode,
               const CTransaction& txTo, unsigned int nIn, int nHashType)
 {
-    static CSignatureCache signatureCache;
+    CSignatureCache& signatureCache = GetSignatureCache();
 
     // Hash type is one byte tacked on to the end of the signature
     if (vchSig.empty())
@@ -1285,11 +1507,7 @@ bool CheckSig(vector<unsigned char> vchSig, vector<unsigned char> vchPubKey, CSc
     if (signatureCache.Get(sighash, vchSig, vchPubKey))
         return true;
 
-    CKey key;
-    if (!key.SetPubKey(vchPubKey))
-        return false;
-
-    if (!key.Verify(sighash, vchSig))
+    if (!CPubKey(vchPubKey).Verify(sighash, vchSig))
         return false;
 
     signatureCache.Set(sighash, vchSig, vchPubKey);
@@ -1747,7 +1965,10 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
     if (!EvalScript(stack, scriptSig, txTo, nIn, nHashType))
         return false;
 
-    stackCopy = stack;
+    // Only the evaluation of the serialized script of a P2SH output needs the
+    // stack that the scriptSig left:
+    if (scriptPubKey.IsPayToScriptHash())
+        stackCopy = stack;
 
     if (!EvalScript(stack, scriptPubKey, txTo, nIn, nHashType))
         return false;
@@ -1823,6 +2044,56 @@ bool SignSignature(const CKeyStore &keystore, const CTransaction& txFrom, CTrans
     return SignSignature(keystore, txout.scriptPubKey, txTo, nIn, nHashType);
 }
 
+bool SignSignatures(const CKeyStore& keystore, const std::vector<CScript>& fromPubKeys, CTransaction& txTo, int nHashType)
+{
+    assert(fromPubKeys.size() == txTo.vin.size());
+
+    // The signature hash of an input blanks the scriptSig of every other
+    // input, so each signature depends only on the skeleton of the transaction
+    // and the inputs can be signed independently. A worker writes only to the
+    // scriptSig of the inputs it claims, and the key store and signature cache
+    // lock themselves.
+    //
+    // Below this many inputs, starting threads costs more than it saves:
+    static const size_t MIN_INPUTS_PER_THREAD = 8;
+
+    const size_t nInputs = txTo.vin.size();
+    const size_t nThreads = std::min<size_t>(
+        std::max(std::thread::hardware_concurrency(), 1u),
+        std::min<size_t>(16, nInputs / MIN_INPUTS_PER_THREAD));
+
+    if (nThreads <= 1) {
+        for (unsigned int nIn = 0; nIn < nInputs; ++nIn) {
+            if (!SignSignature(keystore, fromPubKeys[nIn], txTo, nIn, nHashType)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    std::atomic<size_t> nNext(0);
+    std::atomic<bool> fFailed(false);
+
+    const auto worker = [&]() {
+        try {
+            for (size_t nIn = nNext++; nIn < nInputs && !fFailed; nIn = nNext++) {
+                if (!SignSignature(keystore, fromPubKeys[nIn], txTo, nIn, nHashType)) {
+                    fFailed = true;
+                }
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("%s: %s", __func__, e.what());
+            fFailed = true;
+        }
+    };
+
+    // The calling thread runs one of the workers:
+    util::ParallelFor(util::Executor::VALIDATION, nThreads, [&](size_t) { worker(); });
+
+    return !fFailed;
+}
+
 bool VerifySignature(const CTransaction& txFrom, const CTransaction& txTo, unsigned int nIn, int nHashType)
 {
     assert(nIn < txTo.vin.size());
@@ -16,6 +16,7 @@
 #include "keystore.h"
 #include "bignum.h"
 #include "prevector.h"
+#include "span.h"
 #include "wallet/ismine.h"
 
 typedef std::vector<unsigned char> valtype;
@@ -275,7 +276,10 @@ protected:
 
 public:
     CScript() { }
-    CScript(const CScript& b) : CScriptBase(b.begin(), b.end()) { }
+    CScript(const CScript& b) = default;
+    // Declared so that moves of inputs, outputs and transactions, and
+    // vector growth, keep the allocation of a long script:
+    CScript(CScript&& b) = default;
     CScript(std::vector<unsigned char>::const_iterator pbegin, std::vector<unsigned char>::const_iterator pend) : CScriptBase(pbegin, pend) { }
     CScript(const_iterator pbegin, const_iterator pend) : CScriptBase(pbegin, pend) { }
 #ifndef _MSC_VER
@@ -404,6 +408,7 @@ public:
     }
 
     CScript& operator=(const CScript& other) = default;
+    CScript& operator=(CScript&& other) = default;
 
     bool GetOp(iterator& pc, opcodetype& opcodeRet, std::vector<unsigned char>& vchRet)
     {
@@ -432,6 +437,34 @@ public:
         return GetOp2(pc, opcodeRet, NULL);
     }
 
+    /** Read an instruction without copying its push data. On success,
+     *  dataRet points into the script at the data that the instruction
+     *  pushes, and is empty if it pushes nothing. The span is valid until
+     *  the script changes. */
+    bool GetOp(const_iterator& pc, opcodetype& opcodeRet, Span<const unsigned char>& dataRet) const
+    {
+        const size_t nStart = pc - begin();
+        dataRet = Span<const unsigned char>();
+
+        if (!GetOp2(pc, opcodeRet, NULL))
+            return false;
+
+        if (opcodeRet <= OP_PUSHDATA4)
+        {
+            // Skip the opcode and the size that precede the data:
+            const unsigned int nHeader = opcodeRet < OP_PUSHDATA1 ? 1
+                : opcodeRet == OP_PUSHDATA1 ? 2
+                : opcodeRet == OP_PUSHDATA2 ? 3
+                : 5;
+            const size_t nSize = (pc - begin()) - nStart - nHeader;
+
+            if (nSize > 0)
+                dataRet = Span<const unsigned char>(data() + nStart + nHeader, nSize);
+        }
+
+        return true;
+    }
+
     bool GetOp2(const_iterator& pc, opcodetype& opcodeRet, std::vector<unsigned char>* pvchRet) const
     {
         opcodeRet = OP_INVALIDOPCODE;
@@ -607,10 +640,32 @@ bool ExtractDestination(const CScript& scriptPubKey, CTxDestination& addressRet)
 bool ExtractDestinations(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<CTxDestination>& addressRet, int& nRequiredRet);
 bool SignSignature(const CKeyStore& keystore, const CScript& fromPubKey, CTransaction& txTo, unsigned int nIn, int nHashType=SIGHASH_ALL);
 bool SignSignature(const CKeyStore& keystore, const CTransaction& txFrom, CTransaction& txTo, unsigned int nIn, int nHashType=SIGHASH_ALL);
+/** Sign every input of txTo against the output script at the same index of
+    fromPubKeys. Large transactions are signed on several threads. */
+bool SignSignatures(const CKeyStore& keystore, const std::vector<CScript>& fromPubKeys, CTransaction& txTo, int nHashType=SIGHASH_ALL);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CTransaction& txTo, unsigned int nIn,
                   int nHashType);
 bool VerifySignature(const CTransaction& txFrom, const CTransaction& txTo, unsigned int nIn, int nHashType);
 
+/** Default -sigcachesize: maximum signature cache memory in megabytes */
+static const int64_t DEFAULT_SIGNATURE_CACHE_SIZE = 32;
+/** Upper bound for -sigcachesize in megabytes */
+static const int64_t MAX_SIGNATURE_CACHE_SIZE = 16384;
+
+/** Counters that describe the effectiveness of the signature cache */
+struct SignatureCacheStats
+{
+    uint64_t nHits;       //!< Lookups that found a verified signature.
+    uint64_t nMisses;     //!< Lookups that required a full verification.
+    uint64_t nInserts;    //!< Newly-verified signatures stored.
+    uint64_t nEvictions;  //!< Entries replaced to stay under the size limit.
+    size_t nEntries;      //!< Current number of cached signatures.
+    size_t nMaxEntries;   //!< Number of signatures that fit in the cache.
+    size_t nMaxBytes;     //!< Approximate memory limit of the cache.
+};
+
+SignatureCacheStats GetSignatureCacheStats();
+
 // Given two sets of signatures for scriptPubKey, possibly with OP_0 placeholders,
 // combine them intelligently and return the result.
 CScript CombineSignatures(CScript scriptPubKey, const CTransaction& txTo, unsigned int nIn, const CScript& scriptSig1, const CScript& scriptSig2);
@@ -29,6 +29,12 @@
 
 #include <stdlib.h>
 #include <stdint.h>
+#include <algorithm>
+#include <memory>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "util.h"
 #include "scrypt.h"
@@ -197,3 +203,110 @@ uint256 scrypt_blockhash(const void* input)
     return scrypt_nosalt(input, 80, scratchpad);
 }
 
+
+#if defined(__SSE2__)
+// Four-way scrypt_core. Word k of lane l lives at X[k * 4 + l], so that each
+// SSE2 register holds the same word of four independent hashes.
+
+static inline __m128i rotl_4way(__m128i x, int n)
+{
+    return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n));
+}
+
+static inline void xor_salsa8_4way(__m128i B[16], const __m128i Bx[16])
+{
+    __m128i x[16];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        x[i] = B[i] = _mm_xor_si128(B[i], Bx[i]);
+
+    for (i = 0; i < 8; i += 2) {
+#define R(a, b, c, n) x[a] = _mm_xor_si128(x[a], rotl_4way(_mm_add_epi32(x[b], x[c]), n))
+        /* Operate on columns. */
+        R( 4, 0,12, 7); R( 9, 5, 1, 7); R(14,10, 6, 7); R( 3,15,11, 7);
+        R( 8, 4, 0, 9); R(13, 9, 5, 9); R( 2,14,10, 9); R( 7, 3,15, 9);
+        R(12, 8, 4,13); R( 1,13, 9,13); R( 6, 2,14,13); R(11, 7, 3,13);
+        R( 0,12, 8,18); R( 5, 1,13,18); R(10, 6, 2,18); R(15,11, 7,18);
+
+        /* Operate on rows. */
+        R( 1, 0, 3, 7); R( 6, 5, 4, 7); R(11,10, 9, 7); R(12,15,14, 7);
+        R( 2, 1, 0, 9); R( 7, 6, 5, 9); R( 8,11,10, 9); R(13,12,15, 9);
+        R( 3, 2, 1,13); R( 4, 7, 6,13); R( 9, 8,11,13); R(14,13,12,13);
+        R( 0, 3, 2,18); R( 5, 4, 7,18); R(10, 9, 8,18); R(15,14,13,18);
+#undef R
+    }
+
+    for (i = 0; i < 16; i++)
+        B[i] = _mm_add_epi32(B[i], x[i]);
+}
+
+static void scrypt_core_4way(uint32_t *X, uint32_t *V)
+{
+    __m128i *X4 = (__m128i *)X;
+    unsigned int i, k;
+
+    for (i = 0; i < 1024; i++) {
+        memcpy(&V[i * 128], X, 512);
+        xor_salsa8_4way(&X4[0], &X4[16]);
+        xor_salsa8_4way(&X4[16], &X4[0]);
+    }
+    for (i = 0; i < 1024; i++) {
+        // Each lane reads its own entry of the scratchpad:
+        const uint32_t *V0 = &V[128 * (X[16 * 4 + 0] & 1023) + 0];
+        const uint32_t *V1 = &V[128 * (X[16 * 4 + 1] & 1023) + 1];
+        const uint32_t *V2 = &V[128 * (X[16 * 4 + 2] & 1023) + 2];
+        const uint32_t *V3 = &V[128 * (X[16 * 4 + 3] & 1023) + 3];
+
+        for (k = 0; k < 32; k++)
+            X4[k] = _mm_xor_si128(X4[k], _mm_set_epi32(V3[k * 4], V2[k * 4], V1[k * 4], V0[k * 4]));
+        xor_salsa8_4way(&X4[0], &X4[16]);
+        xor_salsa8_4way(&X4[16], &X4[0]);
+    }
+}
+
+void scrypt_blockhash_batch(const void* const* inputs, uint256* outputs, size_t count)
+{
+    if (count < 2) {
+        if (count == 1)
+            outputs[0] = scrypt_blockhash(inputs[0]);
+        return;
+    }
+
+    // 16-byte aligned state of four lanes and their 512 KiB scratchpad:
+    std::unique_ptr<unsigned char[]> buffer(new unsigned char[512 + 4 * 131072 + 63]);
+    uint32_t *X = (uint32_t *)(((uintptr_t)(buffer.get()) + 63) & ~ (uintptr_t)(63));
+    uint32_t *V = X + 128;
+
+    for (size_t n = 0; n < count; n += 4) {
+        const size_t lanes = std::min<size_t>(count - n, 4);
+        uint32_t B[32];
+        size_t l, k;
+
+        for (l = 0; l < 4; l++) {
+            // Hash the last header again in the unused lanes:
+            const uint8_t* input = (const uint8_t*)inputs[n + std::min(l, lanes - 1)];
+
+            PBKDF2_SHA256(input, 80, input, 80, 1, (uint8_t *)B, 128);
+            for (k = 0; k < 32; k++)
+                X[k * 4 + l] = B[k];
+        }
+
+        scrypt_core_4way(X, V);
+
+        for (l = 0; l < lanes; l++) {
+            const uint8_t* input = (const uint8_t*)inputs[n + l];
+
+            for (k = 0; k < 32; k++)
+                B[k] = X[k * 4 + l];
+            PBKDF2_SHA256(input, 80, (uint8_t *)B, 128, 1, (uint8_t*)&outputs[n + l], 32);
+        }
+    }
+}
+#else
+void scrypt_blockhash_batch(const void* const* inputs, uint256* outputs, size_t count)
+{
+    for (size_t n = 0; n < count; n++)
+        outputs[n] = scrypt_blockhash(inputs[n]);
+}
+#endif
@@ -10,4 +10,13 @@ uint256 scrypt_salted_hash(const void* input, size_t inputlen, const void* salt,
 uint256 scrypt_hash(const void* input, size_t inputlen);
 uint256 scrypt_blockhash(const void* input);
 
+/** Number of headers that scrypt_blockhash_batch() hashes at once. */
+static const size_t SCRYPT_BATCH_LANES = 4;
+
+/**
+ * Hash several 80-byte block headers like scrypt_blockhash(). Interleaves
+ * SCRYPT_BATCH_LANES hashes in the SIMD registers where SSE2 is available.
+ */
+void scrypt_blockhash_batch(const void* const* inputs, uint256* outputs, size_t count);
+
 #endif // SCRYPT_MINE_H
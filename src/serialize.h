@@ -18,6 +18,7 @@
 #include <stdint.h>
 #include <string>
 #include <string.h>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -674,9 +675,30 @@ template<typename Stream, unsigned int N, typename T> void Unserialize_impl(Stre
 template<typename Stream, unsigned int N, typename T, typename V> void Unserialize_impl(Stream& is, prevector<N, T>& v, const V&);
 template<typename Stream, unsigned int N, typename T> inline void Unserialize(Stream& is, prevector<N, T>& v);
 
+/**
+ * Detects the types that serialize as an exact copy of their memory, so that
+ * vectors of them read and write in one bulk operation. A type opts in with a
+ * true BULK_SERIALIZABLE static constexpr member. It must be trivially
+ * copyable, have no padding and serialize to sizeof(T) bytes in its memory
+ * order, which for multi-byte integer fields only holds on little-endian
+ * hosts.
+ */
+template<typename T, typename = void>
+struct is_bulk_serializable : std::integral_constant<bool,
+    std::is_same<T, unsigned char>::value
+    || std::is_same<T, signed char>::value
+    || std::is_same<T, char>::value> { };
+
+template<typename T>
+struct is_bulk_serializable<T, typename std::enable_if<T::BULK_SERIALIZABLE>::type> : std::true_type
+{
+    static_assert(std::is_trivially_copyable<T>::value, "bulk serializable types must be trivially copyable");
+};
+
 /**
  * vector
  * vectors of unsigned char are a special case and are intended to be serialized as a single opaque blob.
+ * Vectors of the other bulk serializable types share that path.
  */
 template<typename Stream, typename T, typename A> void Serialize_impl(Stream& os, const std::vector<T, A>& v, const unsigned char&);
 template<typename Stream, typename T, typename A> void Serialize_impl(Stream& os, const std::vector<T, A>& v, const bool&);
@@ -867,7 +889,7 @@ void Serialize_impl(Stream& os, const std::vector<T, A>& v, const V&)
 template<typename Stream, typename T, typename A>
 inline void Serialize(Stream& os, const std::vector<T, A>& v)
 {
-    Serialize_impl(os, v, T());
+    Serialize_impl(os, v, typename std::conditional<is_bulk_serializable<T>::value, unsigned char, T>::type());
 }
 
 
@@ -908,7 +930,7 @@ void Unserialize_impl(Stream& is, std::vector<T, A>& v, const V&)
 template<typename Stream, typename T, typename A>
 inline void Unserialize(Stream& is, std::vector<T, A>& v)
 {
-    Unserialize_impl(is, v, T());
+    Unserialize_impl(is, v, typename std::conditional<is_bulk_serializable<T>::value, unsigned char, T>::type());
 }
 
 
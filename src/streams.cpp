@@ -0,0 +1,127 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "streams.h"
+
+#include <array>
+
+constexpr size_t CStreamBufferPool::MIN_BUFFER_SIZE; // for clang
+constexpr size_t CStreamBufferPool::MAX_BUFFER_SIZE; // for clang
+constexpr size_t CStreamBufferPool::MAX_POOLED_BYTES; // for clang
+
+namespace {
+//!
+//! \brief Get the smallest size class that holds \p nSize bytes.
+//!
+size_t StreamBufferClass(size_t nSize)
+{
+    size_t nClass = 0;
+
+    while ((CStreamBufferPool::MIN_BUFFER_SIZE << nClass) < nSize) {
+        ++nClass;
+    }
+
+    return nClass;
+}
+
+constexpr size_t STREAM_BUFFER_CLASSES = 10; //!< 256 B to 128 KiB.
+
+//!
+//! \brief The free buffers of one thread.
+//!
+struct ThreadBufferCache
+{
+    std::array<std::vector<CSerializeData>, STREAM_BUFFER_CLASSES> m_free;
+    size_t m_bytes = 0;
+    uint64_t m_hits = 0;
+    uint64_t m_misses = 0;
+
+    ~ThreadBufferCache();
+};
+
+//! Set when the cache of the thread is gone. Streams destroyed later during
+//! the thread exit free their buffers instead.
+thread_local bool g_cache_destroyed = false;
+thread_local ThreadBufferCache g_cache;
+
+ThreadBufferCache::~ThreadBufferCache()
+{
+    g_cache_destroyed = true;
+}
+
+ThreadBufferCache* GetCache()
+{
+    return g_cache_destroyed ? nullptr : &g_cache;
+}
+} // anonymous namespace
+
+void CStreamBufferPool::Take(CSerializeData& buffer, size_t nSize)
+{
+    ThreadBufferCache* cache = nSize <= MAX_BUFFER_SIZE ? GetCache() : nullptr;
+
+    if (!cache) {
+        buffer.reserve(nSize);
+        return;
+    }
+
+    const size_t nClass = StreamBufferClass(nSize);
+
+    for (size_t i = nClass; i < STREAM_BUFFER_CLASSES; ++i) {
+        if (!cache->m_free[i].empty()) {
+            buffer.swap(cache->m_free[i].back());
+            cache->m_free[i].pop_back();
+            cache->m_bytes -= buffer.capacity();
+            ++cache->m_hits;
+
+            return;
+        }
+    }
+
+    ++cache->m_misses;
+    buffer.reserve(MIN_BUFFER_SIZE << nClass);
+}
+
+void CStreamBufferPool::Give(CSerializeData& buffer, bool fCleanse)
+{
+    const size_t nCapacity = buffer.capacity();
+
+    if (nCapacity < MIN_BUFFER_SIZE || nCapacity > MAX_BUFFER_SIZE) {
+        return;
+    }
+
+    ThreadBufferCache* cache = GetCache();
+
+    if (!cache || cache->m_bytes + nCapacity > MAX_POOLED_BYTES) {
+        return;
+    }
+
+    // File the buffer under the largest class that it fills:
+    size_t nClass = StreamBufferClass(nCapacity);
+
+    if ((MIN_BUFFER_SIZE << nClass) > nCapacity) {
+        --nClass;
+    }
+
+    if (fCleanse) {
+        memory_cleanse(buffer.data(), nCapacity);
+    }
+
+    buffer.clear();
+
+    cache->m_bytes += nCapacity;
+    cache->m_free[nClass].emplace_back(std::move(buffer));
+}
+
+CStreamBufferPool::Stats CStreamBufferPool::GetStats()
+{
+    Stats stats = { 0, 0, 0 };
+
+    if (const ThreadBufferCache* cache = GetCache()) {
+        stats.hits = cache->m_hits;
+        stats.misses = cache->m_misses;
+        stats.bytes = cache->m_bytes;
+    }
+
+    return stats;
+}
@@ -8,6 +8,7 @@
 
 #include <support/allocators/zeroafterfree.h>
 #include <serialize.h>
+#include <span.h>
 
 #include <algorithm>
 #include <assert.h>
@@ -195,6 +196,106 @@ public:
     }
 };
 
+/** Minimal stream for reading from a span of memory that the caller owns,
+ * like a memory-mapped file. The data is not copied until it is read.
+ */
+class SpanReader
+{
+private:
+    const int m_type;
+    const int m_version;
+    const char* m_data;
+    size_t m_size;
+
+public:
+
+    /**
+     * @param[in]  type Serialization Type
+     * @param[in]  version Serialization Version (including any flags)
+     * @param[in]  data Start of the referenced memory
+     * @param[in]  size Number of bytes available to read
+     */
+    SpanReader(int type, int version, const char* data, size_t size)
+        : m_type(type), m_version(version), m_data(data), m_size(size)
+    {
+    }
+
+    /**
+     * @param[in]  type Serialization Type
+     * @param[in]  version Serialization Version (including any flags)
+     * @param[in]  data Referenced memory
+     */
+    SpanReader(int type, int version, Span<const unsigned char> data)
+        : SpanReader(type, version, reinterpret_cast<const char*>(data.data()), data.size())
+    {
+    }
+
+    template<typename T>
+    SpanReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+
+    int GetVersion() const { return m_version; }
+    int GetType() const { return m_type; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    void read(char* dst, size_t n)
+    {
+        if (n > m_size) {
+            throw std::ios_base::failure("SpanReader::read(): end of data");
+        }
+        memcpy(dst, m_data, n);
+        m_data += n;
+        m_size -= n;
+    }
+};
+
+//!
+//! \brief Per-thread cache of CDataStream buffers by size class.
+//!
+//! A stream takes its buffer from the cache of the thread that constructs it
+//! and gives the buffer back to the cache of the thread that destroys it. The
+//! short-lived streams of the database and network code skip an allocation
+//! and a free that way. Buffers from secret streams are cleansed before they
+//! enter the cache, and buffers that leave it still pass through the zeroing
+//! allocator of CSerializeData.
+//!
+class CStreamBufferPool
+{
+public:
+    static constexpr size_t MIN_BUFFER_SIZE = 256;                //!< Smallest class.
+    static constexpr size_t MAX_BUFFER_SIZE = 128 * 1024;         //!< Largest class.
+    static constexpr size_t MAX_POOLED_BYTES = 1024 * 1024;       //!< Per thread.
+
+    struct Stats
+    {
+        uint64_t hits;   //!< Buffers reused.
+        uint64_t misses; //!< Buffers allocated.
+        size_t bytes;    //!< Capacity of the cached buffers.
+    };
+
+    //!
+    //! \brief Replace an empty buffer with one of at least \p nSize bytes.
+    //!
+    static void Take(CSerializeData& buffer, size_t nSize);
+
+    //!
+    //! \brief Move a buffer into the cache of the calling thread. Leaves the
+    //! buffers outside the size classes or beyond MAX_POOLED_BYTES in place.
+    //!
+    //! \param fCleanse Whether to wipe the whole capacity of the buffer.
+    //!
+    static void Give(CSerializeData& buffer, bool fCleanse);
+
+    //! Get the counters of the calling thread.
+    static Stats GetStats();
+};
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -209,6 +310,16 @@ protected:
 
     int nType;
     int nVersion;
+
+    //! Whether to cleanse the buffer when it returns to CStreamBufferPool.
+    bool m_secret = true;
+
+    template <typename It>
+    void InitBuffer(It pbegin, It pend)
+    {
+        CStreamBufferPool::Take(vch, pend - pbegin);
+        vch.assign(pbegin, pend);
+    }
 public:
 
     typedef vector_type::allocator_type   allocator_type;
@@ -224,40 +335,57 @@ public:
     explicit CDataStream(int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
+        CStreamBufferPool::Take(vch, 0);
     }
 
-    CDataStream(const_iterator pbegin, const_iterator pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
+    CDataStream(const_iterator pbegin, const_iterator pend, int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
+        InitBuffer(pbegin, pend);
     }
 
-    CDataStream(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
+    CDataStream(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
+        InitBuffer(pbegin, pend);
     }
 
-    CDataStream(const vector_type& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
+    CDataStream(const vector_type& vchIn, int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
+        InitBuffer(vchIn.begin(), vchIn.end());
     }
 
-    CDataStream(const std::vector<char>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
+    CDataStream(const std::vector<char>& vchIn, int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
+        InitBuffer(vchIn.begin(), vchIn.end());
     }
 
-    CDataStream(const std::vector<unsigned char>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
+    CDataStream(const std::vector<unsigned char>& vchIn, int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
+        InitBuffer(vchIn.begin(), vchIn.end());
     }
 
     template <typename... Args>
     CDataStream(int nTypeIn, int nVersionIn, Args&&... args)
     {
         Init(nTypeIn, nVersionIn);
+        CStreamBufferPool::Take(vch, 0);
         ::SerializeMany(*this, std::forward<Args>(args)...);
     }
 
+    CDataStream(const CDataStream&) = default;
+    CDataStream(CDataStream&&) = default;
+    CDataStream& operator=(const CDataStream&) = default;
+    CDataStream& operator=(CDataStream&&) = default;
+
+    ~CDataStream()
+    {
+        CStreamBufferPool::Give(vch, m_secret);
+    }
+
     void Init(int nTypeIn, int nVersionIn)
     {
         nReadPos = 0;
@@ -294,10 +422,21 @@ public:
     size_type size() const                           { return vch.size() - nReadPos; }
     bool empty() const                               { return vch.size() == nReadPos; }
     void resize(size_type n, value_type c=0)         { vch.resize(n + nReadPos, c); }
-    void reserve(size_type n)                        { vch.reserve(n + nReadPos); }
+    void reserve(size_type n)
+    {
+        if (vch.empty() && n > vch.capacity()) {
+            // Trade the buffer for a pooled one of the new size class:
+            CStreamBufferPool::Give(vch, m_secret);
+            CStreamBufferPool::Take(vch, n);
+            nReadPos = 0;
+        } else {
+            vch.reserve(n + nReadPos);
+        }
+    }
     const_reference operator[](size_type pos) const  { return vch[pos + nReadPos]; }
     reference operator[](size_type pos)              { return vch[pos + nReadPos]; }
     void clear()                                     { vch.clear(); nReadPos = 0; }
+    size_type capacity() const                       { return vch.capacity() - nReadPos; }
     iterator insert(iterator it, const char x=char()) { return vch.insert(it, x); }
     void insert(iterator it, size_type n, const char x) { vch.insert(it, n, x); }
     value_type* data()                               { return vch.data() + nReadPos; }
@@ -396,6 +535,10 @@ public:
     void SetVersion(int n)       { nVersion = n; }
     int GetVersion() const       { return nVersion; }
 
+    //! Let the buffer return to CStreamBufferPool without a cleanse. Only for
+    //! streams that never hold key material.
+    void SetSecret(bool secret)  { m_secret = secret; }
+
     void read(char* pch, size_t nSize)
     {
         if (nSize == 0) return;
@@ -468,6 +611,12 @@ public:
         clear();
     }
 
+    //! Exchange the underlying buffer with \p d and reset the read position.
+    void SwapBuffer(CSerializeData &d) {
+        vch.swap(d);
+        nReadPos = 0;
+    }
+
     /**
      * XOR the contents of this stream with a certain key.
      *
@@ -6,8 +6,10 @@
 #include "util.h"
 
 #include <stdio.h>
+#include <map>
 #include <set>
 #include <memory>
+#include <unordered_map>
 
 #ifdef DEBUG_LOCKCONTENTION
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
@@ -17,6 +19,140 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<bool> g_lock_profile(false);
+
+namespace {
+void StoreMax(std::atomic<uint64_t>& max, uint64_t value)
+{
+    uint64_t current = max.load(std::memory_order_relaxed);
+
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * Owns the lock site statistics. Never destroyed because locks may be taken
+ * during static destruction.
+ */
+struct LockProfileRegistry
+{
+    std::mutex mutex;
+    std::map<std::pair<std::string, int>, std::unique_ptr<CLockSiteStats>> sites;
+};
+
+LockProfileRegistry& GetLockProfileRegistry()
+{
+    static LockProfileRegistry* registry = new LockProfileRegistry();
+    return *registry;
+}
+
+struct LockSiteKeyHash
+{
+    size_t operator()(const std::pair<const char*, int>& key) const
+    {
+        return std::hash<const char*>()(key.first) ^ (size_t)key.second;
+    }
+};
+} // anonymous namespace
+
+CLockSiteStats::CLockSiteStats(const char* pszName, const char* pszFile, int nLine)
+    : strName(pszName), strFile(pszFile), nLine(nLine)
+    , nLocks(0), nContended(0), nWaitUsec(0), nMaxWaitUsec(0)
+    , nHoldUsec(0), nMaxHoldUsec(0), nTryFailures(0)
+{
+}
+
+void CLockSiteStats::RecordWait(uint64_t nUsec)
+{
+    nContended.fetch_add(1, std::memory_order_relaxed);
+    nWaitUsec.fetch_add(nUsec, std::memory_order_relaxed);
+    StoreMax(nMaxWaitUsec, nUsec);
+}
+
+void CLockSiteStats::RecordHold(uint64_t nUsec)
+{
+    nHoldUsec.fetch_add(nUsec, std::memory_order_relaxed);
+    StoreMax(nMaxHoldUsec, nUsec);
+}
+
+void CLockSiteStats::Reset()
+{
+    nLocks = 0;
+    nContended = 0;
+    nWaitUsec = 0;
+    nMaxWaitUsec = 0;
+    nHoldUsec = 0;
+    nMaxHoldUsec = 0;
+    nTryFailures = 0;
+}
+
+CLockSiteStats::Snapshot CLockSiteStats::GetSnapshot() const
+{
+    Snapshot snapshot;
+
+    snapshot.strName = strName;
+    snapshot.strFile = strFile;
+    snapshot.nLine = nLine;
+    snapshot.nLocks = nLocks.load(std::memory_order_relaxed);
+    snapshot.nContended = nContended.load(std::memory_order_relaxed);
+    snapshot.nWaitUsec = nWaitUsec.load(std::memory_order_relaxed);
+    snapshot.nMaxWaitUsec = nMaxWaitUsec.load(std::memory_order_relaxed);
+    snapshot.nHoldUsec = nHoldUsec.load(std::memory_order_relaxed);
+    snapshot.nMaxHoldUsec = nMaxHoldUsec.load(std::memory_order_relaxed);
+    snapshot.nTryFailures = nTryFailures.load(std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+CLockSiteStats* GetLockSiteStats(const char* pszName, const char* pszFile, int nLine)
+{
+    // The file name literal has one address in each translation unit. The
+    // cache avoids the registry lock for the sites that a thread has seen:
+    thread_local std::unordered_map<std::pair<const char*, int>, CLockSiteStats*, LockSiteKeyHash> cache;
+
+    CLockSiteStats*& cached = cache[std::make_pair(pszFile, nLine)];
+
+    if (!cached) {
+        LockProfileRegistry& registry = GetLockProfileRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+
+        std::unique_ptr<CLockSiteStats>& site = registry.sites[std::make_pair(std::string(pszFile), nLine)];
+
+        if (!site) {
+            site.reset(new CLockSiteStats(pszName, pszFile, nLine));
+        }
+
+        cached = site.get();
+    }
+
+    return cached;
+}
+
+std::vector<CLockSiteStats::Snapshot> GetLockProfile()
+{
+    LockProfileRegistry& registry = GetLockProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    std::vector<CLockSiteStats::Snapshot> snapshots;
+    snapshots.reserve(registry.sites.size());
+
+    for (const auto& entry : registry.sites) {
+        snapshots.push_back(entry.second->GetSnapshot());
+    }
+
+    return snapshots;
+}
+
+void ResetLockProfile()
+{
+    LockProfileRegistry& registry = GetLockProfileRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+
+    for (auto& entry : registry.sites) {
+        entry.second->Reset();
+    }
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -7,10 +7,16 @@
 #define BITCOIN_SYNC_H
 
 #include "threadsafety.h"
+#include "util/perf.h"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <stdint.h>
+#include <string>
 #include <thread>
 #include <mutex>
+#include <vector>
 
 ////////////////////////////////////////////////
 //                                            //
@@ -105,31 +111,117 @@ typedef std::condition_variable CConditionVariable;
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/** Whether LOCK() and TRY_LOCK() record the statistics of their sites. Set by -lockprofile. */
+extern std::atomic<bool> g_lock_profile;
+
+/**
+ * Contention statistics of one LOCK() or TRY_LOCK() site in the source. The
+ * profiler keys the sites by file and line.
+ */
+class CLockSiteStats
+{
+public:
+    /** A copy of the values for reporting. */
+    struct Snapshot
+    {
+        std::string strName;
+        std::string strFile;
+        int nLine;
+        uint64_t nLocks;       //!< Times that the site acquired the lock.
+        uint64_t nContended;   //!< Acquisitions that had to wait for another thread.
+        uint64_t nWaitUsec;    //!< Time spent waiting for the lock.
+        uint64_t nMaxWaitUsec; //!< Longest wait.
+        uint64_t nHoldUsec;    //!< Time that the site held the lock.
+        uint64_t nMaxHoldUsec; //!< Longest hold.
+        uint64_t nTryFailures; //!< TRY_LOCK() calls that did not get the lock.
+    };
+
+    CLockSiteStats(const char* pszName, const char* pszFile, int nLine);
+
+    void RecordLock() { nLocks.fetch_add(1, std::memory_order_relaxed); }
+    void RecordWait(uint64_t nUsec);
+    void RecordHold(uint64_t nUsec);
+    void RecordTryFailure() { nTryFailures.fetch_add(1, std::memory_order_relaxed); }
+
+    void Reset();
+    Snapshot GetSnapshot() const;
+
+private:
+    const std::string strName;
+    const std::string strFile;
+    const int nLine;
+    std::atomic<uint64_t> nLocks;
+    std::atomic<uint64_t> nContended;
+    std::atomic<uint64_t> nWaitUsec;
+    std::atomic<uint64_t> nMaxWaitUsec;
+    std::atomic<uint64_t> nHoldUsec;
+    std::atomic<uint64_t> nMaxHoldUsec;
+    std::atomic<uint64_t> nTryFailures;
+};
+
+/**
+ * Get the statistics of a lock site, creating them on the first call. Each
+ * thread caches the sites that it looked up.
+ */
+CLockSiteStats* GetLockSiteStats(const char* pszName, const char* pszFile, int nLine);
+
+/** Copy the statistics of every lock site recorded so far. */
+std::vector<CLockSiteStats::Snapshot> GetLockProfile();
+
+/** Clear the statistics of every lock site. */
+void ResetLockProfile();
+
 /** Wrapper around std::unique_lock<CCriticalSection> */
 class SCOPED_LOCKABLE CCriticalBlock
 {
 private:
+    typedef std::chrono::steady_clock Clock;
+
     std::unique_lock<CCriticalSection> lock;
+    CLockSiteStats* pSite = nullptr; //!< Statistics of the site with -lockprofile.
+    Clock::time_point nHoldStart;
+
+    static uint64_t MicrosSince(const Clock::time_point& start)
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+    }
 
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
+        if (g_lock_profile.load(std::memory_order_relaxed))
+            pSite = GetLockSiteStats(pszName, pszFile, nLine);
         if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
+            // Only a contended lock pays for the timers:
+            util::PerfTimer timer("LockContention.", pszName);
+            const Clock::time_point nWaitStart = pSite ? Clock::now() : Clock::time_point();
             lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+            if (pSite)
+                pSite->RecordWait(MicrosSince(nWaitStart));
+        }
+        if (pSite) {
+            pSite->RecordLock();
+            nHoldStart = Clock::now();
         }
-#endif
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()), true);
+        if (g_lock_profile.load(std::memory_order_relaxed))
+            pSite = GetLockSiteStats(pszName, pszFile, nLine);
         lock.try_lock();
-        if (!lock.owns_lock())
+        if (!lock.owns_lock()) {
             LeaveCritical();
+            if (pSite)
+                pSite->RecordTryFailure();
+        } else if (pSite) {
+            pSite->RecordLock();
+            nHoldStart = Clock::now();
+        }
         return lock.owns_lock();
     }
 
@@ -155,8 +247,11 @@ public:
 
     ~CCriticalBlock() UNLOCK_FUNCTION()
     {
-        if (lock.owns_lock())
+        if (lock.owns_lock()) {
+            if (pSite)
+                pSite->RecordHold(MicrosSince(nHoldStart));
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -0,0 +1,88 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindex.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+std::string SerializeKey(const CAddressIndexKey& key)
+{
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << std::string("addrtx") << key;
+
+    return stream.str();
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+BOOST_AUTO_TEST_CASE(it_sorts_the_history_of_an_address_by_height)
+{
+    const uint160 hashScript = GetAddressIndexHash(CScript() << OP_TRUE);
+    const uint256 txid_low = uint256S("0xff");
+    const uint256 txid_high = uint256S("0x01");
+
+    // Little-endian heights would sort 256 before 1:
+    const std::string key_1 = SerializeKey(CAddressIndexKey(hashScript, 1, txid_low, 0, false));
+    const std::string key_256 = SerializeKey(CAddressIndexKey(hashScript, 256, txid_high, 0, false));
+
+    BOOST_CHECK(key_1 < key_256);
+
+    // Every key of the address starts with the scan prefix:
+    CDataStream prefix(SER_DISK, CLIENT_VERSION);
+    prefix << std::string("addrtx") << hashScript;
+
+    BOOST_CHECK_EQUAL(key_1.compare(0, prefix.size(), prefix.str()), 0);
+    BOOST_CHECK_EQUAL(key_256.compare(0, prefix.size(), prefix.str()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_round_trips_a_history_key)
+{
+    const CAddressIndexKey key(
+        GetAddressIndexHash(CScript() << OP_TRUE),
+        1234567,
+        uint256S("0x0102"),
+        3,
+        true);
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << key;
+
+    CAddressIndexKey decoded;
+    stream >> decoded;
+
+    BOOST_CHECK(decoded.hashScript == key.hashScript);
+    BOOST_CHECK_EQUAL(decoded.nHeight, key.nHeight);
+    BOOST_CHECK(decoded.txid == key.txid);
+    BOOST_CHECK_EQUAL(decoded.nIndex, key.nIndex);
+    BOOST_CHECK_EQUAL(decoded.fSpending, key.fSpending);
+}
+
+BOOST_AUTO_TEST_CASE(it_round_trips_a_spent_index_value)
+{
+    CSpentIndexValue value;
+    value.txid = uint256S("0x0a");
+    value.nInput = 2;
+    value.nHeight = 100;
+    value.nValue = 5 * COIN;
+    value.script = CScript() << OP_TRUE;
+    value.nPrevHeight = 90;
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << value;
+
+    CSpentIndexValue decoded;
+    stream >> decoded;
+
+    BOOST_CHECK(decoded.txid == value.txid);
+    BOOST_CHECK_EQUAL(decoded.nInput, value.nInput);
+    BOOST_CHECK_EQUAL(decoded.nHeight, value.nHeight);
+    BOOST_CHECK_EQUAL(decoded.nValue, value.nValue);
+    BOOST_CHECK(decoded.script == value.script);
+    BOOST_CHECK_EQUAL(decoded.nPrevHeight, value.nPrevHeight);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -33,6 +33,20 @@ BOOST_AUTO_TEST_CASE(base58_EncodeBase58)
     }
 }
 
+// Goal: round-trip every length across the limb boundaries of the encoder
+BOOST_AUTO_TEST_CASE(base58_RoundTrip)
+{
+    for (size_t size = 0; size <= 64; ++size) {
+        for (const unsigned char fill : {0x00, 0x01, 0xff}) {
+            std::vector<unsigned char> data(size, fill);
+            if (size > 1) data[0] = 0;
+            std::vector<unsigned char> result;
+            BOOST_CHECK(DecodeBase58(EncodeBase58(data), result));
+            BOOST_CHECK(result == data);
+        }
+    }
+}
+
 // Goal: test low-level base58 decoding functionality
 BOOST_AUTO_TEST_CASE(base58_DecodeBase58)
 {
@@ -0,0 +1,229 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "banman.h"
+#include "blockdownload.h"
+#include "main.h"
+#include "net.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+//! Height of the block that the headers extend. It is above every checkpoint
+//! so that the headers pass the checkpoint checks.
+constexpr int BASE_HEIGHT = 10000000;
+
+//! Mock time of the tests.
+constexpr int64_t NOW = 1600000000;
+
+CAddress PeerAddress(const uint32_t ip)
+{
+    struct in_addr s;
+    s.s_addr = ip;
+    return CAddress(CService(CNetAddr(s), GetDefaultPort()));
+}
+
+std::vector<CBlockHeader> MakeHeaders(uint256 hash_prev, const size_t count)
+{
+    std::vector<CBlockHeader> headers(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        headers[i].hashPrevBlock = hash_prev;
+        headers[i].nTime = NOW;
+        headers[i].nBits = 0x1e0fffff;
+        headers[i].nNonce = i;
+
+        hash_prev = headers[i].GetHash();
+    }
+
+    return headers;
+}
+
+//!
+//! \brief Adds a base block for the headers to extend as the best block and
+//! a peer that sends the headers.
+//!
+struct BlockDownloadSetup
+{
+    BlockDownloadSetup()
+        : m_old_best_height(nBestHeight)
+        , m_base_hash(uint256S("0x01"))
+        , m_peer(INVALID_SOCKET, PeerAddress(0xa0b0d001), "", true)
+    {
+        SetMockTime(NOW);
+        g_banman->ClearBanned();
+
+        m_base_index.nHeight = BASE_HEIGHT;
+        m_base_index.phashBlock = &mapBlockIndex.emplace(m_base_hash, &m_base_index).first->first;
+        nBestHeight = BASE_HEIGHT;
+
+        m_peer.nStartingHeight = BASE_HEIGHT + 5000;
+    }
+
+    ~BlockDownloadSetup()
+    {
+        mapBlockIndex.erase(m_base_hash);
+        nBestHeight = m_old_best_height;
+        SetMockTime(0);
+    }
+
+    //!
+    //! \brief Ask the peer for headers and pass the reply to the scheduler.
+    //!
+    bool SyncHeaders(const std::vector<CBlockHeader>& headers)
+    {
+        m_scheduler.SendRequests(&m_peer);
+
+        return m_scheduler.ReceiveHeaders(&m_peer, headers);
+    }
+
+    int Misbehavior()
+    {
+        CNodeStats stats;
+        m_peer.copyStats(stats);
+
+        return stats.nMisbehavior;
+    }
+
+    const int m_old_best_height;
+    const uint256 m_base_hash;
+    CBlockIndex m_base_index;
+    CNode m_peer;
+    BlockDownloadScheduler m_scheduler;
+};
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(blockdownload_tests, BlockDownloadSetup)
+
+BOOST_AUTO_TEST_CASE(it_truncates_headers_and_releases_their_requests)
+{
+    LOCK(cs_main);
+
+    const std::vector<CBlockHeader> headers = MakeHeaders(m_base_hash, 100);
+
+    BOOST_CHECK(SyncHeaders(headers));
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 100);
+    BOOST_CHECK_EQUAL(m_scheduler.TipHeight(), BASE_HEIGHT + 100);
+
+    m_scheduler.SendRequests(&m_peer);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), BlockDownloadScheduler::MAX_BLOCKS_IN_TRANSIT_PER_PEER);
+
+    m_scheduler.Truncate(10);
+
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 10);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), 10);
+    BOOST_CHECK_EQUAL(m_scheduler.TipHeight(), BASE_HEIGHT + 10);
+    BOOST_CHECK(m_scheduler.IsScheduled(headers[9].GetHash()));
+    BOOST_CHECK(!m_scheduler.IsScheduled(headers[10].GetHash()));
+    BOOST_CHECK(!m_scheduler.IsScheduled(headers[99].GetHash()));
+
+    m_scheduler.Truncate(0);
+
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 0);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), 0);
+    BOOST_CHECK(!m_scheduler.IsActive());
+}
+
+BOOST_AUTO_TEST_CASE(it_discards_headers_and_ignores_their_source)
+{
+    LOCK(cs_main);
+
+    const std::vector<CBlockHeader> headers = MakeHeaders(m_base_hash, 100);
+
+    BOOST_CHECK(SyncHeaders(headers));
+
+    m_scheduler.DiscardFrom(5);
+
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 5);
+    BOOST_CHECK(!m_scheduler.IsScheduled(headers[5].GetHash()));
+    BOOST_CHECK(!m_scheduler.AcceptsHeadersFrom(m_peer.GetId()));
+
+    // The penalty applies with the next requests for the peer:
+    BOOST_CHECK_EQUAL(Misbehavior(), 0);
+    m_scheduler.SendRequests(&m_peer);
+    BOOST_CHECK_EQUAL(Misbehavior(), BlockDownloadScheduler::HEADER_SOURCE_PENALTY);
+
+    // The scheduler no longer asks the peer for headers:
+    BOOST_CHECK(m_scheduler.ReceiveHeaders(&m_peer, MakeHeaders(headers[4].GetHash(), 10)));
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(it_expires_requests_that_peers_fail_to_deliver)
+{
+    LOCK(cs_main);
+
+    const std::vector<CBlockHeader> headers = MakeHeaders(m_base_hash, 100);
+
+    BOOST_CHECK(SyncHeaders(headers));
+
+    const size_t requests = BlockDownloadScheduler::MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+
+    m_scheduler.SendRequests(&m_peer);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), requests);
+
+    // The first missing block stalls the others, so it expires first:
+    m_scheduler.ExpireRequests(NOW + BlockDownloadScheduler::BLOCK_STALLING_TIMEOUT);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), requests);
+
+    m_scheduler.ExpireRequests(NOW + BlockDownloadScheduler::BLOCK_STALLING_TIMEOUT + 1);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), requests - 1);
+
+    m_scheduler.ExpireRequests(NOW + BlockDownloadScheduler::BLOCK_DOWNLOAD_TIMEOUT + 1);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), 0);
+
+    // A block that times out once stays scheduled:
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 100);
+    BOOST_CHECK(m_scheduler.AcceptsHeadersFrom(m_peer.GetId()));
+}
+
+BOOST_AUTO_TEST_CASE(it_discards_headers_of_blocks_that_never_arrive)
+{
+    LOCK(cs_main);
+
+    BOOST_CHECK(SyncHeaders(MakeHeaders(m_base_hash, 100)));
+
+    // Each round expires the requests of the last round and asks again:
+    for (int i = 0; i <= BlockDownloadScheduler::MAX_BLOCK_FAILURES; ++i) {
+        SetMockTime(NOW + i * (BlockDownloadScheduler::BLOCK_DOWNLOAD_TIMEOUT + 1));
+        m_scheduler.SendRequests(&m_peer);
+    }
+
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 0);
+    BOOST_CHECK_EQUAL(m_scheduler.RequestCount(), 0);
+    BOOST_CHECK(!m_scheduler.AcceptsHeadersFrom(m_peer.GetId()));
+}
+
+BOOST_AUTO_TEST_CASE(it_limits_the_headers_past_the_best_block)
+{
+    LOCK(cs_main);
+
+    nBestHeight = BASE_HEIGHT - BlockDownloadScheduler::MAX_HEADERS_AHEAD + 50;
+
+    BOOST_CHECK(SyncHeaders(MakeHeaders(m_base_hash, 100)));
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), 50);
+    BOOST_CHECK_EQUAL(m_scheduler.TipHeight(), BASE_HEIGHT + 50);
+}
+
+BOOST_AUTO_TEST_CASE(it_stops_asking_for_headers_past_the_starting_height)
+{
+    LOCK(cs_main);
+
+    const size_t count = BlockDownloadScheduler::MAX_HEADERS_RESULTS;
+    const std::vector<CBlockHeader> headers = MakeHeaders(m_base_hash, count);
+
+    // A full reply below the starting height of the peer asks for more:
+    BOOST_CHECK(SyncHeaders(headers));
+    BOOST_CHECK(m_scheduler.ReceiveHeaders(&m_peer, MakeHeaders(headers.back().GetHash(), 10)));
+    BOOST_CHECK_EQUAL(m_scheduler.HeaderCount(), count + 10);
+
+    BlockDownloadScheduler scheduler;
+    m_peer.nStartingHeight = BASE_HEIGHT + 500;
+
+    scheduler.SendRequests(&m_peer);
+    BOOST_CHECK(scheduler.ReceiveHeaders(&m_peer, headers));
+    BOOST_CHECK(scheduler.ReceiveHeaders(&m_peer, MakeHeaders(headers.back().GetHash(), 10)));
+    BOOST_CHECK_EQUAL(scheduler.HeaderCount(), count);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,125 @@
+// Copyright (c) 2016-2018 The Bitcoin Core developers
+// Copyright (c) 2020 The Gridcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockencodings.h"
+#include "main.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+CBlock BuildBlock()
+{
+    CBlock block;
+    block.nBits = 0x1e0fffff;
+    block.nTime = 1600000000;
+
+    CTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.emplace_back(0, CScript() << OP_TRUE);
+    block.vtx.push_back(coinbase);
+
+    for (int i = 1; i <= 3; ++i) {
+        CTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.hash = uint256S(strprintf("%064x", i));
+        tx.vin[0].prevout.n = 0;
+        tx.vout.emplace_back(i * COIN, CScript() << OP_TRUE);
+        block.vtx.push_back(tx);
+    }
+
+    block.hashMerkleRoot = block.BuildMerkleTree();
+
+    return block;
+}
+
+CBlockHeaderAndShortTxIDs RoundTrip(const CBlockHeaderAndShortTxIDs& cmpctblock)
+{
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << cmpctblock;
+
+    CBlockHeaderAndShortTxIDs decoded;
+    stream >> decoded;
+
+    return decoded;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(blockencodings_tests)
+
+BOOST_AUTO_TEST_CASE(it_reconstructs_a_block_from_the_memory_pool)
+{
+    const CBlock block = BuildBlock();
+    CTxMemPool pool;
+
+    for (size_t i = 1; i < block.vtx.size(); ++i) {
+        CTransaction tx = block.vtx[i];
+        pool.addUnchecked(tx.GetHash(), tx);
+    }
+
+    const CBlockHeaderAndShortTxIDs cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block));
+
+    BOOST_CHECK_EQUAL(cmpctblock.BlockTxCount(), 4);
+    BOOST_CHECK_EQUAL(cmpctblock.prefilledtxn.size(), 1);
+
+    PartiallyDownloadedBlock partial;
+    BOOST_CHECK(partial.InitData(cmpctblock, pool) == ReadStatus::OK);
+    BOOST_CHECK(partial.GetMissing().empty());
+
+    CBlock reconstructed;
+    BOOST_CHECK(partial.FillBlock(reconstructed, {}) == ReadStatus::OK);
+    BOOST_CHECK(reconstructed.GetHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(reconstructed.vtx.size(), block.vtx.size());
+}
+
+BOOST_AUTO_TEST_CASE(it_requests_the_missing_transactions)
+{
+    const CBlock block = BuildBlock();
+    CTxMemPool pool;
+
+    CTransaction tx = block.vtx[2];
+    pool.addUnchecked(tx.GetHash(), tx);
+
+    const CBlockHeaderAndShortTxIDs cmpctblock = RoundTrip(CBlockHeaderAndShortTxIDs(block));
+
+    PartiallyDownloadedBlock partial;
+    BOOST_CHECK(partial.InitData(cmpctblock, pool) == ReadStatus::OK);
+
+    const std::vector<uint16_t> missing = partial.GetMissing();
+    BOOST_CHECK(missing == std::vector<uint16_t>({ 1, 3 }));
+
+    CBlock reconstructed;
+    BOOST_CHECK(partial.FillBlock(reconstructed, { block.vtx[1] }) == ReadStatus::INVALID);
+    BOOST_CHECK(partial.FillBlock(reconstructed, { block.vtx[3], block.vtx[1] }) == ReadStatus::FAILED);
+    BOOST_CHECK(partial.FillBlock(reconstructed, { block.vtx[1], block.vtx[3] }) == ReadStatus::OK);
+    BOOST_CHECK(reconstructed.GetHash() == block.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_an_empty_compact_block)
+{
+    CTxMemPool pool;
+    PartiallyDownloadedBlock partial;
+
+    BOOST_CHECK(partial.InitData(CBlockHeaderAndShortTxIDs(), pool) == ReadStatus::INVALID);
+}
+
+BOOST_AUTO_TEST_CASE(it_round_trips_a_transactions_request)
+{
+    BlockTransactionsRequest req;
+    req.blockhash = uint256S("0x01");
+    req.indexes = { 0, 1, 3, 4, 500 };
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << req;
+
+    BlockTransactionsRequest decoded;
+    stream >> decoded;
+
+    BOOST_CHECK(decoded.blockhash == req.blockhash);
+    BOOST_CHECK(decoded.indexes == req.indexes);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,130 @@
+// Copyright (c) 2018 The Bitcoin Core developers
+// Copyright (c) 2020 The Gridcoin developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+#include "key.h"
+#include "main.h"
+#include "script.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+GCSFilter::Element MakeElement(const unsigned char value)
+{
+    return GCSFilter::Element(32, value);
+}
+
+CScript MakeP2PKH(const CKey& key)
+{
+    CScript script;
+    script.SetDestination(key.GetPubKey().GetID());
+
+    return script;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(blockfilter_tests)
+
+BOOST_AUTO_TEST_CASE(gcsfilter_test)
+{
+    GCSFilter::ElementSet included_elements, excluded_elements;
+    for (int i = 0; i < 100; ++i) {
+        included_elements.insert(MakeElement(i));
+        excluded_elements.insert(MakeElement(100 + i));
+    }
+
+    GCSFilter filter({0, 0, 10, 1 << 10}, included_elements);
+    for (const auto& element : included_elements) {
+        BOOST_CHECK(filter.Match(element));
+
+        auto insertion = excluded_elements.insert(element);
+        BOOST_CHECK(filter.MatchAny(excluded_elements));
+        excluded_elements.erase(insertion.first);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
+{
+    GCSFilter filter;
+    BOOST_CHECK_EQUAL(filter.GetN(), 0);
+    BOOST_CHECK_EQUAL(filter.GetEncoded().size(), 1);
+
+    const GCSFilter::Params& params = filter.GetParams();
+    BOOST_CHECK_EQUAL(params.m_siphash_k0, 0);
+    BOOST_CHECK_EQUAL(params.m_siphash_k1, 0);
+    BOOST_CHECK_EQUAL(params.m_P, 0);
+    BOOST_CHECK_EQUAL(params.m_M, 1);
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_round_trips_the_encoding)
+{
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 50; ++i) {
+        elements.insert(MakeElement(i));
+    }
+
+    const GCSFilter::Params params(1, 2, BASIC_FILTER_P, BASIC_FILTER_M);
+    const GCSFilter filter(params, elements);
+    const GCSFilter decoded(params, filter.GetEncoded());
+
+    BOOST_CHECK_EQUAL(decoded.GetN(), 50);
+    BOOST_CHECK(decoded.GetEncoded() == filter.GetEncoded());
+
+    for (const auto& element : elements) {
+        BOOST_CHECK(decoded.Match(element));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_rejects_an_invalid_encoding)
+{
+    const GCSFilter::Params params(0, 0, BASIC_FILTER_P, BASIC_FILTER_M);
+    GCSFilter::ElementSet elements { MakeElement(1), MakeElement(2) };
+
+    std::vector<unsigned char> encoded = GCSFilter(params, elements).GetEncoded();
+    encoded.push_back(0);
+
+    BOOST_CHECK_THROW(GCSFilter(params, encoded), std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(blockfilter_matches_block_and_spent_scripts)
+{
+    CKey key_out, key_spent, key_multisig, key_other;
+    key_out.MakeNewKey(true);
+    key_spent.MakeNewKey(true);
+    key_multisig.MakeNewKey(true);
+    key_other.MakeNewKey(true);
+
+    CScript multisig;
+    multisig << OP_1 << key_multisig.GetPubKey() << key_other.GetPubKey() << OP_2 << OP_CHECKMULTISIG;
+
+    CTransaction tx;
+    tx.vout.emplace_back(1 * COIN, MakeP2PKH(key_out));
+    tx.vout.emplace_back(1 * COIN, multisig);
+    tx.vout.emplace_back(0, CScript() << OP_RETURN);
+
+    CBlock block;
+    block.vtx.push_back(tx);
+
+    const BlockFilter block_filter(block, { MakeP2PKH(key_spent) });
+    const GCSFilter& filter = block_filter.GetFilter();
+
+    BOOST_CHECK(block_filter.GetBlockHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(filter.GetN(), 5); // 3 scripts and 2 multisig keys
+
+    const CScript& script_out = tx.vout[0].scriptPubKey;
+    const CScript script_spent = MakeP2PKH(key_spent);
+
+    BOOST_CHECK(filter.Match(GCSFilter::Element(script_out.begin(), script_out.end())));
+    BOOST_CHECK(filter.Match(GCSFilter::Element(script_spent.begin(), script_spent.end())));
+    BOOST_CHECK(filter.Match(key_multisig.GetPubKey().Raw()));
+
+    // Round trip through the stored representation:
+    const BlockFilter decoded(block_filter.GetBlockHash(), block_filter.GetEncodedFilter());
+
+    BOOST_CHECK(decoded.GetEncodedFilter() == block_filter.GetEncodedFilter());
+    BOOST_CHECK(decoded.GetFilter().Match(key_multisig.GetPubKey().Raw()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
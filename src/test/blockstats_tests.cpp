@@ -0,0 +1,89 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockstats.h"
+#include "main.h"
+#include "streams.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+CBlock BuildBlock()
+{
+    GRC::Claim claim;
+    claim.m_mining_id = GRC::Cpid::Parse("00010203040506070809101112131415");
+    claim.m_client_version = "v5.0.0.0-unk";
+    claim.m_organization = "Example Org";
+    claim.m_block_subsidy = 10 * COIN;
+    claim.m_research_subsidy = 123 * COIN;
+    claim.m_quorum_hash = GRC::QuorumHash::Parse("d41d8cd98f00b204e9800998ecf8427e");
+
+    CBlock block;
+    block.nVersion = 11;
+
+    CTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+    coinbase.vout[0].SetEmpty();
+    coinbase.vContracts.emplace_back(GRC::MakeContract<GRC::Claim>(
+        GRC::ContractAction::ADD,
+        std::move(claim)));
+    block.vtx.push_back(coinbase);
+
+    CTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.hash = uint256S("0x01");
+    tx.vin[0].prevout.n = 0;
+    tx.vout.emplace_back(COIN, CScript() << OP_TRUE);
+    block.vtx.push_back(tx);
+
+    return block;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(blockstats_tests)
+
+BOOST_AUTO_TEST_CASE(it_summarizes_a_block)
+{
+    const CBlock block = BuildBlock();
+    const CBlockStats stats(block);
+
+    BOOST_CHECK_EQUAL(stats.nRecordVersion, CBlockStats::CURRENT_VERSION);
+    BOOST_CHECK_EQUAL(stats.nBlockVersion, 11);
+    BOOST_CHECK_EQUAL(stats.nTxCount, 2);
+    BOOST_CHECK_EQUAL(stats.nSize, ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    BOOST_CHECK(!stats.fCoinStake);
+    BOOST_CHECK(!stats.fSuperblock);
+    BOOST_CHECK_EQUAL(stats.nResearchSubsidy, 123 * COIN);
+    BOOST_CHECK_EQUAL(stats.nBlockSubsidy, 10 * COIN);
+    BOOST_CHECK(stats.HasResearchReward());
+    BOOST_CHECK_EQUAL(stats.m_mining_id.ToString(), "00010203040506070809101112131415");
+    BOOST_CHECK_EQUAL(stats.m_organization, "Example Org");
+    BOOST_CHECK_EQUAL(stats.m_client_version, "v5.0.0.0-unk");
+    BOOST_CHECK(stats.m_quorum_hash == "d41d8cd98f00b204e9800998ecf8427e");
+}
+
+BOOST_AUTO_TEST_CASE(it_round_trips_a_record)
+{
+    const CBlockStats stats(BuildBlock());
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << stats;
+
+    CBlockStats decoded;
+    stream >> decoded;
+
+    BOOST_CHECK_EQUAL(decoded.nTxCount, stats.nTxCount);
+    BOOST_CHECK_EQUAL(decoded.nSize, stats.nSize);
+    BOOST_CHECK_EQUAL(decoded.nResearchSubsidy, stats.nResearchSubsidy);
+    BOOST_CHECK_EQUAL(decoded.nBlockSubsidy, stats.nBlockSubsidy);
+    BOOST_CHECK(decoded.m_mining_id == stats.m_mining_id);
+    BOOST_CHECK_EQUAL(decoded.m_organization, stats.m_organization);
+    BOOST_CHECK_EQUAL(decoded.m_client_version, stats.m_client_version);
+    BOOST_CHECK(decoded.m_quorum_hash == stats.m_quorum_hash);
+    BOOST_CHECK(stream.empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
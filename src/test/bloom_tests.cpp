@@ -0,0 +1,89 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bloom.h"
+#include "net.h"
+#include "util.h"
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(bloom_tests)
+
+BOOST_AUTO_TEST_CASE(rolling_bloom_remembers_recent_items)
+{
+    CRollingBloomFilter filter(100, 0.01);
+
+    std::vector<uint256> hashes;
+    for (int i = 0; i < 100; ++i) {
+        hashes.push_back(GetRandHash());
+        filter.insert(hashes.back());
+    }
+
+    // The filter keeps at least the last nElements / 2 items, and the first
+    // generations are still live after nElements inserts:
+    for (const auto& hash : hashes) {
+        BOOST_CHECK(filter.contains(hash));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(rolling_bloom_false_positive_rate)
+{
+    CRollingBloomFilter filter(1000, 0.001);
+
+    for (int i = 0; i < 1000; ++i) {
+        filter.insert(GetRandHash());
+    }
+
+    int false_positives = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (filter.contains(GetRandHash())) {
+            ++false_positives;
+        }
+    }
+
+    // The expected count is 10. Allow a wide margin for randomness:
+    BOOST_CHECK(false_positives < 100);
+}
+
+BOOST_AUTO_TEST_CASE(rolling_bloom_forgets_old_generations)
+{
+    CRollingBloomFilter filter(10, 0.000001);
+
+    const uint256 first = GetRandHash();
+    filter.insert(first);
+
+    // Three more generations of five items wipe the first one:
+    for (int i = 0; i < 15; ++i) {
+        filter.insert(GetRandHash());
+    }
+
+    BOOST_CHECK(!filter.contains(first));
+}
+
+BOOST_AUTO_TEST_CASE(rolling_bloom_distinguishes_inventory_types)
+{
+    CRollingBloomFilter filter(100, 0.000001);
+    const uint256 hash = GetRandHash();
+
+    filter.insert(CInv(MSG_PART, hash));
+
+    BOOST_CHECK(filter.contains(CInv(MSG_PART, hash)));
+    BOOST_CHECK(!filter.contains(CInv(MSG_SCRAPERINDEX, hash)));
+    BOOST_CHECK(!filter.contains(hash));
+}
+
+BOOST_AUTO_TEST_CASE(rolling_bloom_reset)
+{
+    CRollingBloomFilter filter(100, 0.000001);
+
+    const std::vector<unsigned char> data { 1, 2, 3 };
+    filter.insert(data.data(), data.size());
+    BOOST_CHECK(filter.contains(data.data(), data.size()));
+
+    filter.reset();
+    BOOST_CHECK(!filter.contains(data.data(), data.size()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
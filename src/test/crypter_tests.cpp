@@ -0,0 +1,136 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypter.h"
+#include "crypto/aes.h"
+#include "util.h"
+#include "util/strencodings.h"
+
+#include <boost/test/unit_test.hpp>
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <vector>
+
+namespace {
+//!
+//! \brief Encrypt a buffer with OpenSSL's EVP interface as CCrypter did before
+//! it moved to the in-tree AES.
+//!
+std::vector<unsigned char> EvpEncrypt(
+    const std::vector<unsigned char>& key,
+    const std::vector<unsigned char>& iv,
+    const std::vector<unsigned char>& data)
+{
+    std::vector<unsigned char> out(data.size() + AES_BLOCKSIZE);
+    int len = 0;
+    int final_len = 0;
+
+    EVP_CIPHER_CTX* ctx = EVP_CIPHER_CTX_new();
+    BOOST_REQUIRE(ctx != nullptr);
+    BOOST_REQUIRE(EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), iv.data()));
+    BOOST_REQUIRE(EVP_EncryptUpdate(ctx, out.data(), &len, data.data(), data.size()));
+    BOOST_REQUIRE(EVP_EncryptFinal_ex(ctx, out.data() + len, &final_len));
+    EVP_CIPHER_CTX_free(ctx);
+
+    out.resize(len + final_len);
+    return out;
+}
+
+std::vector<unsigned char> RandomBytes(const size_t size)
+{
+    std::vector<unsigned char> bytes(size);
+    RAND_bytes(bytes.data(), bytes.size());
+
+    return bytes;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(crypter_tests)
+
+BOOST_AUTO_TEST_CASE(aes256_matches_the_fips_197_vector)
+{
+    const std::vector<unsigned char> key = ParseHex(
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    const std::vector<unsigned char> plaintext = ParseHex("00112233445566778899aabbccddeeff");
+    const std::vector<unsigned char> expected = ParseHex("8ea2b7ca516745bfeafc49904b496089");
+
+    std::vector<unsigned char> ciphertext(AES_BLOCKSIZE);
+    AES256Encrypt(key.data()).Encrypt(ciphertext.data(), plaintext.data());
+    BOOST_CHECK(ciphertext == expected);
+
+    std::vector<unsigned char> decrypted(AES_BLOCKSIZE);
+    AES256Decrypt(key.data()).Decrypt(decrypted.data(), ciphertext.data());
+    BOOST_CHECK(decrypted == plaintext);
+}
+
+BOOST_AUTO_TEST_CASE(aes256_cbc_matches_the_sp800_38a_vector)
+{
+    const std::vector<unsigned char> key = ParseHex(
+        "603deb1015ca71be2b73aef0857d77811f352c073b6108d72d9810a30914dff4");
+    const std::vector<unsigned char> iv = ParseHex("000102030405060708090a0b0c0d0e0f");
+    const std::vector<unsigned char> plaintext = ParseHex(
+        "6bc1bee22e409f96e93d7e117393172a"
+        "ae2d8a571e03ac9c9eb76fac45af8e51"
+        "30c81c46a35ce411e5fbc1191a0a52ef"
+        "f69f2445df4f9b17ad2b417be66c3710");
+    const std::vector<unsigned char> expected = ParseHex(
+        "f58c4c04d6e5f1ba779eabfb5f7bfbd6"
+        "9cfc4e967edb808d679f777bc6702c7d"
+        "39f23369a9d9bacfa530e26304231461"
+        "b2eb05e2c39be9fcda6c19078c6a9d1b");
+
+    std::vector<unsigned char> ciphertext(plaintext.size());
+    AES256CBCEncrypt enc(key.data(), iv.data(), false);
+    BOOST_CHECK_EQUAL(enc.Encrypt(plaintext.data(), plaintext.size(), ciphertext.data()), (int)plaintext.size());
+    BOOST_CHECK(ciphertext == expected);
+
+    std::vector<unsigned char> decrypted(ciphertext.size());
+    AES256CBCDecrypt dec(key.data(), iv.data(), false);
+    BOOST_CHECK_EQUAL(dec.Decrypt(ciphertext.data(), ciphertext.size(), decrypted.data()), (int)ciphertext.size());
+    BOOST_CHECK(decrypted == plaintext);
+}
+
+BOOST_AUTO_TEST_CASE(crypter_output_matches_openssl)
+{
+    for (size_t size = 1; size <= 4 * AES_BLOCKSIZE + 1; ++size) {
+        const std::vector<unsigned char> key = RandomBytes(WALLET_CRYPTO_KEY_SIZE);
+        const std::vector<unsigned char> iv = RandomBytes(WALLET_CRYPTO_KEY_SIZE);
+        const std::vector<unsigned char> data = RandomBytes(size);
+
+        CCrypter crypter;
+        BOOST_REQUIRE(crypter.SetKey(CKeyingMaterial(key.begin(), key.end()), iv));
+
+        std::vector<unsigned char> ciphertext;
+        BOOST_REQUIRE(crypter.Encrypt(CKeyingMaterial(data.begin(), data.end()), ciphertext));
+        BOOST_CHECK(ciphertext == EvpEncrypt(key, iv, data));
+
+        CKeyingMaterial decrypted;
+        BOOST_REQUIRE(crypter.Decrypt(ciphertext, decrypted));
+        BOOST_CHECK(std::vector<unsigned char>(decrypted.begin(), decrypted.end()) == data);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(crypter_round_trips_wallet_secrets)
+{
+    CKeyingMaterial master_key(WALLET_CRYPTO_KEY_SIZE);
+    RAND_bytes(master_key.data(), master_key.size());
+
+    const uint256 iv = GetRandHash();
+    CSecret secret(32);
+    RAND_bytes(secret.data(), secret.size());
+
+    std::vector<unsigned char> ciphertext;
+    BOOST_REQUIRE(EncryptSecret(master_key, secret, iv, ciphertext));
+    BOOST_CHECK_EQUAL(ciphertext.size(), 48);
+
+    CSecret decrypted;
+    BOOST_REQUIRE(DecryptSecret(master_key, ciphertext, iv, decrypted));
+    BOOST_CHECK(decrypted == secret);
+
+    // A truncated ciphertext is not a whole number of blocks:
+    ciphertext.pop_back();
+    BOOST_CHECK(!DecryptSecret(master_key, ciphertext, iv, decrypted));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
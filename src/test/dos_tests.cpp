@@ -119,6 +119,59 @@ BOOST_AUTO_TEST_CASE(DoS_misbehavior_decay)
     BOOST_CHECK(nodestats.nMisbehavior == 0); // nMisbehavior should be 0.
 }
 
+BOOST_AUTO_TEST_CASE(DoS_subnet_banning)
+{
+    g_banman->ClearBanned();
+    int64_t nStartTime = GetTime();
+    SetMockTime(nStartTime);
+
+    CSubNet subnet24;
+    CSubNet subnet16;
+    CSubNet subnet6;
+    CSubNet subnetMask;
+    BOOST_CHECK(LookupSubNet("10.1.2.0/24", subnet24));
+    BOOST_CHECK(LookupSubNet("10.3.0.0/16", subnet16));
+    BOOST_CHECK(LookupSubNet("2001:db8::/32", subnet6));
+    BOOST_CHECK(LookupSubNet("10.4.0.5/255.0.255.255", subnetMask)); // Not a prefix
+
+    g_banman->Ban(subnet24, BanReasonNodeMisbehaving, 100);
+    g_banman->Ban(subnet16, BanReasonManuallyAdded, 200);
+    g_banman->Ban(subnet6, BanReasonNodeMisbehaving, 100);
+    g_banman->Ban(subnetMask, BanReasonManuallyAdded, 100);
+
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.1.2.3")), 1);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.1.3.3")), 0);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.3.200.1")), 2);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("2001:db8:1::1")), 1);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("2001:db9::1")), 0);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.77.0.5")), 2);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.77.0.6")), 0);
+
+    // A single address ban inside a banned subnet:
+    g_banman->Ban(CNetAddr("10.1.2.4"), BanReasonManuallyAdded, 100);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.1.2.4")), 2);
+    BOOST_CHECK_EQUAL(g_banman->IsBannedLevel(CNetAddr("10.1.2.3")), 1);
+
+    BOOST_CHECK(g_banman->Unban(subnet24));
+    BOOST_CHECK(!g_banman->IsBanned(CNetAddr("10.1.2.3")));
+    BOOST_CHECK(g_banman->IsBanned(CNetAddr("10.1.2.4")));
+    BOOST_CHECK(!g_banman->Unban(subnet24));
+
+    // The shorter bans expire first:
+    SetMockTime(nStartTime + 101);
+    banmap_t banmap;
+    g_banman->GetBanned(banmap);
+    BOOST_CHECK_EQUAL(banmap.size(), 1);
+    BOOST_CHECK(!g_banman->IsBanned(CNetAddr("10.1.2.4")));
+    BOOST_CHECK(!g_banman->IsBanned(CNetAddr("10.77.0.5")));
+    BOOST_CHECK(g_banman->IsBanned(CNetAddr("10.3.200.1")));
+
+    g_banman->ClearBanned();
+    BOOST_CHECK(!g_banman->IsBanned(CNetAddr("10.3.200.1")));
+
+    SetMockTime(0);
+}
+
 CTransaction RandomOrphan()
 {
     auto it = mapOrphanTransactions.lower_bound(GetRandHash());
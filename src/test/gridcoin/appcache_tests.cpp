@@ -50,4 +50,63 @@ BOOST_AUTO_TEST_CASE(appcache_SortedSectionsShouldBeSorted)
 }
 
 
+BOOST_AUTO_TEST_CASE(appcache_ProtocolParametersShouldFollowProtocolWrites)
+{
+    ClearCache(Section::PROTOCOL);
+
+    const ProtocolParametersPtr cleared = GetProtocolParameters();
+    BOOST_CHECK_EQUAL(cleared->block_reward, 0);
+    BOOST_CHECK(cleared->require_team_membership == true);
+    BOOST_CHECK(cleared->team_whitelist == std::set<std::string>{ "gridcoin" });
+
+    WriteCache(Section::PROTOCOL, "blockreward1", "1500000000", 123456789);
+    WriteCache(Section::PROTOCOL, "TEAM_WHITELIST", "Gridcoin<>Team 2", 123456789);
+
+    const ProtocolParametersPtr written = GetProtocolParameters();
+    BOOST_CHECK_EQUAL(written->block_reward, 1500000000);
+    BOOST_CHECK_EQUAL(written->block_reward_time, 123456789);
+    BOOST_CHECK(written->team_whitelist == (std::set<std::string>{ "gridcoin", "team 2" }));
+    BOOST_CHECK(written->revision > cleared->revision);
+
+    // Unrelated keys do not rebuild the parameters:
+    WriteCache(Section::PROTOCOL, "key", "hello", 123456789);
+    WriteCache(Section::SCRAPER, "TEAM_WHITELIST", "other", 123456789);
+    BOOST_CHECK(GetProtocolParameters() == written);
+
+    WriteCache(Section::PROTOCOL, "REQUIRE_TEAM_WHITELIST_MEMBERSHIP", "false", 123456789);
+    BOOST_CHECK(GetProtocolParameters()->require_team_membership == false);
+
+    DeleteCache(Section::PROTOCOL, "blockreward1");
+    BOOST_CHECK_EQUAL(GetProtocolParameters()->block_reward, 0);
+
+    // The earlier snapshot remains unchanged:
+    BOOST_CHECK_EQUAL(written->block_reward, 1500000000);
+
+    ClearCache(Section::PROTOCOL);
+    ClearCache(Section::SCRAPER);
+}
+
+BOOST_AUTO_TEST_CASE(appcache_RevertCacheShouldRestoreEarlierBlocks)
+{
+    ClearCache(Section::PROTOCOL);
+    WriteCache(Section::PROTOCOL, "key1", "first", 1, 100);
+    WriteCache(Section::PROTOCOL, "key2", "first", 1, 100);
+
+    WriteCache(Section::PROTOCOL, "key1", "second", 2, 101);
+    DeleteCache(Section::PROTOCOL, "key2", 101);
+    WriteCache(Section::PROTOCOL, "key3", "second", 2, 102);
+
+    BOOST_CHECK(RevertCache(101) == true);
+    BOOST_CHECK(ReadCache(Section::PROTOCOL, "key3").value.empty() == true);
+    BOOST_CHECK(ReadCache(Section::PROTOCOL, "key1").value == "second");
+
+    BOOST_CHECK(RevertCache(100) == true);
+    BOOST_CHECK(ReadCache(Section::PROTOCOL, "key1").value == "first");
+    BOOST_CHECK_EQUAL(ReadCache(Section::PROTOCOL, "key1").timestamp, 1);
+    BOOST_CHECK(ReadCache(Section::PROTOCOL, "key2").value == "first");
+
+    BOOST_CHECK(RevertCache(99) == true);
+    BOOST_CHECK(ReadCacheSection(Section::PROTOCOL).empty() == true);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
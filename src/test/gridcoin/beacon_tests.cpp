@@ -113,6 +113,8 @@ BOOST_AUTO_TEST_CASE(it_initializes_to_an_empty_invalid_beacon)
 
     BOOST_CHECK(beacon.m_public_key.Raw().empty() == true);
     BOOST_CHECK_EQUAL(beacon.m_timestamp, 0);
+    BOOST_CHECK(beacon.m_txid.IsNull() == true);
+    BOOST_CHECK_EQUAL(beacon.m_height, 0);
 
     BOOST_CHECK(beacon.WellFormed() == false);
 }
@@ -238,6 +240,25 @@ BOOST_AUTO_TEST_CASE(it_serializes_to_a_stream)
         expected.end());
 }
 
+BOOST_AUTO_TEST_CASE(it_omits_the_contract_location_from_serialization)
+{
+    GRC::Beacon beacon(TestKey::Public());
+    beacon.m_txid = uint256S("0123456789abcdef0123456789abcdef0123456789abcdef0123456789abcdef");
+    beacon.m_height = 123;
+
+    const CDataStream expected = CDataStream(SER_NETWORK, PROTOCOL_VERSION)
+        << TestKey::Public();
+
+    const CDataStream stream = CDataStream(SER_NETWORK, PROTOCOL_VERSION)
+        << beacon;
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(
+        stream.begin(),
+        stream.end(),
+        expected.begin(),
+        expected.end());
+}
+
 BOOST_AUTO_TEST_CASE(it_deserializes_from_a_stream)
 {
     CDataStream stream = CDataStream(SER_NETWORK, PROTOCOL_VERSION)
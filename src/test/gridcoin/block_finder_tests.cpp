@@ -31,6 +31,8 @@ namespace
                 }
                 if(block != &blocks.back())
                     block->pnext = next;
+
+                block->BuildSkip();
             }
             // Setup global variables.
             pindexBest = &blocks.back();
@@ -68,6 +70,24 @@ BOOST_AUTO_TEST_CASE(FindBlockByHeightShouldWorkOnChainsWithJustOneBlock)
     BOOST_CHECK_EQUAL(&chain.blocks.front(), finder.FindByHeight(-1));
 }
 
+BOOST_AUTO_TEST_CASE(GetAncestorShouldFindEveryHeight)
+{
+    BlockChain<1000> chain;
+
+    for(const auto& block : chain.blocks)
+    {
+        BOOST_CHECK_EQUAL(&block, chain.blocks.back().GetAncestor(block.nHeight));
+        BOOST_CHECK_EQUAL(&chain.blocks.front(), block.GetAncestor(0));
+        BOOST_CHECK(block.GetAncestor(block.nHeight + 1) == nullptr);
+    }
+
+    BOOST_CHECK(chain.blocks.back().GetAncestor(-1) == nullptr);
+
+    // Entries without skiplist pointers fall back to the pprev links:
+    chain.blocks[500].pskip = nullptr;
+    BOOST_CHECK_EQUAL(&chain.blocks[123], chain.blocks[500].GetAncestor(123));
+}
+
 BOOST_AUTO_TEST_CASE(FindBlockByTimeShouldReturnNextYoungestBlock)
 {
     // Chain with block times 0, 10, 20, 30, 40 etc.
@@ -575,6 +575,28 @@ BOOST_AUTO_TEST_CASE(it_converts_a_legacy_payload_into_a_specific_contract_type)
     BOOST_CHECK_EQUAL(project.m_url, "https://example.com/@");
 }
 
+BOOST_AUTO_TEST_CASE(it_parses_a_legacy_payload_once)
+{
+    GRC::Contract contract = GRC::MakeLegacyContract(
+        GRC::ContractType::PROJECT,
+        GRC::ContractAction::ADD,
+        "Project Name",
+        "https://example.com/@");
+
+    const GRC::ContractPayload first = contract.SharePayload();
+    const GRC::ContractPayload second = contract.SharePayload();
+
+    BOOST_CHECK(&*first == &*second);
+
+    // A copy parses its own payload so that pulling it leaves this one intact:
+    GRC::Contract copy = contract;
+    const GRC::Project pulled = copy.PullPayloadAs<GRC::Project>();
+
+    BOOST_CHECK_EQUAL(pulled.m_name, "Project Name");
+    BOOST_CHECK_EQUAL(first->LegacyKeyString(), "Project Name");
+    BOOST_CHECK_EQUAL(copy.SharePayloadAs<GRC::Project>()->m_name, "Project Name");
+}
+
 BOOST_AUTO_TEST_CASE(it_serializes_to_a_stream)
 {
     const GRC::Contract::Body body(GRC::ContractPayload::Make<TestPayload>("test"));
@@ -852,6 +874,30 @@ BOOST_AUTO_TEST_CASE(it_parses_a_legacy_v1_contract_from_a_transaction_message)
     BOOST_CHECK(contract.m_public_key.Key().Raw().size() == 0);
 }
 
+BOOST_AUTO_TEST_CASE(it_parses_the_legacy_contract_of_a_transaction_once)
+{
+    CTransaction tx;
+    tx.nVersion = 1;
+    tx.hashBoinc = TestMessage::V1String();
+
+    const GRC::Contract* contract = &tx.GetContracts().front();
+
+    BOOST_CHECK_EQUAL(tx.GetContracts().size(), 1U);
+    BOOST_CHECK(&tx.GetContracts().front() == contract);
+    BOOST_CHECK(contract->m_type == GRC::ContractType::BEACON);
+
+    // Moving the contracts out parses the message again on the next call:
+    BOOST_CHECK_EQUAL(tx.PullContracts().size(), 1U);
+    BOOST_CHECK_EQUAL(tx.GetContracts().size(), 1U);
+
+    CTransaction plain;
+    plain.nVersion = 1;
+    plain.hashBoinc = "Not a contract";
+
+    BOOST_CHECK(plain.GetContracts().empty());
+    BOOST_CHECK(plain.GetContracts().empty());
+}
+
 BOOST_AUTO_TEST_CASE(it_gives_an_invalid_contract_when_parsing_an_empty_message)
 {
     GRC::Contract contract = GRC::Contract::Parse("");
@@ -248,10 +248,11 @@ BOOST_AUTO_TEST_CASE(it_is_hashable_to_key_a_lookup_map)
 
     std::hash<GRC::Cpid> hasher;
 
-    // CPID halves, little endian
-    const size_t expected = 0x0706050403020100ull + 0x1514131211100908ull;
+    // Salted SipHash of the CPID bytes:
+    const size_t expected = SaltedSipHash(cpid.Raw().data(), cpid.Raw().size());
 
     BOOST_CHECK_EQUAL(hasher(cpid), expected);
+    BOOST_CHECK(hasher(cpid) != hasher(GRC::Cpid()));
 }
 
 BOOST_AUTO_TEST_SUITE_END()
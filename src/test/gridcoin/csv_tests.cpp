@@ -0,0 +1,117 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/support/csv.h"
+
+#include <boost/algorithm/string/classification.hpp>
+#include <boost/algorithm/string/split.hpp>
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+//!
+//! \brief Read every line from the input with a CsvReader and collect the
+//! fields as strings.
+//!
+std::vector<std::vector<std::string>> ReadAll(const std::string& input)
+{
+    std::istringstream in(input);
+    GRC::CsvReader reader(in);
+    std::vector<std::vector<std::string>> lines;
+
+    while (reader.NextLine()) {
+        std::vector<std::string> fields;
+
+        for (const auto& field : reader.Fields()) {
+            fields.emplace_back(field.ToString());
+        }
+
+        lines.emplace_back(std::move(fields));
+    }
+
+    return lines;
+}
+
+//!
+//! \brief Split the input the way that the scraper did before CsvReader.
+//!
+std::vector<std::vector<std::string>> SplitAll(const std::string& input)
+{
+    std::istringstream in(input);
+    std::string line;
+    std::vector<std::vector<std::string>> lines;
+
+    while (std::getline(in, line)) {
+        std::vector<std::string> fields;
+        boost::split(fields, line, boost::is_any_of(","), boost::token_compress_on);
+
+        lines.emplace_back(std::move(fields));
+    }
+
+    return lines;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(CsvReader)
+
+BOOST_AUTO_TEST_CASE(it_splits_lines_into_fields)
+{
+    const auto lines = ReadAll("1,2.5,3,abc\n4,5,6,def\n");
+
+    BOOST_REQUIRE(lines.size() == 2);
+    BOOST_CHECK(lines[0] == std::vector<std::string>({ "1", "2.5", "3", "abc" }));
+    BOOST_CHECK(lines[1] == std::vector<std::string>({ "4", "5", "6", "def" }));
+}
+
+BOOST_AUTO_TEST_CASE(it_matches_getline_and_compressed_boost_split)
+{
+    const std::vector<std::string> inputs {
+        "",
+        "\n",
+        "a",
+        "a\n\nb",
+        ",a,,b,\n",
+        ",,,\n#comment,x\n",
+        "1,2,3,cpid\r\n4,,5,cpid",
+    };
+
+    for (const auto& input : inputs) {
+        BOOST_CHECK(ReadAll(input) == SplitAll(input));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_reads_lines_that_span_buffer_chunks)
+{
+    std::string input;
+
+    for (size_t i = 0; i < 20000; ++i) {
+        input += std::to_string(i) + ",0," + std::string(i % 50, 'x') + ",cpid\n";
+    }
+
+    // A single line longer than the chunk size grows the buffer:
+    input += std::string(200 * 1024, 'y') + ",z";
+
+    BOOST_CHECK(ReadAll(input) == SplitAll(input));
+}
+
+BOOST_AUTO_TEST_CASE(it_parses_fields_like_stod)
+{
+    const std::vector<std::string> inputs { "0", "1.5", " 42", "1e3", "3.25abc", "-7" };
+
+    for (const auto& input : inputs) {
+        GRC::CsvField field(input.data(), input.data() + input.size());
+
+        BOOST_CHECK_EQUAL(field.ToDouble(), std::stod(input));
+    }
+
+    const std::string invalid = "abc";
+    GRC::CsvField field(invalid.data(), invalid.data() + invalid.size());
+
+    BOOST_CHECK_THROW(field.ToDouble(), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,152 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "gridcoin/staking/difficulty.h"
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+namespace {
+//!
+//! \brief A chain of block index entries with a varying difficulty. Every
+//! third block is proof-of-work.
+//!
+class DifficultyChain
+{
+public:
+    DifficultyChain(const size_t size) : m_blocks(size)
+    {
+        for (size_t i = 0; i < m_blocks.size(); ++i) {
+            CBlockIndex& block = m_blocks[i];
+
+            block.SetNull();
+            block.nHeight = i;
+            block.nBits = 0x1d00ffff - (i % 50) * 0x100;
+
+            if (i > 0) {
+                block.pprev = &m_blocks[i - 1];
+            }
+
+            if (i % 3 != 0) {
+                block.SetProofOfStake();
+            }
+        }
+    }
+
+    const CBlockIndex* At(const size_t height) const
+    {
+        return &m_blocks[height];
+    }
+
+private:
+    std::vector<CBlockIndex> m_blocks;
+};
+
+//!
+//! \brief Average the difficulty by walking the block index like the node
+//! did before the difficulty window.
+//!
+double WalkAverage(const CBlockIndex* pindex, const unsigned int interval)
+{
+    double sum = 0.0;
+    unsigned int count = 0;
+
+    for (; pindex && count < interval; pindex = pindex->pprev) {
+        if (pindex->IsProofOfStake()) {
+            sum += GRC::GetBlockDifficulty(pindex->nBits);
+            ++count;
+        }
+    }
+
+    return count ? sum / count : 0;
+}
+
+void CheckAverages(const GRC::DifficultyWindow& window, const CBlockIndex* tip)
+{
+    for (const unsigned int interval : { 1u, 40u, GRC::DifficultyWindow::MAX_INTERVAL }) {
+        double average = 0;
+
+        BOOST_REQUIRE(window.GetAverage(interval, average));
+        BOOST_CHECK_EQUAL(average, WalkAverage(tip, interval));
+    }
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(difficulty_tests)
+
+BOOST_AUTO_TEST_CASE(it_needs_a_tip_to_answer)
+{
+    GRC::DifficultyWindow window;
+    double average = 0;
+
+    BOOST_CHECK(!window.GetAverage(40, average));
+}
+
+BOOST_AUTO_TEST_CASE(it_matches_the_walk_as_blocks_connect)
+{
+    const DifficultyChain chain(400);
+    GRC::DifficultyWindow window;
+
+    window.SetTip(chain.At(0));
+
+    for (size_t height = 1; height < 400; ++height) {
+        window.SetTip(chain.At(height));
+        CheckAverages(window, chain.At(height));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_matches_the_walk_as_blocks_disconnect)
+{
+    const DifficultyChain chain(400);
+    GRC::DifficultyWindow window;
+
+    window.Initialize(chain.At(399));
+
+    for (size_t height = 399; height-- > 0;) {
+        window.SetTip(chain.At(height));
+        CheckAverages(window, chain.At(height));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_rebuilds_for_an_unrelated_tip)
+{
+    const DifficultyChain chain(400);
+    GRC::DifficultyWindow window;
+
+    window.SetTip(chain.At(399));
+    window.SetTip(chain.At(250));
+    CheckAverages(window, chain.At(250));
+
+    window.SetTip(chain.At(300));
+    CheckAverages(window, chain.At(300));
+}
+
+BOOST_AUTO_TEST_CASE(it_defers_longer_intervals_to_the_walk)
+{
+    const DifficultyChain chain(400);
+    GRC::DifficultyWindow window;
+    double average = 0;
+
+    window.SetTip(chain.At(399));
+
+    BOOST_CHECK(!window.GetAverage(GRC::DifficultyWindow::MAX_INTERVAL + 1, average));
+}
+
+BOOST_AUTO_TEST_CASE(it_answers_any_interval_for_a_short_chain)
+{
+    const DifficultyChain chain(30);
+    GRC::DifficultyWindow window;
+    double average = 0;
+
+    window.SetTip(chain.At(29));
+
+    BOOST_REQUIRE(window.GetAverage(1000, average));
+    BOOST_CHECK_EQUAL(average, WalkAverage(chain.At(29), 1000));
+
+    window.SetTip(nullptr);
+    BOOST_CHECK(!window.GetAverage(40, average));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,131 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "bignum.h"
+#include "gridcoin/staking/kernel.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(kernel_tests)
+
+BOOST_AUTO_TEST_CASE(it_batches_the_same_kernel_hashes_as_one_at_a_time)
+{
+    const uint64_t stake_modifier = 0x0123456789abcdef;
+    const unsigned coinstake_time = 1600000017;
+
+    std::vector<GRC::StakeKernelCandidate> candidates;
+
+    for (unsigned i = 0; i < 5; ++i) {
+        candidates.push_back({
+            1500000000 + i * 97,
+            uint256S(strprintf("%064x", i * 7919 + 1)),
+            i,
+        });
+    }
+
+    const std::vector<uint256> hashes = GRC::CalculateStakeHashesV8(
+        candidates,
+        coinstake_time,
+        stake_modifier);
+
+    BOOST_REQUIRE_EQUAL(hashes.size(), candidates.size());
+
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        const uint256 expected = GRC::CalculateStakeHashV8(
+            candidates[i].nCoinBlockTime,
+            candidates[i].CoinTxHash,
+            candidates[i].CoinTxN,
+            coinstake_time,
+            stake_modifier);
+
+        BOOST_CHECK(hashes[i] == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_no_hashes_for_no_candidates)
+{
+    BOOST_CHECK(GRC::CalculateStakeHashesV8({}, 1600000000, 1).empty());
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_the_stake_modifier_through_the_index_links)
+{
+    std::vector<CBlockIndex> chain(10);
+
+    for (size_t i = 0; i < chain.size(); ++i) {
+        chain[i].nHeight = i;
+        chain[i].pprev = i > 0 ? &chain[i - 1] : nullptr;
+
+        // Blocks 0 and 6 generate a new modifier:
+        chain[i].SetStakeModifier(i < 6 ? 100 : 600, i == 0 || i == 6);
+    }
+
+    uint64_t modifier = 0;
+
+    // Unlinked entries fall back to walking the chain:
+    BOOST_CHECK(GRC::FindStakeModifierRev(modifier, &chain[5]));
+    BOOST_CHECK_EQUAL(modifier, 100);
+
+    for (auto& pindex : chain) {
+        pindex.BuildStakeModifierLink();
+    }
+
+    BOOST_CHECK(chain[5].pmodifier == &chain[0]);
+    BOOST_CHECK(chain[9].pmodifier == &chain[6]);
+
+    BOOST_CHECK(GRC::FindStakeModifierRev(modifier, &chain[5]));
+    BOOST_CHECK_EQUAL(modifier, 100);
+    BOOST_CHECK(GRC::FindStakeModifierRev(modifier, &chain[9]));
+    BOOST_CHECK_EQUAL(modifier, 600);
+}
+
+BOOST_AUTO_TEST_CASE(it_checks_kernel_hashes_like_the_bignum_arithmetic)
+{
+    const std::vector<unsigned int> targets {
+        0x1e0fffff, // Proof-of-stake limit
+        0x1d00ffff,
+        0x1c0ab123,
+        0x20123456, // Overflows 256 bits when weighted
+        0x22012345, // Overflows 256 bits
+        0x1d80ffff, // Negative
+        0x00000000,
+        0x02008000, // Zero mantissa after the shift
+    };
+
+    const std::vector<int64_t> weights { 0, 1, 800, 1000000, INT64_MAX, -1 };
+
+    std::vector<uint256> hashes { uint256() };
+
+    for (int shift = 0; shift < 256; shift += 17) {
+        hashes.push_back(ArithToUint256(~arith_uint256() >> shift));
+        hashes.push_back(ArithToUint256(arith_uint256(0x1234567890abcdef) << shift));
+    }
+
+    for (const auto nBits : targets) {
+        for (const auto weight : weights) {
+            for (const auto& hash : hashes) {
+                CBigNum target;
+                target.SetCompact(nBits);
+                target *= weight;
+
+                BOOST_CHECK_EQUAL(
+                    GRC::CheckStakeKernelHashV8(hash, nBits, weight),
+                    CBigNum(hash) <= target);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_multiplies_past_256_bits)
+{
+    const arith_uint256 max = ~arith_uint256();
+    const arith_uint512 product = arith_uint512(max) * arith_uint512(max);
+
+    // (2**256 - 1)**2 = 2**512 - 2**257 + 1
+    BOOST_CHECK_EQUAL(product.bits(), 512);
+    BOOST_CHECK(product.GetLow256() == arith_uint256(1));
+    BOOST_CHECK(arith_uint512(product / arith_uint512(max)).GetLow256() == max);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
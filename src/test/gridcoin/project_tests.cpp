@@ -5,6 +5,7 @@
 #include "main.h"
 #include "gridcoin/contract/contract.h"
 #include "gridcoin/project.h"
+#include "streams.h"
 
 #include <boost/test/unit_test.hpp>
 
@@ -362,4 +363,29 @@ BOOST_AUTO_TEST_CASE(it_overwrites_projects_with_the_same_name)
     }
 }
 
+BOOST_AUTO_TEST_CASE(it_restores_projects_from_a_contract_state_snapshot)
+{
+    GRC::Whitelist whitelist;
+    whitelist.Add({ contract("Enigma", "http://enigma.test"), g_tx, nullptr });
+    whitelist.Add({ contract("Einstein", "http://einstein.test"), g_tx, nullptr });
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    whitelist.WriteSnapshot(stream);
+
+    GRC::Whitelist restored;
+    restored.ReadSnapshot(stream);
+
+    auto snapshot = restored.Snapshot().Sorted();
+    BOOST_CHECK(snapshot.size() == 2);
+    BOOST_CHECK(snapshot.Contains("Enigma") == true);
+    BOOST_CHECK(snapshot.Contains("Einstein") == true);
+    BOOST_CHECK(stream.empty());
+
+    for (const auto& project : snapshot) {
+        if (project.m_name == "Enigma") {
+            BOOST_CHECK(project.m_url == "http://enigma.test");
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,61 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/research_history.h"
+#include "streams.h"
+#include "version.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+std::string SerializeKey(const GRC::ResearchHistoryKey& key)
+{
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << std::string("rhistory") << key;
+
+    return stream.str();
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(ResearchHistory)
+
+BOOST_AUTO_TEST_CASE(it_sorts_the_history_of_a_cpid_by_height)
+{
+    const GRC::Cpid cpid = GRC::Cpid::Parse("00010203040506070809101112131415");
+
+    // Little-endian heights would sort 256 before 1:
+    const std::string key_1 = SerializeKey(
+        GRC::ResearchHistoryKey(cpid, 1, GRC::ResearchHistoryKind::ACCRUAL));
+    const std::string key_256 = SerializeKey(
+        GRC::ResearchHistoryKey(cpid, 256, GRC::ResearchHistoryKind::MAGNITUDE));
+
+    BOOST_CHECK(key_1 < key_256);
+
+    // Every key of the CPID starts with the scan prefix:
+    CDataStream prefix(SER_DISK, CLIENT_VERSION);
+    prefix << std::string("rhistory") << cpid;
+
+    BOOST_CHECK_EQUAL(key_1.compare(0, prefix.size(), prefix.str()), 0);
+    BOOST_CHECK_EQUAL(key_256.compare(0, prefix.size(), prefix.str()), 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_round_trips_a_history_key)
+{
+    const GRC::ResearchHistoryKey key(
+        GRC::Cpid::Parse("00010203040506070809101112131415"),
+        1234567,
+        GRC::ResearchHistoryKind::REWARD);
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << key;
+
+    GRC::ResearchHistoryKey decoded;
+    stream >> decoded;
+
+    BOOST_CHECK(decoded.m_cpid == key.m_cpid);
+    BOOST_CHECK_EQUAL(decoded.m_height, key.m_height);
+    BOOST_CHECK(decoded.m_kind == key.m_kind);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,146 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/scraper/fwd.h"
+
+#include <boost/test/unit_test.hpp>
+#include <string>
+#include <vector>
+
+namespace {
+//!
+//! \brief Create a statistics entry with the supplied key and RAC.
+//!
+ScraperStats::value_type MakeEntry(
+    const statsobjecttype type,
+    const std::string& object_id,
+    const double rac)
+{
+    ScraperObjectStats stats = {};
+
+    stats.statskey.objecttype = type;
+    stats.statskey.objectID = object_id;
+    stats.statsvalue.dRAC = rac;
+
+    return ScraperStats::value_type(stats.statskey, stats);
+}
+
+//!
+//! \brief Collect the object IDs of the entries in iteration order.
+//!
+std::vector<std::string> ObjectIds(const ScraperStats& stats)
+{
+    std::vector<std::string> ids;
+
+    for (const auto& entry : stats) {
+        ids.emplace_back(entry.first.objectID);
+    }
+
+    return ids;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(ScraperStats_tests)
+
+BOOST_AUTO_TEST_CASE(it_iterates_entries_in_key_order)
+{
+    ScraperStats stats;
+
+    stats.emplace(MakeEntry(statsobjecttype::byCPIDbyProject, "b,1", 1).first, {});
+    stats.emplace(MakeEntry(statsobjecttype::byProject, "b", 1).first, {});
+    stats.emplace(MakeEntry(statsobjecttype::byCPIDbyProject, "a,1", 1).first, {});
+    stats.emplace(MakeEntry(statsobjecttype::NetworkWide, "", 1).first, {});
+
+    const std::vector<std::string> expected { "", "b", "a,1", "b,1" };
+
+    BOOST_CHECK(ObjectIds(stats) == expected);
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_replace_an_existing_entry_on_emplace)
+{
+    ScraperStats stats;
+    const auto first = MakeEntry(statsobjecttype::byProject, "a", 1);
+    const auto second = MakeEntry(statsobjecttype::byProject, "a", 2);
+
+    BOOST_CHECK(stats.emplace(first.first, first.second).second == true);
+    BOOST_CHECK(stats.emplace(second.first, second.second).second == false);
+
+    BOOST_CHECK_EQUAL(stats.size(), 1);
+    BOOST_CHECK_EQUAL(stats.find(first.first)->second.statsvalue.dRAC, 1);
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_entries_by_key)
+{
+    ScraperStats stats;
+    const auto entry = MakeEntry(statsobjecttype::byCPID, "a", 1);
+    const auto missing = MakeEntry(statsobjecttype::byProject, "a", 1);
+
+    stats[entry.first] = entry.second;
+
+    BOOST_CHECK(stats.find(entry.first) != stats.end());
+    BOOST_CHECK(stats.find(missing.first) == stats.end());
+    BOOST_CHECK_EQUAL(stats.count(entry.first), 1);
+    BOOST_CHECK_EQUAL(stats.count(missing.first), 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_seeks_to_the_first_entry_not_before_a_key)
+{
+    const ScraperStats stats = ScraperStats::FromUnsorted({
+        MakeEntry(statsobjecttype::byCPIDbyProject, "a,1", 1),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "ab,1", 2),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "b,1", 3),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "b,2", 4),
+    });
+
+    ScraperObjectStatsKey key { statsobjecttype::byCPIDbyProject, "b," };
+
+    BOOST_CHECK_EQUAL(stats.lower_bound(key)->second.statsvalue.dRAC, 3);
+
+    key.objectID = "c,";
+    BOOST_CHECK(stats.lower_bound(key) == stats.end());
+
+    key.objecttype = statsobjecttype::byCPID;
+    key.objectID = "";
+    BOOST_CHECK(stats.lower_bound(key) == stats.begin());
+}
+
+BOOST_AUTO_TEST_CASE(it_keeps_the_last_duplicate_when_built_from_unsorted_entries)
+{
+    std::vector<ScraperStats::value_type> entries {
+        MakeEntry(statsobjecttype::byCPIDbyProject, "p,c", 1),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "p,a", 2),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "p,c", 3),
+    };
+
+    const ScraperStats stats = ScraperStats::FromUnsorted(std::move(entries));
+
+    const std::vector<std::string> expected { "p,a", "p,c" };
+
+    BOOST_CHECK(ObjectIds(stats) == expected);
+    BOOST_CHECK_EQUAL(stats.begin()->second.statsvalue.dRAC, 2);
+    BOOST_CHECK_EQUAL(std::next(stats.begin())->second.statsvalue.dRAC, 3);
+}
+
+BOOST_AUTO_TEST_CASE(it_merges_sets_of_entries)
+{
+    ScraperStats stats = ScraperStats::FromUnsorted({
+        MakeEntry(statsobjecttype::byCPIDbyProject, "a,1", 1),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "c,1", 1),
+    });
+
+    stats.Merge(ScraperStats::FromUnsorted({
+        MakeEntry(statsobjecttype::byProject, "b", 2),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "b,1", 2),
+        MakeEntry(statsobjecttype::byCPIDbyProject, "c,1", 2),
+    }));
+
+    const std::vector<std::string> expected { "b", "a,1", "b,1", "c,1" };
+
+    BOOST_CHECK(ObjectIds(stats) == expected);
+
+    // The merged set replaces existing entries with the same key:
+    BOOST_CHECK_EQUAL(std::prev(stats.end())->second.statsvalue.dRAC, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
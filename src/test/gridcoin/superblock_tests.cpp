@@ -7,13 +7,16 @@
 #include "gridcoin/scraper/scraper_net.h"
 #include "gridcoin/superblock.h"
 #include "gridcoin/support/xml.h"
+#include "hash.h"
 #include "streams.h"
+#include "util.h"
 
 #include <array>
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/test/unit_test.hpp>
 #include <iostream>
 #include <openssl/md5.h>
+#include <set>
 #include <vector>
 
 #include "test/data/superblock.txt.h"
@@ -511,6 +514,8 @@ ConvergedScraperStats GetTestConvergence(
     /* set the hash pointer inside */
     manifest.phash= &it.first->first;
 
+    if (it.second) CScraperManifest::IndexManifest(manifest);
+
     return convergence;
 }
 } // anonymous namespace
@@ -843,6 +848,58 @@ BOOST_AUTO_TEST_CASE(it_initializes_to_an_empty_superblock_for_empty_strings)
     BOOST_CHECK(superblock.m_projects.empty());
 }
 
+BOOST_AUTO_TEST_CASE(it_reuses_decoded_legacy_text_contracts_from_the_cache)
+{
+    const fs::path path = GetDataDir() / "legacysuperblocks_test.dat";
+    fs::remove(path);
+
+    const std::string packed =
+        "<ZERO>2</ZERO>"
+        "<MAGNITUDES>"
+            "00010203040506070809101112131415,100;"
+            "15141312111009080706050403020100,200;"
+        "</MAGNITUDES>"
+        "<AVERAGES>"
+            "project_1,123,456;"
+            "project_2,234;"
+        "</AVERAGES>";
+
+    const GRC::Superblock expected = GRC::Superblock::UnpackLegacy(packed);
+
+    GRC::Superblock::OpenLegacyCache(path);
+    GRC::Superblock::UnpackLegacyCached(packed); // Stores the contract
+
+    const uint64_t cache_size = fs::file_size(path);
+    BOOST_CHECK(cache_size > 4);
+
+    // Simulate a record torn by an unclean shutdown:
+    {
+        CAutoFile file(fsbridge::fopen(path, "ab"), SER_DISK, CLIENT_VERSION);
+        file << uint256S("1");
+    }
+
+    GRC::Superblock::OpenLegacyCache(path);
+    BOOST_CHECK_EQUAL(fs::file_size(path), cache_size);
+
+    const GRC::Superblock superblock = GRC::Superblock::UnpackLegacyCached(packed);
+
+    // Loading the cached record appends nothing:
+    BOOST_CHECK_EQUAL(fs::file_size(path), cache_size);
+
+    BOOST_CHECK(superblock.m_version == 1);
+    BOOST_CHECK(superblock.GetHash() == expected.GetHash());
+    BOOST_CHECK(superblock.m_cpids.Zeros() == 2);
+    BOOST_CHECK(superblock.m_cpids.TotalMagnitude() == expected.m_cpids.TotalMagnitude());
+    BOOST_CHECK(superblock.m_projects.TotalRac() == 456);
+
+    if (const auto project_2 = superblock.m_projects.Try("project_2")) {
+        BOOST_CHECK(project_2->m_average_rac == 234);
+        BOOST_CHECK(project_2->m_rac == 0);
+    } else {
+        BOOST_FAIL("Project 2 not found in superblock.");
+    }
+}
+
 BOOST_AUTO_TEST_CASE(it_provides_backward_compatibility_for_legacy_contracts)
 {
     const std::string legacy_contract(
@@ -1358,6 +1415,43 @@ BOOST_AUTO_TEST_CASE(it_assumes_zero_magnitude_for_a_nonexistent_cpid)
     BOOST_CHECK(cpids.MagnitudeOf(cpid) == 0);
 }
 
+BOOST_AUTO_TEST_CASE(it_fetches_magnitudes_from_a_prebuilt_lookup_table)
+{
+    GRC::Superblock::CpidIndex cpids;
+    std::vector<std::pair<GRC::Cpid, GRC::Magnitude>> expected;
+
+    const double magnitudes[] = { 0.25, 5.5, 50 };
+
+    // Spread the CPIDs across all three magnitude segments:
+    for (uint8_t i = 0; i < 100; ++i) {
+        GRC::Cpid cpid;
+        cpid.Raw()[0] = i;
+        cpid.Raw()[15] = 100 - i;
+
+        const GRC::Magnitude magnitude = GRC::Magnitude::RoundFrom(magnitudes[i % 3]);
+
+        cpids.Add(cpid, magnitude);
+        expected.emplace_back(cpid, magnitude);
+    }
+
+    cpids.BuildLookup();
+
+    for (const auto& entry : expected) {
+        BOOST_CHECK(cpids.MagnitudeOf(entry.first) == entry.second);
+    }
+
+    GRC::Cpid missing;
+    missing.Raw()[0] = 200;
+
+    BOOST_CHECK(cpids.MagnitudeOf(missing) == 0);
+    BOOST_CHECK(cpids.MagnitudeOf(GRC::Cpid()) == 0);
+
+    // Adding a CPID discards the lookup table:
+    cpids.Add(missing, GRC::Magnitude::RoundFrom(123));
+
+    BOOST_CHECK(cpids.MagnitudeOf(missing) == 123);
+}
+
 BOOST_AUTO_TEST_CASE(it_counts_the_number_of_active_cpids)
 {
     GRC::Superblock::CpidIndex cpids;
@@ -1570,6 +1664,87 @@ BOOST_AUTO_TEST_CASE(it_deserializes_from_a_stream)
     BOOST_CHECK_CLOSE(cpids.AverageMagnitude(), meta.cpid_average_mag, 0.00000001);
 }
 
+BOOST_AUTO_TEST_CASE(it_round_trips_compressed_cpids)
+{
+    std::set<GRC::Cpid> sorted;
+
+    for (uint32_t i = 0; i < 1000; ++i) {
+        const uint256 hash = Hash(BEGIN(i), END(i));
+        GRC::Cpid cpid;
+
+        std::copy(hash.begin(), hash.begin() + 16, cpid.Raw().begin());
+        sorted.insert(cpid);
+    }
+
+    GRC::Superblock::CpidIndex cpids;
+    const double magnitudes[] = { 0.5, 50.0, 5000.0 };
+    size_t i = 0;
+
+    for (const auto& cpid : sorted) {
+        cpids.Add(cpid, GRC::Magnitude::RoundFrom(magnitudes[i++ % 3]));
+    }
+
+    cpids.Add(GRC::Cpid(), GRC::Magnitude::Zero());
+
+    CDataStream plain(SER_NETWORK, PROTOCOL_VERSION);
+    CDataStream compressed(SER_NETWORK, PROTOCOL_VERSION);
+
+    plain << cpids;
+    compressed << GRC::Superblock::CpidIndex::Compressed { cpids };
+
+    BOOST_CHECK_LT(compressed.size(), plain.size());
+
+    GRC::Superblock::CpidIndex result;
+    compressed >> GRC::Superblock::CpidIndex::Compressed { result };
+
+    BOOST_CHECK(compressed.empty());
+    BOOST_CHECK_EQUAL(result.size(), cpids.size());
+    BOOST_CHECK_EQUAL(result.Zeros(), 1);
+    BOOST_CHECK_EQUAL(result.TotalMagnitude(), cpids.TotalMagnitude());
+
+    i = 0;
+
+    for (const auto& cpid : sorted) {
+        BOOST_CHECK(result.MagnitudeOf(cpid) == GRC::Magnitude::RoundFrom(magnitudes[i++ % 3]));
+    }
+
+    // The compressed form re-serializes to the canonical one:
+    CDataStream reserialized(SER_NETWORK, PROTOCOL_VERSION);
+    reserialized << result;
+
+    BOOST_CHECK(reserialized.str() == plain.str());
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_malformed_compressed_cpids)
+{
+    const ScraperStatsMeta meta;
+    GRC::Superblock::MagnitudeStorageType magnitudes;
+
+    magnitudes.emplace_back(meta.cpid1, 0);
+    magnitudes.emplace_back(meta.cpid2, 0);
+    std::sort(magnitudes.begin(), magnitudes.end());
+
+    std::vector<unsigned char> packed = GRC::Superblock::PackCpids(magnitudes);
+    GRC::Superblock::MagnitudeStorageType result;
+
+    GRC::Superblock::UnpackCpids(packed, 2, result);
+    BOOST_CHECK(result == magnitudes);
+
+    // More CPIDs than the data holds:
+    BOOST_CHECK_THROW(GRC::Superblock::UnpackCpids(packed, 3, result), std::ios_base::failure);
+
+    // Truncated data:
+    std::vector<unsigned char> truncated(packed.begin(), packed.end() - 1);
+    BOOST_CHECK_THROW(GRC::Superblock::UnpackCpids(truncated, 2, result), std::ios_base::failure);
+
+    // Duplicate and descending CPIDs:
+    std::swap(magnitudes[0], magnitudes[1]);
+    BOOST_CHECK_THROW(GRC::Superblock::PackCpids(magnitudes), std::ios_base::failure);
+
+    magnitudes[0] = magnitudes[1];
+    BOOST_CHECK_THROW(GRC::Superblock::PackCpids(magnitudes), std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 // -----------------------------------------------------------------------------
@@ -2541,3 +2716,87 @@ BOOST_AUTO_TEST_CASE(it_deserializes_from_a_stream_for_md5)
 }
 
 BOOST_AUTO_TEST_SUITE_END()
+
+// -----------------------------------------------------------------------------
+// ConvergedScraperStats
+// -----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(CScraperManifest__PartIndex)
+
+BOOST_AUTO_TEST_CASE(it_indexes_the_project_parts_of_a_manifest)
+{
+    const ScraperStatsMeta meta;
+    const ConvergedScraperStats cache = GetTestConvergence(meta);
+
+    LOCK(CScraperManifest::cs_mapManifest);
+
+    const CSplitBlob::CPart* part = cache.Convergence.ConvergedManifestPartPtrsMap.at("project_1");
+    const auto range = CScraperManifest::mapProjectPartsByHash.equal_range(part->hash.GetUint64());
+
+    BOOST_REQUIRE(range.first != range.second);
+
+    const CScraperManifest& manifest = *range.first->second.first;
+    const CScraperManifest::dentry& entry = manifest.projects[range.first->second.second];
+
+    BOOST_CHECK_EQUAL(entry.project, "project_1");
+    BOOST_CHECK(manifest.vParts[entry.part1]->hash == part->hash);
+
+    // Deleting the manifest removes its parts from the index:
+    const uint256 manifest_hash = *manifest.phash;
+    const uint64_t part_key = part->hash.GetUint64();
+
+    BOOST_CHECK(CScraperManifest::DeleteManifest(manifest_hash, true));
+    BOOST_CHECK_EQUAL(CScraperManifest::mapProjectPartsByHash.count(part_key), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+BOOST_AUTO_TEST_SUITE(ConvergedScraperStats__PastConvergences)
+
+BOOST_AUTO_TEST_CASE(it_indexes_past_convergences_by_superblock_hash)
+{
+    const ScraperStatsMeta meta;
+    ConvergedScraperStats cache = GetTestConvergence(meta);
+
+    cache.NewFormatSuperblock = GRC::Superblock::FromConvergence(cache);
+    cache.Convergence.timestamp = GetAdjustedTime();
+
+    const GRC::QuorumHash superblock_hash = cache.NewFormatSuperblock.GetHash();
+
+    BOOST_CHECK(!cache.HasPastConvergenceForSuperblock(superblock_hash));
+
+    cache.AddConvergenceToPastConvergencesMap();
+
+    BOOST_CHECK(cache.HasPastConvergenceForSuperblock(superblock_hash));
+
+    // A second convergence with other content produces the same superblock:
+    cache.Convergence.nContentHash
+        = uint256S("3333333333333333333333333333333333333333333333333333333333333333");
+    cache.Convergence.timestamp += 1;
+    cache.AddConvergenceToPastConvergencesMap();
+
+    BOOST_CHECK_EQUAL(cache.PastConvergences.size(), 2);
+    BOOST_CHECK(cache.GetPastConvergencesMemoryUsage() > 0);
+
+    // Trimming keeps the newest convergence:
+    BOOST_CHECK_EQUAL(cache.TrimPastConvergencesMap(0), 1);
+    BOOST_CHECK_EQUAL(cache.PastConvergences.size(), 1);
+    BOOST_CHECK_EQUAL(cache.PastConvergences.begin()->second.second.timestamp, cache.Convergence.timestamp);
+    BOOST_CHECK(cache.HasPastConvergenceForSuperblock(superblock_hash));
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_the_index_entry_for_expired_convergences)
+{
+    const ScraperStatsMeta meta;
+    ConvergedScraperStats cache = GetTestConvergence(meta);
+
+    cache.NewFormatSuperblock = GRC::Superblock::FromConvergence(cache);
+    cache.Convergence.timestamp = GetAdjustedTime() - SCRAPER_CMANIFEST_RETENTION_TIME - 1;
+    cache.AddConvergenceToPastConvergencesMap();
+
+    BOOST_CHECK_EQUAL(cache.DeleteOldConvergenceFromPastConvergencesMap(), 1);
+    BOOST_CHECK(cache.PastConvergences.empty());
+    BOOST_CHECK(!cache.HasPastConvergenceForSuperblock(cache.NewFormatSuperblock.GetHash()));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
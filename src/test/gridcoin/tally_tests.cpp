@@ -0,0 +1,85 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "gridcoin/cpid.h"
+#include "gridcoin/tally.h"
+
+#include <boost/test/unit_test.hpp>
+
+// -----------------------------------------------------------------------------
+// TallyView
+// -----------------------------------------------------------------------------
+
+BOOST_AUTO_TEST_SUITE(TallyView)
+
+BOOST_AUTO_TEST_CASE(it_initializes_to_an_empty_view)
+{
+    const GRC::TallyView view;
+    const GRC::Cpid cpid = GRC::Cpid::Parse("00010203040506070809101112131415");
+
+    BOOST_CHECK_EQUAL(view.Epoch(), 0);
+    BOOST_CHECK_EQUAL(view.GetAccount(cpid).m_total_research_subsidy, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_fetches_accounts_from_the_shard_of_a_cpid)
+{
+    const GRC::Cpid cpid = GRC::Cpid::Parse("00010203040506070809101112131415");
+    const GRC::Cpid missing = GRC::Cpid::Parse("ff010203040506070809101112131415");
+
+    GRC::ResearchAccountMap accounts;
+    accounts[cpid].m_total_research_subsidy = 123;
+
+    GRC::TallyView::ShardArray shards;
+    shards[GRC::TallyView::ShardOf(cpid)]
+        = std::make_shared<const GRC::ResearchAccountMap>(std::move(accounts));
+
+    const GRC::TallyView view(1, std::move(shards), GRC::SuperblockPtr::Empty());
+
+    BOOST_CHECK_EQUAL(view.Epoch(), 1);
+    BOOST_CHECK_EQUAL(view.GetAccount(cpid).m_total_research_subsidy, 123);
+    BOOST_CHECK_EQUAL(view.GetAccount(missing).m_total_research_subsidy, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_reuses_the_arena_nodes_of_erased_accounts)
+{
+    std::vector<GRC::Cpid> cpids;
+
+    for (size_t i = 0; i < 1000; ++i) {
+        GRC::Cpid cpid;
+        cpid.Raw()[0] = i & 0xFF;
+        cpid.Raw()[1] = i >> 8;
+        cpids.emplace_back(cpid);
+    }
+
+    GRC::ResearchAccountMap accounts;
+
+    for (const auto& cpid : cpids) {
+        accounts[cpid].m_total_research_subsidy = 1;
+    }
+
+    const size_t slab_bytes = accounts.get_allocator().SlabBytes();
+    BOOST_CHECK(slab_bytes > 0);
+
+    for (size_t i = 0; i < 500; ++i) {
+        accounts.erase(cpids[i]);
+    }
+
+    for (size_t i = 0; i < 500; ++i) {
+        accounts[cpids[i]].m_total_research_subsidy = 2;
+    }
+
+    BOOST_CHECK_EQUAL(accounts.get_allocator().SlabBytes(), slab_bytes);
+    BOOST_CHECK_EQUAL(accounts.at(cpids[0]).m_total_research_subsidy, 2);
+    BOOST_CHECK_EQUAL(accounts.at(cpids[999]).m_total_research_subsidy, 1);
+
+    // A copy, like a published tally view, allocates from its own arena:
+    const GRC::ResearchAccountMap copy(accounts);
+
+    BOOST_CHECK(copy.get_allocator() != accounts.get_allocator());
+    BOOST_CHECK_EQUAL(copy.size(), accounts.size());
+    BOOST_CHECK_EQUAL(copy.at(cpids[0]).m_total_research_subsidy, 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,102 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "gridcoin/support/xml.h"
+
+#include <boost/test/unit_test.hpp>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+//!
+//! \brief Read every team record from the input with an XmlRecordReader and
+//! collect the IDs and names.
+//!
+std::vector<std::pair<std::string, std::string>> ReadTeams(const std::string& input)
+{
+    std::istringstream in(input);
+    GRC::XmlRecordReader reader(in, "team");
+    std::vector<std::pair<std::string, std::string>> teams;
+
+    while (reader.NextRecord()) {
+        teams.emplace_back(reader.Field("id"), reader.Field("name"));
+    }
+
+    return teams;
+}
+
+std::string Team(const size_t id, const std::string& name)
+{
+    return "<team>\n"
+        "  <id>" + std::to_string(id) + "</id>\n"
+        "  <type>1</type>\n"
+        "  <name>" + name + "</name>\n"
+        "  <total_credit>1234.5</total_credit>\n"
+        "</team>\n";
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(XmlRecordReader)
+
+BOOST_AUTO_TEST_CASE(it_reads_the_records_of_a_team_file)
+{
+    const auto teams = ReadTeams(
+        "<?xml version=\"1.0\" encoding=\"ISO-8859-1\" ?>\n"
+        "<teams>\n"
+        + Team(1, "Gridcoin")
+        + Team(2, "Other")
+        + "</teams>\n");
+
+    BOOST_REQUIRE_EQUAL(teams.size(), 2);
+    BOOST_CHECK_EQUAL(teams[0].first, "1");
+    BOOST_CHECK_EQUAL(teams[0].second, "Gridcoin");
+    BOOST_CHECK_EQUAL(teams[1].first, "2");
+    BOOST_CHECK_EQUAL(teams[1].second, "Other");
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_an_empty_string_for_a_missing_field)
+{
+    const auto teams = ReadTeams("<teams><team><id>7</id></team></teams>");
+
+    BOOST_REQUIRE_EQUAL(teams.size(), 1);
+    BOOST_CHECK_EQUAL(teams[0].first, "7");
+    BOOST_CHECK_EQUAL(teams[0].second, "");
+}
+
+BOOST_AUTO_TEST_CASE(it_ignores_an_incomplete_trailing_record)
+{
+    const auto teams = ReadTeams(Team(1, "Gridcoin") + "<team><id>2</id>");
+
+    BOOST_REQUIRE_EQUAL(teams.size(), 1);
+    BOOST_CHECK_EQUAL(teams[0].second, "Gridcoin");
+}
+
+BOOST_AUTO_TEST_CASE(it_reads_records_that_span_chunks)
+{
+    // Enough records to split tags across the boundaries of the 64 KiB chunks
+    // read from the stream, and one record larger than a chunk:
+    std::string input = "<teams>\n";
+
+    for (size_t i = 0; i < 5000; ++i) {
+        input += Team(i, "Team " + std::to_string(i));
+    }
+
+    input += Team(5000, std::string(100 * 1024, 'x'));
+    input += "</teams>\n";
+
+    const auto teams = ReadTeams(input);
+
+    BOOST_REQUIRE_EQUAL(teams.size(), 5001);
+
+    for (size_t i = 0; i < 5000; ++i) {
+        BOOST_CHECK_EQUAL(teams[i].first, std::to_string(i));
+        BOOST_CHECK_EQUAL(teams[i].second, "Team " + std::to_string(i));
+    }
+
+    BOOST_CHECK_EQUAL(teams[5000].second.size(), 100 * 1024);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
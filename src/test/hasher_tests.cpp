@@ -0,0 +1,74 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/siphash.h"
+#include "main.h"
+#include "uint256.h"
+#include "util/hasher.h"
+
+#include <boost/test/unit_test.hpp>
+#include <vector>
+
+namespace {
+//!
+//! \brief Key of the SipHash reference test vectors: bytes 0x00 to 0x0f.
+//!
+constexpr uint64_t k0 = 0x0706050403020100ULL;
+constexpr uint64_t k1 = 0x0F0E0D0C0B0A0908ULL;
+
+//!
+//! \brief Get the message of the reference test vectors: the bytes from
+//! 0x00 counting up.
+//!
+std::vector<unsigned char> Message(const size_t size)
+{
+    std::vector<unsigned char> message(size);
+
+    for (size_t i = 0; i < size; ++i) {
+        message[i] = i;
+    }
+
+    return message;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(hasher_tests)
+
+BOOST_AUTO_TEST_CASE(siphash13_matches_reference_vectors)
+{
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(0).data(), 0), 0xabac0158050fc4dcULL);
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(1).data(), 1), 0xc9f49bf37d57ca93ULL);
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(7).data(), 7), 0xd3927d989bb11140ULL);
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(8).data(), 8), 0x369095118d299a8eULL);
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(15).data(), 15), 0xd320d86d2a519956ULL);
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(16).data(), 16), 0xcc4fdd1a7d908b66ULL);
+    BOOST_CHECK_EQUAL(SipHash13(k0, k1, Message(20).data(), 20), 0xc0dc2f46a6cce040ULL);
+}
+
+BOOST_AUTO_TEST_CASE(siphash13_uint256_matches_the_generic_implementation)
+{
+    const std::vector<unsigned char> message = Message(36);
+    const uint256 hash(std::vector<unsigned char>(message.begin(), message.begin() + 32));
+
+    BOOST_CHECK_EQUAL(SipHash13Uint256(k0, k1, hash), 0x81157b6c16a7b60dULL);
+    BOOST_CHECK_EQUAL(SipHash13Uint256(k0, k1, hash), SipHash13(k0, k1, message.data(), 32));
+
+    BOOST_CHECK_EQUAL(SipHash13Uint256Extra(k0, k1, hash, 0x23222120), 0x2cf508d3ada26206ULL);
+    BOOST_CHECK_EQUAL(SipHash13Uint256Extra(k0, k1, hash, 0x23222120), SipHash13(k0, k1, message.data(), 36));
+}
+
+BOOST_AUTO_TEST_CASE(salted_hashers_hash_the_bytes_of_their_keys)
+{
+    const uint256 hash = GetRandHash();
+    const uint160 id(std::vector<unsigned char>(hash.begin(), hash.begin() + 20));
+
+    BOOST_CHECK_EQUAL(SaltedUint256Hasher()(hash), SaltedSipHash(hash.begin(), hash.size()));
+    BOOST_CHECK_EQUAL(SaltedUint160Hasher()(id), SaltedSipHash(id.begin(), id.size()));
+
+    // The hash of an outpoint covers the output index:
+    BOOST_CHECK(SaltedOutPointHasher()(COutPoint(hash, 0)) != SaltedOutPointHasher()(COutPoint(hash, 1)));
+    BOOST_CHECK(SaltedOutPointHasher()(COutPoint(hash, 0)) != SaltedUint256Hasher()(hash));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -141,7 +141,74 @@ BOOST_AUTO_TEST_CASE(key_test1)
         BOOST_CHECK(rkey2.GetPubKey()  == key2.GetPubKey());
         BOOST_CHECK(rkey1C.GetPubKey() == key1C.GetPubKey());
         BOOST_CHECK(rkey2C.GetPubKey() == key2C.GetPubKey());
+
+        // public key verification and recovery
+
+        const CPubKey pubkey1 = key1.GetPubKey();
+        const CPubKey pubkey2C = key2C.GetPubKey();
+
+        BOOST_CHECK( pubkey1.Verify(hashMsg, sign1));
+        BOOST_CHECK( pubkey1.Verify(hashMsg, sign1C));
+        BOOST_CHECK(!pubkey1.Verify(hashMsg, sign2));
+        BOOST_CHECK( pubkey2C.Verify(hashMsg, sign2));
+        BOOST_CHECK(!pubkey2C.Verify(hashMsg, sign1C));
+        BOOST_CHECK(!pubkey1.Verify(hashMsg, vector<unsigned char>()));
+
+        CPubKey rpubkey1, rpubkey2C;
+
+        BOOST_CHECK(rpubkey1.RecoverCompact (hashMsg, csign1));
+        BOOST_CHECK(rpubkey2C.RecoverCompact(hashMsg, csign2C));
+        BOOST_CHECK(rpubkey1  == pubkey1);
+        BOOST_CHECK(rpubkey2C == pubkey2C);
     }
 }
 
+BOOST_AUTO_TEST_CASE(pubkey_verify_accepts_high_s_signatures)
+{
+    CBitcoinSecret bsecret;
+    BOOST_CHECK(bsecret.SetString(strSecret1C));
+
+    bool fCompressed;
+    CKey key;
+    key.SetSecret(bsecret.GetSecret(fCompressed), fCompressed);
+
+    const std::string strMsg = "High-S signature";
+    const uint256 hashMsg = Hash(strMsg.begin(), strMsg.end());
+
+    vector<unsigned char> vchSig;
+    BOOST_CHECK(key.Sign(hashMsg, vchSig));
+
+    // Replace S with (order - S) to produce the equivalent high-S signature
+    // that the original OpenSSL verifier accepted and old blocks may contain:
+    static const unsigned char order[32] = {
+        0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,
+        0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFF,0xFE,
+        0xBA,0xAE,0xDC,0xE6,0xAF,0x48,0xA0,0x3B,
+        0xBF,0xD2,0x5E,0x8C,0xD0,0x36,0x41,0x41
+    };
+
+    const size_t rlen = vchSig[3];
+    const size_t slen = vchSig[5 + rlen];
+    unsigned char s[32] = {0};
+    memcpy(s + 32 - slen, &vchSig[6 + rlen], slen);
+
+    unsigned char high_s[32];
+    int borrow = 0;
+    for (int i = 31; i >= 0; i--) {
+        int diff = order[i] - s[i] - borrow;
+        borrow = diff < 0;
+        high_s[i] = diff & 0xFF;
+    }
+
+    vector<unsigned char> vchHighSig(vchSig.begin(), vchSig.begin() + 4 + rlen);
+    vchHighSig.push_back(0x02);
+    vchHighSig.push_back(33);
+    vchHighSig.push_back(0x00);
+    vchHighSig.insert(vchHighSig.end(), high_s, high_s + 32);
+    vchHighSig[1] = vchHighSig.size() - 2;
+
+    BOOST_CHECK(key.GetPubKey().Verify(hashMsg, vchSig));
+    BOOST_CHECK(key.GetPubKey().Verify(hashMsg, vchHighSig));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
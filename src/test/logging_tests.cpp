@@ -0,0 +1,86 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "logging.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(logging_tests)
+
+BOOST_AUTO_TEST_CASE(it_drains_queued_messages_in_order)
+{
+    std::string written;
+    BCLog::AsyncQueue queue(4, false, [&](const std::string& batch) { written += batch; });
+
+    BOOST_CHECK(!queue.Drain());
+
+    BOOST_CHECK(queue.Push("a\n"));
+    BOOST_CHECK(queue.Push("b\n"));
+    BOOST_CHECK(queue.Drain());
+    BOOST_CHECK_EQUAL(written, "a\nb\n");
+
+    // Wraps around the ring:
+    for (const char* str : { "c\n", "d\n", "e\n", "f\n" }) {
+        BOOST_CHECK(queue.Push(str));
+    }
+
+    BOOST_CHECK(queue.Drain());
+    BOOST_CHECK_EQUAL(written, "a\nb\nc\nd\ne\nf\n");
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_dropped_messages_when_full)
+{
+    std::string written;
+    BCLog::AsyncQueue queue(2, true, [&](const std::string& batch) { written += batch; });
+
+    BOOST_CHECK(queue.Push("a\n"));
+    BOOST_CHECK(queue.Push("b\n"));
+    BOOST_CHECK(queue.Push("c\n"));
+    BOOST_CHECK_EQUAL(queue.Dropped(), 1);
+
+    BOOST_CHECK(queue.Drain());
+    BOOST_CHECK_EQUAL(written, "a\nb\nWARNING: Logger: dropped 1 messages because the log queue was full\n");
+}
+
+BOOST_AUTO_TEST_CASE(it_refuses_messages_after_close)
+{
+    std::string written;
+    BCLog::AsyncQueue queue(2, false, [&](const std::string& batch) { written += batch; });
+
+    BOOST_CHECK(queue.Push("a\n"));
+    queue.Close();
+    BOOST_CHECK(!queue.Push("b\n"));
+
+    BOOST_CHECK(queue.Drain());
+    BOOST_CHECK_EQUAL(written, "a\n");
+}
+
+BOOST_AUTO_TEST_CASE(it_accepts_messages_from_many_producers)
+{
+    size_t lines = 0;
+    BCLog::AsyncQueue queue(8, false, [&](const std::string& batch) {
+        lines += std::count(batch.begin(), batch.end(), '\n');
+    });
+
+    std::vector<std::thread> producers;
+
+    for (int i = 0; i < 4; ++i) {
+        producers.emplace_back([&] {
+            for (int j = 0; j < 1000; ++j) queue.Push("x\n");
+        });
+    }
+
+    while (lines < 4000) queue.Drain();
+
+    for (auto& producer : producers) producer.join();
+
+    BOOST_CHECK_EQUAL(lines, 4000);
+    BOOST_CHECK(!queue.Drain());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+CTransaction BuildTransaction(const uint256& hash_prev, const int64_t value)
+{
+    CTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout.hash = hash_prev;
+    tx.vin[0].prevout.n = 0;
+    tx.vout.emplace_back(value, CScript() << OP_TRUE);
+
+    return tx;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(mempool_tests)
+
+BOOST_AUTO_TEST_CASE(it_stores_the_admission_data_of_a_transaction)
+{
+    CTxMemPool pool;
+    CTransaction parent = BuildTransaction(uint256S("0x01"), COIN);
+    CTransaction child = BuildTransaction(parent.GetHash(), COIN / 2);
+
+    CTxMemPoolEntry entry;
+    entry.nFee = COIN / 2;
+    entry.nTxSize = 100;
+    entry.fHaveInputs = true;
+    entry.setParents.insert(parent.GetHash());
+
+    LOCK(pool.cs);
+
+    pool.addUnchecked(parent.GetHash(), parent);
+    pool.addUnchecked(child.GetHash(), child, entry);
+
+    const CTxMemPoolEntry* stored = pool.GetEntry(parent.GetHash());
+
+    BOOST_REQUIRE(stored != nullptr);
+    BOOST_CHECK(!stored->fHaveInputs);
+
+    stored = pool.GetEntry(child.GetHash());
+
+    BOOST_REQUIRE(stored != nullptr);
+    BOOST_CHECK_EQUAL(stored->nFee, COIN / 2);
+    BOOST_CHECK_EQUAL(stored->nTxSize, 100);
+    BOOST_CHECK(stored->setParents == entry.setParents);
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_the_admission_data_with_the_transaction)
+{
+    CTxMemPool pool;
+    CTransaction parent = BuildTransaction(uint256S("0x01"), COIN);
+    CTransaction child = BuildTransaction(parent.GetHash(), COIN / 2);
+
+    LOCK(pool.cs);
+
+    pool.addUnchecked(parent.GetHash(), parent, CTxMemPoolEntry());
+    pool.addUnchecked(child.GetHash(), child, CTxMemPoolEntry());
+    pool.remove(parent, true);
+
+    BOOST_CHECK(pool.mapTx.empty());
+    BOOST_CHECK(pool.mapEntries.empty());
+
+    pool.addUnchecked(parent.GetHash(), parent, CTxMemPoolEntry());
+    pool.clear();
+
+    BOOST_CHECK(pool.mapEntries.empty());
+}
+
+BOOST_AUTO_TEST_CASE(it_accounts_for_the_size_of_the_transactions)
+{
+    CTxMemPool pool;
+    CTransaction tx = BuildTransaction(uint256S("0x01"), COIN);
+    const unsigned int size = ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION);
+
+    BOOST_CHECK(pool.addUnchecked(tx.GetHash(), tx));
+    BOOST_CHECK(!pool.addUnchecked(tx.GetHash(), tx));
+
+    CTxMemPoolStats stats = pool.GetStats();
+
+    BOOST_CHECK_EQUAL(stats.nTx, 1);
+    BOOST_CHECK_EQUAL(stats.nTxBytes, size);
+    BOOST_CHECK(stats.nUsage > size);
+
+    pool.remove(tx);
+    stats = pool.GetStats();
+
+    BOOST_CHECK_EQUAL(stats.nTx, 0);
+    BOOST_CHECK_EQUAL(stats.nTxBytes, 0);
+    BOOST_CHECK_EQUAL(stats.nUsage, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_expires_transactions_by_age)
+{
+    CTxMemPool pool;
+    pool.SetLimits(1024 * 1024, 60);
+
+    CTransaction parent = BuildTransaction(uint256S("0x01"), COIN);
+    CTransaction child = BuildTransaction(parent.GetHash(), COIN / 2);
+    CTransaction other = BuildTransaction(uint256S("0x02"), COIN);
+
+    CTxMemPoolEntry entry;
+    entry.nTime = 1000;
+    pool.addUnchecked(parent.GetHash(), parent, entry);
+    entry.nTime = 1050;
+    pool.addUnchecked(child.GetHash(), child, entry);
+    pool.addUnchecked(other.GetHash(), other, entry);
+
+    BOOST_CHECK_EQUAL(pool.Limit(1060), 0);
+
+    // The child leaves with its expired parent:
+    BOOST_CHECK_EQUAL(pool.Limit(1061), 2);
+    BOOST_CHECK(pool.exists(other.GetHash()));
+    BOOST_CHECK_EQUAL(pool.GetStats().nExpired, 2);
+}
+
+BOOST_AUTO_TEST_CASE(it_evicts_the_lowest_fee_rate_over_the_limit)
+{
+    CTxMemPool pool;
+    std::vector<CTransaction> txs;
+
+    for (int i = 1; i <= 3; ++i) {
+        txs.push_back(BuildTransaction(uint256S(strprintf("%064x", i)), COIN));
+
+        CTxMemPoolEntry entry;
+        entry.nFee = i * 1000;
+        entry.nTxSize = 100;
+        entry.nTime = 1000;
+
+        pool.addUnchecked(txs.back().GetHash(), txs.back(), entry);
+    }
+
+    const size_t usage = pool.GetStats().nUsage;
+
+    pool.SetLimits(usage - 1, 60 * 60);
+
+    BOOST_CHECK_EQUAL(pool.Limit(1000), 1);
+    BOOST_CHECK(!pool.exists(txs[0].GetHash()));
+    BOOST_CHECK(pool.exists(txs[1].GetHash()));
+    BOOST_CHECK(pool.exists(txs[2].GetHash()));
+
+    const CTxMemPoolStats stats = pool.GetStats();
+
+    BOOST_CHECK_EQUAL(stats.nEvicted, 1);
+    BOOST_CHECK(stats.nUsage <= usage - 1);
+    BOOST_CHECK_EQUAL(stats.dMinFeeRate, 20000);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_malformed_transactions_before_validation)
+{
+    CTransaction empty;
+
+    BOOST_CHECK(!PreValidateTransaction(empty));
+
+    CTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vin[0].scriptSig = CScript() << 1 << 2;
+    coinbase.vout.emplace_back(COIN, CScript() << OP_TRUE);
+
+    BOOST_CHECK(!PreValidateTransaction(coinbase));
+    BOOST_CHECK_EQUAL(coinbase.nDoS, 100);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
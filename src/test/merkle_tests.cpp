@@ -0,0 +1,64 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+//!
+//! \brief Compute a merkle root one hash at a time like the original code.
+//!
+uint256 NaiveMerkleRoot(std::vector<uint256> level)
+{
+    if (level.empty()) {
+        return uint256();
+    }
+
+    while (level.size() > 1) {
+        std::vector<uint256> next;
+
+        for (size_t i = 0; i < level.size(); i += 2) {
+            const uint256& left = level[i];
+            const uint256& right = level[std::min(i + 1, level.size() - 1)];
+
+            next.push_back(Hash(BEGIN(left), END(left), BEGIN(right), END(right)));
+        }
+
+        level.swap(next);
+    }
+
+    return level[0];
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(merkle_tests)
+
+BOOST_AUTO_TEST_CASE(it_builds_the_same_tree_as_one_hash_at_a_time)
+{
+    for (size_t count = 0; count <= 33; ++count) {
+        CBlock block;
+        std::vector<uint256> txids;
+
+        for (size_t i = 0; i < count; ++i) {
+            CTransaction tx;
+            tx.nLockTime = i;
+
+            block.vtx.push_back(tx);
+            txids.push_back(tx.GetHash());
+        }
+
+        const uint256 root = block.BuildMerkleTree();
+
+        BOOST_CHECK_EQUAL(root.GetHex(), NaiveMerkleRoot(txids).GetHex());
+
+        for (size_t i = 0; i < count; ++i) {
+            BOOST_CHECK_EQUAL(
+                CBlock::CheckMerkleBranch(txids[i], block.GetMerkleBranch(i), i).GetHex(),
+                root.GetHex());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
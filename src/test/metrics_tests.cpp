@@ -0,0 +1,51 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "metrics.h"
+#include "util/perf.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+bool Contains(const std::string& text, const std::string& part)
+{
+    return text.find(part) != std::string::npos;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(metrics_tests)
+
+BOOST_AUTO_TEST_CASE(it_formats_the_node_metric_families)
+{
+    const std::string metrics = FormatMetrics();
+
+    BOOST_CHECK(Contains(metrics, "# TYPE gridcoin_mempool_transactions gauge\n"));
+    BOOST_CHECK(Contains(metrics, "# TYPE gridcoin_peers gauge\n"));
+    BOOST_CHECK(Contains(metrics, "gridcoin_peers{direction=\"inbound\"} "));
+    BOOST_CHECK(Contains(metrics, "# TYPE gridcoin_staking_kernel_hashes_total counter\n"));
+    BOOST_CHECK(Contains(metrics, "# TYPE gridcoin_scraper_convergence_timestamp_seconds gauge\n"));
+    BOOST_CHECK(Contains(metrics, "# TYPE gridcoin_duration_seconds histogram\n"));
+}
+
+BOOST_AUTO_TEST_CASE(it_formats_perf_counters_as_cumulative_histograms)
+{
+    util::PerfCounter& counter = util::GetPerfCounter("metrics_tests.\"path\"");
+
+    counter.Reset();
+    counter.Record(1);
+    counter.Record(3);
+
+    const std::string metrics = FormatMetrics();
+    const std::string path = "path=\"metrics_tests.\\\"path\\\"\"";
+
+    BOOST_CHECK(Contains(metrics, "gridcoin_duration_seconds_bucket{" + path + ",le=\"2e-06\"} 1\n"));
+    BOOST_CHECK(Contains(metrics, "gridcoin_duration_seconds_bucket{" + path + ",le=\"4e-06\"} 2\n"));
+    BOOST_CHECK(Contains(metrics, "gridcoin_duration_seconds_bucket{" + path + ",le=\"+Inf\"} 2\n"));
+    BOOST_CHECK(Contains(metrics, "gridcoin_duration_seconds_sum{" + path + "} 4e-06\n"));
+    BOOST_CHECK(Contains(metrics, "gridcoin_duration_seconds_count{" + path + "} 2\n"));
+
+    counter.Reset();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -293,5 +293,47 @@ BOOST_AUTO_TEST_CASE(multisig_Sign)
     }
 }
 
+BOOST_AUTO_TEST_CASE(multisig_SignSignatures)
+{
+    // Enough inputs for SignSignatures() to sign them on several threads:
+    CBasicKeyStore keystore;
+    CKey key[3];
+    for (int i = 0; i < 3; i++)
+    {
+        key[i].MakeNewKey(true);
+        keystore.AddKey(key[i]);
+    }
+
+    CScript a_and_b;
+    a_and_b << OP_2 << key[0].GetPubKey() << key[1].GetPubKey() << OP_2 << OP_CHECKMULTISIG;
+
+    CScript to_c;
+    to_c.SetDestination(key[2].GetPubKey().GetID());
+
+    CTransaction txTo;
+    std::vector<CScript> prevScripts;
+    for (int i = 0; i < 100; i++)
+    {
+        txTo.vin.push_back(CTxIn(GetRandHash(), i));
+        prevScripts.push_back(i % 2 ? a_and_b : to_c);
+    }
+    txTo.vout.resize(1);
+    txTo.vout[0].nValue = 1;
+
+    BOOST_CHECK(SignSignatures(keystore, prevScripts, txTo));
+
+    for (unsigned int i = 0; i < txTo.vin.size(); i++)
+    {
+        BOOST_CHECK_MESSAGE(VerifyScript(txTo.vin[i].scriptSig, prevScripts[i], txTo, i, 0), strprintf("VerifyScript %d", i));
+    }
+
+    // A script that the key store cannot solve fails the whole transaction:
+    CKey unknown;
+    unknown.MakeNewKey(true);
+    prevScripts[57].SetDestination(unknown.GetPubKey().GetID());
+
+    BOOST_CHECK(!SignSignatures(keystore, prevScripts, txTo));
+}
+
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,115 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "orphanblocks.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+CBlock MakeBlock(const uint256& hash_prev, const unsigned int time)
+{
+    CBlock block;
+    block.hashPrevBlock = hash_prev;
+    block.nTime = time;
+    block.nBits = 0x1e0fffff;
+
+    CTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.emplace_back(0, CScript() << OP_TRUE);
+    block.vtx.push_back(coinbase);
+
+    block.hashMerkleRoot = block.BuildMerkleTree();
+
+    return block;
+}
+
+size_t BlockSize(const CBlock& block)
+{
+    return ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(orphanblocks_tests)
+
+BOOST_AUTO_TEST_CASE(it_returns_the_children_of_a_block)
+{
+    COrphanBlockPool pool(1024 * 1024);
+
+    const CBlock first = MakeBlock(uint256S("0x01"), 1);
+    const CBlock second = MakeBlock(first.GetHash(), 2);
+    const CBlock sibling = MakeBlock(first.GetHash(), 3);
+
+    pool.Add(second, 1, 100);
+    pool.Add(first, 1, 100);
+    pool.Add(sibling, 2, 100);
+
+    BOOST_CHECK(pool.Contains(first.GetHash()));
+    BOOST_CHECK(pool.HasChildren(first.GetHash()));
+    BOOST_CHECK(pool.GetRoot(pool.Get(second.GetHash()))->GetHash() == first.GetHash());
+
+    const std::vector<std::unique_ptr<CBlock>> children = pool.TakeChildren(first.GetHash());
+
+    BOOST_CHECK_EQUAL(children.size(), 2);
+    BOOST_CHECK(!pool.Contains(second.GetHash()));
+    BOOST_CHECK(!pool.Contains(sibling.GetHash()));
+    BOOST_CHECK(!pool.HasChildren(first.GetHash()));
+
+    const OrphanBlockStats stats = pool.GetStats();
+
+    BOOST_CHECK_EQUAL(stats.nBlocks, 1);
+    BOOST_CHECK_EQUAL(stats.nBytes, BlockSize(first));
+    BOOST_CHECK_EQUAL(stats.nPeers, 1);
+    BOOST_CHECK_EQUAL(stats.nAdded, 3);
+}
+
+BOOST_AUTO_TEST_CASE(it_evicts_the_oldest_block_of_the_heaviest_peer)
+{
+    const CBlock a = MakeBlock(uint256S("0x01"), 1);
+    const CBlock b = MakeBlock(uint256S("0x02"), 2);
+    const CBlock c = MakeBlock(uint256S("0x03"), 3);
+    const CBlock d = MakeBlock(uint256S("0x04"), 4);
+
+    // All of the blocks have the same size. Room for three. The oldest block
+    // survives because another peer sent more bytes:
+    COrphanBlockPool pool(BlockSize(a) * 3);
+
+    pool.Add(a, 1, 100);
+    pool.Add(b, 2, 101);
+    pool.Add(c, 2, 102);
+    pool.Add(d, 2, 103);
+
+    BOOST_CHECK(pool.Contains(a.GetHash()));
+    BOOST_CHECK(!pool.Contains(b.GetHash()));
+    BOOST_CHECK(pool.Contains(c.GetHash()));
+    BOOST_CHECK(pool.Contains(d.GetHash()));
+    BOOST_CHECK_EQUAL(pool.GetStats().nEvicted, 1);
+}
+
+BOOST_AUTO_TEST_CASE(it_expires_old_blocks)
+{
+    COrphanBlockPool pool(1024 * 1024);
+
+    const CBlock old_block = MakeBlock(uint256S("0x01"), 1);
+    const CBlock new_block = MakeBlock(uint256S("0x02"), 2);
+
+    pool.Add(old_block, 1, 100);
+    pool.Add(new_block, 1, 101 + COrphanBlockPool::ORPHAN_BLOCK_EXPIRE_TIME);
+
+    BOOST_CHECK(!pool.Contains(old_block.GetHash()));
+    BOOST_CHECK(pool.Contains(new_block.GetHash()));
+    BOOST_CHECK_EQUAL(pool.GetStats().nExpired, 1);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_a_block_larger_than_the_limit)
+{
+    const CBlock block = MakeBlock(uint256S("0x01"), 1);
+    COrphanBlockPool pool(BlockSize(block) - 1);
+
+    BOOST_CHECK(pool.Add(block, 1, 100) == nullptr);
+    BOOST_CHECK_EQUAL(pool.GetStats().nBytes, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
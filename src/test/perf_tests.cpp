@@ -0,0 +1,59 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/perf.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_SUITE(perf_tests)
+
+BOOST_AUTO_TEST_CASE(it_records_durations_into_histogram_buckets)
+{
+    util::PerfCounter counter("test");
+
+    counter.Record(0);
+    counter.Record(1);
+    counter.Record(3);
+    counter.Record(1000);
+    counter.Record(UINT64_MAX);
+
+    const util::PerfCounter::Snapshot snapshot = counter.GetSnapshot();
+
+    BOOST_CHECK_EQUAL(snapshot.name, "test");
+    BOOST_CHECK_EQUAL(snapshot.count, 5);
+    BOOST_CHECK_EQUAL(snapshot.max_us, UINT64_MAX);
+    BOOST_CHECK_EQUAL(snapshot.histogram[0], 2); // 0 and 1
+    BOOST_CHECK_EQUAL(snapshot.histogram[1], 1); // 3
+    BOOST_CHECK_EQUAL(snapshot.histogram[9], 1); // 1000
+    BOOST_CHECK_EQUAL(snapshot.histogram[util::PerfCounter::BUCKETS - 1], 1);
+
+    counter.Reset();
+
+    BOOST_CHECK_EQUAL(counter.GetSnapshot().count, 0);
+    BOOST_CHECK_EQUAL(counter.GetSnapshot().max_us, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_records_scopes_only_while_enabled)
+{
+    util::PerfCounter& counter = util::GetPerfCounter("perf_tests.scope");
+
+    BOOST_CHECK_EQUAL(&counter, &util::GetPerfCounter("perf_tests.scope"));
+
+    util::g_perf_enabled = false;
+    { util::PerfTimer timer(counter); }
+    BOOST_CHECK_EQUAL(counter.GetSnapshot().count, 0);
+
+    util::g_perf_enabled = true;
+    { util::PerfTimer timer(counter); }
+    { util::PerfTimer timer("perf_tests.", "scope"); }
+    util::g_perf_enabled = false;
+
+    BOOST_CHECK_EQUAL(counter.GetSnapshot().count, 2);
+
+    util::ResetPerfCounters();
+
+    BOOST_CHECK_EQUAL(counter.GetSnapshot().count, 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 #include <boost/foreach.hpp>
 
 #include "base58.h"
+#include "gridcoin/magnitude.h"
 #include "util.h"
 #include "rpcserver.h"
 #include "rpcclient.h"
@@ -61,4 +62,65 @@ BOOST_AUTO_TEST_CASE(rpc_addmultisig)
     BOOST_CHECK_THROW(addmultisig(createArgs(2, short2.c_str()), false), runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_format_fixed_point_values)
+{
+    BOOST_CHECK_EQUAL(ValueFromAmount(0).write(), "0.00000000");
+    BOOST_CHECK_EQUAL(ValueFromAmount(1).write(), "0.00000001");
+    BOOST_CHECK_EQUAL(ValueFromAmount(-COIN / 2).write(), "-0.50000000");
+    BOOST_CHECK_EQUAL(ValueFromAmount(2099999997690000LL).write(), "20999999.97690000");
+
+    // Unlike the double from Magnitude::Floating(), which writes 0.07 as
+    // 0.07000000000000001, the fixed-point value prints exactly:
+    BOOST_CHECK_EQUAL(ValueFromMagnitude(GRC::Magnitude::FromScaled(0)).write(), "0");
+    BOOST_CHECK_EQUAL(ValueFromMagnitude(GRC::Magnitude::FromScaled(7)).write(), "0.07");
+    BOOST_CHECK_EQUAL(ValueFromMagnitude(GRC::Magnitude::FromScaled(1230)).write(), "12.3");
+    BOOST_CHECK_EQUAL(ValueFromMagnitude(GRC::Magnitude::FromScaled(3276700)).write(), "32767");
+}
+
+BOOST_AUTO_TEST_CASE(rpc_json_stream_writer)
+{
+    std::vector<std::string> chunks;
+    JSONStreamWriter out([&](const std::string& data) { chunks.push_back(data); }, 8);
+
+    out.BeginObject();
+    BOOST_CHECK(!out.Started());
+
+    out.KV("a", 1);
+    out.Key("b");
+    out.BeginArray();
+    out.Value("x");
+    out.Value(UniValue(UniValue::VOBJ));
+    out.EndArray();
+    out.KV("c", NullUniValue);
+    out.EndObject();
+    out.Flush();
+
+    BOOST_CHECK(out.Started());
+    BOOST_CHECK(chunks.size() > 1);
+
+    std::string document;
+    for (const auto& chunk : chunks) document += chunk;
+
+    BOOST_CHECK_EQUAL(document, "{\"a\":1,\"b\":[\"x\",{}],\"c\":null}");
+
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(document));
+}
+
+BOOST_AUTO_TEST_CASE(rpc_reads_chunked_reply)
+{
+    std::istringstream stream(
+        HTTPChunkedReplyHeader(HTTP_OK, true).substr(strlen("HTTP/1.1 200 OK\r\n"))
+        + HTTPChunk("{\"result\":")
+        + HTTPChunk("[1,2,3]}")
+        + HTTPChunk(""));
+
+    std::map<std::string, std::string> headers;
+    std::string message;
+
+    BOOST_CHECK_EQUAL(ReadHTTPMessage(stream, headers, message, 1), HTTP_OK);
+    BOOST_CHECK_EQUAL(message, "{\"result\":[1,2,3]}");
+    BOOST_CHECK_EQUAL(headers["connection"], "keep-alive");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
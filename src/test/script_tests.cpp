@@ -439,4 +439,58 @@ BOOST_AUTO_TEST_CASE(script_combineSigs)
     BOOST_CHECK(combined == partial3c);
 }
 
+BOOST_AUTO_TEST_CASE(script_moves_keep_allocation)
+{
+    BOOST_CHECK(std::is_nothrow_move_constructible<CScript>::value);
+    BOOST_CHECK(std::is_nothrow_move_constructible<CTxIn>::value);
+    BOOST_CHECK(std::is_nothrow_move_constructible<CTxOut>::value);
+
+    // Longer than the inline buffer of the prevector, like a scriptSig:
+    CScript script;
+    script << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+    const CScript copy = script;
+    const unsigned char* data = script.data();
+
+    CTxIn txin(COutPoint(), std::move(script));
+
+    BOOST_CHECK(txin.scriptSig == copy);
+    BOOST_CHECK(txin.scriptSig.data() == data);
+}
+
+BOOST_AUTO_TEST_CASE(script_GetOp_span_matches_copy)
+{
+    // Direct pushes and each of the OP_PUSHDATA forms:
+    CScript script;
+    script << OP_DUP << std::vector<unsigned char>(20, 0x14) << OP_0
+        << std::vector<unsigned char>(80, 0x50)
+        << std::vector<unsigned char>(300, 0x2c) << OP_CHECKSIG;
+    for (const unsigned char byte : { (int)OP_PUSHDATA4, 2, 0, 0, 0, 0xab, 0xab })
+        script.push_back(byte);
+
+    CScript::const_iterator pc = script.begin();
+    CScript::const_iterator pcSpan = script.begin();
+    opcodetype opcode, opcodeSpan;
+    std::vector<unsigned char> vch;
+    Span<const unsigned char> span;
+    int nOps = 0;
+
+    while (script.GetOp(pc, opcode, vch)) {
+        BOOST_CHECK(script.GetOp(pcSpan, opcodeSpan, span));
+        BOOST_CHECK(pc == pcSpan);
+        BOOST_CHECK_EQUAL(opcode, opcodeSpan);
+        BOOST_CHECK(vch == std::vector<unsigned char>(span.begin(), span.end()));
+        ++nOps;
+    }
+
+    BOOST_CHECK_EQUAL(nOps, 7);
+    BOOST_CHECK(!script.GetOp(pcSpan, opcodeSpan, span));
+
+    // A push that runs past the end of the script fails:
+    CScript truncated;
+    truncated.push_back(5);
+    truncated.push_back(0x01);
+    CScript::const_iterator pcTruncated = truncated.begin();
+    BOOST_CHECK(!truncated.GetOp(pcTruncated, opcodeSpan, span));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
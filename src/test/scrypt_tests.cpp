@@ -0,0 +1,71 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "main.h"
+#include "scrypt.h"
+#include "uint256.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+namespace {
+std::vector<CBlockHeader> MakeHeaders(const size_t count, const int version)
+{
+    std::vector<CBlockHeader> headers(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        headers[i].nVersion = version;
+        headers[i].nTime = 1413033777 + i;
+        headers[i].nBits = 0x1e0fffff;
+        headers[i].nNonce = i * 7919;
+    }
+
+    return headers;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(scrypt_tests)
+
+BOOST_AUTO_TEST_CASE(it_hashes_batches_like_scrypt_blockhash)
+{
+    const std::vector<CBlockHeader> headers = MakeHeaders(2 * SCRYPT_BATCH_LANES + 1, 1);
+
+    // Covers empty, partial, and several full batches:
+    for (size_t count = 0; count <= headers.size(); ++count) {
+        std::vector<const void*> inputs;
+        std::vector<uint256> outputs(count);
+
+        for (size_t i = 0; i < count; ++i) {
+            inputs.push_back(&headers[i].nVersion);
+        }
+
+        scrypt_blockhash_batch(inputs.data(), outputs.data(), count);
+
+        for (size_t i = 0; i < count; ++i) {
+            BOOST_CHECK_EQUAL(outputs[i].GetHex(), headers[i].GetPoWHash().GetHex());
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_caches_the_hashes_of_a_batch_of_headers)
+{
+    std::vector<CBlockHeader> headers = MakeHeaders(3, 1);
+    std::vector<CBlockHeader> v7_headers = MakeHeaders(2, 7);
+    headers.insert(headers.end(), v7_headers.begin(), v7_headers.end());
+
+    std::vector<CBlockHeader*> batch;
+
+    for (auto& header : headers) {
+        batch.push_back(&header);
+    }
+
+    CBlockHeader::CacheHashes(batch);
+
+    for (const auto& header : headers) {
+        BOOST_CHECK_EQUAL(header.GetHash(true).GetHex(), header.GetHash().GetHex());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -267,6 +267,46 @@ BOOST_AUTO_TEST_CASE(vector_bool)
     BOOST_CHECK(SerializeHash(vec1) == SerializeHash(vec2));
 }
 
+BOOST_AUTO_TEST_CASE(vector_bulk_serializable)
+{
+    BOOST_CHECK(is_bulk_serializable<unsigned char>::value);
+    BOOST_CHECK(is_bulk_serializable<uint256>::value);
+    BOOST_CHECK(is_bulk_serializable<uint160>::value);
+    BOOST_CHECK(!is_bulk_serializable<uint32_t>::value);
+    BOOST_CHECK(!is_bulk_serializable<std::string>::value);
+
+    std::vector<uint256> hashes;
+    std::vector<CDiskTxPos> positions;
+
+    for (unsigned int i = 0; i < 100; ++i) {
+        hashes.push_back(GetRandHash());
+        positions.emplace_back(i, i * 1000, i * 1000 + 81);
+    }
+
+    // The bulk path writes the same bytes as the elements one by one:
+    CDataStream expected(SER_DISK, CLIENT_VERSION);
+    WriteCompactSize(expected, hashes.size());
+    for (const auto& hash : hashes) {
+        expected << hash;
+    }
+    WriteCompactSize(expected, positions.size());
+    for (const auto& pos : positions) {
+        expected << pos;
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << hashes << positions;
+    BOOST_CHECK(ss.str() == expected.str());
+
+    std::vector<uint256> hashes_out;
+    std::vector<CDiskTxPos> positions_out;
+    ss >> hashes_out >> positions_out;
+
+    BOOST_CHECK(hashes_out == hashes);
+    BOOST_CHECK(positions_out == positions);
+    BOOST_CHECK(ss.empty());
+}
+
 BOOST_AUTO_TEST_CASE(noncanonical)
 {
     // Write some non-canonical CompactSize encodings, and
@@ -352,6 +392,100 @@ BOOST_AUTO_TEST_CASE(insert_delete)
     BOOST_CHECK_EQUAL(ss.size(), 0U);
 }
 
+BOOST_AUTO_TEST_CASE(stream_buffer_pool)
+{
+    const char* buffer;
+
+    {
+        CDataStream ss(SER_DISK, 0);
+        ss.SetSecret(false);
+        ss << std::string("pooled");
+        buffer = ss.data();
+    }
+
+    const CStreamBufferPool::Stats before = CStreamBufferPool::GetStats();
+
+    {
+        // The next stream of the thread reuses the buffer:
+        CDataStream ss(SER_DISK, 0);
+        BOOST_CHECK(ss.empty());
+        BOOST_CHECK(ss.data() == buffer);
+        BOOST_CHECK(ss.capacity() >= CStreamBufferPool::MIN_BUFFER_SIZE);
+
+        ss << std::string("secret");
+    }
+
+    const CStreamBufferPool::Stats after = CStreamBufferPool::GetStats();
+
+    BOOST_CHECK_EQUAL(after.hits, before.hits + 1);
+    BOOST_CHECK_EQUAL(after.misses, before.misses);
+    BOOST_CHECK_EQUAL(after.bytes, before.bytes);
+
+    // Reserving in an empty stream trades for a buffer of the size class:
+    {
+        CDataStream ss(SER_DISK, 0);
+        ss.reserve(5000);
+        BOOST_CHECK(ss.capacity() >= 8192);
+    }
+
+    // Buffers beyond the largest class stay out of the pool:
+    CSerializeData large;
+    large.reserve(CStreamBufferPool::MAX_BUFFER_SIZE + 1);
+    CStreamBufferPool::Give(large, true);
+    BOOST_CHECK(large.capacity() > CStreamBufferPool::MAX_BUFFER_SIZE);
+
+    CSerializeData small;
+    CStreamBufferPool::Take(small, 100);
+    BOOST_CHECK(small.empty());
+    BOOST_CHECK(small.capacity() >= 100);
+}
+
+BOOST_AUTO_TEST_CASE(block_from_message_buffer)
+{
+    CBlock block;
+    block.nVersion = 11;
+    block.nTime = 1600000000;
+    block.vtx.resize(2);
+    block.vtx[0].nLockTime = 1;
+    block.vtx[1].nLockTime = 2;
+    block.vchBlockSig = { 0x01, 0x02, 0x03 };
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << block << std::string("trailing");
+
+    const size_t block_size = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    auto buffer = std::make_shared<const CSerializeData>(ss.begin(), ss.end());
+
+    CBlock received;
+    const Span<const unsigned char> rest = received.ReadFromBuffer(buffer, SER_NETWORK, PROTOCOL_VERSION);
+
+    BOOST_CHECK_EQUAL(received.GetHash().GetHex(), block.GetHash().GetHex());
+    BOOST_CHECK_EQUAL(received.vtx.size(), 2U);
+    BOOST_CHECK(received.vchBlockSig == block.vchBlockSig);
+    BOOST_CHECK(received.m_raw_data == buffer);
+    BOOST_CHECK_EQUAL(received.m_raw_size, block_size);
+    BOOST_CHECK_EQUAL(rest.size(), (std::ptrdiff_t)(buffer->size() - block_size));
+
+    std::string trailing;
+    SpanReader(SER_NETWORK, PROTOCOL_VERSION, rest) >> trailing;
+    BOOST_CHECK_EQUAL(trailing, "trailing");
+
+    // Copies share the buffer. Reading or clearing a block releases it:
+    CBlock copy = received;
+    BOOST_CHECK(copy.m_raw_data == buffer);
+    copy.SetNull();
+    BOOST_CHECK(!copy.m_raw_data);
+
+    // A truncated message fails like a stream:
+    CBlock truncated;
+    BOOST_CHECK_THROW(
+        truncated.ReadFromSpan(
+            Span<const unsigned char>(reinterpret_cast<const unsigned char*>(buffer->data()), block_size - 1),
+            SER_NETWORK,
+            PROTOCOL_VERSION),
+        std::ios_base::failure);
+}
+
 BOOST_AUTO_TEST_CASE(class_methods)
 {
     int intval(100);
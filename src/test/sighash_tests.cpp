@@ -0,0 +1,141 @@
+#include <boost/test/unit_test.hpp>
+
+#include "main.h"
+#include "script.h"
+#include "streams.h"
+#include "util.h"
+
+#include <vector>
+
+extern uint256 SignatureHash(CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType);
+
+namespace {
+// The legacy signature hash as computed before SignatureHash() streamed the
+// modified transaction: copy the transaction, blank and trim the copy, and
+// hash its serialization.
+uint256 SignatureHashOld(CScript scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType)
+{
+    static const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
+
+    if (nIn >= txTo.vin.size())
+        return one;
+
+    CTransaction txTmp(txTo);
+
+    scriptCode.FindAndDelete(CScript(OP_CODESEPARATOR));
+
+    for (unsigned int i = 0; i < txTmp.vin.size(); i++)
+        txTmp.vin[i].scriptSig = CScript();
+    txTmp.vin[nIn].scriptSig = scriptCode;
+
+    if ((nHashType & 0x1f) == SIGHASH_NONE)
+    {
+        txTmp.vout.clear();
+
+        for (unsigned int i = 0; i < txTmp.vin.size(); i++)
+            if (i != nIn)
+                txTmp.vin[i].nSequence = 0;
+    }
+    else if ((nHashType & 0x1f) == SIGHASH_SINGLE)
+    {
+        unsigned int nOut = nIn;
+        if (nOut >= txTmp.vout.size())
+            return one;
+
+        txTmp.vout.resize(nOut+1);
+        for (unsigned int i = 0; i < nOut; i++)
+            txTmp.vout[i].SetNull();
+
+        for (unsigned int i = 0; i < txTmp.vin.size(); i++)
+            if (i != nIn)
+                txTmp.vin[i].nSequence = 0;
+    }
+
+    if (nHashType & SIGHASH_ANYONECANPAY)
+    {
+        txTmp.vin[0] = txTmp.vin[nIn];
+        txTmp.vin.resize(1);
+    }
+
+    CDataStream ss(SER_GETHASH, 0);
+    ss << txTmp << nHashType;
+    return Hash(ss.begin(), ss.end());
+}
+
+CScript RandomScript()
+{
+    static const opcodetype oplist[] = {
+        OP_FALSE, OP_1, OP_2, OP_3, OP_CHECKSIG, OP_IF, OP_VERIF, OP_RETURN, OP_CODESEPARATOR
+    };
+
+    CScript script;
+    const int ops = GetRandInt(10);
+    for (int i = 0; i < ops; i++)
+        script << oplist[GetRandInt(sizeof(oplist) / sizeof(oplist[0]))];
+
+    return script;
+}
+
+CTransaction RandomTransaction(bool fSingle)
+{
+    CTransaction tx;
+    tx.nVersion = 1 + GetRandInt(2);
+    tx.nTime = GetRand(std::numeric_limits<uint32_t>::max());
+    tx.nLockTime = GetRandInt(2) ? GetRand(std::numeric_limits<uint32_t>::max()) : 0;
+
+    if (tx.nVersion == 1)
+        tx.hashBoinc = GetRandInt(2) ? "<MESSAGE>legacy</MESSAGE>" : "";
+
+    const int ins = 1 + GetRandInt(4);
+    const int outs = fSingle ? ins : 1 + GetRandInt(4);
+
+    for (int in = 0; in < ins; in++) {
+        CTxIn txin;
+        txin.prevout.hash = GetRandHash();
+        txin.prevout.n = GetRandInt(4);
+        txin.scriptSig = RandomScript();
+        txin.nSequence = GetRandInt(2) ? GetRand(std::numeric_limits<uint32_t>::max()) : (unsigned int)-1;
+        tx.vin.push_back(txin);
+    }
+
+    for (int out = 0; out < outs; out++) {
+        CTxOut txout;
+        txout.nValue = GetRand(100000000);
+        txout.scriptPubKey = RandomScript();
+        tx.vout.push_back(txout);
+    }
+
+    return tx;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(sighash_tests)
+
+BOOST_AUTO_TEST_CASE(sighash_matches_copying_implementation)
+{
+    for (int i = 0; i < 5000; i++) {
+        const int nHashType = GetRand(std::numeric_limits<uint32_t>::max());
+        const CTransaction txTo = RandomTransaction((nHashType & 0x1f) == SIGHASH_SINGLE);
+        const CScript scriptCode = RandomScript();
+        const unsigned int nIn = GetRandInt(txTo.vin.size());
+
+        BOOST_CHECK(SignatureHash(scriptCode, txTo, nIn, nHashType)
+            == SignatureHashOld(scriptCode, txTo, nIn, nHashType));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(sighash_out_of_range_returns_one)
+{
+    const uint256 one(uint256S("0000000000000000000000000000000000000000000000000000000000000001"));
+
+    CTransaction txTo = RandomTransaction(false);
+    txTo.vout.resize(1);
+
+    BOOST_CHECK(SignatureHash(CScript(), txTo, txTo.vin.size(), SIGHASH_ALL) == one);
+
+    txTo.vin.resize(2);
+    BOOST_CHECK(SignatureHash(CScript(), txTo, 1, SIGHASH_SINGLE) == one);
+    BOOST_CHECK(SignatureHash(CScript(), txTo, 0, SIGHASH_SINGLE) != one);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "sync.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+namespace {
+const CLockSiteStats::Snapshot* FindSite(const std::vector<CLockSiteStats::Snapshot>& sites, const std::string& name)
+{
+    for (const auto& site : sites) {
+        if (site.strName == name) {
+            return &site;
+        }
+    }
+
+    return nullptr;
+}
+} // anonymous namespace
+
+BOOST_AUTO_TEST_SUITE(sync_tests)
+
+BOOST_AUTO_TEST_CASE(it_profiles_lock_sites_only_when_enabled)
+{
+    CCriticalSection cs_profiled;
+
+    g_lock_profile = false;
+    {
+        LOCK(cs_profiled);
+    }
+    BOOST_CHECK(FindSite(GetLockProfile(), "cs_profiled") == nullptr);
+
+    g_lock_profile = true;
+    {
+        LOCK(cs_profiled);
+
+        // A recursive mutex lets the same thread in, so try from another:
+        std::thread([&] {
+            TRY_LOCK(cs_profiled, lockProfiled);
+            BOOST_CHECK(!lockProfiled);
+        }).join();
+    }
+    g_lock_profile = false;
+
+    const std::vector<CLockSiteStats::Snapshot> sites = GetLockProfile();
+    size_t nLocks = 0;
+    size_t nTryFailures = 0;
+
+    for (const auto& site : sites) {
+        if (site.strName == "cs_profiled") {
+            BOOST_CHECK(site.nLine > 0);
+            nLocks += site.nLocks;
+            nTryFailures += site.nTryFailures;
+        }
+    }
+
+    BOOST_CHECK_EQUAL(nLocks, 1);
+    BOOST_CHECK_EQUAL(nTryFailures, 1);
+
+    ResetLockProfile();
+
+    const CLockSiteStats::Snapshot* site = FindSite(GetLockProfile(), "cs_profiled");
+
+    BOOST_REQUIRE(site != nullptr);
+    BOOST_CHECK_EQUAL(site->nLocks, 0);
+    BOOST_CHECK_EQUAL(site->nTryFailures, 0);
+}
+
+BOOST_AUTO_TEST_CASE(it_records_waits_and_holds)
+{
+    CLockSiteStats stats("cs_test", "test.cpp", 1);
+
+    stats.RecordLock();
+    stats.RecordWait(5);
+    stats.RecordWait(3);
+    stats.RecordHold(7);
+
+    const CLockSiteStats::Snapshot snapshot = stats.GetSnapshot();
+
+    BOOST_CHECK_EQUAL(snapshot.nLocks, 1);
+    BOOST_CHECK_EQUAL(snapshot.nContended, 2);
+    BOOST_CHECK_EQUAL(snapshot.nWaitUsec, 8);
+    BOOST_CHECK_EQUAL(snapshot.nMaxWaitUsec, 5);
+    BOOST_CHECK_EQUAL(snapshot.nHoldUsec, 7);
+    BOOST_CHECK_EQUAL(snapshot.nMaxHoldUsec, 7);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
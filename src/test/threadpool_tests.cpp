@@ -0,0 +1,91 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/threadpool.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(threadpool_tests)
+
+BOOST_AUTO_TEST_CASE(it_delivers_task_results_through_futures)
+{
+    util::ThreadPool pool("test", 3);
+
+    std::vector<std::future<int>> results;
+
+    for (int i = 0; i < 100; ++i) {
+        results.emplace_back(pool.Submit([i]() { return i * 2; }));
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        BOOST_CHECK_EQUAL(results[i].get(), i * 2);
+    }
+
+    std::future<void> failure = pool.Submit([]() { throw std::runtime_error("task"); });
+    BOOST_CHECK_THROW(failure.get(), std::runtime_error);
+
+    const util::ThreadPool::Stats stats = pool.GetStats();
+
+    BOOST_CHECK_EQUAL(stats.name, "test");
+    BOOST_CHECK_EQUAL(stats.threads, 3);
+}
+
+BOOST_AUTO_TEST_CASE(it_breaks_the_futures_of_tasks_submitted_after_stop)
+{
+    util::ThreadPool pool("test", 1);
+    pool.Stop();
+
+    BOOST_CHECK(!pool.IsRunning());
+
+    std::future<int> result = pool.Submit([]() { return 1; });
+    BOOST_CHECK_THROW(result.get(), std::future_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_runs_each_parallel_index_once)
+{
+    std::vector<std::atomic<int>> runs(1000);
+
+    for (auto& count : runs) {
+        count = 0;
+    }
+
+    util::ParallelFor(util::Executor::BACKGROUND, runs.size(), [&](size_t i) { ++runs[i]; });
+
+    for (const auto& count : runs) {
+        BOOST_CHECK_EQUAL(count, 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(it_nests_parallel_loops_without_deadlock)
+{
+    std::atomic<size_t> total(0);
+
+    // Every outer task occupies a worker while it waits for its inner loop:
+    util::ParallelFor(util::Executor::BACKGROUND, 16, [&](size_t) {
+        util::ParallelFor(util::Executor::BACKGROUND, 16, [&](size_t) { ++total; });
+    });
+
+    BOOST_CHECK_EQUAL(total, 16 * 16);
+}
+
+BOOST_AUTO_TEST_CASE(it_rethrows_the_exception_of_a_parallel_task)
+{
+    std::atomic<size_t> finished(0);
+
+    BOOST_CHECK_THROW(
+        util::ParallelFor(util::Executor::BACKGROUND, 10, [&](size_t i) {
+            if (i == 5) throw std::runtime_error("task");
+            ++finished;
+        }),
+        std::runtime_error);
+
+    // The other indices still ran before the exception propagated:
+    BOOST_CHECK_EQUAL(finished, 9);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
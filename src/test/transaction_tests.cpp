@@ -268,5 +268,69 @@ BOOST_AUTO_TEST_CASE(test_GetThrow)
     BOOST_CHECK_THROW(t1.GetValueIn(missingInputs), runtime_error);
 }
 
+BOOST_AUTO_TEST_CASE(transaction_hash_cache)
+{
+    CTransaction tx;
+    tx.nLockTime = 1;
+
+    const uint256 hash = tx.GetHash();
+    BOOST_CHECK(tx.GetHash(true) == hash);
+
+    // The cache only serves callers that ask for it:
+    tx.nLockTime = 2;
+    BOOST_CHECK(tx.GetHash(true) == hash);
+    BOOST_CHECK(tx.GetHash() != hash);
+
+    // Deserialization replaces the cached hash:
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    CTransaction other;
+    other.nLockTime = 3;
+    ss << other;
+    ss >> tx;
+    BOOST_CHECK(tx.GetHash(true) == other.GetHash());
+
+    tx.SetNull();
+    BOOST_CHECK(tx.GetHash(true) == tx.GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(txindex_round_trips_in_the_compact_encoding)
+{
+    CTxIndex txindex(CDiskTxPos(3, 1000000, 1000250), 20);
+    txindex.vSpent[0] = CDiskTxPos(3, 2000000, 2000081);
+    txindex.vSpent[9] = CDiskTxPos(1, 1, 1);
+    txindex.vSpent[19] = CDiskTxPos(4, 500, 100);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << txindex;
+
+    // Version, position, count, bitmap and the three spent positions:
+    BOOST_CHECK_EQUAL(ss.size(), 4 + 6 + 1 + 3 + 5 + 3 + 8);
+
+    CTxIndex decoded;
+    ss >> decoded;
+    BOOST_CHECK(decoded == txindex);
+    BOOST_CHECK(ss.empty());
+
+    // A memory pool position and an entry without outputs:
+    CTxIndex mempool_txindex(CDiskTxPos(1, 1, 1), 0);
+    ss << mempool_txindex;
+    ss >> decoded;
+    BOOST_CHECK(decoded == mempool_txindex);
+}
+
+BOOST_AUTO_TEST_CASE(txindex_reads_the_legacy_encoding)
+{
+    CTxIndex txindex(CDiskTxPos(2, 4096, 4200), 3);
+    txindex.vSpent[1] = CDiskTxPos(2, 8192, 8300);
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (int)CLIENT_VERSION << txindex.pos << txindex.vSpent;
+
+    CTxIndex decoded;
+    ss >> decoded;
+    BOOST_CHECK(decoded == txindex);
+    BOOST_CHECK(ss.empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 #endif
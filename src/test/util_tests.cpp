@@ -83,6 +83,12 @@ BOOST_AUTO_TEST_CASE(util_ParseHex)
     // Stop parsing at invalid value
     result = ParseHex("1234 invalid 1234");
     BOOST_CHECK(result.size() == 2 && result[0] == 0x12 && result[1] == 0x34);
+
+    // Separators and invalid values within runs of sixteen digits
+    result = ParseHex("04678afdb0fe5548 271967f1a67130b7105cd6a828e03909a679");
+    BOOST_CHECK_EQUAL(HexStr(result), "04678afdb0fe5548271967f1a67130b7105cd6a828e03909a679");
+    result = ParseHex("04678afdb0fe5548271967f1a6713Xb7105cd6a828e03909");
+    BOOST_CHECK_EQUAL(HexStr(result), "04678afdb0fe5548271967f1a671");
 }
 
 BOOST_AUTO_TEST_CASE(util_HexStr)
@@ -229,6 +229,16 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
         BOOST_CHECK_EQUAL(nValueRet, 500000 * COIN); // we should get the exact amount
         BOOST_CHECK_EQUAL(setCoinsRet.size(), 10); // in ten coins
 
+        // the subset search finds an exact match that needs the smallest coin
+        empty_wallet();
+        add_coin(7 * CENT);
+        for (int i = 0; i < 20; i++)
+            add_coin(3 * CENT);
+
+        BOOST_CHECK( wallet.SelectCoinsMinConf(16 * CENT, spendTime, 1, 1, vCoins, setCoinsRet, nValueRet));
+        BOOST_CHECK_EQUAL(nValueRet, 16 * CENT); // we should get the exact amount
+        BOOST_CHECK_EQUAL(setCoinsRet.size(), 4); // in 7+3+3+3
+
         // if there's not enough in the smaller coins to make at least 1 cent change (0.5+0.6+0.7 < 1.0+1.0),
         // we need to try finding an exact subset anyway
 
@@ -274,8 +284,8 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
             for (int i2 = 0; i2 < 100; i2++)
                 add_coin(COIN);
 
-            // picking 50 from 100 coins doesn't depend on the shuffle,
-            // but does depend on randomness in the stochastic approximation code
+            // picking 50 from 100 identical coins depends on the shuffle
+            // because the subset search keeps the shuffled order of equal coins
             BOOST_CHECK(wallet.SelectCoinsMinConf(50 * COIN, spendTime, 1, 6, vCoins, setCoinsRet , nValueRet));
             BOOST_CHECK(wallet.SelectCoinsMinConf(50 * COIN, spendTime, 1, 6, vCoins, setCoinsRet2, nValueRet));
             BOOST_CHECK(!equal_sets(setCoinsRet, setCoinsRet2));
@@ -312,4 +322,111 @@ BOOST_AUTO_TEST_CASE(coin_selection_tests)
     }
 }
 
+BOOST_AUTO_TEST_CASE(it_groups_addresses_spent_together_with_their_change)
+{
+    CWallet groupings_wallet;
+    std::vector<CTxDestination> addresses;
+
+    {
+        LOCK(groupings_wallet.cs_wallet);
+
+        for (int i = 0; i < 4; i++) {
+            CKey key;
+            key.MakeNewKey(true);
+            BOOST_CHECK(groupings_wallet.AddKey(key));
+            addresses.push_back(key.GetPubKey().GetID());
+        }
+    }
+
+    const auto add_tx = [&](const std::vector<COutPoint>& inputs, const std::vector<CTxDestination>& outputs) {
+        CTransaction tx;
+        tx.nTime = addresses.size() + groupings_wallet.mapWallet.size();
+
+        for (const auto& prevout : inputs) {
+            tx.vin.push_back(CTxIn(prevout));
+        }
+
+        for (const auto& dest : outputs) {
+            CScript script;
+            script.SetDestination(dest);
+            tx.vout.push_back(CTxOut(1 * COIN, script));
+        }
+
+        const uint256 hash = tx.GetHash();
+        groupings_wallet.mapWallet.emplace(hash, CWalletTx(&groupings_wallet, tx));
+
+        return hash;
+    };
+
+    LOCK(groupings_wallet.cs_wallet);
+
+    const uint256 a = add_tx({COutPoint(uint256(), 0)}, {addresses[0]});
+    const uint256 b = add_tx({COutPoint(uint256(), 1)}, {addresses[1]});
+    add_tx({COutPoint(uint256(), 2)}, {addresses[2]});
+
+    // Each address received on its own:
+    BOOST_CHECK_EQUAL(groupings_wallet.GetAddressGroupings().size(), 3);
+
+    // Spending the first two outputs together links them with the change:
+    add_tx({COutPoint(a, 0), COutPoint(b, 0)}, {addresses[3]});
+    groupings_wallet.MarkGroupingsDirty();
+
+    const std::set<std::set<CTxDestination>> groupings = groupings_wallet.GetAddressGroupings();
+
+    BOOST_CHECK_EQUAL(groupings.size(), 2);
+    BOOST_CHECK(groupings.count({addresses[0], addresses[1], addresses[3]}) == 1);
+    BOOST_CHECK(groupings.count({addresses[2]}) == 1);
+
+    // The change stops counting as change when it enters the address book:
+    groupings_wallet.mapAddressBook[addresses[3]] = "label";
+    groupings_wallet.MarkGroupingsDirty();
+
+    BOOST_CHECK(groupings_wallet.GetAddressGroupings().count({addresses[3]}) == 1);
+}
+
+BOOST_AUTO_TEST_CASE(it_recomputes_cached_amounts_when_the_address_book_changes)
+{
+    CWallet amounts_wallet;
+    CKey key;
+    key.MakeNewKey(true);
+
+    {
+        LOCK(amounts_wallet.cs_wallet);
+        BOOST_CHECK(amounts_wallet.AddKey(key));
+    }
+
+    CScript script;
+    script.SetDestination(key.GetPubKey().GetID());
+
+    CTransaction tx;
+    tx.vin.push_back(CTxIn(COutPoint(uint256(), 0)));
+    tx.vout.push_back(CTxOut(1 * COIN, script));
+
+    CWalletTx wtx(&amounts_wallet, tx);
+
+    // Fake a debit so that the transaction counts as sent by the wallet:
+    wtx.fDebitCached = true;
+    wtx.nDebitCached = 2 * COIN;
+
+    std::list<COutputEntry> listReceived;
+    std::list<COutputEntry> listSent;
+    int64_t nFee;
+    std::string strSentAccount;
+
+    // An output that pays an unlabeled address of the wallet is change:
+    wtx.GetAmounts(listReceived, listSent, nFee, strSentAccount);
+
+    BOOST_CHECK(listReceived.empty());
+    BOOST_CHECK(listSent.empty());
+    BOOST_CHECK_EQUAL(nFee, 1 * COIN);
+
+    // With a label, the output becomes a payment to self:
+    amounts_wallet.SetAddressBookName(key.GetPubKey().GetID(), "label");
+    wtx.GetAmounts(listReceived, listSent, nFee, strSentAccount);
+
+    BOOST_CHECK_EQUAL(listReceived.size(), 1);
+    BOOST_CHECK_EQUAL(listSent.size(), 1);
+    BOOST_CHECK_EQUAL(listSent.front().amount, 1 * COIN);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,21 +3,34 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file license.txt or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include "config/gridcoin-config.h"
+#endif
+
+#include <cstring>
 #include <map>
+#include <memory>
 
 #include <boost/version.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
 #include <leveldb/env.h>
 #include <leveldb/cache.h>
 #include <leveldb/filter_policy.h>
 #include <leveldb/helpers/memenv/memenv.h>
 
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 #include "gridcoin/staking/kernel.h"
 #include "txdb.h"
 #include "main.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "util/perf.h"
+#include "util/threadpool.h"
 
 using namespace std;
 using namespace boost;
@@ -26,12 +39,125 @@ extern bool fQtActive;
 
 leveldb::DB *txdb; // global pointer for LevelDB object instance
 
+namespace {
+//!
+//! \brief Get the amount of physical memory installed in the machine.
+//!
+//! \return Size in bytes, or zero when the platform does not report it.
+//!
+uint64_t GetTotalPhysicalMemory()
+{
+#ifdef WIN32
+    MEMORYSTATUSEX status;
+    status.dwLength = sizeof(status);
+
+    if (GlobalMemoryStatusEx(&status)) {
+        return status.ullTotalPhys;
+    }
+#elif defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+    const long pages = sysconf(_SC_PHYS_PAGES);
+    const long page_size = sysconf(_SC_PAGESIZE);
+
+    if (pages > 0 && page_size > 0) {
+        return static_cast<uint64_t>(pages) * static_cast<uint64_t>(page_size);
+    }
+#endif
+
+    return 0;
+}
+
+//!
+//! \brief Sizes the LevelDB settings from the configuration and the memory
+//! of the machine.
+//!
+struct StorageProfile
+{
+    int64_t nCacheSizeMB;       //!< Size of the LRU block cache.
+    int64_t nWriteBufferSizeMB; //!< Size of the memtable.
+    int64_t nMaxOpenFiles;      //!< Table files held open by LevelDB.
+    bool fCompression;          //!< Compress table blocks with snappy.
+    bool fBulkLoad;             //!< Importing blocks from a file at startup.
+
+    StorageProfile()
+    {
+        // Without -dbcache, use 1/64 of the physical memory of the machine
+        // within the bounds below. A 16 GB machine gets a 256 MB cache.
+        //
+        const int64_t nMemoryMB = GetTotalPhysicalMemory() >> 20;
+        const int64_t nAutoCacheMB = std::max<int64_t>(
+            DEFAULT_CACHE_MB,
+            std::min<int64_t>(nMemoryMB / 64, MAX_AUTO_CACHE_MB));
+
+        nCacheSizeMB = std::max<int64_t>(1, GetArg("-dbcache", nAutoCacheMB));
+
+        // Importing blocks with -loadblock or from bootstrap.dat writes the
+        // index in bulk. A larger memtable reduces the number of compactions
+        // that the import triggers.
+        //
+        fBulkLoad = mapArgs.count("-loadblock")
+            || filesystem::exists(GetDataDir() / "bootstrap.dat");
+
+        int64_t nAutoWriteBufferMB = std::max<int64_t>(
+            DEFAULT_WRITE_BUFFER_MB,
+            std::min<int64_t>(nCacheSizeMB / 8, MAX_AUTO_WRITE_BUFFER_MB));
+
+        if (fBulkLoad) {
+            nAutoWriteBufferMB *= BULK_LOAD_WRITE_BUFFER_FACTOR;
+        }
+
+        nWriteBufferSizeMB = std::max<int64_t>(1, GetArg("-dbwritebuffer", nAutoWriteBufferMB));
+        nMaxOpenFiles = std::max<int64_t>(64, GetArg("-dbmaxopenfiles", DEFAULT_MAX_OPEN_FILES));
+        fCompression = GetBoolArg("-dbcompression", true);
+    }
+
+    leveldb::Options GetOptions() const
+    {
+        leveldb::Options options;
+        options.block_cache = leveldb::NewLRUCache(nCacheSizeMB * 1048576);
+        options.write_buffer_size = nWriteBufferSizeMB * 1048576;
+        options.max_open_files = nMaxOpenFiles;
+        options.compression = fCompression
+            ? leveldb::kSnappyCompression
+            : leveldb::kNoCompression;
+        options.filter_policy = leveldb::NewBloomFilterPolicy(10);
+
+        return options;
+    }
+
+    static constexpr int64_t DEFAULT_CACHE_MB = 25;
+    static constexpr int64_t MAX_AUTO_CACHE_MB = 512;
+    static constexpr int64_t DEFAULT_WRITE_BUFFER_MB = 4;
+    static constexpr int64_t MAX_AUTO_WRITE_BUFFER_MB = 64;
+    static constexpr int64_t BULK_LOAD_WRITE_BUFFER_FACTOR = 4;
+    static constexpr int64_t DEFAULT_MAX_OPEN_FILES = 1000;
+};
+
+constexpr int64_t StorageProfile::DEFAULT_CACHE_MB; // for clang
+constexpr int64_t StorageProfile::MAX_AUTO_CACHE_MB; // for clang
+constexpr int64_t StorageProfile::DEFAULT_WRITE_BUFFER_MB; // for clang
+constexpr int64_t StorageProfile::MAX_AUTO_WRITE_BUFFER_MB; // for clang
+constexpr int64_t StorageProfile::BULK_LOAD_WRITE_BUFFER_FACTOR; // for clang
+constexpr int64_t StorageProfile::DEFAULT_MAX_OPEN_FILES; // for clang
+} // anonymous namespace
+
 static leveldb::Options GetOptions() {
-    leveldb::Options options;
-    int nCacheSizeMB = GetArg("-dbcache", 25);
-    options.block_cache = leveldb::NewLRUCache(nCacheSizeMB * 1048576);
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    return options;
+    const StorageProfile profile;
+
+#ifdef USE_SNAPPY
+    const char* compression = profile.fCompression ? "snappy" : "none";
+#else
+    // LevelDB stores the tables uncompressed when built without libsnappy:
+    const char* compression = "none";
+#endif
+
+    LogPrintf("LevelDB storage profile: cache=%dMB write_buffer=%dMB max_open_files=%d compression=%s%s",
+        profile.nCacheSizeMB,
+        profile.nWriteBufferSizeMB,
+        profile.nMaxOpenFiles,
+        compression,
+        profile.fBulkLoad ? " (bulk load)" : "");
+
+    return profile.GetOptions();
 }
 
 void init_blockindex(leveldb::Options& options, bool fRemoveOld = false) {
@@ -81,7 +207,6 @@ CTxDB::CTxDB(const char* pszMode)
 
     options = GetOptions();
     options.create_if_missing = fCreate;
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
 
     init_blockindex(options); // Init directory
     pdb = txdb;
@@ -91,7 +216,22 @@ CTxDB::CTxDB(const char* pszMode)
         ReadVersion(nVersion);
         LogPrintf("Transaction index version is %d", nVersion);
 
-        if (nVersion < DATABASE_VERSION)
+        if (nVersion >= TXINDEX_LEGACY_DATABASE_VERSION && nVersion < DATABASE_VERSION)
+        {
+            LogPrintf("Required index version is %d, converting transaction index", DATABASE_VERSION);
+
+            bool fTmp = fReadOnly;
+            fReadOnly = false;
+
+            if (MigrateTxIndexes()) {
+                WriteVersion(DATABASE_VERSION);
+            } else {
+                LogPrintf("Failed to convert transaction index. Will retry at next start.");
+            }
+
+            fReadOnly = fTmp;
+        }
+        else if (nVersion < DATABASE_VERSION)
         {
             LogPrintf("Required index version is %d, removing old database", DATABASE_VERSION);
 
@@ -100,6 +240,7 @@ CTxDB::CTxDB(const char* pszMode)
             txdb = pdb = NULL;
             delete activeBatch;
             activeBatch = NULL;
+            mapBatchOverlay.clear();
 
             init_blockindex(options, true); // Remove directory and create new database
             pdb = txdb;
@@ -121,6 +262,69 @@ CTxDB::CTxDB(const char* pszMode)
     LogPrintf("Opened LevelDB successfully");
 }
 
+bool CTxDB::MigrateTxIndexes()
+{
+    // Commit in batches to bound the memory of the pending writes:
+    const size_t nBatchSize = 10000;
+    size_t nPending = 0;
+    uint64_t nConverted = 0;
+    bool fSuccess = true;
+
+    TxnBegin();
+
+    const bool fScanned = ScanRecords("tx", [&](CDataStream& ssKey, CDataStream& ssValue) {
+        uint256 hash;
+        CTxIndex txindex;
+
+        try {
+            ssKey >> hash;
+            ssValue >> txindex;
+        } catch (const std::exception& e) {
+            fSuccess = error("%s: failed to read entry: %s", __func__, e.what());
+            return false;
+        }
+
+        WriteRecord("tx", hash, txindex);
+        ++nConverted;
+
+        if (++nPending >= nBatchSize) {
+            if (!TxnCommit()) {
+                fSuccess = false;
+                return false;
+            }
+
+            TxnBegin();
+            nPending = 0;
+
+            if (nConverted % 1000000 == 0) {
+                LogPrintf("Converted %d transaction index entries", nConverted);
+            }
+        }
+
+        return true;
+    });
+
+    if (!fSuccess || !fScanned) {
+        if (activeBatch) {
+            TxnAbort();
+        }
+
+        return false;
+    }
+
+    if (!TxnCommit()) {
+        return false;
+    }
+
+    LogPrintf("Converted %d transaction index entries", nConverted);
+
+    // Reclaim the space of the legacy entries now rather than over the next
+    // compactions:
+    pdb->CompactRange(nullptr, nullptr);
+
+    return true;
+}
+
 void CTxDB::Close()
 {
     delete txdb;
@@ -131,6 +335,18 @@ void CTxDB::Close()
     options.block_cache = NULL;
     delete activeBatch;
     activeBatch = NULL;
+    mapBatchOverlay.clear();
+}
+
+uint64_t CTxDB::GetMemoryUsage() const
+{
+    std::string value;
+
+    if (!pdb || !pdb->GetProperty("leveldb.approximate-memory-usage", &value)) {
+        return 0;
+    }
+
+    return atoi64(value);
 }
 
 bool CTxDB::TxnBegin()
@@ -142,10 +358,13 @@ bool CTxDB::TxnBegin()
 
 bool CTxDB::TxnCommit()
 {
+    PERF_SCOPE("TxnCommit");
+
     assert(activeBatch);
     leveldb::Status status = pdb->Write(leveldb::WriteOptions(), activeBatch);
     delete activeBatch;
     activeBatch = NULL;
+    mapBatchOverlay.clear();
     if (!status.ok()) {
         LogPrintf("LevelDB batch commit failure: %s", status.ToString());
         return false;
@@ -153,48 +372,27 @@ bool CTxDB::TxnCommit()
     return true;
 }
 
-class CBatchScanner : public leveldb::WriteBatch::Handler {
-public:
-    std::string needle;
-    bool *deleted;
-    std::string *foundValue;
-    bool foundEntry;
-
-    CBatchScanner() : foundEntry(false) {}
-
-    virtual void Put(const leveldb::Slice& key, const leveldb::Slice& value) {
-        if (key.ToString() == needle) {
-            foundEntry = true;
-            *deleted = false;
-            *foundValue = value.ToString();
-        }
-    }
-
-    virtual void Delete(const leveldb::Slice& key) {
-        if (key.ToString() == needle) {
-            foundEntry = true;
-            *deleted = true;
-        }
-    }
-};
-
 // When performing a read, if we have an active batch we need to check it first
 // before reading from the database, as the rest of the code assumes that once
-// a database transaction begins reads are consistent with it. It would be good
-// to change that assumption in future and avoid the performance hit, though in
-// practice it does not appear to be large.
+// a database transaction begins reads are consistent with it. The overlay map
+// mirrors the batch, so this is a single hash lookup.
 bool CTxDB::ScanBatch(const CDataStream &key, string *value, bool *deleted) const {
     assert(activeBatch);
     *deleted = false;
-    CBatchScanner scanner;
-    scanner.needle = key.str();
-    scanner.deleted = deleted;
-    scanner.foundValue = value;
-    leveldb::Status status = activeBatch->Iterate(&scanner);
-    if (!status.ok()) {
-        throw runtime_error(status.ToString());
+
+    const auto iter = mapBatchOverlay.find(key.str());
+
+    if (iter == mapBatchOverlay.end()) {
+        return false;
+    }
+
+    if (iter->second) {
+        *value = *iter->second;
+    } else {
+        *deleted = true;
     }
-    return scanner.foundEntry;
+
+    return true;
 }
 
 bool CTxDB::ReadTxIndex(uint256 hash, CTxIndex& txindex)
@@ -203,6 +401,123 @@ bool CTxDB::ReadTxIndex(uint256 hash, CTxIndex& txindex)
     return Read(make_pair(string("tx"), hash), txindex);
 }
 
+bool CTxDB::ReadTxIndexes(
+    const std::vector<uint256>& hashes,
+    std::map<uint256, CTxIndex>& txindexes)
+{
+    if (activeBatch) {
+        for (const auto& hash : hashes) {
+            CTxIndex txindex;
+
+            if (ReadTxIndex(hash, txindex)) {
+                txindexes[hash] = std::move(txindex);
+            }
+        }
+
+        return true;
+    }
+
+    // LevelDB orders keys by their serialized bytes which differs from the
+    // order of uint256 values, so sort the serialized keys instead:
+    //
+    std::vector<std::pair<std::string, uint256>> keys;
+    keys.reserve(hashes.size());
+
+    for (const auto& hash : hashes) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.SetSecret(false);
+        ssKey << make_pair(string("tx"), hash);
+
+        keys.emplace_back(ssKey.str(), hash);
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    std::unique_ptr<leveldb::Iterator> iterator(pdb->NewIterator(leveldb::ReadOptions()));
+
+    for (const auto& key : keys) {
+        iterator->Seek(key.first);
+
+        if (!iterator->Valid()) {
+            break;
+        }
+
+        if (iterator->key() != key.first) {
+            continue;
+        }
+
+        try {
+            CDataStream ssValue(
+                iterator->value().data(),
+                iterator->value().data() + iterator->value().size(),
+                SER_DISK,
+                CLIENT_VERSION);
+
+            ssValue.SetSecret(false);
+            ssValue >> txindexes[key.second];
+        } catch (const std::exception& e) {
+            txindexes.erase(key.second);
+        }
+    }
+
+    if (!iterator->status().ok()) {
+        LogPrintf("LevelDB read failure: %s", iterator->status().ToString());
+        return false;
+    }
+
+    return true;
+}
+
+std::future<std::map<uint256, CTxIndex>> CTxDB::ReadTxIndexesAsync(std::vector<uint256> hashes)
+{
+    auto task = std::make_shared<std::vector<uint256>>(std::move(hashes));
+
+    return util::GetExecutor(util::Executor::IO).Submit([task]() {
+        // Below this many lookups per thread, the extra handles and iterators
+        // cost more than they save:
+        static const size_t MIN_LOOKUPS_PER_THREAD = 1000;
+
+        std::vector<uint256>& hashes = *task;
+        std::map<uint256, CTxIndex> txindexes;
+
+        const size_t nThreads = std::min<size_t>(
+            util::GetExecutor(util::Executor::IO).Size(),
+            hashes.size() / MIN_LOOKUPS_PER_THREAD);
+
+        if (nThreads <= 1) {
+            if (!CTxDB("r").ReadTxIndexes(hashes, txindexes)) {
+                throw std::runtime_error("ReadTxIndexesAsync: failed to read the transaction index");
+            }
+
+            return txindexes;
+        }
+
+        // Keys serialize the bytes of the hash in storage order:
+        std::sort(hashes.begin(), hashes.end(), [](const uint256& a, const uint256& b) {
+            return std::memcmp(a.begin(), b.begin(), a.size()) < 0;
+        });
+
+        std::vector<std::map<uint256, CTxIndex>> vResults(nThreads);
+        const size_t nSlice = (hashes.size() + nThreads - 1) / nThreads;
+
+        util::ParallelFor(util::Executor::IO, nThreads, [&](size_t i) {
+            const auto first = hashes.begin() + std::min(hashes.size(), i * nSlice);
+            const auto last = hashes.begin() + std::min(hashes.size(), (i + 1) * nSlice);
+
+            if (!CTxDB("r").ReadTxIndexes(std::vector<uint256>(first, last), vResults[i])) {
+                throw std::runtime_error("ReadTxIndexesAsync: failed to read the transaction index");
+            }
+        });
+
+        for (auto& result : vResults) {
+            txindexes.insert(result.begin(), result.end());
+        }
+
+        return txindexes;
+    });
+}
+
 bool CTxDB::UpdateTxIndex(uint256 hash, const CTxIndex& txindex)
 {
     return Write(make_pair(string("tx"), hash), txindex);
@@ -278,6 +593,116 @@ bool CTxDB::WriteBestInvalidTrust(CBigNum bnBestInvalidTrust)
     return Write(string("bnBestInvalidTrust"), bnBestInvalidTrust);
 }
 
+bool CTxDB::ReadContractSnapshot(uint256& hashBlock, std::vector<unsigned char>& vchState)
+{
+    std::pair<uint256, std::vector<unsigned char>> snapshot;
+
+    if (!Read(string("contractSnapshot"), snapshot))
+        return false;
+
+    hashBlock = snapshot.first;
+    vchState = std::move(snapshot.second);
+
+    return true;
+}
+
+bool CTxDB::WriteContractSnapshot(const uint256& hashBlock, const std::vector<unsigned char>& vchState)
+{
+    return Write(string("contractSnapshot"), make_pair(hashBlock, vchState));
+}
+
+bool CTxDB::EraseContractSnapshot()
+{
+    return Erase(string("contractSnapshot"));
+}
+
+bool CTxDB::ReadBlockFilter(const uint256& hashBlock, BlockFilter& filter)
+{
+    std::vector<unsigned char> vchFilter;
+
+    if (!Read(make_pair(string("blockfilter"), hashBlock), vchFilter))
+        return false;
+
+    try {
+        filter = BlockFilter(hashBlock, std::move(vchFilter));
+    } catch (const std::ios_base::failure& e) {
+        return error("%s: invalid filter for block %s: %s", __func__, hashBlock.ToString(), e.what());
+    }
+
+    return true;
+}
+
+bool CTxDB::WriteBlockFilter(const BlockFilter& filter)
+{
+    return Write(make_pair(string("blockfilter"), filter.GetBlockHash()), filter.GetEncodedFilter());
+}
+
+bool CTxDB::ReadBlockStats(const uint256& hashBlock, CBlockStats& stats)
+{
+    return Read(make_pair(string("blockstats"), hashBlock), stats);
+}
+
+bool CTxDB::WriteBlockStats(const uint256& hashBlock, const CBlockStats& stats)
+{
+    return Write(make_pair(string("blockstats"), hashBlock), stats);
+}
+
+bool CTxDB::ReadBlockUndo(const uint256& hashBlock, CBlockUndo& undo)
+{
+    return Read(make_pair(string("blockundo"), hashBlock), undo);
+}
+
+bool CTxDB::WriteBlockUndo(const uint256& hashBlock, const CBlockUndo& undo)
+{
+    return Write(make_pair(string("blockundo"), hashBlock), undo);
+}
+
+bool CTxDB::EraseBlockUndo(const uint256& hashBlock)
+{
+    return Erase(make_pair(string("blockundo"), hashBlock));
+}
+
+bool CTxDB::ScanRecords(
+    const std::string& strType,
+    const std::function<bool(CDataStream& ssKey, CDataStream& ssValue)>& fn)
+{
+    CDataStream ssStartKey(SER_DISK, CLIENT_VERSION);
+    ssStartKey << strType;
+
+    return ScanKeyPrefix(ssStartKey.str(), fn);
+}
+
+bool CTxDB::ScanKeyPrefix(
+    const std::string& strPrefix,
+    const std::function<bool(CDataStream& ssKey, CDataStream& ssValue)>& fn)
+{
+    if (!pdb)
+        return false;
+
+    std::unique_ptr<leveldb::Iterator> iterator(pdb->NewIterator(leveldb::ReadOptions()));
+
+    for (iterator->Seek(strPrefix); iterator->Valid(); iterator->Next())
+    {
+        if (!iterator->key().starts_with(strPrefix))
+            break;
+
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.SetSecret(false);
+        ssKey.write(iterator->key().data(), iterator->key().size());
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue.SetSecret(false);
+        ssValue.write(iterator->value().data(), iterator->value().size());
+
+        string strKeyType;
+        ssKey >> strKeyType;
+
+        if (!fn(ssKey, ssValue))
+            break;
+    }
+
+    return iterator->status().ok();
+}
+
 bool CTxDB::ReadGenericData(std::string KeyName, std::string& strValue)
 {
     return Read(string(KeyName.c_str()), strValue);
@@ -301,15 +726,100 @@ static CBlockIndex *InsertBlockIndex(const uint256& hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw runtime_error("LoadBlockIndex() : new CBlockIndex failed");
+    CBlockIndex* pindexNew = NewBlockIndex(CBlockIndex());
     mi = mapBlockIndex.insert(make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
     return pindexNew;
 }
 
+namespace {
+//!
+//! \brief Maximum number of threads that decode the block index at startup.
+//!
+constexpr size_t BLOCK_INDEX_LOAD_MAX_THREADS = 8;
+
+//!
+//! \brief Loads the block index entries with block hashes in a range of
+//! values of the first hash byte.
+//!
+class BlockIndexRange
+{
+public:
+    //!
+    //! \brief A decoded entry waiting to be linked into mapBlockIndex.
+    //!
+    struct Entry
+    {
+        uint256 hash;
+        uint256 hashPrev;
+        uint256 hashNext;
+        CBlockIndex index;
+    };
+
+    std::vector<Entry> vEntries; //!< Decoded entries in key order.
+    std::string strError;        //!< Describes a failed load.
+
+    //!
+    //! \param first First value of the first hash byte in the range.
+    //! \param last  Value of the first hash byte after the range.
+    //!
+    BlockIndexRange(const size_t first, const size_t last) : m_first(first), m_last(last)
+    {
+    }
+
+    //!
+    //! \brief Decode the entries in the range from the database.
+    //!
+    void Load(leveldb::DB* pdb)
+    {
+        CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+        ssPrefix << string("blockindex");
+        const std::string strPrefix = ssPrefix.str();
+
+        uint256 start;
+        *start.begin() = static_cast<unsigned char>(m_first);
+
+        CDataStream ssStartKey(SER_DISK, CLIENT_VERSION);
+        ssStartKey << make_pair(string("blockindex"), start);
+
+        std::unique_ptr<leveldb::Iterator> iterator(pdb->NewIterator(leveldb::ReadOptions()));
+
+        try {
+            for (iterator->Seek(ssStartKey.str()); iterator->Valid(); iterator->Next()) {
+                const leveldb::Slice key = iterator->key();
+
+                // Did we reach the end of the data to read?
+                if (fRequestShutdown
+                    || key.size() != strPrefix.size() + start.size()
+                    || memcmp(key.data(), strPrefix.data(), strPrefix.size()) != 0
+                    || static_cast<unsigned char>(key[strPrefix.size()]) >= m_last)
+                {
+                    break;
+                }
+
+                CDiskBlockIndex diskindex;
+                SpanReader(SER_DISK, CLIENT_VERSION, iterator->value().data(), iterator->value().size()) >> diskindex;
+
+                Entry entry;
+                entry.hash = diskindex.GetBlockHash();
+                entry.hashPrev = diskindex.hashPrev;
+                entry.hashNext = diskindex.hashNext;
+                entry.index = diskindex;
+
+                vEntries.push_back(entry);
+            }
+        } catch (const std::exception& e) {
+            strError = strprintf("%s: %s", __func__, e.what());
+        }
+    }
+
+private:
+    const size_t m_first;
+    const size_t m_last;
+};
+} // anonymous namespace
+
 //Halford - todo - 6/19/2015 - Load block index on dedicated thread to decrease startup time by 90% - move checkblocks to separate thread
 
 bool CTxDB::LoadBlockIndex()
@@ -326,85 +836,108 @@ bool CTxDB::LoadBlockIndex()
     // The block index is an in-memory structure that maps hashes to on-disk
     // locations where the contents of the block can be found. Here, we scan it
     // out of the DB and into mapBlockIndex.
-    leveldb::Iterator *iterator = pdb->NewIterator(leveldb::ReadOptions());
-    // Seek to start key.
-    CDataStream ssStartKey(SER_DISK, CLIENT_VERSION);
-    ssStartKey << make_pair(string("blockindex"), uint256());
-    iterator->Seek(ssStartKey.str());
+    //
+    // Decoding the entries dominates the time to load the index, so split the
+    // keyspace by the first byte of the block hash and decode the ranges in
+    // parallel. The entries link to each other by hash, so they are linked in
+    // one pass after every range has loaded.
+    //
+    const size_t nThreads = std::max<size_t>(1, std::min<size_t>(
+        boost::thread::hardware_concurrency(),
+        BLOCK_INDEX_LOAD_MAX_THREADS));
+
+    std::vector<BlockIndexRange> vRanges;
+    vRanges.reserve(nThreads);
+
+    for (size_t i = 0; i < nThreads; ++i) {
+        vRanges.emplace_back(256 * i / nThreads, 256 * (i + 1) / nThreads);
+    }
 
     int nLoaded = 0;
 
-    // Now read each entry.
-    LogPrintf("Loading DiskIndex %d",nHighest);
-    while (iterator->Valid())
-    {
-        // Unpack keys and values.
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.write(iterator->key().data(), iterator->key().size());
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.write(iterator->value().data(), iterator->value().size());
-        string strType;
-        ssKey >> strType;
-        // Did we reach the end of the data to read?
-        if (fRequestShutdown || strType != "blockindex")
-            break;
-        CDiskBlockIndex diskindex;
-        ssValue >> diskindex;
-
-        uint256 blockHash = diskindex.GetBlockHash();
-
-        // Construct block index object
-        CBlockIndex* pindexNew    = InsertBlockIndex(blockHash);
-        pindexNew->pprev          = InsertBlockIndex(diskindex.hashPrev);
-        pindexNew->pnext          = InsertBlockIndex(diskindex.hashNext);
-        pindexNew->nFile          = diskindex.nFile;
-        pindexNew->nBlockPos      = diskindex.nBlockPos;
-        pindexNew->nHeight        = diskindex.nHeight;
-        pindexNew->nMint          = diskindex.nMint;
-        pindexNew->nMoneySupply   = diskindex.nMoneySupply;
-        pindexNew->nFlags         = diskindex.nFlags;
-        pindexNew->nStakeModifier = diskindex.nStakeModifier;
-        pindexNew->prevoutStake   = diskindex.prevoutStake;
-        pindexNew->nStakeTime     = diskindex.nStakeTime;
-        pindexNew->hashProof      = diskindex.hashProof;
-        pindexNew->nVersion       = diskindex.nVersion;
-        pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-        pindexNew->nTime          = diskindex.nTime;
-        pindexNew->nBits          = diskindex.nBits;
-        pindexNew->nNonce         = diskindex.nNonce;
-
-        //9-26-2016 - Gridcoin - New Accrual Fields
-        pindexNew->cpid              = diskindex.cpid;
-        pindexNew->nResearchSubsidy  = diskindex.nResearchSubsidy;
-        pindexNew->nInterestSubsidy  = diskindex.nInterestSubsidy;
-        pindexNew->nMagnitude        = diskindex.nMagnitude;
-        pindexNew->nIsContract       = diskindex.nIsContract;
-        pindexNew->nIsSuperBlock     = diskindex.nIsSuperBlock;
-
-        nBlockCount++;
-        // Watch for genesis block
-        if (pindexGenesisBlock == NULL && blockHash == (!fTestNet ? hashGenesisBlock : hashGenesisBlockTestNet))
-            pindexGenesisBlock = pindexNew;
+    LogPrintf("Loading DiskIndex with %u threads", nThreads);
 
-        if(fQtActive)
-        {
-            if ((pindexNew->nHeight % 10000) == 0)
+    if (nThreads == 1) {
+        vRanges[0].Load(pdb);
+    } else {
+        boost::thread_group threads;
+
+        for (auto& range : vRanges) {
+            threads.create_thread(std::bind(&BlockIndexRange::Load, &range, pdb));
+        }
+
+        threads.join_all();
+    }
+
+    bool fLoadFailed = false;
+
+    for (const auto& range : vRanges) {
+        if (!range.strError.empty()) {
+            LogPrintf("CTxDB::LoadBlockIndex() : %s", range.strError);
+            fLoadFailed = true;
+        }
+    }
+
+    size_t nEntries = 0;
+
+    for (const auto& range : vRanges) {
+        nEntries += range.vEntries.size();
+    }
+
+    if (fLoadFailed) {
+        return error("CTxDB::LoadBlockIndex() : failed to read the block index");
+    }
+
+    mapBlockIndex.reserve(nEntries);
+
+    // Allocate the entries from the arena and link them one range at a time.
+    // Each range frees its decoded copies after this, so the index does not
+    // exist twice in memory once the decoding finished.
+    //
+    // Linking an entry can insert a placeholder for a block in a later range.
+    // Copying that block over the placeholder leaves the links alone as they
+    // belong to the entry itself and are set right after the copy.
+    //
+    for (auto& range : vRanges) {
+        for (const auto& entry : range.vEntries) {
+            auto result = mapBlockIndex.emplace(entry.hash, nullptr);
+
+            if (result.second) {
+                result.first->second = NewBlockIndex(entry.index);
+            } else {
+                *result.first->second = entry.index;
+            }
+
+            CBlockIndex* pindexNew = result.first->second;
+
+            pindexNew->phashBlock = &result.first->first;
+            pindexNew->pprev = InsertBlockIndex(entry.hashPrev);
+            pindexNew->pnext = InsertBlockIndex(entry.hashNext);
+
+            nBlockCount++;
+            // Watch for genesis block
+            if (pindexGenesisBlock == NULL && entry.hash == (!fTestNet ? hashGenesisBlock : hashGenesisBlockTestNet))
+                pindexGenesisBlock = pindexNew;
+
+            if(fQtActive)
             {
-                nLoaded +=10000;
-                if (nLoaded > nHighest) nHighest=nLoaded;
-                if (nHighest < nGrandfather) nHighest=nGrandfather;
-                uiInterface.InitMessage(strprintf("%" PRId64 "/%" PRId64 " %s", nLoaded, nHighest, _("Blocks Loaded")));
-                fprintf(stdout,"%d ",nLoaded); fflush(stdout);
+                if ((pindexNew->nHeight % 10000) == 0)
+                {
+                    nLoaded +=10000;
+                    if (nLoaded > nHighest) nHighest=nLoaded;
+                    if (nHighest < nGrandfather) nHighest=nGrandfather;
+                    uiInterface.InitMessage(strprintf("%" PRId64 "/%" PRId64 " %s", nLoaded, nHighest, _("Blocks Loaded")));
+                    fprintf(stdout,"%d ",nLoaded); fflush(stdout);
+                }
             }
-        }
 
-        // NovaCoin: build setStakeSeen
-        if (pindexNew->IsProofOfStake())
-            setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+            // NovaCoin: build setStakeSeen
+            if (pindexNew->IsProofOfStake())
+                setStakeSeen.insert(make_pair(pindexNew->prevoutStake, pindexNew->nStakeTime));
+        }
 
-        iterator->Next();
+        std::vector<BlockIndexRange::Entry>().swap(range.vEntries);
     }
-    delete iterator;
 
 
     LogPrintf("Time to memorize diskindex containing %i blocks : %15" PRId64 "ms", nBlockCount, GetTimeMillis() - nStart);
@@ -426,6 +959,8 @@ bool CTxDB::LoadBlockIndex()
     for (auto const& item : vSortedByHeight)
     {
         CBlockIndex* pindex = item.second;
+        pindex->BuildSkip();
+        pindex->BuildStakeModifierLink();
         pindex->nChainTrust = (pindex->pprev ? pindex->pprev->nChainTrust : 0) + pindex->GetBlockTrust();
         // NovaCoin: calculate stake modifier checksum
         pindex->nStakeModifierChecksum = GRC::GetStakeModifierChecksum(pindex);
@@ -471,7 +1006,7 @@ bool CTxDB::LoadBlockIndex()
     map<pair<unsigned int, unsigned int>, CBlockIndex*> mapBlockPos;
     for (CBlockIndex* pindex = pindexBest; pindex && pindex->pprev; pindex = pindex->pprev)
     {
-        if (fRequestShutdown || pindex->nHeight < nBestHeight-nCheckDepth)
+        if (fRequestShutdown || pindex->nHeight < nBestHeight-nCheckDepth || pindex->IsPruned())
             break;
         CBlock block;
         if (!block.ReadFromDisk(pindex))
@@ -6,10 +6,16 @@
 #ifndef BITCOIN_LEVELDB_H
 #define BITCOIN_LEVELDB_H
 
+#include "blockfilter.h"
+#include "blockstats.h"
 #include "main.h"
 #include "streams.h"
 
+#include <boost/optional.hpp>
+#include <functional>
+#include <future>
 #include <string>
+#include <unordered_map>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
@@ -44,6 +50,12 @@ private:
     // A batch stores up writes and deletes for atomic application. When this
     // field is non-NULL, writes/deletes go there instead of directly to disk.
     leveldb::WriteBatch *activeBatch;
+
+    // Indexes the pending writes of activeBatch by serialized key so that
+    // reads inside a transaction do not scan the whole batch. An empty value
+    // records a pending delete.
+    std::unordered_map<std::string, boost::optional<std::string>> mapBatchOverlay;
+
     leveldb::Options options;
     bool fReadOnly;
     int nVersion;
@@ -58,6 +70,7 @@ protected:
     bool Read(const K& key, T& value)
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.SetSecret(false);
         ssKey.reserve(1000);
         ssKey << key;
         std::string strValue;
@@ -87,6 +100,7 @@ protected:
         try {
             CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(),
                                 SER_DISK, CLIENT_VERSION);
+            ssValue.SetSecret(false);
             ssValue >> value;
         }
         catch (std::exception &e) {
@@ -102,14 +116,19 @@ protected:
             assert(!"Write called on database in read-only mode");
 
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.SetSecret(false);
         ssKey.reserve(1000);
         ssKey << key;
         CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue.SetSecret(false);
         ssValue.reserve(90000);
         ssValue << value;
 
         if (activeBatch) {
-            activeBatch->Put(ssKey.str(), ssValue.str());
+            std::string strKey = ssKey.str();
+            std::string strValue = ssValue.str();
+            activeBatch->Put(strKey, strValue);
+            mapBatchOverlay[std::move(strKey)] = std::move(strValue);
             return true;
         }
         leveldb::Status status = pdb->Put(leveldb::WriteOptions(), ssKey.str(), ssValue.str());
@@ -129,10 +148,13 @@ protected:
             assert(!"Erase called on database in read-only mode");
 
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.SetSecret(false);
         ssKey.reserve(1000);
         ssKey << key;
         if (activeBatch) {
-            activeBatch->Delete(ssKey.str());
+            std::string strKey = ssKey.str();
+            activeBatch->Delete(strKey);
+            mapBatchOverlay[std::move(strKey)] = boost::none;
             return true;
         }
         leveldb::Status status = pdb->Delete(leveldb::WriteOptions(), ssKey.str());
@@ -143,14 +165,15 @@ protected:
     bool Exists(const K& key)
     {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey.SetSecret(false);
         ssKey.reserve(1000);
         ssKey << key;
         std::string unused;
 
         if (activeBatch) {
             bool deleted;
-            if (ScanBatch(ssKey, &unused, &deleted) && !deleted) {
-                return true;
+            if (ScanBatch(ssKey, &unused, &deleted)) {
+                return !deleted;
             }
         }
 
@@ -167,9 +190,13 @@ public:
     {
         delete activeBatch;
         activeBatch = NULL;
+        mapBatchOverlay.clear();
         return true;
     }
 
+    //! Get the memory held by the block cache and the memtables of LevelDB.
+    uint64_t GetMemoryUsage() const;
+
     bool ReadVersion(int& nVersion)
     {
         nVersion = 0;
@@ -182,6 +209,45 @@ public:
     }
 
     bool ReadTxIndex(uint256 hash, CTxIndex& txindex);
+
+    //!
+    //! \brief Read the transaction index entries for a set of transactions
+    //! in one pass over the database.
+    //!
+    //! This sorts the keys and seeks a single iterator forward through them
+    //! so that lookups of many transactions reuse the same table blocks. It
+    //! reads entries individually when a transaction batch is active.
+    //!
+    //! \param hashes    Hashes of the transactions to look up. Duplicates
+    //! are allowed.
+    //! \param txindexes Receives the index entry of each transaction found
+    //! in the database. Missing transactions have no entry.
+    //!
+    //! \return \c false if a database error occurred.
+    //!
+    bool ReadTxIndexes(
+        const std::vector<uint256>& hashes,
+        std::map<uint256, CTxIndex>& txindexes);
+
+    //!
+    //! \brief Read the transaction index entries for a set of transactions
+    //! on the shared I/O pool.
+    //!
+    //! The task sorts the keys and splits large sets into contiguous slices
+    //! that read concurrently, each with its own database handle and sorted
+    //! iterator pass from ReadTxIndexes(). The caller can do other work until
+    //! it needs the entries. This reads committed entries only, so it cannot
+    //! observe the transaction batch of another handle.
+    //!
+    //! \param hashes Hashes of the transactions to look up. Duplicates are
+    //! allowed.
+    //!
+    //! \return Receives the index entry of each transaction found. It throws
+    //! a std::runtime_error when a database error occurred, or a
+    //! std::future_error when the node shuts down before the read runs.
+    //!
+    static std::future<std::map<uint256, CTxIndex>> ReadTxIndexesAsync(std::vector<uint256> hashes);
+
     bool UpdateTxIndex(uint256 hash, const CTxIndex& txindex);
     bool AddTxIndex(const CTransaction& tx, const CDiskTxPos& pos, int nHeight);
     bool EraseTxIndex(const CTransaction& tx);
@@ -199,6 +265,92 @@ public:
     bool WriteSyncCheckpoint(uint256 hashCheckpoint);
     bool ReadCheckpointPubKey(std::string& strPubKey);
     bool WriteCheckpointPubKey(const std::string& strPubKey);
+    bool ReadContractSnapshot(uint256& hashBlock, std::vector<unsigned char>& vchState);
+    bool WriteContractSnapshot(const uint256& hashBlock, const std::vector<unsigned char>& vchState);
+    bool EraseContractSnapshot();
+
+    //!
+    //! \brief Read the compact filter stored for a block.
+    //!
+    //! \param hashBlock Hash of the block to read the filter for.
+    //! \param filter    Receives the filter.
+    //!
+    //! \return \c false if the database contains no valid filter for the
+    //! block.
+    //!
+    bool ReadBlockFilter(const uint256& hashBlock, BlockFilter& filter);
+
+    //!
+    //! \brief Store the compact filter for a block.
+    //!
+    bool WriteBlockFilter(const BlockFilter& filter);
+
+    //!
+    //! \brief Read the statistics record stored for a block.
+    //!
+    //! \return \c false if the database contains no record for the block.
+    //!
+    bool ReadBlockStats(const uint256& hashBlock, CBlockStats& stats);
+
+    //!
+    //! \brief Store the statistics record for a block.
+    //!
+    bool WriteBlockStats(const uint256& hashBlock, const CBlockStats& stats);
+
+    //!
+    //! \brief Read the undo record written when a block connected.
+    //!
+    //! \return \c false if the database contains no undo record for the
+    //! block.
+    //!
+    bool ReadBlockUndo(const uint256& hashBlock, CBlockUndo& undo);
+    bool WriteBlockUndo(const uint256& hashBlock, const CBlockUndo& undo);
+    bool EraseBlockUndo(const uint256& hashBlock);
+
+    // Reads, writes or erases a record with a key composed of the strType
+    // string and a subsystem-specific key. ScanRecords() reads these back in
+    // bulk.
+    template<typename K, typename T>
+    bool ReadRecord(const std::string& strType, const K& key, T& value)
+    {
+        return Read(std::make_pair(strType, key), value);
+    }
+
+    template<typename K, typename T>
+    bool WriteRecord(const std::string& strType, const K& key, const T& value)
+    {
+        return Write(std::make_pair(strType, key), value);
+    }
+
+    template<typename K>
+    bool EraseRecord(const std::string& strType, const K& key)
+    {
+        return Erase(std::make_pair(strType, key));
+    }
+
+    // Invokes fn for each record with a key that begins with the serialized
+    // strType string. The key stream is positioned just past that string. The
+    // scan stops early when fn returns false. This reads from the database on
+    // disk and does not observe writes pending in an active batch.
+    bool ScanRecords(
+        const std::string& strType,
+        const std::function<bool(CDataStream& ssKey, CDataStream& ssValue)>& fn);
+
+    // Like ScanRecords() above, but only visits the records with a key that
+    // continues with the serialized prefix after the strType string. Because
+    // leveldb sorts the keys, the scan seeks straight to the first match.
+    template<typename K>
+    bool ScanRecords(
+        const std::string& strType,
+        const K& prefix,
+        const std::function<bool(CDataStream& ssKey, CDataStream& ssValue)>& fn)
+    {
+        CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+        ssPrefix.SetSecret(false);
+        ssPrefix << strType << prefix;
+
+        return ScanKeyPrefix(ssPrefix.str(), fn);
+    }
 
 	bool ReadGenericData(std::string KeyName, std::string& strValue);
 	bool WriteGenericData(const std::string& strKey,const std::string& strData);
@@ -207,6 +359,18 @@ public:
     bool LoadBlockIndex();
 private:
     bool LoadBlockIndexGuts();
+
+    // Rewrites the transaction index entries of a database from the last
+    // version with the legacy CTxIndex encoding in the compact encoding. The
+    // entries decode in either encoding, so an interrupted run can start over.
+    bool MigrateTxIndexes();
+
+    // Invokes fn for each record with a key that begins with the serialized
+    // bytes in strPrefix. The key stream is positioned just past the string
+    // at the start of the key.
+    bool ScanKeyPrefix(
+        const std::string& strPrefix,
+        const std::function<bool(CDataStream& ssKey, CDataStream& ssValue)>& fn);
 };
 
 
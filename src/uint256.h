@@ -20,6 +20,9 @@ protected:
     static constexpr int WIDTH = BITS / 8;
     uint8_t data[WIDTH];
 public:
+    //! Vectors of blobs serialize in bulk.
+    static constexpr bool BULK_SERIALIZABLE = true;
+
     base_blob()
     {
         memset(data, 0, sizeof(data));
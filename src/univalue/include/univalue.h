@@ -22,9 +22,9 @@ public:
     enum VType { VNULL, VOBJ, VARR, VSTR, VNUM, VBOOL, };
 
     UniValue() { typ = VNULL; }
-    UniValue(UniValue::VType initialType, const std::string& initialStr = "") {
+    UniValue(UniValue::VType initialType, std::string initialStr = "") {
         typ = initialType;
-        val = initialStr;
+        val = std::move(initialStr);
     }
     UniValue(uint64_t val_) {
         setInt(val_);
@@ -48,7 +48,8 @@ public:
         std::string s(val_);
         setStr(s);
     }
-    ~UniValue() {}
+    // No user-declared destructor, so that the compiler generates the move
+    // constructor and assignment used when values are inserted and returned.
 
     void clear();
 
@@ -59,6 +60,7 @@ public:
     bool setInt(int64_t val);
     bool setInt(int val_) { return setInt((int64_t)val_); }
     bool setFloat(double val);
+    bool setFixed(int64_t scaled, unsigned int decimals, bool trimZeros = false);
     bool setStr(const std::string& val);
     bool setArray();
     bool setObject();
@@ -160,6 +162,7 @@ private:
     std::vector<UniValue> values;
 
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
@@ -56,22 +56,85 @@ bool UniValue::setNumStr(const string& val_)
     return true;
 }
 
-bool UniValue::setInt(uint64_t val_)
+// Format the digits of an integer without a stream. The result is always a
+// valid JSON number, so the setters below skip the check in setNumStr().
+static string formatUInt(uint64_t val_, bool negative)
 {
-    ostringstream oss;
+    char buf[21];
+    char *end = buf + sizeof(buf);
+    char *p = end;
 
-    oss << val_;
+    do {
+        *--p = '0' + (val_ % 10);
+        val_ /= 10;
+    } while (val_);
 
-    return setNumStr(oss.str());
+    if (negative)
+        *--p = '-';
+
+    return string(p, end - p);
+}
+
+bool UniValue::setInt(uint64_t val_)
+{
+    clear();
+    typ = VNUM;
+    val = formatUInt(val_, false);
+    return true;
 }
 
 bool UniValue::setInt(int64_t val_)
 {
-    ostringstream oss;
+    // Negate in unsigned arithmetic so that INT64_MIN does not overflow:
+    const uint64_t magnitude = val_ < 0 ? 0 - (uint64_t)val_ : (uint64_t)val_;
+
+    clear();
+    typ = VNUM;
+    val = formatUInt(magnitude, val_ < 0);
+    return true;
+}
+
+// Set a number stored as an integer scaled by 10^decimals, such as an amount
+// in satoshis, without a round trip through double. With trimZeros, drop the
+// trailing zeros of the fraction, and the point if nothing remains of it.
+bool UniValue::setFixed(int64_t scaled, unsigned int decimals, bool trimZeros)
+{
+    if (decimals > 18)
+        return false;
 
-    oss << val_;
+    const bool negative = scaled < 0;
+    uint64_t magnitude = negative ? 0 - (uint64_t)scaled : (uint64_t)scaled;
 
-    return setNumStr(oss.str());
+    char buf[42];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    bool significant = !trimZeros;
+
+    for (unsigned int i = 0; i < decimals; ++i) {
+        const char digit = '0' + (magnitude % 10);
+        magnitude /= 10;
+
+        if (significant || digit != '0') {
+            *--p = digit;
+            significant = true;
+        }
+    }
+
+    if (p != end)
+        *--p = '.';
+
+    do {
+        *--p = '0' + (magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude);
+
+    if (negative)
+        *--p = '-';
+
+    clear();
+    typ = VNUM;
+    val.assign(p, end - p);
+    return true;
 }
 
 bool UniValue::setFloat(double val_)
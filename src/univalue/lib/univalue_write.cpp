@@ -10,22 +10,23 @@
 
 using namespace std;
 
-static string json_escape(const string& inS)
+static void json_escape(const string& inS, string& outS)
 {
-    string outS;
-    outS.reserve(inS.size() * 2);
-
-    for (unsigned int i = 0; i < inS.size(); i++) {
-        unsigned char ch = inS[i];
-        const char *escStr = escapes[ch];
-
-        if (escStr)
-            outS += escStr;
-        else
-            outS += ch;
+    const char *raw = inS.data();
+    const char *end = raw + inS.size();
+
+    // Copy runs of characters that need no escape in one append:
+    while (raw < end) {
+        const char *run = raw;
+        while (raw < end && !escapes[(unsigned char)*raw])
+            raw++;
+        outS.append(run, raw - run);
+
+        if (raw < end) {
+            outS += escapes[(unsigned char)*raw];
+            raw++;
+        }
     }
-
-    return outS;
 }
 
 string UniValue::write(unsigned int prettyIndent,
@@ -34,6 +35,15 @@ string UniValue::write(unsigned int prettyIndent,
     string s;
     s.reserve(1024);
 
+    writeValue(prettyIndent, indentLevel, s);
+
+    return s;
+}
+
+void UniValue::writeValue(unsigned int prettyIndent,
+                          unsigned int indentLevel,
+                          string& s) const
+{
     unsigned int modIndent = indentLevel;
     if (modIndent == 0)
         modIndent = 1;
@@ -49,7 +59,9 @@ string UniValue::write(unsigned int prettyIndent,
         writeArray(prettyIndent, modIndent, s);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        s += '"';
+        json_escape(val, s);
+        s += '"';
         break;
     case VNUM:
         s += val;
@@ -58,8 +70,6 @@ string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, string& s)
@@ -76,7 +86,7 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].writeValue(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1)) {
             s += ",";
         }
@@ -98,10 +108,12 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        s += '"';
+        json_escape(keys[i], s);
+        s += "\":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).writeValue(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
@@ -162,6 +162,24 @@ BOOST_AUTO_TEST_CASE(univalue_set)
     BOOST_CHECK(v.isNum());
     BOOST_CHECK_EQUAL(v.getValStr(), "1023");
 
+    BOOST_CHECK(v.setFixed(-123456789LL, 8));
+    BOOST_CHECK(v.isNum());
+    BOOST_CHECK_EQUAL(v.getValStr(), "-1.23456789");
+
+    BOOST_CHECK(v.setFixed(5, 8));
+    BOOST_CHECK_EQUAL(v.getValStr(), "0.00000005");
+
+    BOOST_CHECK(v.setFixed(1230, 2, true));
+    BOOST_CHECK_EQUAL(v.getValStr(), "12.3");
+
+    BOOST_CHECK(v.setFixed(1200, 2, true));
+    BOOST_CHECK_EQUAL(v.getValStr(), "12");
+
+    BOOST_CHECK(v.setFixed(0, 2, true));
+    BOOST_CHECK_EQUAL(v.getValStr(), "0");
+
+    BOOST_CHECK(!v.setFixed(1, 19));
+
     BOOST_CHECK(v.setNumStr("-688"));
     BOOST_CHECK(v.isNum());
     BOOST_CHECK_EQUAL(v.getValStr(), "-688");
@@ -0,0 +1,67 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/hasher.h"
+
+#include "crypto/siphash.h"
+#include "uint256.h"
+#include "util.h"
+
+#include <limits>
+
+namespace {
+//!
+//! \brief The SipHash key shared by the salted hashers of the process.
+//!
+struct SaltedHasherKey
+{
+    const uint64_t k0;
+    const uint64_t k1;
+
+    SaltedHasherKey()
+        : k0(GetRand(std::numeric_limits<uint64_t>::max()))
+        , k1(GetRand(std::numeric_limits<uint64_t>::max()))
+    {
+    }
+};
+
+//!
+//! \brief Get the SipHash key, generating it on first use.
+//!
+//! Containers with these hashers exist as globals, so the key cannot be a
+//! global itself without depending on the order of static initialization.
+//!
+const SaltedHasherKey& GetKey()
+{
+    static const SaltedHasherKey key;
+
+    return key;
+}
+} // anonymous namespace
+
+uint64_t SaltedSipHash(const unsigned char* data, size_t size)
+{
+    const SaltedHasherKey& key = GetKey();
+
+    return SipHash13(key.k0, key.k1, data, size);
+}
+
+size_t SaltedUint256Hasher::operator()(const uint256& hash) const
+{
+    const SaltedHasherKey& key = GetKey();
+
+    return SipHash13Uint256(key.k0, key.k1, hash);
+}
+
+size_t SaltedUint160Hasher::operator()(const uint160& hash) const
+{
+    return SaltedSipHash(hash.begin(), hash.size());
+}
+
+uint64_t SaltedSipHash(const uint256& hash, const uint32_t extra)
+{
+    const SaltedHasherKey& key = GetKey();
+
+    return SipHash13Uint256Extra(key.k0, key.k1, hash, extra);
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_HASHER_H
+#define BITCOIN_UTIL_HASHER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+class uint160;
+class uint256;
+
+//!
+//! \brief Hash bytes to key a lookup table.
+//!
+//! Computes SipHash-1-3 with a key chosen at random once for each process, so
+//! peers that send us chosen transaction hashes, CPIDs or other identifiers
+//! cannot predict which buckets of a hash table they land in. The result is
+//! only meaningful within the running process: never store it or use it for
+//! anything that other nodes need to agree on.
+//!
+//! \param data Points to the bytes to hash.
+//! \param size Number of bytes to hash.
+//!
+uint64_t SaltedSipHash(const unsigned char* data, size_t size);
+
+//!
+//! \brief Hash a \c uint256 and a 32-bit integer, like the transaction hash
+//! and the output index of an outpoint, with the key of \c SaltedSipHash().
+//!
+uint64_t SaltedSipHash(const uint256& hash, uint32_t extra);
+
+//!
+//! \brief Hashes \c uint256 keys of unordered containers with the salted
+//! SipHash-1-3 of \c SaltedSipHash().
+//!
+struct SaltedUint256Hasher
+{
+    size_t operator()(const uint256& hash) const;
+};
+
+//!
+//! \brief Hashes \c uint160 keys, such as key and script IDs, of unordered
+//! containers with the salted SipHash-1-3 of \c SaltedSipHash().
+//!
+struct SaltedUint160Hasher
+{
+    size_t operator()(const uint160& hash) const;
+};
+
+//!
+//! \brief Hashes \c COutPoint keys of unordered containers with the salted
+//! SipHash-1-3 of \c SaltedSipHash().
+//!
+//! A template so that this header needs no definition of the transaction
+//! types.
+//!
+struct SaltedOutPointHasher
+{
+    template <typename OutPoint>
+    size_t operator()(const OutPoint& outpoint) const
+    {
+        return SaltedSipHash(outpoint.hash, outpoint.n);
+    }
+};
+
+#endif // BITCOIN_UTIL_HASHER_H
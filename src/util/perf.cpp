@@ -0,0 +1,142 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/perf.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace util;
+
+constexpr size_t PerfCounter::BUCKETS; // for clang
+
+std::atomic<bool> util::g_perf_enabled(false);
+
+namespace {
+//!
+//! \brief Owns the counters. Never destroyed so that timers in static and
+//! thread objects may outlive the end of main().
+//!
+struct PerfRegistry
+{
+    std::mutex m_mutex;
+    std::map<std::string, std::unique_ptr<PerfCounter>> m_counters;
+};
+
+PerfRegistry& GetRegistry()
+{
+    static PerfRegistry* registry = new PerfRegistry();
+    return *registry;
+}
+
+size_t GetBucket(uint64_t micros)
+{
+    size_t bucket = 0;
+
+    while (micros > 1 && bucket < PerfCounter::BUCKETS - 1) {
+        micros >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+} // anonymous namespace
+
+PerfCounter::PerfCounter(std::string name)
+    : m_name(std::move(name))
+    , m_count(0)
+    , m_total_us(0)
+    , m_max_us(0)
+{
+    for (auto& bucket : m_histogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void PerfCounter::Record(uint64_t micros)
+{
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total_us.fetch_add(micros, std::memory_order_relaxed);
+    m_histogram[GetBucket(micros)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t max = m_max_us.load(std::memory_order_relaxed);
+
+    while (micros > max
+        && !m_max_us.compare_exchange_weak(max, micros, std::memory_order_relaxed))
+    {
+    }
+}
+
+void PerfCounter::Reset()
+{
+    m_count.store(0, std::memory_order_relaxed);
+    m_total_us.store(0, std::memory_order_relaxed);
+    m_max_us.store(0, std::memory_order_relaxed);
+
+    for (auto& bucket : m_histogram) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+PerfCounter::Snapshot PerfCounter::GetSnapshot() const
+{
+    Snapshot snapshot;
+
+    snapshot.name = m_name;
+    snapshot.count = m_count.load(std::memory_order_relaxed);
+    snapshot.total_us = m_total_us.load(std::memory_order_relaxed);
+    snapshot.max_us = m_max_us.load(std::memory_order_relaxed);
+
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        snapshot.histogram[i] = m_histogram[i].load(std::memory_order_relaxed);
+    }
+
+    return snapshot;
+}
+
+PerfCounter& util::GetPerfCounter(const std::string& name)
+{
+    PerfRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+
+    auto iter = registry.m_counters.find(name);
+
+    if (iter == registry.m_counters.end()) {
+        const std::string key = registry.m_counters.size() < MAX_PERF_COUNTERS ? name : "(overflow)";
+
+        iter = registry.m_counters.find(key);
+
+        if (iter == registry.m_counters.end()) {
+            iter = registry.m_counters.emplace(key, std::unique_ptr<PerfCounter>(new PerfCounter(key))).first;
+        }
+    }
+
+    return *iter->second;
+}
+
+std::vector<PerfCounter::Snapshot> util::GetPerfSnapshots()
+{
+    PerfRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+
+    std::vector<PerfCounter::Snapshot> snapshots;
+    snapshots.reserve(registry.m_counters.size());
+
+    for (const auto& entry : registry.m_counters) {
+        snapshots.push_back(entry.second->GetSnapshot());
+    }
+
+    return snapshots;
+}
+
+void util::ResetPerfCounters()
+{
+    PerfRegistry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.m_mutex);
+
+    for (auto& entry : registry.m_counters) {
+        entry.second->Reset();
+    }
+}
@@ -0,0 +1,135 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_PERF_H
+#define BITCOIN_UTIL_PERF_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace util {
+//!
+//! \brief Accumulates the durations of a measured code path.
+//!
+//! Counters live as long as the program. A counter records the number of
+//! calls, the total and largest durations, and a histogram of the durations
+//! with one bucket for each power of two microseconds.
+//!
+class PerfCounter
+{
+public:
+    //! Number of histogram buckets. The last one collects the rest.
+    static constexpr size_t BUCKETS = 24;
+
+    //! A consistent enough copy of the counter values for reporting.
+    struct Snapshot
+    {
+        std::string name;
+        uint64_t count;
+        uint64_t total_us;
+        uint64_t max_us;
+        std::array<uint64_t, BUCKETS> histogram;
+    };
+
+    explicit PerfCounter(std::string name);
+
+    //! Record a duration in microseconds.
+    void Record(uint64_t micros);
+
+    //! Clear the recorded values.
+    void Reset();
+
+    Snapshot GetSnapshot() const;
+
+private:
+    const std::string m_name;
+    std::atomic<uint64_t> m_count;
+    std::atomic<uint64_t> m_total_us;
+    std::atomic<uint64_t> m_max_us;
+    std::array<std::atomic<uint64_t>, BUCKETS> m_histogram;
+};
+
+//! Maximum number of distinct counters.
+static constexpr size_t MAX_PERF_COUNTERS = 256;
+
+//!
+//! \brief Whether the scoped timers record durations. Set by -perfstats.
+//!
+extern std::atomic<bool> g_perf_enabled;
+
+//!
+//! \brief Get the counter for a name, creating it on the first call.
+//!
+//! The call takes a lock. Code paths that run often should cache the result
+//! like PERF_SCOPE() does. Names may come from the network, so the registry
+//! holds at most MAX_PERF_COUNTERS. Further names share one overflow counter.
+//!
+PerfCounter& GetPerfCounter(const std::string& name);
+
+//!
+//! \brief Copy the values of every counter in order of name.
+//!
+std::vector<PerfCounter::Snapshot> GetPerfSnapshots();
+
+//!
+//! \brief Clear the values of every counter.
+//!
+void ResetPerfCounters();
+
+//!
+//! \brief Records the lifetime of the scope that contains it. Does nothing
+//! when constructed while g_perf_enabled is unset.
+//!
+class PerfTimer
+{
+public:
+    explicit PerfTimer(PerfCounter& counter)
+        : m_counter(g_perf_enabled.load(std::memory_order_relaxed) ? &counter : nullptr)
+    {
+        if (m_counter) m_start = std::chrono::steady_clock::now();
+    }
+
+    //!
+    //! \brief Time a scope with a counter named at runtime. Builds the name
+    //! and looks the counter up only when enabled.
+    //!
+    PerfTimer(const char* prefix, const std::string& suffix)
+        : m_counter(g_perf_enabled.load(std::memory_order_relaxed) ? &GetPerfCounter(prefix + suffix) : nullptr)
+    {
+        if (m_counter) m_start = std::chrono::steady_clock::now();
+    }
+
+    ~PerfTimer()
+    {
+        if (m_counter) {
+            m_counter->Record(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - m_start).count());
+        }
+    }
+
+    PerfTimer(const PerfTimer&) = delete;
+    PerfTimer& operator=(const PerfTimer&) = delete;
+
+private:
+    PerfCounter* const m_counter;
+    std::chrono::steady_clock::time_point m_start;
+};
+} // namespace util
+
+#define PERF_CONCAT_INNER(a, b) a ## b
+#define PERF_CONCAT(a, b) PERF_CONCAT_INNER(a, b)
+
+//!
+//! \brief Time the rest of the enclosing scope under a constant name. Costs
+//! one relaxed atomic load when disabled.
+//!
+#define PERF_SCOPE(name) \
+    static util::PerfCounter& PERF_CONCAT(perf_counter_, __LINE__) = util::GetPerfCounter(name); \
+    util::PerfTimer PERF_CONCAT(perf_timer_, __LINE__)(PERF_CONCAT(perf_counter_, __LINE__))
+
+#endif // BITCOIN_UTIL_PERF_H
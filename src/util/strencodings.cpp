@@ -5,6 +5,7 @@
 
 #include <util/strencodings.h>
 
+#include <crypto/common.h>
 #include <tinyformat.h>
 
 #include <algorithm>
@@ -59,12 +60,12 @@ signed char HexDigit(char c)
 
 bool IsHex(const std::string& str)
 {
-    for(std::string::const_iterator it(str.begin()); it != str.end(); ++it)
-    {
-        if (HexDigit(*it) < 0)
-            return false;
-    }
-    return (str.size() > 0) && (str.size()%2 == 0);
+    // Invalid digits map to -1, so the sign bit of the union of the values
+    // tells whether any character fails without a branch per character:
+    signed char acc = 0;
+    for (const char c : str)
+        acc |= HexDigit(c);
+    return acc >= 0 && (str.size() > 0) && (str.size()%2 == 0);
 }
 
 bool IsHexNumber(const std::string& str)
@@ -80,12 +81,81 @@ bool IsHexNumber(const std::string& str)
     return (str.size() > starting_location);
 }
 
+namespace {
+/**
+ * Spread the four bytes of x into the low byte of each 16-bit lane of a 64-bit
+ * word, and then split each byte into its high nibble in the first byte of
+ * the lane and its low nibble in the second byte.
+ */
+uint64_t SpreadNibbles(uint32_t x)
+{
+    uint64_t v = x;
+    v = (v | (v << 16)) & 0x0000FFFF0000FFFFULL;
+    v = (v | (v << 8)) & 0x00FF00FF00FF00FFULL;
+    return ((v >> 4) & 0x000F000F000F000FULL) | ((v & 0x000F000F000F000FULL) << 8);
+}
+
+/** Convert eight nibbles, one per byte, to their lowercase hex digits. */
+uint64_t NibblesToHex(uint64_t n)
+{
+    // A nibble of 10 or more carries into bit 4 when adding 6. No byte can
+    // overflow into the next, since 15 + 6 is less than 256:
+    const uint64_t letters = ((n + 0x0606060606060606ULL) >> 4) & 0x0101010101010101ULL;
+    return n + 0x3030303030303030ULL + letters * ('a' - '0' - 10);
+}
+
+/**
+ * Decode 16 hex digits to 8 bytes.
+ *
+ * \return false, leaving out untouched, if any of the characters is not a
+ * hex digit.
+ */
+bool DecodeHexBlock(const char* in, unsigned char* out)
+{
+    signed char digits[16];
+    signed char acc = 0;
+    for (int i = 0; i < 16; ++i) {
+        digits[i] = HexDigit(in[i]);
+        acc |= digits[i];
+    }
+    if (acc < 0)
+        return false;
+    for (int i = 0; i < 8; ++i) {
+        out[i] = (digits[2 * i] << 4) | digits[2 * i + 1];
+    }
+    return true;
+}
+} // anonymous namespace
+
+void HexEncode(char* out, const unsigned char* pch, size_t len)
+{
+    for (; len >= 4; len -= 4, pch += 4, out += 8) {
+        WriteLE64((unsigned char*)out, NibblesToHex(SpreadNibbles(ReadLE32(pch))));
+    }
+
+    static const char hexmap[16] = { '0', '1', '2', '3', '4', '5', '6', '7',
+                                     '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+    for (; len > 0; --len, ++pch) {
+        *out++ = hexmap[*pch >> 4];
+        *out++ = hexmap[*pch & 15];
+    }
+}
+
 std::vector<unsigned char> ParseHex(const char* psz)
 {
     // convert hex dump to vector
     std::vector<unsigned char> vch;
+    const char* const pend = psz + strlen(psz);
+    vch.reserve((pend - psz) / 2);
     while (true)
     {
+        // Decode runs of digits without separators eight bytes at a time:
+        unsigned char block[8];
+        if (pend - psz >= 16 && DecodeHexBlock(psz, block)) {
+            vch.insert(vch.end(), block, block + sizeof(block));
+            psz += 16;
+            continue;
+        }
         while (IsSpace(*psz))
             psz++;
         signed char c = HexDigit(*psz++);
@@ -0,0 +1,367 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "util/threadpool.h"
+#include "util/threadnames.h"
+#include "util/time.h"
+
+#include <algorithm>
+#include <array>
+
+using namespace util;
+
+namespace {
+//! The pool and the queue of the current thread if it is a pool worker.
+thread_local const ThreadPool* g_current_pool = nullptr;
+thread_local size_t g_current_worker = 0;
+
+//!
+//! \brief The work of a ParallelFor() call. Helpers hold it by shared pointer
+//! so that a helper that starts after the call returned finds no indices left
+//! and never touches the task of the caller.
+//!
+struct ParallelForState
+{
+    ParallelForState(const size_t count, const std::function<void(size_t)>& task)
+        : m_next(0), m_count(count), m_task(&task), m_done(0)
+    {
+    }
+
+    std::atomic<size_t> m_next;
+    const size_t m_count;
+    const std::function<void(size_t)>* const m_task;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    size_t m_done;
+    std::exception_ptr m_error;
+
+    void Run()
+    {
+        for (size_t i = m_next++; i < m_count; i = m_next++) {
+            std::exception_ptr error;
+
+            try {
+                (*m_task)(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (error && !m_error) {
+                m_error = error;
+            }
+
+            if (++m_done == m_count) {
+                m_cond.notify_all();
+            }
+        }
+    }
+
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]() { return m_done == m_count; });
+
+        if (m_error) {
+            std::rethrow_exception(m_error);
+        }
+    }
+};
+
+struct ExecutorConfig
+{
+    const char* name;
+    size_t threads;
+};
+
+ExecutorConfig GetExecutorConfig(const Executor executor)
+{
+    const size_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    switch (executor) {
+        case Executor::VALIDATION: return { "validation", cores };
+        case Executor::IO:         return { "io", std::min<size_t>(8, std::max<size_t>(2, cores)) };
+        case Executor::NETWORK:    return { "network", std::min<size_t>(4, cores) };
+        case Executor::BACKGROUND: return { "background", std::min<size_t>(4, cores) };
+    }
+
+    return { "unknown", 1 };
+}
+
+constexpr size_t EXECUTOR_COUNT = 4;
+
+std::mutex g_executors_mutex;
+std::array<std::unique_ptr<ThreadPool>, EXECUTOR_COUNT> g_executors;
+bool g_executors_stopped = false;
+} // anonymous namespace
+
+// -----------------------------------------------------------------------------
+// Class: ThreadPool
+// -----------------------------------------------------------------------------
+
+ThreadPool::ThreadPool(std::string name, size_t threads)
+    : m_name(std::move(name))
+    , m_start_time(GetTimeMicros())
+    , m_stop(false)
+    , m_queued(0)
+    , m_active(0)
+    , m_next_worker(0)
+    , m_completed(0)
+    , m_stolen(0)
+    , m_busy_us(0)
+{
+    threads = std::max<size_t>(threads, 1);
+
+    for (size_t i = 0; i < threads; ++i) {
+        m_workers.emplace_back(new Worker());
+    }
+
+    for (size_t i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&ThreadPool::Run, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_cond.notify_all();
+
+    for (auto& thread : m_threads) {
+        if (!thread.joinable()) {
+            continue;
+        }
+
+        // A task that stops its own pool cannot wait for itself:
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach();
+        } else {
+            thread.join();
+        }
+    }
+
+    // Destroying the queued tasks breaks the promises of their futures:
+    for (auto& worker : m_workers) {
+        std::deque<std::function<void()>> tasks;
+
+        {
+            std::lock_guard<std::mutex> lock(worker->m_mutex);
+            tasks.swap(worker->m_tasks);
+        }
+
+        m_queued -= tasks.size();
+    }
+}
+
+ThreadPool::Stats ThreadPool::GetStats() const
+{
+    Stats stats;
+
+    stats.name = m_name;
+    stats.threads = m_workers.size();
+    stats.active = m_active;
+    stats.queued = m_queued;
+    stats.completed = m_completed;
+    stats.stolen = m_stolen;
+    stats.busy_us = m_busy_us;
+    stats.uptime_us = GetTimeMicros() - m_start_time;
+
+    return stats;
+}
+
+void ThreadPool::Push(std::function<void()> task)
+{
+    {
+        // Queue the task under the lock that the workers wait on so that no
+        // worker misses the wakeup, and so that no task arrives after Stop()
+        // dropped the queues:
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_stop) {
+            return;
+        }
+
+        if (g_current_pool == this) {
+            Worker& worker = *m_workers[g_current_worker];
+            std::lock_guard<std::mutex> worker_lock(worker.m_mutex);
+            worker.m_tasks.push_front(std::move(task));
+        } else {
+            Worker& worker = *m_workers[m_next_worker++ % m_workers.size()];
+            std::lock_guard<std::mutex> worker_lock(worker.m_mutex);
+            worker.m_tasks.push_back(std::move(task));
+        }
+
+        ++m_queued;
+    }
+
+    m_cond.notify_one();
+}
+
+bool ThreadPool::Pop(const size_t index, std::function<void()>& task)
+{
+    {
+        Worker& worker = *m_workers[index];
+        std::lock_guard<std::mutex> lock(worker.m_mutex);
+
+        if (!worker.m_tasks.empty()) {
+            task = std::move(worker.m_tasks.front());
+            worker.m_tasks.pop_front();
+            --m_queued;
+
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < m_workers.size(); ++offset) {
+        Worker& victim = *m_workers[(index + offset) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+
+        if (!victim.m_tasks.empty()) {
+            task = std::move(victim.m_tasks.back());
+            victim.m_tasks.pop_back();
+            --m_queued;
+            ++m_stolen;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::Run(const size_t index)
+{
+    util::ThreadRename(m_name + "." + std::to_string(index));
+
+    g_current_pool = this;
+    g_current_worker = index;
+
+    while (true) {
+        std::function<void()> task;
+
+        if (!m_stop && Pop(index, task)) {
+            const int64_t start_time = GetTimeMicros();
+            ++m_active;
+
+            // Submit() delivers the exceptions of a task to its future, but
+            // a worker must survive a task that throws anyway:
+            try {
+                task();
+            } catch (...) {
+            }
+
+            task = nullptr;
+
+            --m_active;
+            ++m_completed;
+            m_busy_us += std::max<int64_t>(0, GetTimeMicros() - start_time);
+
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]() { return m_stop || m_queued > 0; });
+
+        if (m_stop) {
+            return;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------------
+// Functions
+// -----------------------------------------------------------------------------
+
+ThreadPool& util::GetExecutor(const Executor executor)
+{
+    std::lock_guard<std::mutex> lock(g_executors_mutex);
+
+    std::unique_ptr<ThreadPool>& pool = g_executors[static_cast<size_t>(executor)];
+
+    if (!pool) {
+        const ExecutorConfig config = GetExecutorConfig(executor);
+        pool.reset(new ThreadPool(config.name, config.threads));
+
+        // A pool requested after shutdown accepts no tasks:
+        if (g_executors_stopped) {
+            pool->Stop();
+        }
+    }
+
+    return *pool;
+}
+
+void util::ParallelFor(
+    const Executor executor,
+    const size_t count,
+    const std::function<void(size_t)>& task,
+    size_t max_threads)
+{
+    if (count == 0) {
+        return;
+    }
+
+    if (count == 1 || max_threads == 1) {
+        for (size_t i = 0; i < count; ++i) {
+            task(i);
+        }
+
+        return;
+    }
+
+    ThreadPool& pool = GetExecutor(executor);
+
+    if (max_threads == 0) {
+        max_threads = pool.Size() + 1;
+    }
+
+    const size_t helpers = std::min(count, max_threads) - 1;
+    const auto state = std::make_shared<ParallelForState>(count, task);
+
+    if (pool.IsRunning()) {
+        for (size_t i = 0; i < helpers; ++i) {
+            pool.Submit([state]() { state->Run(); });
+        }
+    }
+
+    state->Run();
+    state->Wait();
+}
+
+std::vector<ThreadPool::Stats> util::GetExecutorStats()
+{
+    std::vector<ThreadPool::Stats> stats;
+    std::lock_guard<std::mutex> lock(g_executors_mutex);
+
+    for (const auto& pool : g_executors) {
+        if (pool) {
+            stats.emplace_back(pool->GetStats());
+        }
+    }
+
+    return stats;
+}
+
+void util::StopExecutors()
+{
+    std::lock_guard<std::mutex> lock(g_executors_mutex);
+
+    g_executors_stopped = true;
+
+    for (const auto& pool : g_executors) {
+        if (pool) {
+            pool->Stop();
+        }
+    }
+}
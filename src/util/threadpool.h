@@ -0,0 +1,179 @@
+// Copyright (c) 2014-2020 The Gridcoin developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_THREADPOOL_H
+#define BITCOIN_UTIL_THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace util {
+//!
+//! \brief A fixed set of worker threads that run submitted tasks.
+//!
+//! Each worker owns a queue. A task submitted from a worker of the pool goes
+//! to the front of that worker's queue, and other tasks go to the back of the
+//! queues in turn. A worker takes tasks from the front of its own queue and
+//! steals from the back of the other queues when its own is empty.
+//!
+class ThreadPool
+{
+public:
+    //! A consistent enough copy of the pool counters for reporting.
+    struct Stats
+    {
+        std::string name;
+        size_t threads;      //!< Number of worker threads.
+        size_t active;       //!< Workers that are running a task.
+        size_t queued;       //!< Tasks waiting for a worker.
+        uint64_t completed;  //!< Tasks that finished since the pool started.
+        uint64_t stolen;     //!< Tasks taken from the queue of another worker.
+        uint64_t busy_us;    //!< Time that workers spent running tasks.
+        uint64_t uptime_us;  //!< Time since the pool started.
+    };
+
+    //!
+    //! \brief Start the worker threads.
+    //!
+    //! \param name    Names the pool in reports and its threads.
+    //! \param threads Number of worker threads. At least one starts.
+    //!
+    ThreadPool(std::string name, size_t threads);
+
+    //!
+    //! \brief Stop the worker threads. Calls Stop().
+    //!
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //!
+    //! \brief Queue a task to run on a worker.
+    //!
+    //! \return Receives the result or the exception of the task. After the
+    //! pool stops, it throws a std::future_error with a broken promise for the
+    //! tasks that never ran.
+    //!
+    template <typename F>
+    auto Submit(F&& func) -> std::future<decltype(func())>
+    {
+        typedef decltype(func()) Result;
+
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(func));
+        std::future<Result> result = task->get_future();
+
+        Push([task]() { (*task)(); });
+
+        return result;
+    }
+
+    //!
+    //! \brief Stop the workers after their running tasks finish and drop the
+    //! queued tasks. Further tasks never run.
+    //!
+    void Stop();
+
+    //!
+    //! \brief Whether the pool accepts tasks.
+    //!
+    bool IsRunning() const { return !m_stop; }
+
+    //!
+    //! \brief Get the number of worker threads.
+    //!
+    size_t Size() const { return m_workers.size(); }
+
+    Stats GetStats() const;
+
+private:
+    //! The queue of a worker thread.
+    struct Worker
+    {
+        std::mutex m_mutex;
+        std::deque<std::function<void()>> m_tasks;
+    };
+
+    const std::string m_name;
+    const int64_t m_start_time;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::vector<std::thread> m_threads;
+
+    mutable std::mutex m_mutex;              //!< Guards the wait for tasks.
+    std::condition_variable m_cond;          //!< Wakes workers for new tasks.
+    std::atomic<bool> m_stop;
+    std::atomic<size_t> m_queued;
+    std::atomic<size_t> m_active;
+    std::atomic<size_t> m_next_worker;       //!< Queue for the next outside task.
+    std::atomic<uint64_t> m_completed;
+    std::atomic<uint64_t> m_stolen;
+    std::atomic<uint64_t> m_busy_us;
+
+    void Push(std::function<void()> task);
+    bool Pop(size_t index, std::function<void()>& task);
+    void Run(size_t index);
+};
+
+//!
+//! \brief Identifies the shared thread pools by the kind of work they run.
+//!
+enum class Executor
+{
+    VALIDATION, //!< CPU-bound checks of blocks, transactions and superblocks.
+    IO,         //!< Disk reads and writes.
+    NETWORK,    //!< Work for network peers and HTTP requests.
+    BACKGROUND, //!< Work that nothing waits for urgently, like statistics.
+};
+
+//!
+//! \brief Get a shared thread pool, starting it on the first call.
+//!
+//! The validation pool starts a thread for each core, the I/O pool up to
+//! eight, and the other pools up to four.
+//!
+ThreadPool& GetExecutor(Executor executor);
+
+//!
+//! \brief Run a task for each index from zero to \p count on the calling
+//! thread and the workers of a shared pool.
+//!
+//! The calling thread takes a share of the indices, so the call never waits
+//! on workers that have not started yet, even when the pool is busy or the
+//! calling thread is one of its workers. The call returns when every index
+//! finished and rethrows the first exception of a task.
+//!
+//! \param executor    Pool that provides the helping workers.
+//! \param count       Number of indices to process.
+//! \param task        Processes the supplied index.
+//! \param max_threads Limits the number of threads that run tasks, including
+//! the calling thread. Zero allows one more than the size of the pool.
+//!
+void ParallelFor(
+    Executor executor,
+    size_t count,
+    const std::function<void(size_t)>& task,
+    size_t max_threads = 0);
+
+//!
+//! \brief Get the counters of the shared pools that started.
+//!
+std::vector<ThreadPool::Stats> GetExecutorStats();
+
+//!
+//! \brief Stop the shared pools at shutdown. Tasks submitted afterward never
+//! run, and ParallelFor() runs its tasks on the calling thread.
+//!
+void StopExecutors();
+} // namespace util
+
+#endif // BITCOIN_UTIL_THREADPOOL_H
@@ -54,6 +54,9 @@ static const int INIT_PROTO_VERSION = 180275;            //
 //
 // database format versioning
 //
-static const int DATABASE_VERSION = 180015;
+static const int DATABASE_VERSION = 180016;
+// last database version with the legacy transaction index encoding, which
+// converts in place instead of a resync
+static const int TXINDEX_LEGACY_DATABASE_VERSION = 180015;
 
 #endif
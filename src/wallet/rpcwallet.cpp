@@ -515,11 +515,11 @@ UniValue verifymessage(const UniValue& params, bool fHelp)
     ss << strMessageMagic;
     ss << strMessage;
 
-    CKey key;
-    if (!key.SetCompactSignature(Hash(ss.begin(), ss.end()), vchSig))
+    CPubKey pubkey;
+    if (!pubkey.RecoverCompact(Hash(ss.begin(), ss.end()), vchSig))
         return false;
 
-    return (key.GetPubKey().GetID() == keyID);
+    return (pubkey.GetID() == keyID);
 }
 
 
@@ -1618,21 +1618,15 @@ UniValue listtransactions(const UniValue& params, bool fHelp)
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
-
     // iterate backwards until we have nCount items to return:
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
-    {
-        CWalletTx *const pwtx = (*it).second.first;
+    pwalletMain->ForEachTxItemNewestFirst(strAccount, [&](CWalletTx* pwtx, CAccountingEntry* pacentry) {
         if (pwtx != 0)
             ListTransactions(*pwtx, strAccount, 0, true, ret, filter);
-        CAccountingEntry *const pacentry = (*it).second.second;
         if (pacentry != 0)
             AcentryToJSON(*pacentry, strAccount, ret);
 
-        if ((int)ret.size() >= (nCount+nFrom)) break;
-    }
+        return (int)ret.size() < (nCount+nFrom);
+    });
     // ret is newest to oldest
 
     if (nFrom > (int)ret.size())
@@ -1685,21 +1679,15 @@ UniValue liststakes(const UniValue& params, bool fHelp)
 
     LOCK2(cs_main, pwalletMain->cs_wallet);
 
-    std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered = pwalletMain->OrderedTxItems(acentries, strAccount);
-
     // iterate backwards until we have at least nCount items to return:
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
-    {
-        CWalletTx *const pwtx = it->second.first;
+    pwalletMain->ForEachTxItemNewestFirst(strAccount, [&](CWalletTx* pwtx, CAccountingEntry* pacentry) {
         if (pwtx != 0)
             ListTransactions(*pwtx, strAccount, 0, true, ret_superset, filter, true);
-        CAccountingEntry *const pacentry = it->second.second;
         if (pacentry != 0)
             AcentryToJSON(*pacentry, strAccount, ret_superset);
 
-        if ((int)ret_superset.size() >= nCount) break;
-    }
+        return (int)ret_superset.size() < nCount;
+    });
     // ret is newest to oldest, for the stake listings, we will leave in that order.
     std::vector<UniValue> arrTmp = ret_superset.getValues();
 
@@ -1828,19 +1816,16 @@ UniValue listsinceblock(const UniValue& params, bool fHelp)
     int depth = pindex ? (1 + nBestHeight - pindex->nHeight) : -1;
     UniValue transactions(UniValue::VARR);
 
-    for (map<uint256, CWalletTx>::iterator it = pwalletMain->mapWallet.begin(); it != pwalletMain->mapWallet.end(); it++)
+    for (const auto& item : pwalletMain->mapWallet)
     {
-        CWalletTx tx = (*it).second;
+        const CWalletTx& tx = item.second;
 
         if (depth == -1 || tx.GetDepthInMainChain() < depth)
             ListTransactions(tx, "*", 0, true, transactions, filter);
     }
 
     int target_height = pindexBest->nHeight + 1 - target_confirms;
-    CBlockIndex *block;
-        for (block = pindexBest;
-             block && block->nHeight > target_height;
-             block = block->pprev)  { }
+    const CBlockIndex *block = pindexBest->GetAncestor(target_height);
     uint256 lastblock = block ? block->GetBlockHash() : uint256();
 
     UniValue ret(UniValue::VOBJ);
@@ -1964,8 +1949,6 @@ UniValue backupwallet(const UniValue& params, bool fHelp)
                 "\n"
                 "Backup your wallet and config files.\n");
 
-    LOCK2(cs_main, pwalletMain->cs_wallet);
-
     bool bWalletBackupResults = GRC::BackupWallet(*pwalletMain, GRC::GetBackupFilename("wallet.dat"));
     bool bConfigBackupResults = GRC::BackupConfigFile(GRC::GetBackupFilename("gridcoinresearch.conf"));
 
@@ -2171,8 +2154,8 @@ UniValue walletpassphrase(const UniValue& params, bool fHelp)
 
     if (strWalletPass.length() > 0)
     {
-        LOCK2(cs_main, pwalletMain->cs_wallet);
-
+        // Unlock() takes the wallet lock itself after deriving the key from
+        // the passphrase. Holding cs_main here would stall the node meanwhile.
         if (!pwalletMain->Unlock(strWalletPass))
             throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: The wallet passphrase entered was incorrect.");
     }
@@ -19,16 +19,20 @@
 #include <script.h>
 #include "main.h"
 #include "util.h"
+#include <cstring>
 #include <random>
 #include "gridcoin/researcher.h"
 #include "gridcoin/staking/kernel.h"
 #include "gridcoin/support/block_finder.h"
+#include "gridcoin/support/block_prefetcher.h"
+#include "init.h"
 
 using namespace std;
 
 extern bool fQtActive;
 
 bool fConfChange;
+unsigned int nCoinSelectionTries = DEFAULT_COIN_SELECTION_TRIES;
 unsigned int nDerivationMethodIndex;
 extern std::atomic<int64_t> g_nTimeBestReceived;
 
@@ -41,12 +45,62 @@ struct CompareValueOnly
         return t1.first < t2.first;
     }
 };
+
+//!
+//! \brief Number of blocks between saved rescan progress checkpoints.
+//!
+constexpr size_t RESCAN_CHECKPOINT_INTERVAL = 10000;
 } // anonymous namespace
 
+// -----------------------------------------------------------------------------
+// Class: CWalletWriteBatch
+// -----------------------------------------------------------------------------
+
+CWalletWriteBatch::CWalletWriteBatch(CWallet& walletIn) : wallet(walletIn)
+{
+    AssertLockHeld(wallet.cs_wallet);
+
+    if (!wallet.pwalletdbBatch)
+    {
+        pwalletdb.reset(new CWalletDB(wallet.strWalletFile, "r+", true));
+        wallet.pwalletdbBatch = pwalletdb.get();
+        wallet.pmapNotifyBatch = &mapNotify;
+    }
+}
+
+CWalletWriteBatch::~CWalletWriteBatch()
+{
+    // The handle flushes the database log when it closes:
+    if (pwalletdb)
+    {
+        wallet.pwalletdbBatch = NULL;
+        wallet.pmapNotifyBatch = NULL;
+
+        for (const auto& notify : mapNotify)
+            wallet.NotifyTransactionChanged(&wallet, notify.first, notify.second);
+    }
+}
+
 // -----------------------------------------------------------------------------
 // Class: CWallet
 // -----------------------------------------------------------------------------
 
+void CWallet::NotifyTransaction(const uint256& hash, ChangeType status)
+{
+    AssertLockHeld(cs_wallet);
+
+    if (!pmapNotifyBatch)
+    {
+        NotifyTransactionChanged(this, hash, status);
+        return;
+    }
+
+    // A transaction added and then updated in one batch is still new:
+    auto inserted = pmapNotifyBatch->emplace(hash, status);
+    if (!inserted.second && status == CT_NEW)
+        inserted.first->second = CT_NEW;
+}
+
 const CPubKey& CWallet::MasterPublicKey()
 {
     // If the master key changes, add a conditional entry to this method that
@@ -117,10 +171,15 @@ bool CWallet::AddKey(const CKey& key)
 
     if (!CCryptoKeyStore::AddKey(key))
         return false;
+    MarkOwnershipChanged();
     if (!fFileBacked)
         return true;
     if (!IsCrypted())
+    {
+        if (pwalletdbBatch)
+            return pwalletdbBatch->WriteKey(pubkey, key.GetPrivKey(), mapKeyMetadata[pubkey.GetID()]);
         return CWalletDB(strWalletFile).WriteKey(pubkey, key.GetPrivKey(), mapKeyMetadata[pubkey.GetID()]);
+    }
     return true;
 }
 
@@ -128,12 +187,15 @@ bool CWallet::AddCryptedKey(const CPubKey &vchPubKey, const vector<unsigned char
 {
     if (!CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret))
         return false;
+    MarkOwnershipChanged();
     if (!fFileBacked)
         return true;
     {
         LOCK(cs_wallet);
         if (pwalletdbEncryption)
             return pwalletdbEncryption->WriteCryptedKey(vchPubKey, vchCryptedSecret, mapKeyMetadata[vchPubKey.GetID()]);
+        else if (pwalletdbBatch)
+            return pwalletdbBatch->WriteCryptedKey(vchPubKey, vchCryptedSecret, mapKeyMetadata[vchPubKey.GetID()]);
         else
             return CWalletDB(strWalletFile).WriteCryptedKey(vchPubKey, vchCryptedSecret, mapKeyMetadata[vchPubKey.GetID()]);
     }
@@ -152,6 +214,7 @@ bool CWallet::LoadKeyMetadata(const CPubKey &pubkey, const CKeyMetadata &meta)
 
 bool CWallet::LoadCryptedKey(const CPubKey &vchPubKey, const std::vector<unsigned char> &vchCryptedSecret)
 {
+    MarkOwnershipChanged();
     return CCryptoKeyStore::AddCryptedKey(vchPubKey, vchCryptedSecret);
 }
 
@@ -159,6 +222,7 @@ bool CWallet::AddCScript(const CScript& redeemScript)
 {
     if (!CCryptoKeyStore::AddCScript(redeemScript))
         return false;
+    MarkOwnershipChanged();
     if (!fFileBacked)
         return true;
     return CWalletDB(strWalletFile).WriteCScript(Hash160(redeemScript), redeemScript);
@@ -182,6 +246,7 @@ bool CWallet::LoadCScript(const CScript& redeemScript)
         return true;
     }
 
+    MarkOwnershipChanged();
     return CCryptoKeyStore::AddCScript(redeemScript);
 }
 
@@ -190,24 +255,36 @@ bool CWallet::Unlock(const SecureString& strWalletPassphrase)
     if (!IsLocked())
         return false;
 
+    // Deriving the key from the passphrase takes a deliberately long time.
+    // Derive it without holding cs_wallet so that staking and the other wallet
+    // users do not wait on it. The crypted keys decrypt on first use, so only
+    // the derivation and the check of one key remain:
+    MasterKeyMap mapMasterKeysCopy;
+
+    {
+        LOCK(cs_wallet);
+        mapMasterKeysCopy = mapMasterKeys;
+    }
+
     CCrypter crypter;
     CKeyingMaterial vMasterKey;
 
+    for (auto const& pMasterKey : mapMasterKeysCopy)
     {
+        if(!crypter.SetKeyFromPassphrase(strWalletPassphrase, pMasterKey.second.vchSalt, pMasterKey.second.nDeriveIterations, pMasterKey.second.nDerivationMethod))
+            return false;
+        if (!crypter.Decrypt(pMasterKey.second.vchCryptedKey, vMasterKey))
+            return false;
+
         LOCK(cs_wallet);
-        for (auto const& pMasterKey : mapMasterKeys)
+
+        if (CCryptoKeyStore::Unlock(vMasterKey))
         {
-            if(!crypter.SetKeyFromPassphrase(strWalletPassphrase, pMasterKey.second.vchSalt, pMasterKey.second.nDeriveIterations, pMasterKey.second.nDerivationMethod))
-                return false;
-            if (!crypter.Decrypt(pMasterKey.second.vchCryptedKey, vMasterKey))
-                return false;
-            if (CCryptoKeyStore::Unlock(vMasterKey))
-            {
-                GRC::Researcher::Get()->ImportBeaconKeysFromConfig(this);
-                return true;
-            }
+            GRC::Researcher::Get()->ImportBeaconKeysFromConfig(this);
+            return true;
         }
     }
+
     return false;
 }
 
@@ -395,6 +472,21 @@ int64_t CWallet::IncOrderPosNext(CWalletDB *pwalletdb)
     return nRet;
 }
 
+const std::multimap<int64_t, CWalletTx*>& CWallet::GetOrderedWalletTxs()
+{
+    AssertLockHeld(cs_wallet); // mapWallet
+
+    if (wtxOrdered.size() != mapWallet.size())
+    {
+        wtxOrdered.clear();
+
+        for (auto& item : mapWallet)
+            wtxOrdered.emplace(item.second.nOrderPos, &item.second);
+    }
+
+    return wtxOrdered;
+}
+
 CWallet::TxItems CWallet::OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount)
 {
     AssertLockHeld(cs_wallet); // mapWallet
@@ -403,13 +495,9 @@ CWallet::TxItems CWallet::OrderedTxItems(std::list<CAccountingEntry>& acentries,
     // First: get all CWalletTx and CAccountingEntry into a sorted-by-order multimap.
     TxItems txOrdered;
 
-    // Note: maintaining indices in the database of (account,time) --> txid and (account, time) --> acentry
-    // would make this much faster for applications that do this a lot.
-    for (map<uint256, CWalletTx>::iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-    {
-        CWalletTx* wtx = &((*it).second);
-        txOrdered.insert(make_pair(wtx->nOrderPos, TxPair(wtx, (CAccountingEntry*)0)));
-    }
+    for (const auto& item : GetOrderedWalletTxs())
+        txOrdered.emplace_hint(txOrdered.end(), item.first, TxPair(item.second, (CAccountingEntry*)0));
+
     acentries.clear();
     walletdb.ListAccountCreditDebit(strAccount, acentries);
     for (auto &entry : acentries)
@@ -420,6 +508,46 @@ CWallet::TxItems CWallet::OrderedTxItems(std::list<CAccountingEntry>& acentries,
     return txOrdered;
 }
 
+void CWallet::ForEachTxItemNewestFirst(const std::string& strAccount, const std::function<bool(CWalletTx*, CAccountingEntry*)>& fn)
+{
+    AssertLockHeld(cs_wallet); // mapWallet
+
+    // Accounting entries are few and live only in the database. Order them
+    // newest first and merge them with the transaction index:
+    std::list<CAccountingEntry> acentries;
+    CWalletDB(strWalletFile).ListAccountCreditDebit(strAccount, acentries);
+
+    std::vector<CAccountingEntry*> vEntries;
+    vEntries.reserve(acentries.size());
+    for (auto it = acentries.rbegin(); it != acentries.rend(); ++it)
+        vEntries.push_back(&*it);
+
+    std::stable_sort(vEntries.begin(), vEntries.end(), [](const CAccountingEntry* a, const CAccountingEntry* b) {
+        return a->nOrderPos > b->nOrderPos;
+    });
+
+    const std::multimap<int64_t, CWalletTx*>& txOrdered = GetOrderedWalletTxs();
+
+    auto tx_iter = txOrdered.rbegin();
+    auto entry_iter = vEntries.begin();
+
+    while (tx_iter != txOrdered.rend() || entry_iter != vEntries.end())
+    {
+        // An accounting entry comes first of the items with the same order
+        // position, as in the reverse walk of OrderedTxItems():
+        if (entry_iter != vEntries.end()
+            && (tx_iter == txOrdered.rend() || (*entry_iter)->nOrderPos >= tx_iter->first))
+        {
+            if (!fn(nullptr, *entry_iter++))
+                return;
+        }
+        else if (!fn((tx_iter++)->second, nullptr))
+        {
+            return;
+        }
+    }
+}
+
 void CWallet::WalletUpdateSpent(const CTransaction &tx, bool fBlock, CWalletDB* pwalletdb)
 {
     // Anytime a signature is successfully verified, it's proof the outpoint is spent.
@@ -440,7 +568,7 @@ void CWallet::WalletUpdateSpent(const CTransaction &tx, bool fBlock, CWalletDB*
                     LogPrint(BCLog::LogFlags::VERBOSE, "WalletUpdateSpent found spent coin %s gC %s", FormatMoney(wtx.GetCredit()), wtx.GetHash().ToString());
                     wtx.MarkSpent(txin.prevout.n);
                     wtx.WriteToDisk(pwalletdb);
-                    NotifyTransactionChanged(this, txin.prevout.hash, CT_UPDATED);
+                    NotifyTransaction(txin.prevout.hash, CT_UPDATED);
                 }
             }
         }
@@ -457,7 +585,7 @@ void CWallet::WalletUpdateSpent(const CTransaction &tx, bool fBlock, CWalletDB*
                 {
                     wtx.MarkUnspent(&txout - &tx.vout[0]);
                     wtx.WriteToDisk(pwalletdb);
-                    NotifyTransactionChanged(this, hash, CT_UPDATED);
+                    NotifyTransaction(hash, CT_UPDATED);
                 }
             }
         }
@@ -471,7 +599,97 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (auto &item : mapWallet)
             item.second.MarkDirty();
+        MarkBalancesDirty();
+
+        // Ownership of outputs may have changed, so rebuild on next use:
+        setSpendable.clear();
+        fSpendableIndexed = false;
+        MarkOwnershipChanged();
+    }
+}
+
+bool CWallet::HasSpendableOutput(const CWalletTx& wtx) const
+{
+    for (unsigned int i = 0; i < wtx.vout.size(); i++)
+        if (!wtx.IsSpent(i) && IsMine(wtx.vout[i]) != ISMINE_NO)
+            return true;
+
+    return false;
+}
+
+GCSFilter::ElementSet CWallet::GetFilterElements() const
+{
+    GCSFilter::ElementSet elements;
+
+    std::set<CKeyID> setKeys;
+    GetKeys(setKeys);
+
+    for (const auto& keyID : setKeys)
+    {
+        CScript script;
+        script.SetDestination(keyID);
+        BlockFilter::AddScriptElements(script, elements);
+
+        CPubKey pubkey;
+        if (GetPubKey(keyID, pubkey))
+        {
+            // Pay-to-pubkey outputs, and bare multisig outputs that the
+            // filter indexes by each of their keys:
+            BlockFilter::AddScriptElements(CScript() << pubkey << OP_CHECKSIG, elements);
+            elements.insert(pubkey.Raw());
+        }
+    }
+
+    {
+        LOCK(cs_KeyStore);
+
+        for (const auto& script_pair : mapScripts)
+        {
+            CScript script;
+            script.SetDestination(script_pair.first);
+            BlockFilter::AddScriptElements(script, elements);
+            BlockFilter::AddScriptElements(script_pair.second, elements);
+        }
+    }
+
+    return elements;
+}
+
+const CWallet::SpendableIndex& CWallet::GetSpendableIndex() const
+{
+    AssertLockHeld(cs_wallet);
+
+    if (!fSpendableIndexed)
+    {
+        setSpendable.clear();
+
+        for (const auto& item : mapWallet)
+            if (HasSpendableOutput(item.second))
+                setSpendable.emplace(item.second.nTime, &item.second);
+
+        fSpendableIndexed = true;
     }
+
+    return setSpendable;
+}
+
+void CWallet::UpdateSpendableIndex(const CWalletTx& wtx) const
+{
+    LOCK(cs_wallet);
+
+    if (!fSpendableIndexed)
+        return;
+
+    // Only index the transaction objects owned by mapWallet. Copies of
+    // wallet transactions stay bound to the wallet but are not tracked:
+    map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(wtx.GetHash());
+    if (mi == mapWallet.end() || &mi->second != &wtx)
+        return;
+
+    if (HasSpendableOutput(wtx))
+        setSpendable.emplace(wtx.nTime, &wtx);
+    else
+        setSpendable.erase(std::make_pair(wtx.nTime, &wtx));
 }
 
 bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
@@ -489,6 +707,10 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
             wtx.nTimeReceived = GetAdjustedTime();
             wtx.nOrderPos = IncOrderPosNext(pwalletdb);
 
+            // Index the transaction unless the index needs a rebuild anyway:
+            if (wtxOrdered.size() + 1 == mapWallet.size())
+                wtxOrdered.emplace(wtx.nOrderPos, &wtx);
+
             wtx.nTimeSmart = wtx.nTimeReceived;
             if (!wtxIn.hashBlock.IsNull())
             {
@@ -500,14 +722,9 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
                     {
                         // Tolerate times up to the last timestamp in the wallet not more than 5 minutes into the future
                         int64_t latestTolerated = latestNow + 300;
-                        std::list<CAccountingEntry> acentries;
-                        TxItems txOrdered = OrderedTxItems(acentries);
-                        for (TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
-                        {
-                            CWalletTx *const pwtx = (*it).second.first;
+                        ForEachTxItemNewestFirst("", [&](CWalletTx* pwtx, CAccountingEntry* pacentry) {
                             if (pwtx == &wtx)
-                                continue;
-                            CAccountingEntry *const pacentry = (*it).second.second;
+                                return true;
                             int64_t nSmartTime;
                             if (pwtx)
                             {
@@ -522,9 +739,10 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
                                 latestEntry = nSmartTime;
                                 if (nSmartTime > latestNow)
                                     latestNow = nSmartTime;
-                                break;
+                                return false;
                             }
-                        }
+                            return true;
+                        });
                     }
 
                     unsigned int& blocktime = mapItem->second->nTime;
@@ -589,8 +807,23 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
         // since AddToWallet is called directly for self-originating transactions, check for consumption of own coins
         WalletUpdateSpent(wtx, (!wtxIn.hashBlock.IsNull()), pwalletdb);
 
+        if (fInsertedNew || fUpdated)
+            MarkBalancesDirty();
+
+        UpdateSpendableIndex(wtx);
+
+        if (fInsertedNew && fGroupingsIndexed)
+        {
+            // Transactions that arrived earlier may spend this one. Their
+            // inputs were unknown when they joined the groupings:
+            if (setGroupingMissingInputs.count(hash))
+                MarkGroupingsDirty();
+            else
+                AddToGroupings(wtx);
+        }
+
         // Notify UI of new or updated transaction
-        NotifyTransactionChanged(this, hash, fInsertedNew ? CT_NEW : CT_UPDATED);
+        NotifyTransaction(hash, fInsertedNew ? CT_NEW : CT_UPDATED);
 
         // notify an external script when a wallet transaction comes in or is updated
         std::string strCmd = GetArg("-walletnotify", "");
@@ -609,7 +842,7 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, CWalletDB* pwalletdb)
 // If fUpdate is true, existing transactions will be updated.
 bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate, bool fFindBlock)
 {
-    uint256 hash = tx.GetHash();
+    uint256 hash = tx.GetHash(true);
     {
         LOCK(cs_wallet);
         bool fExisted = mapWallet.count(hash);
@@ -617,7 +850,13 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 
         // Do not flush the wallet here for performance reasons
         // this is safe, as in case of a crash, we rescan the necessary blocks on startup.
-        CWalletDB walletdb(strWalletFile, "r+", false);
+        std::unique_ptr<CWalletDB> walletdbOwned;
+        CWalletDB* pwalletdb = pwalletdbBatch;
+        if (!pwalletdb)
+        {
+            walletdbOwned.reset(new CWalletDB(strWalletFile, "r+", false));
+            pwalletdb = walletdbOwned.get();
+        }
 
         if (fExisted || (IsMine(tx) != ISMINE_NO) || IsFromMe(tx))
         {
@@ -626,10 +865,10 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
             if (pblock)
                 wtx.SetMerkleBranch(pblock);
 
-            return AddToWallet(wtx, &walletdb);
+            return AddToWallet(wtx, pwalletdb);
         }
         else
-            WalletUpdateSpent(tx, false, &walletdb);
+            WalletUpdateSpent(tx, false, pwalletdb);
     }
     return false;
 }
@@ -640,8 +879,17 @@ bool CWallet::EraseFromWallet(uint256 hash)
         return false;
     {
         LOCK(cs_wallet);
+        map<uint256, CWalletTx>::iterator mi = mapWallet.find(hash);
+        if (mi != mapWallet.end())
+            setSpendable.erase(std::make_pair(mi->second.nTime, &mi->second));
         if (mapWallet.erase(hash))
+        {
+            MarkTxOrderDirty();
+
             CWalletDB(strWalletFile).EraseTx(hash);
+            MarkBalancesDirty();
+            MarkGroupingsDirty();
+        }
     }
     return true;
 }
@@ -678,6 +926,27 @@ int64_t CWallet::GetDebit(const CTxIn &txin,const isminefilter& filter) const
     return 0;
 }
 
+isminetype CWallet::IsMine(const CTxOut& txout) const
+{
+    {
+        LOCK(cs_IsMineCache);
+        const auto iter = mapIsMineCache.find(txout.scriptPubKey);
+        if (iter != mapIsMineCache.end())
+            return iter->second;
+    }
+
+    // Solving the script and looking up its keys happens outside of the
+    // cache lock, so that it does not wait on cs_KeyStore with the lock held:
+    const isminetype mine = ::IsMine(*this, txout.scriptPubKey);
+
+    LOCK(cs_IsMineCache);
+    if (mapIsMineCache.size() >= MAX_ISMINE_CACHE_SIZE)
+        mapIsMineCache.clear();
+    mapIsMineCache.emplace(txout.scriptPubKey, mine);
+
+    return mine;
+}
+
 bool CWallet::IsChange(const CTxOut& txout) const
 {
     CTxDestination address;
@@ -772,14 +1041,33 @@ CTxDestination GetCoinstakeDestination(const CWalletTx* wtx,CTxDB& txdb)
 void CWalletTx::GetAmounts(list<COutputEntry>& listReceived, list<COutputEntry>& listSent,
                            int64_t& nFee, string& strSentAccount,
                            const isminefilter& filter) const
+{
+    strSentAccount = strFromAccount;
+
+    if (!fAmountsCached
+        || nAmountsFilterCached != filter
+        || nAmountsRevisionCached != pwallet->GetOwnershipRevision())
+    {
+        ComputeAmounts(listReceivedCached, listSentCached, nFeeCached, filter);
+
+        fAmountsCached = true;
+        nAmountsFilterCached = filter;
+        nAmountsRevisionCached = pwallet->GetOwnershipRevision();
+    }
+
+    listReceived = listReceivedCached;
+    listSent = listSentCached;
+    nFee = nFeeCached;
+}
+
+void CWalletTx::ComputeAmounts(list<COutputEntry>& listReceived, list<COutputEntry>& listSent,
+                               int64_t& nFee, const isminefilter& filter) const
 {
     nFee = 0;
 
     listReceived.clear();
     listSent.clear();
 
-    strSentAccount = strFromAccount;
-
     // This is the same as nDebit > 0, i.e. we sent the transaction.
     bool fIsFromMe = IsFromMe();
 
@@ -1035,35 +1323,118 @@ bool CWalletTx::WriteToDisk(CWalletDB *pwalletdb)
 // Scan the block chain (starting in pindexStart) for transactions
 // from or to us. If fUpdate is true, found transactions that already
 // exist in the wallet will be updated.
+//
+// Blocks are read from disk on background threads while this thread applies
+// them to the wallet in chain order. When -blockfilterindex is enabled, the
+// scan skips blocks whose compact filters match none of the wallet's scripts. When the wallet already recorded progress
+// up to pindexStart, the scan saves a checkpoint of its own progress as the
+// wallet's best block. If the node shuts down during the scan, the rescan on
+// the next start resumes where this one stopped.
 int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate)
 {
     int ret = 0;
 
-    CBlockIndex* pindex = pindexStart;
     {
         LOCK2(cs_main, cs_wallet);
-        while (pindex)
+        CWalletWriteBatch batch(*this);
+
+        std::vector<const CBlockIndex*> vBlocks;
+        const CBlockIndex* pindexLast = nullptr;
+
+        // With the compact block filter index, skip the blocks that cannot
+        // contain transactions involving the wallet:
+        GCSFilter::ElementSet filterElements;
+        std::unique_ptr<CTxDB> txdb;
+
+        if (fBlockFilterIndex)
         {
+            filterElements = GetFilterElements();
+            txdb.reset(new CTxDB("r"));
+        }
+
+        for (const CBlockIndex* pindex = pindexStart; pindex; pindex = pindex->pnext)
+        {
+            pindexLast = pindex;
+
             // no need to read and scan block, if block was created before
             // our wallet birthday (as adjusted for block time variability)
-            if (nTimeFirstKey && (pindex->nTime < (nTimeFirstKey - 7200))) {
-                pindex = pindex->pnext;
+            if (nTimeFirstKey && (pindex->nTime < (nTimeFirstKey - 7200)))
+                continue;
+
+            // Blocks connected before the filter index was enabled have no
+            // filter. We need to read these:
+            BlockFilter filter;
+            if (txdb
+                && txdb->ReadBlockFilter(pindex->GetBlockHash(), filter)
+                && !filter.GetFilter().MatchAny(filterElements))
+            {
                 continue;
             }
 
+            vBlocks.push_back(pindex);
+        }
+
+        if (vBlocks.empty())
+            return ret;
+
+        // Only move the wallet's best block backward to record progress when
+        // it does not leave a gap of blocks that the wallet never scanned:
+        bool fCheckpoint = false;
+
+        if (fFileBacked && pindexStart)
+        {
+            CBlockLocator locator;
+            if (CWalletDB(strWalletFile).ReadBestBlock(locator))
+            {
+                const CBlockIndex* pindexWalletBest = locator.GetBlockIndex();
+                fCheckpoint = pindexWalletBest && pindexWalletBest->nHeight + 1 >= pindexStart->nHeight;
+            }
+        }
+
+        GRC::BlockPrefetcher prefetcher(vBlocks);
+        const CBlockIndex* pindexScanned = nullptr;
+
+        for (size_t i = 0; i < prefetcher.size(); ++i)
+        {
+            if (ShutdownRequested())
+            {
+                LogPrintf("%s: interrupted at block %d", __func__, vBlocks[i]->nHeight);
+                pindexLast = pindexScanned;
+                break;
+            }
+
             CBlock block;
-            block.ReadFromDisk(pindex, true);
+            if (!prefetcher.Take(block))
+                error("%s: failed to read block %d", __func__, vBlocks[i]->nHeight);
+
             for (auto const& tx : block.vtx)
             {
                 if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
                     ret++;
             }
-            pindex = pindex->pnext;
+
+            pindexScanned = vBlocks[i];
+
+            if (fCheckpoint && (i + 1) % RESCAN_CHECKPOINT_INTERVAL == 0)
+                SetBestChain(CBlockLocator(pindexScanned));
         }
+
+        if (fCheckpoint && pindexLast)
+            SetBestChain(CBlockLocator(pindexLast));
     }
+
     return ret;
 }
 
+namespace {
+//!
+//! \brief Most blocks that ReacceptWalletTransactions() reads to find the
+//! transactions that changed since its last check. A wallet that missed more
+//! blocks than this checks every transaction instead.
+//!
+constexpr int MAX_SPENT_CHECK_BLOCKS = 5000;
+} // anonymous namespace
+
 void CWallet::ReacceptWalletTransactions()
 {
     CTxDB txdb("r");
@@ -1073,16 +1444,103 @@ void CWallet::ReacceptWalletTransactions()
         LOCK2(cs_main, cs_wallet);
         fRepeat = false;
         vector<CDiskTxPos> vMissingTx;
+
+        // The index can only disagree with the spent flags of the wallet for
+        // outputs spent by blocks connected after the last check and for the
+        // transactions added to the wallet since then, such as the ones that
+        // a rescan finds. Transactions that no block contains are re-accepted
+        // every time. When the block of the last check is still in the main
+        // chain, read the blocks since then to find the transactions that they
+        // spend from instead of looking up every transaction in the wallet:
+        //
+        std::set<uint256> setSpentSince;
+        bool fIncremental = false;
+        uint256 hashCheckBlock;
+        int64_t nCheckOrderPos = 0;
+
+        if (fFileBacked && CWalletDB(strWalletFile).ReadSpentCheck(hashCheckBlock, nCheckOrderPos))
+        {
+            const auto mi = mapBlockIndex.find(hashCheckBlock);
+
+            if (mi != mapBlockIndex.end()
+                && mi->second->IsInMainChain()
+                && nBestHeight - mi->second->nHeight <= MAX_SPENT_CHECK_BLOCKS)
+            {
+                std::vector<const CBlockIndex*> vBlocks;
+                for (const CBlockIndex* pindex = mi->second->pnext; pindex; pindex = pindex->pnext)
+                    vBlocks.push_back(pindex);
+
+                GRC::BlockPrefetcher prefetcher(vBlocks);
+                fIncremental = true;
+
+                for (size_t i = 0; i < prefetcher.size(); ++i)
+                {
+                    CBlock block;
+                    if (!prefetcher.Take(block))
+                    {
+                        error("%s: failed to read block %d", __func__, vBlocks[i]->nHeight);
+                        fIncremental = false;
+                        break;
+                    }
+
+                    for (const auto& tx : block.vtx)
+                        for (const auto& txin : tx.vin)
+                            if (mapWallet.count(txin.prevout.hash))
+                                setSpentSince.insert(txin.prevout.hash);
+                }
+            }
+        }
+
+        std::vector<CWalletTx*> vCheck;
+        vCheck.reserve(fIncremental ? setSpentSince.size() : mapWallet.size());
+
         for (auto &item : mapWallet)
         {
             CWalletTx& wtx = item.second;
             if ((wtx.IsCoinBase() && wtx.IsSpent(0)) || (wtx.IsCoinStake() && wtx.IsSpent(1)))
                 continue;
 
-            CTxIndex txindex;
+            if (fIncremental
+                && wtx.nOrderPos >= 0
+                && wtx.nOrderPos < nCheckOrderPos
+                && !setSpentSince.count(item.first)
+                && wtx.GetDepthInMainChain() > 0)
+            {
+                continue;
+            }
+
+            vCheck.push_back(&wtx);
+        }
+
+        LogPrintf("%s: checking %" PRIszu " of %" PRIszu " transactions%s",
+            __func__, vCheck.size(), mapWallet.size(), fIncremental ? " changed since the last check" : "");
+
+        std::vector<uint256> vHashes;
+        vHashes.reserve(vCheck.size());
+        for (const auto& pwtx : vCheck)
+            vHashes.push_back(pwtx->GetHash());
+
+        std::map<uint256, CTxIndex> mapTxIndex;
+        try
+        {
+            mapTxIndex = CTxDB::ReadTxIndexesAsync(std::move(vHashes)).get();
+        }
+        catch (const std::exception& e)
+        {
+            error("%s: failed to read the transaction index: %s", __func__, e.what());
+            return;
+        }
+
+        for (auto const& pwtx : vCheck)
+        {
+            CWalletTx& wtx = *pwtx;
+
             bool fUpdated = false;
-            if (txdb.ReadTxIndex(wtx.GetHash(), txindex))
+            const auto txindex_iter = mapTxIndex.find(wtx.GetHash());
+            if (txindex_iter != mapTxIndex.end())
             {
+                const CTxIndex& txindex = txindex_iter->second;
+
                 // Update fSpent if a tx got spent somewhere else by a copy of wallet.dat
                 if (txindex.vSpent.size() != wtx.vout.size())
                 {
@@ -1123,6 +1581,10 @@ void CWallet::ReacceptWalletTransactions()
             if (ScanForWalletTransactions(pindexGenesisBlock))
                 fRepeat = true;  // Found missing transactions: re-do re-accept.
         }
+        else if (fFileBacked)
+        {
+            CWalletDB(strWalletFile).WriteSpentCheck(hashBestChain, nOrderPosNext);
+        }
     }
 }
 
@@ -1243,50 +1705,135 @@ void CWallet::ResendWalletTransactions(bool fForce)
 //
 
 
-int64_t CWallet::GetBalance() const
+const CWallet::BalanceTotals& CWallet::GetBalanceTotals() const
 {
-    int64_t nTotal = 0;
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    // The balances depend on the depth of each transaction in the chain and
+    // on whether unconfirmed transactions remain in the memory pool, so we
+    // also recalculate them when either of these changes:
+    const unsigned int nMempoolUpdated = mempool.GetTransactionsUpdated();
+
+    if (fBalancesCached
+        && pindexBalancesCached == pindexBest
+        && nMempoolBalancesCached == nMempoolUpdated)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx* pcoin = &(*it).second;
-            if (pcoin->IsTrusted() && (pcoin->IsConfirmed() || pcoin->fFromMe))
-                nTotal += pcoin->GetAvailableCredit();
-        }
+        return cachedBalances;
+    }
+
+    BalanceTotals totals = { 0, 0, 0, 0 };
+
+    // Transactions with time-based lock times become final without a change
+    // to the wallet or the chain tip, so their totals cannot be cached:
+    bool fCacheable = true;
+
+    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+    {
+        const CWalletTx* pcoin = &(*it).second;
+        const bool fFinal = IsFinalTx(*pcoin);
+
+        if (!fFinal)
+            fCacheable = false;
+
+        if (pcoin->IsTrusted() && (pcoin->IsConfirmed() || pcoin->fFromMe))
+            totals.nBalance += pcoin->GetAvailableCredit();
+
+        if (!fFinal || (!pcoin->IsConfirmed() && !pcoin->fFromMe && pcoin->IsInMainChain()))
+            totals.nUnconfirmed += pcoin->GetAvailableCredit();
+
+        if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0 && pcoin->IsInMainChain())
+            totals.nImmature += GetCredit(*pcoin);
+
+        if (pcoin->IsCoinStake() && pcoin->GetBlocksToMaturity() > 0 && pcoin->GetDepthInMainChain() > 0)
+            totals.nStake += GetCredit(*pcoin);
     }
 
-    return nTotal;
+    cachedBalances = totals;
+    fBalancesCached = fCacheable;
+    pindexBalancesCached = pindexBest;
+    nMempoolBalancesCached = nMempoolUpdated;
+
+    return cachedBalances;
 }
 
-int64_t CWallet::GetUnconfirmedBalance() const
+int64_t CWallet::GetBalance() const
 {
-    int64_t nTotal = 0;
+    LOCK2(cs_main, cs_wallet);
+
+    return GetBalanceTotals().nBalance;
+}
+
+int64_t CWallet::GetStakeWeight(int64_t nTime) const
+{
+    LOCK2(cs_main, cs_wallet);
+
+    const int64_t nBalanceToConsider = GetBalanceTotals().nBalance - nReserveBalance;
+    const unsigned int nMempoolUpdated = mempool.GetTransactionsUpdated();
+
+    if (!fStakeWeightCached
+        || pindexStakeWeightCached != pindexBest
+        || nMempoolStakeWeightCached != nMempoolUpdated
+        || nBalanceStakeWeightCached != nBalanceToConsider
+        || nTime < nTimeStakeWeightCached)
     {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        queueStakeMaturity = StakeMaturityQueue();
+        nStakeWeightMatured = 0;
+
+        // The same outputs that SelectCoinsForStaking() chooses from, before
+        // the stake age filter:
+        if (nBalanceToConsider > 0)
         {
-            const CWalletTx* pcoin = &(*it).second;
-            if (!IsFinalTx(*pcoin) || (!pcoin->IsConfirmed() && !pcoin->fFromMe && pcoin->IsInMainChain()))
-                nTotal += pcoin->GetAvailableCredit();
+            for (const auto& entry : GetSpendableIndex())
+            {
+                const CWalletTx* pcoin = entry.second;
+
+                if (pcoin->GetBlocksToMaturity() > 0 || pcoin->GetDepthInMainChain() < 1)
+                    continue;
+
+                for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+                {
+                    const int64_t nValue = pcoin->vout[i].nValue;
+
+                    if (!pcoin->IsSpent(i) && IsMine(pcoin->vout[i]) != ISMINE_NO
+                        && nValue >= nMinimumInputValue && nValue > 0 && nValue <= nBalanceToConsider)
+                    {
+                        queueStakeMaturity.emplace(pcoin->nTime, nValue);
+                    }
+                }
+            }
         }
+
+        fStakeWeightCached = true;
+        pindexStakeWeightCached = pindexBest;
+        nMempoolStakeWeightCached = nMempoolUpdated;
+        nBalanceStakeWeightCached = nBalanceToConsider;
     }
-    return nTotal;
+
+    // Outputs count toward the weight once older than the minimum stake age:
+    while (!queueStakeMaturity.empty() && nTime - queueStakeMaturity.top().first > nStakeMinAge)
+    {
+        nStakeWeightMatured += queueStakeMaturity.top().second;
+        queueStakeMaturity.pop();
+    }
+
+    nTimeStakeWeightCached = nTime;
+
+    return nStakeWeightMatured;
+}
+
+int64_t CWallet::GetUnconfirmedBalance() const
+{
+    LOCK2(cs_main, cs_wallet);
+
+    return GetBalanceTotals().nUnconfirmed;
 }
 
 int64_t CWallet::GetImmatureBalance() const
 {
-    int64_t nTotal = 0;
-    {
-        LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-        {
-            const CWalletTx& pcoin = (*it).second;
-            if (pcoin.IsCoinBase() && pcoin.GetBlocksToMaturity() > 0 && pcoin.IsInMainChain())
-                nTotal += GetCredit(pcoin);
-        }
-    }
-    return nTotal;
+    LOCK2(cs_main, cs_wallet);
+
+    return GetBalanceTotals().nImmature;
 }
 
 // populate vCoins with vector of spendable COutputs
@@ -1296,9 +1843,9 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
 
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const auto& entry : GetSpendableIndex())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = entry.second;
 			int nDepth = pcoin->GetDepthInMainChain();
 
 			if (!fIncludeStakedCoins)
@@ -1326,7 +1873,7 @@ void CWallet::AvailableCoins(vector<COutput>& vCoins, bool fOnlyConfirmed, const
             for (unsigned int i = 0; i < pcoin->vout.size(); i++)
 			{
                 if ((!(pcoin->IsSpent(i)) && (IsMine(pcoin->vout[i]) != ISMINE_NO) && pcoin->vout[i].nValue >= nMinimumInputValue &&
-                   (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected((*it).first, i)))
+                   (!coinControl || !coinControl->HasSelected() || coinControl->IsSelected(pcoin->GetHash(), i)))
 	     	 	   || (fIncludeStakedCoins && pcoin->IsCoinStake() && pcoin->GetBlocksToMaturity() > 0 && pcoin->GetDepthInMainChain() > 0))
 				   {
 				        vCoins.push_back(COutput(pcoin, i, nDepth));
@@ -1343,13 +1890,14 @@ void CWallet::AvailableCoinsForStaking(vector<COutput>& vCoins, unsigned int nSp
     vCoins.clear();
     {
         LOCK2(cs_main, cs_wallet);
-        for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
+        for (const auto& entry : GetSpendableIndex())
         {
-            const CWalletTx* pcoin = &(*it).second;
+            const CWalletTx* pcoin = entry.second;
 
-            // Filtering by tx timestamp instead of block timestamp may give false positives but never false negatives
+            // Filtering by tx timestamp instead of block timestamp may give false positives but never false negatives.
+            // The index is ordered by tx timestamp, so no later entries can meet the minimum stake age either:
             if (pcoin->nTime + nStakeMinAge > nSpendTime)
-                continue;
+                break;
 
             if (pcoin->GetBlocksToMaturity() > 0)
                 continue;
@@ -1365,47 +1913,74 @@ void CWallet::AvailableCoinsForStaking(vector<COutput>& vCoins, unsigned int nSp
     }
 }
 
-static void ApproximateBestSubset(vector<pair<int64_t, pair<const CWalletTx*,unsigned int> > >vValue, int64_t nTotalLower, int64_t nTargetValue,
-                                  vector<char>& vfBest, int64_t& nBest, int iterations = 1000)
+//
+// Find the subset of vValue with the smallest total that reaches nTargetValue
+// by a depth-first branch-and-bound search. vValue must be sorted by value in
+// descending order. Each try visits one node of the search tree. When the
+// budget runs out, vfBest and nBest hold the best subset found so far, or all
+// of the coins if the search found nothing better.
+//
+static void SelectBranchAndBound(const vector<pair<int64_t, pair<const CWalletTx*,unsigned int> > >& vValue, int64_t nTotalLower, int64_t nTargetValue,
+                                 vector<char>& vfBest, int64_t& nBest, unsigned int nMaxTries)
 {
     vector<char> vfIncluded;
+    vfIncluded.reserve(vValue.size());
 
     vfBest.assign(vValue.size(), true);
     nBest = nTotalLower;
 
-    seed_insecure_rand();
+    int64_t nTotal = 0;
+    int64_t nRemaining = nTotalLower; // value of the coins not yet decided
 
-    for (int nRep = 0; nRep < iterations && nBest != nTargetValue; nRep++)
+    for (unsigned int nTry = 0; nTry < nMaxTries && nBest != nTargetValue; nTry++)
     {
-        vfIncluded.assign(vValue.size(), false);
-        int64_t nTotal = 0;
-        bool fReachedTarget = false;
-        for (int nPass = 0; nPass < 2 && !fReachedTarget; nPass++)
+        bool fBacktrack = false;
+
+        if (nTotal + nRemaining < nTargetValue || nTotal >= nBest)
         {
-            for (unsigned int i = 0; i < vValue.size(); i++)
+            // This branch cannot reach the target or improve on the best:
+            fBacktrack = true;
+        }
+        else if (nTotal >= nTargetValue)
+        {
+            // Adding more coins can only increase the total:
+            nBest = nTotal;
+            vfBest = vfIncluded;
+            vfBest.resize(vValue.size(), false);
+            fBacktrack = true;
+        }
+
+        if (fBacktrack)
+        {
+            // Walk back to the last included coin and try the branch that
+            // excludes it:
+            while (!vfIncluded.empty() && !vfIncluded.back())
             {
-                //The solver here uses a randomized algorithm,
-                //the randomness serves no real security purpose but is just
-                //needed to prevent degenerate behavior and it is important
-                //that the rng fast. We do not use a constant random sequence,
-                //because there may be some privacy improvement by making
-                //the selection random.
-                if (nPass == 0 ? insecure_rand()&1 : !vfIncluded[i])
-                {
-                    nTotal += vValue[i].first;
-                    vfIncluded[i] = true;
-                    if (nTotal >= nTargetValue)
-                    {
-                        fReachedTarget = true;
-                        if (nTotal < nBest)
-                        {
-                            nBest = nTotal;
-                            vfBest = vfIncluded;
-                        }
-                        nTotal -= vValue[i].first;
-                        vfIncluded[i] = false;
-                    }
-                }
+                vfIncluded.pop_back();
+                nRemaining += vValue[vfIncluded.size()].first;
+            }
+
+            if (vfIncluded.empty())
+                break; // searched the whole tree
+
+            vfIncluded.back() = false;
+            nTotal -= vValue[vfIncluded.size() - 1].first;
+        }
+        else
+        {
+            const size_t i = vfIncluded.size();
+            nRemaining -= vValue[i].first;
+
+            // Including a coin equal in value to one just excluded produces
+            // a subset that the search already explored:
+            if (!vfIncluded.empty() && !vfIncluded.back() && vValue[i].first == vValue[i - 1].first)
+            {
+                vfIncluded.push_back(false);
+            }
+            else
+            {
+                vfIncluded.push_back(true);
+                nTotal += vValue[i].first;
             }
         }
     }
@@ -1414,28 +1989,17 @@ static void ApproximateBestSubset(vector<pair<int64_t, pair<const CWalletTx*,uns
 // ppcoin: total coins staked (non-spendable until maturity)
 int64_t CWallet::GetStake() const
 {
-    int64_t nTotal = 0;
     LOCK2(cs_main, cs_wallet);
-    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-    {
-        const CWalletTx* pcoin = &(*it).second;
-        if (pcoin->IsCoinStake() && pcoin->GetBlocksToMaturity() > 0 && pcoin->GetDepthInMainChain() > 0)
-            nTotal += CWallet::GetCredit(*pcoin);
-    }
-    return nTotal;
+
+    return GetBalanceTotals().nStake;
 }
 
 int64_t CWallet::GetNewMint() const
 {
-    int64_t nTotal = 0;
+    // Same as GetStake(): Gridcoin has no proof-of-work minting.
     LOCK2(cs_main, cs_wallet);
-    for (map<uint256, CWalletTx>::const_iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
-    {
-        const CWalletTx* pcoin = &(*it).second;
-        if (pcoin->IsCoinStake() && pcoin->GetBlocksToMaturity() > 0 && pcoin->GetDepthInMainChain() > 0)
-            nTotal += CWallet::GetCredit(*pcoin);
-    }
-    return nTotal;
+
+    return GetBalanceTotals().nStake;
 }
 
 // This comparator is needed since std::sort alone cannot sort COutput
@@ -1517,16 +2081,18 @@ bool CWallet::SelectCoinsMinConf(int64_t nTargetValue, unsigned int nSpendTime,
         return true;
     }
 
-    // Solve subset sum by stochastic approximation
-    sort(vValue.rbegin(), vValue.rend(), CompareValueOnly());
+    // Solve subset sum by branch and bound. The stable sort keeps the
+    // shuffled order of equal coins so that ties do not always select the
+    // same outputs:
+    stable_sort(vValue.rbegin(), vValue.rend(), CompareValueOnly());
     vector<char> vfBest;
     int64_t nBest;
 
-    ApproximateBestSubset(vValue, nTotalLower, nTargetValue, vfBest, nBest, 1000);
+    SelectBranchAndBound(vValue, nTotalLower, nTargetValue, vfBest, nBest, nCoinSelectionTries);
     if (nBest != nTargetValue && nTotalLower >= nTargetValue + CENT)
-        ApproximateBestSubset(vValue, nTotalLower, nTargetValue + CENT, vfBest, nBest, 1000);
+        SelectBranchAndBound(vValue, nTotalLower, nTargetValue + CENT, vfBest, nBest, nCoinSelectionTries);
 
-    // If we have a bigger coin and (either the stochastic approximation didn't find a good solution,
+    // If we have a bigger coin and (either the subset search didn't find a good solution,
     //                                   or the next bigger coin is closer), return the bigger coin
     if (coinLowestLarger.second.first &&
         ((nBest != nTargetValue && nBest < nTargetValue + CENT) || coinLowestLarger.first <= nBest))
@@ -1854,11 +2420,14 @@ bool CWallet::CreateTransaction(const vector<pair<CScript, int64_t> >& vecSend,
                     wtxNew.vin.push_back(CTxIn(coin.first->GetHash(),coin.second));
 
                 // Sign
-                int nIn = 0;
+                std::vector<CScript> vPrevScripts;
+                vPrevScripts.reserve(setCoins.size());
                 for (auto const& coin : setCoins)
-                    if (!SignSignature(*this, *coin.first, wtxNew, nIn++)) {
-                        return error("%s: Failed to sign tx", __func__);
-                    }
+                    vPrevScripts.push_back(coin.first->vout[coin.second].scriptPubKey);
+
+                if (!SignSignatures(*this, vPrevScripts, wtxNew)) {
+                    return error("%s: Failed to sign tx", __func__);
+                }
 
                 // Limit size
                 unsigned int nBytes = ::GetSerializeSize(*(CTransaction*)&wtxNew, SER_NETWORK, PROTOCOL_VERSION);
@@ -1939,7 +2508,7 @@ bool CWallet::CommitTransaction(CWalletTx& wtxNew, CReserveKey& reservekey)
                 coin.BindWallet(this);
                 coin.MarkSpent(txin.prevout.n);
                 coin.WriteToDisk(pwalletdb);
-                NotifyTransactionChanged(this, coin.GetHash(), CT_UPDATED);
+                NotifyTransaction(coin.GetHash(), CT_UPDATED);
             }
 
             if (fFileBacked)
@@ -2070,6 +2639,11 @@ DBErrors CWallet::ZapWalletTx(std::vector<CWalletTx>& vWtx)
     if (nZapWalletTxRet != DB_LOAD_OK)
         return nZapWalletTxRet;
 
+    {
+        LOCK(cs_wallet);
+        MarkGroupingsDirty();
+    }
+
     return DB_LOAD_OK;
 }
 
@@ -2083,6 +2657,9 @@ bool CWallet::SetAddressBookName(const CTxDestination& address, const string& st
         std::map<CTxDestination, std::string>::iterator mi = mapAddressBook.find(address);
         fUpdated = mi != mapAddressBook.end();
         mapAddressBook[address] = strName;
+
+        // Addresses in the address book no longer count as change:
+        MarkOwnershipChanged();
     }
     NotifyAddressBookChanged(this, address, strName, (::IsMine(*this, address) != ISMINE_NO),
                              (fUpdated ? CT_UPDATED : CT_NEW) );
@@ -2097,6 +2674,7 @@ bool CWallet::DelAddressBookName(const CTxDestination& address)
         LOCK(cs_wallet); // mapAddressBook
 
         mapAddressBook.erase(address);
+        MarkOwnershipChanged();
     }
 
     NotifyAddressBookChanged(this, address, "", (::IsMine(*this, address) != ISMINE_NO), CT_DELETED);
@@ -2187,7 +2765,9 @@ bool CWallet::TopUpKeyPool(unsigned int nSize)
         if (IsLocked())
             return false;
 
-        CWalletDB walletdb(strWalletFile);
+        // Write the generated keys and the pool entries in one batch:
+        CWalletWriteBatch batch(*this);
+        CWalletDB& walletdb = *pwalletdbBatch;
 
         // Top up key pool
         unsigned int nTargetSize;
@@ -2210,6 +2790,90 @@ bool CWallet::TopUpKeyPool(unsigned int nSize)
     return true;
 }
 
+namespace {
+unsigned int GetKeyPoolTargetSize()
+{
+    return max(GetArg("-keypool", 100), (int64_t)0);
+}
+
+} // anonymous namespace
+
+void CWallet::RequestKeyPoolRefill()
+{
+    AssertLockHeld(cs_wallet);
+
+    const int64_t nLowWater = GetArg("-keypoollowwater", GetKeyPoolTargetSize() / 2);
+
+    if (!fFileBacked || IsLocked() || (int64_t)setKeyPool.size() > nLowWater)
+        return;
+
+    if (fKeyPoolRefillStopped || fKeyPoolRefilling.exchange(true))
+        return;
+
+    // The previous refill already cleared the flag and takes no more locks:
+    if (threadKeyPoolRefill.joinable())
+        threadKeyPoolRefill.join();
+
+    try
+    {
+        threadKeyPoolRefill = boost::thread([this]() {
+            // Make this thread recognisable as the key-topping-up thread
+            RenameThread("grc-key-top");
+
+            RefillKeyPool();
+        });
+    }
+    catch (const boost::thread_resource_error& e)
+    {
+        LogPrintf("RequestKeyPoolRefill() : %s", e.what());
+        fKeyPoolRefilling = false;
+    }
+}
+
+void CWallet::StopKeyPoolRefill()
+{
+    {
+        LOCK(cs_wallet);
+        fKeyPoolRefillStopped = true;
+    }
+
+    // No other thread replaces the refill thread once the flag is set:
+    threadKeyPoolRefill.interrupt();
+
+    if (threadKeyPoolRefill.joinable())
+        threadKeyPoolRefill.join();
+}
+
+void CWallet::RefillKeyPool()
+{
+    try
+    {
+        while (!fShutdown)
+        {
+            boost::this_thread::interruption_point();
+
+            LOCK(cs_wallet);
+
+            const unsigned int nTargetSize = GetKeyPoolTargetSize();
+
+            if (IsLocked() || setKeyPool.size() >= nTargetSize + 1)
+                break;
+
+            // TopUpKeyPool() fills up to one more key than the size passed:
+            TopUpKeyPool(std::min<unsigned int>(nTargetSize, setKeyPool.size() + KEYPOOL_REFILL_BATCH_SIZE - 1));
+        }
+    }
+    catch (const boost::thread_interrupted&)
+    {
+    }
+    catch (std::exception& e)
+    {
+        LogPrintf("RefillKeyPool() : %s", e.what());
+    }
+
+    fKeyPoolRefilling = false;
+}
+
 void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
 {
     nIndex = -1;
@@ -2218,7 +2882,14 @@ void CWallet::ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool)
         LOCK(cs_wallet);
 
         if (!IsLocked())
-            TopUpKeyPool();
+        {
+            // Generate a key while the caller waits only if the pool ran dry.
+            // Otherwise the background refill keeps the pool topped up:
+            if (setKeyPool.empty())
+                TopUpKeyPool(1);
+
+            RequestKeyPoolRefill();
+        }
 
         // Get the oldest key
         if(setKeyPool.empty())
@@ -2311,124 +2982,178 @@ int64_t CWallet::GetOldestKeyPoolTime()
 
 std::map<CTxDestination, int64_t> CWallet::GetAddressBalances()
 {
+    LOCK2(cs_main, cs_wallet);
+
+    // Like the wallet balances, these depend on the depth of each transaction
+    // and on the memory pool for unconfirmed transactions:
+    const unsigned int nMempoolUpdated = mempool.GetTransactionsUpdated();
+
+    if (fAddressBalancesCached
+        && pindexAddressBalancesCached == pindexBest
+        && nMempoolAddressBalancesCached == nMempoolUpdated)
+    {
+        return cachedAddressBalances;
+    }
+
     map<CTxDestination, int64_t> balances;
+    bool fCacheable = true;
 
+    for (const auto& walletEntry : mapWallet)
     {
-        LOCK(cs_wallet);
-        for (auto walletEntry : mapWallet)
-        {
-            CWalletTx *pcoin = &walletEntry.second;
+        const CWalletTx *pcoin = &walletEntry.second;
 
-            if (!IsFinalTx(*pcoin) || !pcoin->IsTrusted())
-                continue;
+        if (!IsFinalTx(*pcoin))
+        {
+            // Becomes final with time alone. See GetBalanceTotals().
+            fCacheable = false;
+            continue;
+        }
 
-            if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0)
-                continue;
+        if (!pcoin->IsTrusted())
+            continue;
 
-            int nDepth = pcoin->GetDepthInMainChain();
-            if (nDepth < (pcoin->IsFromMe() ? 0 : 1))
-                continue;
+        if ((pcoin->IsCoinBase() || pcoin->IsCoinStake()) && pcoin->GetBlocksToMaturity() > 0)
+            continue;
 
-            for (unsigned int i = 0; i < pcoin->vout.size(); i++)
-            {
-                CTxDestination addr;
-                if (IsMine(pcoin->vout[i]) == ISMINE_NO)
-                    continue;
-                if(!ExtractDestination(pcoin->vout[i].scriptPubKey, addr))
-                    continue;
+        int nDepth = pcoin->GetDepthInMainChain();
+        if (nDepth < (pcoin->IsFromMe() ? 0 : 1))
+            continue;
 
-                int64_t n = pcoin->IsSpent(i) ? 0 : pcoin->vout[i].nValue;
+        for (unsigned int i = 0; i < pcoin->vout.size(); i++)
+        {
+            CTxDestination addr;
+            if (IsMine(pcoin->vout[i]) == ISMINE_NO)
+                continue;
+            if(!ExtractDestination(pcoin->vout[i].scriptPubKey, addr))
+                continue;
 
-                if (!balances.count(addr))
-                    balances[addr] = 0;
-                balances[addr] += n;
-            }
+            balances[addr] += pcoin->IsSpent(i) ? 0 : pcoin->vout[i].nValue;
         }
     }
 
+    cachedAddressBalances = balances;
+    fAddressBalancesCached = fCacheable;
+    pindexAddressBalancesCached = pindexBest;
+    nMempoolAddressBalancesCached = nMempoolUpdated;
+
     return balances;
 }
 
-set< set<CTxDestination> > CWallet::GetAddressGroupings()
+CTxDestination CWallet::FindGroupingRoot(const CTxDestination& address) const
 {
-    AssertLockHeld(cs_wallet); // mapWallet
-    set< set<CTxDestination> > groupings;
-    set<CTxDestination> grouping;
+    AssertLockHeld(cs_wallet);
+
+    map<CTxDestination, CTxDestination>::iterator it = mapGroupingParents.find(address);
+
+    if (it == mapGroupingParents.end())
+    {
+        mapGroupingParents.emplace(address, address);
+        return address;
+    }
 
-    for (auto walletEntry : mapWallet)
+    // Walk to the root and halve the path on the way:
+    while (!(it->second == it->first))
     {
-        CWalletTx *pcoin = &walletEntry.second;
+        map<CTxDestination, CTxDestination>::iterator parent = mapGroupingParents.find(it->second);
+        it->second = parent->second;
+        it = mapGroupingParents.find(it->second);
+    }
+
+    return it->first;
+}
 
-        if (pcoin->vin.size() > 0 && (IsMine(pcoin->vin[0]) != ISMINE_NO))
+void CWallet::AddToGroupings(const CWalletTx& wtx) const
+{
+    AssertLockHeld(cs_wallet);
+
+    if (!wtx.vin.empty())
+    {
+        map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(wtx.vin[0].prevout.hash);
+
+        // The transaction counts as ours only while its first input is known:
+        if (mi == mapWallet.end())
+            setGroupingMissingInputs.insert(wtx.vin[0].prevout.hash);
+        else if (IsMine(wtx.vin[0]) != ISMINE_NO)
         {
-            // group all input addresses with each other
-            for (auto const& txin : pcoin->vin)
+            // group all input addresses with each other, and change with the
+            // input addresses
+            std::vector<CTxDestination> grouping;
+
+            for (auto const& txin : wtx.vin)
             {
+                map<uint256, CWalletTx>::const_iterator prev = mapWallet.find(txin.prevout.hash);
+
+                if (prev == mapWallet.end())
+                {
+                    setGroupingMissingInputs.insert(txin.prevout.hash);
+                    continue;
+                }
+
                 CTxDestination address;
-                if(!ExtractDestination(mapWallet[txin.prevout.hash].vout[txin.prevout.n].scriptPubKey, address))
+                if (txin.prevout.n >= prev->second.vout.size()
+                    || !ExtractDestination(prev->second.vout[txin.prevout.n].scriptPubKey, address))
+                {
                     continue;
-                grouping.insert(address);
+                }
+
+                grouping.push_back(address);
             }
 
-            // group change with input addresses
-            for (auto const& txout : pcoin->vout)
-                if (IsChange(txout))
+            for (auto const& txout : wtx.vout)
+            {
+                CTxDestination txoutAddr;
+                if (IsChange(txout) && ExtractDestination(txout.scriptPubKey, txoutAddr))
+                    grouping.push_back(txoutAddr);
+            }
+
+            if (!grouping.empty())
+            {
+                const CTxDestination root = FindGroupingRoot(grouping.front());
+
+                for (auto const& address : grouping)
                 {
-                    CWalletTx tx = mapWallet[pcoin->vin[0].prevout.hash];
-                    CTxDestination txoutAddr;
-                    if(!ExtractDestination(txout.scriptPubKey, txoutAddr))
-                        continue;
-                    grouping.insert(txoutAddr);
+                    const CTxDestination other = FindGroupingRoot(address);
+
+                    if (!(other == root))
+                        mapGroupingParents[other] = root;
                 }
-            groupings.insert(grouping);
-            grouping.clear();
+            }
         }
+    }
 
-        // group lone addrs by themselves
-        for (unsigned int i = 0; i < pcoin->vout.size(); i++)
-            if (IsMine(pcoin->vout[i]) != ISMINE_NO)
-            {
-                CTxDestination address;
-                if(!ExtractDestination(pcoin->vout[i].scriptPubKey, address))
-                    continue;
-                grouping.insert(address);
-                groupings.insert(grouping);
-                grouping.clear();
-            }
+    // group lone addrs by themselves
+    for (auto const& txout : wtx.vout)
+    {
+        CTxDestination address;
+        if (IsMine(txout) != ISMINE_NO && ExtractDestination(txout.scriptPubKey, address))
+            FindGroupingRoot(address);
     }
+}
 
-    set< set<CTxDestination>* > uniqueGroupings; // a set of pointers to groups of addresses
-    map< CTxDestination, set<CTxDestination>* > setmap;  // map addresses to the unique group containing it
-    for (auto const& grouping : groupings)
+set< set<CTxDestination> > CWallet::GetAddressGroupings()
+{
+    AssertLockHeld(cs_wallet); // mapWallet
+
+    if (!fGroupingsIndexed)
     {
-        // make a set of all the groups hit by this new group
-        set< set<CTxDestination>* > hits;
-        map< CTxDestination, set<CTxDestination>* >::iterator it;
-        for (auto const& address : grouping)
-            if ((it = setmap.find(address)) != setmap.end())
-                hits.insert((*it).second);
+        mapGroupingParents.clear();
+        setGroupingMissingInputs.clear();
 
-        // merge all hit groups into a new single group and delete old groups
-        set<CTxDestination>* merged = new set<CTxDestination>(grouping);
-        for (auto const& hit : hits)
-        {
-            merged->insert(hit->begin(), hit->end());
-            uniqueGroupings.erase(hit);
-            delete hit;
-        }
-        uniqueGroupings.insert(merged);
+        for (auto const& walletEntry : mapWallet)
+            AddToGroupings(walletEntry.second);
 
-        // update setmap
-        for (auto const& element : *merged)
-            setmap[element] = merged;
+        fGroupingsIndexed = true;
     }
 
+    map<CTxDestination, set<CTxDestination> > groups;
+
+    for (auto const& entry : mapGroupingParents)
+        groups[FindGroupingRoot(entry.first)].insert(entry.first);
+
     set< set<CTxDestination> > ret;
-    for (auto const& uniqueGrouping : uniqueGroupings)
-    {
-        ret.insert(*uniqueGrouping);
-        delete uniqueGrouping;
-    }
+
+    for (auto& group : groups)
+        ret.insert(std::move(group.second));
 
     return ret;
 }
@@ -2446,15 +3171,34 @@ void CWallet::FixSpentCoins(int& nMismatchFound, int64_t& nBalanceInQuestion, bo
     for (map<uint256, CWalletTx>::iterator it = mapWallet.begin(); it != mapWallet.end(); ++it)
         vCoins.push_back(&(*it).second);
 
+    std::vector<uint256> vHashes;
+    vHashes.reserve(vCoins.size());
+    for (auto const& pcoin : vCoins)
+        vHashes.push_back(pcoin->GetHash());
+
+    // Open the wallet database while the I/O pool reads the index:
+    auto futureTxIndex = CTxDB::ReadTxIndexesAsync(std::move(vHashes));
+
     CWalletDB walletdb(strWalletFile);
 
-    CTxDB txdb("r");
+    std::map<uint256, CTxIndex> mapTxIndex;
+    try
+    {
+        mapTxIndex = futureTxIndex.get();
+    }
+    catch (const std::exception& e)
+    {
+        error("%s: failed to read the transaction index: %s", __func__, e.what());
+        return;
+    }
+
     for (auto const& pcoin : vCoins)
     {
         // Find the corresponding transaction index
-        CTxIndex txindex;
-        if (!txdb.ReadTxIndex(pcoin->GetHash(), txindex))
+        const auto txindex_iter = mapTxIndex.find(pcoin->GetHash());
+        if (txindex_iter == mapTxIndex.end())
             continue;
+        const CTxIndex& txindex = txindex_iter->second;
         for (unsigned int n=0; n < pcoin->vout.size(); n++)
         {
             if ((IsMine(pcoin->vout[n]) != ISMINE_NO) && pcoin->IsSpent(n) && (txindex.vSpent.size() <= n || txindex.vSpent[n].IsNull()))
@@ -2647,7 +3391,7 @@ void CWallet::UpdatedTransaction(const uint256 &hashTx)
         // Only notify UI if this transaction is in this wallet
         map<uint256, CWalletTx>::const_iterator mi = mapWallet.find(hashTx);
         if (mi != mapWallet.end())
-            NotifyTransactionChanged(this, hashTx, CT_UPDATED);
+            NotifyTransaction(hashTx, CT_UPDATED);
     }
 }
 
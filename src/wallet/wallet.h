@@ -5,11 +5,18 @@
 #ifndef BITCOIN_WALLET_H
 #define BITCOIN_WALLET_H
 
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <queue>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <set>
 #include <stdlib.h>
 #include "gridcoin/staking/status.h"
+#include "blockfilter.h"
+#include "crypto/siphash.h"
 #include "main.h"
 #include "key.h"
 #include "keystore.h"
@@ -21,8 +28,16 @@
 
 extern bool fWalletUnlockStakingOnly;
 extern bool fConfChange;
+extern unsigned int nCoinSelectionTries;
+
+/** Default number of nodes the branch-and-bound coin selection may visit. */
+static const unsigned int DEFAULT_COIN_SELECTION_TRIES = 100000;
+/** Number of keys that the background key pool refill generates between
+    releases of the wallet lock. */
+static const unsigned int KEYPOOL_REFILL_BATCH_SIZE = 10;
 class CAccountingEntry;
 class CWalletTx;
+class CWalletWriteBatch;
 class CReserveKey;
 class COutput;
 class CCoinControl;
@@ -93,12 +108,167 @@ private:
 
     CWalletDB *pwalletdbEncryption;
 
+    // Database handle shared by the writes of an active CWalletWriteBatch,
+    // or NULL. Guarded by cs_wallet.
+    CWalletDB *pwalletdbBatch;
+    friend class CWalletWriteBatch;
+
+    // Transaction notifications deferred until the active CWalletWriteBatch
+    // ends, or NULL. Guarded by cs_wallet.
+    std::map<uint256, ChangeType> *pmapNotifyBatch;
+
+    // Signal NotifyTransactionChanged, or defer it to the active batch.
+    // Requires cs_wallet.
+    void NotifyTransaction(const uint256& hash, ChangeType status);
+
     // the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion;
 
     // the maximum wallet format version: memory-only variable that specifies to what version this wallet may be upgraded
     int nWalletMaxVersion;
 
+    /** Wallet balances totaled in one pass over mapWallet. */
+    struct BalanceTotals
+    {
+        int64_t nBalance;
+        int64_t nUnconfirmed;
+        int64_t nImmature;
+        int64_t nStake;
+    };
+
+    // Balances cached by the last call to GetBalanceTotals(). The totals stay
+    // valid until a wallet transaction, the chain tip, or the memory pool
+    // changes.
+    mutable BalanceTotals cachedBalances;
+    mutable bool fBalancesCached;
+    mutable const CBlockIndex* pindexBalancesCached;
+    mutable unsigned int nMempoolBalancesCached;
+
+    /** Get the wallet balances, recalculating them when they are out of date.
+        Requires cs_main and cs_wallet.
+     */
+    const BalanceTotals& GetBalanceTotals() const;
+
+    // Per-address balances cached by the last call to GetAddressBalances().
+    // They depend on the same state as the wallet balances, so they follow
+    // the same invalidation.
+    mutable std::map<CTxDestination, int64_t> cachedAddressBalances;
+    mutable bool fAddressBalancesCached;
+    mutable const CBlockIndex* pindexAddressBalancesCached;
+    mutable unsigned int nMempoolAddressBalancesCached;
+
+    // Stake weight state kept by GetStakeWeight(). The queue holds the time
+    // and value of each stakeable output that had not reached the minimum
+    // stake age, earliest first, so that the weight grows as outputs age
+    // without another pass over the wallet. Rebuilt when the balances, the
+    // chain tip, the memory pool or the reserve balance change.
+    typedef std::pair<int64_t, int64_t> StakeMaturityEntry;
+    typedef std::priority_queue<StakeMaturityEntry, std::vector<StakeMaturityEntry>, std::greater<StakeMaturityEntry> > StakeMaturityQueue;
+    mutable StakeMaturityQueue queueStakeMaturity;
+    mutable int64_t nStakeWeightMatured;
+    mutable bool fStakeWeightCached;
+    mutable const CBlockIndex* pindexStakeWeightCached;
+    mutable unsigned int nMempoolStakeWeightCached;
+    mutable int64_t nBalanceStakeWeightCached;
+    mutable int64_t nTimeStakeWeightCached;
+
+    // Address groupings stored as a disjoint-set forest. Each address maps to
+    // its parent, and the root of each tree identifies a group. Built on first
+    // use and then extended as new wallet transactions arrive. Changes to the
+    // keys or the address book can split groups, so they force a rebuild.
+    // Guarded by cs_wallet.
+    mutable std::map<CTxDestination, CTxDestination> mapGroupingParents;
+    mutable bool fGroupingsIndexed;
+
+    // Incremented when a change to the keys or the address book can change
+    // which outputs belong to the wallet or count as change. Wallet
+    // transactions compare it to detect stale cached amounts.
+    mutable unsigned int nOwnershipRevision;
+
+    /** Hashes output scripts with a random key, so that the senders of
+        transactions cannot choose scripts that collide in the cache. */
+    class CScriptHasher
+    {
+    private:
+        uint64_t k0;
+        uint64_t k1;
+
+    public:
+        CScriptHasher()
+            : k0(GetRand(std::numeric_limits<uint64_t>::max()))
+            , k1(GetRand(std::numeric_limits<uint64_t>::max()))
+        {
+        }
+
+        size_t operator()(const CScript& script) const
+        {
+            return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize();
+        }
+    };
+
+    // Wallet transactions by nOrderPos. Updated as transactions enter the
+    // wallet, and rebuilt on the next use when it no longer covers mapWallet,
+    // so that walking the newest activity does not sort the whole wallet.
+    // Guarded by cs_wallet.
+    std::multimap<int64_t, CWalletTx*> wtxOrdered;
+
+    const std::multimap<int64_t, CWalletTx*>& GetOrderedWalletTxs();
+
+    // Results of ::IsMine() for output scripts. Cleared with the rest of the
+    // ownership state when keys or scripts are added. Guarded by its own lock
+    // because IsMine() does not require cs_wallet.
+    static constexpr size_t MAX_ISMINE_CACHE_SIZE = 100000;
+    mutable CCriticalSection cs_IsMineCache;
+    mutable std::unordered_map<CScript, isminetype, CScriptHasher> mapIsMineCache;
+
+    // Hashes of transactions missing from the wallet that the groupings would
+    // read the inputs of. Their arrival forces a rebuild of the groupings.
+    mutable std::set<uint256> setGroupingMissingInputs;
+
+    /** Find the address that identifies the group of an address, adding the
+        address as a group of its own if needed. Requires cs_wallet.
+     */
+    CTxDestination FindGroupingRoot(const CTxDestination& address) const;
+
+    /** Merge the addresses linked by a wallet transaction into the groupings.
+        Requires cs_wallet.
+     */
+    void AddToGroupings(const CWalletTx& wtx) const;
+
+    // Set while a background thread refills the key pool.
+    std::atomic<bool> fKeyPoolRefilling;
+
+    // Refills the key pool. Started and replaced under cs_wallet.
+    boost::thread threadKeyPoolRefill;
+
+    // Set by StopKeyPoolRefill() to refuse further refills. Guarded by
+    // cs_wallet.
+    bool fKeyPoolRefillStopped;
+
+    // Wallet transactions with at least one unspent output that belongs to
+    // the wallet, ordered by transaction time so that staking can skip the
+    // outputs that have not reached the minimum stake age. Built on first use
+    // and then kept current as wallet transactions change. Guarded by
+    // cs_wallet.
+    typedef std::set<std::pair<unsigned int, const CWalletTx*> > SpendableIndex;
+    mutable SpendableIndex setSpendable;
+    mutable bool fSpendableIndexed;
+
+    /** Build the index of spendable wallet transactions if needed.
+        Requires cs_wallet.
+     */
+    const SpendableIndex& GetSpendableIndex() const;
+
+    /** Determine whether a wallet transaction has an unspent output that
+        belongs to the wallet.
+     */
+    bool HasSpendableOutput(const CWalletTx& wtx) const;
+
+    /** Get the compact block filter elements that match transactions
+        involving the wallet's keys and scripts.
+     */
+    GCSFilter::ElementSet GetFilterElements() const;
+
 public:
     /// Main wallet lock.
     /// This lock protects all the fields added by CWallet
@@ -131,6 +301,11 @@ public:
         fFileBacked = true;
     }
 
+    ~CWallet()
+    {
+        StopKeyPoolRefill();
+    }
+
     //!
     //! \brief Get the public key used to verify administrative contracts.
     //!
@@ -180,10 +355,66 @@ public:
         fFileBacked = false;
         nMasterKeyMaxID = 0;
         pwalletdbEncryption = NULL;
+        pwalletdbBatch = NULL;
+        pmapNotifyBatch = NULL;
         nOrderPosNext = 0;
         nTimeFirstKey = 0;
+        fBalancesCached = false;
+        pindexBalancesCached = NULL;
+        nMempoolBalancesCached = 0;
+        fAddressBalancesCached = false;
+        pindexAddressBalancesCached = NULL;
+        nMempoolAddressBalancesCached = 0;
+        nStakeWeightMatured = 0;
+        fStakeWeightCached = false;
+        pindexStakeWeightCached = NULL;
+        nMempoolStakeWeightCached = 0;
+        nBalanceStakeWeightCached = 0;
+        nTimeStakeWeightCached = 0;
+        fGroupingsIndexed = false;
+        nOwnershipRevision = 0;
+        fKeyPoolRefilling = false;
+        fKeyPoolRefillStopped = false;
+        fSpendableIndexed = false;
+    }
+
+    /** Invalidate the cached wallet balances. Called when any wallet
+        transaction changes in a way that can affect a balance.
+     */
+    void MarkBalancesDirty() const
+    {
+        fBalancesCached = false;
+        fAddressBalancesCached = false;
+        fStakeWeightCached = false;
     }
 
+    /** Rebuild the address groupings on next use. Called when the keys or
+        the address book change.
+     */
+    void MarkGroupingsDirty() const
+    {
+        fGroupingsIndexed = false;
+    }
+
+    /** Invalidate the state derived from which outputs belong to the wallet.
+        Called when the keys or the address book change.
+     */
+    void MarkOwnershipChanged() const
+    {
+        MarkGroupingsDirty();
+        ++nOwnershipRevision;
+
+        LOCK(cs_IsMineCache);
+        mapIsMineCache.clear();
+    }
+
+    unsigned int GetOwnershipRevision() const { return nOwnershipRevision; }
+
+    /** Refresh the entry for a wallet transaction in the index of spendable
+        transactions after a change to its outputs or their spent flags.
+     */
+    void UpdateSpendableIndex(const CWalletTx& wtx) const;
+
     std::map<uint256, CWalletTx> mapWallet;
     int64_t nOrderPosNext;
     std::map<uint256, int> mapRequestCount;
@@ -209,7 +440,7 @@ public:
     // Adds a key to the store, and saves it to disk.
     bool AddKey(const CKey& key);
     // Adds a key to the store, without saving it to disk (used by LoadWallet)
-    bool LoadKey(const CKey& key) { return CCryptoKeyStore::AddKey(key); }
+    bool LoadKey(const CKey& key) { MarkOwnershipChanged(); return CCryptoKeyStore::AddKey(key); }
     // Load metadata (used by LoadWallet)
     bool LoadKeyMetadata(const CPubKey &pubkey, const CKeyMetadata &metadata);
 
@@ -243,6 +474,17 @@ public:
      */
     TxItems OrderedTxItems(std::list<CAccountingEntry>& acentries, std::string strAccount = "");
 
+    /** Visit the wallet's activity log from the newest item to the oldest
+        without ordering the whole wallet, for callers that only read the most
+        recent items.
+        @param[in] fn  Called with either a transaction or an accounting entry
+                       of the account. Return false to stop.
+     */
+    void ForEachTxItemNewestFirst(const std::string& strAccount, const std::function<bool(CWalletTx*, CAccountingEntry*)>& fn);
+
+    /** Drop the order index after nOrderPos values change in place. */
+    void MarkTxOrderDirty() { AssertLockHeld(cs_wallet); wtxOrdered.clear(); }
+
     void MarkDirty();
     bool AddToWallet(const CWalletTx& wtxIn, CWalletDB *pwalletdb);
     bool AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pblock, bool fUpdate = false, bool fFindBlock = false);
@@ -256,6 +498,12 @@ public:
     int64_t GetImmatureBalance() const;
     int64_t GetStake() const;
     int64_t GetNewMint() const;
+
+    /** Get the total value of the outputs that can stake at a time: outputs
+        covered by the balance left after the reserve that have passed the
+        minimum stake age.
+     */
+    int64_t GetStakeWeight(int64_t nTime) const;
     bool CreateTransaction(const std::vector<std::pair<CScript, int64_t> >& vecSend, CWalletTx& wtxNew, CReserveKey& reservekey, int64_t& nFeeRet, const CCoinControl *coinControl=NULL);
     bool CreateTransaction(const std::vector<std::pair<CScript, int64_t> >& vecSend, std::set<std::pair<const CWalletTx*,unsigned int>>& setCoins, CWalletTx& wtxNew, CReserveKey& reservekey, int64_t& nFeeRet, const CCoinControl *coinControl=NULL);
     bool CreateTransaction(CScript scriptPubKey, int64_t nValue, CWalletTx& wtxNew, CReserveKey& reservekey, int64_t& nFeeRet, const CCoinControl *coinControl=NULL);
@@ -266,6 +514,22 @@ public:
 
     bool NewKeyPool();
     bool TopUpKeyPool(unsigned int nSize = 0);
+
+    /** Refill the key pool from a background thread when it drops below the
+        -keypoollowwater mark. Requires cs_wallet.
+     */
+    void RequestKeyPoolRefill();
+
+    /** Top up the key pool in batches, releasing the wallet lock between each
+        batch. Runs on the thread started by RequestKeyPoolRefill().
+     */
+    void RefillKeyPool();
+
+    /** Interrupt and wait for the background key pool refill and refuse to
+        start another. Call before closing the wallet database. Must not hold
+        cs_wallet.
+     */
+    void StopKeyPoolRefill();
     int64_t AddReserveKey(const CKeyPool& keypool);
     void ReserveKeyFromKeyPool(int64_t& nIndex, CKeyPool& keypool);
     void KeepKey(int64_t nIndex);
@@ -281,10 +545,7 @@ public:
 
     isminetype IsMine(const CTxIn& txin) const;
     int64_t GetDebit(const CTxIn& txin, const isminefilter& filter=(ISMINE_SPENDABLE|ISMINE_WATCH_ONLY)) const;
-    isminetype IsMine(const CTxOut& txout) const
-    {
-        return ::IsMine(*this, txout.scriptPubKey);
-    }
+    isminetype IsMine(const CTxOut& txout) const;
     int64_t GetCredit(const CTxOut& txout, const isminefilter& filter=(ISMINE_WATCH_ONLY|ISMINE_SPENDABLE)) const
     {
         if (!MoneyRange(txout.nValue))
@@ -415,6 +676,30 @@ public:
     boost::signals2::signal<void (CWallet *wallet, const uint256 &hashTx, ChangeType status)> NotifyTransactionChanged;
 };
 
+/** Routes the wallet database writes made while it exists, such as the
+ * updates for the transactions of a block or a rescan, or the keys of a key
+ * pool top-up, through one database handle. The handle flushes the database
+ * log once when the batch ends instead of once per write. Batches nest: an
+ * inner batch reuses the handle of the outer one. The batch also collects the
+ * transaction notifications and signals each changed transaction once when
+ * it ends.
+ * @note requires lock cs_wallet held for the lifetime of the batch.
+ */
+class CWalletWriteBatch
+{
+private:
+    CWallet& wallet;
+    std::unique_ptr<CWalletDB> pwalletdb; // NULL when nested
+    std::map<uint256, ChangeType> mapNotify;
+
+public:
+    explicit CWalletWriteBatch(CWallet& walletIn);
+    ~CWalletWriteBatch();
+
+    CWalletWriteBatch(const CWalletWriteBatch&) = delete;
+    CWalletWriteBatch& operator=(const CWalletWriteBatch&) = delete;
+};
+
 /** A key allocated from the key pool. */
 class CReserveKey
 {
@@ -496,6 +781,7 @@ public:
 	mutable bool fWatchDebitCached;
 	mutable bool fWatchCreditCached;
     mutable bool fChangeCached;
+    mutable bool fAmountsCached;
     mutable int64_t nDebitCached;
     mutable int64_t nCreditCached;
     mutable int64_t nAvailableCreditCached;
@@ -503,6 +789,14 @@ public:
 	mutable int64_t nWatchCreditCached;
     mutable int64_t nChangeCached;
 
+    // Result of the last GetAmounts() call, valid for the filter and the
+    // wallet ownership revision that it was computed for:
+    mutable std::list<COutputEntry> listReceivedCached;
+    mutable std::list<COutputEntry> listSentCached;
+    mutable int64_t nFeeCached;
+    mutable isminefilter nAmountsFilterCached;
+    mutable unsigned int nAmountsRevisionCached;
+
     CWalletTx()
     {
         Init(NULL);
@@ -541,12 +835,18 @@ public:
 		fWatchDebitCached = false;
 		fWatchCreditCached = false;
         fChangeCached = false;
+        fAmountsCached = false;
         nDebitCached = 0;
         nCreditCached = 0;
         nAvailableCreditCached = 0;
 		nWatchDebitCached = 0;
 		nWatchCreditCached = 0;
         nChangeCached = 0;
+        listReceivedCached.clear();
+        listSentCached.clear();
+        nFeeCached = 0;
+        nAmountsFilterCached = ISMINE_NO;
+        nAmountsRevisionCached = 0;
         nOrderPos = -1;
     }
 
@@ -630,6 +930,8 @@ public:
                 fAvailableCreditCached = false;
             }
         }
+        if (fReturn)
+            MarkWalletSpentDirty();
         return fReturn;
     }
 
@@ -642,6 +944,25 @@ public:
 		fWatchCreditCached = false;
         fDebitCached = false;
         fChangeCached = false;
+        fAmountsCached = false;
+        MarkWalletBalancesDirty();
+    }
+
+    // make sure the wallet-wide balance totals are recalculated
+    void MarkWalletBalancesDirty() const
+    {
+        if (pwallet)
+            pwallet->MarkBalancesDirty();
+    }
+
+    // make sure the wallet refreshes its view of this transaction's unspent outputs
+    void MarkWalletSpentDirty() const
+    {
+        if (pwallet)
+        {
+            pwallet->MarkBalancesDirty();
+            pwallet->UpdateSpendableIndex(*this);
+        }
     }
 
     void BindWallet(CWallet *pwalletIn)
@@ -659,6 +980,7 @@ public:
         {
             vfSpent[nOut] = true;
             fAvailableCreditCached = false;
+            MarkWalletSpentDirty();
         }
     }
 
@@ -671,6 +993,7 @@ public:
         {
             vfSpent[nOut] = false;
             fAvailableCreditCached = false;
+            MarkWalletSpentDirty();
         }
     }
 
@@ -765,9 +1088,19 @@ public:
         return nChangeCached;
     }
 
+    /** Decompose the transaction into the outputs sent and received by the
+        wallet. The result is cached until the transaction changes or a key or
+        address book change affects which outputs belong to the wallet.
+     */
     void GetAmounts(std::list<COutputEntry>& listReceived, std::list<COutputEntry>& listSent, int64_t& nFee, std::string& strSentAccount,
         const isminefilter& filter=(ISMINE_SPENDABLE|ISMINE_WATCH_ONLY)) const;
 
+private:
+    void ComputeAmounts(std::list<COutputEntry>& listReceived, std::list<COutputEntry>& listSent, int64_t& nFee,
+        const isminefilter& filter) const;
+
+public:
+
 
     void GetAccountAmounts(const std::string& strAccount, int64_t& nReceived,
                               int64_t& nSent, int64_t& nFee, const isminefilter& filter=(ISMINE_SPENDABLE|ISMINE_WATCH_ONLY)) const;
@@ -9,6 +9,8 @@
 #include "init.h"
 #include <fstream>
 
+#include <boost/thread.hpp>
+
 using namespace std;
 using namespace boost;
 
@@ -136,6 +138,7 @@ CWalletDB::ReorderTransactions(CWallet* pwallet)
 
     int64_t& nOrderPosNext = pwallet->nOrderPosNext;
     nOrderPosNext = 0;
+    pwallet->MarkTxOrderDirty();
     std::vector<int64_t> nOrderPosOffsets;
     for (TxItems::iterator it = txByTime.begin(); it != txByTime.end(); ++it)
     {
@@ -200,6 +203,170 @@ public:
     }
 };
 
+namespace {
+//!
+//! \brief Maximum number of threads that decode wallet transactions at load.
+//!
+constexpr size_t WALLET_LOAD_MAX_THREADS = 8;
+
+//!
+//! \brief Wallets with fewer transaction records than this load them on one
+//! thread.
+//!
+constexpr size_t WALLET_LOAD_MIN_PARALLEL_TXS = 256;
+
+//!
+//! \brief Decode a wallet transaction record.
+//!
+//! Touches no wallet state so that threads can decode records in parallel.
+//!
+//! \param ssKey    Key of the record positioned after the record type.
+//! \param ssValue  Serialized wallet transaction.
+//! \param hash     Receives the hash of the transaction in the key.
+//! \param wtx      Receives the decoded transaction.
+//! \param fUpgrade Set when the record needs a rewrite in the current format.
+//! \param strErr   Receives a message to log about the record.
+//!
+//! \return \c false if the record is corrupt.
+//!
+bool DecodeWalletTx(
+    CDataStream& ssKey,
+    CDataStream& ssValue,
+    uint256& hash,
+    CWalletTx& wtx,
+    bool& fUpgrade,
+    string& strErr)
+{
+    ssKey >> hash;
+    ssValue >> wtx;
+
+    if (!wtx.CheckTransaction() || wtx.GetHash() != hash)
+        return false;
+
+    // Undo serialize changes in 31600
+    if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+    {
+        if (!ssValue.empty())
+        {
+            char fTmp;
+            char fUnused;
+            ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+            strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                               wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = fTmp;
+        }
+        else
+        {
+            strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+            wtx.fTimeReceivedIsTxTime = 0;
+        }
+        fUpgrade = true;
+    }
+
+    return true;
+}
+
+//!
+//! \brief Add a decoded wallet transaction to the wallet.
+//!
+void LoadWalletTx(CWallet* pwallet, CWalletScanState& wss, const uint256& hash, CWalletTx&& wtxIn, bool fUpgrade)
+{
+    CWalletTx& wtx = pwallet->mapWallet[hash];
+    wtx = std::move(wtxIn);
+    wtx.BindWallet(pwallet);
+
+    if (fUpgrade)
+        wss.vWalletUpgrade.push_back(hash);
+
+    if (wtx.nOrderPos == -1)
+        wss.fAnyUnordered = true;
+}
+
+//!
+//! \brief A wallet transaction record read by the cursor and decoded later.
+//!
+class WalletTxRecord
+{
+public:
+    WalletTxRecord(CDataStream ssKeyIn, CDataStream ssValueIn)
+        : ssKey(std::move(ssKeyIn)), ssValue(std::move(ssValueIn)), fOk(false), fUpgrade(false)
+    {
+    }
+
+    void Decode()
+    {
+        try {
+            string strType;
+            ssKey >> strType;
+            fOk = DecodeWalletTx(ssKey, ssValue, hash, wtx, fUpgrade, strErr);
+        } catch (...) {
+            fOk = false;
+        }
+    }
+
+    CDataStream ssKey;
+    CDataStream ssValue;
+    uint256 hash;
+    CWalletTx wtx;
+    bool fOk;
+    bool fUpgrade;
+    string strErr;
+};
+
+//!
+//! \brief Determine whether a wallet record holds a transaction.
+//!
+bool IsTxRecord(const CDataStream& ssKey)
+{
+    try {
+        CDataStream ssType(ssKey);
+        string strType;
+        ssType >> strType;
+
+        return strType == "tx";
+    } catch (...) {
+        return false; // ReadKeyValue() reports the error.
+    }
+}
+
+//!
+//! \brief Decode wallet transaction records in parallel.
+//!
+//! Decoding the transactions dominates the time to load a large wallet. The
+//! records do not depend on each other, so split them into one contiguous
+//! range per thread.
+//!
+void DecodeWalletTxRecords(std::vector<WalletTxRecord>& vRecords)
+{
+    const size_t nThreads = vRecords.size() < WALLET_LOAD_MIN_PARALLEL_TXS
+        ? 1
+        : std::max<size_t>(1, std::min<size_t>(
+            boost::thread::hardware_concurrency(),
+            WALLET_LOAD_MAX_THREADS));
+
+    const auto decode_range = [&vRecords](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; ++i)
+            vRecords[i].Decode();
+    };
+
+    if (nThreads == 1) {
+        decode_range(0, vRecords.size());
+        return;
+    }
+
+    boost::thread_group threads;
+
+    for (size_t i = 0; i < nThreads; ++i) {
+        threads.create_thread(std::bind(
+            decode_range,
+            vRecords.size() * i / nThreads,
+            vRecords.size() * (i + 1) / nThreads));
+    }
+
+    threads.join_all();
+}
+} // anonymous namespace
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, string& strType, string& strErr)
@@ -218,39 +385,13 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
         else if (strType == "tx")
         {
             uint256 hash;
-            ssKey >> hash;
-            CWalletTx& wtx = pwallet->mapWallet[hash];
-            ssValue >> wtx;
-            if (wtx.CheckTransaction() && (wtx.GetHash() == hash))
-                wtx.BindWallet(pwallet);
-            else
-            {
-                pwallet->mapWallet.erase(hash);
-                return false;
-            }
+            CWalletTx wtx;
+            bool fUpgrade = false;
 
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
+            if (!DecodeWalletTx(ssKey, ssValue, hash, wtx, fUpgrade, strErr))
+                return false;
 
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
+            LoadWalletTx(pwallet, wss, hash, std::move(wtx), fUpgrade);
         }
         else if (strType == "acentry")
         {
@@ -447,6 +588,10 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
+        // Transactions decode after the cursor finishes. See
+        // DecodeWalletTxRecords():
+        std::vector<WalletTxRecord> vTxRecords;
+
         while (true)
         {
             // Read next record
@@ -461,6 +606,12 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 return DB_CORRUPT;
             }
 
+            if (IsTxRecord(ssKey))
+            {
+                vTxRecords.emplace_back(std::move(ssKey), std::move(ssValue));
+                continue;
+            }
+
             // Try to be tolerant of single corrupt records:
             string strType, strErr;
             if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
@@ -482,6 +633,24 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
                 LogPrintf("%s", strErr);
         }
         pcursor->close();
+
+        DecodeWalletTxRecords(vTxRecords);
+
+        // Add the transactions in the order of the records:
+        for (auto& record : vTxRecords)
+        {
+            if (record.fOk)
+                LoadWalletTx(pwallet, wss, record.hash, std::move(record.wtx), record.fUpgrade);
+            else
+            {
+                fNoncriticalErrors = true;
+                // Rescan if there is a bad transaction record:
+                SoftSetBoolArg("-rescan", true);
+            }
+
+            if (!record.strErr.empty())
+                LogPrintf("%s", record.strErr);
+        }
     }
     catch (...)
     {
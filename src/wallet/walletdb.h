@@ -135,6 +135,26 @@ public:
         return Read(std::string("bestblock"), locator);
     }
 
+    // The tip of the chain and the next transaction order position when
+    // CWallet::ReacceptWalletTransactions() last checked the spent state of
+    // the wallet against the transaction index.
+    bool WriteSpentCheck(const uint256& hashBlock, int64_t nOrderPos)
+    {
+        nWalletDBUpdated++;
+        return Write(std::string("spentcheck"), std::make_pair(hashBlock, nOrderPos));
+    }
+
+    bool ReadSpentCheck(uint256& hashBlock, int64_t& nOrderPos)
+    {
+        std::pair<uint256, int64_t> check;
+        if (!Read(std::string("spentcheck"), check))
+            return false;
+
+        hashBlock = check.first;
+        nOrderPos = check.second;
+        return true;
+    }
+
     bool WriteOrderPosNext(int64_t nOrderPosNext)
     {
         nWalletDBUpdated++;